@@ -0,0 +1,546 @@
+// Copyright (C) 2017 David Reid. See included LICENSE file.
+
+// Command: dred -f benchmark [Benchmark Name] [Options]
+//    lines [Line Count] : Compares the text engine's line cache against a flat array of line offsets. Defaults to 5000000 lines.
+//    newlines [Size in MB] : Compares a byte-at-a-time search for line breaks against the text engine's vectorized one. Defaults to 256MB.
+//    find [Size in MB] : Compares a character-at-a-time search of the text engine against drte_engine_find(). Defaults to 256MB.
+//    measure [Call Count] : Compares measuring strings with Cairo against the cached glyph advances of dtk_font_measure_string(). Defaults to 1000000 calls.
+//
+// Implementation: dred_benchmark
+
+double dred_benchmark__get_time_in_seconds()
+{
+#ifdef DRED_WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+#endif
+}
+
+// A simple pseudo-random number generator so that runs are reproducible across platforms.
+unsigned int dred_benchmark__rand(unsigned int* pState)
+{
+    *pState = (*pState * 1103515245) + 12345;
+    return (*pState >> 8) & 0x00FFFFFF;
+}
+
+
+//// Lines ////
+//
+// The flat array below is how the line cache used to work. It's kept here as a baseline to measure against.
+typedef struct
+{
+    size_t* pLines;
+    size_t count;
+} dred_benchmark_line_array;
+
+void dred_benchmark_line_array__insert_line(dred_benchmark_line_array* pArray, size_t iLine, size_t iCharBeg, size_t characterOffset)
+{
+    for (size_t i = pArray->count; i > iLine; --i) {
+        pArray->pLines[i] = pArray->pLines[i-1] + characterOffset;
+    }
+
+    pArray->pLines[iLine] = iCharBeg;
+    pArray->count += 1;
+}
+
+void dred_benchmark_line_array__remove_line(dred_benchmark_line_array* pArray, size_t iLine, size_t characterOffset)
+{
+    for (size_t i = iLine; i < pArray->count-1; ++i) {
+        pArray->pLines[i] = pArray->pLines[i+1] - characterOffset;
+    }
+
+    pArray->count -= 1;
+}
+
+size_t dred_benchmark_line_array__find_line_by_character(dred_benchmark_line_array* pArray, size_t iChar)
+{
+    size_t iLo = 0;
+    size_t iHi = pArray->count;
+    while (iHi - iLo > 1) {
+        size_t iMid = iLo + (iHi - iLo)/2;
+        if (pArray->pLines[iMid] <= iChar) {
+            iLo = iMid;
+        } else {
+            iHi = iMid;
+        }
+    }
+
+    return iLo;
+}
+
+int dred_benchmark_lines(int argc, char** argv)
+{
+    size_t lineCount = 5000000;
+    if (argc > 2) {
+        lineCount = (size_t)atoll(argv[2]);
+    }
+
+    if (lineCount < 2) {
+        lineCount = 2;
+    }
+
+    const size_t lineLength = 40;   // Including the new line character.
+    const size_t editCount = 100;       // <-- Kept low because the array is so slow at these.
+    const size_t lookupCount = 1000000;
+
+    // The synthetic file is just a bunch of lines of the same length.
+    size_t textLength = lineCount * lineLength;
+    char* pText = (char*)malloc(textLength);
+    if (pText == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < textLength; ++i) {
+        pText[i] = ((i % lineLength) == lineLength-1) ? '\n' : 'a';
+    }
+
+    dred_benchmark_line_array lineArray;
+    lineArray.pLines = (size_t*)malloc((lineCount + editCount + 2) * sizeof(size_t));
+    if (lineArray.pLines == NULL) {
+        free(pText);
+        return -1;
+    }
+
+    drte_line_cache lineCache;
+    if (!drte_line_cache_init(&lineCache)) {
+        free(lineArray.pLines);
+        free(pText);
+        return -1;
+    }
+
+    printf("Lines: %u lines, %u bytes\n", (unsigned int)lineCount, (unsigned int)textLength);
+    printf("%-28s %12s %12s\n", "", "array", "tree");
+
+
+    // Loading.
+    double arrayTime = dred_benchmark__get_time_in_seconds();
+    {
+        lineArray.pLines[0] = 0;
+        lineArray.count = 1;
+        for (size_t i = 0; i < textLength; ++i) {
+            if (pText[i] == '\n') {
+                lineArray.pLines[lineArray.count++] = i+1;
+            }
+        }
+    }
+    arrayTime = dred_benchmark__get_time_in_seconds() - arrayTime;
+
+    double treeTime = dred_benchmark__get_time_in_seconds();
+    {
+        drte_line_cache_insert_lines_from_text(&lineCache, 1, 0, pText, textLength);
+    }
+    treeTime = dred_benchmark__get_time_in_seconds() - treeTime;
+
+    printf("%-28s %10.3fms %10.3fms\n", "Load", arrayTime*1000, treeTime*1000);
+
+
+    // Lookups.
+    unsigned int seed = 1;
+    size_t checksumArray = 0;
+    arrayTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < lookupCount; ++i) {
+        checksumArray += dred_benchmark_line_array__find_line_by_character(&lineArray, (dred_benchmark__rand(&seed) * 256 + dred_benchmark__rand(&seed)) % textLength);
+    }
+    arrayTime = dred_benchmark__get_time_in_seconds() - arrayTime;
+
+    seed = 1;
+    size_t checksumTree = 0;
+    treeTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < lookupCount; ++i) {
+        checksumTree += drte_line_cache_find_line_by_character(&lineCache, (dred_benchmark__rand(&seed) * 256 + dred_benchmark__rand(&seed)) % textLength);
+    }
+    treeTime = dred_benchmark__get_time_in_seconds() - treeTime;
+
+    printf("%-28s %10.3fms %10.3fms\n", "Find line by character", arrayTime*1000, treeTime*1000);
+    if (checksumArray != checksumTree) {
+        printf("ERROR: Lookup results differ.\n");
+    }
+
+
+    // Edits. Lines are inserted and removed near the top of the file which is the worst case for the array.
+    arrayTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < editCount; ++i) {
+        size_t iLine = 1 + (i % 100);
+        if ((i & 1) == 0) {
+            dred_benchmark_line_array__insert_line(&lineArray, iLine, lineArray.pLines[iLine-1] + 1, 1);
+        } else {
+            dred_benchmark_line_array__remove_line(&lineArray, iLine, 1);
+        }
+    }
+    arrayTime = dred_benchmark__get_time_in_seconds() - arrayTime;
+
+    treeTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < editCount; ++i) {
+        size_t iLine = 1 + (i % 100);
+        if ((i & 1) == 0) {
+            drte_line_cache_insert_lines_from_text(&lineCache, iLine, drte_line_cache_get_line_first_character(&lineCache, iLine-1), "\n", 1);
+        } else {
+            drte_line_cache_remove_lines(&lineCache, iLine, 1, 1);
+        }
+    }
+    treeTime = dred_benchmark__get_time_in_seconds() - treeTime;
+
+    printf("%-28s %10.3fms %10.3fms\n", "Insert/remove line at top", arrayTime*1000, treeTime*1000);
+
+
+    // Typing on the first line offsets every line after it.
+    arrayTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < editCount; ++i) {
+        for (size_t iLine = 1; iLine < lineArray.count; ++iLine) {
+            lineArray.pLines[iLine] += 1;
+        }
+    }
+    arrayTime = dred_benchmark__get_time_in_seconds() - arrayTime;
+
+    treeTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < editCount; ++i) {
+        drte_line_cache_offset_lines(&lineCache, 1, 1);
+    }
+    treeTime = dred_benchmark__get_time_in_seconds() - treeTime;
+
+    printf("%-28s %10.3fms %10.3fms\n", "Type on first line", arrayTime*1000, treeTime*1000);
+
+
+    // Sanity check. Both structures should have ended up in the same place.
+    drte_bool32 isConsistent = drte_line_cache_get_line_count(&lineCache) == lineArray.count;
+    for (size_t iLine = 0; isConsistent && iLine < lineArray.count; iLine += 997) {
+        isConsistent = drte_line_cache_get_line_first_character(&lineCache, iLine) == lineArray.pLines[iLine];
+    }
+
+    if (!isConsistent) {
+        printf("ERROR: Line cache and array are inconsistent.\n");
+    }
+
+    drte_line_cache_uninit(&lineCache);
+    free(lineArray.pLines);
+    free(pText);
+
+    return isConsistent ? 0 : -2;
+}
+
+
+//// Newlines ////
+int dred_benchmark_newlines(int argc, char** argv)
+{
+    size_t sizeInMB = 256;
+    if (argc > 2) {
+        sizeInMB = (size_t)atoll(argv[2]);
+    }
+
+    if (sizeInMB == 0) {
+        sizeInMB = 1;
+    }
+
+    // Lines of varying length, similar to source code.
+    size_t textLength = sizeInMB * 1024 * 1024;
+    char* pText = (char*)malloc(textLength);
+    if (pText == NULL) {
+        return -1;
+    }
+
+    unsigned int seed = 1;
+    size_t nextNewLine = 0;
+    for (size_t i = 0; i < textLength; ++i) {
+        if (i == nextNewLine) {
+            pText[i] = '\n';
+            nextNewLine = i + 1 + (dred_benchmark__rand(&seed) % 120);
+        } else {
+            pText[i] = 'a';
+        }
+    }
+
+    printf("Newlines: %u bytes\n", (unsigned int)textLength);
+    printf("%-28s %12s %12s\n", "", "scalar", "engine");
+
+
+    // Counting.
+    size_t countScalar = 0;
+    double scalarTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < textLength; ++i) {
+        if (pText[i] == '\n') {
+            countScalar += 1;
+        }
+    }
+    scalarTime = dred_benchmark__get_time_in_seconds() - scalarTime;
+
+    double engineTime = dred_benchmark__get_time_in_seconds();
+    size_t countEngine = drte__count_newlines(pText, textLength);
+    engineTime = dred_benchmark__get_time_in_seconds() - engineTime;
+
+    printf("%-28s %10.3fms %10.3fms\n", "Count", scalarTime*1000, engineTime*1000);
+
+
+    // Finding each line. This is what the line indexing thread does.
+    size_t lineOffsets[4096];
+    size_t checksumScalar = 0;
+    scalarTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < textLength; ++i) {
+        if (pText[i] == '\n') {
+            checksumScalar += i+1;
+        }
+    }
+    scalarTime = dred_benchmark__get_time_in_seconds() - scalarTime;
+
+    size_t checksumEngine = 0;
+    engineTime = dred_benchmark__get_time_in_seconds();
+    for (size_t scannedLength = 0; scannedLength < textLength; ) {
+        size_t lineCount;
+        size_t chunkLength = drte_find_line_offsets(pText + scannedLength, textLength - scannedLength, lineOffsets, sizeof(lineOffsets)/sizeof(lineOffsets[0]), &lineCount);
+        for (size_t i = 0; i < lineCount; ++i) {
+            checksumEngine += scannedLength + lineOffsets[i];
+        }
+
+        scannedLength += chunkLength;
+    }
+    engineTime = dred_benchmark__get_time_in_seconds() - engineTime;
+
+    printf("%-28s %10.3fms %10.3fms\n", "Find line offsets", scalarTime*1000, engineTime*1000);
+
+    free(pText);
+
+    if (countScalar != countEngine || checksumScalar != checksumEngine) {
+        printf("ERROR: Results differ.\n");
+        return -2;
+    }
+
+    return 0;
+}
+
+
+//// Find ////
+//
+// This is how searching used to work. Every character is retrieved through the piece table.
+dtk_bool32 dred_benchmark__find_naive(drte_engine* pEngine, const char* text, size_t iCharBeg, size_t* pCharOut)
+{
+    size_t textLength = strlen(text);
+    for (size_t iChar = iCharBeg; iChar + textLength <= pEngine->textLength; ++iChar) {
+        size_t i = 0;
+        while (i < textLength && drte_engine__get_char(pEngine, iChar + i) == text[i]) {
+            i += 1;
+        }
+
+        if (i == textLength) {
+            *pCharOut = iChar;
+            return DTK_TRUE;
+        }
+    }
+
+    return DTK_FALSE;
+}
+
+int dred_benchmark_find(int argc, char** argv)
+{
+    size_t sizeInMB = 256;
+    if (argc > 2) {
+        sizeInMB = (size_t)atoll(argv[2]);
+    }
+
+    if (sizeInMB == 0) {
+        sizeInMB = 1;
+    }
+
+    // Random words. The patterns are placed at the end so the whole text needs to be searched.
+    size_t textLength = sizeInMB * 1024 * 1024;
+    char* pText = (char*)malloc(textLength);
+    if (pText == NULL) {
+        return -1;
+    }
+
+    unsigned int seed = 1;
+    for (size_t i = 0; i < textLength; ++i) {
+        unsigned int r = dred_benchmark__rand(&seed) % 32;
+        pText[i] = (r < 26) ? (char)('a' + r) : ((r < 31) ? ' ' : '\n');
+    }
+
+    const char* patterns[] = {
+        "q",
+        "dred",
+        "the quick brown fox",
+        "a pattern long enough to use horspool instead of the vectorized search"
+    };
+
+    drte_engine engine;
+    if (!drte_engine_init(&engine, NULL)) {
+        free(pText);
+        return -1;
+    }
+
+    drte_engine_set_text_no_copy(&engine, pText, textLength, NULL, NULL);
+
+    // Splitting the text into a few pieces so matches need to be found across piece boundaries.
+    for (size_t i = 1; i < 8; ++i) {
+        drte_engine_insert_text(&engine, " ", (textLength/8) * i);
+    }
+
+    printf("Find: %u bytes\n", (unsigned int)textLength);
+    printf("%-28s %12s %12s %10s\n", "", "naive", "engine", "GB/s");
+
+    int result = 0;
+    for (size_t iPattern = 0; iPattern < sizeof(patterns)/sizeof(patterns[0]); ++iPattern) {
+        const char* pattern = patterns[iPattern];
+
+        // The last byte of the pattern is removed from the body of the text, but the first byte is kept since that is the worst case
+        // for the vectorized search.
+        size_t patternLength = strlen(pattern);
+        char replacement = (patternLength > 1) ? pattern[0] : ' ';
+        for (size_t i = 0; i < textLength - patternLength; ++i) {
+            if (pText[i] == pattern[patternLength-1]) {
+                pText[i] = replacement;
+            }
+        }
+        memcpy(pText + textLength - patternLength, pattern, patternLength);
+
+        size_t iCharNaive = 0;
+        double naiveTime = dred_benchmark__get_time_in_seconds();
+        dred_benchmark__find_naive(&engine, pattern, 0, &iCharNaive);
+        naiveTime = dred_benchmark__get_time_in_seconds() - naiveTime;
+
+        size_t iCharEngine = 0;
+        drte_search_pattern searchPattern;
+        drte_search_pattern_init(&searchPattern, pattern, patternLength);
+        double engineTime = dred_benchmark__get_time_in_seconds();
+        drte_engine_find(&engine, &searchPattern, 0, engine.textLength, &iCharEngine);
+        engineTime = dred_benchmark__get_time_in_seconds() - engineTime;
+        drte_search_pattern_uninit(&searchPattern);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%u byte pattern", (unsigned int)patternLength);
+        printf("%-28s %10.3fms %10.3fms %10.2f\n", name, naiveTime*1000, engineTime*1000, (textLength / engineTime) / (1024.0*1024.0*1024.0));
+
+        if (iCharNaive != iCharEngine) {
+            printf("ERROR: Results differ.\n");
+            result = -2;
+        }
+    }
+
+    drte_engine_uninit(&engine);
+    free(pText);
+
+    return result;
+}
+
+
+//// Measure ////
+#ifdef DTK_GTK
+// This is how strings used to be measured on the Cairo backend. A null terminated copy of the string is made for every call.
+dtk_int32 dred_benchmark__measure_string_cairo(dtk_font* pFont, const char* text, size_t textSizeInBytes)
+{
+    char* textNT = (char*)malloc(textSizeInBytes + 1);
+    if (textNT == NULL) {
+        return 0;
+    }
+    memcpy(textNT, text, textSizeInBytes);
+    textNT[textSizeInBytes] = '\0';
+
+    cairo_text_extents_t textMetrics;
+    cairo_scaled_font_text_extents((cairo_scaled_font_t*)pFont->cachedSubfonts[0].cairo.pFont, textNT, &textMetrics);
+
+    free(textNT);
+    return (dtk_int32)textMetrics.x_advance;
+}
+#endif
+
+int dred_benchmark_measure(int argc, char** argv)
+{
+#ifdef DTK_GTK
+    size_t callCount = 1000000;
+    if (argc > 2) {
+        callCount = (size_t)atoll(argv[2]);
+    }
+
+    if (callCount == 0) {
+        callCount = 1;
+    }
+
+    // Fonts don't need a window system so the context only needs to be set up enough to select the Cairo backend.
+    dtk_context tk;
+    memset(&tk, 0, sizeof(tk));
+    tk.platform = dtk_platform_gtk;
+
+    dtk_font font;
+    if (dtk_font_init(&tk, "monospace", 13, dtk_font_weight_normal, dtk_font_slant_none, 0, &font) != DTK_SUCCESS) {
+        return -1;
+    }
+
+    // Segments similar to what the text editor measures while painting.
+    const char* segments[] = {
+        "int",
+        "dred_text_editor__on_line_indexing_timer",
+        "    for (size_t iByte = 0; iByte < textSizeInBytes; ) {",
+        "        // The lines are taken from the thread before handing them to the engine so the thread isn't held up.",
+        "\xC3\xA9t\xC3\xA9 \xE2\x86\x92 caf\xC3\xA9 \xCE\xBB\xCE\xBC"
+    };
+    const size_t segmentCount = sizeof(segments)/sizeof(segments[0]);
+
+    printf("Measure: %u calls\n", (unsigned int)callCount);
+    printf("%-28s %12s %12s\n", "", "cairo", "cached");
+
+    int result = 0;
+    dtk_int64 checksumCairo = 0;
+    double cairoTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < callCount; ++i) {
+        const char* segment = segments[i % segmentCount];
+        checksumCairo += dred_benchmark__measure_string_cairo(&font, segment, strlen(segment));
+    }
+    cairoTime = dred_benchmark__get_time_in_seconds() - cairoTime;
+
+    dtk_int64 checksumCached = 0;
+    double cachedTime = dred_benchmark__get_time_in_seconds();
+    for (size_t i = 0; i < callCount; ++i) {
+        const char* segment = segments[i % segmentCount];
+        dtk_int32 width;
+        dtk_font_measure_string(&font, 1, segment, strlen(segment), &width, NULL);
+        checksumCached += width;
+    }
+    cachedTime = dred_benchmark__get_time_in_seconds() - cachedTime;
+
+    printf("%-28s %10.3fms %10.3fms\n", "Total", cairoTime*1000, cachedTime*1000);
+    printf("%-28s %12.0f %12.0f\n", "Calls per second", callCount / cairoTime, callCount / cachedTime);
+
+    // The cached advances are stored as floats so allow for a pixel of rounding per call.
+    dtk_int64 difference = checksumCairo - checksumCached;
+    if (difference < -(dtk_int64)callCount || difference > (dtk_int64)callCount) {
+        printf("ERROR: Results differ.\n");
+        result = -2;
+    }
+
+    dtk_font_uninit(&font);
+    return result;
+#else
+    (void)argc;
+    (void)argv;
+    printf("The measure benchmark requires the Cairo backend.\n");
+    return -1;
+#endif
+}
+
+
+// dred -f benchmark
+int dred_benchmark(int argc, char** argv)
+{
+    if (argc <= 1) {
+        return -1;  // No benchmark specified.
+    }
+
+    if (strcmp(argv[1], "lines") == 0) {
+        return dred_benchmark_lines(argc, argv);
+    }
+    if (strcmp(argv[1], "newlines") == 0) {
+        return dred_benchmark_newlines(argc, argv);
+    }
+    if (strcmp(argv[1], "find") == 0) {
+        return dred_benchmark_find(argc, argv);
+    }
+    if (strcmp(argv[1], "measure") == 0) {
+        return dred_benchmark_measure(argc, argv);
+    }
+
+    return -2;  // Unknown benchmark.
+}
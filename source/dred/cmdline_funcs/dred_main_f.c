@@ -10,7 +10,8 @@ typedef struct
 
 static dred_cmdline_func_mapping g_BuiltInCmdLineFuncs[] = {
     {"file2chex",    dred_file2chex},
-    {"file2cstring", dred_file2cstring}
+    {"file2cstring", dred_file2cstring},
+    {"benchmark",    dred_benchmark}
 };
 
 
@@ -33,6 +33,8 @@
 #include "dred_shortcuts.c"
 #include "dred_editor.c"
 #include "dred_settings_editor.c"
+#include "dred_highlighter.c"
+#include "dred_file_loader.c"
 #include "dred_text_editor.c"
 #include "dred_font.c"
 #include "dred_font_library.c"
@@ -52,4 +54,5 @@
 #include "dred_package_library.c"
 #include "cmdline_funcs/dred_file2chex.c"
 #include "cmdline_funcs/dred_file2cstring.c"
+#include "cmdline_funcs/dred_benchmark.c"
 #include "cmdline_funcs/dred_main_f.c"
\ No newline at end of file
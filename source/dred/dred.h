@@ -110,6 +110,8 @@ extern "C" {
 #include "dred_shortcuts.h"
 #include "dred_editor.h"
 #include "dred_settings_editor.h"
+#include "dred_highlighter.h"
+#include "dred_file_loader.h"
 #include "dred_text_editor.h"
 #include "dred_font.h"
 #include "dred_font_library.h"
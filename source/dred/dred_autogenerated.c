@@ -4,7 +4,7 @@
 
 
 // Commands
-#define DRED_COMMAND_COUNT 58
+#define DRED_COMMAND_COUNT 61
 
 const char g_CommandNamePool[] = 
     "!\0"
@@ -51,6 +51,9 @@ const char g_CommandNamePool[] =
     "find\0"
     "replace\0"
     "replace-all\0"
+    "find-regex\0"
+    "replace-regex\0"
+    "replace-all-regex\0"
     "show-line-numbers\0"
     "hide-line-numbers\0"
     "toggle-line-numbers\0"
@@ -112,19 +115,22 @@ const char* g_CommandNames[] = {
     g_CommandNamePool + 366,
     g_CommandNamePool + 374,
     g_CommandNamePool + 386,
-    g_CommandNamePool + 404,
-    g_CommandNamePool + 422,
-    g_CommandNamePool + 442,
-    g_CommandNamePool + 459,
-    g_CommandNamePool + 464,
-    g_CommandNamePool + 473,
+    g_CommandNamePool + 397,
+    g_CommandNamePool + 411,
+    g_CommandNamePool + 429,
+    g_CommandNamePool + 447,
+    g_CommandNamePool + 465,
     g_CommandNamePool + 485,
-    g_CommandNamePool + 500,
-    g_CommandNamePool + 519,
-    g_CommandNamePool + 533,
-    g_CommandNamePool + 550,
-    g_CommandNamePool + 572,
-    g_CommandNamePool + 597,
+    g_CommandNamePool + 502,
+    g_CommandNamePool + 507,
+    g_CommandNamePool + 516,
+    g_CommandNamePool + 528,
+    g_CommandNamePool + 543,
+    g_CommandNamePool + 562,
+    g_CommandNamePool + 576,
+    g_CommandNamePool + 593,
+    g_CommandNamePool + 615,
+    g_CommandNamePool + 640,
 };
 
 dred_command g_Commands[] = {
@@ -172,6 +178,9 @@ dred_command g_Commands[] = {
     {dred_command__find, DRED_CMDBAR_NO_CLEAR},
     {dred_command__replace, DRED_CMDBAR_NO_CLEAR},
     {dred_command__replace_all, DRED_CMDBAR_RELEASE_KEYBOARD},
+    {dred_command__find_regex, DRED_CMDBAR_NO_CLEAR},
+    {dred_command__replace_regex, DRED_CMDBAR_NO_CLEAR},
+    {dred_command__replace_all_regex, DRED_CMDBAR_RELEASE_KEYBOARD},
     {dred_command__show_line_numbers, DRED_CMDBAR_RELEASE_KEYBOARD},
     {dred_command__hide_line_numbers, DRED_CMDBAR_RELEASE_KEYBOARD},
     {dred_command__toggle_line_numbers, DRED_CMDBAR_RELEASE_KEYBOARD},
@@ -1116,6 +1125,7 @@ void dred_config_init_variables__autogenerated(dred_config* pConfig)
     pConfig->textEditorCursorColor = dred_rgba(224, 224, 224, 255);
     pConfig->textEditorCursorWidth = 1;
     pConfig->textEditorSelectionBGColor = dred_rgba(64, 128, 192, 255);
+    pConfig->textEditorMatchBGColor = dred_rgba(96, 80, 40, 255);
     pConfig->textEditorActiveLineColor = dred_rgba(40, 40, 40, 255);
     pConfig->textEditorShowLineNumbers = false;
     pConfig->textEditorLineNumbersColor = dred_rgba(80, 160, 192, 255);
@@ -1135,6 +1145,7 @@ void dred_config_init_variables__autogenerated(dred_config* pConfig)
     pConfig->textEditorEnableAutoIndent = true;
     pConfig->textEditorEnableWordWrap = true;
     pConfig->textEditorEnableDragAndDrop = false;
+    pConfig->textEditorUndoMemoryBudget = 64;
     pConfig->cppCommentTextColor = dred_rgba(64, 192, 92, 255);
     pConfig->cppStringTextColor = dred_rgba(192, 92, 64, 255);
     pConfig->cppKeywordTextColor = dred_rgba(64, 160, 255, 255);
@@ -1285,6 +1296,9 @@ void dred_config_write_to_file__autogenerated(dred_config* pConfig, dred_file fi
     snprintf(tempbuf, sizeof(tempbuf), "texteditor-selection-bg-color %d %d %d %d\n", pConfig->textEditorSelectionBGColor.r, pConfig->textEditorSelectionBGColor.g, pConfig->textEditorSelectionBGColor.b, pConfig->textEditorSelectionBGColor.a);
     dred_file_write_string(file, tempbuf);
 
+    snprintf(tempbuf, sizeof(tempbuf), "texteditor-match-bg-color %d %d %d %d\n", pConfig->textEditorMatchBGColor.r, pConfig->textEditorMatchBGColor.g, pConfig->textEditorMatchBGColor.b, pConfig->textEditorMatchBGColor.a);
+    dred_file_write_string(file, tempbuf);
+
     snprintf(tempbuf, sizeof(tempbuf), "texteditor-active-line-color %d %d %d %d\n", pConfig->textEditorActiveLineColor.r, pConfig->textEditorActiveLineColor.g, pConfig->textEditorActiveLineColor.b, pConfig->textEditorActiveLineColor.a);
     dred_file_write_string(file, tempbuf);
 
@@ -1342,6 +1356,9 @@ void dred_config_write_to_file__autogenerated(dred_config* pConfig, dred_file fi
     snprintf(tempbuf, sizeof(tempbuf), "texteditor-enable-drag-and-drop %s\n", pConfig->textEditorEnableDragAndDrop ? "true" : "false");
     dred_file_write_string(file, tempbuf);
 
+    snprintf(tempbuf, sizeof(tempbuf), "texteditor-undo-memory-budget %d\n", pConfig->textEditorUndoMemoryBudget);
+    dred_file_write_string(file, tempbuf);
+
     snprintf(tempbuf, sizeof(tempbuf), "cpp-comment-text-color %d %d %d %d\n", pConfig->cppCommentTextColor.r, pConfig->cppCommentTextColor.g, pConfig->cppCommentTextColor.b, pConfig->cppCommentTextColor.a);
     dred_file_write_string(file, tempbuf);
 
@@ -1551,6 +1568,11 @@ void dred_config_set__autogenerated(dred_config* pConfig, const char* key, const
         if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_generic_refresh(pConfig->pDred);
         return;
     }
+    if (strcmp(key, "texteditor-match-bg-color") == 0) {
+        pConfig->textEditorMatchBGColor = dred_parse_color(value);
+        if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_generic_refresh(pConfig->pDred);
+        return;
+    }
     if (strcmp(key, "texteditor-active-line-color") == 0) {
         pConfig->textEditorActiveLineColor = dred_parse_color(value);
         if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_generic_refresh(pConfig->pDred);
@@ -1646,6 +1668,11 @@ void dred_config_set__autogenerated(dred_config* pConfig, const char* key, const
         if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_drag_and_drop(pConfig->pDred);
         return;
     }
+    if (strcmp(key, "texteditor-undo-memory-budget") == 0) {
+        pConfig->textEditorUndoMemoryBudget = atoi(value);
+        if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_undo_memory_budget(pConfig->pDred);
+        return;
+    }
     if (strcmp(key, "cpp-comment-text-color") == 0) {
         pConfig->cppCommentTextColor = dred_parse_color(value);
         if (pConfig->pDred->isInitialized) dred_config_on_set__cpp_syntax_color(pConfig->pDred);
@@ -1863,6 +1890,11 @@ void dred_config_set_default__autogenerated(dred_config* pConfig, const char* ke
         if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_generic_refresh(pConfig->pDred);
         return;
     }
+    if (strcmp(key, "texteditor-match-bg-color") == 0) {
+        pConfig->textEditorMatchBGColor = dred_rgba(96, 80, 40, 255);
+        if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_generic_refresh(pConfig->pDred);
+        return;
+    }
     if (strcmp(key, "texteditor-active-line-color") == 0) {
         pConfig->textEditorActiveLineColor = dred_rgba(40, 40, 40, 255);
         if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_generic_refresh(pConfig->pDred);
@@ -1958,6 +1990,11 @@ void dred_config_set_default__autogenerated(dred_config* pConfig, const char* ke
         if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_drag_and_drop(pConfig->pDred);
         return;
     }
+    if (strcmp(key, "texteditor-undo-memory-budget") == 0) {
+        pConfig->textEditorUndoMemoryBudget = 64;
+        if (pConfig->pDred->isInitialized) dred_config_on_set__texteditor_undo_memory_budget(pConfig->pDred);
+        return;
+    }
     if (strcmp(key, "cpp-comment-text-color") == 0) {
         pConfig->cppCommentTextColor = dred_rgba(64, 192, 92, 255);
         if (pConfig->pDred->isInitialized) dred_config_on_set__cpp_syntax_color(pConfig->pDred);
@@ -48,6 +48,7 @@ dtk_color textEditorBGColor; \
 dtk_color textEditorCursorColor; \
 float textEditorCursorWidth; \
 dtk_color textEditorSelectionBGColor; \
+dtk_color textEditorMatchBGColor; \
 dtk_color textEditorActiveLineColor; \
 dtk_bool32 textEditorShowLineNumbers; \
 dtk_color textEditorLineNumbersColor; \
@@ -67,6 +68,7 @@ float textEditorScale; \
 dtk_bool32 textEditorEnableAutoIndent; \
 dtk_bool32 textEditorEnableWordWrap; \
 dtk_bool32 textEditorEnableDragAndDrop; \
+int textEditorUndoMemoryBudget; \
 dtk_color cppCommentTextColor; \
 dtk_color cppStringTextColor; \
 dtk_color cppKeywordTextColor;
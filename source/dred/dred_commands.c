@@ -692,6 +692,108 @@ dtk_bool32 dred_command__replace_all(dred_context* pDred, const char* value)
     return DTK_FALSE;
 }
 
+// Checks that the given regular expression compiles, and lets the user know if it doesn't.
+dtk_bool32 dred_command__validate_regex(dred_context* pDred, const char* pattern)
+{
+    drte_regex regex;
+    if (!drte_regex_init(&regex, pattern, 0)) {
+        dred_cmdbar_set_message(&pDred->cmdBar, "Invalid regular expression.");
+        return DTK_FALSE;
+    }
+
+    drte_regex_uninit(&regex);
+    return DTK_TRUE;
+}
+
+dtk_bool32 dred_command__find_regex(dred_context* pDred, const char* value)
+{
+    dred_editor* pFocusedEditor = dred_get_focused_editor(pDred);
+    if (pFocusedEditor == NULL) {
+        return DTK_FALSE;
+    }
+
+    if (dred_control_is_of_type(DRED_CONTROL(pFocusedEditor), DRED_CONTROL_TYPE_TEXT_EDITOR)) {
+        char query[1024];
+        if (dtk_next_token(value, query, sizeof(query)) != NULL) {
+            if (!dred_command__validate_regex(pDred, query)) {
+                return DTK_FALSE;
+            }
+
+            dred_text_editor_deselect_all_in_focused_view(DRED_TEXT_EDITOR(pFocusedEditor));
+            if (!dred_text_editor_find_and_select_next_regex(DRED_TEXT_EDITOR(pFocusedEditor), query)) {
+                dred_cmdbar_set_message(&pDred->cmdBar, "No results found.");
+                return DTK_FALSE;
+            }
+
+            return DTK_TRUE;
+        }
+    }
+
+    return DTK_FALSE;
+}
+
+dtk_bool32 dred_command__replace_regex(dred_context* pDred, const char* value)
+{
+    dred_editor* pFocusedEditor = dred_get_focused_editor(pDred);
+    if (pFocusedEditor == NULL) {
+        return DTK_FALSE;
+    }
+
+    if (dred_control_is_of_type(DRED_CONTROL(pFocusedEditor), DRED_CONTROL_TYPE_TEXT_EDITOR)) {
+        char query[1024];
+        value = dtk_next_token(value, query, sizeof(query));
+        if (value != NULL) {
+            char replacement[1024];
+            value = dtk_next_token(value, replacement, sizeof(replacement));
+            if (value != NULL) {
+                if (!dred_command__validate_regex(pDred, query)) {
+                    return DTK_FALSE;
+                }
+
+                if (!dred_text_editor_find_and_replace_next_regex(DRED_TEXT_EDITOR(pFocusedEditor), query, replacement)) {
+                    dred_cmdbar_set_message(&pDred->cmdBar, "No results found.");
+                    return DTK_FALSE;
+                }
+
+                return DTK_TRUE;
+            }
+        }
+    }
+
+    return DTK_FALSE;
+}
+
+dtk_bool32 dred_command__replace_all_regex(dred_context* pDred, const char* value)
+{
+    dred_editor* pFocusedEditor = dred_get_focused_editor(pDred);
+    if (pFocusedEditor == NULL) {
+        return DTK_FALSE;
+    }
+
+    if (dred_control_is_of_type(DRED_CONTROL(pFocusedEditor), DRED_CONTROL_TYPE_TEXT_EDITOR)) {
+        char query[1024];
+        value = dtk_next_token(value, query, sizeof(query));
+        if (value != NULL) {
+            char replacement[1024];
+            value = dtk_next_token(value, replacement, sizeof(replacement));
+            if (value != NULL) {
+                if (!dred_command__validate_regex(pDred, query)) {
+                    return DTK_FALSE;
+                }
+
+                if (!dred_text_editor_find_and_replace_all_regex(DRED_TEXT_EDITOR(pFocusedEditor), query, replacement)) {
+                    dred_cmdbar_set_message(&pDred->cmdBar, "No results found.");
+                    return DTK_FALSE;
+                }
+
+                return DTK_TRUE;
+            }
+        }
+    }
+
+    return DTK_FALSE;
+}
+
 dtk_bool32 dred_command__show_line_numbers(dred_context* pDred, const char* value)
 {
     (void)value;
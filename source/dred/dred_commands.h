@@ -49,6 +49,9 @@
 // find                         dred_command__find                          DRED_CMDBAR_NO_CLEAR
 // replace                      dred_command__replace                       DRED_CMDBAR_NO_CLEAR
 // replace-all                  dred_command__replace_all                   DRED_CMDBAR_RELEASE_KEYBOARD
+// find-regex                   dred_command__find_regex                    DRED_CMDBAR_NO_CLEAR
+// replace-regex                dred_command__replace_regex                 DRED_CMDBAR_NO_CLEAR
+// replace-all-regex            dred_command__replace_all_regex             DRED_CMDBAR_RELEASE_KEYBOARD
 // show-line-numbers            dred_command__show_line_numbers             DRED_CMDBAR_RELEASE_KEYBOARD
 // hide-line-numbers            dred_command__hide_line_numbers             DRED_CMDBAR_RELEASE_KEYBOARD
 // toggle-line-numbers          dred_command__toggle_line_numbers           DRED_CMDBAR_RELEASE_KEYBOARD
@@ -258,6 +261,15 @@ dtk_bool32 dred_command__replace(dred_context* pDred, const char* value);
 // replace-all
 dtk_bool32 dred_command__replace_all(dred_context* pDred, const char* value);
 
+// find-regex
+dtk_bool32 dred_command__find_regex(dred_context* pDred, const char* value);
+
+// replace-regex
+dtk_bool32 dred_command__replace_regex(dred_context* pDred, const char* value);
+
+// replace-all-regex
+dtk_bool32 dred_command__replace_all_regex(dred_context* pDred, const char* value);
+
 // show-line-numbers
 dtk_bool32 dred_command__show_line_numbers(dred_context* pDred, const char* value);
 
@@ -517,6 +517,18 @@ void dred_config_on_set__texteditor_drag_and_drop(dred_context* pDred)
     }
 }
 
+void dred_config_on_set__texteditor_undo_memory_budget(dred_context* pDred)
+{
+    for (dred_tabgroup* pTabGroup = dred_first_tabgroup(pDred); pTabGroup != NULL; pTabGroup = dred_tabgroup_next_tabgroup(pTabGroup)) {
+        for (dred_tab* pTab = dred_tabgroup_first_tab(pTabGroup); pTab != NULL; pTab = dred_tabgroup_next_tab(pTabGroup, pTab)) {
+            dred_control* pControl = dred_tab_get_control(pTab);
+            if (dred_control_is_of_type(pControl, DRED_CONTROL_TYPE_TEXT_EDITOR)) {
+                dred_text_editor_refresh_undo_memory_budget(DRED_TEXT_EDITOR(pControl));
+            }
+        }
+    }
+}
+
 
 void dred_config_on_set__cpp_syntax_color(dred_context* pDred)
 {
@@ -130,6 +130,9 @@
 // texteditor-selection-bg-color textEditorSelectionBGColor color dred_config_on_set__texteditor_generic_refresh 64 128 192
 //   The background color to use for selected text.
 //
+// texteditor-match-bg-color textEditorMatchBGColor color dred_config_on_set__texteditor_generic_refresh 96 80 40
+//   The background color to use for highlighting every occurrence of the text being searched for.
+//
 // texteditor-active-line-color textEditorActiveLineColor color dred_config_on_set__texteditor_generic_refresh 40 40 40
 //   The background color of the line that the caret is currently sitting on in a text editor.
 //
@@ -187,6 +190,10 @@
 // texteditor-enable-drag-and-drop textEditorEnableDragAndDrop dtk_bool32 dred_config_on_set__texteditor_drag_and_drop false
 //   Whether or not drag-and-drop should be enabled for text editors.
 //
+// texteditor-undo-memory-budget textEditorUndoMemoryBudget int dred_config_on_set__texteditor_undo_memory_budget 64
+//   The maximum amount of memory in megabytes each text editor can use for undo/redo history. The oldest undo points are
+//   discarded when this is exceeded. Set to 0 for no limit.
+//
 //
 // cpp-comment-text-color cppCommentTextColor color dred_config_on_set__cpp_syntax_color 64 192 92
 //   The color to use for C/C++ comments.
@@ -313,6 +320,9 @@ void dred_config_on_set__texteditor_word_wrap(dred_context* pDred);
 // texteditor-enable-drag-and-drop
 void dred_config_on_set__texteditor_drag_and_drop(dred_context* pDred);
 
+// texteditor-undo-memory-budget
+void dred_config_on_set__texteditor_undo_memory_budget(dred_context* pDred);
+
 
 // Generic function for setting a syntax color for C/C++.
 void dred_config_on_set__cpp_syntax_color(dred_context* pDred);
@@ -132,6 +132,7 @@ void dred__refresh_editor_tab_text(dred_editor* pEditor, dred_tab* pTab)
     const char* filename = dtk_path_file_name(dred_editor_get_file_path(pEditor));
     const char* modified = "";
     const char* readonly = "";
+    const char* loading = "";
 
     if (filename == NULL || filename[0] == '\0') {
         filename = "[New File]";
@@ -142,8 +143,11 @@ void dred__refresh_editor_tab_text(dred_editor* pEditor, dred_tab* pTab)
     if (dred_editor_is_read_only(pEditor)) {
         readonly = " [Read Only]";
     }
+    if (dred_editor_is_loading(pEditor)) {
+        loading = " [Loading]";
+    }
 
-    snprintf(tabText, sizeof(tabText), "%s%s%s", filename, modified, readonly);
+    snprintf(tabText, sizeof(tabText), "%s%s%s%s", filename, modified, readonly, loading);
     dred_tab_set_text(pTab, tabText);
 
     dred_context* pDred = dred_control_get_context(DRED_CONTROL(pEditor));
@@ -176,6 +180,17 @@ void dred__on_editor_unmodified(dred_editor* pEditor)
     dred__refresh_editor_tab_text(pEditor, pTab);
 }
 
+void dred__on_editor_loaded(dred_editor* pEditor)
+{
+    dred_tab* pTab = dred_find_control_tab(DRED_CONTROL(pEditor));
+    if (pTab == NULL) {
+        return;
+    }
+
+    // The tab shows that the file is still loading until now.
+    dred__refresh_editor_tab_text(pEditor, pTab);
+}
+
 
 void dred__on_main_window_close(dtk_window* pWindow)
 {
@@ -692,7 +707,12 @@ dtk_bool32 dred_init(dred_context* pDred, int argc, char** argv, dred_package_li
     pDred->config.useDefaultWindowPos = DTK_FALSE;
 
 
-    // Load initial files from the command line.
+    // Load initial files from the command line. These are loaded in the background so the window can be used straight away. If the
+    // loader can't be started, files are loaded on the main thread instead.
+    if (dred_file_loader_init(&pDred->fileLoader, &pDred->tk) != DTK_SUCCESS) {
+        dred_warningf(pDred, "Failed to start file loading threads. Files will be loaded on the main thread.\n");
+    }
+
     dtk_argv_parse(argc, argv, dred_parse_cmdline__startup_files, pDred);
 
     // If there were no files passed on the command line, start with an empty text file. We can know this by simply finding the
@@ -734,6 +754,9 @@ void dred_uninit(dred_context* pDred)
     // can be prompted to save any unsaved work or whatnot, but I'm keeping this here for sanity.
     dred_close_all_tabs(pDred);
 
+    // The editors will have cancelled anything they were still loading so this can be stopped now.
+    dred_file_loader_uninit(&pDred->fileLoader);
+
 
     // The IPC thread may be waiting for a client connection. To break from the loop we'll need to create a temporary
     // client in order to break from it.
@@ -1218,6 +1241,7 @@ dtk_bool32 dred_open_file_by_type(dred_context* pDred, const char* filePath, con
 
         dred_editor_set_on_modified(pEditor, dred__on_editor_modified);
         dred_editor_set_on_unmodified(pEditor, dred__on_editor_unmodified);
+        dred_editor_set_on_loaded(pEditor, dred__on_editor_loaded);
 
         // We have the editor, so now we need to create a tab an associate the new editor with it.
         dred_tab* pTab = dred_tabgroup_prepend_tab(pTabGroup, NULL, DRED_CONTROL(pEditor));
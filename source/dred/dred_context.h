@@ -19,6 +19,9 @@ struct dred_context
     // The main toolkit context. This needs to be initialized before doing pretty much anything.
     dtk_context tk;
 
+    // The worker threads files are opened on so the window stays responsive while lots of them are being opened at once.
+    dred_file_loader fileLoader;
+
     // The string pool for infrequently changed, but dynamically allocated strings. Strings stored in this
     // pool include:
     // - Shortcut ID strings
@@ -134,6 +134,16 @@ dtk_bool32 dred_editor_save(dred_editor* pEditor, const char* newFilePath)
         }
     }
 
+    // The editor may still be reading from the file (when it's memory mapped, for example) so it needs to be given a chance to let
+    // go of it before it's overwritten.
+    if (pEditor->onBeforeSave && !pEditor->onBeforeSave(pEditor, actualFilePath)) {
+        if (haveTempFile) {
+            dtk_delete_file(tempFilePath);
+        }
+
+        return DTK_FALSE;
+    }
+
     dtk_bool32 wasSaved = DTK_FALSE;
     dred_file file = dred_file_open(actualFilePath, DRED_FILE_OPEN_MODE_WRITE);
     if (file != NULL) {
@@ -261,6 +271,41 @@ dtk_bool32 dred_editor_is_read_only(dred_editor* pEditor)
 }
 
 
+void dred_editor_begin_loading(dred_editor* pEditor)
+{
+    if (pEditor == NULL) {
+        return;
+    }
+
+    pEditor->isLoading = DTK_TRUE;
+}
+
+void dred_editor_end_loading(dred_editor* pEditor)
+{
+    if (pEditor == NULL) {
+        return;
+    }
+
+    if (!pEditor->isLoading) {
+        return;
+    }
+
+    pEditor->isLoading = DTK_FALSE;
+    if (pEditor->onLoaded) {
+        pEditor->onLoaded(pEditor);
+    }
+}
+
+dtk_bool32 dred_editor_is_loading(dred_editor* pEditor)
+{
+    if (pEditor == NULL) {
+        return DTK_FALSE;
+    }
+
+    return pEditor->isLoading;
+}
+
+
 
 void dred_editor_set_on_save(dred_editor* pEditor, dred_editor_on_save_proc proc)
 {
@@ -271,6 +316,15 @@ void dred_editor_set_on_save(dred_editor* pEditor, dred_editor_on_save_proc proc
     pEditor->onSave = proc;
 }
 
+void dred_editor_set_on_before_save(dred_editor* pEditor, dred_editor_on_before_save_proc proc)
+{
+    if (pEditor == NULL) {
+        return;
+    }
+
+    pEditor->onBeforeSave = proc;
+}
+
 void dred_editor_set_on_reload(dred_editor* pEditor, dred_editor_on_reload_proc proc)
 {
     if (pEditor == NULL) {
@@ -296,4 +350,13 @@ void dred_editor_set_on_unmodified(dred_editor* pEditor, dred_editor_on_unmodifi
     }
 
     pEditor->onUnmodified = proc;
+}
+
+void dred_editor_set_on_loaded(dred_editor* pEditor, dred_editor_on_loaded_proc proc)
+{
+    if (pEditor == NULL) {
+        return;
+    }
+
+    pEditor->onLoaded = proc;
 }
\ No newline at end of file
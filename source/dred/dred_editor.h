@@ -6,9 +6,11 @@ typedef struct dred_editor dred_editor;
 #define DRED_EDITOR(a) ((dred_editor*)(a))
 
 typedef dtk_bool32 (* dred_editor_on_save_proc)(dred_editor* pEditor, dred_file file, const char* filePath);
+typedef dtk_bool32 (* dred_editor_on_before_save_proc)(dred_editor* pEditor, const char* filePath);
 typedef dtk_bool32 (* dred_editor_on_reload_proc)(dred_editor* pEditor);
 typedef void (* dred_editor_on_modified_proc)(dred_editor* pEditor);
 typedef void (* dred_editor_on_unmodified_proc)(dred_editor* pEditor);
+typedef void (* dred_editor_on_loaded_proc)(dred_editor* pEditor);
 
 struct dred_editor
 {
@@ -18,11 +20,14 @@ struct dred_editor
     char filePathAbsolute[DRED_MAX_PATH];
     uint64_t fileLastModifiedTime;
     dred_editor_on_save_proc onSave;
+    dred_editor_on_before_save_proc onBeforeSave;
     dred_editor_on_reload_proc onReload;
     dred_editor_on_modified_proc onModified;
     dred_editor_on_unmodified_proc onUnmodified;
+    dred_editor_on_loaded_proc onLoaded;
     dtk_bool32 isModified;
     dtk_bool32 isReadOnly;
+    dtk_bool32 isLoading;
 
     size_t extraDataSize;
     uint8_t pExtraData[1];
@@ -74,8 +79,20 @@ void dred_editor_update_file_last_modified_time(dred_editor* pEditor);
 dtk_bool32 dred_editor_is_read_only(dred_editor* pEditor);
 
 
+// Marks the editor as loading it's file in the background.
+void dred_editor_begin_loading(dred_editor* pEditor);
+
+// Marks the editor as having finished loading it's file.
+void dred_editor_end_loading(dred_editor* pEditor);
+
+// Determines whether or not the editor is still loading it's file in the background.
+dtk_bool32 dred_editor_is_loading(dred_editor* pEditor);
+
+
 // Events
 void dred_editor_set_on_save(dred_editor* pEditor, dred_editor_on_save_proc proc);
+void dred_editor_set_on_before_save(dred_editor* pEditor, dred_editor_on_before_save_proc proc);   // Called before the file is opened for writing. Returning false aborts the save.
 void dred_editor_set_on_reload(dred_editor* pEditor, dred_editor_on_reload_proc proc);
 void dred_editor_set_on_modified(dred_editor* pEditor, dred_editor_on_modified_proc proc);
-void dred_editor_set_on_unmodified(dred_editor* pEditor, dred_editor_on_unmodified_proc proc);
\ No newline at end of file
+void dred_editor_set_on_unmodified(dred_editor* pEditor, dred_editor_on_unmodified_proc proc);
+void dred_editor_set_on_loaded(dred_editor* pEditor, dred_editor_on_loaded_proc proc);
\ No newline at end of file
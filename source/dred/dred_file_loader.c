@@ -0,0 +1,340 @@
+// Copyright (C) 2017 David Reid. See included LICENSE file.
+
+void dred_file_load_job__free(dred_file_load_job* pJob)
+{
+    assert(pJob != NULL);
+
+    if (pJob->pMappedFile != NULL) {
+        dtk_unmap_file(pJob->pMappedFile);
+        dtk_free(pJob->pMappedFile);
+    }
+
+    dtk_free(pJob->pFileData);
+    free(pJob->pLineOffsets);
+    free(pJob);
+}
+
+// Reads the job's file and finds it's lines. This is run on a worker thread so it must not touch anything but the job.
+void dred_file_load_job__run(dred_file_load_job* pJob)
+{
+    assert(pJob != NULL);
+
+    // Large files are mapped rather than read, and their lines are found by the text editor as they're needed.
+    pJob->result = dred_open_text_file(pJob->filePath, pJob->mapFileThreshold, &pJob->pMappedFile, &pJob->pFileData, &pJob->fileSize);
+    if (pJob->result != DTK_SUCCESS || pJob->pMappedFile != NULL) {
+        return;
+    }
+
+    // If we run out of memory the lines are left for the text engine to find on the main thread.
+    size_t lineOffsetCapacity = 0;
+    size_t scannedLength = 0;
+    while (scannedLength < pJob->fileSize) {
+        if (pJob->lineCount == lineOffsetCapacity) {
+            size_t newCapacity = (lineOffsetCapacity == 0) ? 4096 : lineOffsetCapacity*2;
+            size_t* pNewLineOffsets = (size_t*)realloc(pJob->pLineOffsets, newCapacity * sizeof(*pNewLineOffsets));
+            if (pNewLineOffsets == NULL) {
+                free(pJob->pLineOffsets);
+                pJob->pLineOffsets = NULL;
+                pJob->lineCount = 0;
+                return;
+            }
+
+            pJob->pLineOffsets = pNewLineOffsets;
+            lineOffsetCapacity = newCapacity;
+        }
+
+        size_t lineCount;
+        size_t chunkLength = drte_find_line_offsets(pJob->pFileData + scannedLength, pJob->fileSize - scannedLength, pJob->pLineOffsets + pJob->lineCount, lineOffsetCapacity - pJob->lineCount, &lineCount);
+        for (size_t i = 0; i < lineCount; ++i) {
+            pJob->pLineOffsets[pJob->lineCount + i] += scannedLength;
+        }
+
+        pJob->lineCount += lineCount;
+        scannedLength += chunkLength;
+    }
+}
+
+dtk_thread_result DTK_THREADCALL dred_file_loader__thread(void* pData)
+{
+    dred_file_loader* pLoader = (dred_file_loader*)pData;
+    assert(pLoader != NULL);
+
+    for (;;) {
+        dtk_semaphore_wait(&pLoader->semaphore);
+
+        dtk_bool32 isStopping;
+        dred_file_load_job* pJob = NULL;
+        dtk_mutex_lock(&pLoader->lock);
+        {
+            isStopping = pLoader->isStopping;
+            if (!isStopping && pLoader->pFirstQueuedJob != NULL) {
+                pJob = pLoader->pFirstQueuedJob;
+                pLoader->pFirstQueuedJob = pJob->pNextJob;
+                if (pLoader->pFirstQueuedJob == NULL) {
+                    pLoader->pLastQueuedJob = NULL;
+                }
+
+                pJob->pNextJob = NULL;
+                pJob->isQueued = DTK_FALSE;
+            }
+        }
+        dtk_mutex_unlock(&pLoader->lock);
+
+        if (isStopping) {
+            break;
+        }
+
+        if (pJob == NULL) {
+            continue;   // The job was cancelled before it was taken.
+        }
+
+        dred_file_load_job__run(pJob);
+
+        dtk_mutex_lock(&pLoader->lock);
+        {
+            pJob->pNextJob = pLoader->pFirstFinishedJob;
+            pLoader->pFirstFinishedJob = pJob;
+        }
+        dtk_mutex_unlock(&pLoader->lock);
+    }
+
+    return 0;
+}
+
+void dred_file_loader__on_timer(dtk_timer* pTimer, void* pUserData)
+{
+    (void)pTimer;
+
+    dred_file_loader* pLoader = (dred_file_loader*)pUserData;
+    assert(pLoader != NULL);
+
+    // The finished jobs are taken all at once so the threads aren't held up while they're handed back.
+    dred_file_load_job* pFinishedJobs;
+    dtk_mutex_lock(&pLoader->lock);
+    {
+        pFinishedJobs = pLoader->pFirstFinishedJob;
+        pLoader->pFirstFinishedJob = NULL;
+    }
+    dtk_mutex_unlock(&pLoader->lock);
+
+    // They're finished in the reverse order so they're handed back in the order they finished.
+    dred_file_load_job* pJob = NULL;
+    while (pFinishedJobs != NULL) {
+        dred_file_load_job* pNextJob = pFinishedJobs->pNextJob;
+        pFinishedJobs->pNextJob = pJob;
+        pJob = pFinishedJobs;
+        pFinishedJobs = pNextJob;
+    }
+
+    while (pJob != NULL) {
+        dred_file_load_job* pNextJob = pJob->pNextJob;
+
+        // onLoaded may cancel any of the jobs that haven't been handed back yet, including those in this list.
+        dtk_bool32 isCancelled;
+        dtk_mutex_lock(&pLoader->lock);
+        {
+            isCancelled = pJob->isCancelled;
+        }
+        dtk_mutex_unlock(&pLoader->lock);
+
+        if (!isCancelled && pJob->onLoaded) {
+            pJob->onLoaded(pJob);
+        }
+
+        dred_file_load_job__free(pJob);
+        pLoader->pendingJobCount -= 1;
+
+        pJob = pNextJob;
+    }
+
+    if (pLoader->pendingJobCount == 0) {
+        dtk_timer_uninit(&pLoader->timer);
+    }
+}
+
+dtk_result dred_file_loader_init(dred_file_loader* pLoader, dtk_context* pTK)
+{
+    if (pLoader == NULL) return DTK_INVALID_ARGS;
+    dtk_zero_object(pLoader);
+
+    if (pTK == NULL) return DTK_INVALID_ARGS;
+    pLoader->pTK = pTK;
+
+    dtk_result result = dtk_mutex_init(&pLoader->lock);
+    if (result != DTK_SUCCESS) {
+        return result;
+    }
+
+    result = dtk_semaphore_init(&pLoader->semaphore, 0);
+    if (result != DTK_SUCCESS) {
+        dtk_mutex_uninit(&pLoader->lock);
+        return result;
+    }
+
+    // It's fine if only some of the threads could be started.
+    for (dtk_uint32 iThread = 0; iThread < DRED_FILE_LOADER_THREAD_COUNT; ++iThread) {
+        if (dtk_thread_create(&pLoader->threads[pLoader->threadCount], dred_file_loader__thread, pLoader) != DTK_SUCCESS) {
+            break;
+        }
+
+        pLoader->threadCount += 1;
+    }
+
+    if (pLoader->threadCount == 0) {
+        dtk_semaphore_uninit(&pLoader->semaphore);
+        dtk_mutex_uninit(&pLoader->lock);
+        return DTK_ERROR;
+    }
+
+    return DTK_SUCCESS;
+}
+
+void dred_file_loader_uninit(dred_file_loader* pLoader)
+{
+    if (pLoader == NULL || pLoader->threadCount == 0) {
+        return;
+    }
+
+    dtk_mutex_lock(&pLoader->lock);
+    {
+        pLoader->isStopping = DTK_TRUE;
+    }
+    dtk_mutex_unlock(&pLoader->lock);
+
+    for (dtk_uint32 iThread = 0; iThread < pLoader->threadCount; ++iThread) {
+        dtk_semaphore_release(&pLoader->semaphore);
+    }
+
+    for (dtk_uint32 iThread = 0; iThread < pLoader->threadCount; ++iThread) {
+        dtk_thread_wait(&pLoader->threads[iThread]);
+    }
+
+    // Now that the threads are stopped, anything that hasn't been handed back can just be thrown away.
+    while (pLoader->pFirstQueuedJob != NULL) {
+        dred_file_load_job* pNextJob = pLoader->pFirstQueuedJob->pNextJob;
+        dred_file_load_job__free(pLoader->pFirstQueuedJob);
+        pLoader->pFirstQueuedJob = pNextJob;
+    }
+
+    while (pLoader->pFirstFinishedJob != NULL) {
+        dred_file_load_job* pNextJob = pLoader->pFirstFinishedJob->pNextJob;
+        dred_file_load_job__free(pLoader->pFirstFinishedJob);
+        pLoader->pFirstFinishedJob = pNextJob;
+    }
+
+    if (pLoader->pendingJobCount > 0) {
+        dtk_timer_uninit(&pLoader->timer);
+    }
+
+    dtk_semaphore_uninit(&pLoader->semaphore);
+    dtk_mutex_uninit(&pLoader->lock);
+
+    pLoader->threadCount = 0;
+}
+
+dtk_bool32 dred_file_loader_is_running(dred_file_loader* pLoader)
+{
+    if (pLoader == NULL) {
+        return DTK_FALSE;
+    }
+
+    return pLoader->threadCount > 0;
+}
+
+dtk_result dred_file_loader_load(dred_file_loader* pLoader, const char* filePath, size_t mapFileThreshold, dred_file_loader_on_loaded_proc onLoaded, void* pUserData, dred_file_load_job** ppJob)
+{
+    if (ppJob) *ppJob = NULL;
+    if (pLoader == NULL || filePath == NULL) return DTK_INVALID_ARGS;
+    if (pLoader->threadCount == 0) return DTK_ERROR;
+
+    dred_file_load_job* pJob = (dred_file_load_job*)calloc(1, sizeof(*pJob));
+    if (pJob == NULL) {
+        return DTK_OUT_OF_MEMORY;
+    }
+
+    if (strcpy_s(pJob->filePath, sizeof(pJob->filePath), filePath) != 0) {
+        free(pJob);
+        return DTK_INVALID_ARGS;
+    }
+
+    pJob->mapFileThreshold = mapFileThreshold;
+    pJob->onLoaded = onLoaded;
+    pJob->pUserData = pUserData;
+    pJob->isQueued = DTK_TRUE;
+
+    // The timer is only running while there's something to hand back.
+    if (pLoader->pendingJobCount == 0) {
+        dtk_result result = dtk_timer_init(pLoader->pTK, DRED_FILE_LOADER_INTERVAL, dred_file_loader__on_timer, pLoader, &pLoader->timer);
+        if (result != DTK_SUCCESS) {
+            free(pJob);
+            return result;
+        }
+    }
+
+    pLoader->pendingJobCount += 1;
+
+    dtk_mutex_lock(&pLoader->lock);
+    {
+        if (pLoader->pLastQueuedJob != NULL) {
+            pLoader->pLastQueuedJob->pNextJob = pJob;
+        } else {
+            pLoader->pFirstQueuedJob = pJob;
+        }
+
+        pLoader->pLastQueuedJob = pJob;
+    }
+    dtk_mutex_unlock(&pLoader->lock);
+
+    dtk_semaphore_release(&pLoader->semaphore);
+
+    if (ppJob) *ppJob = pJob;
+    return DTK_SUCCESS;
+}
+
+void dred_file_loader_cancel(dred_file_loader* pLoader, dred_file_load_job* pJob)
+{
+    if (pLoader == NULL || pJob == NULL) {
+        return;
+    }
+
+    // A job that hasn't been taken by a thread yet can be removed from the queue straight away. Otherwise it's thrown away when it
+    // would have been handed back.
+    dtk_bool32 wasQueued = DTK_FALSE;
+    dtk_mutex_lock(&pLoader->lock);
+    {
+        if (pJob->isQueued) {
+            dred_file_load_job* pPrevJob = NULL;
+            for (dred_file_load_job* pQueuedJob = pLoader->pFirstQueuedJob; pQueuedJob != NULL; pQueuedJob = pQueuedJob->pNextJob) {
+                if (pQueuedJob == pJob) {
+                    if (pPrevJob != NULL) {
+                        pPrevJob->pNextJob = pJob->pNextJob;
+                    } else {
+                        pLoader->pFirstQueuedJob = pJob->pNextJob;
+                    }
+
+                    if (pLoader->pLastQueuedJob == pJob) {
+                        pLoader->pLastQueuedJob = pPrevJob;
+                    }
+
+                    break;
+                }
+
+                pPrevJob = pQueuedJob;
+            }
+
+            wasQueued = DTK_TRUE;
+        } else {
+            pJob->isCancelled = DTK_TRUE;
+        }
+    }
+    dtk_mutex_unlock(&pLoader->lock);
+
+    if (wasQueued) {
+        dred_file_load_job__free(pJob);
+        pLoader->pendingJobCount -= 1;
+
+        if (pLoader->pendingJobCount == 0) {
+            dtk_timer_uninit(&pLoader->timer);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+// Copyright (C) 2017 David Reid. See included LICENSE file.
+
+// The file loader reads text files on a pool of worker threads so that opening lots of files at once doesn't hold up the main
+// thread. Each file is read and has it's lines found on a worker, and the results are handed back on the main thread from a timer.
+
+// The number of worker threads.
+#ifndef DRED_FILE_LOADER_THREAD_COUNT
+#define DRED_FILE_LOADER_THREAD_COUNT 4
+#endif
+
+// How often finished jobs are handed back to the main thread.
+#ifndef DRED_FILE_LOADER_INTERVAL
+#define DRED_FILE_LOADER_INTERVAL 16
+#endif
+
+typedef struct dred_file_loader dred_file_loader;
+typedef struct dred_file_load_job dred_file_load_job;
+
+// Called on the main thread when a job has finished. The data of the job is freed when this returns, unless it's taken by setting
+// the relevant members to NULL.
+typedef void (* dred_file_loader_on_loaded_proc)(dred_file_load_job* pJob);
+
+struct dred_file_load_job
+{
+    char filePath[DRED_MAX_PATH];
+    size_t mapFileThreshold;                // Files at least this big are memory mapped rather than read if possible. See dred_open_text_file().
+    dred_file_loader_on_loaded_proc onLoaded;
+    void* pUserData;
+
+    // The results, set by the worker thread. Only one of pMappedFile or pFileData is set when result is DTK_SUCCESS.
+    dtk_result result;
+    dtk_mapped_file* pMappedFile;
+    char* pFileData;                        // Null terminated. Free with dtk_free().
+    size_t fileSize;
+    size_t* pLineOffsets;                   // The offset of each line of pFileData after the first. Free with free().
+    size_t lineCount;
+
+    // Internal use only.
+    dred_file_load_job* pNextJob;
+    dtk_bool32 isQueued;                    // Protected by the loader's lock.
+    dtk_bool32 isCancelled;                 // Protected by the loader's lock.
+};
+
+struct dred_file_loader
+{
+    dtk_context* pTK;
+    dtk_thread threads[DRED_FILE_LOADER_THREAD_COUNT];
+    dtk_uint32 threadCount;
+    dtk_mutex lock;
+    dtk_semaphore semaphore;                // Released once for each queued job, and once for each thread when stopping.
+    dtk_timer timer;                        // Only running while there are jobs that haven't been handed back.
+    dred_file_load_job* pFirstQueuedJob;    // Protected by lock.
+    dred_file_load_job* pLastQueuedJob;     // Protected by lock.
+    dred_file_load_job* pFirstFinishedJob;  // Protected by lock.
+    size_t pendingJobCount;                 // The number of jobs that haven't been handed back yet. Only used on the main thread.
+    dtk_bool32 isStopping;                  // Protected by lock.
+};
+
+// Initializes the file loader and starts it's worker threads.
+dtk_result dred_file_loader_init(dred_file_loader* pLoader, dtk_context* pTK);
+
+// Stops the worker threads and uninitializes the loader. Jobs that haven't been handed back are cancelled.
+void dred_file_loader_uninit(dred_file_loader* pLoader);
+
+// Determines whether or not the loader's worker threads are running.
+dtk_bool32 dred_file_loader_is_running(dred_file_loader* pLoader);
+
+// Queues the given file to be loaded on a worker thread. onLoaded is called on the main thread once it's done. The returned job is
+// owned by the loader and is valid until onLoaded returns or it's cancelled.
+dtk_result dred_file_loader_load(dred_file_loader* pLoader, const char* filePath, size_t mapFileThreshold, dred_file_loader_on_loaded_proc onLoaded, void* pUserData, dred_file_load_job** ppJob);
+
+// Cancels a job. onLoaded will not be called for it. Must be called from the main thread.
+void dred_file_loader_cancel(dred_file_loader* pLoader, dred_file_load_job* pJob);
@@ -209,6 +209,37 @@ dtk_bool32 dred_file_write_line(dred_file file, const char* str)
     return dred_file_write_string(file, str) && dred_file_write_string(file, "\n");
 }
 
+dtk_result dred_open_text_file(const char* filePath, size_t mapFileThreshold, dtk_mapped_file** ppMappedFile, char** ppFileData, size_t* pFileSizeOut)
+{
+    if (ppMappedFile == NULL || ppFileData == NULL || pFileSizeOut == NULL) return DTK_INVALID_ARGS;
+    *ppMappedFile = NULL;
+    *ppFileData = NULL;
+    *pFileSizeOut = 0;
+
+    if (filePath == NULL) return DTK_INVALID_ARGS;
+
+    // The size is only used to decide whether or not to try mapping the file. Files whose size can't be queried, such as pipes, are
+    // read. A threshold of 0 means files are never mapped.
+    if (mapFileThreshold > 0 && dtk_get_file_size(filePath) >= mapFileThreshold) {
+        dtk_mapped_file* pMappedFile = (dtk_mapped_file*)dtk_malloc(sizeof(*pMappedFile));
+        if (pMappedFile == NULL) {
+            return DTK_OUT_OF_MEMORY;
+        }
+
+        // If the file can't be mapped it's read instead. The file may also have shrunk since the size was retrieved.
+        if (dtk_map_file(filePath, pMappedFile) == DTK_SUCCESS && pMappedFile->dataSize >= mapFileThreshold) {
+            *ppMappedFile = pMappedFile;
+            *pFileSizeOut = pMappedFile->dataSize;
+            return DTK_SUCCESS;
+        }
+
+        dtk_unmap_file(pMappedFile);
+        dtk_free(pMappedFile);
+    }
+
+    return dtk_open_and_read_text_file(filePath, pFileSizeOut, ppFileData);
+}
+
 
 dtk_bool32 dred_to_absolute_path(const char* relativePath, char* absolutePathOut, size_t absolutePathOutSize)
 {
@@ -60,6 +60,13 @@ dtk_bool32 dred_file_write_string(dred_file file, const char* str);
 // dred_file_write_line()
 dtk_bool32 dred_file_write_line(dred_file file, const char* str);
 
+// Opens a text file to be loaded into an editor. Files at least mapFileThreshold bytes big are memory mapped so that nothing needs
+// to be read up front, and *ppMappedFile is set to the mapping. Smaller files, and files that can't be mapped, are read instead and
+// *ppFileData is set to their null terminated contents. Only one of the two is set on success. This is safe to call from any thread.
+//
+// Free the mapping with dtk_unmap_file() followed by dtk_free(), and the file data with dtk_free().
+dtk_result dred_open_text_file(const char* filePath, size_t mapFileThreshold, dtk_mapped_file** ppMappedFile, char** ppFileData, size_t* pFileSizeOut);
+
 
 // Converts a relative path to absolute.
 dtk_bool32 dred_to_absolute_path(const char* relativePath, char* absolutePathOut, size_t absolutePathOutSize);
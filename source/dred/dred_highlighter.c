@@ -0,0 +1,237 @@
+// Copyright (C) 2017 David Reid. See included LICENSE file.
+
+// The states of the C lexer at the end of a line. Line comments and strings only carry over to the next line when the line ends
+// with a backslash.
+#define DRED_HIGHLIGHTER_C_STATE_DEFAULT        0
+#define DRED_HIGHLIGHTER_C_STATE_BLOCK_COMMENT  1
+#define DRED_HIGHLIGHTER_C_STATE_LINE_COMMENT   2
+#define DRED_HIGHLIGHTER_C_STATE_STRING         3
+
+// Must be kept in order for dred_highlighter__is_keyword().
+static const char* g_KeywordsC[] = {
+    "_Alignas", "_Alignof", "_Atomic", "_Bool", "_Complex", "_Generic", "_Imaginary", "_Noreturn", "_Static_assert",
+    "_Thread_local", "alignas", "alignof", "asm", "auto", "bool", "break", "case", "catch", "char", "char16_t", "char32_t",
+    "class", "const", "const_cast", "constexpr", "continue", "decltype", "default", "delete", "do", "double", "dynamic_cast",
+    "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long",
+    "mutable", "namespace", "new", "noexcept", "nullptr", "operator", "private", "protected", "public", "register",
+    "reinterpret_cast", "restrict", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
+    "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned",
+    "using", "virtual", "void", "volatile", "wchar_t", "while"
+};
+
+dtk_bool32 dred_highlighter_init_c(dred_highlighter* pHighlighter, dred_context* pDred)
+{
+    if (pHighlighter == NULL) {
+        return DTK_FALSE;
+    }
+
+    memset(pHighlighter, 0, sizeof(*pHighlighter));
+    pHighlighter->ppKeywords = g_KeywordsC;
+    pHighlighter->keywordCount = sizeof(g_KeywordsC) / sizeof(g_KeywordsC[0]);
+
+    dred_highlighter_refresh_styling(pHighlighter, pDred);
+    return DTK_TRUE;
+}
+
+void dred_highlighter_refresh_styling(dred_highlighter* pHighlighter, dred_context* pDred)
+{
+    if (pHighlighter == NULL || pDred == NULL) {
+        return;
+    }
+
+    pHighlighter->styles[DRED_HIGHLIGHTER_STYLE_COMMENT].fgColor = pDred->config.cppCommentTextColor;
+    pHighlighter->styles[DRED_HIGHLIGHTER_STYLE_STRING].fgColor  = pDred->config.cppStringTextColor;
+    pHighlighter->styles[DRED_HIGHLIGHTER_STYLE_KEYWORD].fgColor = pDred->config.cppKeywordTextColor;
+}
+
+
+DTK_INLINE dtk_bool32 dred_highlighter__is_identifier_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static dtk_bool32 dred_highlighter__is_keyword(dred_highlighter* pHighlighter, const char* word, size_t wordLength)
+{
+    assert(pHighlighter != NULL);
+
+    size_t lo = 0;
+    size_t hi = pHighlighter->keywordCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        const char* keyword = pHighlighter->ppKeywords[mid];
+
+        int cmp = strncmp(keyword, word, wordLength);
+        if (cmp == 0) {
+            if (keyword[wordLength] == '\0') {
+                return DTK_TRUE;
+            }
+
+            cmp = 1;    // The keyword starts with the word, but is longer.
+        }
+
+        if (cmp < 0) {
+            lo = mid+1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return DTK_FALSE;
+}
+
+// Returns the index of the character after the "*/" ending a block comment, or textLength if it doesn't end on this line.
+static size_t dred_highlighter__find_block_comment_end(const char* text, size_t textLength, size_t i, dtk_bool32* pIsClosedOut)
+{
+    for (; i+1 < textLength; ++i) {
+        if (text[i] == '*' && text[i+1] == '/') {
+            *pIsClosedOut = DTK_TRUE;
+            return i+2;
+        }
+    }
+
+    *pIsClosedOut = DTK_FALSE;
+    return textLength;
+}
+
+// Returns the index of the character after the quote ending a string or character literal, or textLength if it doesn't end on this line.
+static size_t dred_highlighter__find_string_end(const char* text, size_t textLength, size_t i, char quote, dtk_bool32* pIsClosedOut)
+{
+    while (i < textLength) {
+        if (text[i] == '\\') {
+            i += 2;
+        } else if (text[i] == quote) {
+            *pIsClosedOut = DTK_TRUE;
+            return i+1;
+        } else {
+            i += 1;
+        }
+    }
+
+    *pIsClosedOut = DTK_FALSE;
+    return textLength;
+}
+
+uint32_t dred_highlighter_lex_line_c(drte_engine* pEngine, uint32_t state, const char* text, size_t textLength, drte_lexed_line* pLine, void* pUserData)
+{
+    (void)pEngine;
+
+    dred_highlighter* pHighlighter = (dred_highlighter*)pUserData;
+    assert(pHighlighter != NULL);
+
+    drte_style_token commentStyle = (drte_style_token)&pHighlighter->styles[DRED_HIGHLIGHTER_STYLE_COMMENT];
+    drte_style_token stringStyle  = (drte_style_token)&pHighlighter->styles[DRED_HIGHLIGHTER_STYLE_STRING];
+    drte_style_token keywordStyle = (drte_style_token)&pHighlighter->styles[DRED_HIGHLIGHTER_STYLE_KEYWORD];
+
+    // The "\r" of "\r\n" line endings is not part of the line.
+    if (textLength > 0 && text[textLength-1] == '\r') {
+        textLength -= 1;
+    }
+
+    dtk_bool32 isContinued = textLength > 0 && text[textLength-1] == '\\';
+    dtk_bool32 isClosed;
+    size_t i = 0;
+
+    // Finish off whatever was left open by the previous line.
+    if (state == DRED_HIGHLIGHTER_C_STATE_BLOCK_COMMENT) {
+        i = dred_highlighter__find_block_comment_end(text, textLength, 0, &isClosed);
+        drte_lexed_line_add_token(pLine, 0, i, commentStyle);
+        if (!isClosed) {
+            return DRED_HIGHLIGHTER_C_STATE_BLOCK_COMMENT;
+        }
+    } else if (state == DRED_HIGHLIGHTER_C_STATE_LINE_COMMENT) {
+        drte_lexed_line_add_token(pLine, 0, textLength, commentStyle);
+        return isContinued ? DRED_HIGHLIGHTER_C_STATE_LINE_COMMENT : DRED_HIGHLIGHTER_C_STATE_DEFAULT;
+    } else if (state == DRED_HIGHLIGHTER_C_STATE_STRING) {
+        i = dred_highlighter__find_string_end(text, textLength, 0, '\"', &isClosed);
+        drte_lexed_line_add_token(pLine, 0, i, stringStyle);
+        if (!isClosed) {
+            return isContinued ? DRED_HIGHLIGHTER_C_STATE_STRING : DRED_HIGHLIGHTER_C_STATE_DEFAULT;
+        }
+    }
+
+    // Preprocessor directives are only recognized at the start of the line.
+    size_t iFirstChar = i;
+    while (iFirstChar < textLength && (text[iFirstChar] == ' ' || text[iFirstChar] == '\t')) {
+        iFirstChar += 1;
+    }
+
+    while (i < textLength) {
+        char c = text[i];
+
+        if (c == '/' && i+1 < textLength && text[i+1] == '/') {
+            drte_lexed_line_add_token(pLine, i, textLength, commentStyle);
+            return isContinued ? DRED_HIGHLIGHTER_C_STATE_LINE_COMMENT : DRED_HIGHLIGHTER_C_STATE_DEFAULT;
+        }
+
+        if (c == '/' && i+1 < textLength && text[i+1] == '*') {
+            size_t iEnd = dred_highlighter__find_block_comment_end(text, textLength, i+2, &isClosed);
+            drte_lexed_line_add_token(pLine, i, iEnd, commentStyle);
+            if (!isClosed) {
+                return DRED_HIGHLIGHTER_C_STATE_BLOCK_COMMENT;
+            }
+
+            i = iEnd;
+            continue;
+        }
+
+        if (c == '\"' || c == '\'') {
+            size_t iEnd = dred_highlighter__find_string_end(text, textLength, i+1, c, &isClosed);
+            drte_lexed_line_add_token(pLine, i, iEnd, stringStyle);
+            if (!isClosed && c == '\"' && isContinued) {
+                return DRED_HIGHLIGHTER_C_STATE_STRING;
+            }
+
+            i = iEnd;
+            continue;
+        }
+
+        if (c == '#' && i == iFirstChar) {
+            size_t iEnd = i+1;
+            while (iEnd < textLength && (text[iEnd] == ' ' || text[iEnd] == '\t')) {
+                iEnd += 1;
+            }
+
+            size_t iNameBeg = iEnd;
+            while (iEnd < textLength && dred_highlighter__is_identifier_char(text[iEnd])) {
+                iEnd += 1;
+            }
+
+            drte_lexed_line_add_token(pLine, i, iEnd, keywordStyle);
+            i = iEnd;
+
+            // The file name of an include is styled like a string.
+            if (iEnd - iNameBeg == 7 && strncmp(text + iNameBeg, "include", 7) == 0) {
+                while (i < textLength && (text[i] == ' ' || text[i] == '\t')) {
+                    i += 1;
+                }
+
+                if (i < textLength && text[i] == '<') {
+                    iEnd = dred_highlighter__find_string_end(text, textLength, i+1, '>', &isClosed);
+                    drte_lexed_line_add_token(pLine, i, iEnd, stringStyle);
+                    i = iEnd;
+                }
+            }
+
+            continue;
+        }
+
+        if (dred_highlighter__is_identifier_char(c)) {
+            // Numbers are skipped over as a whole so that suffixes and hex digits aren't mistaken for identifiers.
+            size_t iEnd = i+1;
+            while (iEnd < textLength && (dred_highlighter__is_identifier_char(text[iEnd]) || (c >= '0' && c <= '9' && text[iEnd] == '.'))) {
+                iEnd += 1;
+            }
+
+            if (!(c >= '0' && c <= '9') && dred_highlighter__is_keyword(pHighlighter, text + i, iEnd - i)) {
+                drte_lexed_line_add_token(pLine, i, iEnd, keywordStyle);
+            }
+
+            i = iEnd;
+            continue;
+        }
+
+        i += 1;
+    }
+
+    return DRED_HIGHLIGHTER_C_STATE_DEFAULT;
+}
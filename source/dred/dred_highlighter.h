@@ -0,0 +1,28 @@
+// Copyright (C) 2017 David Reid. See included LICENSE file.
+
+// Syntax highlighting is done by the text engine which runs a lexer over one line at a time and keeps track of the state of the lexer
+// at the start of each line. See drte_engine_set_highlighter().
+
+#define DRED_HIGHLIGHTER_STYLE_COMMENT  0
+#define DRED_HIGHLIGHTER_STYLE_STRING   1
+#define DRED_HIGHLIGHTER_STYLE_KEYWORD  2
+#define DRED_HIGHLIGHTER_STYLE_COUNT    3
+
+typedef struct
+{
+    // The style of each kind of token, indexed by DRED_HIGHLIGHTER_STYLE_*. These need to be registered with the text engine.
+    dred_text_style styles[DRED_HIGHLIGHTER_STYLE_COUNT];
+
+    // The keywords of the language, in order.
+    const char** ppKeywords;
+    size_t keywordCount;
+} dred_highlighter;
+
+// Initializes a highlighter for C and C++. Use dred_highlighter_lex_line_c() as the lexer.
+dtk_bool32 dred_highlighter_init_c(dred_highlighter* pHighlighter, dred_context* pDred);
+
+// Updates the colors of the highlighter's styles from the config.
+void dred_highlighter_refresh_styling(dred_highlighter* pHighlighter, dred_context* pDred);
+
+// The lexer for C and C++. Pass this to drte_engine_set_highlighter() with the highlighter as the user data.
+uint32_t dred_highlighter_lex_line_c(drte_engine* pEngine, uint32_t state, const char* text, size_t textLength, drte_lexed_line* pLine, void* pUserData);
@@ -26,6 +26,7 @@ static const char* g_StockTheme_Dark =
     "texteditor-cursor-color 224 224 224 255\n"
     "texteditor-cursor-width 1.000000\n"
     "texteditor-selection-bg-color 64 128 192 255\n"
+    "texteditor-match-bg-color 96 80 40 255\n"
     "texteditor-active-line-color 40 40 40 255\n"
     "texteditor-line-numbers-color 80 160 192 255\n"
     "texteditor-line-numbers-bg-color 48 48 48 255\n"
@@ -62,6 +63,7 @@ static const char* g_StockTheme_Light =
     "texteditor-cursor-color 0 0 0 255\n"
     "texteditor-cursor-width 1.000000\n"
     "texteditor-selection-bg-color 128 200 224 255\n"
+    "texteditor-match-bg-color 255 232 160 255\n"
     "texteditor-active-line-color 224 224 224 255\n"
     "texteditor-line-numbers-color 80 160 192 255\n"
     "texteditor-line-numbers-bg-color 255 255 255 255\n"
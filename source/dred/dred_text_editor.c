@@ -1,5 +1,28 @@
 // Copyright (C) 2017 David Reid. See included LICENSE file.
 
+// Files at least this big are memory mapped and used by the text engine directly rather than being read into memory.
+#ifndef DRED_TEXT_EDITOR_MAP_FILE_THRESHOLD
+#define DRED_TEXT_EDITOR_MAP_FILE_THRESHOLD (16*1024*1024)
+#endif
+
+// How often lines found by the line indexing thread are handed to the text engine.
+#ifndef DRED_TEXT_EDITOR_LINE_INDEXING_INTERVAL
+#define DRED_TEXT_EDITOR_LINE_INDEXING_INTERVAL 50
+#endif
+
+// How often the highlighting thread is given a new job, and the maximum number of characters in each one.
+#ifndef DRED_TEXT_EDITOR_HIGHLIGHTING_INTERVAL
+#define DRED_TEXT_EDITOR_HIGHLIGHTING_INTERVAL 16
+#endif
+#ifndef DRED_TEXT_EDITOR_HIGHLIGHTING_CHUNK_SIZE
+#define DRED_TEXT_EDITOR_HIGHLIGHTING_CHUNK_SIZE (1024*1024)
+#endif
+
+// The maximum number of lines lexed on demand while painting. Anything further is left to the highlighting thread.
+#ifndef DRED_TEXT_EDITOR_HIGHLIGHTING_LEX_LIMIT
+#define DRED_TEXT_EDITOR_HIGHLIGHTING_LEX_LIMIT 1000
+#endif
+
 dred_textview* dred_text_editor__get_textview(dred_text_editor* pTextEditor)
 {
     if (pTextEditor == NULL) {
@@ -18,6 +41,19 @@ void dred_text_editor__register_style(dred_text_editor* pTextEditor, dred_text_s
     drte_engine_register_style_token(dred_textview_get_engine(dred_text_editor__get_textview(pTextEditor)), (drte_style_token)pStyle, drteFontMetrics);
 }
 
+// Registers the styles of the highlighter with the font and scale of the text view. Needs to be called whenever either of them change.
+void dred_text_editor__refresh_highlighter_styles(dred_text_editor* pTextEditor)
+{
+    if (pTextEditor->engine.onLexLine == NULL) {
+        return; // No highlighter.
+    }
+
+    for (int i = 0; i < DRED_HIGHLIGHTER_STYLE_COUNT; ++i) {
+        pTextEditor->highlighter.styles[i].pFont = dred_textview_get_font(pTextEditor->pTextView);
+        dred_text_editor__register_style(pTextEditor, &pTextEditor->highlighter.styles[i]);
+    }
+}
+
 
 void dred_text_editor__on_size(dred_control* pControl, float newWidth, float newHeight)
 {
@@ -57,10 +93,29 @@ void dred_text_editor_textview__on_key_down(dred_control* pControl, dtk_key key,
     if (key == DTK_KEY_ESCAPE) {
         dred_focus_command_bar(dred_control_get_context(pControl));
     } else {
+        // The text is replaced when the file finishes loading so there's no point editing it before then.
+        dred_text_editor* pTextEditor = DRED_TEXT_EDITOR(dtk_control_get_parent(DTK_CONTROL(pControl)));
+        if (pTextEditor != NULL && dred_editor_is_loading(DRED_EDITOR(pTextEditor))) {
+            return;
+        }
+
         dred_textview_on_key_down(DRED_CONTROL(pTextView), key, stateFlags);
     }
 }
 
+void dred_text_editor_textview__on_printable_key_down(dred_control* pControl, unsigned int utf32, int stateFlags)
+{
+    dred_textview* pTextView = DRED_TEXTVIEW(pControl);
+    assert(pTextView != NULL);
+
+    dred_text_editor* pTextEditor = DRED_TEXT_EDITOR(dtk_control_get_parent(DTK_CONTROL(pControl)));
+    if (pTextEditor != NULL && dred_editor_is_loading(DRED_EDITOR(pTextEditor))) {
+        return;
+    }
+
+    dred_textview_on_printable_key_down(DRED_CONTROL(pTextView), utf32, stateFlags);
+}
+
 void dred_text_editor_textview__on_mouse_wheel(dred_control* pControl, int delta, int mousePosX, int mousePosY, int stateFlags)
 {
     dred_textview* pTextView = DRED_TEXTVIEW(pControl);
@@ -124,6 +179,14 @@ void dred_text_editor_textview__on_cursor_move(dred_textview* pTextView)
     dred_update_info_bar(dred_control_get_context(DRED_CONTROL(pTextEditor)), DRED_CONTROL(pTextEditor));
 }
 
+void dred_text_editor_textview__on_matches_changed(dred_textview* pTextView)
+{
+    dred_text_editor* pTextEditor = DRED_TEXT_EDITOR(dtk_control_get_parent(DTK_CONTROL(pTextView)));
+    assert(pTextEditor != NULL);
+
+    dred_update_info_bar(dred_control_get_context(DRED_CONTROL(pTextEditor)), DRED_CONTROL(pTextEditor));
+}
+
 void dred_text_editor_textview__on_capture_keyboard(dred_control* pControl, dtk_control* pPrevCapturedControl)
 {
     dred_textview* pTextView = DRED_TEXTVIEW(pControl);
@@ -198,6 +261,22 @@ void dred_text_editor_engine__on_undo_stack_trimmed(drte_engine* pTextEngine)
     }
 }
 
+void dred_text_editor_engine__on_undo_points_evicted(drte_engine* pTextEngine, unsigned int evictedCount)
+{
+    dred_text_editor* pTextEditor = (dred_text_editor*)pTextEngine->pUserData;
+    assert(pTextEditor != NULL);
+
+    // The undo points are evicted from the bottom of the stack so the base undo point needs to move down with them. If the base undo
+    // point itself was evicted there is no longer any way to get back to the saved state.
+    if (pTextEditor->iBaseUndoPoint != (unsigned int)-1) {
+        if (pTextEditor->iBaseUndoPoint < evictedCount) {
+            pTextEditor->iBaseUndoPoint = (unsigned int)-1;
+        } else {
+            pTextEditor->iBaseUndoPoint -= evictedCount;
+        }
+    }
+}
+
 dtk_bool32 dred_text_editor__on_save(dred_editor* pEditor, dred_file file, const char* filePath)
 {
     dred_text_editor* pTextEditor = DRED_TEXT_EDITOR(pEditor);
@@ -229,24 +308,575 @@ dtk_bool32 dred_text_editor__on_save(dred_editor* pEditor, dred_file file, const
     return result;
 }
 
-dtk_bool32 dred_text_editor__on_reload(dred_editor* pEditor)
+void dred_text_editor__on_free_mapped_file(drte_engine* pEngine, const char* text, size_t textLength, void* pUserData)
+{
+    (void)pEngine;
+    (void)text;
+    (void)textLength;
+
+    dtk_mapped_file* pMappedFile = (dtk_mapped_file*)pUserData;
+    assert(pMappedFile != NULL);
+
+    dtk_unmap_file(pMappedFile);
+    dtk_free(pMappedFile);
+}
+
+void dred_text_editor__on_free_file_data(drte_engine* pEngine, const char* text, size_t textLength, void* pUserData)
+{
+    (void)pEngine;
+    (void)textLength;
+    (void)pUserData;
+
+    dtk_free((void*)text);
+}
+
+dtk_thread_result DTK_THREADCALL dred_text_editor__line_indexing_thread(void* pData)
+{
+    dred_text_editor* pTextEditor = (dred_text_editor*)pData;
+    assert(pTextEditor != NULL);
+
+    const char* pText = pTextEditor->pLineIndexingText;
+    size_t textLength = pTextEditor->lineIndexingTextLength;
+    size_t scannedLength = pTextEditor->lineIndexingStartOffset;
+
+    size_t lineOffsets[4096];
+    while (scannedLength < textLength) {
+        size_t lineCount;
+        size_t chunkLength = drte_find_line_offsets(pText + scannedLength, textLength - scannedLength, lineOffsets, sizeof(lineOffsets)/sizeof(lineOffsets[0]), &lineCount);
+        for (size_t i = 0; i < lineCount; ++i) {
+            lineOffsets[i] += scannedLength;
+        }
+
+        dtk_bool32 keepGoing = DTK_FALSE;
+        dtk_mutex_lock(&pTextEditor->lineIndexingLock);
+        {
+            if (!pTextEditor->isLineIndexingCancelled) {
+                if (pTextEditor->indexedLineOffsetCount + lineCount > pTextEditor->indexedLineOffsetCapacity) {
+                    size_t newCapacity = (pTextEditor->indexedLineOffsetCapacity == 0) ? sizeof(lineOffsets)/sizeof(lineOffsets[0]) : pTextEditor->indexedLineOffsetCapacity*2;
+                    size_t* pNewLineOffsets = (size_t*)realloc(pTextEditor->pIndexedLineOffsets, newCapacity * sizeof(*pNewLineOffsets));
+                    if (pNewLineOffsets != NULL) {
+                        pTextEditor->pIndexedLineOffsets = pNewLineOffsets;
+                        pTextEditor->indexedLineOffsetCapacity = newCapacity;
+                    }
+                }
+
+                // If we run out of memory the remaining lines are left for the engine to index when it needs them.
+                if (pTextEditor->indexedLineOffsetCount + lineCount <= pTextEditor->indexedLineOffsetCapacity) {
+                    memcpy(pTextEditor->pIndexedLineOffsets + pTextEditor->indexedLineOffsetCount, lineOffsets, lineCount * sizeof(*lineOffsets));
+                    pTextEditor->indexedLineOffsetCount += lineCount;
+                    pTextEditor->lineIndexingScannedLength = scannedLength + chunkLength;
+                    keepGoing = DTK_TRUE;
+                } else {
+                    pTextEditor->isLineIndexingCancelled = DTK_TRUE;
+                }
+            }
+        }
+        dtk_mutex_unlock(&pTextEditor->lineIndexingLock);
+
+        if (!keepGoing) {
+            break;
+        }
+
+        scannedLength += chunkLength;
+    }
+
+    return 0;
+}
+
+void dred_text_editor__end_line_indexing(dred_text_editor* pTextEditor)
+{
+    assert(pTextEditor != NULL);
+
+    if (!pTextEditor->isLineIndexing) {
+        return;
+    }
+
+    dtk_mutex_lock(&pTextEditor->lineIndexingLock);
+    {
+        pTextEditor->isLineIndexingCancelled = DTK_TRUE;
+    }
+    dtk_mutex_unlock(&pTextEditor->lineIndexingLock);
+
+    dtk_thread_wait(&pTextEditor->lineIndexingThread);
+    dtk_timer_uninit(&pTextEditor->lineIndexingTimer);
+    dtk_mutex_uninit(&pTextEditor->lineIndexingLock);
+
+    free(pTextEditor->pIndexedLineOffsets);
+    pTextEditor->pIndexedLineOffsets = NULL;
+    pTextEditor->indexedLineOffsetCount = 0;
+    pTextEditor->indexedLineOffsetCapacity = 0;
+    pTextEditor->pLineIndexingText = NULL;
+    pTextEditor->lineIndexingTextLength = 0;
+    pTextEditor->isLineIndexing = DTK_FALSE;
+}
+
+void dred_text_editor__on_line_indexing_timer(dtk_timer* pTimer, void* pUserData)
+{
+    (void)pTimer;
+
+    dred_text_editor* pTextEditor = (dred_text_editor*)pUserData;
+    assert(pTextEditor != NULL);
+
+    // The lines are taken from the thread before handing them to the engine so the thread isn't held up while they're inserted.
+    size_t* pLineOffsets;
+    size_t lineCount;
+    size_t scannedLength;
+    dtk_bool32 isCancelled;
+    dtk_mutex_lock(&pTextEditor->lineIndexingLock);
+    {
+        pLineOffsets = pTextEditor->pIndexedLineOffsets;
+        lineCount = pTextEditor->indexedLineOffsetCount;
+        scannedLength = pTextEditor->lineIndexingScannedLength;
+        isCancelled = pTextEditor->isLineIndexingCancelled;
+
+        pTextEditor->pIndexedLineOffsets = NULL;
+        pTextEditor->indexedLineOffsetCount = 0;
+        pTextEditor->indexedLineOffsetCapacity = 0;
+    }
+    dtk_mutex_unlock(&pTextEditor->lineIndexingLock);
+
+    drte_engine_add_indexed_lines(&pTextEditor->engine, pLineOffsets, lineCount, scannedLength);
+    free(pLineOffsets);
+
+    // The scrollbars and line numbers need to grow with the line count.
+    dred_textview__on_text_changed(pTextEditor->pTextView);
+
+    if (isCancelled || scannedLength == pTextEditor->lineIndexingTextLength || drte_engine_get_unindexed_length(&pTextEditor->engine) == 0) {
+        dred_text_editor__end_line_indexing(pTextEditor);
+    }
+}
+
+// Starts finding the lines of the engine's text on a background thread. This is only used when the text was set without indexing
+// it's lines. Searching starts at the first character that has not yet been indexed.
+dtk_result dred_text_editor__begin_line_indexing(dred_text_editor* pTextEditor)
+{
+    assert(pTextEditor != NULL);
+    assert(!pTextEditor->isLineIndexing);
+
+    size_t unindexedLength = drte_engine_get_unindexed_length(&pTextEditor->engine);
+    if (unindexedLength == 0) {
+        return DTK_SUCCESS;
+    }
+
+    pTextEditor->pLineIndexingText = pTextEditor->engine.text.pOriginal;
+    pTextEditor->lineIndexingTextLength = pTextEditor->engine.text.originalLength;
+    pTextEditor->lineIndexingStartOffset = pTextEditor->lineIndexingTextLength - unindexedLength;
+    pTextEditor->lineIndexingScannedLength = pTextEditor->lineIndexingStartOffset;
+    pTextEditor->isLineIndexingCancelled = DTK_FALSE;
+
+    dtk_result result = dtk_mutex_init(&pTextEditor->lineIndexingLock);
+    if (result != DTK_SUCCESS) {
+        return result;
+    }
+
+    result = dtk_timer_init(DTK_CONTROL(pTextEditor)->pTK, DRED_TEXT_EDITOR_LINE_INDEXING_INTERVAL, dred_text_editor__on_line_indexing_timer, pTextEditor, &pTextEditor->lineIndexingTimer);
+    if (result != DTK_SUCCESS) {
+        dtk_mutex_uninit(&pTextEditor->lineIndexingLock);
+        return result;
+    }
+
+    result = dtk_thread_create(&pTextEditor->lineIndexingThread, dred_text_editor__line_indexing_thread, pTextEditor);
+    if (result != DTK_SUCCESS) {
+        dtk_timer_uninit(&pTextEditor->lineIndexingTimer);
+        dtk_mutex_uninit(&pTextEditor->lineIndexingLock);
+        return result;
+    }
+
+    pTextEditor->isLineIndexing = DTK_TRUE;
+    return DTK_SUCCESS;
+}
+
+dtk_thread_result DTK_THREADCALL dred_text_editor__highlighting_thread(void* pData)
+{
+    dred_text_editor* pTextEditor = (dred_text_editor*)pData;
+    assert(pTextEditor != NULL);
+
+    for (;;) {
+        dtk_semaphore_wait(&pTextEditor->highlightingSemaphore);
+
+        dtk_bool32 isCancelled;
+        dtk_mutex_lock(&pTextEditor->highlightingLock);
+        {
+            isCancelled = pTextEditor->isHighlightingCancelled;
+        }
+        dtk_mutex_unlock(&pTextEditor->highlightingLock);
+
+        if (isCancelled) {
+            break;
+        }
+
+        drte_lexer_job_run(&pTextEditor->highlightingJob, pTextEditor->pHighlightingStates);
+
+        dtk_mutex_lock(&pTextEditor->highlightingLock);
+        {
+            pTextEditor->isHighlightingJobQueued = DTK_FALSE;
+            pTextEditor->isHighlightingJobDone = DTK_TRUE;
+        }
+        dtk_mutex_unlock(&pTextEditor->highlightingLock);
+    }
+
+    return 0;
+}
+
+void dred_text_editor__end_highlighting(dred_text_editor* pTextEditor)
+{
+    assert(pTextEditor != NULL);
+
+    if (!pTextEditor->isHighlighting) {
+        return;
+    }
+
+    dtk_mutex_lock(&pTextEditor->highlightingLock);
+    {
+        pTextEditor->isHighlightingCancelled = DTK_TRUE;
+    }
+    dtk_mutex_unlock(&pTextEditor->highlightingLock);
+
+    dtk_semaphore_release(&pTextEditor->highlightingSemaphore);
+    dtk_thread_wait(&pTextEditor->highlightingThread);
+    dtk_timer_uninit(&pTextEditor->highlightingTimer);
+    dtk_semaphore_uninit(&pTextEditor->highlightingSemaphore);
+    dtk_mutex_uninit(&pTextEditor->highlightingLock);
+
+    free(pTextEditor->pHighlightingText);
+    free(pTextEditor->pHighlightingStates);
+    pTextEditor->pHighlightingText = NULL;
+    pTextEditor->pHighlightingStates = NULL;
+    pTextEditor->highlightingStateCapacity = 0;
+    pTextEditor->isHighlighting = DTK_FALSE;
+
+    // Without the thread every line needs to be lexed on demand.
+    drte_engine_set_highlighter_lex_limit(&pTextEditor->engine, (size_t)-1);
+}
+
+void dred_text_editor__on_highlighting_timer(dtk_timer* pTimer, void* pUserData)
+{
+    (void)pTimer;
+
+    dred_text_editor* pTextEditor = (dred_text_editor*)pUserData;
+    assert(pTextEditor != NULL);
+
+    dtk_bool32 isJobQueued;
+    dtk_bool32 isJobDone;
+    dtk_mutex_lock(&pTextEditor->highlightingLock);
+    {
+        isJobQueued = pTextEditor->isHighlightingJobQueued;
+        isJobDone = pTextEditor->isHighlightingJobDone;
+        pTextEditor->isHighlightingJobDone = DTK_FALSE;
+    }
+    dtk_mutex_unlock(&pTextEditor->highlightingLock);
+
+    if (isJobQueued) {
+        return; // Still running.
+    }
+
+    // The results are ignored by the engine if the text has changed since the job was taken.
+    if (isJobDone) {
+        drte_engine_set_lexer_states(&pTextEditor->engine, &pTextEditor->highlightingJob, pTextEditor->pHighlightingStates);
+    }
+
+    if (!drte_engine_get_lexer_job(&pTextEditor->engine, pTextEditor->pHighlightingText, DRED_TEXT_EDITOR_HIGHLIGHTING_CHUNK_SIZE, &pTextEditor->highlightingJob)) {
+        return; // Everything has been lexed.
+    }
+
+    if (pTextEditor->highlightingJob.lineCount > pTextEditor->highlightingStateCapacity) {
+        uint32_t* pNewStates = (uint32_t*)realloc(pTextEditor->pHighlightingStates, pTextEditor->highlightingJob.lineCount * sizeof(*pNewStates));
+        if (pNewStates == NULL) {
+            return;
+        }
+
+        pTextEditor->pHighlightingStates = pNewStates;
+        pTextEditor->highlightingStateCapacity = pTextEditor->highlightingJob.lineCount;
+    }
+
+    dtk_mutex_lock(&pTextEditor->highlightingLock);
+    {
+        pTextEditor->isHighlightingJobQueued = DTK_TRUE;
+    }
+    dtk_mutex_unlock(&pTextEditor->highlightingLock);
+
+    dtk_semaphore_release(&pTextEditor->highlightingSemaphore);
+}
+
+// Starts lexing for the engine's highlighter on a background thread. Lines that haven't been lexed by the thread are shown without
+// highlighting until it catches up.
+dtk_result dred_text_editor__begin_highlighting(dred_text_editor* pTextEditor)
+{
+    assert(pTextEditor != NULL);
+    assert(!pTextEditor->isHighlighting);
+
+    pTextEditor->pHighlightingText = (char*)malloc(DRED_TEXT_EDITOR_HIGHLIGHTING_CHUNK_SIZE);
+    if (pTextEditor->pHighlightingText == NULL) {
+        return DTK_OUT_OF_MEMORY;
+    }
+
+    pTextEditor->isHighlightingJobQueued = DTK_FALSE;
+    pTextEditor->isHighlightingJobDone = DTK_FALSE;
+    pTextEditor->isHighlightingCancelled = DTK_FALSE;
+
+    dtk_result result = dtk_mutex_init(&pTextEditor->highlightingLock);
+    if (result != DTK_SUCCESS) {
+        goto on_error;
+    }
+
+    result = dtk_semaphore_init(&pTextEditor->highlightingSemaphore, 0);
+    if (result != DTK_SUCCESS) {
+        dtk_mutex_uninit(&pTextEditor->highlightingLock);
+        goto on_error;
+    }
+
+    result = dtk_timer_init(DTK_CONTROL(pTextEditor)->pTK, DRED_TEXT_EDITOR_HIGHLIGHTING_INTERVAL, dred_text_editor__on_highlighting_timer, pTextEditor, &pTextEditor->highlightingTimer);
+    if (result != DTK_SUCCESS) {
+        dtk_semaphore_uninit(&pTextEditor->highlightingSemaphore);
+        dtk_mutex_uninit(&pTextEditor->highlightingLock);
+        goto on_error;
+    }
+
+    result = dtk_thread_create(&pTextEditor->highlightingThread, dred_text_editor__highlighting_thread, pTextEditor);
+    if (result != DTK_SUCCESS) {
+        dtk_timer_uninit(&pTextEditor->highlightingTimer);
+        dtk_semaphore_uninit(&pTextEditor->highlightingSemaphore);
+        dtk_mutex_uninit(&pTextEditor->highlightingLock);
+        goto on_error;
+    }
+
+    drte_engine_set_highlighter_lex_limit(&pTextEditor->engine, DRED_TEXT_EDITOR_HIGHLIGHTING_LEX_LIMIT);
+
+    pTextEditor->isHighlighting = DTK_TRUE;
+    return DTK_SUCCESS;
+
+on_error:
+    free(pTextEditor->pHighlightingText);
+    pTextEditor->pHighlightingText = NULL;
+    return result;
+}
+
+// Hands a memory mapped file to the engine. The engine unmaps it when it's no longer needed. The lines are indexed in the background
+// so the file can be shown straight away.
+dtk_result dred_text_editor__set_mapped_file(dred_text_editor* pTextEditor, dtk_mapped_file* pMappedFile)
+{
+    assert(pTextEditor != NULL);
+    assert(pMappedFile != NULL);
+
+    if (!dred_textview_set_text_no_copy(pTextEditor->pTextView, (const char*)pMappedFile->pData, pMappedFile->dataSize, dred_text_editor__on_free_mapped_file, pMappedFile)) {
+        return DTK_OUT_OF_MEMORY;
+    }
+
+    // If the line indexing thread can't be started the lines are indexed now.
+    if (dred_text_editor__begin_line_indexing(pTextEditor) != DTK_SUCCESS) {
+        drte_engine_index_lines_to_line(&pTextEditor->engine, (size_t)-1);
+    }
+
+    return DTK_SUCCESS;
+}
+
+// Hands text read by the file loader to the engine, along with the lines that were found in it. The engine frees the text when it's
+// no longer needed.
+dtk_result dred_text_editor__set_file_data(dred_text_editor* pTextEditor, char* pFileData, size_t fileSize, const size_t* pLineOffsets, size_t lineCount)
+{
+    assert(pTextEditor != NULL);
+    assert(pFileData != NULL);
+
+    if (!dred_textview_set_text_no_copy(pTextEditor->pTextView, pFileData, fileSize, dred_text_editor__on_free_file_data, NULL)) {
+        return DTK_OUT_OF_MEMORY;
+    }
+
+    // The loader won't have found the lines if it ran out of memory, in which case they're found now.
+    if (pLineOffsets == NULL || !drte_engine_add_indexed_lines(&pTextEditor->engine, pLineOffsets, lineCount, fileSize)) {
+        drte_engine_index_lines_to_line(&pTextEditor->engine, (size_t)-1);
+    }
+
+    // The scrollbars and line numbers need to be updated for the new lines.
+    dred_textview__on_text_changed(pTextEditor->pTextView);
+
+    return DTK_SUCCESS;
+}
+
+// Called once a file has been loaded into the editor so that the load itself can't be undone and doesn't count as a modification.
+void dred_text_editor__on_file_loaded(dred_text_editor* pTextEditor)
+{
+    assert(pTextEditor != NULL);
+
+    dred_textview_clear_undo_stack(pTextEditor->pTextView);
+    pTextEditor->iBaseUndoPoint = dred_textview_get_undo_points_remaining_count(pTextEditor->pTextView);
+    dred_editor_unmark_as_modified(DRED_EDITOR(pTextEditor));
+}
+
+void dred_text_editor__on_load_job_finished(dred_file_load_job* pJob)
+{
+    assert(pJob != NULL);
+
+    dred_text_editor* pTextEditor = (dred_text_editor*)pJob->pUserData;
+    assert(pTextEditor != NULL);
+
+    pTextEditor->pLoadJob = NULL;
+
+    // Whatever is handed to the engine is taken from the job so it isn't freed with it.
+    dtk_result result = pJob->result;
+    if (result == DTK_SUCCESS) {
+        if (pJob->pMappedFile != NULL) {
+            result = dred_text_editor__set_mapped_file(pTextEditor, pJob->pMappedFile);
+            if (result == DTK_SUCCESS) {
+                pJob->pMappedFile = NULL;
+            }
+        } else {
+            result = dred_text_editor__set_file_data(pTextEditor, pJob->pFileData, pJob->fileSize, pJob->pLineOffsets, pJob->lineCount);
+            if (result == DTK_SUCCESS) {
+                pJob->pFileData = NULL;
+            }
+        }
+    }
+
+    if (result != DTK_SUCCESS) {
+        // The tab is closed rather than left empty where it could be saved over the file.
+        dred_context* pDred = dred_control_get_context(DRED_CONTROL(pTextEditor));
+        dred_errorf(pDred, "Failed to open file: %s\n", pJob->filePath);
+        dred_cmdbar_set_message(&pDred->cmdBar, "Failed to open file.");
+
+        dred_tab* pTab = dred_find_control_tab(DRED_CONTROL(pTextEditor));
+        if (pTab != NULL) {
+            dred_close_tab(pDred, pTab);
+            return;
+        }
+    }
+
+    dred_text_editor__on_file_loaded(pTextEditor);
+    dred_editor_end_loading(DRED_EDITOR(pTextEditor));
+}
+
+// Starts loading the given file on the context's file loader. The editor is left empty and marked as loading until it's done. This
+// fails if the loader isn't running or the file doesn't exist, in which case the file should be loaded on the main thread instead so
+// that errors are reported straight away.
+dtk_result dred_text_editor__begin_loading(dred_text_editor* pTextEditor, const char* filePath)
 {
+    assert(pTextEditor != NULL);
+    assert(pTextEditor->pLoadJob == NULL);
+
+    dred_context* pDred = dred_control_get_context(DRED_CONTROL(pTextEditor));
+    assert(pDred != NULL);
+
+    if (!dred_file_loader_is_running(&pDred->fileLoader) || !dtk_file_exists(filePath)) {
+        return DTK_ERROR;
+    }
+
+    dtk_result result = dred_file_loader_load(&pDred->fileLoader, filePath, DRED_TEXT_EDITOR_MAP_FILE_THRESHOLD, dred_text_editor__on_load_job_finished, pTextEditor, &pTextEditor->pLoadJob);
+    if (result != DTK_SUCCESS) {
+        return result;
+    }
+
+    dred_editor_begin_loading(DRED_EDITOR(pTextEditor));
+    return DTK_SUCCESS;
+}
+
+// Stops loading the file in the background. This is used when the editor is being deleted or the file is about to be loaded on the
+// main thread instead.
+void dred_text_editor__cancel_loading(dred_text_editor* pTextEditor)
+{
+    assert(pTextEditor != NULL);
+
+    if (pTextEditor->pLoadJob == NULL) {
+        return;
+    }
+
+    dred_file_loader_cancel(&dred_control_get_context(DRED_CONTROL(pTextEditor))->fileLoader, pTextEditor->pLoadJob);
+    pTextEditor->pLoadJob = NULL;
+
+    dred_editor_end_loading(DRED_EDITOR(pTextEditor));
+}
+
+dtk_result dred_text_editor__load_file(dred_text_editor* pTextEditor, const char* filePath);
+
+// Loads the file on the main thread if it's still being loaded in the background. Used when the contents are needed straight away.
+dtk_result dred_text_editor__finish_loading(dred_text_editor* pTextEditor)
+{
+    assert(pTextEditor != NULL);
+
+    if (pTextEditor->pLoadJob == NULL) {
+        return DTK_SUCCESS;
+    }
+
+    dtk_result result = dred_text_editor__load_file(pTextEditor, dred_editor_get_file_path(DRED_EDITOR(pTextEditor)));
+    if (result != DTK_SUCCESS) {
+        return result;
+    }
+
+    dred_text_editor__on_file_loaded(pTextEditor);
+    return DTK_SUCCESS;
+}
+
+dtk_bool32 dred_text_editor__on_before_save(dred_editor* pEditor, const char* filePath)
+{
+    (void)filePath;
+
     dred_text_editor* pTextEditor = DRED_TEXT_EDITOR(pEditor);
     assert(pTextEditor != NULL);
 
-    dred_textview* pTextView = dred_text_editor__get_textview(pTextEditor);
-    if (pTextView == NULL) {
+    // The file can't be written until the editor has it's contents.
+    if (dred_text_editor__finish_loading(pTextEditor) != DTK_SUCCESS) {
         return DTK_FALSE;
     }
 
+    // If the file is memory mapped the engine is still reading from it, so it needs to take a copy before the file is overwritten. The
+    // line indexing thread is reading from it as well so it needs to be stopped first, and then restarted on the copy.
+    dred_text_editor__end_line_indexing(pTextEditor);
+
+    dtk_bool32 result = drte_engine_copy_borrowed_text(&pTextEditor->engine);
+    if (dred_text_editor__begin_line_indexing(pTextEditor) != DTK_SUCCESS) {
+        drte_engine_index_lines_to_line(&pTextEditor->engine, (size_t)-1);
+    }
+
+    return result;
+}
+
+// Loads the given file into the editor. Large files are memory mapped and handed straight to the text engine so that nothing needs
+// to be read or copied up front, but doing so clears the undo stack. Smaller files, and files that can't be mapped, are read as normal
+// so the load is undoable.
+dtk_result dred_text_editor__load_file(dred_text_editor* pTextEditor, const char* filePath)
+{
+    assert(pTextEditor != NULL);
+
+    // The existing text is about to be replaced so anything still loading or indexing it needs to stop.
+    dred_text_editor__cancel_loading(pTextEditor);
+    dred_text_editor__end_line_indexing(pTextEditor);
+
+    dtk_mapped_file* pMappedFile;
     char* pFileData;
-    if (dtk_open_and_read_text_file(dred_editor_get_file_path(DRED_EDITOR(pTextEditor)), NULL, &pFileData) != DTK_SUCCESS) {
-        return DTK_FALSE;
+    size_t fileSize;
+    dtk_result result = dred_open_text_file(filePath, DRED_TEXT_EDITOR_MAP_FILE_THRESHOLD, &pMappedFile, &pFileData, &fileSize);
+    if (result != DTK_SUCCESS) {
+        return result;
+    }
+
+    if (pMappedFile != NULL) {
+        result = dred_text_editor__set_mapped_file(pTextEditor, pMappedFile);
+        if (result != DTK_SUCCESS) {
+            dtk_unmap_file(pMappedFile);
+            dtk_free(pMappedFile);
+        }
+
+        return result;
     }
 
     dred_textview_set_text(pTextEditor->pTextView, pFileData);
     dtk_free(pFileData);
 
+    return DTK_SUCCESS;
+}
+
+dtk_bool32 dred_text_editor__on_reload(dred_editor* pEditor)
+{
+    dred_text_editor* pTextEditor = DRED_TEXT_EDITOR(pEditor);
+    assert(pTextEditor != NULL);
+
+    dred_textview* pTextView = dred_text_editor__get_textview(pTextEditor);
+    if (pTextView == NULL) {
+        return DTK_FALSE;
+    }
+
+    if (dred_text_editor__load_file(pTextEditor, dred_editor_get_file_path(DRED_EDITOR(pTextEditor))) != DTK_SUCCESS) {
+        return DTK_FALSE;
+    }
+
     // After reloading we need to update the base undo point and unmark the file as modified.
     pTextEditor->iBaseUndoPoint = dred_textview_get_undo_points_remaining_count(pTextView);
     dred_editor_unmark_as_modified(DRED_EDITOR(pTextEditor));
@@ -291,6 +921,7 @@ dred_text_editor* dred_text_editor_create(dred_context* pDred, dtk_control* pPar
     drte_engine_set_on_text_changed(&pTextEditor->engine, dred_text_editor_engine__on_text_changed);
     drte_engine_set_on_undo_point_changed(&pTextEditor->engine, dred_text_editor_engine__on_undo_point_changed);
     pTextEditor->engine.onUndoStackTrimmed = dred_text_editor_engine__on_undo_stack_trimmed;
+    pTextEditor->engine.onUndoPointsEvicted = dred_text_editor_engine__on_undo_points_evicted;
     pTextEditor->engine.onGetUndoState = dred_text_editor_engine__on_get_undo_state;
     pTextEditor->engine.onApplyUndoState = dred_text_editor_engine__on_apply_undo_state;
 
@@ -305,11 +936,12 @@ dred_text_editor* dred_text_editor_create(dred_context* pDred, dtk_control* pPar
     dred_control_set_size(DRED_CONTROL(pTextEditor->pTextView), sizeX, sizeY);
 
     pTextEditor->textScale = 1;
+    dred_text_editor_refresh_undo_memory_budget(pTextEditor);
     dred_text_editor_set_highlighter(pTextEditor, dred_get_language_by_file_path(pDred, filePathAbsolute));
 
-    if (filePathAbsolute != NULL && filePathAbsolute[0] != '\0') {
-        char* pFileData;
-        if (dtk_open_and_read_text_file(filePathAbsolute, NULL, &pFileData) != DTK_SUCCESS) {
+    // The file is loaded in the background when possible so the editor can be shown straight away.
+    if (filePathAbsolute != NULL && filePathAbsolute[0] != '\0' && dred_text_editor__begin_loading(pTextEditor, filePathAbsolute) != DTK_SUCCESS) {
+        if (dred_text_editor__load_file(pTextEditor, filePathAbsolute) != DTK_SUCCESS) {
             dred_textview_uninit(pTextEditor->pTextView);
             drte_engine_uninit(&pTextEditor->engine);
             dred_editor_uninit(DRED_EDITOR(pTextEditor));
@@ -317,9 +949,7 @@ dred_text_editor* dred_text_editor_create(dred_context* pDred, dtk_control* pPar
             return NULL;
         }
 
-        dred_textview_set_text(pTextEditor->pTextView, pFileData);
         dred_textview_clear_undo_stack(pTextEditor->pTextView);
-        dtk_free(pFileData);
     }
 
 
@@ -327,12 +957,15 @@ dred_text_editor* dred_text_editor_create(dred_context* pDred, dtk_control* pPar
     dred_control_set_on_size(DRED_CONTROL(pTextEditor), dred_text_editor__on_size);
     dred_control_set_on_capture_keyboard(DRED_CONTROL(pTextEditor), dred_text_editor__on_capture_keyboard);
     dred_editor_set_on_save(DRED_EDITOR(pTextEditor), dred_text_editor__on_save);
+    dred_editor_set_on_before_save(DRED_EDITOR(pTextEditor), dred_text_editor__on_before_save);
     dred_editor_set_on_reload(DRED_EDITOR(pTextEditor), dred_text_editor__on_reload);
     dred_control_set_on_mouse_button_up(DRED_CONTROL(pTextEditor->pTextView), dred_text_editor_textview__on_mouse_button_up);
     dred_control_set_on_mouse_wheel(DRED_CONTROL(pTextEditor->pTextView), dred_text_editor_textview__on_mouse_wheel);
     dred_control_set_on_key_down(DRED_CONTROL(pTextEditor->pTextView), dred_text_editor_textview__on_key_down);
+    dred_control_set_on_printable_key_down(DRED_CONTROL(pTextEditor->pTextView), dred_text_editor_textview__on_printable_key_down);
     dred_control_set_on_capture_keyboard(DRED_CONTROL(pTextEditor->pTextView), dred_text_editor_textview__on_capture_keyboard);
     dred_textview_set_on_cursor_move(pTextEditor->pTextView, dred_text_editor_textview__on_cursor_move);
+    dred_textview_set_on_matches_changed(pTextEditor->pTextView, dred_text_editor_textview__on_matches_changed);
     //dred_textview_set_on_undo_point_changed(pTextEditor->pTextView, dred_text_editor_textview__on_undo_point_changed);
 
     // Initialize the styling.
@@ -353,6 +986,10 @@ void dred_text_editor_delete(dred_text_editor* pTextEditor)
         return;
     }
 
+    dred_text_editor__cancel_loading(pTextEditor);
+    dred_text_editor__end_line_indexing(pTextEditor);
+    dred_text_editor__end_highlighting(pTextEditor);
+
     dred_textview_uninit(pTextEditor->pTextView);
     drte_engine_uninit(&pTextEditor->engine);
 
@@ -478,6 +1115,25 @@ dtk_bool32 dred_text_editor_is_drag_and_drop_enabled(dred_text_editor* pTextEdit
 }
 
 
+void dred_text_editor_refresh_undo_memory_budget(dred_text_editor* pTextEditor)
+{
+    if (pTextEditor == NULL) {
+        return;
+    }
+
+    dred_context* pDred = dred_control_get_context(DRED_CONTROL(pTextEditor));
+    assert(pDred != NULL);
+
+    // The budget is set in megabytes. Anything less than 1 means there is no limit.
+    size_t budgetInBytes = 0;
+    if (pDred->config.textEditorUndoMemoryBudget > 0) {
+        budgetInBytes = (size_t)pDred->config.textEditorUndoMemoryBudget * 1024 * 1024;
+    }
+
+    drte_engine_set_undo_memory_budget(&pTextEditor->engine, budgetInBytes);
+}
+
+
 dtk_bool32 dred_text_editor_insert_text_at_cursors(dred_text_editor* pTextEditor, const char* text)
 {
     if (pTextEditor == NULL) {
@@ -497,6 +1153,8 @@ void dred_text_editor_refresh_styling(dred_text_editor* pTextEditor)
 
     float uiScale = dtk_control_get_scaling_factor(DTK_CONTROL(pTextEditor));
 
+    dred_highlighter_refresh_styling(&pTextEditor->highlighter, pDred);
+
     //dred_control_begin_dirty(DRED_CONTROL(pTextEditor));
     {
         dred_textview_set_font(pTextEditor->pTextView, &pDred->config.pTextEditorFont->fontDTK);
@@ -505,6 +1163,7 @@ void dred_text_editor_refresh_styling(dred_text_editor* pTextEditor)
         dred_textview_set_cursor_color(pTextEditor->pTextView, pDred->config.textEditorCursorColor);
         dred_textview_set_background_color(pTextEditor->pTextView, pDred->config.textEditorBGColor);
         dred_textview_set_selection_background_color(pTextEditor->pTextView, pDred->config.textEditorSelectionBGColor);
+        dred_textview_set_match_background_color(pTextEditor->pTextView, pDred->config.textEditorMatchBGColor);
         dred_textview_set_active_line_background_color(pTextEditor->pTextView, pDred->config.textEditorActiveLineColor);
         dred_textview_set_padding(pTextEditor->pTextView, 0);
         dred_textview_set_line_numbers_color(pTextEditor->pTextView, pDred->config.textEditorLineNumbersColor);
@@ -563,19 +1222,18 @@ void dred_text_editor_set_highlighter(dred_text_editor* pTextEditor, const char*
     dred_context* pDred = dred_control_get_context(DRED_CONTROL(pTextEditor));
     assert(pDred != NULL);
 
-    if (lang == NULL) {
-        drte_engine_set_highlighter(pEngine, NULL, NULL);
+    // The thread needs to be stopped before changing the highlighter since it may be using it.
+    dred_text_editor__end_highlighting(pTextEditor);
+
+    if (lang != NULL && strcmp(lang, "c") == 0) {
+        dred_highlighter_init_c(&pTextEditor->highlighter, pDred);
+        drte_engine_set_highlighter(pEngine, dred_highlighter_lex_line_c, &pTextEditor->highlighter);
+        dred_text_editor__refresh_highlighter_styles(pTextEditor);
+
+        // If the thread can't be started everything is lexed on demand instead.
+        dred_text_editor__begin_highlighting(pTextEditor);
     } else {
-        // Unfortunately highlighting is not quite ready for prime time.
         drte_engine_set_highlighter(pEngine, NULL, NULL);
-        (void)pDred;
-        (void)pTextEditor;
-#if 0
-        if (strcmp(lang, "c") == 0) {
-            dred_highlighter_init(&pTextEditor->highlighter, pDred, dred_textview_get_engine(pTextEditor->pTextView), g_KeywordsC, sizeof(g_KeywordsC) / sizeof(g_KeywordsC[0]));
-            drte_engine_set_highlighter(dred_textview_get_engine(pTextEditor->pTextView), pTextEditor->highlighter.onNextHighlight, &pTextEditor->highlighter);
-        }
-#endif
     }
 }
 
@@ -590,6 +1248,7 @@ void dred_text_editor_set_font(dred_text_editor* pTextEditor, dred_font* pFont)
 
     dred_textview_set_font(pTextEditor->pTextView, &pFont->fontDTK);
     dred_textview_set_scale(pTextEditor->pTextView, uiScale);
+    dred_text_editor__refresh_highlighter_styles(pTextEditor);
 }
 
 
@@ -650,6 +1309,9 @@ void dred_text_editor_goto_ratio(dred_text_editor* pTextEditor, size_t ratio)
         ratio = 100;
     }
 
+    // The total line count isn't known until every line has been indexed.
+    drte_engine_index_lines_to_line(&pTextEditor->engine, (size_t)-1);
+
     dred_text_editor_goto_line(pTextEditor, (size_t)(roundf(dred_textview_get_line_count(pTextEditor->pTextView) * (ratio/100.0f))));
 }
 
@@ -662,6 +1324,10 @@ void dred_text_editor_goto_line(dred_text_editor* pTextEditor, size_t lineNumber
     if (lineNumber == 0) {
         lineNumber = 1;
     }
+
+    // The line may not have been indexed yet.
+    drte_engine_index_lines_to_line(&pTextEditor->engine, lineNumber - 1);
+
     if (lineNumber > dred_textview_get_line_count(pTextEditor->pTextView)) {
         lineNumber = dred_textview_get_line_count(pTextEditor->pTextView);
     }
@@ -720,6 +1386,42 @@ dtk_bool32 dred_text_editor_find_and_replace_all(dred_text_editor* pTextEditor,
     return result;
 }
 
+dtk_bool32 dred_text_editor_find_and_select_next_regex(dred_text_editor* pTextEditor, const char* pattern)
+{
+    if (pTextEditor == NULL) {
+        return DTK_FALSE;
+    }
+
+    return dred_textview_find_and_select_next_regex(pTextEditor->pTextView, pattern);
+}
+
+dtk_bool32 dred_text_editor_find_and_replace_next_regex(dred_text_editor* pTextEditor, const char* pattern, const char* replacement)
+{
+    if (pTextEditor == NULL) {
+        return DTK_FALSE;
+    }
+
+    return dred_textview_find_and_replace_next_regex(pTextEditor->pTextView, pattern, replacement);
+}
+
+dtk_bool32 dred_text_editor_find_and_replace_all_regex(dred_text_editor* pTextEditor, const char* pattern, const char* replacement)
+{
+    if (pTextEditor == NULL) {
+        return DTK_FALSE;
+    }
+
+    return dred_textview_find_and_replace_all_regex(pTextEditor->pTextView, pattern, replacement);
+}
+
+dtk_bool32 dred_text_editor_get_match_info(dred_text_editor* pTextEditor, size_t* pMatchIndexOut, size_t* pMatchCountOut, dtk_bool32* pIsCompleteOut)
+{
+    if (pTextEditor == NULL) {
+        return DTK_FALSE;
+    }
+
+    return dred_textview_get_match_info(pTextEditor->pTextView, pMatchIndexOut, pMatchCountOut, pIsCompleteOut);
+}
+
 
 void dred_text_editor_set_text_scale(dred_text_editor* pTextEditor, float textScale)
 {
@@ -737,6 +1439,7 @@ void dred_text_editor_set_text_scale(dred_text_editor* pTextEditor, float textSc
     dred_textview_set_line_numbers_padding(pTextEditor->pTextView, pDred->config.textEditorLineNumbersPadding * uiScale * pTextEditor->textScale);
     dred_textview_set_font(pTextEditor->pTextView, &pDred->config.pTextEditorFont->fontDTK);
     dred_textview_set_scale(pTextEditor->pTextView, uiScale * pTextEditor->textScale);
+    dred_text_editor__refresh_highlighter_styles(pTextEditor);
     dred_textview_set_cursor_width(pTextEditor->pTextView, pDred->config.textEditorCursorWidth * uiScale * pTextEditor->textScale);
 }
 
@@ -17,8 +17,43 @@ struct dred_text_editor
     dred_textview textView;
     dred_textview* pTextView;
 
+    // The syntax highlighter. Only used when the language of the file is known.
+    dred_highlighter highlighter;
+
     unsigned int iBaseUndoPoint;    // Used to determine whether or no the file has been modified.
     float textScale;
+
+    // The job loading the file on the context's file loader, or NULL when the file isn't being loaded in the background.
+    dred_file_load_job* pLoadJob;
+
+    // The lines of memory mapped files are found on a background thread and handed to the engine from a timer on the main thread.
+    dtk_thread lineIndexingThread;
+    dtk_mutex lineIndexingLock;
+    dtk_timer lineIndexingTimer;
+    const char* pLineIndexingText;
+    size_t lineIndexingTextLength;
+    size_t lineIndexingStartOffset;
+    size_t* pIndexedLineOffsets;            // Lines found by the thread that have not yet been handed to the engine. Protected by lineIndexingLock.
+    size_t indexedLineOffsetCount;          // Protected by lineIndexingLock.
+    size_t indexedLineOffsetCapacity;       // Protected by lineIndexingLock.
+    size_t lineIndexingScannedLength;       // Protected by lineIndexingLock.
+    dtk_bool32 isLineIndexingCancelled;     // Protected by lineIndexingLock.
+    dtk_bool32 isLineIndexing;
+
+    // The lexer states of the highlighter are found on a background thread so painting never has to wait for the whole file to be
+    // lexed. Jobs are taken from the engine and their results handed back to it from a timer on the main thread.
+    dtk_thread highlightingThread;
+    dtk_mutex highlightingLock;
+    dtk_semaphore highlightingSemaphore;    // Released when a job has been queued or the thread needs to stop.
+    dtk_timer highlightingTimer;
+    drte_lexer_job highlightingJob;         // Only used by the thread while isHighlightingJobQueued is set.
+    char* pHighlightingText;                // The text of highlightingJob.
+    uint32_t* pHighlightingStates;          // The results of highlightingJob.
+    size_t highlightingStateCapacity;
+    dtk_bool32 isHighlightingJobQueued;     // Protected by highlightingLock.
+    dtk_bool32 isHighlightingJobDone;       // Protected by highlightingLock.
+    dtk_bool32 isHighlightingCancelled;     // Protected by highlightingLock.
+    dtk_bool32 isHighlighting;
 };
 
 
@@ -70,6 +105,10 @@ void dred_text_editor_disable_drag_and_drop(dred_text_editor* pTextEditor);
 dtk_bool32 dred_text_editor_is_drag_and_drop_enabled(dred_text_editor* pTextEditor);
 
 
+// Applies the undo memory budget from the config to the given text editor.
+void dred_text_editor_refresh_undo_memory_budget(dred_text_editor* pTextEditor);
+
+
 // Inserts text at every cursor.
 //
 // Returns whether or not the text was changed.
@@ -123,6 +162,15 @@ dtk_bool32 dred_text_editor_find_and_replace_next(dred_text_editor* pTextEditor,
 // Finds every occurance of the given string and replaces it with another.
 dtk_bool32 dred_text_editor_find_and_replace_all(dred_text_editor* pTextEditor, const char* text, const char* replacement);
 
+// The regular expression versions of the functions above. See drte_regex_init() for the supported syntax. "\0" to "\9" in the
+// replacement are replaced with the text of the respective capture group.
+dtk_bool32 dred_text_editor_find_and_select_next_regex(dred_text_editor* pTextEditor, const char* pattern);
+dtk_bool32 dred_text_editor_find_and_replace_next_regex(dred_text_editor* pTextEditor, const char* pattern, const char* replacement);
+dtk_bool32 dred_text_editor_find_and_replace_all_regex(dred_text_editor* pTextEditor, const char* pattern, const char* replacement);
+
+// Retrieves the position of the cursor amongst the highlighted occurances of the last searched text. See dred_textview_get_match_info().
+dtk_bool32 dred_text_editor_get_match_info(dred_text_editor* pTextEditor, size_t* pMatchIndexOut, size_t* pMatchCountOut, dtk_bool32* pIsCompleteOut);
+
 
 // Sets the scale of the internal text.
 void dred_text_editor_set_text_scale(dred_text_editor* pTextEditor, float textScale);
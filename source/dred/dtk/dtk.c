@@ -21,6 +21,7 @@
 #include <pwd.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #endif
 #ifdef DTK_GTK
     #include <gdk/gdk.h>
@@ -236,6 +237,52 @@ dtk_result dtk_handle_global_event(dtk_event* pEvent)
         onEventGlobal = dtk_default_event_handler;
     }
 
+    switch (pEvent->type)
+    {
+        case DTK_EVENT_MOUSE_MOVE:
+        case DTK_EVENT_MOUSE_BUTTON_DOWN:
+        case DTK_EVENT_MOUSE_BUTTON_UP:
+        case DTK_EVENT_MOUSE_BUTTON_DBLCLICK:
+        case DTK_EVENT_MOUSE_WHEEL:
+        case DTK_EVENT_KEY_DOWN:
+        case DTK_EVENT_KEY_UP:
+        case DTK_EVENT_PRINTABLE_KEY_DOWN:
+        {
+            // Only the first input event since the last paint is recorded so the latency reflects the longest wait.
+            if (pTK->pendingInputTime == 0) {
+                pTK->pendingInputTime = dtk_get_time_in_seconds();
+            }
+        } break;
+
+        case DTK_EVENT_PAINT:
+        {
+            double paintStartTime = dtk_get_time_in_seconds();
+            onEventGlobal(pEvent);
+            double paintEndTime = dtk_get_time_in_seconds();
+
+            dtk_frame_stats* pStats = &pTK->frameStats;
+            pStats->frameCount += 1;
+            pStats->lastPaintDuration = paintEndTime - paintStartTime;
+            pStats->totalPaintDuration += pStats->lastPaintDuration;
+            if (pStats->maxPaintDuration < pStats->lastPaintDuration) {
+                pStats->maxPaintDuration = pStats->lastPaintDuration;
+            }
+
+            if (pTK->pendingInputTime != 0) {
+                pStats->inputFrameCount += 1;
+                pStats->lastInputToPaintLatency = paintEndTime - pTK->pendingInputTime;
+                pStats->totalInputToPaintLatency += pStats->lastInputToPaintLatency;
+                if (pStats->maxInputToPaintLatency < pStats->lastInputToPaintLatency) {
+                    pStats->maxInputToPaintLatency = pStats->lastInputToPaintLatency;
+                }
+
+                pTK->pendingInputTime = 0;
+            }
+        } return DTK_SUCCESS;
+
+        default: break;
+    }
+
     onEventGlobal(pEvent);
     return DTK_SUCCESS;
 }
@@ -1228,6 +1275,51 @@ dtk_result dtk_post_paint_notification_event__gtk(dtk_context* pTK, dtk_window*
     return DTK_SUCCESS;
 }
 
+static gboolean dtk_frame_tick_cb__gtk(GtkWidget* pWidget, GdkFrameClock* pFrameClock, gpointer pUserData)
+{
+    (void)pWidget;
+    (void)pFrameClock;
+
+    dtk_window* pWindow = (dtk_window*)pUserData;
+    dtk_assert(pWindow != NULL);
+
+    dtk_context* pTK = DTK_CONTROL(pWindow)->pTK;
+    pWindow->gtk.frameTickCallbackID = 0;
+
+    // Everything that was invalidated since the last frame is drained in one go, including requests for other windows. We only
+    // need to queue the areas here because GTK will draw them in the paint phase of this same frame.
+    dtk_paint_queue_item item;
+    while (dtk_paint_queue_dequeue(&pTK->paintQueue, &item) == DTK_SUCCESS) {
+        for (dtk_uint32 iRect = 0; iRect < item.rectCount; ++iRect) {
+            dtk_rect rect = item.rects[iRect];
+            gtk_widget_queue_draw_area(GTK_WIDGET(item.pWindow->gtk.pClientArea), (gint)rect.left, (gint)rect.top, (gint)(rect.right - rect.left), (gint)(rect.bottom - rect.top));
+        }
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+dtk_result dtk_handle_paint_notification_event__gtk(dtk_context* pTK, dtk_window* pWindow)
+{
+    // A window that isn't mapped doesn't have a running frame clock so it would never tick. These are just redrawn straight away.
+    if (!gtk_widget_get_mapped(GTK_WIDGET(pWindow->gtk.pClientArea))) {
+        dtk_paint_queue_item item;
+        if (dtk_paint_queue_dequeue(&pTK->paintQueue, &item) != DTK_SUCCESS) {
+            return DTK_ERROR;
+        }
+
+        return dtk_window_immediate_redraw_rects(item.pWindow, item.rectCount, item.rects);
+    }
+
+    // The notification is posted with an idle priority so by the time we get here all pending input has been handled. If a tick
+    // is already scheduled it will pick up this paint request as well.
+    if (pWindow->gtk.frameTickCallbackID == 0) {
+        pWindow->gtk.frameTickCallbackID = gtk_widget_add_tick_callback(GTK_WIDGET(pWindow->gtk.pClientArea), dtk_frame_tick_cb__gtk, pWindow, NULL);
+    }
+
+    return DTK_SUCCESS;
+}
+
 
 dtk_result dtk_post_quit_event__gtk(dtk_context* pTK, int exitCode)
 {
@@ -1761,13 +1853,31 @@ dtk_result dtk_handle_paint_notification_event(dtk_context* pTK, dtk_window* pWi
 {
     if (pTK == NULL || pWindow == NULL) return DTK_INVALID_ARGS;
 
+#ifdef DTK_GTK
+    if (pTK->platform == dtk_platform_gtk) {
+        return dtk_handle_paint_notification_event__gtk(pTK, pWindow);
+    }
+#endif
+
     // All we do here is an immediate redraw of the window.
     dtk_paint_queue_item item;
     if (dtk_paint_queue_dequeue(&pTK->paintQueue, &item) != DTK_SUCCESS) {
         return DTK_ERROR;
     }
 
-    return dtk_window_immediate_redraw(item.pWindow, item.rect);
+    return dtk_window_immediate_redraw_rects(item.pWindow, item.rectCount, item.rects);
+}
+
+
+dtk_result dtk_get_frame_stats(dtk_context* pTK, dtk_frame_stats* pStats)
+{
+    if (pStats == NULL) return DTK_INVALID_ARGS;
+    dtk_zero_object(pStats);
+
+    if (pTK == NULL) return DTK_INVALID_ARGS;
+    *pStats = pTK->frameStats;
+
+    return DTK_SUCCESS;
 }
 
 
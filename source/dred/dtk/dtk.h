@@ -454,6 +454,20 @@ typedef struct
 } dtk_accelerator_gtk;
 #endif
 
+// Per-frame timing statistics. These are collected from every DTK_EVENT_PAINT event that passes through the global event
+// handler. All times are in seconds.
+typedef struct
+{
+    dtk_uint64 frameCount;                  // The number of paint events that have been handled.
+    double lastPaintDuration;               // How long the most recent paint took.
+    double maxPaintDuration;
+    double totalPaintDuration;              // Divide by frameCount to get the average.
+    dtk_uint64 inputFrameCount;             // The number of paints that followed at least one input event.
+    double lastInputToPaintLatency;         // The time between the first input event of a frame and the end of the paint that follows it.
+    double maxInputToPaintLatency;
+    double totalInputToPaintLatency;        // Divide by inputFrameCount to get the average.
+} dtk_frame_stats;
+
 // The main toolkit context.
 struct dtk_context
 {
@@ -473,6 +487,8 @@ struct dtk_context
     dtk_int32 lastMousePosY;
     void* pUserData;
     dtk_paint_queue paintQueue;
+    dtk_frame_stats frameStats;
+    double pendingInputTime;                    // The time of the first input event since the last paint, or 0 if there's been no input.
     dtk_font uiFont;
     dtk_font monospaceFont;
     dtk_bool32 isUIFontInitialized        : 1;
@@ -614,8 +630,14 @@ dtk_result dtk_handle_custom_event(dtk_context* pTK, dtk_control* pControl, dtk_
 dtk_result dtk_post_paint_notification_event(dtk_context* pTK, dtk_window* pWindow);
 
 // Handles a paint notification event.
+//
+// On GTK this does not paint straight away. Instead the paint is deferred to the next tick of the window's frame clock so
+// that all of the input that arrives within a display frame is handled before painting once.
 dtk_result dtk_handle_paint_notification_event(dtk_context* pTK, dtk_window* pWindow);
 
+// Retrieves the per-frame timing statistics.
+dtk_result dtk_get_frame_stats(dtk_context* pTK, dtk_frame_stats* pStats);
+
 // The default event handler.
 //
 // Applications should call this from their own global event handler.
@@ -29,6 +29,35 @@ void dtk__rgba8_bgra8_swap__premul_flip(const void* pSrc, void* pDst, unsigned i
     }
 }
 
+// Moves the rows and columns of a 32-bit image by the given offset. Pixels that are moved outside of the image are discarded
+// and the area that is uncovered is left unmodified. The order in which rows are moved is chosen so that overlapping rows are
+// never overwritten before they've been copied.
+void dtk__shift_image_data_32(void* pData, unsigned int width, unsigned int height, unsigned int stride, int offsetX, int offsetY)
+{
+    assert(pData != NULL);
+
+    int absOffsetX = (offsetX < 0) ? -offsetX : offsetX;
+    int absOffsetY = (offsetY < 0) ? -offsetY : offsetY;
+    if ((unsigned int)absOffsetX >= width || (unsigned int)absOffsetY >= height) {
+        return;
+    }
+
+    size_t bytesPerRow = (width - absOffsetX) * 4;
+    unsigned int srcCol = (offsetX < 0) ? absOffsetX : 0;
+    unsigned int dstCol = (offsetX < 0) ? 0 : absOffsetX;
+    unsigned int rowCount = height - absOffsetY;
+
+    for (unsigned int i = 0; i < rowCount; ++i) {
+        // Moving down means the bottom rows need to be moved first.
+        unsigned int dstRow = (offsetY > 0) ? (height - i - 1) : i;
+        unsigned int srcRow = (unsigned int)((int)dstRow - offsetY);
+
+        dtk_uint8* pDstRow = (dtk_uint8*)pData + (dstRow * stride) + (dstCol * 4);
+        dtk_uint8* pSrcRow = (dtk_uint8*)pData + (srcRow * stride) + (srcCol * 4);
+        memmove(pDstRow, pSrcRow, bytesPerRow);
+    }
+}
+
 // RGBA8 <-> BGRA8 swap with alpha pre-multiply.
 void dtk__rgba8_bgra8_swap__premul(const void* pSrc, void* pDst, unsigned int width, unsigned int height, unsigned int srcStride, unsigned int dstStride)
 {
@@ -162,6 +191,9 @@ dtk_subfont* dtk_font__acquire_subfont(dtk_font* pFont, float scale)
 
 dtk_result dtk_surface__push_saved_state(dtk_surface* pSurface, dtk_surface_saved_state state);
 dtk_result dtk_surface__pop_saved_state(dtk_surface* pSurface, dtk_surface_saved_state* pState);
+int dtk_text_batch__compare_colors(dtk_color a, dtk_color b);
+int dtk_text_batch__compare_runs(const dtk_text_run* pA, const dtk_text_run* pB);
+dtk_result dtk_text_batch__reserve_scratch(dtk_text_batch* pBatch, size_t sizeInBytes);
 
 #ifdef DTK_WIN32
 // Fonts
@@ -503,6 +535,16 @@ dtk_result dtk_surface_init_image__gdi(dtk_context* pTK, dtk_uint32 width, dtk_u
     // Flush GDI to let it know we are finished with the bitmap object's data.
     GdiFlush();
 
+    // The image gets it's own DC with the bitmap permanently selected into it so that it can be used as a render target.
+    pSurface->gdi.hDC = (dtk_handle)CreateCompatibleDC((HDC)pTK->win32.hGraphicsDC);
+    if (pSurface->gdi.hDC == NULL) {
+        DeleteObject(pSurface->gdi.hBitmap);
+        return DTK_ERROR;
+    }
+
+    SelectObject((HDC)pSurface->gdi.hDC, pSurface->gdi.hBitmap);
+    SetGraphicsMode((HDC)pSurface->gdi.hDC, GM_ADVANCED);    // <-- Needed for world transforms (rotate and scale).
+
     pSurface->backend = dtk_graphics_backend_gdi;
     return DTK_SUCCESS;
 }
@@ -512,6 +554,7 @@ dtk_result dtk_surface_uninit__gdi(dtk_surface* pSurface)
     (void)pSurface;
 
     if (pSurface->isImage) {
+        DeleteDC((HDC)pSurface->gdi.hDC);
         DeleteObject(pSurface->gdi.hBitmap);
     }
 
@@ -679,12 +722,25 @@ void dtk_surface_draw_text__gdi(dtk_surface* pSurface, dtk_font* pFont, float sc
     }
 }
 
+void dtk_surface_draw_text_batch__gdi(dtk_surface* pSurface, dtk_text_batch* pBatch)
+{
+    // GDI has no equivalent to glyph runs so this just saves the background of each run being drawn separately.
+    for (size_t iRect = 0; iRect < pBatch->rectCount; ++iRect) {
+        dtk_surface_draw_rect__gdi(pSurface, pBatch->pRects[iRect].rect, pBatch->pRects[iRect].color);
+    }
+
+    for (size_t iRun = 0; iRun < pBatch->runCount; ++iRun) {
+        dtk_text_run* pRun = &pBatch->pRuns[iRun];
+        dtk_surface_draw_text__gdi(pSurface, pRun->pFont, pRun->scale, pBatch->pText + pRun->textOffset, pRun->textLength, pRun->posX, pRun->posY, pRun->color, dtk_rgba(0, 0, 0, 0));
+    }
+}
+
 void dtk_surface_draw_surface__gdi(dtk_surface* pDstSurface, dtk_surface* pSrcSurface, dtk_draw_surface_args* pArgs)
 {
     HDC hDstDC = (HDC)pDstSurface->gdi.hDC;
     HDC hSrcDC = (HDC)pSrcSurface->gdi.hDC;
 
-    if (pSrcSurface->isImage) {
+    if (pSrcSurface->isImage && hSrcDC == NULL) {
         hSrcDC = (HDC)pDstSurface->pTK->win32.hGraphicsDC;
         SelectObject(hSrcDC, pSrcSurface->gdi.hBitmap);
     }
@@ -742,8 +798,10 @@ void dtk_surface_draw_surface__gdi(dtk_surface* pDstSurface, dtk_surface* pSrcSu
                         }
                     }
 
-                    SelectObject(hSrcDC, hTempBitmap);
+                    // The previous bitmap needs to be restored because image surfaces keep their bitmap selected into their own DC.
+                    HGDIOBJ hPrevBitmap = SelectObject(hSrcDC, hTempBitmap);
                     ((DTK_PFN_AlphaBlend)pSrcSurface->pTK->win32.AlphaBlend)(hIntermediateDC, 0, 0, (int)pArgs->srcWidth, (int)pArgs->srcHeight, hSrcDC, (int)pArgs->srcX, (int)pArgs->srcY, (int)pArgs->srcWidth, (int)pArgs->srcHeight, blend);
+                    SelectObject(hSrcDC, hPrevBitmap);
 
                     DeleteObject(hTempBitmap);
                 }
@@ -762,6 +820,20 @@ void dtk_surface_draw_surface__gdi(dtk_surface* pDstSurface, dtk_surface* pSrcSu
     // Flush GDI to let it know we are finished with the bitmap object's data.
     GdiFlush();
 }
+
+dtk_result dtk_surface_shift__gdi(dtk_surface* pSurface, dtk_int32 offsetX, dtk_int32 offsetY)
+{
+    if (pSurface->gdi.pBitmapData == NULL) {
+        return DTK_INVALID_ARGS;
+    }
+
+    // Any pending drawing operations need to be written to the bitmap before touching it's data directly. DIB sections are stored
+    // bottom-up which means the vertical offset needs to be flipped.
+    GdiFlush();
+    dtk__shift_image_data_32(pSurface->gdi.pBitmapData, pSurface->width, pSurface->height, pSurface->width*4, offsetX, -offsetY);
+
+    return DTK_SUCCESS;
+}
 #endif
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -854,6 +926,15 @@ dtk_result dtk_font__init_subfont__cairo(dtk_font* pFont, float scale, dtk_subfo
     pSubfont->cairo.metrics.spaceWidth = spaceMetrics.x_advance;
 
 
+    // Glyph advances are measured as they're needed.
+    for (int i = 0; i < 256; ++i) {
+        pSubfont->cairo.latin1Advances[i] = -1;
+    }
+
+    pSubfont->cairo.pGlyphs = NULL;
+    pSubfont->cairo.glyphCapacity = 0;
+    pSubfont->cairo.glyphCount = 0;
+
     return DTK_SUCCESS;
 }
 
@@ -864,10 +945,122 @@ dtk_result dtk_font__uninit_subfont__cairo(dtk_font* pFont, dtk_subfont* pSubfon
 
     (void)pFont;
     cairo_scaled_font_destroy((cairo_scaled_font_t*)pSubfont->cairo.pFont);
+
+    dtk_free(pSubfont->cairo.pGlyphs);
+    pSubfont->cairo.pGlyphs = NULL;
+    pSubfont->cairo.glyphCapacity = 0;
+    pSubfont->cairo.glyphCount = 0;
     
     return DTK_SUCCESS;
 }
 
+float dtk_font__measure_glyph__cairo(dtk_subfont* pSubfont, dtk_uint32 utf32, dtk_uint32* pGlyphIndex)
+{
+    *pGlyphIndex = 0;
+
+    char utf8[16];
+    size_t utf8len = dtk_utf32_to_utf8_ch(utf32, utf8, sizeof(utf8));
+    if (utf8len == 0) {
+        return 0;
+    }
+
+    cairo_glyph_t* pGlyphs = NULL;
+    int glyphCount = 0;
+    cairo_status_t result = cairo_scaled_font_text_to_glyphs((cairo_scaled_font_t*)pSubfont->cairo.pFont, 0, 0, utf8, (int)utf8len, &pGlyphs, &glyphCount, NULL, NULL, NULL);
+    if (result != CAIRO_STATUS_SUCCESS) {
+        return 0;
+    }
+
+    float advance = 0;
+    if (glyphCount > 0) {
+        cairo_text_extents_t glyphExtents;
+        cairo_scaled_font_glyph_extents((cairo_scaled_font_t*)pSubfont->cairo.pFont, pGlyphs, glyphCount, &glyphExtents);
+
+        *pGlyphIndex = (dtk_uint32)pGlyphs[0].index;
+        advance = (float)glyphExtents.x_advance;
+    }
+
+    cairo_glyph_free(pGlyphs);
+    return advance;
+}
+
+DTK_INLINE dtk_uint32 dtk_font__hash_glyph_slot__cairo(dtk_uint32 utf32, dtk_uint32 capacity)
+{
+    return (utf32 * 2654435761U) & (capacity - 1);
+}
+
+// Retrieves the horizontal advance of the given code point, measuring it with Cairo the first time it is seen. The index of the glyph is
+// returned in <pGlyphIndex> which can be null.
+float dtk_font__get_glyph__cairo(dtk_subfont* pSubfont, dtk_uint32 utf32, dtk_uint32* pGlyphIndex)
+{
+    dtk_assert(pSubfont != NULL);
+
+    if (utf32 < 256) {
+        float advance = pSubfont->cairo.latin1Advances[utf32];
+        if (advance < 0) {
+            advance = dtk_font__measure_glyph__cairo(pSubfont, utf32, &pSubfont->cairo.latin1GlyphIndices[utf32]);
+            pSubfont->cairo.latin1Advances[utf32] = advance;
+        }
+
+        if (pGlyphIndex) *pGlyphIndex = pSubfont->cairo.latin1GlyphIndices[utf32];
+        return advance;
+    }
+
+    dtk_uint32 capacity = pSubfont->cairo.glyphCapacity;
+    if (capacity > 0) {
+        for (dtk_uint32 iSlot = dtk_font__hash_glyph_slot__cairo(utf32, capacity); ; iSlot = (iSlot + 1) & (capacity - 1)) {
+            if (pSubfont->cairo.pGlyphs[iSlot].utf32 == utf32) {
+                if (pGlyphIndex) *pGlyphIndex = pSubfont->cairo.pGlyphs[iSlot].index;
+                return pSubfont->cairo.pGlyphs[iSlot].advance;
+            }
+            if (pSubfont->cairo.pGlyphs[iSlot].utf32 == 0) {
+                break;
+            }
+        }
+    }
+
+    dtk_uint32 glyphIndex;
+    float advance = dtk_font__measure_glyph__cairo(pSubfont, utf32, &glyphIndex);
+    if (pGlyphIndex) *pGlyphIndex = glyphIndex;
+
+    // The map is kept at most 3/4 full so probing always finds an empty slot.
+    if ((pSubfont->cairo.glyphCount + 1) * 4 > capacity * 3) {
+        dtk_uint32 newCapacity = (capacity == 0) ? 64 : capacity * 2;
+        dtk_cached_glyph* pNewGlyphs = (dtk_cached_glyph*)dtk_calloc(newCapacity, sizeof(*pNewGlyphs));
+        if (pNewGlyphs == NULL) {
+            return advance; // Not cached, but still correct.
+        }
+
+        for (dtk_uint32 iOldSlot = 0; iOldSlot < capacity; ++iOldSlot) {
+            if (pSubfont->cairo.pGlyphs[iOldSlot].utf32 != 0) {
+                dtk_uint32 iSlot = dtk_font__hash_glyph_slot__cairo(pSubfont->cairo.pGlyphs[iOldSlot].utf32, newCapacity);
+                while (pNewGlyphs[iSlot].utf32 != 0) {
+                    iSlot = (iSlot + 1) & (newCapacity - 1);
+                }
+
+                pNewGlyphs[iSlot] = pSubfont->cairo.pGlyphs[iOldSlot];
+            }
+        }
+
+        dtk_free(pSubfont->cairo.pGlyphs);
+        pSubfont->cairo.pGlyphs = pNewGlyphs;
+        pSubfont->cairo.glyphCapacity = newCapacity;
+        capacity = newCapacity;
+    }
+
+    dtk_uint32 iSlot = dtk_font__hash_glyph_slot__cairo(utf32, capacity);
+    while (pSubfont->cairo.pGlyphs[iSlot].utf32 != 0) {
+        iSlot = (iSlot + 1) & (capacity - 1);
+    }
+
+    pSubfont->cairo.pGlyphs[iSlot].utf32 = utf32;
+    pSubfont->cairo.pGlyphs[iSlot].index = glyphIndex;
+    pSubfont->cairo.pGlyphs[iSlot].advance = advance;
+    pSubfont->cairo.glyphCount += 1;
+
+    return advance;
+}
+
 dtk_result dtk_font_init__cairo(dtk_context* pTK, const char* family, float size, dtk_font_weight weight, dtk_font_slant slant, dtk_uint32 optionFlags, dtk_font* pFont)
 {
     cairo_font_slant_t cairoSlant = CAIRO_FONT_SLANT_NORMAL;
@@ -893,6 +1086,11 @@ dtk_result dtk_font_init__cairo(dtk_context* pTK, const char* family, float size
 
 dtk_result dtk_font_uninit__cairo(dtk_font* pFont)
 {
+    for (dtk_uint32 iSubfont = 0; iSubfont < pFont->cachedSubfontCount; ++iSubfont) {
+        dtk_font__uninit_subfont__cairo(pFont, &pFont->cachedSubfonts[iSubfont]);
+    }
+    pFont->cachedSubfontCount = 0;
+
     cairo_font_face_destroy((cairo_font_face_t*)pFont->cairo.pFace);
 
     return DTK_SUCCESS;
@@ -944,36 +1142,38 @@ dtk_result dtk_font_measure_string__cairo(dtk_font* pFont, float scale, const ch
         return DTK_ERROR;
     }
 
-    // Cairo expends null terminated strings, however the input string is not guaranteed to be null terminated.
-    char* textNT;
-    if (textSizeInBytes != (size_t)-1) {
-        textNT = (char*)dtk_malloc(textSizeInBytes + 1);
-        if (textNT == NULL) {
-            return DTK_ERROR;
-        }
-        memcpy(textNT, text, textSizeInBytes);
-        textNT[textSizeInBytes] = '\0';
-    } else {
-        textNT = (char*)text;
+    if (textSizeInBytes == (size_t)-1) {
+        textSizeInBytes = strlen(text);
     }
 
+    // This is called for every segment of every line that's drawn so it's done with the cached glyph advances rather than Cairo. ASCII
+    // characters are looked up directly without needing to be decoded.
+    double width = 0;
+    for (size_t iByte = 0; iByte < textSizeInBytes; ) {
+        unsigned char c = (unsigned char)text[iByte];
+        if (c < 0x80) {
+            float advance = pSubfont->cairo.latin1Advances[c];
+            if (advance < 0) {
+                advance = dtk_font__get_glyph__cairo(pSubfont, c, NULL);
+            }
 
-    cairo_text_extents_t textMetrics;
-    cairo_scaled_font_text_extents((cairo_scaled_font_t*)pSubfont->cairo.pFont, textNT, &textMetrics);
+            width += advance;
+            iByte += 1;
+        } else {
+            dtk_uint32 utf32;
+            iByte += dtk_utf8_to_utf32_ch(text + iByte, textSizeInBytes - iByte, &utf32);
+            width += dtk_font__get_glyph__cairo(pSubfont, utf32, NULL);
+        }
+    }
 
     if (pWidth) {
-        *pWidth = (dtk_int32)textMetrics.x_advance;
+        *pWidth = (dtk_int32)width;
     }
     if (pHeight) {
         //*pHeight = textMetrics.height;
         *pHeight = (dtk_int32)(pSubfont->cairo.metrics.ascent + pSubfont->cairo.metrics.descent);
     }
 
-
-    if (textNT != text) {
-        dtk_free(textNT);
-    }
-
     return DTK_SUCCESS;
 }
 
@@ -984,34 +1184,32 @@ dtk_result dtk_font_get_text_cursor_position_from_point__cairo(dtk_font* pFont,
         return DTK_ERROR;
     }
 
-    cairo_glyph_t* pGlyphs = NULL;
-    int glyphCount = 0;
-    cairo_status_t result = cairo_scaled_font_text_to_glyphs((cairo_scaled_font_t*)pSubfont->cairo.pFont, 0, 0, text, textSizeInBytes, &pGlyphs, &glyphCount, NULL, NULL, NULL);
-    if (result != CAIRO_STATUS_SUCCESS) {
-        return DTK_ERROR;
+    if (textSizeInBytes == (size_t)-1) {
+        textSizeInBytes = strlen(text);
     }
 
     float cursorPosX = 0;
-    int charIndex = 0;
+    size_t charIndex = 0;
 
-    // We just iterate over each glyph until we find the one sitting under <inputPosX>.
+    // We just iterate over each character until we find the one sitting under <inputPosX>.
     float runningPosX = 0;
-    for (int iGlyph = 0; iGlyph < glyphCount; ++iGlyph) {
-        cairo_text_extents_t glyphMetrics;
-        cairo_scaled_font_glyph_extents((cairo_scaled_font_t*)pSubfont->cairo.pFont, pGlyphs + iGlyph, 1, &glyphMetrics);
+    size_t iByte = 0;
+    for (size_t iChar = 0; iByte < textSizeInBytes; ++iChar) {
+        dtk_uint32 utf32;
+        iByte += dtk_utf8_to_utf32_ch(text + iByte, textSizeInBytes - iByte, &utf32);
 
         float glyphLeft  = runningPosX;
-        float glyphRight = glyphLeft + glyphMetrics.x_advance;
+        float glyphRight = glyphLeft + dtk_font__get_glyph__cairo(pSubfont, utf32, NULL);
 
         // Are we sitting on top of inputPosX?
         if (inputPosX >= glyphLeft && inputPosX <= glyphRight) {
             float glyphHalf = glyphLeft + ceilf(((glyphRight - glyphLeft) / 2.0f));
             if (inputPosX <= glyphHalf) {
                 cursorPosX = glyphLeft;
-                charIndex  = iGlyph;
+                charIndex  = iChar;
             } else {
                 cursorPosX = glyphRight;
-                charIndex  = iGlyph + 1;
+                charIndex  = iChar + 1;
             }
 
             break;
@@ -1019,19 +1217,17 @@ dtk_result dtk_font_get_text_cursor_position_from_point__cairo(dtk_font* pFont,
             // Have we moved past maxWidth?
             if (glyphRight > maxWidth) {
                 cursorPosX = maxWidth;
-                charIndex  = iGlyph;
+                charIndex  = iChar;
                 break;
             } else {
                 runningPosX = glyphRight;
 
                 cursorPosX = runningPosX;
-                charIndex  = iGlyph;
+                charIndex  = iChar;
             }
         }
     }
 
-    cairo_glyph_free(pGlyphs);
-
     if (pTextCursorPosX) *pTextCursorPosX = cursorPosX;
     if (pCharacterIndex) *pCharacterIndex = charIndex;
     return DTK_SUCCESS;
@@ -1044,29 +1240,17 @@ dtk_result dtk_font_get_text_cursor_position_from_char__cairo(dtk_font* pFont, f
         return DTK_ERROR;
     }
 
-    cairo_glyph_t* pGlyphs = NULL;
-    int glyphCount = 0;
-    cairo_status_t result = cairo_scaled_font_text_to_glyphs((cairo_scaled_font_t*)pSubfont->cairo.pFont, 0, 0, text, -1, &pGlyphs, &glyphCount, NULL, NULL, NULL);
-    if (result != CAIRO_STATUS_SUCCESS) {
-        return DTK_ERROR;
-    }
-
+    size_t textSizeInBytes = strlen(text);
     float cursorPosX = 0;
 
-    // We just iterate over each glyph until we find the one sitting under <inputPosX>.
-    for (int iGlyph = 0; iGlyph < glyphCount; ++iGlyph) {
-        if (iGlyph == (int)characterIndex) {
-            break;
-        }
-
-        cairo_text_extents_t glyphMetrics;
-        cairo_scaled_font_glyph_extents((cairo_scaled_font_t*)pSubfont->cairo.pFont, pGlyphs + iGlyph, 1, &glyphMetrics);
+    size_t iByte = 0;
+    for (size_t iChar = 0; iChar < characterIndex && iByte < textSizeInBytes; ++iChar) {
+        dtk_uint32 utf32;
+        iByte += dtk_utf8_to_utf32_ch(text + iByte, textSizeInBytes - iByte, &utf32);
 
-        cursorPosX += glyphMetrics.x_advance;
+        cursorPosX += dtk_font__get_glyph__cairo(pSubfont, utf32, NULL);
     }
 
-    cairo_glyph_free(pGlyphs);
-
     if (pTextCursorPosX) *pTextCursorPosX = cursorPosX;
     return DTK_SUCCESS;
 }
@@ -1096,20 +1280,23 @@ dtk_result dtk_surface_init_image__cairo(dtk_context* pTK, dtk_uint32 width, dtk
     // The image data needs to be converted from RGBA to ARGB for cairo.
     dtk_uint32 srcStrideInBytes = (dtk_uint32)cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, (int)width);
 
-    void* pImageDataARGB = dtk_malloc(srcStrideInBytes * height);
+    void* pImageDataARGB = dtk_calloc(srcStrideInBytes * height, 1);
     if (pImageDataARGB == NULL) {
         return DTK_OUT_OF_MEMORY;
     }
 
     // TODO: CAIRO_FORMAT_ARGB32 is in native endian, so may want to do a big-endian rgba8 -> argb8 swap.
-    dtk__rgba8_bgra8_swap__premul(pImageData, pImageDataARGB, width, height, strideInBytes, srcStrideInBytes);
+    if (pImageData != NULL) {
+        dtk__rgba8_bgra8_swap__premul(pImageData, pImageDataARGB, width, height, strideInBytes, srcStrideInBytes);
+    }
 
-    cairo_surface_t* pCairoSurface = cairo_image_surface_create_for_data((unsigned char*)pImageDataARGB, CAIRO_FORMAT_ARGB32, (int)width, (int)height, (int)width*4);
+    cairo_surface_t* pCairoSurface = cairo_image_surface_create_for_data((unsigned char*)pImageDataARGB, CAIRO_FORMAT_ARGB32, (int)width, (int)height, (int)srcStrideInBytes);
     if (pCairoSurface == NULL) {
         dtk_free(pImageDataARGB);
         return DTK_ERROR;
     }
 
+    pSurface->backend = dtk_graphics_backend_cairo;
     pSurface->cairo.pSurface = (dtk_ptr)pCairoSurface;
     pSurface->cairo.pContext = (dtk_ptr)cairo_create(pCairoSurface);
     pSurface->cairo.pImageData = pImageDataARGB;
@@ -1261,6 +1448,77 @@ void dtk_surface_draw_text__cairo(dtk_surface* pSurface, dtk_font* pFont, float
     }
 }
 
+void dtk_surface_draw_text_batch__cairo(dtk_surface* pSurface, dtk_text_batch* pBatch)
+{
+    cairo_t* cr = (cairo_t*)pSurface->cairo.pContext;
+
+    // Backgrounds. These have been sorted by color so each color is filled in one go.
+    for (size_t iRect = 0; iRect < pBatch->rectCount; ) {
+        dtk_color color = pBatch->pRects[iRect].color;
+        cairo_set_source_rgba(cr, color.r / 255.0, color.g / 255.0, color.b / 255.0, color.a / 255.0);
+
+        do {
+            dtk_rect rect = pBatch->pRects[iRect].rect;
+            cairo_rectangle(cr, rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top);
+            iRect += 1;
+        } while (iRect < pBatch->rectCount && dtk_text_batch__compare_colors(pBatch->pRects[iRect].color, color) == 0);
+
+        cairo_fill(cr);
+    }
+
+    // Text. Runs have been sorted by font and color so that each combination can be drawn as a single glyph run.
+    for (size_t iRun = 0; iRun < pBatch->runCount; ) {
+        dtk_text_run* pFirstRun = &pBatch->pRuns[iRun];
+
+        size_t iRunEnd = iRun;
+        size_t textLength = 0;
+        while (iRunEnd < pBatch->runCount && dtk_text_batch__compare_runs(&pBatch->pRuns[iRunEnd], pFirstRun) == 0) {
+            textLength += pBatch->pRuns[iRunEnd].textLength;
+            iRunEnd += 1;
+        }
+
+        // There's never more glyphs than there are bytes.
+        dtk_subfont* pSubfont = dtk_font__acquire_subfont(pFirstRun->pFont, pFirstRun->scale);
+        if (pSubfont != NULL && dtk_text_batch__reserve_scratch(pBatch, textLength * sizeof(cairo_glyph_t)) == DTK_SUCCESS) {
+            cairo_glyph_t* pGlyphs = (cairo_glyph_t*)pBatch->pScratch;
+            int glyphCount = 0;
+
+            for (size_t iGroupRun = iRun; iGroupRun < iRunEnd; ++iGroupRun) {
+                dtk_text_run* pRun = &pBatch->pRuns[iGroupRun];
+                const char* text = pBatch->pText + pRun->textOffset;
+
+                double penPosX = pRun->posX;
+                double penPosY = pRun->posY + pSubfont->cairo.metrics.ascent;
+                for (size_t iByte = 0; iByte < pRun->textLength; ) {
+                    dtk_uint32 utf32;
+                    iByte += dtk_utf8_to_utf32_ch(text + iByte, pRun->textLength - iByte, &utf32);
+
+                    dtk_uint32 glyphIndex;
+                    float advance = dtk_font__get_glyph__cairo(pSubfont, utf32, &glyphIndex);
+
+                    // Spaces are common in source code and have nothing to draw.
+                    if (utf32 != ' ') {
+                        pGlyphs[glyphCount].index = glyphIndex;
+                        pGlyphs[glyphCount].x = penPosX;
+                        pGlyphs[glyphCount].y = penPosY;
+                        glyphCount += 1;
+                    }
+
+                    penPosX += advance;
+                }
+            }
+
+            if (glyphCount > 0) {
+                cairo_set_scaled_font(cr, (cairo_scaled_font_t*)pSubfont->cairo.pFont);
+                cairo_set_source_rgba(cr, pFirstRun->color.r / 255.0, pFirstRun->color.g / 255.0, pFirstRun->color.b / 255.0, pFirstRun->color.a / 255.0);
+                cairo_show_glyphs(cr, pGlyphs, glyphCount);
+            }
+        }
+
+        iRun = iRunEnd;
+    }
+}
+
 void dtk_surface_draw_surface__cairo(dtk_surface* pSurface, dtk_surface* pSrcSurface, dtk_draw_surface_args* pArgs)
 {
     cairo_t* cr = (cairo_t*)pSurface->cairo.pContext;
@@ -1277,10 +1535,12 @@ void dtk_surface_draw_surface__cairo(dtk_surface* pSurface, dtk_surface* pSrcSur
 
 #if 1
     if (pArgs->foregroundTint.r == 255 && pArgs->foregroundTint.g == 255 && pArgs->foregroundTint.b == 255 && pArgs->foregroundTint.a == 255) {
-        cairo_scale(cr, pArgs->dstWidth / pArgs->srcWidth, pArgs->dstHeight / pArgs->srcHeight);
-        cairo_set_source_surface(cr, (cairo_surface_t*)pSrcSurface->cairo.pSurface, pArgs->srcX, pArgs->srcY);
+        // Only the source rectangle is drawn so that a part of a larger image, such as an atlas, can be drawn by itself.
+        cairo_scale(cr, (double)pArgs->dstWidth / pArgs->srcWidth, (double)pArgs->dstHeight / pArgs->srcHeight);
+        cairo_set_source_surface(cr, (cairo_surface_t*)pSrcSurface->cairo.pSurface, -pArgs->srcX, -pArgs->srcY);
         cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_NEAREST);
-        cairo_paint(cr);
+        cairo_rectangle(cr, 0, 0, pArgs->srcWidth, pArgs->srcHeight);
+        cairo_fill(cr);
     } else {
         // Slower path. The image needs to be tinted. We create a temporary image for this.
         // NOTE: This is incorrect. It's just a temporary solution until I figure out a better way.
@@ -1320,6 +1580,20 @@ void dtk_surface_draw_surface__cairo(dtk_surface* pSurface, dtk_surface* pSrcSur
 
     cairo_restore(cr);
 }
+
+dtk_result dtk_surface_shift__cairo(dtk_surface* pSurface, dtk_int32 offsetX, dtk_int32 offsetY)
+{
+    if (pSurface->cairo.pImageData == NULL) {
+        return DTK_INVALID_ARGS;
+    }
+
+    cairo_surface_t* pCairoSurface = (cairo_surface_t*)pSurface->cairo.pSurface;
+    cairo_surface_flush(pCairoSurface);
+    dtk__shift_image_data_32(pSurface->cairo.pImageData, pSurface->width, pSurface->height, (unsigned int)cairo_image_surface_get_stride(pCairoSurface), offsetX, offsetY);
+    cairo_surface_mark_dirty(pCairoSurface);
+
+    return DTK_SUCCESS;
+}
 #endif
 
 
@@ -1843,6 +2117,243 @@ void dtk_surface_draw_surface(dtk_surface* pSurface, dtk_surface* pSrcSurface, d
 #endif
 }
 
+dtk_result dtk_surface_shift(dtk_surface* pSurface, dtk_int32 offsetX, dtk_int32 offsetY)
+{
+    if (pSurface == NULL || !pSurface->isImage) return DTK_INVALID_ARGS;
+
+    if (offsetX == 0 && offsetY == 0) {
+        return DTK_SUCCESS;
+    }
+
+    dtk_result result = DTK_NO_BACKEND;
+#ifdef DTK_WIN32
+    if (pSurface->backend == dtk_graphics_backend_gdi) {
+        result = dtk_surface_shift__gdi(pSurface, offsetX, offsetY);
+    }
+#endif
+#ifdef DTK_GTK
+    if (pSurface->backend == dtk_graphics_backend_cairo) {
+        result = dtk_surface_shift__cairo(pSurface, offsetX, offsetY);
+    }
+#endif
+
+    return result;
+}
+
+
+// Text Batches
+// ============
+int dtk_text_batch__compare_colors(dtk_color a, dtk_color b)
+{
+    dtk_uint32 a32 = ((dtk_uint32)a.r << 24) | ((dtk_uint32)a.g << 16) | ((dtk_uint32)a.b << 8) | a.a;
+    dtk_uint32 b32 = ((dtk_uint32)b.r << 24) | ((dtk_uint32)b.g << 16) | ((dtk_uint32)b.b << 8) | b.a;
+    return (a32 < b32) ? -1 : ((a32 > b32) ? 1 : 0);
+}
+
+// Orders runs by font, scale and then color. The position of the run is not taken into account.
+int dtk_text_batch__compare_runs(const dtk_text_run* pA, const dtk_text_run* pB)
+{
+    if (pA->pFont != pB->pFont) {
+        return (pA->pFont < pB->pFont) ? -1 : 1;
+    }
+    if (pA->scale != pB->scale) {
+        return (pA->scale < pB->scale) ? -1 : 1;
+    }
+
+    return dtk_text_batch__compare_colors(pA->color, pB->color);
+}
+
+int dtk_text_batch__qsort_runs(const void* pA, const void* pB)
+{
+    return dtk_text_batch__compare_runs((const dtk_text_run*)pA, (const dtk_text_run*)pB);
+}
+
+int dtk_text_batch__qsort_rects(const void* pA, const void* pB)
+{
+    return dtk_text_batch__compare_colors(((const dtk_text_batch_rect*)pA)->color, ((const dtk_text_batch_rect*)pB)->color);
+}
+
+dtk_result dtk_text_batch__reserve_scratch(dtk_text_batch* pBatch, size_t sizeInBytes)
+{
+    dtk_assert(pBatch != NULL);
+
+    if (sizeInBytes <= pBatch->scratchSize) {
+        return DTK_SUCCESS;
+    }
+
+    size_t newScratchSize = (pBatch->scratchSize == 0) ? 4096 : pBatch->scratchSize * 2;
+    while (newScratchSize < sizeInBytes) {
+        newScratchSize *= 2;
+    }
+
+    void* pNewScratch = dtk_malloc(newScratchSize);
+    if (pNewScratch == NULL) {
+        return DTK_OUT_OF_MEMORY;
+    }
+
+    dtk_free(pBatch->pScratch);
+    pBatch->pScratch = pNewScratch;
+    pBatch->scratchSize = newScratchSize;
+
+    return DTK_SUCCESS;
+}
+
+dtk_result dtk_text_batch_init(dtk_text_batch* pBatch)
+{
+    if (pBatch == NULL) return DTK_INVALID_ARGS;
+    dtk_zero_object(pBatch);
+
+    return DTK_SUCCESS;
+}
+
+dtk_result dtk_text_batch_uninit(dtk_text_batch* pBatch)
+{
+    if (pBatch == NULL) return DTK_INVALID_ARGS;
+
+    dtk_free(pBatch->pRuns);
+    dtk_free(pBatch->pRects);
+    dtk_free(pBatch->pText);
+    dtk_free(pBatch->pScratch);
+    dtk_zero_object(pBatch);
+
+    return DTK_SUCCESS;
+}
+
+void dtk_text_batch_clear(dtk_text_batch* pBatch)
+{
+    if (pBatch == NULL) return;
+
+    pBatch->runCount = 0;
+    pBatch->rectCount = 0;
+    pBatch->textLength = 0;
+}
+
+dtk_result dtk_text_batch_add_rect(dtk_text_batch* pBatch, dtk_rect rect, dtk_color color)
+{
+    if (pBatch == NULL) return DTK_INVALID_ARGS;
+
+    if (rect.right <= rect.left || rect.bottom <= rect.top || color.a == 0) {
+        return DTK_SUCCESS; // Nothing to draw.
+    }
+
+    // Segments of a line are added from left to right which makes it common for a rectangle to continue on from the previous one.
+    if (pBatch->rectCount > 0) {
+        dtk_text_batch_rect* pPrevRect = &pBatch->pRects[pBatch->rectCount-1];
+        if (pPrevRect->rect.right == rect.left && pPrevRect->rect.top == rect.top && pPrevRect->rect.bottom == rect.bottom && dtk_text_batch__compare_colors(pPrevRect->color, color) == 0) {
+            pPrevRect->rect.right = rect.right;
+            return DTK_SUCCESS;
+        }
+    }
+
+    if (pBatch->rectCount == pBatch->rectCapacity) {
+        size_t newRectCapacity = (pBatch->rectCapacity == 0) ? 64 : pBatch->rectCapacity * 2;
+        dtk_text_batch_rect* pNewRects = (dtk_text_batch_rect*)dtk_realloc(pBatch->pRects, newRectCapacity * sizeof(*pNewRects));
+        if (pNewRects == NULL) {
+            return DTK_OUT_OF_MEMORY;
+        }
+
+        pBatch->pRects = pNewRects;
+        pBatch->rectCapacity = newRectCapacity;
+    }
+
+    pBatch->pRects[pBatch->rectCount].rect = rect;
+    pBatch->pRects[pBatch->rectCount].color = color;
+    pBatch->rectCount += 1;
+
+    return DTK_SUCCESS;
+}
+
+dtk_result dtk_text_batch_add_text(dtk_text_batch* pBatch, dtk_font* pFont, float scale, const char* text, size_t textSizeInBytes, dtk_int32 posX, dtk_int32 posY, dtk_color fgColor, dtk_color bgColor)
+{
+    if (pBatch == NULL || pFont == NULL || text == NULL) return DTK_INVALID_ARGS;
+
+    if (textSizeInBytes == (size_t)-1) {
+        textSizeInBytes = strlen(text);
+    }
+
+    // The background is the same size as what dtk_surface_draw_text() would draw.
+    if (bgColor.a != 0) {
+        dtk_int32 textWidth;
+        dtk_int32 textHeight;
+        dtk_result result = dtk_font_measure_string(pFont, scale, text, textSizeInBytes, &textWidth, &textHeight);
+        if (result != DTK_SUCCESS) {
+            return result;
+        }
+
+        result = dtk_text_batch_add_rect(pBatch, dtk_rect_init(posX, posY, posX + textWidth, posY + textHeight), bgColor);
+        if (result != DTK_SUCCESS) {
+            return result;
+        }
+    }
+
+    if (textSizeInBytes == 0 || fgColor.a == 0) {
+        return DTK_SUCCESS;
+    }
+
+    if (pBatch->runCount == pBatch->runCapacity) {
+        size_t newRunCapacity = (pBatch->runCapacity == 0) ? 64 : pBatch->runCapacity * 2;
+        dtk_text_run* pNewRuns = (dtk_text_run*)dtk_realloc(pBatch->pRuns, newRunCapacity * sizeof(*pNewRuns));
+        if (pNewRuns == NULL) {
+            return DTK_OUT_OF_MEMORY;
+        }
+
+        pBatch->pRuns = pNewRuns;
+        pBatch->runCapacity = newRunCapacity;
+    }
+
+    if (pBatch->textLength + textSizeInBytes > pBatch->textCapacity) {
+        size_t newTextCapacity = (pBatch->textCapacity == 0) ? 4096 : pBatch->textCapacity * 2;
+        while (newTextCapacity < pBatch->textLength + textSizeInBytes) {
+            newTextCapacity *= 2;
+        }
+
+        char* pNewText = (char*)dtk_realloc(pBatch->pText, newTextCapacity);
+        if (pNewText == NULL) {
+            return DTK_OUT_OF_MEMORY;
+        }
+
+        pBatch->pText = pNewText;
+        pBatch->textCapacity = newTextCapacity;
+    }
+
+    memcpy(pBatch->pText + pBatch->textLength, text, textSizeInBytes);
+
+    dtk_text_run* pRun = &pBatch->pRuns[pBatch->runCount];
+    pRun->pFont = pFont;
+    pRun->scale = scale;
+    pRun->textOffset = pBatch->textLength;
+    pRun->textLength = textSizeInBytes;
+    pRun->posX = posX;
+    pRun->posY = posY;
+    pRun->color = fgColor;
+
+    pBatch->runCount += 1;
+    pBatch->textLength += textSizeInBytes;
+
+    return DTK_SUCCESS;
+}
+
+void dtk_surface_draw_text_batch(dtk_surface* pSurface, dtk_text_batch* pBatch)
+{
+    if (pSurface == NULL || pBatch == NULL) return;
+
+    // Grouping by font and color is what allows backends to draw each group with a single call. The order doesn't otherwise matter
+    // because nothing in a batch overlaps.
+    qsort(pBatch->pRects, pBatch->rectCount, sizeof(*pBatch->pRects), dtk_text_batch__qsort_rects);
+    qsort(pBatch->pRuns, pBatch->runCount, sizeof(*pBatch->pRuns), dtk_text_batch__qsort_runs);
+
+#ifdef DTK_WIN32
+    if (pSurface->backend == dtk_graphics_backend_gdi) {
+        dtk_surface_draw_text_batch__gdi(pSurface, pBatch);
+    }
+#endif
+#ifdef DTK_GTK
+    if (pSurface->backend == dtk_graphics_backend_cairo) {
+        dtk_surface_draw_text_batch__cairo(pSurface, pBatch);
+    }
+#endif
+}
+
 
 dtk_result dtk_surface__push_saved_state(dtk_surface* pSurface, dtk_surface_saved_state state)
 {
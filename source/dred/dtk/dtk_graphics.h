@@ -118,6 +118,13 @@ typedef struct
     };
 } dtk_surface_saved_state;
 
+typedef struct
+{
+    dtk_uint32 utf32;   // 0 for empty slots.
+    dtk_uint32 index;   // The backend's index of the glyph.
+    float advance;
+} dtk_cached_glyph;
+
 typedef struct
 {
     dtk_int32 sizeInTens;
@@ -136,6 +143,14 @@ typedef struct
         {
             /*cairo_scaled_font_t**/ dtk_ptr pFont;
             dtk_font_metrics metrics;   // We cache font metrics on the Cairo backend for efficiency.
+
+            // Glyphs are cached so strings can be measured and drawn without going through Cairo's text APIs. Code points below 256 are
+            // looked up directly and everything else goes through an open addressed hash map which is grown as new code points are found.
+            float latin1Advances[256];  // Negative until the glyph has been measured.
+            dtk_uint32 latin1GlyphIndices[256];
+            dtk_cached_glyph* pGlyphs;
+            dtk_uint32 glyphCapacity;   // Always a power of 2.
+            dtk_uint32 glyphCount;
         } cairo;
 #endif
 #ifdef DTK_X11
@@ -280,7 +295,8 @@ dtk_result dtk_surface_init_transient_cairo(dtk_context* pTK, dtk_ptr pCairoCont
 
 // Initializes a surface that's used as an image.
 //
-// Currently, the image data must be in simple 32-bit RGBA format (8-bits per component).
+// Currently, the image data must be in simple 32-bit RGBA format (8-bits per component). When pImageData is NULL the image will
+// be initialized to transparent black, which is useful for images that are going to be drawn to.
 dtk_result dtk_surface_init_image(dtk_context* pTK, dtk_uint32 width, dtk_uint32 height, dtk_uint32 strideInBytes, const void* pImageData, dtk_surface* pSurface);
 
 // Uninitializes a surface.
@@ -346,4 +362,67 @@ typedef struct
 } dtk_draw_surface_args;
 
 // Draws an image.
-void dtk_surface_draw_surface(dtk_surface* pSurface, dtk_surface* pSrcSurface, dtk_draw_surface_args* pArgs);
\ No newline at end of file
+void dtk_surface_draw_surface(dtk_surface* pSurface, dtk_surface* pSrcSurface, dtk_draw_surface_args* pArgs);
+
+// Moves the contents of an image surface by the given number of pixels.
+//
+// Pixels that are moved outside of the surface are lost and the area that is uncovered keeps it's old contents. This is intended
+// to be used for scrolling where only the uncovered area needs to be redrawn.
+dtk_result dtk_surface_shift(dtk_surface* pSurface, dtk_int32 offsetX, dtk_int32 offsetY);
+
+// Text Batches
+// ============
+//
+// A text batch collects runs of text and background rectangles so they can be drawn with far fewer calls into the graphics backend than
+// drawing them one at a time. On the Cairo backend each combination of font and color is drawn as a single glyph run and the backgrounds
+// of each color with a single fill. Every background is drawn before any text which means runs and rectangles should not overlap.
+typedef struct
+{
+    dtk_font* pFont;
+    float scale;
+    size_t textOffset;      // The offset of the run's text in the batch's text buffer.
+    size_t textLength;
+    dtk_int32 posX;
+    dtk_int32 posY;
+    dtk_color color;
+} dtk_text_run;
+
+typedef struct
+{
+    dtk_rect rect;
+    dtk_color color;
+} dtk_text_batch_rect;
+
+typedef struct
+{
+    dtk_text_run* pRuns;
+    size_t runCount;
+    size_t runCapacity;
+    dtk_text_batch_rect* pRects;
+    size_t rectCount;
+    size_t rectCapacity;
+    char* pText;            // The text of every run is copied here so it need only be valid until it has been added.
+    size_t textLength;
+    size_t textCapacity;
+    void* pScratch;         // Used by backends while drawing. This is kept between draws so that drawing doesn't need to allocate.
+    size_t scratchSize;
+} dtk_text_batch;
+
+// Initializes an empty text batch.
+dtk_result dtk_text_batch_init(dtk_text_batch* pBatch);
+
+// Uninitializes a text batch.
+dtk_result dtk_text_batch_uninit(dtk_text_batch* pBatch);
+
+// Removes every run and rectangle from the batch without releasing it's memory.
+void dtk_text_batch_clear(dtk_text_batch* pBatch);
+
+// Adds a rectangle to the batch. Rectangles that continue on from the previous one with the same color are merged.
+dtk_result dtk_text_batch_add_rect(dtk_text_batch* pBatch, dtk_rect rect, dtk_color color);
+
+// Adds a run of text to the batch. This is the batched equivalent of dtk_surface_draw_text(). The background is not drawn when
+// bgColor is fully transparent.
+dtk_result dtk_text_batch_add_text(dtk_text_batch* pBatch, dtk_font* pFont, float scale, const char* text, size_t textSizeInBytes, dtk_int32 posX, dtk_int32 posY, dtk_color fgColor, dtk_color bgColor);
+
+// Draws the contents of a text batch. The batch is left unchanged except for the order of it's runs and rectangles.
+void dtk_surface_draw_text_batch(dtk_surface* pSurface, dtk_text_batch* pBatch);
@@ -260,6 +260,116 @@ dtk_result dtk_open_and_read_text_file(const char* filePath, size_t* pFileSizeOu
     return DTK_SUCCESS;
 }
 
+dtk_result dtk_map_file(const char* filePath, dtk_mapped_file* pMappedFile)
+{
+    if (pMappedFile == NULL) return DTK_INVALID_ARGS;
+    dtk_zero_object(pMappedFile);
+
+    if (filePath == NULL) return DTK_INVALID_ARGS;
+
+#ifdef DTK_WIN32
+    // FILE_SHARE_WRITE is needed to be able to map files that are already open for writing by another program.
+    HANDLE hFile = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return DTK_FAILED_TO_OPEN_FILE;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize)) {
+        CloseHandle(hFile);
+        return dtk_win32_error_to_result(GetLastError());
+    }
+
+    if ((dtk_uint64)fileSize.QuadPart > SIZE_MAX) {
+        CloseHandle(hFile);
+        return DTK_FILE_TOO_BIG;
+    }
+
+    // Empty files cannot be mapped.
+    if (fileSize.QuadPart == 0) {
+        CloseHandle(hFile);
+        return DTK_SUCCESS;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMapping == NULL) {
+        CloseHandle(hFile);
+        return dtk_win32_error_to_result(GetLastError());
+    }
+
+    void* pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (pData == NULL) {
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return dtk_win32_error_to_result(GetLastError());
+    }
+
+    pMappedFile->hFile = (dtk_handle)hFile;
+    pMappedFile->hMapping = (dtk_handle)hMapping;
+    pMappedFile->pData = pData;
+    pMappedFile->dataSize = (size_t)fileSize.QuadPart;
+#else
+    int fd = open(filePath, O_RDONLY);
+    if (fd == -1) {
+        return DTK_FAILED_TO_OPEN_FILE;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return dtk_errno_to_result(errno);
+    }
+
+    // Pipes and devices can't be mapped.
+    if (!S_ISREG(info.st_mode)) {
+        close(fd);
+        return DTK_INVALID_ARGS;
+    }
+
+    if ((dtk_uint64)info.st_size > SIZE_MAX) {
+        close(fd);
+        return DTK_FILE_TOO_BIG;
+    }
+
+    // Empty files cannot be mapped.
+    if (info.st_size == 0) {
+        close(fd);
+        return DTK_SUCCESS;
+    }
+
+    void* pData = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // <-- The mapping stays valid after the descriptor is closed.
+
+    if (pData == MAP_FAILED) {
+        return dtk_errno_to_result(errno);
+    }
+
+    pMappedFile->pData = pData;
+    pMappedFile->dataSize = (size_t)info.st_size;
+#endif
+
+    return DTK_SUCCESS;
+}
+
+void dtk_unmap_file(dtk_mapped_file* pMappedFile)
+{
+    if (pMappedFile == NULL) return;
+
+#ifdef DTK_WIN32
+    if (pMappedFile->pData != NULL) {
+        UnmapViewOfFile(pMappedFile->pData);
+        CloseHandle((HANDLE)pMappedFile->hMapping);
+        CloseHandle((HANDLE)pMappedFile->hFile);
+    }
+#else
+    if (pMappedFile->pData != NULL) {
+        munmap((void*)pMappedFile->pData, pMappedFile->dataSize);
+    }
+#endif
+
+    dtk_zero_object(pMappedFile);
+}
+
 dtk_result dtk_open_and_write_file(const char* filePath, const void* pData, size_t dataSize)
 {
     if (filePath == NULL) {
@@ -435,6 +545,36 @@ dtk_uint64 dtk_get_file_modified_time(const char* filePath)
 #endif
 }
 
+dtk_uint64 dtk_get_file_size(const char* filePath)
+{
+    if (filePath == NULL || filePath[0] == '\0') {
+        return 0;
+    }
+
+#if _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(filePath, GetFileExInfoStandard, &attributes)) {
+        return 0;
+    }
+
+    if ((attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+        return 0;
+    }
+
+    ULARGE_INTEGER result;
+    result.HighPart = attributes.nFileSizeHigh;
+    result.LowPart = attributes.nFileSizeLow;
+    return result.QuadPart;
+#else
+    struct stat info;
+    if (stat(filePath, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return 0;
+    }
+
+    return (dtk_uint64)info.st_size;
+#endif
+}
+
 
 dtk_result dtk_delete_file(const char* filePath)
 {
@@ -13,6 +13,31 @@ dtk_result dtk_open_and_read_file(const char* filePath, size_t* pFileSizeOut, vo
 // returned file size is the length of the string not including the null terminator.
 dtk_result dtk_open_and_read_text_file(const char* filePath, size_t* pFileSizeOut, char** ppFileData);
 
+// A read-only memory mapping of a file. See dtk_map_file().
+typedef struct
+{
+    const void* pData;
+    size_t dataSize;
+#ifdef DTK_WIN32
+    dtk_handle hFile;
+    dtk_handle hMapping;
+#endif
+} dtk_mapped_file;
+
+// Maps the given file into memory for reading. Unmap with dtk_unmap_file(). Nothing is read until the data is accessed, and then
+// only the pages that are actually touched are loaded, which makes this much faster than reading the file for very large files.
+//
+// Mapping an empty file will succeed, but pData will be NULL.
+//
+// The contents of the mapping are not guaranteed to stay the same if the file is changed by something else while it's mapped. On
+// POSIX platforms, accessing the part of a mapping past the end of a file that has since been truncated raises SIGBUS.
+//
+// Only regular files can be mapped. Callers should be prepared to fall back to reading the file when mapping fails.
+dtk_result dtk_map_file(const char* filePath, dtk_mapped_file* pMappedFile);
+
+// Unmaps a file that was mapped with dtk_map_file().
+void dtk_unmap_file(dtk_mapped_file* pMappedFile);
+
 // Creates a new file with the given data.
 dtk_result dtk_open_and_write_file(const char* filePath, const void* pData, size_t dataSize);
 
@@ -46,6 +71,10 @@ dtk_bool32 dtk_is_file_read_only(const char* filePath);
 // Retrieves the last modified time of the file at the given path.
 dtk_uint64 dtk_get_file_modified_time(const char* filePath);
 
+// Retrieves the size of the file at the given path without opening it. Returns 0 if the size can't be retrieved or the path isn't
+// a regular file, such as a pipe.
+dtk_uint64 dtk_get_file_size(const char* filePath);
+
 // Deletes the file at the given path.
 //
 // This uses remove() on POSIX platforms and DeleteFile() on Windows platforms.
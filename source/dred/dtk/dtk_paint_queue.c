@@ -21,23 +21,74 @@ dtk_result dtk_paint_queue_uninit(dtk_paint_queue* pQueue)
 }
 
 
-dtk_bool32 dtk_paint_queue__try_merge(dtk_paint_queue* pQueue, dtk_window* pWindow, dtk_rect rect)
+// Determines whether or not two rectangles overlap or share an edge.
+dtk_bool32 dtk_paint_queue__rects_touch(dtk_rect rect0, dtk_rect rect1)
+{
+    return rect0.left <= rect1.right && rect1.left <= rect0.right && rect0.top <= rect1.bottom && rect1.top <= rect0.bottom;
+}
+
+dtk_int64 dtk_paint_queue__rect_area(dtk_rect rect)
+{
+    return (dtk_int64)(rect.right - rect.left) * (dtk_int64)(rect.bottom - rect.top);
+}
+
+void dtk_paint_queue__add_rect_to_item(dtk_paint_queue* pQueue, dtk_paint_queue_item* pItem, dtk_rect rect)
 {
     dtk_assert(pQueue != NULL);
-    dtk_assert(pWindow != NULL);
+    dtk_assert(pItem != NULL);
+
+    // Combining two rectangles can make the result touch another one so this needs to keep going until nothing changes.
+    dtk_bool32 wasMerged = DTK_TRUE;
+    while (wasMerged) {
+        wasMerged = DTK_FALSE;
+        for (dtk_uint32 iRect = 0; iRect < pItem->rectCount; ++iRect) {
+            if (dtk_paint_queue__rects_touch(pItem->rects[iRect], rect)) {
+                rect = dtk_rect_union(pItem->rects[iRect], rect);
+                pItem->rects[iRect] = pItem->rects[pItem->rectCount-1];
+                pItem->rectCount -= 1;
+                pQueue->stats.rectsMerged += 1;
+                wasMerged = DTK_TRUE;
+                break;
+            }
+        }
+    }
 
-    // We can merge if the previous item uses the same window.
-    if (pQueue->count == 0) {
-        return DTK_FALSE;
+    if (pItem->rectCount < DTK_PAINT_QUEUE_MAX_RECTS_PER_WINDOW) {
+        pItem->rects[pItem->rectCount] = rect;
+        pItem->rectCount += 1;
+        return;
+    }
+
+    // There's no room for another rectangle. It's combined with whichever existing one results in the smallest increase in area.
+    dtk_uint32 iBestRect = 0;
+    dtk_int64 bestGrowth = 0;
+    for (dtk_uint32 iRect = 0; iRect < pItem->rectCount; ++iRect) {
+        dtk_int64 growth = dtk_paint_queue__rect_area(dtk_rect_union(pItem->rects[iRect], rect)) - dtk_paint_queue__rect_area(pItem->rects[iRect]);
+        if (iRect == 0 || growth < bestGrowth) {
+            iBestRect = iRect;
+            bestGrowth = growth;
+        }
     }
 
-    dtk_uint32 iPrevItem = (pQueue->iFirstItem + pQueue->count - 1) % pQueue->capacity;
-    if (pQueue->pItems[iPrevItem].pWindow == pWindow) {
-        pQueue->pItems[iPrevItem].rect = dtk_rect_union(pQueue->pItems[iPrevItem].rect, rect);
-        return DTK_TRUE;
+    pItem->rects[iBestRect] = dtk_rect_union(pItem->rects[iBestRect], rect);
+    pQueue->stats.rectsMerged += 1;
+}
+
+dtk_bool32 dtk_paint_queue__try_merge(dtk_paint_queue* pQueue, dtk_window* pWindow, dtk_rect rect)
+{
+    dtk_assert(pQueue != NULL);
+    dtk_assert(pWindow != NULL);
+
+    // Any pending item for the same window can be merged with, not just the most recent one. This way a window is only ever
+    // painted once for any number of requests made before the paint gets dispatched.
+    for (dtk_uint32 i = 0; i < pQueue->count; ++i) {
+        dtk_paint_queue_item* pItem = &pQueue->pItems[(pQueue->iFirstItem + i) % pQueue->capacity];
+        if (pItem->pWindow == pWindow) {
+            dtk_paint_queue__add_rect_to_item(pQueue, pItem, rect);
+            return DTK_TRUE;
+        }
     }
 
-    // The previous item is not the same window and thus cannot be merged :(
     return DTK_FALSE;
 }
 
@@ -47,6 +98,8 @@ dtk_result dtk_paint_queue_enqueue(dtk_paint_queue* pQueue, dtk_window* pWindow,
 
     dtk_mutex_lock(&pQueue->lock);
     {
+        pQueue->stats.rectsRequested += 1;
+
         if (!dtk_paint_queue__try_merge(pQueue, pWindow, rect)) {   // <-- This will try merging the new paint request with a previous one if possible. If it fails, we need to enqueue a new one.
             // Couldn't merge. Going to need to enqueue a new item.
             if (pQueue->count == pQueue->capacity) {
@@ -72,7 +125,8 @@ dtk_result dtk_paint_queue_enqueue(dtk_paint_queue* pQueue, dtk_window* pWindow,
 
             dtk_uint32 iNewItem = (pQueue->iFirstItem + pQueue->count) % pQueue->capacity;
             pQueue->pItems[iNewItem].pWindow = pWindow;
-            pQueue->pItems[iNewItem].rect = rect;
+            pQueue->pItems[iNewItem].rects[0] = rect;
+            pQueue->pItems[iNewItem].rectCount = 1;
             pQueue->count += 1;
 
             dtk_post_paint_notification_event(DTK_CONTROL(pWindow)->pTK, pWindow);
@@ -95,6 +149,9 @@ dtk_result dtk_paint_queue_dequeue(dtk_paint_queue* pQueue, dtk_paint_queue_item
 
             pQueue->iFirstItem = (pQueue->iFirstItem + 1) % pQueue->capacity;
             pQueue->count -= 1;
+
+            pQueue->stats.rectsPainted += pItem->rectCount;
+            pQueue->stats.paints += 1;
             result = DTK_SUCCESS;
         } else {
             result = DTK_NO_EVENT;  // There's no items.
@@ -103,4 +160,20 @@ dtk_result dtk_paint_queue_dequeue(dtk_paint_queue* pQueue, dtk_paint_queue_item
     dtk_mutex_unlock(&pQueue->lock);
 
     return result;
+}
+
+dtk_result dtk_paint_queue_get_stats(dtk_paint_queue* pQueue, dtk_paint_queue_stats* pStats)
+{
+    if (pStats == NULL) return DTK_INVALID_ARGS;
+    dtk_zero_object(pStats);
+
+    if (pQueue == NULL) return DTK_INVALID_ARGS;
+
+    dtk_mutex_lock(&pQueue->lock);
+    {
+        *pStats = pQueue->stats;
+    }
+    dtk_mutex_unlock(&pQueue->lock);
+
+    return DTK_SUCCESS;
 }
\ No newline at end of file
@@ -1,11 +1,28 @@
 // Copyright (C) 2017 David Reid. See included LICENSE file.
 
+// The maximum number of separate rectangles that are kept for each window. Anything beyond this is merged into the rectangle that
+// grows the least as a result.
+#ifndef DTK_PAINT_QUEUE_MAX_RECTS_PER_WINDOW
+#define DTK_PAINT_QUEUE_MAX_RECTS_PER_WINDOW    8
+#endif
+
+// There is only ever one item in the queue for each window. Paint requests for a window that already has an item are combined with it.
 typedef struct
 {
     dtk_window* pWindow;
-    dtk_rect rect;
+    dtk_rect rects[DTK_PAINT_QUEUE_MAX_RECTS_PER_WINDOW];
+    dtk_uint32 rectCount;
 } dtk_paint_queue_item;
 
+// Counters for measuring how effective the combining of paint requests is.
+typedef struct
+{
+    dtk_uint64 rectsRequested;  // The number of rectangles passed to dtk_paint_queue_enqueue().
+    dtk_uint64 rectsMerged;     // The number of times two rectangles were combined into one.
+    dtk_uint64 rectsPainted;    // The number of rectangles that made it out of the queue to be painted.
+    dtk_uint64 paints;          // The number of items that made it out of the queue. Each one results in a single paint of a window.
+} dtk_paint_queue_stats;
+
 typedef struct
 {
     dtk_mutex lock;
@@ -13,9 +30,13 @@ typedef struct
     dtk_uint32 count;
     dtk_uint32 capacity;
     dtk_uint32 iFirstItem;
+    dtk_paint_queue_stats stats;
 } dtk_paint_queue;
 
 dtk_result dtk_paint_queue_init(dtk_paint_queue* pQueue);
 dtk_result dtk_paint_queue_uninit(dtk_paint_queue* pQueue);
 dtk_result dtk_paint_queue_enqueue(dtk_paint_queue* pQueue, dtk_window* pWindow, dtk_rect rect);
-dtk_result dtk_paint_queue_dequeue(dtk_paint_queue* pQueue, dtk_paint_queue_item* pItem);
\ No newline at end of file
+dtk_result dtk_paint_queue_dequeue(dtk_paint_queue* pQueue, dtk_paint_queue_item* pItem);
+
+// Retrieves a copy of the counters of the given queue.
+dtk_result dtk_paint_queue_get_stats(dtk_paint_queue* pQueue, dtk_paint_queue_stats* pStats);
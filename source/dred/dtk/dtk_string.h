@@ -404,6 +404,55 @@ DTK_INLINE dtk_uint32 dtk_utf32_to_utf8_ch(dtk_uint32 utf32, char* utf8, size_t
     return utf8ByteCount;
 }
 
+// Converts the UTF-8 character at the start of the given string to UTF-32. Returns the number of bytes making up the UTF-8 character,
+// or 0 if the string is empty. Invalid bytes are converted one at a time to U+FFFD.
+DTK_INLINE dtk_uint32 dtk_utf8_to_utf32_ch(const char* utf8, size_t utf8Size, dtk_uint32* pUTF32)
+{
+    if (utf8 == NULL || utf8Size == 0) {
+        *pUTF32 = 0;
+        return 0;
+    }
+
+    const unsigned char* pBytes = (const unsigned char*)utf8;
+    if (pBytes[0] < 0x80) {
+        *pUTF32 = pBytes[0];
+        return 1;
+    }
+
+    dtk_uint32 utf8ByteCount;
+    dtk_uint32 utf32;
+    if ((pBytes[0] & 0xE0) == 0xC0) {
+        utf8ByteCount = 2;
+        utf32 = pBytes[0] & 0x1F;
+    } else if ((pBytes[0] & 0xF0) == 0xE0) {
+        utf8ByteCount = 3;
+        utf32 = pBytes[0] & 0x0F;
+    } else if ((pBytes[0] & 0xF8) == 0xF0) {
+        utf8ByteCount = 4;
+        utf32 = pBytes[0] & 0x07;
+    } else {
+        *pUTF32 = 0xFFFD;
+        return 1;
+    }
+
+    if (utf8ByteCount > utf8Size) {
+        *pUTF32 = 0xFFFD;
+        return 1;
+    }
+
+    for (dtk_uint32 i = 1; i < utf8ByteCount; ++i) {
+        if ((pBytes[i] & 0xC0) != 0x80) {
+            *pUTF32 = 0xFFFD;
+            return 1;
+        }
+
+        utf32 = (utf32 << 6) | (pBytes[i] & 0x3F);
+    }
+
+    *pUTF32 = utf32;
+    return utf8ByteCount;
+}
+
 DTK_INLINE dtk_bool32 dtk_is_whitespace(dtk_uint32 utf32)
 {
     return utf32 == ' ' || utf32 == '\t' || utf32 == '\n' || utf32 == '\v' || utf32 == '\f' || utf32 == '\r';
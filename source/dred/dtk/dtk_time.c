@@ -5,6 +5,21 @@ time_t dtk_now()
     return time(NULL);
 }
 
+double dtk_get_time_in_seconds()
+{
+#ifdef DTK_WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+#endif
+}
+
 size_t dtk_datetime_short(time_t t, char* strOut, size_t strOutSize)
 {
 #if defined(_MSC_VER)
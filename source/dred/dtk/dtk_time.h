@@ -3,6 +3,10 @@
 // Retrieves a time_t as of the time the function was called.
 time_t dtk_now();
 
+// Retrieves the value of a high resolution monotonic timer, in seconds. This is only useful for measuring the time between
+// two points and should not be used for calendar time.
+double dtk_get_time_in_seconds();
+
 // Formats a data/time string.
 size_t dtk_datetime_short(time_t t, char* strOut, size_t strOutSize);
 
@@ -1108,6 +1108,27 @@ dtk_result dtk_window_immediate_redraw__win32(dtk_window* pWindow, dtk_rect rect
     return DTK_SUCCESS;
 }
 
+dtk_result dtk_window_immediate_redraw_rects__win32(dtk_window* pWindow, dtk_uint32 rectCount, const dtk_rect* pRects)
+{
+    // Every rectangle is added to the update region first so that the window only receives a single WM_PAINT for all of them.
+    for (dtk_uint32 iRect = 0; iRect < rectCount; ++iRect) {
+        RECT rectWin32;
+        rectWin32.left   = (LONG)pRects[iRect].left;
+        rectWin32.top    = (LONG)pRects[iRect].top;
+        rectWin32.right  = (LONG)pRects[iRect].right;
+        rectWin32.bottom = (LONG)pRects[iRect].bottom;
+        if (!RedrawWindow((HWND)pWindow->win32.hWnd, &rectWin32, NULL, RDW_INVALIDATE)) {
+            return DTK_ERROR;
+        }
+    }
+
+    if (!RedrawWindow((HWND)pWindow->win32.hWnd, NULL, NULL, RDW_UPDATENOW)) {
+        return DTK_ERROR;
+    }
+
+    return DTK_SUCCESS;
+}
+
 
 
 //// dtk_tooltip ////
@@ -2063,6 +2084,21 @@ dtk_result dtk_window_immediate_redraw__gtk(dtk_window* pWindow, dtk_rect rect)
     return DTK_SUCCESS;
 }
 
+dtk_result dtk_window_immediate_redraw_rects__gtk(dtk_window* pWindow, dtk_uint32 rectCount, const dtk_rect* pRects)
+{
+    // Every rectangle is queued before processing updates so that they're all drawn with a single draw signal.
+    for (dtk_uint32 iRect = 0; iRect < rectCount; ++iRect) {
+        gtk_widget_queue_draw_area(GTK_WIDGET(pWindow->gtk.pClientArea), (gint)pRects[iRect].left, (gint)pRects[iRect].top, (gint)(pRects[iRect].right - pRects[iRect].left), (gint)(pRects[iRect].bottom - pRects[iRect].top));
+    }
+
+    GdkWindow* pGDKWindow = gtk_widget_get_window(GTK_WIDGET(pWindow->gtk.pClientArea));
+    if (pGDKWindow != NULL) {
+        gdk_window_process_updates(pGDKWindow, TRUE);
+    }
+
+    return DTK_SUCCESS;
+}
+
 
 
 //// dtk_tooltip ////
@@ -3042,6 +3078,29 @@ dtk_result dtk_window_immediate_redraw(dtk_window* pWindow, dtk_rect rect)
     return result;
 }
 
+dtk_result dtk_window_immediate_redraw_rects(dtk_window* pWindow, dtk_uint32 rectCount, const dtk_rect* pRects)
+{
+    if (pWindow == NULL || (rectCount > 0 && pRects == NULL)) return DTK_INVALID_ARGS;
+
+    if (rectCount == 0) {
+        return DTK_SUCCESS;
+    }
+
+    dtk_result result = DTK_NO_BACKEND;
+#ifdef DTK_WIN32
+    if (DTK_CONTROL(pWindow)->pTK->platform == dtk_platform_win32) {
+        result = dtk_window_immediate_redraw_rects__win32(pWindow, rectCount, pRects);
+    }
+#endif
+#ifdef DTK_GTK
+    if (DTK_CONTROL(pWindow)->pTK->platform == dtk_platform_gtk) {
+        result = dtk_window_immediate_redraw_rects__gtk(pWindow, rectCount, pRects);
+    }
+#endif
+
+    return result;
+}
+
 
 typedef struct
 {
@@ -91,6 +91,7 @@ struct dtk_window
             dtk_int32 windowHeight;                 // ^
             dtk_int32 desiredPositionX;             // Used when a window want's to move while invisible. When the window is made visible, it will be positioned based on this if repositionOnShow is set.
             dtk_int32 desiredPositionY; 
+            dtk_uint32 frameTickCallbackID;         // The ID of the pending frame clock tick callback, or 0 if a paint is not scheduled.
             dtk_bool32 isCursorOverClientArea : 1;
             dtk_bool32 repositionOnShow : 1;
         } gtk;
@@ -201,6 +202,9 @@ dtk_result dtk_window_scheduled_redraw(dtk_window* pWindow, dtk_rect rect);
 // Immediately redraws a section of the given window.
 dtk_result dtk_window_immediate_redraw(dtk_window* pWindow, dtk_rect rect);
 
+// Immediately redraws multiple sections of the given window with a single paint.
+dtk_result dtk_window_immediate_redraw_rects(dtk_window* pWindow, dtk_uint32 rectCount, const dtk_rect* pRects);
+
 
 // Finds the control sitting under the mouse, using a window as the root level control.
 dtk_control* dtk_window_find_control_under_point(dtk_window* pWindow, dtk_int32 posX, dtk_int32 posY);
@@ -55,17 +55,28 @@ void dred_info_bar__on_paint__text_editor(dred_info_bar* pInfoBar, dtk_surface*
         dtk_font_get_metrics(pFont, uiScale, &fontMetrics);
 
         // The text info will be right-aligned so we need to measure first.
+        dtk_int32 matchStrWidth = 0;
+        if (pInfoBar->matchStr[0] != '\0') {
+            dtk_font_measure_string(pFont, uiScale, pInfoBar->matchStr, strlen(pInfoBar->matchStr), &matchStrWidth, NULL);
+            matchStrWidth += (dtk_int32)padding;
+        }
+
         dtk_int32 lineStrWidth;
         dtk_font_measure_string(pFont, uiScale, pInfoBar->lineStr, strlen(pInfoBar->lineStr), &lineStrWidth, NULL);
 
         dtk_int32 colStrWidth;
         dtk_font_measure_string(pFont, uiScale, pInfoBar->colStr, strlen(pInfoBar->colStr), &colStrWidth, NULL);
 
-        float totalWidth = lineStrWidth + padding + colStrWidth + paddingRight;
+        float totalWidth = matchStrWidth + lineStrWidth + padding + colStrWidth + paddingRight;
 
         
         float textPosX = dred_control_get_width(DRED_CONTROL(pInfoBar)) - totalWidth;
         float textPosY = (dred_control_get_height(DRED_CONTROL(pInfoBar)) - fontMetrics.lineHeight) / 2;
+        if (pInfoBar->matchStr[0] != '\0') {
+            dred_control_draw_text(DRED_CONTROL(pInfoBar), pFont, uiScale, pInfoBar->matchStr, (int)strlen(pInfoBar->matchStr), textPosX, textPosY, dred_info_bar__get_text_color(pInfoBar), dred_info_bar__get_bg_color(pInfoBar), pSurface);
+            textPosX += matchStrWidth;
+        }
+
         dred_control_draw_text(DRED_CONTROL(pInfoBar), pFont, uiScale, pInfoBar->lineStr, (int)strlen(pInfoBar->lineStr), textPosX, textPosY, dred_info_bar__get_text_color(pInfoBar), dred_info_bar__get_bg_color(pInfoBar), pSurface);
 
         textPosX += lineStrWidth + padding;
@@ -107,6 +118,7 @@ dtk_bool32 dred_info_bar_init(dred_info_bar* pInfoBar, dred_context* pDred, dred
     }
 
     pInfoBar->type = DRED_INFO_BAR_TYPE_NONE;
+    pInfoBar->matchStr[0] = '\0';
     pInfoBar->lineStr[0] = '\0';
     pInfoBar->colStr[0] = '\0';
     pInfoBar->zoomStr[0] = '\0';
@@ -137,6 +149,7 @@ void dred_info_bar_update(dred_info_bar* pInfoBar, dred_control* pControl)
     }
 
     pInfoBar->type = DRED_INFO_BAR_TYPE_NONE;
+    pInfoBar->matchStr[0] = '\0';
 
     if (pControl != NULL) {
         if (dred_control_is_of_type(pControl, DRED_CONTROL_TYPE_TEXT_EDITOR) || dred_control_is_of_type(pControl, DRED_CONTROL_TYPE_TEXTBOX))
@@ -144,6 +157,14 @@ void dred_info_bar_update(dred_info_bar* pInfoBar, dred_control* pControl)
             pInfoBar->type = DRED_INFO_BAR_TYPE_TEXT_EDITOR;
             snprintf(pInfoBar->lineStr, sizeof(pInfoBar->lineStr), "Ln %d", (int)dred_text_editor_get_cursor_line(DRED_TEXT_EDITOR(pControl)) + 1);
             snprintf(pInfoBar->colStr,  sizeof(pInfoBar->colStr),  "Col %d", (int)dred_text_editor_get_cursor_column(DRED_TEXT_EDITOR(pControl)) + 1);
+
+            // The match counter is shown with a trailing "+" while the file is still being searched.
+            size_t matchIndex;
+            size_t matchCount;
+            dtk_bool32 isMatchIndexComplete;
+            if (dred_control_is_of_type(pControl, DRED_CONTROL_TYPE_TEXT_EDITOR) && dred_text_editor_get_match_info(DRED_TEXT_EDITOR(pControl), &matchIndex, &matchCount, &isMatchIndexComplete)) {
+                snprintf(pInfoBar->matchStr, sizeof(pInfoBar->matchStr), "%u of %u%s", (unsigned int)matchIndex, (unsigned int)matchCount, isMatchIndexComplete ? "" : "+");
+            }
         }
     }
 
@@ -14,6 +14,7 @@ struct dred_info_bar
 
     dtk_font* pFont;
     int type;
+    char matchStr[64];
     char lineStr[32];
     char colStr[32];
     char zoomStr[32];
@@ -1,5 +1,10 @@
 // Copyright (C) 2017 David Reid. See included LICENSE file.
 
+// The maximum size in bytes of the atlas holding the rendered lines of each text view.
+#ifndef DRED_TEXTVIEW_LINE_TILE_CACHE_SIZE
+#define DRED_TEXTVIEW_LINE_TILE_CACHE_SIZE (16*1024*1024)
+#endif
+
 /// Retrieves the offset to draw the text in the text box.
 void dred_textview__get_text_offset(dred_textview* pTextView, float* pOffsetXOut, float* pOffsetYOut);
 
@@ -66,12 +71,392 @@ void dred_textview__refresh_horizontal_scrollbar(dred_textview* pTextView);
 void dred_textview__move_cursor_left(dred_textview* pTextView, size_t iCursor, int stateFlags);
 void dred_textview__move_cursor_right(dred_textview* pTextView, size_t iCursor, int stateFlags);
 
+void dred_textview__uninit_backing_surface(dred_textview_backing_surface* pBacking)
+{
+    assert(pBacking != NULL);
+
+    if (pBacking->isInitialized) {
+        dtk_surface_uninit(&pBacking->surface);
+        pBacking->isInitialized = DTK_FALSE;
+    }
+}
+
+// Marks a region of a backing surface as needing to be redrawn. The rectangle is relative to the surface.
+void dred_textview__invalidate_backing_surface(dred_textview_backing_surface* pBacking, dred_rect rect)
+{
+    assert(pBacking != NULL);
+
+    if (!pBacking->isInitialized) {
+        return; // The whole surface will be drawn when it's created.
+    }
+
+    // Partially covered pixels need to be redrawn in full.
+    rect = dred_make_rect(floorf(rect.left), floorf(rect.top), ceilf(rect.right), ceilf(rect.bottom));
+    rect = dred_clamp_rect(rect, dred_make_rect(0, 0, (float)pBacking->surface.width, (float)pBacking->surface.height));
+    if (!dred_rect_has_volume(rect)) {
+        return;
+    }
+
+    if (dred_rect_has_volume(pBacking->dirtyRect)) {
+        pBacking->dirtyRect = dred_rect_union(pBacking->dirtyRect, rect);
+    } else {
+        pBacking->dirtyRect = rect;
+    }
+}
+
+void dred_textview__invalidate_entire_backing_surface(dred_textview_backing_surface* pBacking)
+{
+    assert(pBacking != NULL);
+    dred_textview__invalidate_backing_surface(pBacking, dred_make_rect(0, 0, (float)pBacking->surface.width, (float)pBacking->surface.height));
+}
+
+// Moves the pixels of a backing surface to follow a change in the view's inner offset. Only the strips that are uncovered are
+// marked as dirty.
+void dred_textview__scroll_backing_surface(dred_textview_backing_surface* pBacking, float deltaX, float deltaY)
+{
+    assert(pBacking != NULL);
+
+    if (!pBacking->isInitialized) {
+        return;
+    }
+
+    pBacking->innerOffsetX += deltaX;
+    pBacking->innerOffsetY += deltaY;
+
+    float width  = (float)pBacking->surface.width;
+    float height = (float)pBacking->surface.height;
+
+    dtk_int32 shiftX = (dtk_int32)deltaX;
+    dtk_int32 shiftY = (dtk_int32)deltaY;
+    if ((float)shiftX != deltaX || (float)shiftY != deltaY || fabsf(deltaX) >= width || fabsf(deltaY) >= height) {
+        dred_textview__invalidate_entire_backing_surface(pBacking);
+        return;
+    }
+
+    if (dtk_surface_shift(&pBacking->surface, shiftX, shiftY) != DTK_SUCCESS) {
+        dred_textview__invalidate_entire_backing_surface(pBacking);
+        return;
+    }
+
+    // Anything that was waiting to be redrawn has moved with the pixels.
+    if (dred_rect_has_volume(pBacking->dirtyRect)) {
+        dred_rect dirtyRect = pBacking->dirtyRect;
+        pBacking->dirtyRect = dred_make_inside_out_rect();
+        dred_textview__invalidate_backing_surface(pBacking, dred_offset_rect(dirtyRect, deltaX, deltaY));
+    }
+
+    if (deltaX > 0) {
+        dred_textview__invalidate_backing_surface(pBacking, dred_make_rect(0, 0, deltaX, height));
+    } else if (deltaX < 0) {
+        dred_textview__invalidate_backing_surface(pBacking, dred_make_rect(width + deltaX, 0, width, height));
+    }
+
+    if (deltaY > 0) {
+        dred_textview__invalidate_backing_surface(pBacking, dred_make_rect(0, 0, width, deltaY));
+    } else if (deltaY < 0) {
+        dred_textview__invalidate_backing_surface(pBacking, dred_make_rect(0, height + deltaY, width, height));
+    }
+}
+
+// Makes sure the given backing surface exists, is the right size and is in sync with the view's inner offset. Returns DTK_FALSE
+// if the surface could not be created in which case the caller should draw directly to the window instead.
+dtk_bool32 dred_textview__prepare_backing_surface(dred_textview* pTextView, dred_textview_backing_surface* pBacking, float width, float height, float innerOffsetX, float innerOffsetY)
+{
+    assert(pTextView != NULL);
+    assert(pBacking != NULL);
+
+    if (width < 1 || height < 1) {
+        return DTK_FALSE;
+    }
+
+    dtk_uint32 surfaceWidth  = (dtk_uint32)ceilf(width);
+    dtk_uint32 surfaceHeight = (dtk_uint32)ceilf(height);
+    if (!pBacking->isInitialized || pBacking->surface.width != surfaceWidth || pBacking->surface.height != surfaceHeight) {
+        dred_textview__uninit_backing_surface(pBacking);
+
+        if (dtk_surface_init_image(DTK_CONTROL(pTextView)->pTK, surfaceWidth, surfaceHeight, 0, NULL, &pBacking->surface) != DTK_SUCCESS) {
+            return DTK_FALSE;
+        }
+
+        pBacking->isInitialized = DTK_TRUE;
+        pBacking->dirtyRect = dred_make_inside_out_rect();
+        pBacking->innerOffsetX = innerOffsetX;
+        pBacking->innerOffsetY = innerOffsetY;
+        dred_textview__invalidate_entire_backing_surface(pBacking);
+    }
+
+    // The inner offset can be changed by something other than the scrollbars, in which case the pixels can't be trusted.
+    if (pBacking->innerOffsetX != innerOffsetX || pBacking->innerOffsetY != innerOffsetY) {
+        pBacking->innerOffsetX = innerOffsetX;
+        pBacking->innerOffsetY = innerOffsetY;
+        dred_textview__invalidate_entire_backing_surface(pBacking);
+    }
+
+    return DTK_TRUE;
+}
+
+// Determines whether or not the given rectangle is outside of the region being painted and can be skipped.
+dtk_bool32 dred_textview__is_culled(dred_textview_backing_surface* pBacking, dred_rect rect)
+{
+    return rect.bottom <= pBacking->paintRect.top || rect.top >= pBacking->paintRect.bottom || rect.right <= pBacking->paintRect.left || rect.left >= pBacking->paintRect.right;
+}
+
+// Copies the entire backing surface to the given surface.
+void dred_textview__present_backing_surface(dred_textview_backing_surface* pBacking, float posX, float posY, dtk_surface* pSurface)
+{
+    assert(pBacking != NULL);
+
+    dtk_draw_surface_args args;
+    memset(&args, 0, sizeof(args));
+    args.dstX = (dtk_int32)posX;
+    args.dstY = (dtk_int32)posY;
+    args.dstWidth  = (dtk_int32)pBacking->surface.width;
+    args.dstHeight = (dtk_int32)pBacking->surface.height;
+    args.srcWidth  = (dtk_int32)pBacking->surface.width;
+    args.srcHeight = (dtk_int32)pBacking->surface.height;
+    args.foregroundTint = dtk_rgb(255, 255, 255);
+    args.backgroundColor = dtk_rgb(255, 255, 255);
+    args.options = DTK_SURFACE_HINT_NO_ALPHA;
+    dtk_surface_draw_surface(pSurface, &pBacking->surface, &args);
+}
+
+
+void dred_textview__uninit_line_tiles(dred_textview_line_tile_cache* pCache)
+{
+    assert(pCache != NULL);
+
+    if (pCache->isInitialized) {
+        dtk_surface_uninit(&pCache->atlas);
+        pCache->isInitialized = DTK_FALSE;
+    }
+
+    free(pCache->pTiles);
+    pCache->pTiles = NULL;
+    pCache->tileCount = 0;
+    pCache->tileCapacity = 0;
+
+    free(pCache->pPendingTiles);
+    pCache->pPendingTiles = NULL;
+    pCache->pendingTileCount = 0;
+    pCache->pendingTileCapacity = 0;
+}
+
+// Forgets every rendered line. This needs to be called whenever something that isn't part of a tile's hash, such as a font, changes.
+void dred_textview__clear_line_tiles(dred_textview_line_tile_cache* pCache)
+{
+    assert(pCache != NULL);
+    pCache->tileCount = 0;
+}
+
+// Makes sure the atlas is set up for tiles of the given size. Returns DTK_FALSE if line tiles can't be used.
+dtk_bool32 dred_textview__prepare_line_tiles(dred_textview* pTextView, dtk_uint32 tileWidth, dtk_uint32 tileHeight, dtk_uint32 viewHeight)
+{
+    assert(pTextView != NULL);
+
+    dred_textview_line_tile_cache* pCache = &pTextView->lineTiles;
+    if (tileWidth == 0 || tileHeight == 0) {
+        return DTK_FALSE;
+    }
+
+    if (pCache->isInitialized && pCache->tileWidth == tileWidth && pCache->tileHeight == tileHeight) {
+        return DTK_TRUE;
+    }
+
+    dred_textview__uninit_line_tiles(pCache);
+
+    // Enough for a few pages worth of lines, but never more than the size limit allows.
+    size_t tileCapacity = ((size_t)(viewHeight / tileHeight) + 1) * 4;
+    size_t maxTileCapacity = DRED_TEXTVIEW_LINE_TILE_CACHE_SIZE / ((size_t)tileWidth * tileHeight * 4);
+    if (tileCapacity > maxTileCapacity) {
+        tileCapacity = maxTileCapacity;
+    }
+    if (tileCapacity == 0) {
+        return DTK_FALSE;
+    }
+
+    pCache->pTiles = (dred_textview_line_tile*)malloc(tileCapacity * sizeof(*pCache->pTiles));
+    if (pCache->pTiles == NULL) {
+        return DTK_FALSE;
+    }
+
+    if (dtk_surface_init_image(DTK_CONTROL(pTextView)->pTK, tileWidth, tileHeight * (dtk_uint32)tileCapacity, 0, NULL, &pCache->atlas) != DTK_SUCCESS) {
+        free(pCache->pTiles);
+        pCache->pTiles = NULL;
+        return DTK_FALSE;
+    }
+
+    pCache->isInitialized = DTK_TRUE;
+    pCache->tileWidth = tileWidth;
+    pCache->tileHeight = tileHeight;
+    pCache->tileCapacity = tileCapacity;
+    pCache->tileCount = 0;
+
+    return DTK_TRUE;
+}
+
+// Finishes off the line being collected. If the line has been rendered before, what was collected for it is removed from the text
+// batch and the tile is drawn in it's place.
+void dred_textview__end_line_tile(dred_textview* pTextView, dtk_surface* pSurface)
+{
+    assert(pTextView != NULL);
+
+    dred_textview_line_tile_cache* pCache = &pTextView->lineTiles;
+    if (!pCache->isCollectingLine) {
+        return;
+    }
+
+    pCache->isCollectingLine = DTK_FALSE;
+    pCache->useCounter += 1;
+
+    for (size_t iTile = 0; iTile < pCache->tileCount; ++iTile) {
+        if (pCache->pTiles[iTile].hash == pCache->lineHash) {
+            pTextView->textBatch.runCount   = pCache->lineRunStart;
+            pTextView->textBatch.rectCount  = pCache->lineRectStart;
+            pTextView->textBatch.textLength = pCache->lineTextStart;
+            pCache->pTiles[iTile].lastUsed = pCache->useCounter;
+
+            dtk_draw_surface_args args;
+            memset(&args, 0, sizeof(args));
+            args.dstX = (dtk_int32)pCache->originX;
+            args.dstY = (dtk_int32)pCache->lineTop;
+            args.dstWidth  = (dtk_int32)pCache->tileWidth;
+            args.dstHeight = (dtk_int32)pCache->tileHeight;
+            args.srcY = (dtk_int32)(iTile * pCache->tileHeight);
+            args.srcWidth  = (dtk_int32)pCache->tileWidth;
+            args.srcHeight = (dtk_int32)pCache->tileHeight;
+            args.foregroundTint = dtk_rgb(255, 255, 255);
+            args.backgroundColor = dtk_rgb(255, 255, 255);
+            args.options = DTK_SURFACE_HINT_NO_ALPHA;
+            dtk_surface_draw_surface(pSurface, &pCache->atlas, &args);
+            return;
+        }
+    }
+
+    // The line can only be copied into the cache if it's being drawn in full. Otherwise part of it would be left out by the clip.
+    dred_rect paintRect = pTextView->textBacking.paintRect;
+    float lineLeft   = pCache->originX;
+    float lineRight  = pCache->originX + pCache->tileWidth;
+    float lineTop    = pCache->lineTop;
+    float lineBottom = pCache->lineTop + pCache->tileHeight;
+    if (lineLeft < paintRect.left || lineRight > paintRect.right || lineTop < paintRect.top || lineBottom > paintRect.bottom) {
+        return;
+    }
+
+    for (size_t iPendingTile = 0; iPendingTile < pCache->pendingTileCount; ++iPendingTile) {
+        if (pCache->pPendingTiles[iPendingTile].hash == pCache->lineHash) {
+            return; // An identical line has already been drawn.
+        }
+    }
+
+    if (pCache->pendingTileCount == pCache->pendingTileCapacity) {
+        size_t newPendingTileCapacity = (pCache->pendingTileCapacity == 0) ? 64 : pCache->pendingTileCapacity*2;
+        dred_textview_pending_line_tile* pNewPendingTiles = (dred_textview_pending_line_tile*)realloc(pCache->pPendingTiles, newPendingTileCapacity * sizeof(*pNewPendingTiles));
+        if (pNewPendingTiles == NULL) {
+            return;
+        }
+
+        pCache->pPendingTiles = pNewPendingTiles;
+        pCache->pendingTileCapacity = newPendingTileCapacity;
+    }
+
+    pCache->pPendingTiles[pCache->pendingTileCount].hash = pCache->lineHash;
+    pCache->pPendingTiles[pCache->pendingTileCount].posY = pCache->lineTop;
+    pCache->pendingTileCount += 1;
+}
+
+// Adds something that's about to be drawn to the hash of the line at the given position. This must be called before the
+// corresponding run or rectangle is added to the text batch.
+void dred_textview__hash_line_tile_data(dred_textview* pTextView, float lineTop, const void* pData, size_t dataSize, dtk_surface* pSurface)
+{
+    assert(pTextView != NULL);
+
+    dred_textview_line_tile_cache* pCache = &pTextView->lineTiles;
+    if (pCache->isCollectingLine && pCache->lineTop != lineTop) {
+        dred_textview__end_line_tile(pTextView, pSurface);
+    }
+
+    if (!pCache->isCollectingLine) {
+        pCache->isCollectingLine = DTK_TRUE;
+        pCache->lineTop = lineTop;
+        pCache->lineHash = 14695981039346656037ULL;    // FNV-1a offset basis.
+        pCache->lineRunStart  = pTextView->textBatch.runCount;
+        pCache->lineRectStart = pTextView->textBatch.rectCount;
+        pCache->lineTextStart = pTextView->textBatch.textLength;
+    }
+
+    const unsigned char* pBytes = (const unsigned char*)pData;
+    for (size_t i = 0; i < dataSize; ++i) {
+        pCache->lineHash ^= pBytes[i];
+        pCache->lineHash *= 1099511628211ULL;   // FNV-1a prime.
+    }
+}
+
+// Copies the lines that were drawn in full during the last paint from the backing surface into the atlas, replacing the least
+// recently used tiles once it's full.
+void dred_textview__store_pending_line_tiles(dred_textview* pTextView)
+{
+    assert(pTextView != NULL);
+
+    dred_textview_line_tile_cache* pCache = &pTextView->lineTiles;
+    for (size_t iPendingTile = 0; iPendingTile < pCache->pendingTileCount; ++iPendingTile) {
+        size_t iTile;
+        if (pCache->tileCount < pCache->tileCapacity) {
+            iTile = pCache->tileCount;
+            pCache->tileCount += 1;
+        } else {
+            iTile = 0;
+            for (size_t i = 1; i < pCache->tileCount; ++i) {
+                if (pCache->pTiles[i].lastUsed < pCache->pTiles[iTile].lastUsed) {
+                    iTile = i;
+                }
+            }
+        }
+
+        pCache->pTiles[iTile].hash = pCache->pPendingTiles[iPendingTile].hash;
+        pCache->pTiles[iTile].lastUsed = pCache->useCounter;
+
+        dtk_draw_surface_args args;
+        memset(&args, 0, sizeof(args));
+        args.dstY = (dtk_int32)(iTile * pCache->tileHeight);
+        args.dstWidth  = (dtk_int32)pCache->tileWidth;
+        args.dstHeight = (dtk_int32)pCache->tileHeight;
+        args.srcY = (dtk_int32)(pCache->pPendingTiles[iPendingTile].posY - pCache->originY);
+        args.srcWidth  = (dtk_int32)pCache->tileWidth;
+        args.srcHeight = (dtk_int32)pCache->tileHeight;
+        args.foregroundTint = dtk_rgb(255, 255, 255);
+        args.backgroundColor = dtk_rgb(255, 255, 255);
+        args.options = DTK_SURFACE_HINT_NO_ALPHA;
+        dtk_surface_draw_surface(&pCache->atlas, &pTextView->textBacking.surface, &args);
+    }
+
+    pCache->pendingTileCount = 0;
+}
+
+void dred_textview__dirty_line_numbers(dred_textview* pTextView)
+{
+    assert(pTextView != NULL);
+
+    dred_textview__invalidate_entire_backing_surface(&pTextView->lineNumbersBacking);
+    dred_control_dirty(pTextView->pLineNumbers, dred_control_get_local_rect(pTextView->pLineNumbers));
+}
+
+
 void dred_textview__on_vscroll(dtk_scrollbar* pSBControl, int scrollPos)
 {
     dred_textview* pTextView = (dred_textview*)DTK_CONTROL(pSBControl)->pUserData;
     assert(pTextView != NULL);
 
+    float oldInnerOffsetY = drte_view_get_inner_offset_y(pTextView->pView);
+
+    pTextView->isScrolling = DTK_TRUE;
     drte_view_set_inner_offset_y(pTextView->pView, -drte_view_get_line_pos_y(pTextView->pView, scrollPos));
+    pTextView->isScrolling = DTK_FALSE;
+
+    // The pixels that are still visible are moved rather than redrawn.
+    float deltaY = drte_view_get_inner_offset_y(pTextView->pView) - oldInnerOffsetY;
+    dred_textview__scroll_backing_surface(&pTextView->textBacking, 0, deltaY);
+    dred_textview__scroll_backing_surface(&pTextView->lineNumbersBacking, 0, deltaY);
+
     dred_textview__refresh_scrollbars(pTextView);
 
     // The line numbers need to be redrawn.
@@ -83,7 +468,13 @@ void dred_textview__on_hscroll(dtk_scrollbar* pSBControl, int scrollPos)
     dred_textview* pTextView = (dred_textview*)DTK_CONTROL(pSBControl)->pUserData;
     assert(pTextView != NULL);
 
+    float oldInnerOffsetX = drte_view_get_inner_offset_x(pTextView->pView);
+
+    pTextView->isScrolling = DTK_TRUE;
     drte_view_set_inner_offset_x(pTextView->pView, (float)-scrollPos);
+    pTextView->isScrolling = DTK_FALSE;
+
+    dred_textview__scroll_backing_surface(&pTextView->textBacking, drte_view_get_inner_offset_x(pTextView->pView) - oldInnerOffsetX, 0);
 }
 
 void dred_textview__refresh_style(dred_textview* pTextView)
@@ -99,6 +490,9 @@ void dred_textview__refresh_style(dred_textview* pTextView)
     // Selection.
     drte_engine_register_style_token(pTextView->pTextEngine, (drte_style_token)&pTextView->selectionStyle, drte_font_metrics_create(fontMetrics.ascent, fontMetrics.descent, fontMetrics.lineHeight, fontMetrics.spaceWidth));
 
+    // Matches.
+    drte_engine_register_style_token(pTextView->pTextEngine, (drte_style_token)&pTextView->matchStyle, drte_font_metrics_create(fontMetrics.ascent, fontMetrics.descent, fontMetrics.lineHeight, fontMetrics.spaceWidth));
+
     // Active line.
     drte_engine_register_style_token(pTextView->pTextEngine, (drte_style_token)&pTextView->activeLineStyle, drte_font_metrics_create(fontMetrics.ascent, fontMetrics.descent, fontMetrics.lineHeight, fontMetrics.spaceWidth));
 
@@ -107,6 +501,11 @@ void dred_textview__refresh_style(dred_textview* pTextView)
 
     // Line numbers.
     drte_engine_register_style_token(pTextView->pTextEngine, (drte_style_token)&pTextView->lineNumbersStyle, drte_font_metrics_create(fontMetrics.ascent, fontMetrics.descent, fontMetrics.lineHeight, fontMetrics.spaceWidth));
+
+    // Everything that's already been rendered is using the old style.
+    dred_textview__invalidate_entire_backing_surface(&pTextView->textBacking);
+    dred_textview__invalidate_entire_backing_surface(&pTextView->lineNumbersBacking);
+    dred_textview__clear_line_tiles(&pTextView->lineTiles);
 }
 
 
@@ -350,6 +749,107 @@ void dred_textview__delete_timer(dred_textview* pTextView)
 }
 
 
+void dred_textview__delete_match_indexing_timer(dred_textview* pTextView)
+{
+    dtk_assert(pTextView != NULL);
+
+    if (pTextView->pMatchIndexingTimer != NULL) {
+        dtk_timer_uninit(pTextView->pMatchIndexingTimer);
+        free(pTextView->pMatchIndexingTimer);
+        pTextView->pMatchIndexingTimer = NULL;
+    }
+}
+
+void dred_textview__on_match_indexing_timer(dtk_timer* pTimer, void* pUserData)
+{
+    (void)pTimer;
+
+    dred_textview* pTextView = (dred_textview*)pUserData;
+    assert(pTextView != NULL);
+
+    // One chunk per tick keeps the UI responsive while a large file is being searched.
+    if (drte_view_index_matches(pTextView->pView, DRTE_MATCH_INDEXING_CHUNK_SIZE)) {
+        dred_textview__delete_match_indexing_timer(pTextView);
+    }
+
+    if (pTextView->onMatchesChanged) {
+        pTextView->onMatchesChanged(pTextView);
+    }
+}
+
+void dred_textview__begin_match_indexing(dred_textview* pTextView)
+{
+    dtk_assert(pTextView != NULL);
+
+    if (drte_view_is_match_index_complete(pTextView->pView) || pTextView->pMatchIndexingTimer != NULL) {
+        return;
+    }
+
+    pTextView->pMatchIndexingTimer = (dtk_timer*)malloc(sizeof(*pTextView->pMatchIndexingTimer));
+    if (pTextView->pMatchIndexingTimer == NULL) {
+        return;
+    }
+
+    if (dtk_timer_init(DTK_CONTROL(pTextView)->pTK, 10, dred_textview__on_match_indexing_timer, pTextView, pTextView->pMatchIndexingTimer) != DTK_SUCCESS) {
+        free(pTextView->pMatchIndexingTimer);
+        pTextView->pMatchIndexingTimer = NULL;
+    }
+}
+
+void dred_textview__delete_word_wrapping_timer(dred_textview* pTextView)
+{
+    dtk_assert(pTextView != NULL);
+
+    if (pTextView->pWordWrappingTimer != NULL) {
+        dtk_timer_uninit(pTextView->pWordWrappingTimer);
+        free(pTextView->pWordWrappingTimer);
+        pTextView->pWordWrappingTimer = NULL;
+    }
+}
+
+void dred_textview__on_word_wrapping_timer(dtk_timer* pTimer, void* pUserData)
+{
+    (void)pTimer;
+
+    dred_textview* pTextView = (dred_textview*)pUserData;
+    assert(pTextView != NULL);
+
+    // One chunk per tick keeps the UI responsive while the lines of a large file are re-wrapped after a resize.
+    if (drte_view_wrap_lines(pTextView->pView, DRTE_WORD_WRAP_CHUNK_SIZE)) {
+        dred_textview__delete_word_wrapping_timer(pTextView);
+    }
+
+    // The engine keeps the top line where it is as the lines above it are wrapped. The vertical scrollbar needs to follow it.
+    size_t iTopLine;
+    drte_view_get_visible_lines(pTextView->pView, &iTopLine, NULL);
+
+    dred_textview__refresh_scrollbars(pTextView);
+    dtk_scrollbar_scroll_to(pTextView->pVertScrollbar, (int)iTopLine);
+
+    // The line numbers need to be redrawn.
+    dred_textview__dirty_line_numbers(pTextView);
+}
+
+void dred_textview__begin_word_wrapping(dred_textview* pTextView)
+{
+    dtk_assert(pTextView != NULL);
+
+    if (drte_view_is_word_wrapping_complete(pTextView->pView) || pTextView->pWordWrappingTimer != NULL) {
+        return;
+    }
+
+    pTextView->pWordWrappingTimer = (dtk_timer*)malloc(sizeof(*pTextView->pWordWrappingTimer));
+    if (pTextView->pWordWrappingTimer == NULL) {
+        return;
+    }
+
+    if (dtk_timer_init(DTK_CONTROL(pTextView)->pTK, 10, dred_textview__on_word_wrapping_timer, pTextView, pTextView->pWordWrappingTimer) != DTK_SUCCESS) {
+        free(pTextView->pWordWrappingTimer);
+        pTextView->pWordWrappingTimer = NULL;
+    }
+}
+
+
 dtk_bool32 dred_textview_init(dred_textview* pTextView, dred_context* pDred, dred_control* pParent, drte_engine* pTextEngine)
 {
     if (pTextView == NULL || pTextEngine == NULL) {
@@ -362,6 +862,8 @@ dtk_bool32 dred_textview_init(dred_textview* pTextView, dred_context* pDred, dre
     }
 
     pTextView->pTextEngine = pTextEngine;
+    dtk_text_batch_init(&pTextView->textBatch);
+    dtk_text_batch_init(&pTextView->cursorBatch);
 
     pTextView->pView = drte_view_create(pTextView->pTextEngine);
     if (pTextView->pView == NULL) {
@@ -423,6 +925,10 @@ dtk_bool32 dred_textview_init(dred_textview* pTextView, dred_context* pDred, dre
     pTextView->selectionStyle.bgColor = dred_rgb(64, 128, 192);
     pTextView->selectionStyle.fgColor = dred_rgb(0, 0, 0);
 
+    pTextView->matchStyle.pFont = &pDred->config.pTextEditorFont->fontDTK;
+    pTextView->matchStyle.bgColor = dred_rgb(96, 80, 40);
+    pTextView->matchStyle.fgColor = dred_rgb(0, 0, 0);
+
     pTextView->activeLineStyle.pFont = &pDred->config.pTextEditorFont->fontDTK;
     pTextView->activeLineStyle.bgColor = dred_rgb(64, 64, 64);
     pTextView->activeLineStyle.fgColor = dred_rgb(0, 0, 0);
@@ -446,6 +952,7 @@ dtk_bool32 dred_textview_init(dred_textview* pTextView, dred_context* pDred, dre
 
     drte_engine_set_default_style(pTextView->pTextEngine, (drte_style_token)&pTextView->defaultStyle);
     drte_engine_set_selection_style(pTextView->pTextEngine, (drte_style_token)&pTextView->selectionStyle);
+    drte_engine_set_match_style(pTextView->pTextEngine, (drte_style_token)&pTextView->matchStyle);
     drte_engine_set_active_line_style(pTextView->pTextEngine, (drte_style_token)&pTextView->activeLineStyle);
     drte_engine_set_cursor_style(pTextView->pTextEngine, (drte_style_token)&pTextView->cursorStyle);
     drte_engine_set_line_numbers_style(pTextView->pTextEngine, (drte_style_token)&pTextView->lineNumbersStyle);
@@ -482,6 +989,7 @@ dtk_bool32 dred_textview_init(dred_textview* pTextView, dred_context* pDred, dre
     pTextView->iLineSelectAnchor = 0;
     pTextView->onCursorMove = NULL;
     pTextView->onUndoPointChanged = NULL;
+    pTextView->onMatchesChanged = NULL;
 
     return DTK_TRUE;
 }
@@ -493,6 +1001,8 @@ void dred_textview_uninit(dred_textview* pTextView)
     }
 
     dred_textview__delete_timer(pTextView);
+    dred_textview__delete_match_indexing_timer(pTextView);
+    dred_textview__delete_word_wrapping_timer(pTextView);
 
     if (pTextView->pLineNumbers) {
         dred_control_uninit(pTextView->pLineNumbers);
@@ -519,6 +1029,12 @@ void dred_textview_uninit(dred_textview* pTextView)
         pTextView->pView = NULL;
     }
 
+    dtk_text_batch_uninit(&pTextView->textBatch);
+    dtk_text_batch_uninit(&pTextView->cursorBatch);
+    dred_textview__uninit_backing_surface(&pTextView->textBacking);
+    dred_textview__uninit_backing_surface(&pTextView->lineNumbersBacking);
+    dred_textview__uninit_line_tiles(&pTextView->lineTiles);
+
     dred_control_uninit(DRED_CONTROL(pTextView));
 }
 
@@ -630,6 +1146,16 @@ dtk_color dred_textview_get_selection_background_color(dred_textview* pTextView)
     return pTextView->selectionStyle.bgColor;
 }
 
+void dred_textview_set_match_background_color(dred_textview* pTextView, dtk_color color)
+{
+    if (pTextView == NULL) {
+        return;
+    }
+
+    pTextView->matchStyle.bgColor = color;
+    dred_textview__refresh_style(pTextView);
+}
+
 void dred_textview_set_active_line_background_color(dred_textview* pTextView, dtk_color color)
 {
     if (pTextView == NULL) {
@@ -918,6 +1444,25 @@ void dred_textview_set_text(dred_textview* pTextView, const char* text)
     drte_view_move_cursor_to_character(pTextView->pView, drte_view_get_last_cursor(pTextView->pView), iCursorChar);
 }
 
+dtk_bool32 dred_textview_set_text_no_copy(dred_textview* pTextView, const char* text, size_t textLength, drte_engine_on_free_text_proc onFree, void* pUserData)
+{
+    if (pTextView == NULL) {
+        return DTK_FALSE;
+    }
+
+    // Same as dred_textview_set_text(), cursors and selections are cancelled so they don't reference invalid regions.
+    dred_textview__clear_all_cursors_except_last(pTextView);
+    drte_view_deselect_all(pTextView->pView);
+    size_t iCursorChar = drte_view_get_cursor_character(pTextView->pView, drte_view_get_last_cursor(pTextView->pView));
+
+    if (!drte_engine_set_text_no_copy_unindexed(pTextView->pTextEngine, text, textLength, onFree, pUserData)) {
+        return DTK_FALSE;
+    }
+
+    drte_view_move_cursor_to_character(pTextView->pView, drte_view_get_last_cursor(pTextView->pView), iCursorChar);
+    return DTK_TRUE;
+}
+
 size_t dred_textview_get_text(dred_textview* pTextView, char* pTextOut, size_t textOutSize)
 {
     if (pTextView == NULL) {
@@ -1085,22 +1630,35 @@ dtk_bool32 dred_textview_do_delete(dred_textview* pTextView, int keyStateFlags)
             drte_view__update_cursor_sticky_position(pTextView->pView, &pTextView->pView->pCursors[iLastCursor]);
             drte_view_remove_overlapping_cursors(pTextView->pView);
         } else {
-            drte_view_begin_dirty(pTextView->pView);
-            {
-                for (size_t iCursor = 0; iCursor < pTextView->pView->cursorCount; ++iCursor) {
-                    size_t iCharBeg = drte_view_get_cursor_character(pTextView->pView, iCursor);
-                    dred_textview__move_cursor_right(pTextView, iCursor, keyStateFlags);
-                    size_t iCharEnd = drte_view_get_cursor_character(pTextView->pView, iCursor);
+            // The text to delete at every cursor is gathered first so that it can all be deleted as a single change.
+            drte_edit* pEdits = (drte_edit*)malloc(pTextView->pView->cursorCount * sizeof(*pEdits));
+            if (pEdits != NULL) {
+                size_t editCount = 0;
 
-                    if (iCharEnd == iCharBeg) {
-                        continue;   // Nothing to delete.
+                drte_view_begin_dirty(pTextView->pView);
+                {
+                    for (size_t iCursor = 0; iCursor < pTextView->pView->cursorCount; ++iCursor) {
+                        size_t iCharBeg = drte_view_get_cursor_character(pTextView->pView, iCursor);
+                        dred_textview__move_cursor_right(pTextView, iCursor, keyStateFlags);
+                        size_t iCharEnd = drte_view_get_cursor_character(pTextView->pView, iCursor);
+
+                        if (iCharEnd == iCharBeg) {
+                            continue;   // Nothing to delete.
+                        }
+
+                        pEdits[editCount].iChar = iCharBeg;
+                        pEdits[editCount].deleteLength = iCharEnd - iCharBeg;
+                        pEdits[editCount].text = NULL;
+                        pEdits[editCount].textLength = 0;
+                        editCount += 1;
                     }
 
-                    wasTextChanged = drte_engine_delete_text(pTextView->pTextEngine, iCharBeg, iCharEnd);
-                    drte_view__update_cursor_sticky_position(pTextView->pView, &pTextView->pView->pCursors[iCursor]);
+                    wasTextChanged = drte_view_apply_edits(pTextView->pView, pEdits, editCount);
                 }
+                drte_view_end_dirty(pTextView->pView);
+
+                free(pEdits);
             }
-            drte_view_end_dirty(pTextView->pView);
         }
     }
     if (wasTextChanged) { drte_engine_commit_undo_point(pTextView->pTextEngine); }
@@ -1120,34 +1678,48 @@ dtk_bool32 dred_textview_do_backspace(dred_textview* pTextView, int keyStateFlag
             drte_view__update_cursor_sticky_position(pTextView->pView, &pTextView->pView->pCursors[iLastCursor]);
             drte_view_remove_overlapping_cursors(pTextView->pView);
         } else {
-            drte_view_begin_dirty(pTextView->pView);
-            {
-                for (size_t iCursor = 0; iCursor < pTextView->pView->cursorCount; ++iCursor) {
-                    size_t iCursorChar = pTextView->pView->pCursors[iCursor].iCharAbs;
-                    if (iCursorChar == 0) {
-                        continue;
-                    }
+            // As with deleting, the text to the left of every cursor is gathered first and then deleted as a single change.
+            drte_edit* pEdits = (drte_edit*)malloc(pTextView->pView->cursorCount * sizeof(*pEdits));
+            if (pEdits != NULL) {
+                size_t editCount = 0;
 
-                    dtk_bool32 leaveNewLines = pTextView->pView->cursorCount > 1;
-                    if (leaveNewLines) {
-                        size_t iLineCharBeg = drte_view_get_line_first_character(pTextView->pView, pTextView->pView->pWrappedLines, drte_view_get_cursor_line(pTextView->pView, iCursor));
-                        if (iCursorChar == iLineCharBeg) {
+                drte_view_begin_dirty(pTextView->pView);
+                {
+                    for (size_t iCursor = 0; iCursor < pTextView->pView->cursorCount; ++iCursor) {
+                        size_t iCursorChar = pTextView->pView->pCursors[iCursor].iCharAbs;
+                        if (iCursorChar == 0) {
                             continue;
                         }
-                    }
 
-                    size_t iCharEnd = drte_view_get_cursor_character(pTextView->pView, iCursor);
-                    dred_textview__move_cursor_left(pTextView, iCursor, keyStateFlags);
-                    size_t iCharBeg = drte_view_get_cursor_character(pTextView->pView, iCursor);
+                        dtk_bool32 leaveNewLines = pTextView->pView->cursorCount > 1;
+                        if (leaveNewLines) {
+                            size_t iLineCharBeg = drte_view_get_line_first_character(pTextView->pView, pTextView->pView->pWrappedLines, drte_view_get_cursor_line(pTextView->pView, iCursor));
+                            if (iCursorChar == iLineCharBeg) {
+                                continue;
+                            }
+                        }
+
+                        size_t iCharEnd = drte_view_get_cursor_character(pTextView->pView, iCursor);
+                        dred_textview__move_cursor_left(pTextView, iCursor, keyStateFlags);
+                        size_t iCharBeg = drte_view_get_cursor_character(pTextView->pView, iCursor);
 
-                    if (iCharEnd == iCharBeg) {
-                        continue;   // Nothing to delete.
+                        if (iCharEnd == iCharBeg) {
+                            continue;   // Nothing to delete.
+                        }
+
+                        pEdits[editCount].iChar = iCharBeg;
+                        pEdits[editCount].deleteLength = iCharEnd - iCharBeg;
+                        pEdits[editCount].text = NULL;
+                        pEdits[editCount].textLength = 0;
+                        editCount += 1;
                     }
 
-                    wasTextChanged = drte_engine_delete_text(pTextView->pTextEngine, iCharBeg, iCharEnd);
+                    wasTextChanged = drte_view_apply_edits(pTextView->pView, pEdits, editCount);
                 }
+                drte_view_end_dirty(pTextView->pView);
+
+                free(pEdits);
             }
-            drte_view_end_dirty(pTextView->pView);
         }
     }
     if (wasTextChanged) { drte_engine_commit_undo_point(pTextView->pTextEngine); }
@@ -1161,12 +1733,7 @@ dtk_bool32 dred_textview_insert_text_at_cursors_no_undo(dred_textview* pTextView
         return DTK_FALSE;
     }
 
-    dtk_bool32 wasTextChanged = DTK_FALSE;
-    for (size_t iCursor = 0; iCursor < pTextView->cursorCount; ++iCursor) {
-        wasTextChanged = drte_view_insert_text_at_cursor(pTextView->pView, iCursor, text) || wasTextChanged;
-    }
-
-    return wasTextChanged;
+    return drte_view_insert_text_at_cursors(pTextView->pView, text);
 }
 
 dtk_bool32 dred_textview_insert_text_at_cursors(dred_textview* pTextView, const char* text)
@@ -1356,6 +1923,9 @@ dtk_bool32 dred_textview_find_and_select_next(dred_textview* pTextView, const ch
         return 0;
     }
 
+    // Every other occurance is highlighted as well.
+    dred_textview_set_match_text(pTextView, text);
+
     size_t selectionStart;
     size_t selectionEnd;
     if (drte_view_find_next(pTextView->pView, text, &selectionStart, &selectionEnd))
@@ -1369,6 +1939,44 @@ dtk_bool32 dred_textview_find_and_select_next(dred_textview* pTextView, const ch
     return DTK_FALSE;
 }
 
+void dred_textview_set_match_text(dred_textview* pTextView, const char* text)
+{
+    if (pTextView == NULL) {
+        return;
+    }
+
+    drte_view_set_match_text(pTextView->pView, text);
+
+    // Small files are searched straight away. Anything left over is done on a timer.
+    if (!drte_view_index_matches(pTextView->pView, DRTE_MATCH_INDEXING_CHUNK_SIZE)) {
+        dred_textview__begin_match_indexing(pTextView);
+    } else {
+        dred_textview__delete_match_indexing_timer(pTextView);
+    }
+
+    if (pTextView->onMatchesChanged) {
+        pTextView->onMatchesChanged(pTextView);
+    }
+}
+
+dtk_bool32 dred_textview_get_match_info(dred_textview* pTextView, size_t* pMatchIndexOut, size_t* pMatchCountOut, dtk_bool32* pIsCompleteOut)
+{
+    if (pMatchIndexOut) *pMatchIndexOut = 0;
+    if (pMatchCountOut) *pMatchCountOut = 0;
+    if (pIsCompleteOut) *pIsCompleteOut = DTK_TRUE;
+
+    if (pTextView == NULL || drte_view_get_match_text(pTextView->pView) == NULL) {
+        return DTK_FALSE;
+    }
+
+    size_t iCursorChar = drte_view_get_cursor_character(pTextView->pView, drte_view_get_last_cursor(pTextView->pView));
+
+    if (pMatchIndexOut) *pMatchIndexOut = drte_view_get_match_count_before_character(pTextView->pView, iCursorChar);
+    if (pMatchCountOut) *pMatchCountOut = drte_view_get_match_count(pTextView->pView);
+    if (pIsCompleteOut) *pIsCompleteOut = drte_view_is_match_index_complete(pTextView->pView);
+    return DTK_TRUE;
+}
+
 dtk_bool32 dred_textview_find_and_replace_next(dred_textview* pTextView, const char* text, const char* replacement)
 {
     if (pTextView == NULL) {
@@ -1401,11 +2009,11 @@ dtk_bool32 dred_textview_find_and_replace_next(dred_textview* pTextView, const c
     return wasTextChanged;
 }
 
-dtk_bool32 dred_textview_find_and_replace_all(dred_textview* pTextView, const char* text, const char* replacement)
+// Replaces every occurance of the given string, or every match of the given regular expression, and then puts the cursor and scroll
+// positions back to where they were.
+dtk_bool32 dred_textview__find_and_replace_all(dred_textview* pTextView, const char* text, const char* replacement, dtk_bool32 isRegex)
 {
-    if (pTextView == NULL) {
-        return 0;
-    }
+    assert(pTextView != NULL);
 
     size_t originalCursorLine = drte_view_get_cursor_line(pTextView->pView, drte_view_get_last_cursor(pTextView->pView));
     size_t originalCursorPos = drte_view_get_cursor_character(pTextView->pView, drte_view_get_last_cursor(pTextView->pView)) - drte_view_get_line_first_character(pTextView->pView, NULL, originalCursorLine);
@@ -1419,19 +2027,19 @@ dtk_bool32 dred_textview_find_and_replace_all(dred_textview* pTextView, const ch
         {
             drte_view_deselect_all(pTextView->pView);
 
-            // It's important that we don't replace the replacement text. To handle this, we just move the cursor to the top of the text and find
-            // and replace every occurance without looping.
-            drte_view_move_cursor_to_start_of_text(pTextView->pView, drte_view_get_last_cursor(pTextView->pView));
-
-            size_t selectionStart;
-            size_t selectionEnd;
-            while (drte_view_find_next_no_loop(pTextView->pView, text, &selectionStart, &selectionEnd))
-            {
-                drte_view_select(pTextView->pView, selectionStart, selectionEnd);
-                drte_view_move_cursor_to_end_of_selection(pTextView->pView, drte_view_get_last_cursor(pTextView->pView));
-
-                wasTextChanged = dred_textview_delete_selected_text_no_undo(pTextView) || wasTextChanged;
-                wasTextChanged = drte_view_insert_text_at_cursor(pTextView->pView, drte_view_get_last_cursor(pTextView->pView), replacement) || wasTextChanged;
+            // Every occurance is found up front and then replaced in a single pass which means the replacement text is never searched.
+            if (isRegex) {
+                drte_regex regex;
+                if (drte_regex_init(&regex, text, 0)) {
+                    wasTextChanged = drte_engine_replace_all_regex(pTextView->pTextEngine, &regex, replacement, 0, pTextView->pTextEngine->textLength) > 0;
+                    drte_regex_uninit(&regex);
+                }
+            } else {
+                drte_search_pattern pattern;
+                if (drte_search_pattern_init(&pattern, text, strlen(text))) {
+                    wasTextChanged = drte_engine_replace_all(pTextView->pTextEngine, &pattern, replacement, 0, pTextView->pTextEngine->textLength) > 0;
+                    drte_search_pattern_uninit(&pattern);
+                }
             }
 
             // The cursor may have moved so we'll need to restore it.
@@ -1457,6 +2065,92 @@ dtk_bool32 dred_textview_find_and_replace_all(dred_textview* pTextView, const ch
     return wasTextChanged;
 }
 
+dtk_bool32 dred_textview_find_and_replace_all(dred_textview* pTextView, const char* text, const char* replacement)
+{
+    if (pTextView == NULL) {
+        return 0;
+    }
+
+    return dred_textview__find_and_replace_all(pTextView, text, replacement, DTK_FALSE);
+}
+
+dtk_bool32 dred_textview_find_and_select_next_regex(dred_textview* pTextView, const char* pattern)
+{
+    if (pTextView == NULL) {
+        return DTK_FALSE;
+    }
+
+    // Only plain text is highlighted so anything left over from a previous search is cleared.
+    dred_textview_set_match_text(pTextView, NULL);
+
+    size_t selectionStart;
+    size_t selectionEnd;
+    if (drte_view_find_next_regex(pTextView->pView, pattern, &selectionStart, &selectionEnd))
+    {
+        drte_view_select(pTextView->pView, selectionStart, selectionEnd);
+        drte_view_move_cursor_to_end_of_selection(pTextView->pView, drte_view_get_last_cursor(pTextView->pView));
+
+        return DTK_TRUE;
+    }
+
+    return DTK_FALSE;
+}
+
+dtk_bool32 dred_textview_find_and_replace_next_regex(dred_textview* pTextView, const char* pattern, const char* replacement)
+{
+    if (pTextView == NULL || replacement == NULL) {
+        return DTK_FALSE;
+    }
+
+    drte_regex regex;
+    if (!drte_regex_init(&regex, pattern, 0)) {
+        return DTK_FALSE;
+    }
+
+    dtk_bool32 wasTextChanged = DTK_FALSE;
+    drte_engine_prepare_undo_point(pTextView->pTextEngine);
+    {
+        drte_view_begin_dirty(pTextView->pView);
+        {
+            drte_view_deselect_all(pTextView->pView);
+
+            size_t selectionStart;
+            size_t selectionEnd;
+            if (drte_view_find_next_regex(pTextView->pView, pattern, &selectionStart, &selectionEnd))
+            {
+                // The replacement can refer to the matched text so it needs to be built before the match is deleted.
+                size_t expandedLength = drte_engine_expand_regex_replacement(pTextView->pTextEngine, &regex, selectionStart, selectionEnd, replacement, NULL, 0);
+                char* expandedReplacement = (char*)malloc(expandedLength + 1);
+                if (expandedReplacement != NULL) {
+                    drte_engine_expand_regex_replacement(pTextView->pTextEngine, &regex, selectionStart, selectionEnd, replacement, expandedReplacement, expandedLength + 1);
+
+                    drte_view_select(pTextView->pView, selectionStart, selectionEnd);
+                    drte_view_move_cursor_to_end_of_selection(pTextView->pView, drte_view_get_last_cursor(pTextView->pView));
+
+                    wasTextChanged = dred_textview_delete_selected_text_no_undo(pTextView) || wasTextChanged;
+                    wasTextChanged = drte_view_insert_text_at_cursor(pTextView->pView, drte_view_get_last_cursor(pTextView->pView), expandedReplacement) || wasTextChanged;
+
+                    free(expandedReplacement);
+                }
+            }
+        }
+        drte_view_end_dirty(pTextView->pView);
+    }
+    if (wasTextChanged) { drte_engine_commit_undo_point(pTextView->pTextEngine); }
+
+    drte_regex_uninit(&regex);
+    return wasTextChanged;
+}
+
+dtk_bool32 dred_textview_find_and_replace_all_regex(dred_textview* pTextView, const char* pattern, const char* replacement)
+{
+    if (pTextView == NULL) {
+        return DTK_FALSE;
+    }
+
+    return dred_textview__find_and_replace_all(pTextView, pattern, replacement, DTK_TRUE);
+}
+
 
 void dred_textview_show_line_numbers(dred_textview* pTextView)
 {
@@ -1710,6 +2404,15 @@ void dred_textview_set_on_undo_point_changed(dred_textview* pTextView, dred_text
     pTextView->onUndoPointChanged = proc;
 }
 
+void dred_textview_set_on_matches_changed(dred_textview* pTextView, dred_textview_on_matches_changed_proc proc)
+{
+    if (pTextView == NULL) {
+        return;
+    }
+
+    pTextView->onMatchesChanged = proc;
+}
+
 
 void dred_textview_on_size(dred_control* pControl, float newWidth, float newHeight)
 {
@@ -2484,13 +3187,34 @@ void dred_textview_engine__on_paint_rect(drte_engine* pTextEngine, drte_view* pV
     float offsetY;
     dred_textview__get_text_offset(pTextView, &offsetX, &offsetY);
 
-    dred_control_draw_rect(DRED_CONTROL(pTextView), dred_offset_rect(drte_rect_to_dred(rect), offsetX, offsetY), pStyle->bgColor, (dtk_surface*)pPaintData);
+    // Culling is only done vertically so that lines are always collected in full, which is required for line tiles.
+    dred_rect relativeRect = dred_offset_rect(drte_rect_to_dred(rect), offsetX, offsetY);
+    if (relativeRect.bottom <= pTextView->textBacking.paintRect.top || relativeRect.top >= pTextView->textBacking.paintRect.bottom) {
+        return;
+    }
+
+    // Cursors are drawn on top of everything else once the text has been drawn.
+    if (pStyle == &pTextView->cursorStyle) {
+        dtk_text_batch_add_rect(&pTextView->cursorBatch, dtk_rect_init((dtk_int32)relativeRect.left, (dtk_int32)relativeRect.top, (dtk_int32)relativeRect.right, (dtk_int32)relativeRect.bottom), pStyle->bgColor);
+        return;
+    }
+
+    if (pTextView->lineTiles.isActive) {
+        if (rect.bottom - rect.top == drte_engine_get_line_height(pTextEngine)) {
+            dred_textview__hash_line_tile_data(pTextView, relativeRect.top, &rect.left,  sizeof(rect.left),  (dtk_surface*)pPaintData);
+            dred_textview__hash_line_tile_data(pTextView, relativeRect.top, &rect.right, sizeof(rect.right), (dtk_surface*)pPaintData);
+            dred_textview__hash_line_tile_data(pTextView, relativeRect.top, &pStyle->bgColor, sizeof(pStyle->bgColor), (dtk_surface*)pPaintData);
+        } else {
+            // Not part of a line. This is the region below the last line.
+            dred_textview__end_line_tile(pTextView, (dtk_surface*)pPaintData);
+        }
+    }
+
+    dtk_text_batch_add_rect(&pTextView->textBatch, dtk_rect_init((dtk_int32)relativeRect.left, (dtk_int32)relativeRect.top, (dtk_int32)relativeRect.right, (dtk_int32)relativeRect.bottom), pStyle->bgColor);
 }
 
 void dred_textview_engine__on_paint_text(drte_engine* pTextEngine, drte_view* pView, drte_style_token styleTokenFG, drte_style_token styleTokenBG, const char* text, size_t textLength, float posX, float posY, void* pPaintData)
 {
-    (void)pTextEngine;
-
     dred_textview* pTextView = (dred_textview*)pView->pUserData;
 
     dred_text_style* pStyleFG = (dred_text_style*)styleTokenFG;
@@ -2500,7 +3224,24 @@ void dred_textview_engine__on_paint_text(drte_engine* pTextEngine, drte_view* pV
     float offsetY;
     dred_textview__get_text_offset(pTextView, &offsetX, &offsetY);
 
-    dred_control_draw_text(DRED_CONTROL(pTextView), pStyleFG->pFont, pView->scale, text, (int)textLength, posX + offsetX, posY + offsetY, pStyleFG->fgColor, pStyleBG->bgColor, (dtk_surface*)pPaintData);
+    // Only the vertical extent of the text is known without measuring it which is enough to skip lines outside of the painted region.
+    float lineHeight = drte_engine_get_line_height(pTextEngine);
+    if (posY + offsetY >= pTextView->textBacking.paintRect.bottom || posY + offsetY + lineHeight <= pTextView->textBacking.paintRect.top) {
+        return;
+    }
+
+    if (pTextView->lineTiles.isActive) {
+        float lineTop = posY + offsetY;
+        dred_textview__hash_line_tile_data(pTextView, lineTop, &pStyleFG->pFont, sizeof(pStyleFG->pFont), (dtk_surface*)pPaintData);
+        dred_textview__hash_line_tile_data(pTextView, lineTop, &pView->scale, sizeof(pView->scale), (dtk_surface*)pPaintData);
+        dred_textview__hash_line_tile_data(pTextView, lineTop, &posX, sizeof(posX), (dtk_surface*)pPaintData);
+        dred_textview__hash_line_tile_data(pTextView, lineTop, &pStyleFG->fgColor, sizeof(pStyleFG->fgColor), (dtk_surface*)pPaintData);
+        dred_textview__hash_line_tile_data(pTextView, lineTop, &pStyleBG->bgColor, sizeof(pStyleBG->bgColor), (dtk_surface*)pPaintData);
+        dred_textview__hash_line_tile_data(pTextView, lineTop, &textLength, sizeof(textLength), (dtk_surface*)pPaintData);
+        dred_textview__hash_line_tile_data(pTextView, lineTop, text, textLength, (dtk_surface*)pPaintData);
+    }
+
+    dtk_text_batch_add_text(&pTextView->textBatch, pStyleFG->pFont, pView->scale, text, textLength, (dtk_int32)(posX + offsetX), (dtk_int32)(posY + offsetY), pStyleFG->fgColor, pStyleBG->bgColor);
 }
 
 void dred_textview_engine__on_dirty(drte_engine* pTextEngine, drte_view* pView, drte_rect rect)
@@ -2516,7 +3257,15 @@ void dred_textview_engine__on_dirty(drte_engine* pTextEngine, drte_view* pView,
     float offsetY;
     dred_textview__get_text_offset(pTextView, &offsetX, &offsetY);
 
+    // While scrolling the backing surface is shifted instead, which leaves only the uncovered region to be redrawn.
+    if (!pTextView->isScrolling) {
+        dred_textview__invalidate_backing_surface(&pTextView->textBacking, drte_rect_to_dred(rect));
+    }
+
     dred_control_dirty(DRED_CONTROL(pTextView), dred_offset_rect(drte_rect_to_dred(rect), offsetX, offsetY));
+
+    // Lines left unwrapped after a change in width are wrapped in the background. Every such change leads to a redraw.
+    dred_textview__begin_word_wrapping(pTextView);
 }
 
 void dred_textview_engine__on_cursor_move(drte_engine* pTextEngine, drte_view* pView, size_t iCursor)
@@ -2575,7 +3324,16 @@ void dred_textview__on_text_changed(dred_textview* pTextView)
 
     // The line numbers need to be redrawn.
     // TODO: This can probably be optimized a bit so that it is only redrawn if a line was inserted or deleted.
-    dred_control_dirty(pTextView->pLineNumbers, dred_control_get_local_rect(pTextView->pLineNumbers));
+    dred_textview__dirty_line_numbers(pTextView);
+
+    // The engine keeps the match index up to date with small edits, but large ones are left for the timer to finish off.
+    if (drte_view_get_match_text(pTextView->pView) != NULL) {
+        dred_textview__begin_match_indexing(pTextView);
+
+        if (pTextView->onMatchesChanged) {
+            pTextView->onMatchesChanged(pTextView);
+        }
+    }
 }
 
 size_t dred_textview__on_get_undo_state(dred_textview* pTextView, void* pDataOut)
@@ -2639,9 +3397,72 @@ void dred_textview_on_paint(dred_control* pControl, dred_rect relativeRect, dtk_
     dred_rect paddingRect = dred_grow_rect(textRect, pTextView->padding);
     dred_control_draw_rect_outline(pControl, paddingRect, pTextView->defaultStyle.bgColor, pTextView->padding, pSurface);
 
-    // Text.
-    dred_control_set_clip(pControl, dred_clamp_rect(textRect, relativeRect), pSurface);
-    drte_view_paint(pTextView->pView, dred_rect_to_drte(dred_offset_rect(dred_clamp_rect(textRect, relativeRect), -textRect.left, -textRect.top)), pSurface);
+    // Text. The engine's paint callbacks fill the text batch which is then drawn in one go. Normally this is drawn into the backing
+    // surface and only for the regions that have changed since the last paint, after which the whole surface is copied to the window.
+    dred_textview_backing_surface* pBacking = &pTextView->textBacking;
+    float textWidth  = textRect.right  - textRect.left;
+    float textHeight = textRect.bottom - textRect.top;
+    if (dred_textview__prepare_backing_surface(pTextView, pBacking, textWidth, textHeight, drte_view_get_inner_offset_x(pTextView->pView), drte_view_get_inner_offset_y(pTextView->pView))) {
+        if (dred_rect_has_volume(pBacking->dirtyRect)) {
+            pBacking->paintRect = dred_offset_rect(pBacking->dirtyRect, textRect.left, textRect.top);
+
+            // Lines that haven't changed since they were last drawn are copied from the line tile cache. Tiles are one line tall which
+            // means they can't be used when the line height is fractional.
+            float lineHeight = drte_engine_get_line_height(pTextView->pTextEngine);
+            dred_textview_line_tile_cache* pLineTiles = &pTextView->lineTiles;
+            pLineTiles->isActive = lineHeight == (float)(dtk_uint32)lineHeight && dred_textview__prepare_line_tiles(pTextView, pBacking->surface.width, (dtk_uint32)lineHeight, pBacking->surface.height);
+            pLineTiles->originX = textRect.left;
+            pLineTiles->originY = textRect.top;
+            pLineTiles->pendingTileCount = 0;
+
+            // The backing surface is positioned at the top left of the text rectangle, but the paint callbacks draw relative to the control.
+            dtk_surface_push(&pBacking->surface);
+            dtk_surface_translate(&pBacking->surface, (dtk_int32)-textRect.left, (dtk_int32)-textRect.top);
+            dred_control_set_clip(pControl, pBacking->paintRect, &pBacking->surface);
+
+            dtk_text_batch_clear(&pTextView->textBatch);
+            dtk_text_batch_clear(&pTextView->cursorBatch);
+            drte_view_paint(pTextView->pView, dred_rect_to_drte(pBacking->dirtyRect), &pBacking->surface);
+            if (pLineTiles->isActive) {
+                dred_textview__end_line_tile(pTextView, &pBacking->surface);
+            }
+            dtk_surface_draw_text_batch(&pBacking->surface, &pTextView->textBatch);
+            dtk_text_batch_clear(&pTextView->textBatch);
+
+            dtk_surface_pop(&pBacking->surface);
+
+            // The lines need to be copied into the cache before the cursors are drawn on top of them.
+            if (pLineTiles->isActive) {
+                dred_textview__store_pending_line_tiles(pTextView);
+                pLineTiles->isActive = DTK_FALSE;
+            }
+
+            if (pTextView->cursorBatch.rectCount > 0) {
+                dtk_surface_push(&pBacking->surface);
+                dtk_surface_translate(&pBacking->surface, (dtk_int32)-textRect.left, (dtk_int32)-textRect.top);
+                dred_control_set_clip(pControl, pBacking->paintRect, &pBacking->surface);
+                dtk_surface_draw_text_batch(&pBacking->surface, &pTextView->cursorBatch);
+                dtk_surface_pop(&pBacking->surface);
+                dtk_text_batch_clear(&pTextView->cursorBatch);
+            }
+
+            pBacking->dirtyRect = dred_make_inside_out_rect();
+        }
+
+        dred_control_set_clip(pControl, dred_clamp_rect(textRect, relativeRect), pSurface);
+        dred_textview__present_backing_surface(pBacking, textRect.left, textRect.top, pSurface);
+    } else {
+        pBacking->paintRect = dred_clamp_rect(textRect, relativeRect);
+
+        dred_control_set_clip(pControl, pBacking->paintRect, pSurface);
+        dtk_text_batch_clear(&pTextView->textBatch);
+        dtk_text_batch_clear(&pTextView->cursorBatch);
+        drte_view_paint(pTextView->pView, dred_rect_to_drte(dred_offset_rect(pBacking->paintRect, -textRect.left, -textRect.top)), pSurface);
+        dtk_surface_draw_text_batch(pSurface, &pTextView->textBatch);
+        dtk_surface_draw_text_batch(pSurface, &pTextView->cursorBatch);
+        dtk_text_batch_clear(&pTextView->textBatch);
+        dtk_text_batch_clear(&pTextView->cursorBatch);
+    }
 }
 
 
@@ -3009,13 +3830,16 @@ void dred_textview__on_paint_rect_line_numbers(drte_engine* pEngine, drte_view*
     float offsetX = pTextView->padding;
     float offsetY = pTextView->padding;
 
-    dred_control_draw_rect(pTextView->pLineNumbers, dred_offset_rect(drte_rect_to_dred(rect), offsetX, offsetY), pStyle->bgColor, (dtk_surface*)pPaintData);
+    dred_rect relativeRect = dred_offset_rect(drte_rect_to_dred(rect), offsetX, offsetY);
+    if (dred_textview__is_culled(&pTextView->lineNumbersBacking, relativeRect)) {
+        return;
+    }
+
+    dred_control_draw_rect(pTextView->pLineNumbers, relativeRect, pStyle->bgColor, (dtk_surface*)pPaintData);
 }
 
 void dred_textview__on_paint_text_line_numbers(drte_engine* pEngine, drte_view* pView, drte_style_token styleTokenFG, drte_style_token styleTokenBG, const char* text, size_t textLength, float posX, float posY, void* pPaintData)
 {
-    (void)pEngine;
-
     dred_textview* pTextView = (dred_textview*)pView->pUserData;
 
     dred_text_style* pStyleFG = (dred_text_style*)styleTokenFG;
@@ -3026,6 +3850,11 @@ void dred_textview__on_paint_text_line_numbers(drte_engine* pEngine, drte_view*
     float offsetX = pTextView->padding;
     float offsetY = pTextView->padding;
 
+    float lineHeight = drte_engine_get_line_height(pEngine);
+    if (posY + offsetY >= pTextView->lineNumbersBacking.paintRect.bottom || posY + offsetY + lineHeight <= pTextView->lineNumbersBacking.paintRect.top) {
+        return;
+    }
+
     dred_control_draw_text(pTextView->pLineNumbers, pStyleFG->pFont, pView->scale, text, (int)textLength, posX + offsetX, posY + offsetY, pStyleFG->fgColor, pStyleBG->bgColor, (dtk_surface*)pPaintData);
 }
 
@@ -3039,7 +3868,26 @@ void dred_textview__on_paint_line_numbers(dred_control* pLineNumbers, dred_rect
     float lineNumbersWidth  = dred_control_get_width(pLineNumbers) - (pTextView->padding*2) - pTextView->lineNumbersPaddingRight;
     float lineNumbersHeight = dred_control_get_height(pLineNumbers) - (pTextView->padding*2);
 
-    drte_view_paint_line_numbers(pTextView->pView, lineNumbersWidth, lineNumbersHeight, dred_textview__on_paint_text_line_numbers, dred_textview__on_paint_rect_line_numbers, pSurface);
+    // The line numbers are drawn into their own backing surface in the same way as the text.
+    dred_textview_backing_surface* pBacking = &pTextView->lineNumbersBacking;
+    if (dred_textview__prepare_backing_surface(pTextView, pBacking, lineNumbersWidth, lineNumbersHeight, 0, drte_view_get_inner_offset_y(pTextView->pView))) {
+        if (dred_rect_has_volume(pBacking->dirtyRect)) {
+            pBacking->paintRect = dred_offset_rect(pBacking->dirtyRect, pTextView->padding, pTextView->padding);
+
+            dtk_surface_push(&pBacking->surface);
+            dtk_surface_translate(&pBacking->surface, (dtk_int32)-pTextView->padding, (dtk_int32)-pTextView->padding);
+            dred_control_set_clip(pLineNumbers, pBacking->paintRect, &pBacking->surface);
+            drte_view_paint_line_numbers(pTextView->pView, lineNumbersWidth, lineNumbersHeight, dred_textview__on_paint_text_line_numbers, dred_textview__on_paint_rect_line_numbers, &pBacking->surface);
+            dtk_surface_pop(&pBacking->surface);
+
+            pBacking->dirtyRect = dred_make_inside_out_rect();
+        }
+
+        dred_textview__present_backing_surface(pBacking, pTextView->padding, pTextView->padding, pSurface);
+    } else {
+        pBacking->paintRect = dred_control_get_local_rect(pLineNumbers);
+        drte_view_paint_line_numbers(pTextView->pView, lineNumbersWidth, lineNumbersHeight, dred_textview__on_paint_text_line_numbers, dred_textview__on_paint_rect_line_numbers, pSurface);
+    }
 
     dred_control_draw_rect_outline(pLineNumbers, dred_control_get_local_rect(pLineNumbers), pTextView->lineNumbersStyle.bgColor, pTextView->padding, pSurface);
 
@@ -3074,6 +3922,8 @@ void dred_textview__refresh_line_numbers(dred_textview* pTextView)
 
 
     // Force a redraw just to be sure everything is in a valid state.
+    dred_textview__invalidate_entire_backing_surface(&pTextView->textBacking);
+    dred_textview__invalidate_entire_backing_surface(&pTextView->lineNumbersBacking);
     dred_control_dirty(DRED_CONTROL(pTextView), dred_rect_union(lineNumbersRectOld, dred_control_get_local_rect(pTextView->pLineNumbers)));
     //dred_control_end_dirty(pTextView->pLineNumbers);
 }
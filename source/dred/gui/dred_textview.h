@@ -7,6 +7,7 @@ typedef struct dred_textview dred_textview;
 
 typedef void (* dred_textview_on_cursor_move_proc)(dred_textview* pTextView);
 typedef void (* dred_textview_on_undo_point_changed_proc)(dred_textview* pTextView, unsigned int iUndoPoint);
+typedef void (* dred_textview_on_matches_changed_proc)(dred_textview* pTextView);
 
 // A cursor in a textbox is tied to either 1 or 0 selection regions. When a cursor is not associated with a selection, the
 // index of the selection region is set to -1.
@@ -16,6 +17,79 @@ typedef struct
     size_t iEngineSelection;     // <-- Set to -1 if the cursor is not associated with a selection.
 } dred_textview_cursor;
 
+// An offscreen copy of a region of the text view. When the view is scrolled the existing pixels are moved and only the region that
+// was uncovered needs to be redrawn.
+typedef struct
+{
+    // The image holding the rendered pixels. Only valid when isInitialized is set.
+    dtk_surface surface;
+    dtk_bool32 isInitialized;
+
+    // The inner offset of the view at the time the surface was last brought up to date.
+    float innerOffsetX;
+    float innerOffsetY;
+
+    // The region of the surface that needs to be redrawn before it can be presented. Inside out when nothing is dirty.
+    dred_rect dirtyRect;
+
+    // The region being redrawn, relative to the control being painted. Anything outside of this is skipped.
+    dred_rect paintRect;
+} dred_textview_backing_surface;
+
+// A line that has been rendered before and is stored in the line tile cache.
+typedef struct
+{
+    // Identifies the text, styles and positions the line was rendered from. Any change in content, highlighting or selection
+    // leads to a different hash.
+    dtk_uint64 hash;
+
+    // The value of the cache's use counter the last time this tile was drawn. The tile with the lowest value is replaced first.
+    dtk_uint64 lastUsed;
+} dred_textview_line_tile;
+
+// A line that was drawn in full and needs to be copied into the line tile cache once the text batch has been drawn.
+typedef struct
+{
+    dtk_uint64 hash;
+    float posY;
+} dred_textview_pending_line_tile;
+
+// Caches rendered lines so that lines that are redrawn without changing, such as those under a blinking cursor or outside of a
+// changed selection, are copied rather than drawn from scratch. Every tile is the same size and they are stacked vertically in a
+// single atlas.
+typedef struct
+{
+    dtk_surface atlas;
+    dtk_bool32 isInitialized;
+    dtk_uint32 tileWidth;
+    dtk_uint32 tileHeight;
+
+    dred_textview_line_tile* pTiles;
+    size_t tileCount;
+    size_t tileCapacity;
+    dtk_uint64 useCounter;
+
+    // Whether or not lines are being collected by the paint callbacks. This is only set while painting into the backing surface.
+    dtk_bool32 isActive;
+
+    // The position of the text rectangle, relative to the control. Tiles start at the left edge of the text rectangle.
+    float originX;
+    float originY;
+
+    // The line currently being collected. Its runs and rectangles are added to the text batch as usual and removed again if a
+    // matching tile is found.
+    dtk_bool32 isCollectingLine;
+    float lineTop;
+    dtk_uint64 lineHash;
+    size_t lineRunStart;
+    size_t lineRectStart;
+    size_t lineTextStart;
+
+    dred_textview_pending_line_tile* pPendingTiles;
+    size_t pendingTileCount;
+    size_t pendingTileCapacity;
+} dred_textview_line_tile_cache;
+
 struct dred_textview
 {
     // The base control.
@@ -35,6 +109,9 @@ struct dred_textview
     // The style to apply to selected text. Only the background color is used.
     dred_text_style selectionStyle;
 
+    // The style to apply to occurances of the text being searched for. Only the background color is used.
+    dred_text_style matchStyle;
+
     // The style to apply to active lines.
     dred_text_style activeLineStyle;
 
@@ -133,9 +210,35 @@ struct dred_textview
     /// The function to call when the undo point changes.
     dred_textview_on_undo_point_changed_proc onUndoPointChanged;
 
+    // The function to call when the occurances of the match text have changed.
+    dred_textview_on_matches_changed_proc onMatchesChanged;
+
 
     // The timer for stepping the cursor.
     dtk_timer* pTimer;
+
+    // The timer for finding occurances of the match text a chunk at a time. This is only non-null while the index is incomplete.
+    dtk_timer* pMatchIndexingTimer;
+
+    // The timer for wrapping lines a chunk at a time after the width of the text changes. This is only non-null while wrapping is incomplete.
+    dtk_timer* pWordWrappingTimer;
+
+    // The text and backgrounds of the lines being painted are collected here and drawn together once the text engine has finished.
+    dtk_text_batch textBatch;
+
+    // The backing surfaces for the text area and the line numbers.
+    dred_textview_backing_surface textBacking;
+    dred_textview_backing_surface lineNumbersBacking;
+
+    // Rendered lines of the text area.
+    dred_textview_line_tile_cache lineTiles;
+
+    // Cursors are drawn after everything else so that they don't end up in the line tiles.
+    dtk_text_batch cursorBatch;
+
+    // Whether or not the inner offset of the view is being changed by the scrollbars. While this is set the backing surfaces are
+    // shifted rather than redrawn.
+    dtk_bool32 isScrolling;
 };
 
 
@@ -174,6 +277,9 @@ void dred_textview_set_selection_background_color(dred_textview* pTextView, dtk_
 // Retrieves the background color of selected text.
 dtk_color dred_textview_get_selection_background_color(dred_textview* pTextView);
 
+// Sets the background color of occurances of the match text.
+void dred_textview_set_match_background_color(dred_textview* pTextView, dtk_color color);
+
 // Sets the background color for the line the caret is currently sitting on.
 void dred_textview_set_active_line_background_color(dred_textview* pTextView, dtk_color color);
 
@@ -262,6 +368,10 @@ dtk_bool32 dred_textview_is_drag_and_drop_enabled(dred_textview* pTextView);
 // Sets the text of the given text box.
 void dred_textview_set_text(dred_textview* pTextView, const char* text);
 
+// Sets the text of the given text box without copying it or indexing it's lines. See drte_engine_set_text_no_copy_unindexed(). Unlike
+// dred_textview_set_text(), this is not undoable and clears the undo stack.
+dtk_bool32 dred_textview_set_text_no_copy(dred_textview* pTextView, const char* text, size_t textLength, drte_engine_on_free_text_proc onFree, void* pUserData);
+
 // Retrieves the text of the given text box.
 size_t dred_textview_get_text(dred_textview* pTextView, char* pTextOut, size_t textOutSize);
 
@@ -370,6 +480,23 @@ dtk_bool32 dred_textview_find_and_replace_next(dred_textview* pTextView, const c
 // Finds every occurance of the given string and replaces it with another.
 dtk_bool32 dred_textview_find_and_replace_all(dred_textview* pTextView, const char* text, const char* replacement);
 
+// The regular expression versions of the functions above. See drte_regex_init() for the supported syntax. "\0" to "\9" in the
+// replacement are replaced with the text of the respective capture group. Empty matches are skipped when finding the next match.
+dtk_bool32 dred_textview_find_and_select_next_regex(dred_textview* pTextView, const char* pattern);
+dtk_bool32 dred_textview_find_and_replace_next_regex(dred_textview* pTextView, const char* pattern, const char* replacement);
+dtk_bool32 dred_textview_find_and_replace_all_regex(dred_textview* pTextView, const char* pattern, const char* replacement);
+
+// Sets the text whose every occurance is highlighted. Pass NULL or an empty string to clear it. Occurances are found incrementally
+// on a timer so this returns immediately, even for large files.
+void dred_textview_set_match_text(dred_textview* pTextView, const char* text);
+
+// Retrieves the match counter for the info bar. <pMatchIndexOut> is set to the number of occurances starting before the cursor, which
+// is the 1-based index of the occurance that was just selected by dred_textview_find_and_select_next().
+//
+// Returns DTK_FALSE if there is no match text. <pIsCompleteOut> is set to DTK_FALSE while the remainder of the text is still being
+// searched, in which case <pMatchCountOut> is only a lower bound.
+dtk_bool32 dred_textview_get_match_info(dred_textview* pTextView, size_t* pMatchIndexOut, size_t* pMatchCountOut, dtk_bool32* pIsCompleteOut);
+
 
 // Shows the line numbers.
 void dred_textview_show_line_numbers(dred_textview* pTextView);
@@ -448,6 +575,9 @@ void dred_textview_set_on_cursor_move(dred_textview* pTextView, dred_textview_on
 // Sets the function to call when the undo point changes.
 void dred_textview_set_on_undo_point_changed(dred_textview* pTextView, dred_textview_on_undo_point_changed_proc proc);
 
+// Sets the function to call when the occurances of the match text have changed.
+void dred_textview_set_on_matches_changed(dred_textview* pTextView, dred_textview_on_matches_changed_proc proc);
+
 
 
 // on_size.
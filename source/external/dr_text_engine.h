@@ -61,6 +61,7 @@ typedef drte_uint32      drte_bool32;
 
 typedef struct drte_engine drte_engine;
 typedef struct drte_view drte_view;
+typedef struct drte_lexed_line drte_lexed_line;
 typedef uintptr_t drte_style_token;
 
 typedef enum
@@ -109,7 +110,7 @@ typedef struct
 typedef void   (* drte_engine_on_measure_string_proc)(drte_engine* pEngine, drte_style_token styleToken, float scale, const char* text, size_t textLength, int* pWidthOut, int* pHeightOut);
 typedef void   (* drte_engine_on_get_cursor_position_from_point_proc)(drte_engine* pEngine, drte_style_token styleToken, float scale, const char* text, size_t textSizeInBytes, float maxWidth, float inputPosX, float* pTextCursorPosXOut, size_t* pCharacterIndexOut);
 typedef void   (* drte_engine_on_get_cursor_position_from_char_proc)(drte_engine* pEngine, drte_style_token styleToken, float scale, const char* text, size_t characterIndex, float* pTextCursorPosXOut);
-typedef drte_bool32   (* drte_engine_on_get_next_highlight_proc)(drte_engine* pEngine, size_t iChar, size_t* pCharBegOut, size_t* pCharEndOut, drte_style_token* pStyleTokenOut, void* pUserData);
+typedef uint32_t (* drte_engine_on_lex_line_proc)(drte_engine* pEngine, uint32_t state, const char* text, size_t textLength, drte_lexed_line* pLine, void* pUserData);
 
 typedef void   (* drte_engine_on_paint_text_proc)        (drte_engine* pEngine, drte_view* pView, drte_style_token styleTokenFG, drte_style_token styleTokenBG, const char* text, size_t textLength, float posX, float posY, void* pPaintData);
 typedef void   (* drte_engine_on_paint_rect_proc)        (drte_engine* pEngine, drte_view* pView, drte_style_token styleToken, drte_rect rect, void* pPaintData);
@@ -120,6 +121,8 @@ typedef void   (* drte_engine_on_undo_point_changed_proc)(drte_engine* pEngine,
 typedef size_t (* drte_engine_on_get_undo_state_proc)    (drte_engine* pEngine, void* pDataOut);
 typedef void   (* drte_engine_on_apply_undo_state_proc)  (drte_engine* pEngine, size_t dataSize, const void* pData);
 typedef void   (* drte_engine_on_undo_stack_trimmed_proc)(drte_engine* pEngine);
+typedef void   (* drte_engine_on_undo_points_evicted_proc)(drte_engine* pEngine, unsigned int evictedCount);
+typedef void   (* drte_engine_on_free_text_proc)         (drte_engine* pEngine, const char* text, size_t textLength, void* pUserData);
 
 typedef struct
 {
@@ -141,6 +144,16 @@ typedef struct
     size_t iCharEnd;
 } drte_region;
 
+// A single edit for drte_view_apply_edits(). The <deleteLength> characters starting at <iChar> are replaced with the first <textLength>
+// bytes of <text>.
+typedef struct
+{
+    size_t iChar;
+    size_t deleteLength;
+    const char* text;
+    size_t textLength;
+} drte_edit;
+
 typedef struct
 {
     // The index of the first character in the segment.
@@ -166,7 +179,11 @@ typedef struct
 typedef enum
 {
 	drte_undo_change_type_insert,
-	drte_undo_change_type_delete
+	drte_undo_change_type_delete,
+	drte_undo_change_type_replace,
+	drte_undo_change_type_replace_regions,
+	drte_undo_change_type_insert_compressed,
+	drte_undo_change_type_delete_compressed
 } drte_undo_change_type;
 
 typedef struct
@@ -177,15 +194,224 @@ typedef struct
 	size_t textOffset;
 } drte_undo_change;
 
+// Statistics about the memory used by the undo/redo stack. Retrieve with drte_engine_get_undo_stats().
+typedef struct
+{
+	unsigned int undoPointCount;
+	unsigned int redoPointCount;
+	unsigned int evictedPointCount;     // The number of undo points that have been discarded to stay within the memory budget.
+	size_t sizeInBytes;                 // The number of bytes used by the undo points that are still on the stack.
+	size_t allocatedSizeInBytes;        // The number of bytes allocated for the undo stack, including the prepared undo point.
+	size_t memoryBudget;                // 0 when there is no limit.
+	size_t textSizeInBytes;             // The size of the text stored in the text changes, before compression.
+	size_t storedTextSizeInBytes;       // The size of the same text as it is actually stored.
+} drte_undo_stats;
+
+
+// A search pattern which has been prepared for use with drte_engine_find(). Initialize with drte_search_pattern_init().
+typedef struct
+{
+	char* pText;
+	size_t length;
+	size_t skip[256];
+	char* pWindow;      // Used internally for finding matches that straddle the pieces of the engine's text.
+} drte_search_pattern;
+
+
+// The number of recently measured segments each view remembers. Must be a power of two.
+#ifndef DRTE_MEASURED_SEGMENT_CACHE_SIZE
+#define DRTE_MEASURED_SEGMENT_CACHE_SIZE    256
+#endif
+
+// A run of text that has been measured by the backend. Used internally by drte_engine__measure_segment().
+typedef struct
+{
+	size_t iCharBeg;
+	size_t iCharEnd;    // Zero for unused entries.
+	float scale;
+	float width;
+	uint8_t fgStyleSlot;
+} drte_measured_segment;
+
+// Segments never cross a multiple of this many characters from the start of their line. On lines longer than this the position of
+// each of these boundaries is remembered as it's passed so that painting and hit testing can start part way through the line instead
+// of measuring everything before it.
+#ifndef DRTE_LINE_CHECKPOINT_INTERVAL
+#define DRTE_LINE_CHECKPOINT_INTERVAL       4096
+#endif
+
+// A segment boundary on a long line that segment iteration can be started from. Used internally by drte_view.
+typedef struct
+{
+	size_t iChar;       // Relative to the start of the line.
+	float posX;
+} drte_line_checkpoint;
+
+// The checkpoints of a line longer than DRTE_LINE_CHECKPOINT_INTERVAL characters. Used internally by drte_view.
+typedef struct
+{
+	size_t iLine;
+	drte_line_checkpoint* pCheckpoints;     // In order. The first one is always the start of the line.
+	size_t checkpointCount;
+	size_t checkpointBufferSize;
+	float width;        // The width of the whole line, or negative if nothing has walked to the end of it yet.
+} drte_long_line;
+
+// The number of lines whose highlighting tokens are kept by the engine. Must be a power of 2.
+#ifndef DRTE_LEXED_LINE_CACHE_SIZE
+#define DRTE_LEXED_LINE_CACHE_SIZE          128
+#endif
+
+// A run of characters on a line to be styled by the highlighter. Offsets are relative to the start of the line.
+typedef struct
+{
+	size_t iCharBeg;
+	size_t iCharEnd;
+	drte_style_token styleToken;
+} drte_lexer_token;
+
+// The highlighting tokens of a line, in order. See drte_engine_set_highlighter().
+struct drte_lexed_line
+{
+	size_t iLine;       // (size_t)-1 for unused entries.
+	size_t tokenCount;
+	size_t tokenBufferSize;
+	drte_lexer_token* pTokens;
+};
+
+// A run of lines to be lexed in the background. See drte_engine_get_lexer_job().
+typedef struct
+{
+	drte_engine* pEngine;
+	drte_engine_on_lex_line_proc onLexLine;
+	void* pUserData;
+	size_t version;     // The version of the engine's lexer states the job was taken from.
+	size_t iFirstLine;
+	uint32_t state;     // The state of the lexer at the start of the first line.
+	const char* text;   // Whole lines, each ending with a new line character.
+	size_t textLength;
+	size_t lineCount;
+} drte_lexer_job;
+
+
+// Flags for drte_regex_init().
+#define DRTE_REGEX_CASE_INSENSITIVE     (1 << 0)
+
+// The maximum number of capture groups in a regular expression, including group 0 which is the whole match.
+#define DRTE_REGEX_MAX_GROUPS           10
+
+typedef struct drte_regex_dfa_state drte_regex_dfa_state;
+
+typedef struct
+{
+	drte_uint8 op;
+	drte_uint8 arg;
+	drte_uint32 x;
+	drte_uint32 y;
+} drte_regex_inst;
+
+// A compiled program along with the DFA states that have been built from it so far. States are only built when a search first
+// needs them, and are thrown away when they take up too much memory.
+typedef struct
+{
+	drte_regex_inst* pInsts;
+	drte_uint32 instCount;
+	drte_bool32 isLongest;          // When set the DFA reports the longest match instead of the leftmost-first one.
+	drte_uint32 flagsMask;          // The DFA state flags that the program actually depends on.
+
+	drte_regex_dfa_state** pStates; // Hash table.
+	size_t stateCount;
+	size_t stateCapacity;
+	size_t stateMemory;
+
+	drte_uint32* pScratch;          // Used while building states. Sized for the closure stack, the next state and the visited stamps.
+	drte_uint32 visitStamp;
+} drte_regex_program;
+
+// A regular expression which has been compiled for use with drte_engine_find_regex(). Initialize with drte_regex_init().
+typedef struct
+{
+	char* pPattern;
+	unsigned int flags;
+	size_t groupCount;              // Including group 0.
+	drte_uint8* pClasses;           // 256-bit sets of bytes used by character class instructions.
+	size_t classCount;
+	drte_uint8 byteClasses[256];    // Bytes are grouped into classes that can't be told apart by the program. DFA transitions are per class.
+	drte_uint8 byteClassReps[256];  // A byte from each class.
+	size_t byteClassCount;
+	drte_regex_program forward;     // Finds where the leftmost match ends. Also used for finding capture groups.
+	drte_regex_program reverse;     // Runs backwards from the end of a match to find where it starts.
+} drte_regex;
+
 
 // Used internally for caching lines. APIs for working on line caches are private.
+typedef struct drte_line_cache_node drte_line_cache_node;
+
 typedef struct
 {
-	size_t* pLines;
-	size_t bufferSize;
+	drte_line_cache_node* pRoot;
+	size_t height;
 	size_t count;
+	drte_line_cache_node* pSpareNodes;
+	size_t spareNodeCount;
 } drte_line_cache;
 
+
+// Used internally for storing the text of an engine. APIs for working on piece tables are private.
+//
+// The text is described by a list of pieces, each of which references a run of characters in either the original buffer, which
+// is never modified, or the add buffer, which is only ever appended to. An edit only ever touches the end of the add buffer and
+// the piece list which means the cost of an edit is proportional to the size of the edit rather than the size of the document.
+typedef struct
+{
+    // The offset of the piece's text within it's buffer.
+    size_t offset;
+
+    // The length of the piece in bytes.
+    size_t length;
+
+    // The buffer the piece refers to. Either DRTE_PIECE_BUFFER_ORIGINAL or DRTE_PIECE_BUFFER_ADD.
+    drte_uint32 buffer;
+} drte_piece;
+
+typedef struct drte_piece_table_node drte_piece_table_node;
+
+// Refers to a piece and where it sits in the text. Pieces don't store their own position so it's tracked while walking the pieces.
+typedef struct
+{
+    drte_piece_table_node* pLeaf;
+    drte_uint32 iPiece;         // The index of the piece within it's leaf.
+    size_t iCharBeg;            // The index of the first character of the piece, relative to the start of the text.
+    const drte_piece* pPiece;
+} drte_piece_cursor;
+
+typedef struct
+{
+    const char* pOriginal;
+    size_t originalLength;
+    drte_bool32 isOriginalBorrowed;     // When set, the original buffer is owned by the application and is not freed by the piece table.
+
+    char* pAdd;
+    size_t addLength;
+    size_t addBufferSize;
+
+    drte_piece_table_node* pRoot;
+    size_t height;
+    drte_piece_table_node* pSpareNodes;
+    size_t spareNodeCount;
+
+    // The total length of the text.
+    size_t length;
+
+    // The most recently accessed piece. Most access is sequential so this is checked first before walking down the tree. This is
+    // cleared by every edit.
+    drte_piece_cursor lastPiece;
+
+    // Used when a contiguous run of text is requested but the run straddles more than one piece.
+    char* pScratch;
+    size_t scratchBufferSize;
+} drte_piece_table;
+
 struct drte_view
 {
     // A pointer to the engine that owns this view.
@@ -241,6 +467,44 @@ struct drte_view
     drte_rect _accumulatedDirtyRect;
     drte_line_cache _wrappedLines;
     drte_line_cache* pWrappedLines;     // Points to _wrappedLines if word wrap is enabled; points to pEngine->_unwrappedLines when word wrap is disabled.
+    drte_search_pattern _findPattern;   // The pattern of the most recent call to drte_view_find_next(). Kept so it doesn't need to be prepared again.
+    drte_regex _findRegex;              // Likewise for drte_view_find_next_regex().
+    size_t _iNextLineToWrap;            // Unwrapped lines before this have been wrapped against the current size of the view. Set to (size_t)-1 when every line has been.
+
+    // The widths of the lines of the view, indexed by line, and of recently measured segments. These are kept so that layout queries
+    // don't need to go back to the backend for text that hasn't changed. Lines that haven't been measured have a negative width.
+    float* _pLineWidths;
+    size_t _lineWidthCount;
+    size_t _lineWidthBufferSize;
+    float _lineWidthScale;              // The scale the line widths were measured at.
+    drte_measured_segment _measuredSegments[DRTE_MEASURED_SEGMENT_CACHE_SIZE];
+
+    // The checkpoints of the long lines that have been walked, sorted by line. See DRTE_LINE_CHECKPOINT_INTERVAL.
+    drte_long_line* _pLongLines;
+    size_t _longLineCount;
+    size_t _longLineBufferSize;
+
+    // The start of every occurance of the match text, in order. See drte_view_set_match_text().
+    drte_search_pattern _matchPattern;
+    size_t* _pMatches;
+    size_t _matchCount;
+    size_t _matchBufferSize;
+    size_t _matchIndexedLength;         // Every match starting before this character has been indexed.
+
+    size_t _paintedLineCount;           // The number of lines painted by the most recent call to drte_view_paint().
+
+    // The number of elements pCursors and pSelections have room for. These grow geometrically so that adding cursors and selections
+    // one at a time is amortized constant time.
+    size_t _cursorBufferSize;
+    size_t _selectionBufferSize;
+
+    // The selections normalized, sorted by their first character and with overlapping regions merged. This is what's used when
+    // looking up the selection at a character so it can be done with a binary search. It's rebuilt lazily from pSelections which
+    // stays in creation order so that selection indices remain stable for the application.
+    drte_region* _pSortedSelections;
+    size_t _sortedSelectionCount;
+    size_t _sortedSelectionBufferSize;
+    drte_bool32 _isSortedSelectionsStale;
 };
 
 struct drte_engine
@@ -260,6 +524,9 @@ struct drte_engine
     // The style to apply to active lines. Only the background color is used.
     uint8_t activeLineStyleSlot;
 
+    // The style to apply to occurances of a view's match text. Only the background color is used.
+    uint8_t matchStyleSlot;
+
     // The style to apply to the cursor.
     uint8_t cursorStyleSlot;
 
@@ -299,18 +566,46 @@ struct drte_engine
 
     // The function to call for handling syntax highlighting. See documentation for drte_engine_set_highlighter() for information
     // on how this function is used.
-    drte_engine_on_get_next_highlight_proc onGetNextHighlight;
+    drte_engine_on_lex_line_proc onLexLine;
 
-    // The user data to pass to each call to onGetNextHighlight.
+    // The user data to pass to each call to onLexLine.
     void* pHighlightUserData;
 
+    // The state of the lexer at the start of each line, indexed by unwrapped line. The states of lines before _lexerStateValidCount
+    // are up to date. The states of lines from _lexerStateStaleBeg up to _lexerStateCount were up to date before the text was last
+    // changed, and are used to detect when lexing after an edit has caught up with the state it was in before it.
+    uint32_t* _pLexerStates;
+    size_t _lexerStateValidCount;
+    size_t _lexerStateStaleBeg;
+    size_t _lexerStateCount;
+    size_t _lexerStateBufferSize;
+
+    // The tokens of recently painted lines, indexed by line.
+    drte_lexed_line _lexedLines[DRTE_LEXED_LINE_CACHE_SIZE];
 
-    /// The main text of the layout.
-    char* text;
+    // Incremented whenever lexer states are invalidated so that states lexed in the background from older text can be rejected.
+    size_t _lexerVersion;
 
-    /// The length of the text.
+    // The maximum number of lines to lex on demand when painting. See drte_engine_set_highlighter_lex_limit().
+    size_t highlighterLexLimit;
+
+
+    /// The main text of the layout. This should never be accessed directly - use drte_engine_get_text() and family instead.
+    drte_piece_table text;
+
+    /// The length of the text. This is always equal to text.length.
     size_t textLength;
 
+    /// The function to call when the buffer passed to drte_engine_set_text_no_copy() is no longer needed.
+    drte_engine_on_free_text_proc onFreeBorrowedText;
+
+    /// The user data to pass to onFreeBorrowedText.
+    void* pBorrowedTextUserData;
+
+    /// The number of characters at the end of the text whose lines have not been indexed. This is always the tail of the buffer passed
+    /// to drte_engine_set_text_no_copy_unindexed() and is treated as part of the last line until it's indexed.
+    size_t unindexedLength;
+
 
     /// The function to call when the text engine needs to be redrawn.
     drte_engine_on_dirty_proc onDirty;
@@ -330,6 +625,9 @@ struct drte_engine
     // The function to call when the undo stack has been trimmed.
     drte_engine_on_undo_stack_trimmed_proc onUndoStackTrimmed;
 
+    // The function to call when the oldest undo points have been discarded to stay within the undo memory budget.
+    drte_engine_on_undo_points_evicted_proc onUndoPointsEvicted;
+
 
     /// The blink rate in milliseconds of the cursor.
     unsigned int cursorBlinkRate;
@@ -377,6 +675,20 @@ struct drte_engine
     size_t currentUndoDataOffset;
     size_t currentRedoDataOffset;
 
+    // The offset of the oldest undo point still on the stack. Undo points before this one have been evicted.
+    size_t firstUndoDataOffset;
+
+    // The number of bytes that have been removed from the front of the undo buffer. Undo data offsets are measured from the
+    // start of the history so they don't need to be updated when evicted points are removed, which means this needs to be
+    // subtracted from an offset to get the actual position in the buffer.
+    size_t undoBufferDiscardedSize;
+
+    // The maximum number of bytes the undo points can use before the oldest are evicted. 0 means there is no limit.
+    size_t undoMemoryBudget;
+
+    // The number of undo points that have been evicted since the undo stack was last cleared.
+    unsigned int evictedUndoPointCount;
+
 
     // The ID to use for the next view. This is used for identifying views when restoring undo/redo state.
     size_t nextViewID;
@@ -437,6 +749,11 @@ void drte_engine_set_selection_style(drte_engine* pEngine, drte_style_token styl
 // Only the background color is used for this. The text is drawn with it's normal.
 void drte_engine_set_active_line_style(drte_engine* pEngine, drte_style_token styleToken);
 
+// Sets the style to use for occurances of a view's match text. See drte_view_set_match_text().
+//
+// Only the background color is used for this.
+void drte_engine_set_match_style(drte_engine* pEngine, drte_style_token styleToken);
+
 // Sets the style to use for the cursor.
 void drte_engine_set_cursor_style(drte_engine* pEngine, drte_style_token styleToken);
 
@@ -446,12 +763,39 @@ void drte_engine_set_line_numbers_style(drte_engine* pEngine, drte_style_token s
 
 // Registers a highlighter.
 //
-// When the text engine is being painted, it needs information about how to style the text. To do this the engine will refer back to the
-// application through the use of a callback function. The engine will pass a character index to this callback and the callback will return
-// the range of characters (if any) that come come after that character which require highlighting.
+// The highlighter is a lexer which is run over one line at a time. It's given the text of the line, not including the new line character,
+// and the state the lexer was in at the end of the previous line, which is 0 for the first line. It returns the state to start the next
+// line with, such as whether or not it's in the middle of a block comment. When pLine is not NULL, the tokens to style are added to it in
+// order with drte_lexed_line_add_token(). When it's NULL only the state is needed.
+//
+// The engine keeps the state at the start of each line so that only the lines being painted need to be lexed. After the text is changed
+// lines are lexed again from the changed line until the state at the start of a line is the same as it was before the change. Lexing
+// is done on demand so lines that are never painted are never lexed. The style tokens of the highlighter must be registered.
+void drte_engine_set_highlighter(drte_engine* pEngine, drte_engine_on_lex_line_proc proc, void* pUserData);
+
+// Adds a token to a line from a highlighter. The offsets are relative to the start of the line. Tokens must be added in order and
+// must not overlap. Does nothing if pLine is NULL.
+drte_bool32 drte_lexed_line_add_token(drte_lexed_line* pLine, size_t iCharBeg, size_t iCharEnd, drte_style_token styleToken);
+
+// Sets the maximum number of lines the engine will lex on demand to find the state of the lexer at the start of a line it's painting.
+// Lines further away than this are painted with the default style until their states are found in the background, which keeps the
+// time it takes to paint independent of the size of the text. Defaults to (size_t)-1 which means lines are always lexed on demand.
 //
-// TODO: This isn't clear - clarify.
-void drte_engine_set_highlighter(drte_engine* pEngine, drte_engine_on_get_next_highlight_proc proc, void* pUserData);
+// Lexing in the background is done by repeatedly taking a job with drte_engine_get_lexer_job(), running it on another thread with
+// drte_lexer_job_run() and handing the results back with drte_engine_set_lexer_states().
+void drte_engine_set_highlighter_lex_limit(drte_engine* pEngine, size_t maxLineCount);
+
+// Retrieves the next run of lines whose lexer states aren't yet known. The text of the lines is copied to pTextOut, which needs to stay
+// valid until the job has been run. Returns DRTE_FALSE if the state of every line is known.
+drte_bool32 drte_engine_get_lexer_job(drte_engine* pEngine, char* pTextOut, size_t textOutSize, drte_lexer_job* pJob);
+
+// Lexes the lines of a job, outputting the state at the start of the line after each one. pStatesOut must have room for pJob->lineCount
+// states. This doesn't access the engine so it can be called from any thread as long as the highlighter itself can be.
+void drte_lexer_job_run(const drte_lexer_job* pJob, uint32_t* pStatesOut);
+
+// Hands the results of a job back to the engine and repaints the lines whose states are now known. The results are ignored if the
+// text has been changed since the job was taken, in which case DRTE_FALSE is returned.
+drte_bool32 drte_engine_set_lexer_states(drte_engine* pEngine, const drte_lexer_job* pJob, const uint32_t* pStates);
 
 
 // Explicitly sets the line height. Set this to 0 to use the line height based off the registered styles.
@@ -468,6 +812,41 @@ uint32_t drte_engine_get_utf32(drte_engine* pEngine, size_t characterIndex);
 /// Sets the given text engine's text.
 void drte_engine_set_text(drte_engine* pEngine, const char* text);
 
+// Sets the engine's text to the given buffer without copying it. The engine reads the text straight out of the buffer and only
+// allocates memory for edits. The buffer must remain valid and unchanged until onFree is called, which happens when the text is
+// replaced by another call to this function, when drte_engine_copy_borrowed_text() is called or when the engine is uninitialized.
+// onFree can be NULL.
+//
+// If an undo point is being prepared this is recorded like any other change, which means a copy of both the old and new text is
+// stored in the undo buffer. Otherwise the undo stack is cleared.
+drte_bool32 drte_engine_set_text_no_copy(drte_engine* pEngine, const char* text, size_t textLength, drte_engine_on_free_text_proc onFree, void* pUserData);
+
+// Copies the buffer passed to drte_engine_set_text_no_copy() into memory owned by the engine and releases it. Use this when the
+// contents of the buffer are about to change, such as when saving over a memory mapped file.
+drte_bool32 drte_engine_copy_borrowed_text(drte_engine* pEngine);
+
+// Same as drte_engine_set_text_no_copy(), except the lines are not indexed up front. Until they are, the text that has not been
+// indexed is treated as part of the last line. This allows a huge file to be shown straight away while it's lines are found on
+// another thread with drte_find_line_offsets() and handed over with drte_engine_add_indexed_lines(). Anything that needs a line that
+// has not been handed over yet, such as an edit or moving a cursor past the indexed text, indexes it on the spot.
+drte_bool32 drte_engine_set_text_no_copy_unindexed(drte_engine* pEngine, const char* text, size_t textLength, drte_engine_on_free_text_proc onFree, void* pUserData);
+
+// Adds lines found in the buffer passed to drte_engine_set_text_no_copy_unindexed(). pLineOffsets is the offset of the first character
+// of each line relative to the start of that buffer, in increasing order. scannedLength is how much of the buffer has been searched
+// for lines, including the part covered by pLineOffsets. Lines that have already been indexed are skipped.
+drte_bool32 drte_engine_add_indexed_lines(drte_engine* pEngine, const size_t* pLineOffsets, size_t lineCount, size_t scannedLength);
+
+// Indexes lines on the calling thread until the given line has been indexed in full. Use (size_t)-1 to index everything.
+drte_bool32 drte_engine_index_lines_to_line(drte_engine* pEngine, size_t iLine);
+
+// Retrieves the number of characters at the end of the text that have not had their lines indexed.
+size_t drte_engine_get_unindexed_length(drte_engine* pEngine);
+
+// Finds the offset of the first character of each line in the given text, which is the character after each '\n'. At most maxLineCount
+// offsets are output. Returns the number of characters that were searched which will be less than textLength if pLineOffsetsOut fills
+// up. This does not touch any engine and is safe to call from any thread.
+size_t drte_find_line_offsets(const char* text, size_t textLength, size_t* pLineOffsetsOut, size_t maxLineCount, size_t* pLineCountOut);
+
 /// Retrieves the given text engine's text.
 ///
 /// @return The length of the string, not including the null terminator.
@@ -557,6 +936,18 @@ unsigned int drte_engine_get_redo_points_remaining_count(drte_engine* pEngine);
 /// Clears the undo stack.
 void drte_engine_clear_undo_stack(drte_engine* pEngine);
 
+/// Sets the maximum number of bytes the undo/redo stack can use. Set to 0 for no limit.
+///
+/// @remarks
+///     When the limit is exceeded the oldest undo points are evicted. The current undo point is never evicted.
+void drte_engine_set_undo_memory_budget(drte_engine* pEngine, size_t sizeInBytes);
+
+/// Retrieves the maximum number of bytes the undo/redo stack can use.
+size_t drte_engine_get_undo_memory_budget(drte_engine* pEngine);
+
+/// Retrieves statistics about the memory used by the undo/redo stack.
+void drte_engine_get_undo_stats(drte_engine* pEngine, drte_undo_stats* pStatsOut);
+
 
 /// Sets the function to call when a run of text needs to be painted for the given text engine.
 void drte_engine_set_on_paint_text(drte_engine* pEngine, drte_engine_on_paint_text_proc proc);
@@ -629,8 +1020,14 @@ void drte_view_end_dirty(drte_view* pView);
 void drte_view_dirty(drte_view* pView, drte_rect rect);
 
 // Paints a region of the given view.
+//
+// Only the lines and segments intersecting the rectangle are painted.
 void drte_view_paint(drte_view* pView, drte_rect rect, void* pUserData);
 
+// Retrieves the number of lines that were painted by the most recent call to drte_view_paint(). This is useful for measuring
+// how much work each paint is doing.
+size_t drte_view_get_painted_line_count(drte_view* pView);
+
 // Paints the line numbers for the given view.
 void drte_view_paint_line_numbers(drte_view* pView, float lineNumbersWidth, float lineNumbersHeight, drte_engine_on_paint_text_proc onPaintText, drte_engine_on_paint_rect_proc onPaintRect, void* pPaintData);
 
@@ -648,6 +1045,17 @@ void drte_view_disable_word_wrap(drte_view* pView);
 // Determines whether or not the given view has word wrap enabled.
 drte_bool32 drte_view_is_word_wrap_enabled(drte_view* pView);
 
+// Wraps the next maxLineCount unwrapped lines that haven't yet been wrapped against the current size of the view. Returns DRTE_TRUE
+// when every line has been wrapped.
+//
+// Edits only re-wrap the lines they touch, but when the width, tab size or styles of the view change the visible lines are
+// re-wrapped straight away and the rest are left for this to finish off. Lines that are still to be wrapped keep their old wrapping
+// in the mean time. The first visible line is kept in place as lines above it are wrapped.
+drte_bool32 drte_view_wrap_lines(drte_view* pView, size_t maxLineCount);
+
+// Determines whether or not every line has been wrapped against the current size of the view.
+drte_bool32 drte_view_is_word_wrapping_complete(drte_view* pView);
+
 
 // Retrieves the index of the line containing the character at the given index.
 size_t drte_view_get_character_line(drte_view* pView, drte_line_cache* pLineCache, size_t characterIndex);
@@ -919,6 +1327,20 @@ drte_bool32 drte_view_get_last_selection(drte_view* pView, size_t* iCharBegOut,
 drte_bool32 drte_view_get_selection_under_point(drte_view* pView, float posX, float posY, size_t* piSelectionOut);
 
 
+// Applies a list of edits to the text as a single change.
+//
+// The edits can be in any order. Edits that overlap or start at the same character are combined into one, with their text joined in
+// the order they were given. A small number of edits are applied one at a time from the last to the first and only touch the lines
+// they're on, whereas a large number rebuild the text once. Either way every cursor and selection is shifted in a single pass and, if
+// an undo point has been prepared, one change is recorded for the whole list. This is what should be used for editing at many cursors
+// at once.
+//
+// Cursors of this view that are inside, or at either end of, an edited region are moved to the end of it's new text. Cursors of other
+// views are moved to the start of it.
+//
+// @return True if the text within the text engine has changed.
+drte_bool32 drte_view_apply_edits(drte_view* pView, const drte_edit* pEdits, size_t editCount);
+
 /// Inserts a character at the position of the cursor.
 ///
 /// @return True if the text within the text engine has changed.
@@ -930,6 +1352,11 @@ drte_bool32 drte_view_insert_character_at_cursors(drte_view* pView, unsigned int
 /// @return True if the text within the text engine has changed.
 drte_bool32 drte_view_insert_text_at_cursor(drte_view* pView, size_t cursorIndex, const char* text);
 
+// Inserts the given text at the position of every cursor as a single change. See drte_view_apply_edits().
+//
+// @return True if the text within the text engine has changed.
+drte_bool32 drte_view_insert_text_at_cursors(drte_view* pView, const char* text);
+
 /// Deletes the character to the left of the cursor.
 ///
 /// @return True if the text within the text engine has changed.
@@ -952,12 +1379,94 @@ drte_bool32 drte_view_delete_selected_text(drte_view* pView);
 drte_bool32 drte_view_delete_selection_text(drte_view* pView, size_t iSelectionToDelete);
 
 
+// Prepares a search pattern for use with drte_engine_find(). The text is copied. Returns DRTE_FALSE if the text is empty.
+drte_bool32 drte_search_pattern_init(drte_search_pattern* pPattern, const char* text, size_t textLength);
+
+// Frees the memory used by a search pattern.
+void drte_search_pattern_uninit(drte_search_pattern* pPattern);
+
+// Finds the first occurance of the given pattern that lies entirely within the given range of characters. A pattern must only be
+// used by one thread at a time.
+drte_bool32 drte_engine_find(drte_engine* pEngine, drte_search_pattern* pPattern, size_t iCharBeg, size_t iCharEnd, size_t* pCharOut);
+
+// Replaces every occurance of the given pattern within the given range of characters. All of the matches are found first and then the
+// new text is built in a single pass, which means the cost depends on the length of the text rather than the number of matches. This
+// is recorded in the prepared undo point as a single change. Returns the number of occurances that were replaced.
+size_t drte_engine_replace_all(drte_engine* pEngine, drte_search_pattern* pPattern, const char* replacement, size_t iCharBeg, size_t iCharEnd);
+
+// Compiles a regular expression. Returns DRTE_FALSE if the pattern is invalid or empty.
+//
+// Supported syntax is literals, ".", "[...]" and "[^...]" classes with ranges, the \d \w \s \D \W \S \n \t \r \xHH escapes, the "^" and
+// "$" line anchors, "\b" and "\B" word boundaries, "(...)" capture groups, "(?:...)" non-capturing groups, "|" and the "*", "+", "?",
+// "{n}", "{n,}" and "{n,m}" quantifiers, all of which can be made lazy with a trailing "?". Matching is byte based and "." never
+// matches a new line.
+//
+// Searches run in linear time. The pattern is compiled to an NFA which is turned into a DFA lazily as the text is scanned, and the NFA
+// is only simulated directly when capture groups are needed.
+drte_bool32 drte_regex_init(drte_regex* pRegex, const char* pattern, unsigned int flags);
+
+// Frees the memory used by a regular expression.
+void drte_regex_uninit(drte_regex* pRegex);
+
+// Finds the leftmost match of the given regular expression that lies entirely within the given range of characters. Matches can be
+// empty. A regular expression must only be used by one thread at a time.
+drte_bool32 drte_engine_find_regex(drte_engine* pEngine, drte_regex* pRegex, size_t iCharBeg, size_t iCharEnd, size_t* pMatchBegOut, size_t* pMatchEndOut);
+
+// Retrieves the capture groups of a match returned by drte_engine_find_regex(). <pGroupsOut> must have room for DRTE_REGEX_MAX_GROUPS*2
+// entries. Each group is a begin and end pair, both of which are set to (size_t)-1 if the group did not take part in the match.
+drte_bool32 drte_engine_get_regex_groups(drte_engine* pEngine, drte_regex* pRegex, size_t iMatchBeg, size_t iMatchEnd, size_t* pGroupsOut);
+
+// Builds the replacement text for a match returned by drte_engine_find_regex(). "\0" to "\9" are replaced with the text of the
+// respective capture group and "\n", "\t" and "\\" are unescaped. Returns the length of the replacement, not including the null
+// terminator. Call this once with <pTextOut> set to NULL to calculate the required size of the buffer.
+size_t drte_engine_expand_regex_replacement(drte_engine* pEngine, drte_regex* pRegex, size_t iMatchBeg, size_t iMatchEnd, const char* replacement, char* pTextOut, size_t textOutSize);
+
+// The regular expression version of drte_engine_replace_all(). Each match is replaced with the result of
+// drte_engine_expand_regex_replacement(). After an empty match the search continues from the next character.
+size_t drte_engine_replace_all_regex(drte_engine* pEngine, drte_regex* pRegex, const char* replacement, size_t iCharBeg, size_t iCharEnd);
+
 /// Finds the given string starting from the cursor and then looping back.
 drte_bool32 drte_view_find_next(drte_view* pView, const char* text, size_t* pSelectionStartOut, size_t* pSelectionEndOut);
 
+// Finds the next match of the given regular expression starting from the cursor and then looping back. Empty matches are skipped.
+drte_bool32 drte_view_find_next_regex(drte_view* pView, const char* pattern, size_t* pSelectionStartOut, size_t* pSelectionEndOut);
+
 /// Finds the given string starting from the cursor, but does not loop back.
 drte_bool32 drte_view_find_next_no_loop(drte_view* pView, const char* text, size_t* pSelectionStartOut, size_t* pSelectionEndOut);
 
+// Sets the text whose every occurance is indexed and highlighted with the engine's match style. Pass NULL or an empty string to clear
+// it. Occurances may overlap. The index is built incrementally with drte_view_index_matches() so that large files don't stall the
+// calling thread, and once built it's kept up to date as the text is edited. Finding with the same text uses the index when it's
+// complete.
+drte_bool32 drte_view_set_match_text(drte_view* pView, const char* text);
+
+// Retrieves the view's match text, or NULL if there isn't one.
+const char* drte_view_get_match_text(drte_view* pView);
+
+// Indexes the occurances of the match text in the next maxCharacters characters that haven't yet been searched. Returns DRTE_TRUE
+// if the index is complete. The index will need to be continued after the text is replaced in it's entirety.
+drte_bool32 drte_view_index_matches(drte_view* pView, size_t maxCharacters);
+
+// Determines whether or not every occurance of the match text has been indexed.
+drte_bool32 drte_view_is_match_index_complete(drte_view* pView);
+
+// Retrieves the number of occurances of the match text that have been indexed.
+size_t drte_view_get_match_count(drte_view* pView);
+
+// Retrieves the range of characters of the given occurance of the match text.
+drte_bool32 drte_view_get_match(drte_view* pView, size_t iMatch, size_t* pCharBegOut, size_t* pCharEndOut);
+
+// Retrieves the number of indexed occurances of the match text that start before the given character. This runs in O(log n).
+size_t drte_view_get_match_count_before_character(drte_view* pView, size_t iChar);
+
+// Retrieves the index of the first occurance of the match text starting at or after the given character, looping back to the start
+// if necessary. This runs in O(log n).
+drte_bool32 drte_view_find_next_match(drte_view* pView, size_t iChar, size_t* pMatchIndexOut);
+
+// Retrieves the index of the last occurance of the match text starting before the given character, looping back to the end if
+// necessary. This runs in O(log n).
+drte_bool32 drte_view_find_prev_match(drte_view* pView, size_t iChar, size_t* pMatchIndexOut);
+
 
 //// Rectangles ////
 DRTE_INLINE drte_rect drte_make_rect(float left, float top, float right, float bottom)
@@ -1040,12 +1549,61 @@ DRTE_INLINE drte_rect drte_rect_make_right_way_out(drte_rect rect)
 #define DRTE_STACK_BUFFER_BLOCK_SIZE 4096
 #endif
 
-#ifndef DRTE_PAGE_LINE_COUNT
-#define DRTE_PAGE_LINE_COUNT    256
+// Inserted and deleted text at least this long is compressed before being stored in the undo buffer.
+#ifndef DRTE_UNDO_COMPRESSION_THRESHOLD
+#define DRTE_UNDO_COMPRESSION_THRESHOLD 1024
+#endif
+
+// The minimum number of insertions and deletions in a row before undo and redo apply them as a single replacement. A replacement
+// rebuilds the whole text and line cache so it's only worth it when there's enough changes to make up for it.
+#ifndef DRTE_UNDO_BATCH_MIN_CHANGE_COUNT
+#define DRTE_UNDO_BATCH_MIN_CHANGE_COUNT 16
+#endif
+
+#ifndef DRTE_LINE_CACHE_LEAF_CAPACITY
+#define DRTE_LINE_CACHE_LEAF_CAPACITY   128
+#endif
+
+#ifndef DRTE_LINE_CACHE_BRANCH_CAPACITY
+#define DRTE_LINE_CACHE_BRANCH_CAPACITY 32
+#endif
+
+#ifndef DRTE_PIECE_TABLE_LEAF_CAPACITY
+#define DRTE_PIECE_TABLE_LEAF_CAPACITY  64
+#endif
+
+#ifndef DRTE_PIECE_TABLE_BRANCH_CAPACITY
+#define DRTE_PIECE_TABLE_BRANCH_CAPACITY 32
+#endif
+
+// The number of characters indexed at a time by drte_engine_index_lines_to_line().
+#ifndef DRTE_LINE_INDEXING_CHUNK_SIZE
+#define DRTE_LINE_INDEXING_CHUNK_SIZE   (1024*1024)
+#endif
+
+// The number of unwrapped lines to wrap at a time with drte_view_wrap_lines() after the width of a view changes.
+#ifndef DRTE_WORD_WRAP_CHUNK_SIZE
+#define DRTE_WORD_WRAP_CHUNK_SIZE       1024
+#endif
+
+// Edits that insert more than this many characters leave the matches in the new text to be found by drte_view_index_matches() rather
+// than searching for them on the spot.
+#ifndef DRTE_MATCH_INDEXING_CHUNK_SIZE
+#define DRTE_MATCH_INDEXING_CHUNK_SIZE  (1024*1024)
+#endif
+
+// Batches of edits with more regions than this are applied by drte_engine__replace_regions() by rebuilding the whole text in one go.
+// Smaller batches, such as typing at each cursor, are applied one region at a time.
+#ifndef DRTE_REPLACE_REGIONS_IN_PLACE_LIMIT
+#define DRTE_REPLACE_REGIONS_IN_PLACE_LIMIT 64
 #endif
 
 #define DRTE_INVALID_STYLE_SLOT 255
 
+// The buffers a piece can refer to.
+#define DRTE_PIECE_BUFFER_ORIGINAL      0
+#define DRTE_PIECE_BUFFER_ADD           1
+
 // Flags for the drte_engine::flags and drte_view::flags properties.
 #define DRTE_USE_EXPLICIT_LINE_HEIGHT   (1 << 0)
 #define DRTE_WORD_WRAP_ENABLED          (1 << 1)
@@ -1053,8 +1611,9 @@ DRTE_INLINE drte_rect drte_rect_make_right_way_out(drte_rect rect)
 
 
 
-// min
+// min/max
 #define drte_min(a, b) (((a) < (b)) ? (a) : (b))
+#define drte_max(a, b) (((a) > (b)) ? (a) : (b))
 #define drte_round_up(x, multiple) ((((x) + ((multiple) - 1)) / (multiple)) * (multiple))
 
 // Determines if the given character is whitespace.
@@ -1177,4642 +1736,11782 @@ int drte__strncpy_s(char* dst, size_t dstSizeInBytes, const char* src, size_t co
 
 
 
-//// Stack Buffer ////
-//
-// A stack buffer is a simple FILO buffer where blocks memory of arbitrary sizes are pushed to the end and, likewise, freed from the end.
-//
-// Do not persistently store pointers returned by drte_stack_buffer_alloc(). Instead store offsets by interrogating the stackPtr property.
+//// Newlines ////
 //
-// Data can be popped from the internal buffer with drte_stack_buffer_free() or drte_stack_buffer_set_stack_ptr(). Note that these will
-// ensure the stack pointer is aligned based on DRTE_STACK_BUFFER_ALIGNMENT, so you will want to call drte_stack_buffer_get_stack_ptr()
-// after the fact if you need to access the stack pointer again later.
-drte_bool32 drte_stack_buffer_init(drte_stack_buffer* pStack)
-{
-    if (pStack == NULL) {
-        return DRTE_FALSE;
-    }
+// Finding line breaks is the bulk of the work when loading a file so it's vectorized where possible. SSE2 is always available on
+// 64-bit x86. AVX2 is only used when the compiler has been told it can use it (-mavx2 or /arch:AVX2).
+#if defined(__AVX2__)
+#define DRTE_SUPPORT_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DRTE_SUPPORT_SSE2
+#include <emmintrin.h>
+#endif
 
-    memset(pStack, 0, sizeof(*pStack));
-    return DRTE_TRUE;
-}
+#if defined(DRTE_SUPPORT_AVX2) || defined(DRTE_SUPPORT_SSE2)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-void drte_stack_buffer_uninit(drte_stack_buffer* pStack)
+// Retrieves the index of the lowest set bit. The mask cannot be zero.
+static unsigned int drte__bit_scan_forward(drte_uint32 mask)
 {
-    if (pStack == NULL) {
-        return;
-    }
-
-    free(pStack->pBuffer);
-}
+    assert(mask != 0);
 
-size_t drte_stack_buffer_get_stack_ptr(drte_stack_buffer* pStack)
-{
-    if (pStack == NULL) {
-        return 0;
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#elif defined(__GNUC__)
+    return (unsigned int)__builtin_ctz(mask);
+#else
+    unsigned int index = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        index += 1;
     }
-
-    return pStack->stackPtr;
+    return index;
+#endif
 }
+#endif
 
-size_t drte_stack_buffer_set_stack_ptr(drte_stack_buffer* pStack, size_t newStackPtr)
+// Counts the number of '\n' characters in the given text.
+size_t drte__count_newlines(const char* text, size_t textLength)
 {
-    if (pStack == NULL) {
-        return 0;
-    }
+    size_t count = 0;
+    size_t iChar = 0;
 
-    assert(newStackPtr <= pStack->stackPtr);   // <-- If you trigger this it means you're trying to move the stack pointer beyond the valid area. You cannot use this function to grow the buffer.
+    // Matches are accumulated in 8-bit lanes which would overflow after 255 iterations so they're summed in batches.
+#if defined(DRTE_SUPPORT_AVX2)
+    const __m256i newline256 = _mm256_set1_epi8('\n');
+    while (textLength - iChar >= 32) {
+        size_t blockCount = drte_min((textLength - iChar) / 32, 255);
+        __m256i counts = _mm256_setzero_si256();
+        for (size_t iBlock = 0; iBlock < blockCount; ++iBlock, iChar += 32) {
+            counts = _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(text + iChar)), newline256));
+        }
 
-    pStack->stackPtr = drte_round_up(newStackPtr, DRTE_STACK_BUFFER_ALIGNMENT);
+        drte_uint64 sums[4];
+        _mm256_storeu_si256((__m256i*)sums, _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+        count += (size_t)(sums[0] + sums[1] + sums[2] + sums[3]);
+    }
+#elif defined(DRTE_SUPPORT_SSE2)
+    const __m128i newline128 = _mm_set1_epi8('\n');
+    while (textLength - iChar >= 16) {
+        size_t blockCount = drte_min((textLength - iChar) / 16, 255);
+        __m128i counts = _mm_setzero_si128();
+        for (size_t iBlock = 0; iBlock < blockCount; ++iBlock, iChar += 16) {
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(text + iChar)), newline128));
+        }
 
-    // Shrink the buffer if we're getting a bit too wasteful.
-    size_t desiredBufferSize = drte_round_up(pStack->stackPtr, DRTE_STACK_BUFFER_BLOCK_SIZE);
-    if (desiredBufferSize == 0) {
-        desiredBufferSize = DRTE_STACK_BUFFER_BLOCK_SIZE;
+        drte_uint64 sums[2];
+        _mm_storeu_si128((__m128i*)sums, _mm_sad_epu8(counts, _mm_setzero_si128()));
+        count += (size_t)(sums[0] + sums[1]);
     }
+#endif
 
-    if (desiredBufferSize < pStack->bufferSize) {
-        void* pNewBuffer = realloc(pStack->pBuffer, desiredBufferSize);
-        if (pNewBuffer != NULL) {
-            pStack->pBuffer = pNewBuffer;
-            pStack->bufferSize = desiredBufferSize;
+    for (; iChar < textLength; ++iChar) {
+        if (text[iChar] == '\n') {
+            count += 1;
         }
     }
 
-    return pStack->stackPtr;
+    return count;
 }
 
-void* drte_stack_buffer_alloc(drte_stack_buffer* pStack, size_t sizeInBytes)
+// Finds the first occurance of the given byte in the given text. Returns textLength if there isn't one.
+size_t drte__find_byte(const char* text, size_t textLength, char c)
 {
-    if (pStack == NULL || sizeInBytes == 0) {
-        return NULL;
-    }
-
-    // The allocated size is always aligned.
-    sizeInBytes = drte_round_up(sizeInBytes, DRTE_STACK_BUFFER_ALIGNMENT);
+    size_t iChar = 0;
 
-    size_t newStackPtr = pStack->stackPtr + sizeInBytes;
-    if (newStackPtr > pStack->bufferSize) {
-        size_t newBufferSize = (pStack->bufferSize == 0) ? DRTE_STACK_BUFFER_BLOCK_SIZE : drte_round_up(newStackPtr, DRTE_STACK_BUFFER_BLOCK_SIZE);
-        void* pNewBuffer = realloc(pStack->pBuffer, newBufferSize);
-        if (pNewBuffer == NULL) {
-            return NULL;
+#if defined(DRTE_SUPPORT_AVX2)
+    const __m256i c256 = _mm256_set1_epi8(c);
+    for (; textLength - iChar >= 32; iChar += 32) {
+        drte_uint32 mask = (drte_uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(text + iChar)), c256));
+        if (mask != 0) {
+            return iChar + drte__bit_scan_forward(mask);
         }
-
-        pStack->bufferSize = newBufferSize;
-        pStack->pBuffer = pNewBuffer;
     }
+#elif defined(DRTE_SUPPORT_SSE2)
+    const __m128i c128 = _mm_set1_epi8(c);
+    for (; textLength - iChar >= 16; iChar += 16) {
+        drte_uint32 mask = (drte_uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(text + iChar)), c128));
+        if (mask != 0) {
+            return iChar + drte__bit_scan_forward(mask);
+        }
+    }
+#endif
 
-    void* pResult = (void*)((uint8_t*)pStack->pBuffer + pStack->stackPtr);
+    for (; iChar < textLength; ++iChar) {
+        if (text[iChar] == c) {
+            return iChar;
+        }
+    }
 
-    pStack->stackPtr = newStackPtr;
-    return pResult;
+    return textLength;
 }
 
-void drte_stack_buffer_free(drte_stack_buffer* pStack, size_t sizeInBytes)
+// Finds the first '\n' character in the given text. Returns textLength if there isn't one.
+DRTE_INLINE size_t drte__find_newline(const char* text, size_t textLength)
 {
-    if (pStack == NULL || sizeInBytes == 0) {
-        return;
-    }
-
-    assert(sizeInBytes <= pStack->stackPtr);     // <-- If you trigger this is means you're trying to free too much.
-    drte_stack_buffer_set_stack_ptr(pStack, pStack->stackPtr - sizeInBytes);
+    return drte__find_byte(text, textLength, '\n');
 }
 
-void* drte_stack_buffer_get_data_ptr(drte_stack_buffer* pStack, size_t offset)
+size_t drte_find_line_offsets(const char* text, size_t textLength, size_t* pLineOffsetsOut, size_t maxLineCount, size_t* pLineCountOut)
 {
-    if (pStack == NULL || pStack->stackPtr < offset) {
-        return NULL;
-    }
+    size_t lineCount = 0;
+    size_t iChar = 0;
 
-    return (void*)((uint8_t*)pStack->pBuffer + offset);
-}
+    if (text != NULL && pLineOffsetsOut != NULL) {
+        while (lineCount < maxLineCount) {
+            iChar += drte__find_newline(text + iChar, textLength - iChar);
+            if (iChar == textLength) {
+                break;
+            }
 
+            iChar += 1;
+            pLineOffsetsOut[lineCount++] = iChar;
+        }
+    }
 
+    if (pLineCountOut) *pLineCountOut = lineCount;
+    return iChar;
+}
 
 
-// Performs a full refresh of the text engine, including refreshing line wrapping and repaining.
-void drte_engine__refresh(drte_engine* pEngine);
 
-/// Applies the given undo state.
-void drte_engine__apply_undo_state(drte_engine* pEngine, const void* pUndoDataPtr);
+//// Search ////
+//
+// Short patterns are found by comparing the first and last byte of the pattern against a whole vector's worth of positions at once
+// and only doing a full comparison where both match. Longer patterns use Boyer-Moore-Horspool which skips ahead by up to the length
+// of the pattern at a time. Horspool is also used for whatever is left over at the end of the text.
+#ifndef DRTE_SEARCH_SIMD_MAX_PATTERN_LENGTH
+#define DRTE_SEARCH_SIMD_MAX_PATTERN_LENGTH 32
+#endif
 
-/// Applies the given undo state as a redo operation.
-void drte_engine__apply_redo_state(drte_engine* pEngine, const void* pUndoDataPtr);
+drte_bool32 drte_search_pattern_init(drte_search_pattern* pPattern, const char* text, size_t textLength)
+{
+    if (pPattern == NULL) {
+        return DRTE_FALSE;
+    }
 
-/// Called when a cursor moves.
-void drte_engine__on_cursor_move(drte_engine* pEngine, drte_view* pView, size_t cursorIndex);
+    memset(pPattern, 0, sizeof(*pPattern));
 
+    if (text == NULL || textLength == 0) {
+        return DRTE_FALSE;
+    }
 
+    // The pattern and the window used for matches that straddle pieces share the one allocation. The window needs room for the
+    // pattern on either side of a piece boundary.
+    pPattern->pText = (char*)malloc(textLength + (textLength-1)*2 + 1);
+    if (pPattern->pText == NULL) {
+        return DRTE_FALSE;
+    }
 
-static void drte_view__refresh_word_wrapping(drte_view* pView);
-static float drte_view__get_tab_width_in_pixels(drte_view* pView);
+    memcpy(pPattern->pText, text, textLength);
+    pPattern->pText[textLength] = '\0';
+    pPattern->pWindow = pPattern->pText + textLength + 1;
+    pPattern->length = textLength;
 
-void drte_view__update_cursor_sticky_position(drte_view* pView, drte_cursor* pCursor)
-{
-    if (pView == NULL || pCursor == NULL) {
-        return;
+    // Horspool's bad character table. When the last character of the window doesn't result in a match we can skip ahead so that
+    // it lines up with the last occurance of that character in the pattern.
+    for (size_t i = 0; i < 256; ++i) {
+        pPattern->skip[i] = textLength;
     }
-
-    // If the character is on a different line to the cursor, it means the cursor is pinned to the end of the previous line and the character
-    // is the first character on the _next_ line. This will happen when word wrap is enabled. In this case things need to be treated a bit
-    // differently to calculate the x position.
-    float charPosX;
-    float charPosY;
-    if (pCursor->iLine != drte_view_get_character_line(pView, pView->pWrappedLines, pCursor->iCharAbs)) {
-        drte_view_measure_line(pView, pCursor->iLine, &charPosX, NULL);
-        charPosY = drte_view_get_line_pos_y(pView, pCursor->iLine);
-    } else {
-        drte_view_get_character_position(pView, pView->pWrappedLines, pCursor->iCharAbs, &charPosX, &charPosY);
+    for (size_t i = 0; i+1 < textLength; ++i) {
+        pPattern->skip[(drte_uint8)text[i]] = textLength-1 - i;
     }
 
-    pCursor->absoluteSickyPosX = charPosX;
+    return DRTE_TRUE;
 }
 
-size_t drte_engine__acquire_view_id(drte_engine* pEngine)
+void drte_search_pattern_uninit(drte_search_pattern* pPattern)
 {
-    assert(pEngine != NULL);
-    return pEngine->nextViewID++;   // <-- Make this thread-safe?
-}
+    if (pPattern == NULL) {
+        return;
+    }
 
+    free(pPattern->pText);
+    memset(pPattern, 0, sizeof(*pPattern));
+}
 
-// Finds a style slot index of the given style token. Returns DRTE_INVALID_STYLE_SLOT if it could not be found.
-uint8_t drte_engine__get_style_slot(drte_engine* pEngine, drte_style_token styleToken)
+size_t drte__find_pattern_horspool(const drte_search_pattern* pPattern, const char* text, size_t textLength)
 {
-    assert(pEngine != NULL);
-    assert(pEngine->styleCount < 256);
+    size_t patternLength = pPattern->length;
+    if (patternLength > textLength) {
+        return textLength;
+    }
 
-    for (uint8_t iStyleSlot = 0; iStyleSlot < pEngine->styleCount; ++iStyleSlot) {
-        if (pEngine->styles[iStyleSlot].styleToken == styleToken) {
-            return iStyleSlot;
+    char last = pPattern->pText[patternLength-1];
+    for (size_t iChar = 0; iChar + patternLength <= textLength; ) {
+        char c = text[iChar + patternLength-1];
+        if (c == last && memcmp(text + iChar, pPattern->pText, patternLength-1) == 0) {
+            return iChar;
         }
+
+        iChar += pPattern->skip[(drte_uint8)c];
     }
 
-    return DRTE_INVALID_STYLE_SLOT;
+    return textLength;
 }
 
-// Gets the style token associated with the given slot.
-drte_style_token drte_engine__get_style_token(drte_engine* pEngine, uint8_t styleSlot)
+// Finds the first occurance of the given pattern in the given contiguous text. Returns textLength if there isn't one.
+size_t drte__find_pattern(const drte_search_pattern* pPattern, const char* text, size_t textLength)
 {
-    assert(pEngine != NULL);
-    return pEngine->styles[styleSlot].styleToken;
-}
+    size_t patternLength = pPattern->length;
+    if (patternLength > textLength) {
+        return textLength;
+    }
 
-// Retrieves the next selection region starting from the given character, including the region the character is sitting in, if any.
-static drte_bool32 drte_view__get_next_selection_from_character(drte_view* pView, size_t iChar, drte_region* pSelectionOut)
-{
-    assert(pView != NULL);
-    assert(pSelectionOut != NULL);
+    if (patternLength == 1) {
+        return drte__find_byte(text, textLength, pPattern->pText[0]);
+    }
 
-    // Selections can be in any order. Need to first check every single one to determine if any are on top of the character. If so we
-    // just return the first one. Otherwise we fall through to the next loop which finds the closest selection to the character.
-    drte_bool32 foundSelectionAfterChar = DRTE_FALSE;
-    drte_region closestSelection;
-    closestSelection.iCharBeg = (size_t)-1;
-    closestSelection.iCharEnd = (size_t)-1;
+    size_t iChar = 0;
 
-    for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
-        drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
-        if (iChar >= selection.iCharBeg && iChar < selection.iCharEnd) {
-            *pSelectionOut = selection;
-            return DRTE_TRUE;
-        }
+#if defined(DRTE_SUPPORT_AVX2)
+    if (patternLength <= DRTE_SEARCH_SIMD_MAX_PATTERN_LENGTH) {
+        const __m256i first256 = _mm256_set1_epi8(pPattern->pText[0]);
+        const __m256i last256  = _mm256_set1_epi8(pPattern->pText[patternLength-1]);
+        for (; textLength - iChar >= 32 + patternLength-1; iChar += 32) {
+            __m256i eqFirst = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(text + iChar)), first256);
+            __m256i eqLast  = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(text + iChar + patternLength-1)), last256);
+            drte_uint32 mask = (drte_uint32)_mm256_movemask_epi8(_mm256_and_si256(eqFirst, eqLast));
+            while (mask != 0) {
+                unsigned int i = drte__bit_scan_forward(mask);
+                if (memcmp(text + iChar + i + 1, pPattern->pText + 1, patternLength-2) == 0) {
+                    return iChar + i;
+                }
 
-        if (selection.iCharBeg > iChar) {
-            foundSelectionAfterChar = DRTE_TRUE;
-            if (closestSelection.iCharBeg > selection.iCharBeg) {
-                closestSelection = selection;
+                mask &= mask - 1;
             }
         }
     }
+#elif defined(DRTE_SUPPORT_SSE2)
+    if (patternLength <= DRTE_SEARCH_SIMD_MAX_PATTERN_LENGTH) {
+        const __m128i first128 = _mm_set1_epi8(pPattern->pText[0]);
+        const __m128i last128  = _mm_set1_epi8(pPattern->pText[patternLength-1]);
+        for (; textLength - iChar >= 16 + patternLength-1; iChar += 16) {
+            __m128i eqFirst = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(text + iChar)), first128);
+            __m128i eqLast  = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(text + iChar + patternLength-1)), last128);
+            drte_uint32 mask = (drte_uint32)_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast));
+            while (mask != 0) {
+                unsigned int i = drte__bit_scan_forward(mask);
+                if (memcmp(text + iChar + i + 1, pPattern->pText + 1, patternLength-2) == 0) {
+                    return iChar + i;
+                }
 
-
-    if (foundSelectionAfterChar) {
-        *pSelectionOut = closestSelection;
+                mask &= mask - 1;
+            }
+        }
     }
+#endif
 
-    return foundSelectionAfterChar;
+    return iChar + drte__find_pattern_horspool(pPattern, text + iChar, textLength - iChar);
 }
 
 
+//// Regular Expressions ////
+//
+// Patterns are parsed into a tree which is compiled twice: once forwards with capture groups, and once backwards without them. A
+// search runs the forward program as a lazily built DFA to find where the leftmost match ends and then runs the reverse program
+// backwards from there to find where it starts. Neither needs to backtrack so searching is linear in the length of the text. A DFA
+// can't keep track of capture groups so they're found afterwards by simulating the forward program as an NFA over just the match.
+#ifndef DRTE_REGEX_MAX_INSTRUCTIONS
+#define DRTE_REGEX_MAX_INSTRUCTIONS     32768
+#endif
 
-//// Line Cache ////
+#ifndef DRTE_REGEX_MAX_REPEAT
+#define DRTE_REGEX_MAX_REPEAT           1000
+#endif
 
-drte_bool32 drte_line_cache_init(drte_line_cache* pLineCache)
-{
-    if (pLineCache == NULL) {
-        return DRTE_FALSE;
-    }
+#ifndef DRTE_REGEX_MAX_DEPTH
+#define DRTE_REGEX_MAX_DEPTH            128
+#endif
 
-    // There's always at least one line.
-    pLineCache->bufferSize = DRTE_PAGE_LINE_COUNT;
-    pLineCache->pLines = (size_t*)calloc(pLineCache->bufferSize, sizeof(*pLineCache->pLines));   // <-- calloc() is important here. It initializes the first line to 0.
-    pLineCache->count = 1;
+// The amount of memory the DFA states of a program can use before they're all thrown away and built again as they're needed.
+#ifndef DRTE_REGEX_DFA_CACHE_SIZE
+#define DRTE_REGEX_DFA_CACHE_SIZE       (4*1024*1024)
+#endif
 
-    return DRTE_TRUE;
-}
+#define DRTE_REGEX_NONE                 0xFFFFFFFF
+
+#define DRTE_REGEX_OP_BYTE              0   // arg = the byte.
+#define DRTE_REGEX_OP_CLASS             1   // x = the index of the class.
+#define DRTE_REGEX_OP_ANY               2   // Anything but a new line.
+#define DRTE_REGEX_OP_SPLIT             3   // x is preferred over y.
+#define DRTE_REGEX_OP_JMP               4
+#define DRTE_REGEX_OP_SAVE              5   // x = the capture slot.
+#define DRTE_REGEX_OP_ASSERT            6   // arg = one of DRTE_REGEX_ASSERT_*.
+#define DRTE_REGEX_OP_MATCH             7
+
+// Assertions are relative to the direction the program runs. "Prev" is the character that has just been consumed and "next" is the one
+// about to be, so "^" is DRTE_REGEX_ASSERT_PREV_NEW_LINE in the forward program and DRTE_REGEX_ASSERT_NEXT_NEW_LINE in the reverse one.
+#define DRTE_REGEX_ASSERT_PREV_NEW_LINE     0
+#define DRTE_REGEX_ASSERT_NEXT_NEW_LINE     1
+#define DRTE_REGEX_ASSERT_WORD_BOUNDARY     2
+#define DRTE_REGEX_ASSERT_NOT_WORD_BOUNDARY 3
+
+// Flags for DFA states.
+#define DRTE_REGEX_DFA_MATCH            (1 << 0)    // A match ended just before the character that led to this state.
+#define DRTE_REGEX_DFA_PREV_NEW_LINE    (1 << 1)    // The previous character is a new line, or there isn't one.
+#define DRTE_REGEX_DFA_PREV_WORD        (1 << 2)    // The previous character is part of a word.
+#define DRTE_REGEX_DFA_START            (1 << 3)    // A new thread is started at every character. This is how unanchored searches work.
+
+#define DRTE_REGEX_NODE_BYTE            0
+#define DRTE_REGEX_NODE_CLASS           1
+#define DRTE_REGEX_NODE_ANY             2
+#define DRTE_REGEX_NODE_ASSERT          3
+#define DRTE_REGEX_NODE_CAT             4
+#define DRTE_REGEX_NODE_ALT             5
+#define DRTE_REGEX_NODE_REPEAT          6
+#define DRTE_REGEX_NODE_GROUP           7
+
+struct drte_regex_dfa_state
+{
+    drte_uint32 flags;
+    drte_uint32 instCount;
+    drte_uint32 hash;
+    drte_uint32* pInsts;                // The instructions to continue from, in order of priority.
+    drte_regex_dfa_state* pNext[1];     // One for each byte class plus one for the edge of the text. Null until first needed.
+};
 
-void drte_line_cache_uninit(drte_line_cache* pLineCache)
+typedef struct
 {
-    if (pLineCache == NULL) {
-        return;
-    }
+    drte_uint8 type;
+    drte_uint8 arg;         // The byte, the assertion, or whether or not a repeat is greedy.
+    drte_uint32 first;      // The first child, or the index of the class.
+    drte_uint32 last;
+    drte_uint32 next;       // Siblings.
+    drte_uint32 prev;
+    drte_uint32 group;
+    drte_int32 min;
+    drte_int32 max;         // -1 when unbounded.
+} drte_regex_node;
 
-    free(pLineCache->pLines);
+typedef struct
+{
+    drte_regex* pRegex;
+    const char* pNext;
+    drte_regex_node* pNodes;
+    drte_uint32 nodeCount;
+    drte_uint32 nodeCapacity;
+    size_t classCapacity;
+    drte_bool32 hasError;
+} drte_regex_parser;
 
-    // It's important to clear everything to zero in case this is called multiple times after each other which is abolutely possible.
-    pLineCache->pLines = NULL;
-    pLineCache->bufferSize = 0;
-    pLineCache->count = 0;
+drte_bool32 drte_regex__is_word_byte(drte_uint8 c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
 }
 
-size_t drte_line_cache_get_line_count(drte_line_cache* pLineCache)
+drte_bool32 drte_regex__class_contains(const drte_regex* pRegex, drte_uint32 iClass, drte_uint8 c)
 {
-    if (pLineCache == NULL) {
-        return 0;
-    }
-
-    return pLineCache->count;
+    return (pRegex->pClasses[iClass*32 + (c >> 3)] & (1 << (c & 7))) != 0;
 }
 
-
-size_t drte_line_cache_get_line_first_character(drte_line_cache* pLineCache, size_t iLine)
+drte_bool32 drte_regex__check_assertion(drte_uint8 assertion, drte_bool32 isPrevNewLine, drte_bool32 isPrevWord, drte_bool32 isNextNewLine, drte_bool32 isNextWord)
 {
-    if (pLineCache == NULL || iLine >= pLineCache->count) {
-        return 0;
+    switch (assertion)
+    {
+        case DRTE_REGEX_ASSERT_PREV_NEW_LINE:     return isPrevNewLine;
+        case DRTE_REGEX_ASSERT_NEXT_NEW_LINE:     return isNextNewLine;
+        case DRTE_REGEX_ASSERT_WORD_BOUNDARY:     return isPrevWord != isNextWord;
+        case DRTE_REGEX_ASSERT_NOT_WORD_BOUNDARY: return isPrevWord == isNextWord;
+        default: return DRTE_FALSE;
     }
-
-    return pLineCache->pLines[iLine];
 }
 
-void drte_line_cache_set_line_first_character(drte_line_cache* pLineCache, size_t iLine, size_t iCharBeg)
+
+drte_uint32 drte_regex__new_node(drte_regex_parser* pParser, drte_uint8 type)
 {
-    if (pLineCache == NULL || iLine >= pLineCache->count) {
-        return;
+    assert(pParser != NULL);
+
+    if (pParser->nodeCount == pParser->nodeCapacity) {
+        drte_uint32 newCapacity = (pParser->nodeCapacity == 0) ? 64 : pParser->nodeCapacity*2;
+        drte_regex_node* pNewNodes = (drte_regex_node*)realloc(pParser->pNodes, newCapacity * sizeof(*pNewNodes));
+        if (pNewNodes == NULL) {
+            pParser->hasError = DRTE_TRUE;
+            return DRTE_REGEX_NONE;
+        }
+
+        pParser->pNodes = pNewNodes;
+        pParser->nodeCapacity = newCapacity;
     }
 
-    pLineCache->pLines[iLine] = iCharBeg;
+    drte_regex_node* pNode = &pParser->pNodes[pParser->nodeCount];
+    memset(pNode, 0, sizeof(*pNode));
+    pNode->type  = type;
+    pNode->first = DRTE_REGEX_NONE;
+    pNode->last  = DRTE_REGEX_NONE;
+    pNode->next  = DRTE_REGEX_NONE;
+    pNode->prev  = DRTE_REGEX_NONE;
+
+    return pParser->nodeCount++;
 }
 
-drte_bool32 drte_line_cache_insert_lines(drte_line_cache* pLineCache, size_t insertLineIndex, size_t lineCount, size_t characterOffset)
+void drte_regex__append_child(drte_regex_parser* pParser, drte_uint32 iParent, drte_uint32 iChild)
 {
-    if (pLineCache == NULL || insertLineIndex > pLineCache->count) {
-        return DRTE_FALSE;
+    drte_regex_node* pParent = &pParser->pNodes[iParent];
+    if (pParent->last == DRTE_REGEX_NONE) {
+        pParent->first = iChild;
+    } else {
+        pParser->pNodes[pParent->last].next = iChild;
+        pParser->pNodes[iChild].prev = pParent->last;
     }
 
-    size_t newLineCount = pLineCache->count + lineCount;
+    pParent->last = iChild;
+}
 
-    if (newLineCount >= pLineCache->bufferSize) {
-        size_t newLineBufferSize = (pLineCache->bufferSize == 0) ? DRTE_PAGE_LINE_COUNT : drte_round_up(newLineCount, DRTE_PAGE_LINE_COUNT);
-        size_t* pNewLines = (size_t*)realloc(pLineCache->pLines, newLineBufferSize * sizeof(*pNewLines));
-        if (pNewLines == NULL) {
-            return DRTE_FALSE;   // Ran out of memory?
+// Adds a new class to the regex and returns a pointer to it's 32 bytes, all of which are cleared.
+drte_uint8* drte_regex__new_class(drte_regex_parser* pParser, drte_uint32* pClassIndexOut)
+{
+    drte_regex* pRegex = pParser->pRegex;
+    if (pRegex->classCount == pParser->classCapacity) {
+        size_t newCapacity = (pParser->classCapacity == 0) ? 8 : pParser->classCapacity*2;
+        drte_uint8* pNewClasses = (drte_uint8*)realloc(pRegex->pClasses, newCapacity * 32);
+        if (pNewClasses == NULL) {
+            pParser->hasError = DRTE_TRUE;
+            return NULL;
         }
 
-        pLineCache->bufferSize = newLineBufferSize;
-        pLineCache->pLines = pNewLines;
+        pRegex->pClasses = pNewClasses;
+        pParser->classCapacity = newCapacity;
     }
 
-    // All existing lines coming after the line the text was inserted at need to be moved down newLineCount slots. They also need to have their
-    // first character index updated.
-    for (size_t i = pLineCache->count; i > insertLineIndex; --i) {
-        size_t iSrc = i-1;
-        size_t iDst = iSrc + lineCount;
-        pLineCache->pLines[iDst] = pLineCache->pLines[iSrc] + characterOffset;
-    }
+    *pClassIndexOut = (drte_uint32)pRegex->classCount;
 
-    pLineCache->count = newLineCount;
-    return DRTE_TRUE;
+    drte_uint8* pClass = pRegex->pClasses + (pRegex->classCount++)*32;
+    memset(pClass, 0, 32);
+    return pClass;
 }
 
-drte_bool32 drte_line_cache_append_line(drte_line_cache* pLineCache, size_t iLineCharBeg)
+void drte_regex__class_add_range(drte_uint8* pClass, unsigned int lo, unsigned int hi)
 {
-    size_t lineCount = drte_line_cache_get_line_count(pLineCache);
-    if (!drte_line_cache_insert_lines(pLineCache, lineCount, 1, 0)) {
-        return DRTE_FALSE;
+    for (unsigned int c = lo; c <= hi; ++c) {
+        pClass[c >> 3] |= (drte_uint8)(1 << (c & 7));
     }
-
-    drte_line_cache_set_line_first_character(pLineCache, lineCount, iLineCharBeg);
-    return DRTE_TRUE;
 }
 
-drte_bool32 drte_line_cache_remove_lines(drte_line_cache* pLineCache, size_t firstLineIndex, size_t lineCount, size_t characterOffset)
+// Adds the bytes of one of the \d, \w and \s classes, or their negations.
+void drte_regex__class_add_escape(drte_uint8* pClass, char escape)
 {
-    if (pLineCache == NULL || firstLineIndex >= pLineCache->count) {
-        return DRTE_FALSE;
-    }
+    drte_uint8 bits[32];
+    memset(bits, 0, sizeof(bits));
 
-    if (pLineCache->count <= lineCount) {
-        pLineCache->count = 1;
-    } else {
-        for (size_t i = firstLineIndex; i < (pLineCache->count - lineCount); ++i) {
-            size_t iDst = i;
-            size_t iSrc = i + lineCount;
-            pLineCache->pLines[iDst] = pLineCache->pLines[iSrc] - characterOffset;
-        }
+    switch (escape)
+    {
+        case 'd': case 'D':
+        {
+            drte_regex__class_add_range(bits, '0', '9');
+        } break;
+
+        case 'w': case 'W':
+        {
+            for (unsigned int c = 0; c < 256; ++c) {
+                if (drte_regex__is_word_byte((drte_uint8)c)) {
+                    drte_regex__class_add_range(bits, c, c);
+                }
+            }
+        } break;
+
+        case 's': case 'S':
+        {
+            drte_regex__class_add_range(bits, ' ', ' ');
+            drte_regex__class_add_range(bits, '\t', '\r');     // \t \n \v \f \r
+        } break;
 
-        pLineCache->count -= lineCount;
+        default: break;
     }
 
-    return DRTE_TRUE;
+    drte_bool32 isNegated = escape == 'D' || escape == 'W' || escape == 'S';
+    for (int i = 0; i < 32; ++i) {
+        pClass[i] |= isNegated ? (drte_uint8)~bits[i] : bits[i];
+    }
 }
 
-drte_bool32 drte_line_cache_offset_lines(drte_line_cache* pLineCache, size_t firstLineIndex, size_t characterOffset)
+void drte_regex__class_fold_case(drte_uint8* pClass)
 {
-    if (pLineCache == NULL || firstLineIndex >= pLineCache->count) {
-        return DRTE_FALSE;
-    }
-
-    for (size_t iLine = firstLineIndex; iLine < pLineCache->count; ++iLine) {
-        pLineCache->pLines[iLine] += characterOffset;
+    for (unsigned int c = 'a'; c <= 'z'; ++c) {
+        unsigned int C = c - 'a' + 'A';
+        if ((pClass[c >> 3] & (1 << (c & 7))) || (pClass[C >> 3] & (1 << (C & 7)))) {
+            drte_regex__class_add_range(pClass, c, c);
+            drte_regex__class_add_range(pClass, C, C);
+        }
     }
+}
 
-    return DRTE_TRUE;
+int drte_regex__parse_hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
 }
 
-drte_bool32 drte_line_cache_offset_lines_negative(drte_line_cache* pLineCache, size_t firstLineIndex, size_t characterOffset)
+// Parses the character after a backslash that stands for a single byte. Returns -1 if it's not one.
+int drte_regex__parse_escaped_byte(drte_regex_parser* pParser)
 {
-    if (pLineCache == NULL || firstLineIndex >= pLineCache->count) {
-        return DRTE_FALSE;
-    }
+    char c = *pParser->pNext;
+    switch (c)
+    {
+        case 'n': pParser->pNext += 1; return '\n';
+        case 't': pParser->pNext += 1; return '\t';
+        case 'r': pParser->pNext += 1; return '\r';
+        case 'f': pParser->pNext += 1; return '\f';
+        case 'v': pParser->pNext += 1; return '\v';
+        case 'x':
+        {
+            int hi = drte_regex__parse_hex_digit(pParser->pNext[1]);
+            int lo = (hi >= 0) ? drte_regex__parse_hex_digit(pParser->pNext[2]) : -1;
+            if (lo < 0) {
+                return -1;
+            }
 
-    for (size_t iLine = firstLineIndex; iLine < pLineCache->count; ++iLine) {
-        pLineCache->pLines[iLine] -= characterOffset;
-    }
+            pParser->pNext += 3;
+            return (hi << 4) | lo;
+        }
 
-    return DRTE_TRUE;
-}
+        default:
+        {
+            // Letters and digits are reserved for escapes that may be supported later. Everything else is taken literally.
+            if (c == '\0' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+                return -1;
+            }
 
+            pParser->pNext += 1;
+            return (drte_uint8)c;
+        }
+    }
+}
 
-size_t drte_line_cache_find_line_by_character__internal(drte_line_cache* pLineCache, size_t iChar, size_t iLineBeg, size_t iLineEnd)
+drte_uint32 drte_regex__parse_byte_node(drte_regex_parser* pParser, drte_uint8 c)
 {
-    assert(pLineCache != NULL);
+    if ((pParser->pRegex->flags & DRTE_REGEX_CASE_INSENSITIVE) != 0 && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+        drte_uint32 iNode = drte_regex__new_node(pParser, DRTE_REGEX_NODE_CLASS);
+        if (iNode == DRTE_REGEX_NONE) {
+            return DRTE_REGEX_NONE;
+        }
 
-    if ((iLineBeg+1 == iLineEnd) || (iChar >= pLineCache->pLines[iLineBeg] && iChar < pLineCache->pLines[iLineBeg+1])) {
-        return iLineBeg;    // It's on iLineBeg.
+        drte_uint8* pClass = drte_regex__new_class(pParser, &pParser->pNodes[iNode].first);
+        if (pClass == NULL) {
+            return DRTE_REGEX_NONE;
+        }
+
+        drte_regex__class_add_range(pClass, c, c);
+        drte_regex__class_fold_case(pClass);
+        return iNode;
     }
 
-    size_t iLineMid = iLineEnd - ((iLineEnd - iLineBeg)/2);
-    if (iChar >= pLineCache->pLines[iLineMid]) {
-        return drte_line_cache_find_line_by_character__internal(pLineCache, iChar, iLineMid, iLineEnd);
-    } else {
-        return drte_line_cache_find_line_by_character__internal(pLineCache, iChar, iLineBeg, iLineMid);
+    drte_uint32 iNode = drte_regex__new_node(pParser, DRTE_REGEX_NODE_BYTE);
+    if (iNode != DRTE_REGEX_NONE) {
+        pParser->pNodes[iNode].arg = c;
     }
+
+    return iNode;
 }
 
-size_t drte_line_cache_find_line_by_character(drte_line_cache* pLineCache, size_t iChar)
+// Parses a "[...]" class. pNext is just past the opening bracket.
+drte_uint32 drte_regex__parse_class(drte_regex_parser* pParser)
 {
-    if (pLineCache == NULL || pLineCache->count <= 1) {
-        return 0;
+    drte_uint32 iNode = drte_regex__new_node(pParser, DRTE_REGEX_NODE_CLASS);
+    if (iNode == DRTE_REGEX_NONE) {
+        return DRTE_REGEX_NONE;
     }
 
-#if 1
-    if (iChar >= pLineCache->pLines[pLineCache->count-1]) {
-        return pLineCache->count-1;
+    drte_uint32 iClass;
+    drte_uint8* pClass = drte_regex__new_class(pParser, &iClass);
+    if (pClass == NULL) {
+        return DRTE_REGEX_NONE;
     }
 
-    return drte_line_cache_find_line_by_character__internal(pLineCache, iChar, 0, pLineCache->count-1); // <-- We've already checked the last line so start at the second-last line.
-#endif
+    pParser->pNodes[iNode].first = iClass;
 
-#if 0
-    // Linear search. Simple, but slow.
-    size_t lineIndex = 0;
-    for (size_t iLine = 0; iLine < pLineCache->count; ++iLine) {
-        if (pLineCache->pLines[iLine] > iChar) {
+    drte_bool32 isNegated = DRTE_FALSE;
+    if (*pParser->pNext == '^') {
+        isNegated = DRTE_TRUE;
+        pParser->pNext += 1;
+    }
+
+    // A closing bracket straight away is taken literally.
+    drte_bool32 isFirst = DRTE_TRUE;
+    for (;;) {
+        char c = *pParser->pNext;
+        if (c == '\0') {
+            pParser->hasError = DRTE_TRUE;
+            return DRTE_REGEX_NONE;
+        }
+
+        if (c == ']' && !isFirst) {
+            pParser->pNext += 1;
             break;
         }
 
-        lineIndex = iLine;
+        isFirst = DRTE_FALSE;
+
+        int lo;
+        pParser->pNext += 1;
+        if (c == '\\') {
+            char e = *pParser->pNext;
+            if (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S') {
+                drte_regex__class_add_escape(pClass, e);
+                pParser->pNext += 1;
+                continue;
+            }
+
+            lo = drte_regex__parse_escaped_byte(pParser);
+            if (lo < 0) {
+                pParser->hasError = DRTE_TRUE;
+                return DRTE_REGEX_NONE;
+            }
+        } else {
+            lo = (drte_uint8)c;
+        }
+
+        int hi = lo;
+        if (pParser->pNext[0] == '-' && pParser->pNext[1] != ']' && pParser->pNext[1] != '\0') {
+            pParser->pNext += 1;
+
+            c = *pParser->pNext++;
+            if (c == '\\') {
+                hi = drte_regex__parse_escaped_byte(pParser);
+            } else {
+                hi = (drte_uint8)c;
+            }
+
+            if (hi < lo) {
+                pParser->hasError = DRTE_TRUE;
+                return DRTE_REGEX_NONE;
+            }
+        }
+
+        drte_regex__class_add_range(pClass, (unsigned int)lo, (unsigned int)hi);
     }
 
-    return lineIndex;
-#endif
-}
+    if ((pParser->pRegex->flags & DRTE_REGEX_CASE_INSENSITIVE) != 0) {
+        drte_regex__class_fold_case(pClass);
+    }
 
-void drte_line_cache_clear(drte_line_cache* pLineCache)
-{
-    if (pLineCache == NULL) {
-        return;
+    if (isNegated) {
+        for (int i = 0; i < 32; ++i) {
+            pClass[i] = (drte_uint8)~pClass[i];
+        }
     }
 
-    pLineCache->count = 0;
+    return iNode;
 }
 
+drte_uint32 drte_regex__parse_alt(drte_regex_parser* pParser, unsigned int depth);
 
-
-// A drte_segment object is used for iterating over the segments of a chunk of text.
-typedef struct
+drte_uint32 drte_regex__parse_atom(drte_regex_parser* pParser, unsigned int depth)
 {
-    drte_line_cache* pLineCache;
-    size_t iLine;
-    size_t iLineCharBeg;
-    size_t iLineCharEnd;
-    size_t iCursorLine;
-    size_t iCharBeg;
-    size_t iCharEnd;
-    uint8_t fgStyleSlot;
-    uint8_t bgStyleSlot;
-    float posX;
-    float width;
-    drte_bool32 isAtEnd;
-    drte_bool32 isAtEndOfLine;
-} drte_segment;
+    char c = *pParser->pNext++;
+    switch (c)
+    {
+        case '(':
+        {
+            if (depth >= DRTE_REGEX_MAX_DEPTH) {
+                pParser->hasError = DRTE_TRUE;
+                return DRTE_REGEX_NONE;
+            }
 
-float drte_engine__measure_segment(drte_view* pView, drte_segment* pSegment)
-{
-    assert(pView != NULL);
-    assert(pSegment != NULL);
+            drte_uint32 iGroup = DRTE_REGEX_NONE;
+            if (pParser->pNext[0] == '?' && pParser->pNext[1] == ':') {
+                pParser->pNext += 2;
+            } else {
+                if (pParser->pRegex->groupCount == DRTE_REGEX_MAX_GROUPS) {
+                    pParser->hasError = DRTE_TRUE;
+                    return DRTE_REGEX_NONE;
+                }
 
-    drte_engine* pEngine = pView->pEngine;
-    assert(pEngine != NULL);
+                iGroup = (drte_uint32)pParser->pRegex->groupCount++;
+            }
 
+            drte_uint32 iInner = drte_regex__parse_alt(pParser, depth+1);
+            if (iInner == DRTE_REGEX_NONE || *pParser->pNext != ')') {
+                pParser->hasError = DRTE_TRUE;
+                return DRTE_REGEX_NONE;
+            }
 
-    dtk_int32 segmentWidth = 0;
-    if (pSegment->iCharEnd > pSegment->iCharBeg) {
-        uint32_t c = drte_engine_get_utf32(pEngine, pSegment->iCharBeg);
-        if (c == '\t') {
-            // It was a tab segment.
-            float tabWidth = drte_view__get_tab_width_in_pixels(pView);
-            size_t tabCount = pSegment->iCharEnd - pSegment->iCharBeg;
-            float nextTabPos = (float)((int)(pSegment->posX / tabWidth) + 1) * tabWidth;
-            float distanceToNextTab = nextTabPos - pSegment->posX;
-            segmentWidth = (dtk_int32)(distanceToNextTab + ((tabCount-1) * tabWidth));
-        } else if (pSegment->iCharBeg == pSegment->iLineCharEnd) {
-            segmentWidth = 0;
-        } else {
-            // It's normal text. We need to refer to the backend for measuring.
-            dtk_int32 unused;
-            drte_style_token fgStyleToken = drte_engine__get_style_token(pEngine, pSegment->fgStyleSlot);
-            if (pEngine->onMeasureString && fgStyleToken) {
-                pEngine->onMeasureString(pEngine, fgStyleToken, pView->scale, pEngine->text + pSegment->iCharBeg, pSegment->iCharEnd - pSegment->iCharBeg, &segmentWidth, &unused);
+            pParser->pNext += 1;
+
+            if (iGroup == DRTE_REGEX_NONE) {
+                return iInner;
+            }
+
+            drte_uint32 iNode = drte_regex__new_node(pParser, DRTE_REGEX_NODE_GROUP);
+            if (iNode != DRTE_REGEX_NONE) {
+                pParser->pNodes[iNode].group = iGroup;
+                drte_regex__append_child(pParser, iNode, iInner);
             }
+
+            return iNode;
         }
-    }
 
-    return (float)segmentWidth;
-}
+        case '[':
+        {
+            return drte_regex__parse_class(pParser);
+        }
 
-drte_bool32 drte_engine__next_segment(drte_view* pView, drte_segment* pSegment)
-{
-    assert(pView != NULL);
-    assert(pSegment != NULL);
+        case '.':
+        {
+            return drte_regex__new_node(pParser, DRTE_REGEX_NODE_ANY);
+        }
 
-    drte_engine* pEngine = pView->pEngine;
-    assert(pEngine != NULL);
+        case '^':
+        case '$':
+        {
+            drte_uint32 iNode = drte_regex__new_node(pParser, DRTE_REGEX_NODE_ASSERT);
+            if (iNode != DRTE_REGEX_NONE) {
+                pParser->pNodes[iNode].arg = (c == '^') ? DRTE_REGEX_ASSERT_PREV_NEW_LINE : DRTE_REGEX_ASSERT_NEXT_NEW_LINE;
+            }
 
-    // TODO: Handle UTF-8 properly.
-    // TODO: There is LOTS of optimization opportunity in this function.
+            return iNode;
+        }
 
-    // The next segment is clamped to a specific character with the following priorities, from highest priority to lowest
-    // - The end of the text
-    // - The end of the line
-    // - Tab boundaries
-    // - Selection boundaries
-    // - Highlight boundaries
-    //
-    // If the next character begins in the middle of a segment, it will be clamped against said segment.
+        case '*':
+        case '+':
+        case '?':
+        {
+            // Nothing to repeat.
+            pParser->hasError = DRTE_TRUE;
+            return DRTE_REGEX_NONE;
+        }
 
+        case '\\':
+        {
+            char e = *pParser->pNext;
+            if (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S') {
+                pParser->pNext += 1;
 
-    if (pSegment->isAtEnd) {
-        return DRTE_FALSE;
-    }
+                drte_uint32 iNode = drte_regex__new_node(pParser, DRTE_REGEX_NODE_CLASS);
+                if (iNode == DRTE_REGEX_NONE) {
+                    return DRTE_REGEX_NONE;
+                }
 
-    if (pSegment->isAtEndOfLine) {
-        pSegment->iLine += 1;
-        pSegment->posX = 0;
-        pSegment->width = 0;
-        pSegment->isAtEndOfLine = DRTE_FALSE;
-        drte_view_get_line_character_range(pView, pSegment->pLineCache, pSegment->iLine, &pSegment->iLineCharBeg, &pSegment->iLineCharEnd);
+                drte_uint8* pClass = drte_regex__new_class(pParser, &pParser->pNodes[iNode].first);
+                if (pClass == NULL) {
+                    return DRTE_REGEX_NONE;
+                }
 
-        pSegment->iCharEnd = pSegment->iLineCharBeg;
-    }
+                drte_regex__class_add_escape(pClass, e);
+                return iNode;
+            }
 
-    uint8_t fgStyleSlot = pEngine->defaultStyleSlot;
-    uint8_t bgStyleSlot = pEngine->defaultStyleSlot;
+            if (e == 'b' || e == 'B') {
+                pParser->pNext += 1;
 
-    // Find the end of the next segment, but don't modify the segment yet. The reason for this is that we need to measure the segment later.
-    size_t iCharBeg = pSegment->iCharEnd;
-    size_t iCharEnd = iCharBeg;
+                drte_uint32 iNode = drte_regex__new_node(pParser, DRTE_REGEX_NODE_ASSERT);
+                if (iNode != DRTE_REGEX_NONE) {
+                    pParser->pNodes[iNode].arg = (e == 'b') ? DRTE_REGEX_ASSERT_WORD_BOUNDARY : DRTE_REGEX_ASSERT_NOT_WORD_BOUNDARY;
+                }
 
-    if (pView->cursorCount > 0 && pSegment->iLine == pSegment->iCursorLine) {
-        bgStyleSlot = pEngine->activeLineStyleSlot;
-    }
+                return iNode;
+            }
 
+            int b = drte_regex__parse_escaped_byte(pParser);
+            if (b < 0) {
+                pParser->hasError = DRTE_TRUE;
+                return DRTE_REGEX_NONE;
+            }
 
-    drte_bool32 isAnythingSelected = DRTE_FALSE;
-    drte_bool32 isInSelection = DRTE_FALSE;
-    drte_region selection = drte_make_region(0, 0);
-    if (drte_view__get_next_selection_from_character(pView, iCharBeg, &selection)) {
-        isInSelection = iCharBeg >= selection.iCharBeg && iCharBeg < selection.iCharEnd;
-        isAnythingSelected = DRTE_TRUE;
-    }
+            return drte_regex__parse_byte_node(pParser, (drte_uint8)b);
+        }
 
-    if (isInSelection) {
-        bgStyleSlot = pEngine->selectionStyleSlot;
+        default:
+        {
+            return drte_regex__parse_byte_node(pParser, (drte_uint8)c);
+        }
     }
+}
 
+// Parses the number of a "{n,m}" quantifier. Returns -1 if there isn't one.
+drte_int32 drte_regex__parse_count(const char** ppNext)
+{
+    const char* pNext = *ppNext;
+    if (*pNext < '0' || *pNext > '9') {
+        return -1;
+    }
 
+    drte_int32 count = 0;
+    while (*pNext >= '0' && *pNext <= '9') {
+        count = count*10 + (*pNext - '0');
+        if (count > DRTE_REGEX_MAX_REPEAT) {
+            count = DRTE_REGEX_MAX_REPEAT+1;    // Too big. Caught by the caller.
+        }
 
-    // Highlight segment.
-    drte_style_segment highlightSegment;
-    drte_style_token highlightStyleToken;
-    drte_bool32 isInHighlightSegment = DRTE_FALSE;
-    if (pEngine->onGetNextHighlight && pEngine->onGetNextHighlight(pEngine, iCharBeg, &highlightSegment.iCharBeg, &highlightSegment.iCharEnd, &highlightStyleToken, pEngine->pHighlightUserData)) {
-        isInHighlightSegment = iCharBeg >= highlightSegment.iCharBeg && iCharBeg < highlightSegment.iCharEnd;
-    } else {
-        highlightSegment.iCharBeg = (size_t)-1;
-        highlightSegment.iCharEnd = (size_t)-1;
-        highlightStyleToken = drte_engine__get_style_token(pEngine, pEngine->defaultStyleSlot);
+        pNext += 1;
     }
 
+    *ppNext = pNext;
+    return count;
+}
 
+// Parses a "{n}", "{n,}" or "{n,m}" quantifier. Returns DRTE_FALSE and leaves pNext untouched if it's not one, in which case the brace
+// is taken literally.
+drte_bool32 drte_regex__parse_counted_quantifier(drte_regex_parser* pParser, drte_int32* pMinOut, drte_int32* pMaxOut)
+{
+    const char* pNext = pParser->pNext + 1;
 
-    size_t iMaxChar = (size_t)-1;
+    drte_int32 min = drte_regex__parse_count(&pNext);
+    if (min < 0) {
+        return DRTE_FALSE;
+    }
 
-    // Clamp to selection.
-    if (isInSelection) {
-        iMaxChar = selection.iCharEnd;
-    } else if (isAnythingSelected) {
-        if (selection.iCharBeg > iCharBeg) {
-            iMaxChar = selection.iCharBeg;
+    drte_int32 max = min;
+    if (*pNext == ',') {
+        pNext += 1;
+        max = (*pNext == '}') ? -1 : drte_regex__parse_count(&pNext);
+        if (max < -1 || (*pNext == '}' && max == -1 && pNext[-1] != ',')) {
+            return DRTE_FALSE;
         }
     }
 
-    // Clamp to highlight segment.
-    if (isInHighlightSegment) {
-        fgStyleSlot = drte_engine__get_style_slot(pEngine, highlightStyleToken);
-        iMaxChar = drte_min(iMaxChar, highlightSegment.iCharEnd);
-    } else {
-        iMaxChar = drte_min(iMaxChar, highlightSegment.iCharBeg);
+    if (*pNext != '}') {
+        return DRTE_FALSE;
     }
 
+    pParser->pNext = pNext + 1;
+    *pMinOut = min;
+    *pMaxOut = max;
+    return DRTE_TRUE;
+}
 
+drte_uint32 drte_regex__parse_repeat(drte_regex_parser* pParser, unsigned int depth)
+{
+    drte_uint32 iNode = drte_regex__parse_atom(pParser, depth);
 
-    char c = pEngine->text[iCharBeg];
-    if (c == '\0') {
-        pSegment->isAtEnd = DRTE_TRUE;
-    } else {
-        if (iCharBeg == pSegment->iLineCharEnd) {
-            pSegment->isAtEndOfLine = DRTE_TRUE;
-            iCharEnd += 1;
-        } else {
-            for (;;) {
-                c = pEngine->text[iCharEnd];
-                if (c == '\0' || iCharEnd == pSegment->iLineCharEnd) {
-                    break;
-                }
-
-                if (c == '\t') {
-                    if (pEngine->text[iCharBeg] != '\t') {
-                        break;
-                    } else {
-                        // Group tabs into a single segment.
-                        for (;;) {
-                            c = pEngine->text[iCharEnd];
-                            if (c == '\0' || iCharEnd == pSegment->iLineCharEnd || c != '\t') {
-                                break;
-                            }
-
-                            if (iCharEnd == iMaxChar) {
-                                break;
-                            }
-
-                            iCharEnd += 1;
-                        }
-
-                        break;
-                    }
-                }
-
-
-                // Selection and styling segment clamp.
-                if (iCharEnd == iMaxChar) {
-                    break;
-                }
+    while (iNode != DRTE_REGEX_NONE) {
+        drte_int32 min;
+        drte_int32 max;
 
-                iCharEnd += 1;
+        char c = *pParser->pNext;
+        if (c == '*') {
+            min = 0; max = -1; pParser->pNext += 1;
+        } else if (c == '+') {
+            min = 1; max = -1; pParser->pNext += 1;
+        } else if (c == '?') {
+            min = 0; max = 1;  pParser->pNext += 1;
+        } else if (c == '{' && drte_regex__parse_counted_quantifier(pParser, &min, &max)) {
+            if (min > DRTE_REGEX_MAX_REPEAT || max > DRTE_REGEX_MAX_REPEAT || (max != -1 && max < min)) {
+                pParser->hasError = DRTE_TRUE;
+                return DRTE_REGEX_NONE;
             }
+        } else {
+            break;
         }
-    }
 
-    if (iCharBeg == iCharEnd) {
-        assert(pSegment->isAtEnd == DRTE_TRUE);
-        iCharEnd += 1;
-    }
+        drte_uint32 iRepeat = drte_regex__new_node(pParser, DRTE_REGEX_NODE_REPEAT);
+        if (iRepeat == DRTE_REGEX_NONE) {
+            return DRTE_REGEX_NONE;
+        }
 
+        pParser->pNodes[iRepeat].min = min;
+        pParser->pNodes[iRepeat].max = max;
+        pParser->pNodes[iRepeat].arg = DRTE_TRUE;     // Greedy.
+        if (*pParser->pNext == '?') {
+            pParser->pNodes[iRepeat].arg = DRTE_FALSE;
+            pParser->pNext += 1;
+        }
 
-    // We now have everything we need to construct the next segment iterator.
-    pSegment->iCharBeg = iCharBeg;
-    pSegment->iCharEnd = iCharEnd;
-    pSegment->fgStyleSlot = fgStyleSlot;
-    pSegment->bgStyleSlot = bgStyleSlot;
-    pSegment->posX += pSegment->width;
-    pSegment->width = drte_engine__measure_segment(pView, pSegment);
+        drte_regex__append_child(pParser, iRepeat, iNode);
+        iNode = iRepeat;
+    }
 
-    return DRTE_TRUE;
+    return iNode;
 }
 
-drte_bool32 drte_engine__next_segment_on_line(drte_view* pView, drte_segment* pSegment)
+drte_uint32 drte_regex__parse_cat(drte_regex_parser* pParser, unsigned int depth)
 {
-    assert(pView != NULL);
-    assert(pSegment != NULL);
+    drte_uint32 iCat = drte_regex__new_node(pParser, DRTE_REGEX_NODE_CAT);
+    while (iCat != DRTE_REGEX_NONE && *pParser->pNext != '\0' && *pParser->pNext != '|' && *pParser->pNext != ')') {
+        drte_uint32 iNode = drte_regex__parse_repeat(pParser, depth);
+        if (iNode == DRTE_REGEX_NONE) {
+            return DRTE_REGEX_NONE;
+        }
 
-    if (pSegment->isAtEndOfLine) {
-        return DRTE_FALSE;
+        drte_regex__append_child(pParser, iCat, iNode);
     }
 
-    return drte_engine__next_segment(pView, pSegment);
+    return iCat;
 }
 
-drte_bool32 drte_engine__first_segment(drte_view* pView, drte_line_cache* pLineCache, size_t iChar, drte_segment* pSegment)
+drte_uint32 drte_regex__parse_alt(drte_regex_parser* pParser, unsigned int depth)
 {
-    if (pView == NULL || pSegment == NULL) {
-        return DRTE_FALSE;
+    drte_uint32 iFirst = drte_regex__parse_cat(pParser, depth);
+    if (iFirst == DRTE_REGEX_NONE || *pParser->pNext != '|') {
+        return iFirst;
     }
 
-    drte_engine* pEngine = pView->pEngine;
-    if (pEngine == NULL || pEngine->textLength == 0) {
-        return DRTE_FALSE;
+    drte_uint32 iAlt = drte_regex__new_node(pParser, DRTE_REGEX_NODE_ALT);
+    if (iAlt == DRTE_REGEX_NONE) {
+        return DRTE_REGEX_NONE;
     }
 
+    drte_regex__append_child(pParser, iAlt, iFirst);
+    while (*pParser->pNext == '|') {
+        pParser->pNext += 1;
 
-    pSegment->pLineCache = pLineCache;
-    pSegment->iLine = drte_line_cache_find_line_by_character(pLineCache, iChar);
-    pSegment->iCursorLine = drte_view_get_cursor_line(pView, pView->cursorCount-1);
-    pSegment->iCharBeg = iChar;
-    pSegment->iCharEnd = pSegment->iCharBeg;
-    pSegment->fgStyleSlot = pEngine->defaultStyleSlot;
-    pSegment->bgStyleSlot = pEngine->defaultStyleSlot;
-    pSegment->posX = 0;
-    pSegment->width = 0;
-    pSegment->isAtEnd = DRTE_FALSE;
-    pSegment->isAtEndOfLine = DRTE_FALSE;
-    drte_view_get_line_character_range(pView, pSegment->pLineCache, pSegment->iLine, &pSegment->iLineCharBeg, &pSegment->iLineCharEnd);
+        drte_uint32 iNode = drte_regex__parse_cat(pParser, depth);
+        if (iNode == DRTE_REGEX_NONE) {
+            return DRTE_REGEX_NONE;
+        }
 
-    return drte_engine__next_segment(pView, pSegment);
+        drte_regex__append_child(pParser, iAlt, iNode);
+    }
+
+    return iAlt;
 }
 
-drte_bool32 drte_engine__first_segment_on_line(drte_view* pView, drte_line_cache* pLineCache, size_t lineIndex, size_t iChar, drte_segment* pSegment)
+
+drte_uint32 drte_regex__emit(drte_regex_program* pProgram, size_t* pCapacity, drte_uint8 op, drte_uint8 arg, drte_uint32 x, drte_uint32 y)
 {
-    if (pView == NULL || pSegment == NULL) {
-        return DRTE_FALSE;
+    if (pProgram->instCount == DRTE_REGEX_MAX_INSTRUCTIONS) {
+        return DRTE_REGEX_NONE;
     }
 
-    drte_engine* pEngine = pView->pEngine;
-    if (pEngine == NULL || pEngine->textLength == 0) {
-        return DRTE_FALSE;
+    if (pProgram->instCount == *pCapacity) {
+        size_t newCapacity = (*pCapacity == 0) ? 64 : *pCapacity*2;
+        drte_regex_inst* pNewInsts = (drte_regex_inst*)realloc(pProgram->pInsts, newCapacity * sizeof(*pNewInsts));
+        if (pNewInsts == NULL) {
+            return DRTE_REGEX_NONE;
+        }
+
+        pProgram->pInsts = pNewInsts;
+        *pCapacity = newCapacity;
     }
 
+    drte_regex_inst* pInst = &pProgram->pInsts[pProgram->instCount];
+    pInst->op  = op;
+    pInst->arg = arg;
+    pInst->x   = x;
+    pInst->y   = y;
+    return pProgram->instCount++;
+}
 
-    pSegment->pLineCache = pLineCache;
-    pSegment->iLine = lineIndex;
-    pSegment->iCursorLine = drte_view_get_cursor_line(pView, pView->cursorCount-1);
-    pSegment->iCharBeg = iChar;
-    pSegment->iCharEnd = iChar;
-    pSegment->fgStyleSlot = pEngine->defaultStyleSlot;
-    pSegment->bgStyleSlot = pEngine->defaultStyleSlot;
-    pSegment->posX = 0;
-    pSegment->width = 0;
-    pSegment->isAtEnd = DRTE_FALSE;
-    pSegment->isAtEndOfLine = DRTE_FALSE;
+// Makes a split instruction prefer whichever of the two branches is wanted.
+void drte_regex__patch_split(drte_regex_program* pProgram, drte_uint32 iSplit, drte_uint32 iPreferred, drte_uint32 iOther)
+{
+    pProgram->pInsts[iSplit].x = iPreferred;
+    pProgram->pInsts[iSplit].y = iOther;
+}
 
-    if (iChar == (size_t)-1) {
-        pSegment->iCharBeg = drte_view_get_line_first_character(pView, pLineCache, lineIndex);
-        pSegment->iCharEnd = pSegment->iCharBeg;
-    }
+drte_bool32 drte_regex__compile_node(const drte_regex_parser* pParser, drte_uint32 iNode, drte_bool32 isReverse, drte_regex_program* pProgram, size_t* pCapacity)
+{
+    const drte_regex_node* pNode = &pParser->pNodes[iNode];
+    switch (pNode->type)
+    {
+        case DRTE_REGEX_NODE_BYTE:
+        {
+            return drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_BYTE, pNode->arg, 0, 0) != DRTE_REGEX_NONE;
+        }
 
-    pSegment->iLineCharBeg = pSegment->iCharBeg;
-    pSegment->iLineCharEnd = drte_view_get_line_last_character(pView, pLineCache, lineIndex);
+        case DRTE_REGEX_NODE_CLASS:
+        {
+            return drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_CLASS, 0, pNode->first, 0) != DRTE_REGEX_NONE;
+        }
 
-    return drte_engine__next_segment(pView, pSegment);
-}
+        case DRTE_REGEX_NODE_ANY:
+        {
+            return drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_ANY, 0, 0, 0) != DRTE_REGEX_NONE;
+        }
 
+        case DRTE_REGEX_NODE_ASSERT:
+        {
+            drte_uint8 assertion = pNode->arg;
+            if (isReverse) {
+                if (assertion == DRTE_REGEX_ASSERT_PREV_NEW_LINE) {
+                    assertion = DRTE_REGEX_ASSERT_NEXT_NEW_LINE;
+                } else if (assertion == DRTE_REGEX_ASSERT_NEXT_NEW_LINE) {
+                    assertion = DRTE_REGEX_ASSERT_PREV_NEW_LINE;
+                }
+            }
 
+            return drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_ASSERT, assertion, 0, 0) != DRTE_REGEX_NONE;
+        }
 
-// Word iteration.
-typedef struct
-{
-    size_t iCharRangeBeg;
-    size_t iCharRangeEnd;
-    size_t iCharBeg;
-    size_t iCharEnd;
-    drte_bool32 isAtEnd;
-} drte_word_iterator;
+        case DRTE_REGEX_NODE_CAT:
+        {
+            for (drte_uint32 iChild = isReverse ? pNode->last : pNode->first; iChild != DRTE_REGEX_NONE; iChild = isReverse ? pParser->pNodes[iChild].prev : pParser->pNodes[iChild].next) {
+                if (!drte_regex__compile_node(pParser, iChild, isReverse, pProgram, pCapacity)) {
+                    return DRTE_FALSE;
+                }
+            }
 
-drte_bool32 drte_engine__next_word(drte_engine* pEngine, drte_word_iterator* pIterator)
-{
-    if (pEngine == NULL || pIterator == NULL) {
-        return DRTE_FALSE;
-    }
+            return DRTE_TRUE;
+        }
 
-    if (pIterator->isAtEnd) {
-        return DRTE_FALSE;
-    }
+        case DRTE_REGEX_NODE_ALT:
+        {
+            // Every branch but the last is preceeded by a split and followed by a jump to the end. The jumps are chained together
+            // through their targets while the end is unknown.
+            drte_uint32 iLastJmp = DRTE_REGEX_NONE;
+            for (drte_uint32 iChild = pNode->first; iChild != DRTE_REGEX_NONE; iChild = pParser->pNodes[iChild].next) {
+                if (pParser->pNodes[iChild].next == DRTE_REGEX_NONE) {
+                    if (!drte_regex__compile_node(pParser, iChild, isReverse, pProgram, pCapacity)) {
+                        return DRTE_FALSE;
+                    }
+                    break;
+                }
 
-    pIterator->iCharBeg = pIterator->iCharEnd;
+                drte_uint32 iSplit = drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_SPLIT, 0, 0, 0);
+                if (iSplit == DRTE_REGEX_NONE || !drte_regex__compile_node(pParser, iChild, isReverse, pProgram, pCapacity)) {
+                    return DRTE_FALSE;
+                }
 
-    size_t iCharEnd;
-    if (!drte_engine_get_end_of_word_containing_character(pEngine, pIterator->iCharBeg, &iCharEnd)) {
-        pIterator->isAtEnd = DRTE_TRUE;
-        return DRTE_FALSE;
-    }
+                drte_uint32 iJmp = drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_JMP, 0, iLastJmp, 0);
+                if (iJmp == DRTE_REGEX_NONE) {
+                    return DRTE_FALSE;
+                }
 
-    // Always make sure the last character never goes beyond the end of the range.
-    if (iCharEnd > pIterator->iCharRangeEnd) {
-        iCharEnd = pIterator->iCharRangeEnd;
-    }
+                iLastJmp = iJmp;
+                drte_regex__patch_split(pProgram, iSplit, iSplit+1, pProgram->instCount);
+            }
 
-    pIterator->iCharEnd = iCharEnd;
+            while (iLastJmp != DRTE_REGEX_NONE) {
+                drte_uint32 iPrevJmp = pProgram->pInsts[iLastJmp].x;
+                pProgram->pInsts[iLastJmp].x = pProgram->instCount;
+                iLastJmp = iPrevJmp;
+            }
 
-    // If we got an empty word we will fall back to the remaining section of the range as the last part.
-    if (pIterator->iCharBeg == pIterator->iCharEnd) {
-        pIterator->iCharEnd = pIterator->iCharRangeEnd;
-    }
+            return DRTE_TRUE;
+        }
 
+        case DRTE_REGEX_NODE_GROUP:
+        {
+            // Capture groups are only needed by the forward program.
+            if (!isReverse && drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_SAVE, 0, pNode->group*2 + 0, 0) == DRTE_REGEX_NONE) {
+                return DRTE_FALSE;
+            }
 
-    if (pIterator->iCharBeg == pIterator->iCharEnd) {
-        pIterator->isAtEnd = DRTE_TRUE;
-        return DRTE_FALSE;
-    }
+            if (!drte_regex__compile_node(pParser, pNode->first, isReverse, pProgram, pCapacity)) {
+                return DRTE_FALSE;
+            }
 
-    return DRTE_TRUE;
+            if (!isReverse && drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_SAVE, 0, pNode->group*2 + 1, 0) == DRTE_REGEX_NONE) {
+                return DRTE_FALSE;
+            }
+
+            return DRTE_TRUE;
+        }
+
+        case DRTE_REGEX_NODE_REPEAT:
+        {
+            drte_bool32 isGreedy = pNode->arg;
+
+            // The required repetitions. When unbounded, the last of these loops back on itself.
+            for (drte_int32 i = 0; i < pNode->min; ++i) {
+                drte_uint32 iBeg = pProgram->instCount;
+                if (!drte_regex__compile_node(pParser, pNode->first, isReverse, pProgram, pCapacity)) {
+                    return DRTE_FALSE;
+                }
+
+                if (pNode->max == -1 && i+1 == pNode->min) {
+                    drte_uint32 iSplit = drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_SPLIT, 0, 0, 0);
+                    if (iSplit == DRTE_REGEX_NONE) {
+                        return DRTE_FALSE;
+                    }
+
+                    if (isGreedy) {
+                        drte_regex__patch_split(pProgram, iSplit, iBeg, iSplit+1);
+                    } else {
+                        drte_regex__patch_split(pProgram, iSplit, iSplit+1, iBeg);
+                    }
+                }
+            }
+
+            if (pNode->max == -1) {
+                if (pNode->min == 0) {
+                    drte_uint32 iSplit = drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_SPLIT, 0, 0, 0);
+                    if (iSplit == DRTE_REGEX_NONE || !drte_regex__compile_node(pParser, pNode->first, isReverse, pProgram, pCapacity)) {
+                        return DRTE_FALSE;
+                    }
+
+                    if (drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_JMP, 0, iSplit, 0) == DRTE_REGEX_NONE) {
+                        return DRTE_FALSE;
+                    }
+
+                    if (isGreedy) {
+                        drte_regex__patch_split(pProgram, iSplit, iSplit+1, pProgram->instCount);
+                    } else {
+                        drte_regex__patch_split(pProgram, iSplit, pProgram->instCount, iSplit+1);
+                    }
+                }
+
+                return DRTE_TRUE;
+            }
+
+            // The optional repetitions. Each one can skip to the end, which isn't known until they've all been compiled so the splits
+            // are chained together through their second branch in the mean time.
+            drte_uint32 iLastSplit = DRTE_REGEX_NONE;
+            for (drte_int32 i = pNode->min; i < pNode->max; ++i) {
+                drte_uint32 iSplit = drte_regex__emit(pProgram, pCapacity, DRTE_REGEX_OP_SPLIT, 0, 0, iLastSplit);
+                if (iSplit == DRTE_REGEX_NONE || !drte_regex__compile_node(pParser, pNode->first, isReverse, pProgram, pCapacity)) {
+                    return DRTE_FALSE;
+                }
+
+                iLastSplit = iSplit;
+            }
+
+            while (iLastSplit != DRTE_REGEX_NONE) {
+                drte_uint32 iPrevSplit = pProgram->pInsts[iLastSplit].y;
+                if (isGreedy) {
+                    drte_regex__patch_split(pProgram, iLastSplit, iLastSplit+1, pProgram->instCount);
+                } else {
+                    drte_regex__patch_split(pProgram, iLastSplit, pProgram->instCount, iLastSplit+1);
+                }
+
+                iLastSplit = iPrevSplit;
+            }
+
+            return DRTE_TRUE;
+        }
+
+        default: return DRTE_FALSE;
+    }
 }
 
-drte_bool32 drte_engine__first_word(drte_engine* pEngine, size_t iCharRangeBeg, size_t iCharRangeEnd, drte_word_iterator* pIterator)
+drte_bool32 drte_regex__compile_program(const drte_regex_parser* pParser, drte_uint32 iRoot, drte_bool32 isReverse, drte_regex_program* pProgram)
 {
-    if (pEngine == NULL || pEngine->textLength == 0 || pIterator == NULL) {
+    size_t capacity = 0;
+
+    memset(pProgram, 0, sizeof(*pProgram));
+    pProgram->isLongest = isReverse;
+
+    drte_bool32 result = DRTE_TRUE;
+    if (!isReverse) result = result && drte_regex__emit(pProgram, &capacity, DRTE_REGEX_OP_SAVE, 0, 0, 0) != DRTE_REGEX_NONE;
+    result = result && drte_regex__compile_node(pParser, iRoot, isReverse, pProgram, &capacity);
+    if (!isReverse) result = result && drte_regex__emit(pProgram, &capacity, DRTE_REGEX_OP_SAVE, 0, 1, 0) != DRTE_REGEX_NONE;
+    result = result && drte_regex__emit(pProgram, &capacity, DRTE_REGEX_OP_MATCH, 0, 0, 0) != DRTE_REGEX_NONE;
+
+    if (!result) {
         return DRTE_FALSE;
     }
 
-    if (iCharRangeBeg >= iCharRangeEnd) {
-        return DRTE_FALSE;
+    // States only need to remember what the previous character was if the program checks it.
+    pProgram->flagsMask = DRTE_REGEX_DFA_MATCH | DRTE_REGEX_DFA_START;
+    for (drte_uint32 pc = 0; pc < pProgram->instCount; ++pc) {
+        if (pProgram->pInsts[pc].op == DRTE_REGEX_OP_ASSERT) {
+            if (pProgram->pInsts[pc].arg == DRTE_REGEX_ASSERT_PREV_NEW_LINE) {
+                pProgram->flagsMask |= DRTE_REGEX_DFA_PREV_NEW_LINE;
+            }
+            if (pProgram->pInsts[pc].arg == DRTE_REGEX_ASSERT_WORD_BOUNDARY || pProgram->pInsts[pc].arg == DRTE_REGEX_ASSERT_NOT_WORD_BOUNDARY) {
+                pProgram->flagsMask |= DRTE_REGEX_DFA_PREV_WORD;
+            }
+        }
     }
 
-    if (iCharRangeBeg > pEngine->textLength) {
+    // The closure stack, the instructions of the next state and the visited stamps.
+    pProgram->pScratch = (drte_uint32*)calloc((size_t)pProgram->instCount*5 + 1, sizeof(*pProgram->pScratch));
+    if (pProgram->pScratch == NULL) {
         return DRTE_FALSE;
     }
 
-    // Clamp the end character to the last character in the text.
-    if (iCharRangeEnd > pEngine->textLength) {
-        iCharRangeEnd = pEngine->textLength;
-    }
+    return DRTE_TRUE;
+}
 
+void drte_regex__clear_dfa(drte_regex_program* pProgram)
+{
+    for (size_t i = 0; i < pProgram->stateCapacity; ++i) {
+        free(pProgram->pStates[i]);
+        pProgram->pStates[i] = NULL;
+    }
 
-    pIterator->iCharRangeBeg = iCharRangeBeg;
-    pIterator->iCharRangeEnd = iCharRangeEnd;
-    pIterator->iCharBeg = iCharRangeBeg;
-    pIterator->iCharEnd = iCharRangeBeg;
-    pIterator->isAtEnd = DRTE_FALSE;
+    pProgram->stateCount  = 0;
+    pProgram->stateMemory = 0;
+}
 
-    return drte_engine__next_word(pEngine, pIterator);
+void drte_regex__uninit_program(drte_regex_program* pProgram)
+{
+    drte_regex__clear_dfa(pProgram);
+    free(pProgram->pStates);
+    free(pProgram->pScratch);
+    free(pProgram->pInsts);
+    memset(pProgram, 0, sizeof(*pProgram));
 }
 
+// Splits the bytes into classes which no instruction can tell apart. DFA transitions are stored per class rather than per byte.
+void drte_regex__compute_byte_classes(drte_regex* pRegex)
+{
+    assert(pRegex != NULL);
 
+    drte_uint8 newLine[32];
+    memset(newLine, 0, sizeof(newLine));
+    drte_regex__class_add_range(newLine, '\n', '\n');
 
+    drte_uint8 word[32];
+    memset(word, 0, sizeof(word));
+    drte_regex__class_add_escape(word, 'w');
 
-void drte_engine__push_text_change_to_prepared_undo_state(drte_engine* pEngine, drte_undo_change_type type, size_t iCharBeg, size_t iCharEnd, const char* text)
-{
-    if (pEngine == NULL || text == NULL) {
-        return;
-    }
+    memset(pRegex->byteClasses, 0, sizeof(pRegex->byteClasses));
+    size_t classCount = 1;
 
-    size_t sizeInBytes =
-        sizeof(type) +
-        sizeof(size_t) +
-        sizeof(size_t) +
-        (iCharEnd - iCharBeg) + 1;  // +1 for null terminator.
+    const drte_regex_program* pProgram = &pRegex->forward;
+    for (drte_uint32 pc = 0; pc <= pProgram->instCount; ++pc) {
+        drte_uint8 single[32];
+        const drte_uint8* pSet = NULL;
+        if (pc == pProgram->instCount) {
+            pSet = newLine;     // Always split new lines out because the DFA needs to know about them for "^" and "$".
+        } else {
+            const drte_regex_inst* pInst = &pProgram->pInsts[pc];
+            if (pInst->op == DRTE_REGEX_OP_BYTE) {
+                memset(single, 0, sizeof(single));
+                drte_regex__class_add_range(single, pInst->arg, pInst->arg);
+                pSet = single;
+            } else if (pInst->op == DRTE_REGEX_OP_CLASS) {
+                pSet = pRegex->pClasses + pInst->x*32;
+            } else if (pInst->op == DRTE_REGEX_OP_ASSERT && (pInst->arg == DRTE_REGEX_ASSERT_WORD_BOUNDARY || pInst->arg == DRTE_REGEX_ASSERT_NOT_WORD_BOUNDARY)) {
+                pSet = word;
+            }
+        }
 
-    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(&pEngine->preparedUndoState, sizeInBytes);
-    if (pData == NULL) {
-        return;
-    }
+        if (pSet == NULL) {
+            continue;
+        }
 
-    memcpy(pData, &type, sizeof(type));
-    memcpy(pData + sizeof(type), &iCharBeg, sizeof(iCharBeg));
-    memcpy(pData + sizeof(type) + sizeof(iCharBeg), &iCharEnd, sizeof(iCharEnd));
-    memcpy(pData + sizeof(type) + sizeof(iCharBeg) + sizeof(iCharEnd), text, (iCharEnd - iCharBeg));
-    *(pData + sizeof(type) + sizeof(iCharBeg) + sizeof(iCharEnd) + (iCharEnd - iCharBeg)) = '\0';
+        drte_int16 remap[512];
+        for (int i = 0; i < 512; ++i) {
+            remap[i] = -1;
+        }
 
-    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->preparedUndoState, pEngine->preparedUndoTextChangesOffset)) += 1;
-}
+        size_t newClassCount = 0;
+        for (unsigned int c = 0; c < 256; ++c) {
+            int key = pRegex->byteClasses[c]*2 + ((pSet[c >> 3] & (1 << (c & 7))) ? 1 : 0);
+            if (remap[key] == -1) {
+                remap[key] = (drte_int16)newClassCount++;
+            }
 
+            pRegex->byteClasses[c] = (drte_uint8)remap[key];
+        }
 
-drte_bool32 drte_engine_init(drte_engine* pEngine, void* pUserData)
+        classCount = newClassCount;
+    }
+
+    pRegex->byteClassCount = classCount;
+    for (int c = 255; c >= 0; --c) {
+        pRegex->byteClassReps[pRegex->byteClasses[c]] = (drte_uint8)c;
+    }
+}
+
+drte_bool32 drte_regex_init(drte_regex* pRegex, const char* pattern, unsigned int flags)
 {
-    if (pEngine == NULL) {
+    if (pRegex == NULL) {
         return DRTE_FALSE;
     }
 
-    memset(pEngine, 0, sizeof(*pEngine));
+    memset(pRegex, 0, sizeof(*pRegex));
 
-    pEngine->defaultStyleSlot = DRTE_INVALID_STYLE_SLOT;
-    pEngine->selectionStyleSlot = DRTE_INVALID_STYLE_SLOT;
-    pEngine->activeLineStyleSlot = DRTE_INVALID_STYLE_SLOT;
-    pEngine->cursorStyleSlot = DRTE_INVALID_STYLE_SLOT;
-    pEngine->lineNumbersStyleSlot = DRTE_INVALID_STYLE_SLOT;
+    if (pattern == NULL || pattern[0] == '\0') {
+        return DRTE_FALSE;
+    }
 
+    pRegex->flags = flags;
+    pRegex->groupCount = 1;
 
-    // Note that _wrappedLines is intentionally left uninitialized because word wrap is disabled by default.
-    drte_line_cache_init(&pEngine->_unwrappedLines);
+    drte_regex_parser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.pRegex = pRegex;
+    parser.pNext  = pattern;
 
-    // Both line caches point to the same underlying structure to save on memory. This is only the case when word wrap is disabled, which is
-    // the default behaviour.
-    pEngine->pUnwrappedLines = &pEngine->_unwrappedLines;
+    drte_uint32 iRoot = drte_regex__parse_alt(&parser, 0);
 
-    pEngine->cursorBlinkRate       = 500;
-    pEngine->timeToNextCursorBlink = pEngine->cursorBlinkRate;
-    pEngine->isCursorBlinkOn       = DRTE_TRUE;
-    pEngine->pUserData             = pUserData;
+    drte_bool32 result = iRoot != DRTE_REGEX_NONE && !parser.hasError && *parser.pNext == '\0';
+    result = result && drte_regex__compile_program(&parser, iRoot, DRTE_FALSE, &pRegex->forward);
+    result = result && drte_regex__compile_program(&parser, iRoot, DRTE_TRUE,  &pRegex->reverse);
 
-    drte_stack_buffer_init(&pEngine->preparedUndoState);
-    drte_stack_buffer_init(&pEngine->undoBuffer);
+    free(parser.pNodes);
 
+    if (result) {
+        size_t patternLength = strlen(pattern);
+        pRegex->pPattern = (char*)malloc(patternLength + 1);
+        result = pRegex->pPattern != NULL;
+        if (result) {
+            memcpy(pRegex->pPattern, pattern, patternLength + 1);
+        }
+    }
 
-    // The temporary view.
-    //pEngine->pView = drte_view_create(pEngine);
+    if (!result) {
+        drte_regex_uninit(pRegex);
+        return DRTE_FALSE;
+    }
 
+    drte_regex__compute_byte_classes(pRegex);
     return DRTE_TRUE;
 }
 
-void drte_engine_uninit(drte_engine* pEngine)
+void drte_regex_uninit(drte_regex* pRegex)
 {
-    if (pEngine == NULL) {
+    if (pRegex == NULL) {
         return;
     }
 
-    // All views need to be deleted.
-    while (pEngine->pRootView != NULL) {
-        drte_view_delete(pEngine->pRootView);
-    }
-
-
-    drte_engine_clear_undo_stack(pEngine);
-
-    drte_stack_buffer_uninit(&pEngine->undoBuffer);
-    drte_stack_buffer_uninit(&pEngine->preparedUndoState);
-
-    drte_line_cache_uninit(&pEngine->_unwrappedLines);
-
-    //free(pEngine->pView->pSelections);
-    //free(pEngine->pView->pCursors);
-
-    free(pEngine->text);
+    drte_regex__uninit_program(&pRegex->forward);
+    drte_regex__uninit_program(&pRegex->reverse);
+    free(pRegex->pClasses);
+    free(pRegex->pPattern);
+    memset(pRegex, 0, sizeof(*pRegex));
 }
 
 
-size_t drte_engine_get_view_count(drte_engine* pEngine)
+drte_uint32 drte_regex__hash_dfa_state(drte_uint32 flags, const drte_uint32* pInsts, drte_uint32 instCount)
 {
-    size_t count = 0;
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        count += 1;
+    // FNV-1a.
+    drte_uint32 hash = 2166136261u;
+    hash = (hash ^ flags) * 16777619u;
+    for (drte_uint32 i = 0; i < instCount; ++i) {
+        hash = (hash ^ pInsts[i]) * 16777619u;
     }
 
-    return count;
+    return hash;
 }
 
-
-drte_bool32 drte_engine_register_style_token(drte_engine* pEngine, drte_style_token styleToken, drte_font_metrics fontMetrics)
+// Finds the state with the given flags and instructions, creating it if it doesn't exist. If the cache is full it's cleared first, in
+// which case *pWasClearedOut is set to DRTE_TRUE and any state pointers held by the caller are no longer valid.
+drte_regex_dfa_state* drte_regex__get_dfa_state(drte_regex* pRegex, drte_regex_program* pProgram, drte_uint32 flags, const drte_uint32* pInsts, drte_uint32 instCount, drte_bool32* pWasClearedOut)
 {
-    if (pEngine == NULL) {
-        return DRTE_FALSE;
+    drte_uint32 hash = drte_regex__hash_dfa_state(flags, pInsts, instCount);
+
+    if (pProgram->stateCapacity > 0) {
+        size_t mask = pProgram->stateCapacity-1;
+        for (size_t i = hash & mask; pProgram->pStates[i] != NULL; i = (i+1) & mask) {
+            drte_regex_dfa_state* pState = pProgram->pStates[i];
+            if (pState->hash == hash && pState->flags == flags && pState->instCount == instCount && memcmp(pState->pInsts, pInsts, instCount * sizeof(*pInsts)) == 0) {
+                return pState;
+            }
+        }
     }
 
-    // If the token already exists just refresh.
-    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
-    if (styleSlot != DRTE_INVALID_STYLE_SLOT) {
-        pEngine->styles[styleSlot].fontMetrics = fontMetrics;
+    size_t transitionCount = pRegex->byteClassCount + 1;
+    size_t stateSize = sizeof(drte_regex_dfa_state) + (transitionCount-1)*sizeof(drte_regex_dfa_state*) + instCount*sizeof(drte_uint32);
+    if (pProgram->stateMemory + stateSize > DRTE_REGEX_DFA_CACHE_SIZE && pProgram->stateCount > 0) {
+        drte_regex__clear_dfa(pProgram);
+        *pWasClearedOut = DRTE_TRUE;
+    }
 
-        if (!(pEngine->flags & DRTE_USE_EXPLICIT_LINE_HEIGHT)) {
-            pEngine->lineHeight = 0;
-            for (uint16_t i = 0; i < pEngine->styleCount; ++i) {
-                if (pEngine->lineHeight < fontMetrics.lineHeight) {
-                    pEngine->lineHeight = fontMetrics.lineHeight;
+    if ((pProgram->stateCount+1)*2 > pProgram->stateCapacity) {
+        size_t newCapacity = (pProgram->stateCapacity == 0) ? 64 : pProgram->stateCapacity*2;
+        drte_regex_dfa_state** pNewStates = (drte_regex_dfa_state**)calloc(newCapacity, sizeof(*pNewStates));
+        if (pNewStates == NULL) {
+            return NULL;
+        }
+
+        for (size_t i = 0; i < pProgram->stateCapacity; ++i) {
+            if (pProgram->pStates[i] != NULL) {
+                size_t j = pProgram->pStates[i]->hash & (newCapacity-1);
+                while (pNewStates[j] != NULL) {
+                    j = (j+1) & (newCapacity-1);
                 }
+
+                pNewStates[j] = pProgram->pStates[i];
             }
         }
 
-        drte_engine__refresh(pEngine);
-        return DRTE_TRUE;
+        free(pProgram->pStates);
+        pProgram->pStates = pNewStates;
+        pProgram->stateCapacity = newCapacity;
     }
 
-
-    // If we get here it means the style has not previously been registered. We don't need to do any repainting or refreshing here
-    // because the style will not actually be used by anything yet.
-    if (pEngine->styleCount == 255) {
-        return DRTE_FALSE;   // Too many styles. The 256'th slot (index 255) is used as the error indicator.
+    drte_regex_dfa_state* pState = (drte_regex_dfa_state*)calloc(1, stateSize);
+    if (pState == NULL) {
+        return NULL;
     }
 
-    // Line heights need to be refreshed if it has not been set explicitly.
-    if (pEngine->lineHeight < fontMetrics.lineHeight && (pEngine->flags & DRTE_USE_EXPLICIT_LINE_HEIGHT) == 0) {
-        pEngine->lineHeight = fontMetrics.lineHeight;
+    pState->flags = flags;
+    pState->instCount = instCount;
+    pState->hash = hash;
+    pState->pInsts = (drte_uint32*)(pState->pNext + transitionCount);
+    memcpy(pState->pInsts, pInsts, instCount * sizeof(*pInsts));
+
+    size_t i = hash & (pProgram->stateCapacity-1);
+    while (pProgram->pStates[i] != NULL) {
+        i = (i+1) & (pProgram->stateCapacity-1);
     }
 
-    pEngine->styles[pEngine->styleCount].styleToken = styleToken;
-    pEngine->styles[pEngine->styleCount].fontMetrics = fontMetrics;
+    pProgram->pStates[i] = pState;
+    pProgram->stateCount += 1;
+    pProgram->stateMemory += stateSize;
 
-    pEngine->styleCount += 1;
-    return DRTE_TRUE;
+    return pState;
 }
 
-void drte_engine_set_default_style(drte_engine* pEngine, drte_style_token styleToken)
+// Retrieves the flags describing the character before the start of a search, or -1 if the search starts at the edge of the text.
+drte_uint32 drte_regex__get_prev_flags(int c)
 {
-    if (pEngine == NULL) {
-        return;
+    drte_uint32 flags = 0;
+    if (c < 0 || c == '\n') {
+        flags |= DRTE_REGEX_DFA_PREV_NEW_LINE;
     }
-
-    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
-    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
-        return;
+    if (c >= 0 && drte_regex__is_word_byte((drte_uint8)c)) {
+        flags |= DRTE_REGEX_DFA_PREV_WORD;
     }
 
-    if (pEngine->defaultStyleSlot == styleSlot) {
-        return; // Nothing has changed.
+    return flags;
+}
+
+// Retrieves the state a search starts in. Unanchored searches start a new thread at every character whereas anchored searches only
+// start one at the beginning.
+drte_regex_dfa_state* drte_regex__get_dfa_start_state(drte_regex* pRegex, drte_regex_program* pProgram, int prevChar, drte_bool32 isAnchored)
+{
+    drte_uint32 flags = drte_regex__get_prev_flags(prevChar);
+    if (!isAnchored) {
+        flags |= DRTE_REGEX_DFA_START;
     }
 
-    pEngine->defaultStyleSlot = styleSlot;
-    drte_engine__refresh(pEngine);
+    drte_uint32 startInst = 0;
+    drte_bool32 wasCleared = DRTE_FALSE;
+    return drte_regex__get_dfa_state(pRegex, pProgram, flags & pProgram->flagsMask, &startInst, isAnchored ? 1 : 0, &wasCleared);
 }
 
-void drte_engine_set_selection_style(drte_engine* pEngine, drte_style_token styleToken)
+// Builds the transition out of the given state for a byte class, or for the edge of the text when iByteClass is byteClassCount.
+drte_regex_dfa_state* drte_regex__get_dfa_next_state(drte_regex* pRegex, drte_regex_program* pProgram, drte_regex_dfa_state* pState, size_t iByteClass)
 {
-    if (pEngine == NULL) {
-        return;
-    }
+    drte_bool32 isEdge = iByteClass == pRegex->byteClassCount;
+    drte_uint8 c = isEdge ? 0 : pRegex->byteClassReps[iByteClass];
 
-    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
-    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
-        return;
-    }
+    drte_bool32 isPrevNewLine = (pState->flags & DRTE_REGEX_DFA_PREV_NEW_LINE) != 0;
+    drte_bool32 isPrevWord    = (pState->flags & DRTE_REGEX_DFA_PREV_WORD) != 0;
+    drte_bool32 isNextNewLine = isEdge || c == '\n';
+    drte_bool32 isNextWord    = !isEdge && drte_regex__is_word_byte(c);
 
-    if (pEngine->selectionStyleSlot == styleSlot) {
-        return; // Nothing has changed.
+    drte_uint32 instCount = pProgram->instCount;
+    drte_uint32* pStack     = pProgram->pScratch;
+    drte_uint32* pNextInsts = pStack + instCount*3 + 1;
+    drte_uint32* pVisited   = pNextInsts + instCount;
+    drte_uint32 nextInstCount = 0;
+
+    pProgram->visitStamp += 1;
+    if (pProgram->visitStamp == 0) {
+        memset(pVisited, 0, instCount * sizeof(*pVisited));
+        pProgram->visitStamp = 1;
     }
 
-    pEngine->selectionStyleSlot = styleSlot;
+    // Each thread is followed through it's empty transitions in order of priority. A match cuts off every thread with a lower priority
+    // unless the program is looking for the longest match.
+    drte_bool32 isMatch = DRTE_FALSE;
+    drte_bool32 isCut = DRTE_FALSE;
+    drte_uint32 threadCount = pState->instCount + (((pState->flags & DRTE_REGEX_DFA_START) != 0) ? 1 : 0);
+    for (drte_uint32 iThread = 0; iThread < threadCount && !isCut; ++iThread) {
+        drte_uint32 stackCount = 0;
+        pStack[stackCount++] = (iThread < pState->instCount) ? pState->pInsts[iThread] : 0;
 
+        while (stackCount > 0) {
+            drte_uint32 pc = pStack[--stackCount];
+            if (pVisited[pc] == pProgram->visitStamp) {
+                continue;
+            }
 
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        if (drte_view_is_anything_selected(pView)) {
-            drte_view__refresh_word_wrapping(pView);    // <-- This will repaint.
+            pVisited[pc] = pProgram->visitStamp;
+
+            const drte_regex_inst* pInst = &pProgram->pInsts[pc];
+            switch (pInst->op)
+            {
+                case DRTE_REGEX_OP_BYTE:
+                {
+                    if (!isEdge && c == pInst->arg) {
+                        pNextInsts[nextInstCount++] = pc+1;
+                    }
+                } break;
+
+                case DRTE_REGEX_OP_CLASS:
+                {
+                    if (!isEdge && drte_regex__class_contains(pRegex, pInst->x, c)) {
+                        pNextInsts[nextInstCount++] = pc+1;
+                    }
+                } break;
+
+                case DRTE_REGEX_OP_ANY:
+                {
+                    if (!isEdge && c != '\n') {
+                        pNextInsts[nextInstCount++] = pc+1;
+                    }
+                } break;
+
+                case DRTE_REGEX_OP_SPLIT:
+                {
+                    pStack[stackCount++] = pInst->y;
+                    pStack[stackCount++] = pInst->x;
+                } break;
+
+                case DRTE_REGEX_OP_JMP:
+                {
+                    pStack[stackCount++] = pInst->x;
+                } break;
+
+                case DRTE_REGEX_OP_SAVE:
+                {
+                    pStack[stackCount++] = pc+1;
+                } break;
+
+                case DRTE_REGEX_OP_ASSERT:
+                {
+                    if (drte_regex__check_assertion(pInst->arg, isPrevNewLine, isPrevWord, isNextNewLine, isNextWord)) {
+                        pStack[stackCount++] = pc+1;
+                    }
+                } break;
+
+                case DRTE_REGEX_OP_MATCH:
+                {
+                    isMatch = DRTE_TRUE;
+                    if (!pProgram->isLongest) {
+                        isCut = DRTE_TRUE;
+                        stackCount = 0;
+                    }
+                } break;
+
+                default: break;
+            }
         }
     }
-}
 
-void drte_engine_set_active_line_style(drte_engine* pEngine, drte_style_token styleToken)
-{
-    if (pEngine == NULL) {
-        return;
+    drte_uint32 flags = 0;
+    if (isMatch) {
+        flags |= DRTE_REGEX_DFA_MATCH;
     }
-
-    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
-    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
-        return;
+    if (isNextNewLine) {
+        flags |= DRTE_REGEX_DFA_PREV_NEW_LINE;
     }
-
-    if (pEngine->activeLineStyleSlot == styleSlot) {
-        return; // Nothing has changed.
+    if (isNextWord) {
+        flags |= DRTE_REGEX_DFA_PREV_WORD;
     }
-
-    pEngine->activeLineStyleSlot = styleSlot;
-    drte_engine__refresh(pEngine);
-}
-
-void drte_engine_set_cursor_style(drte_engine* pEngine, drte_style_token styleToken)
-{
-    if (pEngine == NULL) {
-        return;
+    if ((pState->flags & DRTE_REGEX_DFA_START) != 0 && !isCut && !isEdge) {
+        flags |= DRTE_REGEX_DFA_START;
     }
 
-    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
-    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
-        return;
+    drte_bool32 wasCleared = DRTE_FALSE;
+    drte_regex_dfa_state* pNextState = drte_regex__get_dfa_state(pRegex, pProgram, flags & pProgram->flagsMask, pNextInsts, nextInstCount, &wasCleared);
+    if (pNextState != NULL && !wasCleared) {
+        pState->pNext[iByteClass] = pNextState;
     }
 
-    if (pEngine->cursorStyleSlot == styleSlot) {
-        return; // Nothing has changed.
-    }
+    return pNextState;
+}
 
-    pEngine->cursorStyleSlot = styleSlot;
-    drte_engine__refresh(pEngine);
+drte_bool32 drte_regex__is_dfa_state_dead(const drte_regex_dfa_state* pState)
+{
+    return pState->instCount == 0 && (pState->flags & DRTE_REGEX_DFA_START) == 0;
 }
 
-void drte_engine_set_line_numbers_style(drte_engine* pEngine, drte_style_token styleToken)
+// Simulates the forward program as an NFA, anchored at the start of the given text, to find the capture groups of the highest priority
+// match ending at the end of it. prevChar and nextChar are the characters either side of the text, or -1 at the edge of the text.
+drte_bool32 drte_regex__find_groups(drte_regex* pRegex, const char* text, size_t textLength, int prevChar, int nextChar, size_t* pGroupsOut)
 {
-    if (pEngine == NULL) {
-        return;
-    }
+    drte_regex_program* pProgram = &pRegex->forward;
+    drte_uint32 instCount = pProgram->instCount;
+    size_t slotCount = pRegex->groupCount*2;
 
-    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
-    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
-        return;
-    }
+    // Each list has a thread for each instruction at most, and each thread has a copy of the capture slots.
+    typedef struct { drte_uint32 pc; drte_uint32 slot; size_t value; } drte_regex_stack_item;
 
-    if (pEngine->lineNumbersStyleSlot == styleSlot) {
-        return; // Nothing has changed.
+    size_t* pSlots = (size_t*)malloc((instCount*2 + 1) * slotCount * sizeof(size_t));
+    drte_uint32* pThreads = (drte_uint32*)malloc(instCount*2 * sizeof(drte_uint32));
+    drte_uint32* pVisited = (drte_uint32*)calloc(instCount, sizeof(drte_uint32));
+    drte_regex_stack_item* pStack = (drte_regex_stack_item*)malloc((instCount*3 + 1) * sizeof(drte_regex_stack_item));
+    if (pSlots == NULL || pThreads == NULL || pVisited == NULL || pStack == NULL) {
+        free(pSlots);
+        free(pThreads);
+        free(pVisited);
+        free(pStack);
+        return DRTE_FALSE;
     }
 
-    pEngine->lineNumbersStyleSlot = styleSlot;
-    drte_engine__refresh(pEngine);
-}
+    drte_uint32* pCurrThreads = pThreads;
+    drte_uint32* pNextThreads = pThreads + instCount;
+    size_t* pCurrSlots = pSlots;
+    size_t* pNextSlots = pSlots + instCount*slotCount;
+    size_t* pWorkingSlots = pSlots + instCount*2*slotCount;
+    drte_uint32 currThreadCount = 0;
+    drte_uint32 visitStamp = 0;
+
+    drte_bool32 isMatch = DRTE_FALSE;
+    for (size_t i = 0; i < slotCount; ++i) {
+        pWorkingSlots[i] = (size_t)-1;
+        pGroupsOut[i] = (size_t)-1;
+    }
+
+    for (size_t iChar = 0; ; ++iChar) {
+        int prev = (iChar == 0) ? prevChar : (drte_uint8)text[iChar-1];
+        int next = (iChar == textLength) ? nextChar : (drte_uint8)text[iChar];
+        drte_bool32 isPrevNewLine = prev < 0 || prev == '\n';
+        drte_bool32 isPrevWord    = prev >= 0 && drte_regex__is_word_byte((drte_uint8)prev);
+        drte_bool32 isNextNewLine = next < 0 || next == '\n';
+        drte_bool32 isNextWord    = next >= 0 && drte_regex__is_word_byte((drte_uint8)next);
+
+        // Follow the empty transitions of every thread that consumed the previous character, plus the initial thread, in order of
+        // priority. The stack doubles as a way of restoring capture slots once a branch has been followed.
+        visitStamp += 1;
+        drte_uint32 nextThreadCount = 0;
+        drte_uint32 threadCount = (iChar == 0) ? 1 : currThreadCount;
+        for (drte_uint32 iThread = 0; iThread < threadCount; ++iThread) {
+            size_t stackCount = 0;
+            if (iChar == 0) {
+                pStack[stackCount].pc = 0;
+            } else {
+                pStack[stackCount].pc = pCurrThreads[iThread] + 1;
+                memcpy(pWorkingSlots, pCurrSlots + iThread*slotCount, slotCount * sizeof(size_t));
+            }
+            pStack[stackCount++].slot = DRTE_REGEX_NONE;
 
+            while (stackCount > 0) {
+                drte_regex_stack_item item = pStack[--stackCount];
+                if (item.slot != DRTE_REGEX_NONE) {
+                    pWorkingSlots[item.slot] = item.value;
+                    continue;
+                }
 
-void drte_engine_set_highlighter(drte_engine* pEngine, drte_engine_on_get_next_highlight_proc proc, void* pUserData)
-{
-    if (pEngine == NULL) {
-        return;
-    }
+                if (pVisited[item.pc] == visitStamp) {
+                    continue;
+                }
 
-    pEngine->onGetNextHighlight = proc;
-    pEngine->pHighlightUserData = pUserData;
+                pVisited[item.pc] = visitStamp;
 
-    drte_engine__refresh(pEngine);
-}
+                const drte_regex_inst* pInst = &pProgram->pInsts[item.pc];
+                switch (pInst->op)
+                {
+                    case DRTE_REGEX_OP_SPLIT:
+                    {
+                        pStack[stackCount].pc = pInst->y; pStack[stackCount++].slot = DRTE_REGEX_NONE;
+                        pStack[stackCount].pc = pInst->x; pStack[stackCount++].slot = DRTE_REGEX_NONE;
+                    } break;
 
+                    case DRTE_REGEX_OP_JMP:
+                    {
+                        pStack[stackCount].pc = pInst->x; pStack[stackCount++].slot = DRTE_REGEX_NONE;
+                    } break;
 
-void drte_engine_set_line_height(drte_engine* pEngine, float lineHeight)
-{
-    if (pEngine == NULL) {
-        return;
-    }
+                    case DRTE_REGEX_OP_SAVE:
+                    {
+                        pStack[stackCount].slot = pInst->x; pStack[stackCount++].value = pWorkingSlots[pInst->x];
+                        pStack[stackCount].pc = item.pc+1;  pStack[stackCount++].slot = DRTE_REGEX_NONE;
+                        pWorkingSlots[pInst->x] = iChar;
+                    } break;
 
-    // Don't do anything if nothing is changing.
-    if (lineHeight == 0 && (pEngine->flags & DRTE_USE_EXPLICIT_LINE_HEIGHT) == 0) {
-        return;
-    }
+                    case DRTE_REGEX_OP_ASSERT:
+                    {
+                        if (drte_regex__check_assertion(pInst->arg, isPrevNewLine, isPrevWord, isNextNewLine, isNextWord)) {
+                            pStack[stackCount].pc = item.pc+1; pStack[stackCount++].slot = DRTE_REGEX_NONE;
+                        }
+                    } break;
 
-    pEngine->flags |= DRTE_USE_EXPLICIT_LINE_HEIGHT;
-    pEngine->lineHeight = lineHeight;
+                    default:
+                    {
+                        pNextThreads[nextThreadCount] = item.pc;
+                        memcpy(pNextSlots + nextThreadCount*slotCount, pWorkingSlots, slotCount * sizeof(size_t));
+                        nextThreadCount += 1;
+                    } break;
+                }
+            }
+        }
 
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        drte_view_dirty(pView, drte_view_get_local_rect(pView));
-    }
-}
+        // Swap the lists. The threads are now waiting on the character at iChar.
+        drte_uint32* pTempThreads = pCurrThreads; pCurrThreads = pNextThreads; pNextThreads = pTempThreads;
+        size_t* pTempSlots = pCurrSlots; pCurrSlots = pNextSlots; pNextSlots = pTempSlots;
+        currThreadCount = nextThreadCount;
+
+        // Threads that consume the next character are kept. A match cuts off every thread after it.
+        nextThreadCount = 0;
+        for (drte_uint32 iThread = 0; iThread < currThreadCount; ++iThread) {
+            const drte_regex_inst* pInst = &pProgram->pInsts[pCurrThreads[iThread]];
+            if (pInst->op == DRTE_REGEX_OP_MATCH) {
+                isMatch = DRTE_TRUE;
+                memcpy(pGroupsOut, pCurrSlots + iThread*slotCount, slotCount * sizeof(size_t));
+                break;
+            }
 
-float drte_engine_get_line_height(drte_engine* pEngine)
-{
-    if (pEngine == NULL) {
-        return 0;
+            if (iChar == textLength) {
+                continue;
+            }
+
+            drte_uint8 c = (drte_uint8)text[iChar];
+            drte_bool32 isConsumed =
+                (pInst->op == DRTE_REGEX_OP_BYTE  && c == pInst->arg) ||
+                (pInst->op == DRTE_REGEX_OP_CLASS && drte_regex__class_contains(pRegex, pInst->x, c)) ||
+                (pInst->op == DRTE_REGEX_OP_ANY   && c != '\n');
+            if (isConsumed) {
+                pCurrThreads[nextThreadCount] = pCurrThreads[iThread];
+                memmove(pCurrSlots + nextThreadCount*slotCount, pCurrSlots + iThread*slotCount, slotCount * sizeof(size_t));
+                nextThreadCount += 1;
+            }
+        }
+
+        currThreadCount = nextThreadCount;
+        if (iChar == textLength || currThreadCount == 0) {
+            break;
+        }
     }
 
-    return pEngine->lineHeight;
+    free(pSlots);
+    free(pThreads);
+    free(pVisited);
+    free(pStack);
+    return isMatch;
 }
 
 
 
-uint32_t drte_engine_get_utf32(drte_engine* pEngine, size_t characterIndex)
+//// Stack Buffer ////
+//
+// A stack buffer is a simple FILO buffer where blocks memory of arbitrary sizes are pushed to the end and, likewise, freed from the end.
+//
+// Do not persistently store pointers returned by drte_stack_buffer_alloc(). Instead store offsets by interrogating the stackPtr property.
+//
+// Data can be popped from the internal buffer with drte_stack_buffer_free() or drte_stack_buffer_set_stack_ptr(). Note that these will
+// ensure the stack pointer is aligned based on DRTE_STACK_BUFFER_ALIGNMENT, so you will want to call drte_stack_buffer_get_stack_ptr()
+// after the fact if you need to access the stack pointer again later.
+drte_bool32 drte_stack_buffer_init(drte_stack_buffer* pStack)
 {
-    if (pEngine == NULL) {
-        return 0;
+    if (pStack == NULL) {
+        return DRTE_FALSE;
     }
 
-    // TODO: Handle UTF-8 properly.
-    return pEngine->text[characterIndex];
+    memset(pStack, 0, sizeof(*pStack));
+    return DRTE_TRUE;
 }
 
-
-void drte_engine_set_text(drte_engine* pEngine, const char* text)
+void drte_stack_buffer_uninit(drte_stack_buffer* pStack)
 {
-    if (pEngine == NULL) {
+    if (pStack == NULL) {
         return;
     }
 
-    // Remove existing text first.
-    if (pEngine->textLength > 0) {
-        drte_engine_delete_text(pEngine, 0, pEngine->textLength);
-    }
-
-    // Insert new text.
-    drte_engine_insert_text(pEngine, text, 0);
+    free(pStack->pBuffer);
 }
 
-size_t drte_engine_get_text(drte_engine* pEngine, char* textOut, size_t textOutSize)
+size_t drte_stack_buffer_get_stack_ptr(drte_stack_buffer* pStack)
 {
-    if (pEngine == NULL) {
+    if (pStack == NULL) {
         return 0;
     }
 
-    return drte_engine_get_subtext(pEngine, 0, pEngine->textLength, textOut, textOutSize);
+    return pStack->stackPtr;
 }
 
-size_t drte_engine_get_subtext(drte_engine* pEngine, size_t characterBeg, size_t characterEnd, char* textOut, size_t textOutSize)
+size_t drte_stack_buffer_set_stack_ptr(drte_stack_buffer* pStack, size_t newStackPtr)
 {
-    if (pEngine == NULL) {
+    if (pStack == NULL) {
         return 0;
     }
 
-    // Safety.
-    if (textOut != NULL && textOutSize > 0) {
-        textOut[0] = '\0';
-    }
+    assert(newStackPtr <= pStack->stackPtr);   // <-- If you trigger this it means you're trying to move the stack pointer beyond the valid area. You cannot use this function to grow the buffer.
 
-    if (characterEnd > pEngine->textLength) {
-        return 0;   // Trying to read past the end of the engine's text.
-    }
+    pStack->stackPtr = drte_round_up(newStackPtr, DRTE_STACK_BUFFER_ALIGNMENT);
 
-    size_t subtextLen = (characterEnd - characterBeg);
-    if (textOut == NULL) {
-        return subtextLen;
+    // Shrink the buffer if we're getting a bit too wasteful.
+    size_t desiredBufferSize = drte_round_up(pStack->stackPtr, DRTE_STACK_BUFFER_BLOCK_SIZE);
+    if (desiredBufferSize == 0) {
+        desiredBufferSize = DRTE_STACK_BUFFER_BLOCK_SIZE;
     }
 
-    if (subtextLen == 0) {
-        return 0;
+    if (desiredBufferSize < pStack->bufferSize) {
+        void* pNewBuffer = realloc(pStack->pBuffer, desiredBufferSize);
+        if (pNewBuffer != NULL) {
+            pStack->pBuffer = pNewBuffer;
+            pStack->bufferSize = desiredBufferSize;
+        }
     }
 
-    if (pEngine->text == NULL) {
-        return 0;   // There is no text...
-    }
+    return pStack->stackPtr;
+}
 
-    if (drte__strncpy_s(textOut, textOutSize, pEngine->text + characterBeg, subtextLen) == 0) {
-        return subtextLen;
+void* drte_stack_buffer_alloc(drte_stack_buffer* pStack, size_t sizeInBytes)
+{
+    if (pStack == NULL || sizeInBytes == 0) {
+        return NULL;
     }
 
-    return 0;   // Error with strncpy_s().
-}
+    // The allocated size is always aligned.
+    sizeInBytes = drte_round_up(sizeInBytes, DRTE_STACK_BUFFER_ALIGNMENT);
 
+    size_t newStackPtr = pStack->stackPtr + sizeInBytes;
+    if (newStackPtr > pStack->bufferSize) {
+        size_t newBufferSize = (pStack->bufferSize == 0) ? DRTE_STACK_BUFFER_BLOCK_SIZE : drte_round_up(newStackPtr, DRTE_STACK_BUFFER_BLOCK_SIZE);
+        void* pNewBuffer = realloc(pStack->pBuffer, newBufferSize);
+        if (pNewBuffer == NULL) {
+            return NULL;
+        }
 
-void drte_engine_set_on_dirty(drte_engine* pEngine, drte_engine_on_dirty_proc proc)
-{
-    if (pEngine == NULL) {
-        return;
+        pStack->bufferSize = newBufferSize;
+        pStack->pBuffer = pNewBuffer;
     }
 
-    pEngine->onDirty = proc;
+    void* pResult = (void*)((uint8_t*)pStack->pBuffer + pStack->stackPtr);
+
+    pStack->stackPtr = newStackPtr;
+    return pResult;
 }
 
-void drte_engine_set_on_text_changed(drte_engine* pEngine, drte_engine_on_text_changed_proc proc)
+void drte_stack_buffer_free(drte_stack_buffer* pStack, size_t sizeInBytes)
 {
-    if (pEngine == NULL) {
+    if (pStack == NULL || sizeInBytes == 0) {
         return;
     }
 
-    pEngine->onTextChanged = proc;
+    assert(sizeInBytes <= pStack->stackPtr);     // <-- If you trigger this is means you're trying to free too much.
+    drte_stack_buffer_set_stack_ptr(pStack, pStack->stackPtr - sizeInBytes);
 }
 
-void drte_engine_set_on_undo_point_changed(drte_engine* pEngine, drte_engine_on_undo_point_changed_proc proc)
+void* drte_stack_buffer_get_data_ptr(drte_stack_buffer* pStack, size_t offset)
 {
-    if (pEngine == NULL) {
-        return;
+    if (pStack == NULL || pStack->stackPtr < offset) {
+        return NULL;
     }
 
-    pEngine->onUndoPointChanged = proc;
+    return (void*)((uint8_t*)pStack->pBuffer + offset);
 }
 
-void drte_engine_set_on_cursor_move(drte_engine* pEngine, drte_engine_on_cursor_move_proc proc)
+// Removes the given number of bytes from the front of the buffer and moves the remaining data down to take it's place. This is
+// the one exception to the FILO rule and is used for discarding the oldest undo points. The size must be a multiple of
+// DRTE_STACK_BUFFER_ALIGNMENT.
+void drte_stack_buffer_remove_front(drte_stack_buffer* pStack, size_t sizeInBytes)
 {
-    if (pEngine == NULL) {
+    if (pStack == NULL || sizeInBytes == 0) {
         return;
     }
 
-    pEngine->onCursorMove = proc;
+    assert(sizeInBytes <= pStack->stackPtr);
+    assert(sizeInBytes % DRTE_STACK_BUFFER_ALIGNMENT == 0);
+
+    memmove(pStack->pBuffer, (uint8_t*)pStack->pBuffer + sizeInBytes, pStack->stackPtr - sizeInBytes);
+    pStack->stackPtr -= sizeInBytes;
+
+    // This will shrink the buffer if it's now too big.
+    drte_stack_buffer_set_stack_ptr(pStack, pStack->stackPtr);
 }
 
 
 
-void drte_engine_set_cursor_blink_rate(drte_engine* pEngine, unsigned int blinkRateInMilliseconds)
-{
-    if (pEngine == NULL) {
-        return;
-    }
+//// LZ Compression ////
+//
+// A small LZ77 block compressor using the LZ4 block format. It's used for compressing large runs of text in the undo buffer where
+// speed matters more than the compression ratio - it's a single greedy pass with a hash table of recent 4 byte sequences.
+//
+// Each sequence is a token whose high nibble is the literal length and low nibble is the match length minus 4. A nibble value of
+// 15 means the length continues in the following bytes which are added together until one is less than 255. The literals come
+// next, followed by the match offset as a 16-bit little-endian value. The last sequence is made up of literals only.
+#define DRTE_LZ_MIN_MATCH       4
+#define DRTE_LZ_HASH_BITS       12
+#define DRTE_LZ_MAX_OFFSET      65535
+#define DRTE_LZ_LAST_LITERALS   5       // The last 5 bytes are always literals.
+#define DRTE_LZ_MATCH_LIMIT     12      // A match cannot start within the last 12 bytes.
 
-    pEngine->cursorBlinkRate = blinkRateInMilliseconds;
+// Retrieves the largest size data of the given size can take up after compression.
+DRTE_INLINE size_t drte_lz_compress_bound(size_t srcSize)
+{
+    return srcSize + (srcSize / 255) + 16;
 }
 
-unsigned int drte_engine_get_cursor_blink_rate(drte_engine* pEngine)
+DRTE_INLINE uint32_t drte_lz__read32(const uint8_t* p)
 {
-    if (pEngine == NULL) {
-        return 0;
-    }
-
-    return pEngine->cursorBlinkRate;
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
 }
 
-void drte_engine_reset_cursor_blinks(drte_engine* pEngine)
+DRTE_INLINE uint32_t drte_lz__hash(uint32_t sequence)
 {
-    if (pEngine == NULL) return;
-    pEngine->timeToNextCursorBlink = pEngine->cursorBlinkRate;
-    pEngine->isCursorBlinkOn = DRTE_TRUE;
+    return (sequence * 2654435761U) >> (32 - DRTE_LZ_HASH_BITS);
 }
 
-
-
-drte_bool32 drte_engine_insert_character(drte_engine* pEngine, size_t insertIndex, uint32_t utf32)
+DRTE_INLINE uint8_t* drte_lz__write_length(uint8_t* pDst, size_t length)
 {
-    // TODO: Do a proper UTF-32 -> UTF-8 conversion.
-    char utf8[16];
-    utf8[0] = (char)utf32;
-    utf8[1] = '\0';
+    // The first 15 has already been stored in the token.
+    length -= 15;
+    while (length >= 255) {
+        *pDst++ = 255;
+        length -= 255;
+    }
 
-    return drte_engine_insert_text(pEngine, utf8, insertIndex);
+    *pDst++ = (uint8_t)length;
+    return pDst;
 }
 
-drte_bool32 drte_engine_delete_character(drte_engine* pEngine, size_t iChar)
+// Writes a single sequence. Set matchLength to 0 for the last sequence. Returns NULL if there isn't enough room.
+uint8_t* drte_lz__write_sequence(uint8_t* pDst, uint8_t* pDstEnd, const uint8_t* pLiterals, size_t literalLength, size_t matchOffset, size_t matchLength)
 {
-    return drte_engine_delete_text(pEngine, iChar, iChar+1);
-}
+    size_t maxSize = 1 + (literalLength/255 + 1) + literalLength + 2 + (matchLength/255 + 1);
+    if ((size_t)(pDstEnd - pDst) < maxSize) {
+        return NULL;
+    }
 
-drte_bool32 drte_engine_insert_text(drte_engine* pEngine, const char* text, size_t insertIndex)
-{
-    if (pEngine == NULL || text == NULL) {
-        return DRTE_FALSE;
+    uint8_t* pToken = pDst++;
+    *pToken = (uint8_t)(((literalLength < 15) ? literalLength : 15) << 4);
+    if (literalLength >= 15) {
+        pDst = drte_lz__write_length(pDst, literalLength);
     }
 
-    if (insertIndex > pEngine->textLength) {
-        return DRTE_FALSE;
+    memcpy(pDst, pLiterals, literalLength);
+    pDst += literalLength;
+
+    if (matchLength > 0) {
+        *pDst++ = (uint8_t)(matchOffset & 0xFF);
+        *pDst++ = (uint8_t)(matchOffset >> 8);
+
+        size_t matchLengthMinus4 = matchLength - DRTE_LZ_MIN_MATCH;
+        *pToken |= (uint8_t)((matchLengthMinus4 < 15) ? matchLengthMinus4 : 15);
+        if (matchLengthMinus4 >= 15) {
+            pDst = drte_lz__write_length(pDst, matchLengthMinus4);
+        }
     }
 
-    size_t newTextLength = strlen(text);
-    if (newTextLength == 0) {
-        return DRTE_FALSE;
+    return pDst;
+}
+
+// Compresses a block of data. Returns the compressed size, or 0 if it did not fit in the output buffer. The output buffer will
+// never need to be larger than drte_lz_compress_bound(srcSize).
+size_t drte_lz_compress(const void* pSrc, size_t srcSize, void* pDst, size_t dstCapacity)
+{
+    if (pSrc == NULL || pDst == NULL) {
+        return 0;
     }
 
-    // We need to get the index of the line that's being inserted so we can know how to update the internal line cache.
-    size_t iLine = drte_line_cache_find_line_by_character(pEngine->pUnwrappedLines, insertIndex);
+    const uint8_t* src = (const uint8_t*)pSrc;
+    uint8_t* pOut = (uint8_t*)pDst;
+    uint8_t* pOutEnd = pOut + dstCapacity;
 
+    // Positions are stored plus 1 so that 0 can mean an empty slot.
+    size_t hashTable[1 << DRTE_LZ_HASH_BITS];
+    memset(hashTable, 0, sizeof(hashTable));
 
-    // TODO: Add proper support for UTF-8.
-    char* pOldText = pEngine->text;
-    char* pNewText = (char*)malloc(pEngine->textLength + newTextLength + 1);   // +1 for the new character and +1 for the null terminator.
+    size_t iAnchor = 0;
+    if (srcSize > DRTE_LZ_MATCH_LIMIT) {
+        size_t iMatchLimit = srcSize - DRTE_LZ_MATCH_LIMIT;
+        size_t iMatchEndLimit = srcSize - DRTE_LZ_LAST_LITERALS;
 
-    if (insertIndex > 0) {
-        memcpy(pNewText, pOldText, insertIndex);
-    }
+        size_t i = 0;
+        while (i < iMatchLimit) {
+            uint32_t sequence = drte_lz__read32(src + i);
+            uint32_t hash = drte_lz__hash(sequence);
+            size_t iCandidatePlus1 = hashTable[hash];
+            hashTable[hash] = i + 1;
+
+            if (iCandidatePlus1 == 0 || (i - (iCandidatePlus1-1)) > DRTE_LZ_MAX_OFFSET || drte_lz__read32(src + iCandidatePlus1-1) != sequence) {
+                i += 1;
+                continue;
+            }
+
+            size_t iCandidate = iCandidatePlus1 - 1;
+            size_t matchLength = DRTE_LZ_MIN_MATCH;
+            while (i + matchLength < iMatchEndLimit && src[i + matchLength] == src[iCandidate + matchLength]) {
+                matchLength += 1;
+            }
+
+            pOut = drte_lz__write_sequence(pOut, pOutEnd, src + iAnchor, i - iAnchor, i - iCandidate, matchLength);
+            if (pOut == NULL) {
+                return 0;
+            }
 
+            i += matchLength;
+            iAnchor = i;
+        }
+    }
 
-    size_t linesAddedCount = 0;
+    pOut = drte_lz__write_sequence(pOut, pOutEnd, src + iAnchor, srcSize - iAnchor, 0, 0);
+    if (pOut == NULL) {
+        return 0;
+    }
 
-    char* dst = pNewText + insertIndex;
-    const char* src = text;
-    while (*src != '\0') {
-        if (src[0] == '\n') {
-            linesAddedCount += 1;
-        } else if (src[0] == '\r' && src[1] == '\n') {
-            linesAddedCount += 1;
+    return (size_t)(pOut - (uint8_t*)pDst);
+}
 
-            *dst++ = *src;
-            src += 1;
+DRTE_INLINE drte_bool32 drte_lz__read_length(const uint8_t** ppSrc, const uint8_t* pSrcEnd, size_t* pLength)
+{
+    for (;;) {
+        if (*ppSrc == pSrcEnd) {
+            return DRTE_FALSE;
         }
 
-        *dst++ = *src;
-        src += 1;
+        uint8_t b = *(*ppSrc)++;
+        *pLength += b;
+        if (b < 255) {
+            return DRTE_TRUE;
+        }
     }
+}
 
-    if (insertIndex < pEngine->textLength) {
-        memcpy(pNewText + insertIndex + newTextLength, pOldText + insertIndex, pEngine->textLength - insertIndex);
+// Decompresses a block of data which was compressed with drte_lz_compress(). This fails unless exactly dstSize bytes are produced.
+drte_bool32 drte_lz_decompress(const void* pSrc, size_t srcSize, void* pDst, size_t dstSize)
+{
+    if (pSrc == NULL || pDst == NULL) {
+        return DRTE_FALSE;
     }
 
-    pEngine->textLength += newTextLength;
-    pEngine->text = pNewText;
-    pNewText[pEngine->textLength] = '\0';
+    const uint8_t* pIn = (const uint8_t*)pSrc;
+    const uint8_t* pInEnd = pIn + srcSize;
+    uint8_t* pOut = (uint8_t*)pDst;
+    uint8_t* pOutEnd = pOut + dstSize;
 
-    free(pOldText);
+    while (pIn < pInEnd) {
+        uint8_t token = *pIn++;
 
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !drte_lz__read_length(&pIn, pInEnd, &literalLength)) {
+            return DRTE_FALSE;
+        }
 
-    // Adjust lines.
-    if (linesAddedCount > 0) {
-        if (!drte_line_cache_insert_lines(pEngine->pUnwrappedLines, iLine+1, linesAddedCount, newTextLength)) {
+        if (literalLength > (size_t)(pInEnd - pIn) || literalLength > (size_t)(pOutEnd - pOut)) {
             return DRTE_FALSE;
         }
 
-        for (size_t i = iLine+1; i <= iLine + linesAddedCount; ++i) {
-            size_t iRunningChar = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, i-1);
-            while (pEngine->text[iRunningChar] != '\0') {
-                if (pEngine->text[iRunningChar] == '\n') {
-                    iRunningChar += 1;
-                    break;
-                } else if (pEngine->text[iRunningChar] == '\r' && pEngine->text[iRunningChar+1] == '\n') {
-                    iRunningChar += 2;
-                    break;
-                }
+        memcpy(pOut, pIn, literalLength);
+        pIn  += literalLength;
+        pOut += literalLength;
 
-                iRunningChar += 1;
-            }
+        // The last sequence does not have a match.
+        if (pIn == pInEnd) {
+            break;
+        }
 
-            drte_line_cache_set_line_first_character(pEngine->pUnwrappedLines, i, iRunningChar);
+        if (pInEnd - pIn < 2) {
+            return DRTE_FALSE;
         }
-    } else {
-        // No new lines were added, but we still need to update the character positions of the line cache.
-        drte_line_cache_offset_lines(pEngine->pUnwrappedLines, iLine+1, newTextLength);
-    }
 
+        size_t matchOffset = (size_t)pIn[0] | ((size_t)pIn[1] << 8);
+        pIn += 2;
 
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !drte_lz__read_length(&pIn, pInEnd, &matchLength)) {
+            return DRTE_FALSE;
+        }
+        matchLength += DRTE_LZ_MIN_MATCH;
 
-    // Add the change to the prepared state.
-    if (pEngine->hasPreparedUndoState) {
-        drte_engine__push_text_change_to_prepared_undo_state(pEngine, drte_undo_change_type_insert, insertIndex, insertIndex + newTextLength, text);
+        if (matchOffset == 0 || matchOffset > (size_t)(pOut - (uint8_t*)pDst) || matchLength > (size_t)(pOutEnd - pOut)) {
+            return DRTE_FALSE;
+        }
+
+        // The match can overlap with the output so it needs to be copied one byte at a time.
+        const uint8_t* pMatch = pOut - matchOffset;
+        for (size_t i = 0; i < matchLength; ++i) {
+            pOut[i] = pMatch[i];
+        }
+        pOut += matchLength;
     }
 
+    return pOut == pOutEnd;
+}
 
-    // Cursors and selections after this cursor need to be updated.
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-            if (pView->pCursors[iCursor].iCharAbs >= insertIndex) {
-                drte_view_move_cursor_to_character(pView, iCursor, pView->pCursors[iCursor].iCharAbs + newTextLength);
-            }
-        }
 
-        // As with cursors, selections need to be updated too.
-        for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
-            drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
-            if (selection.iCharBeg >= insertIndex) {
-                pView->pSelections[iSelection].iCharBeg += newTextLength;
-                pView->pSelections[iSelection].iCharEnd += newTextLength;
-            } else {
-                if (selection.iCharEnd >= insertIndex) {
-                    if (pView->pSelections[iSelection].iCharEnd > pView->pSelections[iSelection].iCharBeg) {
-                        pView->pSelections[iSelection].iCharEnd += newTextLength;
-                    } else {
-                        pView->pSelections[iSelection].iCharBeg += newTextLength;
-                    }
-                }
-            }
+
+//// Piece Table ////
+//
+// A piece table stores the text as an ordered list of pieces, each of which references a run of characters in either the original
+// buffer or the add buffer. The original buffer is never modified and the add buffer is only ever appended to which means an edit
+// never needs to move the existing text around - it only needs to update the pieces that surround it.
+//
+// The pieces are stored in a B-tree in the same way as the line cache. Leaves store the pieces and are linked to their neighbours
+// so the text can be walked in order. Branches store the number of characters contained within each of their children. Pieces do
+// not store their own position which means inserting or removing a piece only needs to update the nodes along a single path rather
+// than every piece that comes after the edit. Most access is sequential (painting, measuring, searching) so the piece that was found
+// most recently is remembered and checked first.
+//
+// Do not persistently store pointers returned by drte_piece_table_get_text_range(). They are invalidated by the next edit, and
+// in the case of a range that spans multiple pieces, by the next call to drte_piece_table_get_text_range().
+struct drte_piece_table_node
+{
+    drte_uint32 isLeaf;
+    drte_uint32 count;      // The number of pieces for leaves, or the number of children for branches.
+    union
+    {
+        struct
+        {
+            drte_piece pieces[DRTE_PIECE_TABLE_LEAF_CAPACITY];
+            drte_piece_table_node* pPrev;
+            drte_piece_table_node* pNext;
+        } leaf;
+        struct
+        {
+            drte_piece_table_node* pChildren[DRTE_PIECE_TABLE_BRANCH_CAPACITY];
+            size_t lengths[DRTE_PIECE_TABLE_BRANCH_CAPACITY];
+        } branch;
+    } data;
+};
+
+drte_piece_table_node* drte_piece_table__alloc_node(drte_piece_table* pTable, drte_bool32 isLeaf)
+{
+    assert(pTable != NULL);
+
+    // Spare nodes are reserved before any operation that may need to split a node so that we never run out of memory half way
+    // through an edit.
+    drte_piece_table_node* pNode = pTable->pSpareNodes;
+    if (pNode != NULL) {
+        pTable->pSpareNodes = pNode->data.branch.pChildren[0];
+        pTable->spareNodeCount -= 1;
+    } else {
+        pNode = (drte_piece_table_node*)malloc(sizeof(*pNode));
+        if (pNode == NULL) {
+            return NULL;
         }
     }
 
+    pNode->isLeaf = isLeaf;
+    pNode->count = 0;
+    if (isLeaf) {
+        pNode->data.leaf.pPrev = NULL;
+        pNode->data.leaf.pNext = NULL;
+    }
 
-    // Refresh the lines if line wrap is enabled.
-    // TODO: Optimize this.
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        if (drte_view_is_word_wrap_enabled(pView)) {
-            drte_view__refresh_word_wrapping(pView);    // <-- This will repaint.
-        } else {
-            drte_view_dirty(pView, drte_view_get_local_rect(pView));
+    return pNode;
+}
+
+void drte_piece_table__free_node(drte_piece_table_node* pNode)
+{
+    if (pNode == NULL) {
+        return;
+    }
+
+    if (!pNode->isLeaf) {
+        for (drte_uint32 iChild = 0; iChild < pNode->count; ++iChild) {
+            drte_piece_table__free_node(pNode->data.branch.pChildren[iChild]);
         }
     }
 
+    free(pNode);
+}
 
-    if (pEngine->onTextChanged) {
-        pEngine->onTextChanged(pEngine);
+drte_bool32 drte_piece_table__reserve_nodes(drte_piece_table* pTable, size_t count)
+{
+    assert(pTable != NULL);
+
+    while (pTable->spareNodeCount < count) {
+        drte_piece_table_node* pNode = (drte_piece_table_node*)malloc(sizeof(*pNode));
+        if (pNode == NULL) {
+            return DRTE_FALSE;
+        }
+
+        pNode->data.branch.pChildren[0] = pTable->pSpareNodes;
+        pTable->pSpareNodes = pNode;
+        pTable->spareNodeCount += 1;
     }
 
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_engine_delete_text(drte_engine* pEngine, size_t iFirstCh, size_t iLastChPlus1)
+// Retrieves the number of characters contained within the given node.
+size_t drte_piece_table__get_node_length(drte_piece_table_node* pNode)
 {
-    if (pEngine == NULL || iLastChPlus1 == iFirstCh) {
+    assert(pNode != NULL);
+
+    size_t length = 0;
+    if (pNode->isLeaf) {
+        for (drte_uint32 i = 0; i < pNode->count; ++i) {
+            length += pNode->data.leaf.pieces[i].length;
+        }
+    } else {
+        for (drte_uint32 i = 0; i < pNode->count; ++i) {
+            length += pNode->data.branch.lengths[i];
+        }
+    }
+
+    return length;
+}
+
+drte_bool32 drte_piece_table_init(drte_piece_table* pTable)
+{
+    if (pTable == NULL) {
         return DRTE_FALSE;
     }
 
-    if (iFirstCh > pEngine->textLength) {
-        iFirstCh = pEngine->textLength;
+    memset(pTable, 0, sizeof(*pTable));
+    return DRTE_TRUE;
+}
+
+void drte_piece_table_uninit(drte_piece_table* pTable)
+{
+    if (pTable == NULL) {
+        return;
     }
 
-    if (iLastChPlus1 > pEngine->textLength) {
-        iLastChPlus1 = pEngine->textLength;
+    if (!pTable->isOriginalBorrowed) {
+        free((void*)pTable->pOriginal);
     }
+    free(pTable->pAdd);
+    free(pTable->pScratch);
 
+    drte_piece_table__free_node(pTable->pRoot);
 
-    if (iFirstCh > iLastChPlus1) {
-        size_t temp = iFirstCh;
-        iFirstCh = iLastChPlus1;
-        iLastChPlus1 = temp;
+    while (pTable->pSpareNodes != NULL) {
+        drte_piece_table_node* pNext = pTable->pSpareNodes->data.branch.pChildren[0];
+        free(pTable->pSpareNodes);
+        pTable->pSpareNodes = pNext;
     }
 
+    memset(pTable, 0, sizeof(*pTable));
+}
 
-    // We need to get the index of the line that's being inserted so we can know how to update the internal line cache.
-    size_t iLine = drte_line_cache_find_line_by_character(pEngine->pUnwrappedLines, iFirstCh);
+DRTE_INLINE const char* drte_piece_table__get_piece_text(drte_piece_table* pTable, const drte_piece* pPiece)
+{
+    assert(pTable != NULL);
+    assert(pPiece != NULL);
 
-    size_t linesRemovedCount = 0;
-    for (size_t iChar = iFirstCh; iChar < iLastChPlus1; ++iChar) {
-        if (pEngine->text[iChar] == '\n') {
-            linesRemovedCount += 1;
-        } else if (pEngine->text[iChar] == '\r' && pEngine->text[iChar+1] == '\n') {
-            linesRemovedCount += 1;
-            iChar += 1;
+    if (pPiece->buffer == DRTE_PIECE_BUFFER_ORIGINAL) {
+        return pTable->pOriginal + pPiece->offset;
+    } else {
+        return pTable->pAdd + pPiece->offset;
+    }
+}
+
+// Moves the cursor to the next piece. Returns DRTE_FALSE, leaving the cursor where it is, if it's already on the last piece.
+drte_bool32 drte_piece_table__next_piece(drte_piece_cursor* pCursor)
+{
+    assert(pCursor != NULL);
+    assert(pCursor->pLeaf != NULL);
+
+    drte_piece_table_node* pLeaf = pCursor->pLeaf;
+    drte_uint32 iPiece = pCursor->iPiece + 1;
+    if (iPiece == pLeaf->count) {
+        pLeaf = pLeaf->data.leaf.pNext;
+        if (pLeaf == NULL) {
+            return DRTE_FALSE;
         }
+
+        iPiece = 0;
     }
 
+    pCursor->iCharBeg += pCursor->pPiece->length;
+    pCursor->pLeaf  = pLeaf;
+    pCursor->iPiece = iPiece;
+    pCursor->pPiece = &pLeaf->data.leaf.pieces[iPiece];
 
-    size_t bytesToRemove = iLastChPlus1 - iFirstCh;
-    if (bytesToRemove > 0)
-    {
-        // Update cursors and selections _before_ deleting the text.
-        size_t iCharBeg = iFirstCh;
-        size_t iCharEnd = iLastChPlus1;
-        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-            for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-                size_t iCursorChar = pView->pCursors[iCursor].iCharAbs;
-                if (iCursorChar > iCharBeg && iCursorChar <= iCharEnd) {
-                    drte_view_move_cursor_to_character(pView, iCursor, iCharBeg);
-                } else {
-                    if (iCursorChar >= iCharEnd) {
-                        drte_view_move_cursor_to_character(pView, iCursor, iCursorChar - (iCharEnd - iCharBeg));
-                    }
-                }
-            }
+    return DRTE_TRUE;
+}
 
-            // <---> = selection
-            // |---| = selectionToDelete
-            for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
-                drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
-                if (selection.iCharBeg < iCharBeg) {
-                    if (selection.iCharEnd > iCharBeg) {
-                        if (selection.iCharEnd < iCharEnd) {
-                            // <---|--->---|
-                            selection.iCharEnd = iCharBeg;
-                        } else {
-                            // <---|---|--->
-                            selection.iCharEnd -= iCharEnd - iCharBeg;
-                        }
-                    }
-                } else {
-                    if (selection.iCharBeg < iCharEnd) {
-                        if (selection.iCharEnd < iCharEnd) {
-                            // |---<--->---|
-                            selection.iCharBeg = selection.iCharEnd = iCharBeg;
-                        } else {
-                            // |---<---|--->
-                            selection.iCharEnd -= (iCharEnd - selection.iCharBeg);
-                            selection.iCharBeg  = iCharBeg;
-                        }
-                    } else {
-                        selection.iCharBeg -= (iCharEnd - iCharBeg);
-                        selection.iCharEnd -= (iCharEnd - iCharBeg);
-                    }
-                }
+// Moves the cursor to the previous piece. Returns DRTE_FALSE, leaving the cursor where it is, if it's already on the first piece.
+drte_bool32 drte_piece_table__prev_piece(drte_piece_cursor* pCursor)
+{
+    assert(pCursor != NULL);
+    assert(pCursor->pLeaf != NULL);
 
-                if (pView->pSelections[iSelection].iCharBeg < pView->pSelections[iSelection].iCharEnd) {
-                    pView->pSelections[iSelection].iCharBeg = selection.iCharBeg;
-                    pView->pSelections[iSelection].iCharEnd = selection.iCharEnd;
-                } else {
-                    pView->pSelections[iSelection].iCharBeg = selection.iCharEnd;
-                    pView->pSelections[iSelection].iCharEnd = selection.iCharBeg;
-                }
-            }
+    drte_piece_table_node* pLeaf = pCursor->pLeaf;
+    drte_uint32 iPiece = pCursor->iPiece;
+    if (iPiece == 0) {
+        pLeaf = pLeaf->data.leaf.pPrev;
+        if (pLeaf == NULL) {
+            return DRTE_FALSE;
         }
 
+        iPiece = pLeaf->count;
+    }
+
+    iPiece -= 1;
 
+    pCursor->pLeaf  = pLeaf;
+    pCursor->iPiece = iPiece;
+    pCursor->pPiece = &pLeaf->data.leaf.pieces[iPiece];
+    pCursor->iCharBeg -= pCursor->pPiece->length;
 
-        // Add the change to the prepared state.
-        if (pEngine->hasPreparedUndoState) {
-            drte_engine__push_text_change_to_prepared_undo_state(pEngine, drte_undo_change_type_delete, iFirstCh, iLastChPlus1, pEngine->text + iFirstCh);
-        }
+    return DRTE_TRUE;
+}
+
+// Finds the piece containing the given character. Returns DRTE_FALSE if the character is at or past the end of the text.
+drte_bool32 drte_piece_table__find_piece(drte_piece_table* pTable, size_t iChar, drte_piece_cursor* pCursorOut)
+{
+    assert(pTable != NULL);
+    assert(pCursorOut != NULL);
 
+    if (iChar >= pTable->length) {
+        return DRTE_FALSE;
+    }
 
-        memmove(pEngine->text + iFirstCh, pEngine->text + iLastChPlus1, pEngine->textLength - iLastChPlus1);
-        pEngine->textLength -= bytesToRemove;
-        pEngine->text[pEngine->textLength] = '\0';
+    // Sequential access is the common case so check the previous piece and it's neighbours before walking down the tree.
+    drte_piece_cursor cursor = pTable->lastPiece;
+    if (cursor.pLeaf != NULL) {
+        if (iChar >= cursor.iCharBeg) {
+            if (iChar < cursor.iCharBeg + cursor.pPiece->length) {
+                *pCursorOut = cursor;
+                return DRTE_TRUE;
+            }
 
-        if (linesRemovedCount > 0) {
-            if (!drte_line_cache_remove_lines(pEngine->pUnwrappedLines, iLine+1, linesRemovedCount, bytesToRemove)) {
-                return DRTE_FALSE;
+            if (drte_piece_table__next_piece(&cursor) && iChar < cursor.iCharBeg + cursor.pPiece->length) {
+                pTable->lastPiece = cursor;
+                *pCursorOut = cursor;
+                return DRTE_TRUE;
             }
         } else {
-            // No lines were removed, but we still need to update the character positions of the line cache.
-            drte_line_cache_offset_lines_negative(pEngine->pUnwrappedLines, iLine+1, bytesToRemove);
+            if (drte_piece_table__prev_piece(&cursor) && iChar >= cursor.iCharBeg) {
+                pTable->lastPiece = cursor;
+                *pCursorOut = cursor;
+                return DRTE_TRUE;
+            }
         }
+    }
 
+    size_t iLocalChar = iChar;
+    drte_piece_table_node* pNode = pTable->pRoot;
+    while (!pNode->isLeaf) {
+        drte_uint32 iChild = 0;
+        while (iLocalChar >= pNode->data.branch.lengths[iChild]) {
+            iLocalChar -= pNode->data.branch.lengths[iChild];
+            iChild += 1;
+        }
 
-        // Refresh the lines if line wrap is enabled.
-        // TODO: Optimize this.
-        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-            if (drte_view_is_word_wrap_enabled(pView)) {
-                drte_view__refresh_word_wrapping(pView);    // <-- This will repaint.
-            } else {
-                // After line each cursor is sitting on may have changed.
-                for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-                    drte_view_move_cursor_to_character(pView, iCursor, pView->pCursors[iCursor].iCharAbs);
-                }
+        pNode = pNode->data.branch.pChildren[iChild];
+    }
 
-                drte_view_dirty(pView, drte_view_get_local_rect(pView));
+    drte_uint32 iPiece = 0;
+    while (iLocalChar >= pNode->data.leaf.pieces[iPiece].length) {
+        iLocalChar -= pNode->data.leaf.pieces[iPiece].length;
+        iPiece += 1;
+    }
+
+    cursor.pLeaf    = pNode;
+    cursor.iPiece   = iPiece;
+    cursor.iCharBeg = iChar - iLocalChar;
+    cursor.pPiece   = &pNode->data.leaf.pieces[iPiece];
+
+    pTable->lastPiece = cursor;
+    *pCursorOut = cursor;
+    return DRTE_TRUE;
+}
+
+// Inserts a piece into the given node at the given character, relative to the start of the node, splitting the piece the character
+// falls within if it's not already at the start of a piece. When pPiece is NULL the piece is split and nothing is inserted. Returns
+// the new right sibling if the node needed to be split, otherwise NULL.
+drte_piece_table_node* drte_piece_table__node_insert(drte_piece_table* pTable, drte_piece_table_node* pNode, size_t iChar, const drte_piece* pPiece)
+{
+    assert(pTable != NULL);
+    assert(pNode != NULL);
+
+    if (pNode->isLeaf) {
+        drte_uint32 iPiece = 0;
+        while (iPiece < pNode->count && iChar >= pNode->data.leaf.pieces[iPiece].length) {
+            iChar -= pNode->data.leaf.pieces[iPiece].length;
+            iPiece += 1;
+        }
+
+        // At this point iChar is the offset within the piece the new one lands in. When it's zero the new piece goes in front of it.
+        //
+        // When typing, each character is added straight after the previous one in which case the previous piece can simply be
+        // extended rather than creating a new piece for every key press.
+        if (iChar == 0 && iPiece > 0 && pPiece != NULL) {
+            drte_piece* pPrevPiece = &pNode->data.leaf.pieces[iPiece-1];
+            if (pPrevPiece->buffer == pPiece->buffer && pPrevPiece->offset + pPrevPiece->length == pPiece->offset) {
+                pPrevPiece->length += pPiece->length;
+                return NULL;
             }
         }
-        
 
-        if (pEngine->onTextChanged) {
-            pEngine->onTextChanged(pEngine);
+        drte_uint32 insertCount = ((iChar > 0) ? 1 : 0) + ((pPiece != NULL) ? 1 : 0);
+        if (insertCount == 0) {
+            return NULL;
         }
 
-        return DRTE_TRUE;
+        drte_piece_table_node* pSibling = NULL;
+        drte_piece_table_node* pTarget = pNode;
+        if (pNode->count + insertCount > DRTE_PIECE_TABLE_LEAF_CAPACITY) {
+            pSibling = drte_piece_table__alloc_node(pTable, DRTE_TRUE);
+            assert(pSibling != NULL);   // <-- Nodes should have been reserved with drte_piece_table__reserve_nodes().
+
+            drte_uint32 splitIndex = pNode->count/2;
+            pSibling->count = pNode->count - splitIndex;
+            memcpy(pSibling->data.leaf.pieces, pNode->data.leaf.pieces + splitIndex, pSibling->count * sizeof(drte_piece));
+            pNode->count = splitIndex;
+
+            pSibling->data.leaf.pPrev = pNode;
+            pSibling->data.leaf.pNext = pNode->data.leaf.pNext;
+            if (pNode->data.leaf.pNext != NULL) {
+                pNode->data.leaf.pNext->data.leaf.pPrev = pSibling;
+            }
+            pNode->data.leaf.pNext = pSibling;
+
+            if (iPiece >= splitIndex) {
+                pTarget = pSibling;
+                iPiece -= splitIndex;
+            }
+        }
+
+        drte_piece* pPieces = pTarget->data.leaf.pieces;
+        if (iChar > 0) {
+            // The piece is split in two with the new piece, if any, going in between.
+            drte_piece piece = pPieces[iPiece];
+            memmove(pPieces + iPiece + 1 + insertCount, pPieces + iPiece + 1, (pTarget->count - (iPiece + 1)) * sizeof(drte_piece));
+            pPieces[iPiece].length = iChar;
+            pPieces[iPiece + insertCount].offset = piece.offset + iChar;
+            pPieces[iPiece + insertCount].length = piece.length - iChar;
+            pPieces[iPiece + insertCount].buffer = piece.buffer;
+            if (pPiece != NULL) {
+                pPieces[iPiece + 1] = *pPiece;
+            }
+        } else {
+            memmove(pPieces + iPiece + 1, pPieces + iPiece, (pTarget->count - iPiece) * sizeof(drte_piece));
+            pPieces[iPiece] = *pPiece;
+        }
+
+        pTarget->count += insertCount;
+        return pSibling;
     }
 
-    return DRTE_FALSE;
-}
 
+    // Characters at the boundary between two children go to the end of the left child so that typing at the end of a piece can
+    // extend it.
+    drte_uint32 iChild = 0;
+    while (iChild+1 < pNode->count && iChar > pNode->data.branch.lengths[iChild]) {
+        iChar -= pNode->data.branch.lengths[iChild];
+        iChild += 1;
+    }
 
-drte_bool32 drte_engine_get_start_of_word_containing_character(drte_engine* pEngine, size_t iChar, size_t* pWordBegOut)
-{
-    if (pEngine == NULL || pEngine->text == NULL) {
-        return DRTE_FALSE;
+    if (pPiece != NULL) {
+        pNode->data.branch.lengths[iChild] += pPiece->length;
     }
 
-    if (iChar > 0) {
-        iChar -= 1;
+    drte_piece_table_node* pNewChild = drte_piece_table__node_insert(pTable, pNode->data.branch.pChildren[iChild], iChar, pPiece);
+    if (pNewChild == NULL) {
+        return NULL;
+    }
 
-        // Skip whitespace.
-        if (drte_is_whitespace(pEngine->text[iChar])) {
-            while (iChar > 0) {
-                if (!drte_is_whitespace(pEngine->text[iChar])) {
-                    break;
-                }
+    size_t newChildLength = drte_piece_table__get_node_length(pNewChild);
+    pNode->data.branch.lengths[iChild] -= newChildLength;
 
-                iChar -= 1;
-            }
-        }
+    drte_piece_table_node* pSibling = NULL;
+    drte_piece_table_node* pTarget = pNode;
+    drte_uint32 iNewChild = iChild+1;
+    if (pNode->count == DRTE_PIECE_TABLE_BRANCH_CAPACITY) {
+        pSibling = drte_piece_table__alloc_node(pTable, DRTE_FALSE);
+        assert(pSibling != NULL);
 
-        if (!drte_is_symbol_or_whitespace(pEngine->text[iChar])) {
-            while (iChar > 0) {
-                uint32_t c = pEngine->text[iChar-1];
-                if (drte_is_symbol_or_whitespace(c)) {
-                    break;
-                }
+        drte_uint32 splitIndex = DRTE_PIECE_TABLE_BRANCH_CAPACITY/2;
+        pSibling->count = pNode->count - splitIndex;
+        memcpy(pSibling->data.branch.pChildren, pNode->data.branch.pChildren + splitIndex, pSibling->count * sizeof(drte_piece_table_node*));
+        memcpy(pSibling->data.branch.lengths,   pNode->data.branch.lengths   + splitIndex, pSibling->count * sizeof(size_t));
+        pNode->count = splitIndex;
 
-                iChar -= 1;
-            }
+        if (iNewChild > splitIndex) {
+            pTarget = pSibling;
+            iNewChild -= splitIndex;
         }
     }
 
-    if (pWordBegOut) *pWordBegOut = iChar;
-    return DRTE_TRUE;
-}
+    drte_uint32 moveCount = pTarget->count - iNewChild;
+    memmove(pTarget->data.branch.pChildren + iNewChild + 1, pTarget->data.branch.pChildren + iNewChild, moveCount * sizeof(drte_piece_table_node*));
+    memmove(pTarget->data.branch.lengths   + iNewChild + 1, pTarget->data.branch.lengths   + iNewChild, moveCount * sizeof(size_t));
+    pTarget->data.branch.pChildren[iNewChild] = pNewChild;
+    pTarget->data.branch.lengths[iNewChild]   = newChildLength;
+    pTarget->count += 1;
 
+    return pSibling;
+}
 
-drte_bool32 drte_engine_get_start_of_next_word_from_character(drte_engine* pEngine, size_t iChar, size_t* pWordBegOut)
+// Inserts a piece at the given character. When pPiece is NULL this just makes sure a piece begins at the character.
+drte_bool32 drte_piece_table__insert_piece(drte_piece_table* pTable, size_t iChar, const drte_piece* pPiece)
 {
-    if (pEngine == NULL || pEngine->text == NULL) {
+    assert(pTable != NULL);
+    assert(iChar <= pTable->length);
+
+    // Worst case is that every node on the path to the leaf is split, plus a new root.
+    if (!drte_piece_table__reserve_nodes(pTable, pTable->height + 2)) {
         return DRTE_FALSE;
     }
 
-    while (pEngine->text[iChar] != '\0' && pEngine->text[iChar] != '\n' && !(pEngine->text[iChar] == '\r' && pEngine->text[iChar+1])) {
-        uint32_t c = pEngine->text[iChar];
-        if (!drte_is_whitespace(c)) {
-            break;
-        }
+    if (pTable->pRoot == NULL) {
+        pTable->pRoot = drte_piece_table__alloc_node(pTable, DRTE_TRUE);
+        pTable->height = 1;
+    }
 
-        iChar += 1;
+    drte_piece_table_node* pSibling = drte_piece_table__node_insert(pTable, pTable->pRoot, iChar, pPiece);
+    if (pSibling != NULL) {
+        drte_piece_table_node* pNewRoot = drte_piece_table__alloc_node(pTable, DRTE_FALSE);
+        assert(pNewRoot != NULL);
+
+        pNewRoot->count = 2;
+        pNewRoot->data.branch.pChildren[0] = pTable->pRoot;
+        pNewRoot->data.branch.pChildren[1] = pSibling;
+        pNewRoot->data.branch.lengths[0] = drte_piece_table__get_node_length(pTable->pRoot);
+        pNewRoot->data.branch.lengths[1] = drte_piece_table__get_node_length(pSibling);
+
+        pTable->pRoot = pNewRoot;
+        pTable->height += 1;
     }
 
-    if (pWordBegOut) *pWordBegOut = iChar;
+    if (pPiece != NULL) {
+        pTable->length += pPiece->length;
+    }
+
+    pTable->lastPiece.pLeaf = NULL;
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_engine_get_end_of_word_containing_character(drte_engine* pEngine, size_t iChar, size_t* pWordEndOut)
+// Merges the child at the given index with it's right neighbour if they are small enough to fit in a single node.
+void drte_piece_table__try_merge_children(drte_piece_table_node* pNode, drte_uint32 iChild)
 {
-    if (pEngine == NULL || pEngine->text == NULL) {
-        return DRTE_FALSE;
+    assert(pNode != NULL);
+    assert(!pNode->isLeaf);
+
+    if (iChild+1 >= pNode->count) {
+        return;
     }
 
-    if (!drte_is_symbol_or_whitespace(pEngine->text[iChar])) {
-        while (pEngine->text[iChar] != '\0' && pEngine->text[iChar] != '\n' && !(pEngine->text[iChar] == '\r' && pEngine->text[iChar+1])) {
-            uint32_t c = pEngine->text[iChar];
-            if (drte_is_symbol_or_whitespace(c)) {
-                break;
-            }
+    drte_piece_table_node* pLeft  = pNode->data.branch.pChildren[iChild];
+    drte_piece_table_node* pRight = pNode->data.branch.pChildren[iChild+1];
+    drte_uint32 capacity = (pLeft->isLeaf) ? DRTE_PIECE_TABLE_LEAF_CAPACITY : DRTE_PIECE_TABLE_BRANCH_CAPACITY;
+    if (pLeft->count + pRight->count > capacity) {
+        return;
+    }
 
-            iChar += 1;
+    if (pLeft->isLeaf) {
+        memcpy(pLeft->data.leaf.pieces + pLeft->count, pRight->data.leaf.pieces, pRight->count * sizeof(drte_piece));
+
+        pLeft->data.leaf.pNext = pRight->data.leaf.pNext;
+        if (pRight->data.leaf.pNext != NULL) {
+            pRight->data.leaf.pNext->data.leaf.pPrev = pLeft;
         }
     } else {
-        if (pEngine->text[iChar] != '\n' && !(pEngine->text[iChar] == '\r' && pEngine->text[iChar+1])) {
-            iChar += 1;
-        }
+        memcpy(pLeft->data.branch.pChildren + pLeft->count, pRight->data.branch.pChildren, pRight->count * sizeof(drte_piece_table_node*));
+        memcpy(pLeft->data.branch.lengths   + pLeft->count, pRight->data.branch.lengths,   pRight->count * sizeof(size_t));
     }
+    pLeft->count += pRight->count;
 
-    if (pWordEndOut) *pWordEndOut = iChar;
-    return DRTE_TRUE;
+    pNode->data.branch.lengths[iChild] += pNode->data.branch.lengths[iChild+1];
+
+    drte_uint32 moveCount = pNode->count - (iChild+2);
+    memmove(pNode->data.branch.pChildren + iChild+1, pNode->data.branch.pChildren + iChild+2, moveCount * sizeof(drte_piece_table_node*));
+    memmove(pNode->data.branch.lengths   + iChild+1, pNode->data.branch.lengths   + iChild+2, moveCount * sizeof(size_t));
+    pNode->count -= 1;
+
+    free(pRight);   // <-- Not drte_piece_table__free_node() because the children have been moved to the left node.
 }
 
-drte_bool32 drte_engine_get_word_containing_character(drte_engine* pEngine, size_t iChar, size_t* pWordBegOut, size_t* pWordEndOut)
+// Removes the pieces covering the given range of characters, relative to the start of the node. A piece must begin at both ends of
+// the range, which is done by inserting NULL pieces with drte_piece_table__insert_piece().
+void drte_piece_table__node_remove(drte_piece_table_node* pNode, size_t iCharBeg, size_t iCharEnd)
 {
-    if (pEngine == NULL || pEngine->text == NULL) {
-        return DRTE_FALSE;
+    assert(pNode != NULL);
+    assert(iCharBeg < iCharEnd);
+
+    if (pNode->isLeaf) {
+        drte_uint32 iPieceBeg = 0;
+        while (iCharBeg > 0) {
+            assert(iCharBeg >= pNode->data.leaf.pieces[iPieceBeg].length);
+            iCharBeg -= pNode->data.leaf.pieces[iPieceBeg].length;
+            iCharEnd -= pNode->data.leaf.pieces[iPieceBeg].length;
+            iPieceBeg += 1;
+        }
+
+        drte_uint32 iPieceEnd = iPieceBeg;
+        while (iCharEnd > 0) {
+            assert(iCharEnd >= pNode->data.leaf.pieces[iPieceEnd].length);
+            iCharEnd -= pNode->data.leaf.pieces[iPieceEnd].length;
+            iPieceEnd += 1;
+        }
+
+        memmove(pNode->data.leaf.pieces + iPieceBeg, pNode->data.leaf.pieces + iPieceEnd, (pNode->count - iPieceEnd) * sizeof(drte_piece));
+        pNode->count -= iPieceEnd - iPieceBeg;
+        return;
     }
 
-    drte_bool32 moveToStartOfNextWord = DRTE_FALSE;
+    drte_uint32 iChild = 0;
+    while (iCharBeg >= pNode->data.branch.lengths[iChild]) {
+        iCharBeg -= pNode->data.branch.lengths[iChild];
+        iCharEnd -= pNode->data.branch.lengths[iChild];
+        iChild += 1;
+    }
 
-    // Move to the start of the word if we're not already there.
-    if (iChar > 0) {
-        uint32_t c = pEngine->text[iChar];
-        uint32_t cprev = pEngine->text[iChar-1];
+    drte_uint32 iFirstChild = iChild;
+    while (iChild < pNode->count && iCharEnd > 0) {
+        drte_piece_table_node* pChild = pNode->data.branch.pChildren[iChild];
+        size_t childLength = pNode->data.branch.lengths[iChild];
+        size_t iChildCharEnd = (iCharEnd < childLength) ? iCharEnd : childLength;
 
-        if (c == '\0') {
-            if (pWordBegOut) *pWordBegOut = pEngine->textLength;
-            if (pWordEndOut) *pWordEndOut = pEngine->textLength;
-            return DRTE_FALSE;
-        }
+        drte_piece_table__node_remove(pChild, iCharBeg, iChildCharEnd);
+        pNode->data.branch.lengths[iChild] -= iChildCharEnd - iCharBeg;
+        iCharEnd -= iChildCharEnd;
+        iCharBeg  = 0;
 
-        if (!drte_is_whitespace(c) && !drte_is_whitespace(cprev) && !drte_is_symbol_or_whitespace(c)) {
-            drte_engine_get_start_of_word_containing_character(pEngine, iChar, &iChar);
-        } else if (drte_is_whitespace(c) && drte_is_whitespace(cprev)) {
-            size_t iLineCharBeg = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, drte_line_cache_find_line_by_character(pEngine->pUnwrappedLines, iChar));
-            while (iChar > 0 && iChar > iLineCharBeg) {
-                if (!drte_is_whitespace(pEngine->text[iChar-1])) {
-                    break;
+        if (pChild->count == 0) {
+            if (pChild->isLeaf) {
+                if (pChild->data.leaf.pPrev != NULL) {
+                    pChild->data.leaf.pPrev->data.leaf.pNext = pChild->data.leaf.pNext;
+                }
+                if (pChild->data.leaf.pNext != NULL) {
+                    pChild->data.leaf.pNext->data.leaf.pPrev = pChild->data.leaf.pPrev;
                 }
-                iChar -= 1;
             }
 
-            moveToStartOfNextWord = DRTE_TRUE;
+            free(pChild);
+
+            drte_uint32 moveCount = pNode->count - (iChild+1);
+            memmove(pNode->data.branch.pChildren + iChild, pNode->data.branch.pChildren + iChild+1, moveCount * sizeof(drte_piece_table_node*));
+            memmove(pNode->data.branch.lengths   + iChild, pNode->data.branch.lengths   + iChild+1, moveCount * sizeof(size_t));
+            pNode->count -= 1;
+        } else {
+            iChild += 1;
         }
     }
 
-    size_t iWordCharEnd;
-    drte_bool32 result;
-    if (moveToStartOfNextWord) {
-        result = drte_engine_get_start_of_next_word_from_character(pEngine, iChar, &iWordCharEnd);
-    } else {
-        result = drte_engine_get_end_of_word_containing_character(pEngine, iChar, &iWordCharEnd);
+    // Keep the tree reasonably dense by merging small children back in with their neighbours. Only the children either side of
+    // the removed range can have shrunk.
+    if (iFirstChild > 0) {
+        iFirstChild -= 1;
     }
 
-    if (pWordBegOut) *pWordBegOut = iChar;
-    if (pWordEndOut) *pWordEndOut = iWordCharEnd;
+    for (iChild = iFirstChild; iChild < pNode->count && iChild <= iFirstChild+2; ) {
+        drte_piece_table_node* pChild = pNode->data.branch.pChildren[iChild];
+        drte_uint32 capacity = (pChild->isLeaf) ? DRTE_PIECE_TABLE_LEAF_CAPACITY : DRTE_PIECE_TABLE_BRANCH_CAPACITY;
+        drte_uint32 oldCount = pNode->count;
+        if (pChild->count < capacity/4 || (iChild+1 < pNode->count && pNode->data.branch.pChildren[iChild+1]->count < capacity/4)) {
+            drte_piece_table__try_merge_children(pNode, iChild);
+        }
 
-    if (result) {
-        result = iChar < iWordCharEnd;
+        if (pNode->count == oldCount) {
+            iChild += 1;
+        }
     }
-
-    return result;
 }
 
+// Removes the pieces covering the given range of characters. A piece must begin at both ends of the range.
+void drte_piece_table__remove_pieces(drte_piece_table* pTable, size_t iCharBeg, size_t iCharEnd)
+{
+    assert(pTable != NULL);
+    assert(iCharBeg < iCharEnd);
+    assert(iCharEnd <= pTable->length);
 
+    drte_piece_table__node_remove(pTable->pRoot, iCharBeg, iCharEnd);
+    pTable->length -= iCharEnd - iCharBeg;
 
+    // The root is collapsed when it only has one child left.
+    while (!pTable->pRoot->isLeaf && pTable->pRoot->count == 1) {
+        drte_piece_table_node* pOldRoot = pTable->pRoot;
+        pTable->pRoot = pOldRoot->data.branch.pChildren[0];
+        pTable->height -= 1;
 
-drte_bool32 drte_engine__capture_and_push_undo_state__user_data(drte_engine* pEngine, drte_stack_buffer* pStack)
-{
-    assert(pEngine != NULL);
-    assert(pStack != NULL);
-
-    // Make room in the undo buffer for the application-defined prepared state.
-    size_t preparedStateUserDataSize = 0;
-    if (pEngine->onGetUndoState) {
-        preparedStateUserDataSize = pEngine->onGetUndoState(pEngine, NULL);
+        free(pOldRoot);
     }
 
-    void* pPreparedUserData = drte_stack_buffer_alloc(pStack, sizeof(size_t) + preparedStateUserDataSize);     // <-- sizeof(size_t) is for storing the size of the user data.
-    if (pPreparedUserData == NULL) {
-        return DRTE_FALSE;
+    // A branch with no children is left behind when everything is removed. It's turned back into an empty leaf.
+    if (!pTable->pRoot->isLeaf && pTable->pRoot->count == 0) {
+        pTable->pRoot->isLeaf = DRTE_TRUE;
+        pTable->pRoot->data.leaf.pPrev = NULL;
+        pTable->pRoot->data.leaf.pNext = NULL;
+        pTable->height = 1;
     }
 
-    *(size_t*)pPreparedUserData = preparedStateUserDataSize;
-    if (preparedStateUserDataSize > 0) {
-        if (pEngine->onGetUndoState(pEngine, (uint8_t*)pPreparedUserData + sizeof(size_t)) != preparedStateUserDataSize) {
-            return DRTE_FALSE;   // Inconsistent data size returned by onGetUndoState().
+    pTable->lastPiece.pLeaf = NULL;
+}
+
+// Adds the given amount to the length of the piece containing the given character.
+void drte_piece_table__add_to_piece_length(drte_piece_table* pTable, size_t iChar, size_t amount)
+{
+    assert(pTable != NULL);
+    assert(iChar < pTable->length);
+
+    drte_piece_table_node* pNode = pTable->pRoot;
+    while (!pNode->isLeaf) {
+        drte_uint32 iChild = 0;
+        while (iChar >= pNode->data.branch.lengths[iChild]) {
+            iChar -= pNode->data.branch.lengths[iChild];
+            iChild += 1;
         }
+
+        pNode->data.branch.lengths[iChild] += amount;
+        pNode = pNode->data.branch.pChildren[iChild];
     }
 
-    return DRTE_TRUE;
+    drte_uint32 iPiece = 0;
+    while (iChar >= pNode->data.leaf.pieces[iPiece].length) {
+        iChar -= pNode->data.leaf.pieces[iPiece].length;
+        iPiece += 1;
+    }
+
+    pNode->data.leaf.pieces[iPiece].length += amount;
+    pTable->length += amount;
+    pTable->lastPiece.pLeaf = NULL;
 }
 
-drte_bool32 drte_engine__capture_and_push_undo_state__cursors(drte_engine* pEngine, drte_stack_buffer* pStack, drte_view* pView)
+// Removes every piece.
+void drte_piece_table__clear_pieces(drte_piece_table* pTable)
 {
-    assert(pEngine != NULL);
-    assert(pStack != NULL);
-    assert(pView != NULL);
+    assert(pTable != NULL);
 
-    (void)pEngine;
+    drte_piece_table__free_node(pTable->pRoot);
+    pTable->pRoot = NULL;
+    pTable->height = 0;
+    pTable->length = 0;
+    pTable->lastPiece.pLeaf = NULL;
+}
 
-    size_t sizeInBytes =
-        sizeof(pView->cursorCount) +
-        sizeof(drte_cursor) * pView->cursorCount;
+// Replaces the add buffer with the given buffer, which becomes the entire text. Nothing references the old add buffer after this so
+// it's freed, which stops whole-text replacements piling up dead text. The original buffer is left alone because it may be borrowed.
+//
+// At least 2 nodes must have been reserved with drte_piece_table__reserve_nodes() beforehand.
+void drte_piece_table__replace_add_buffer(drte_piece_table* pTable, char* pNewAdd, size_t newLength)
+{
+    assert(pTable != NULL);
+    assert(pTable->spareNodeCount >= 2);
 
-    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(pStack, sizeInBytes);
-    if (pData == NULL) {
-        return DRTE_FALSE;
-    }
+    drte_piece_table__clear_pieces(pTable);
 
-    memcpy(pData, &pView->cursorCount, sizeof(pView->cursorCount));
-    memcpy(pData + sizeof(pView->cursorCount), pView->pCursors, sizeof(drte_cursor) * pView->cursorCount);
+    free(pTable->pAdd);
+    pTable->pAdd = pNewAdd;
+    pTable->addLength = newLength;
+    pTable->addBufferSize = newLength;
 
-    return DRTE_TRUE;
+    if (newLength > 0) {
+        drte_piece piece;
+        piece.offset = 0;
+        piece.length = newLength;
+        piece.buffer = DRTE_PIECE_BUFFER_ADD;
+        drte_piece_table__insert_piece(pTable, 0, &piece);  // <-- Can't fail because the nodes were reserved.
+    }
 }
 
-drte_bool32 drte_engine__capture_and_push_undo_state__selections(drte_engine* pEngine, drte_stack_buffer* pStack, drte_view* pView)
+// Makes sure the add buffer has room for the given number of characters past the end of what's already been added.
+drte_bool32 drte_piece_table__reserve(drte_piece_table* pTable, size_t textLength)
 {
-    assert(pEngine != NULL);
-    assert(pStack != NULL);
-    assert(pView != NULL);
+    assert(pTable != NULL);
 
-    (void)pEngine;
+    if (pTable->addLength + textLength > pTable->addBufferSize) {
+        size_t newBufferSize = (pTable->addBufferSize == 0) ? 4096 : pTable->addBufferSize*2;
+        if (newBufferSize < pTable->addLength + textLength) {
+            newBufferSize = pTable->addLength + textLength;
+        }
 
-    size_t sizeInBytes =
-        sizeof(pView->selectionCount) +
-        sizeof(drte_region) * pView->selectionCount;
+        char* pNewAdd = (char*)realloc(pTable->pAdd, newBufferSize);
+        if (pNewAdd == NULL) {
+            return DRTE_FALSE;
+        }
 
-    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(pStack, sizeInBytes);
-    if (pData == NULL) {
+        pTable->pAdd = pNewAdd;
+        pTable->addBufferSize = newBufferSize;
+    }
+
+    return DRTE_TRUE;
+}
+
+// Appends the given text to the add buffer, growing it if necessary.
+drte_bool32 drte_piece_table__append(drte_piece_table* pTable, const char* text, size_t textLength)
+{
+    assert(pTable != NULL);
+
+    if (!drte_piece_table__reserve(pTable, textLength)) {
         return DRTE_FALSE;
     }
 
-    memcpy(pData, &pView->selectionCount, sizeof(pView->selectionCount));
-    memcpy(pData + sizeof(pView->selectionCount), pView->pSelections, sizeof(drte_region) * pView->selectionCount);
+    memcpy(pTable->pAdd + pTable->addLength, text, textLength);
+    pTable->addLength += textLength;
 
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_engine__capture_and_push_undo_state__view(drte_engine* pEngine, drte_stack_buffer* pStack, drte_view* pView)
+DRTE_INLINE char drte_piece_table_get_char(drte_piece_table* pTable, size_t iChar)
 {
-    if (pEngine == NULL || pStack == NULL || pView == NULL) {
+    drte_piece_cursor cursor;
+    if (!drte_piece_table__find_piece(pTable, iChar, &cursor)) {
+        return '\0';
+    }
+
+    return drte_piece_table__get_piece_text(pTable, cursor.pPiece)[iChar - cursor.iCharBeg];
+}
+
+// Replaces the original buffer. This can only be done when the table is empty. The new buffer becomes the entire text.
+drte_bool32 drte_piece_table_set_original(drte_piece_table* pTable, const char* pOriginal, size_t originalLength, drte_bool32 isBorrowed)
+{
+    if (pTable == NULL || pTable->length > 0) {
         return DRTE_FALSE;
     }
 
-    size_t sizeInBytes = 
-        sizeof(pView->_id);
+    if (originalLength > 0) {
+        drte_piece piece;
+        piece.offset = 0;
+        piece.length = originalLength;
+        piece.buffer = DRTE_PIECE_BUFFER_ORIGINAL;
+        if (!drte_piece_table__insert_piece(pTable, 0, &piece)) {
+            return DRTE_FALSE;
+        }
+    }
 
-    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(pStack, sizeInBytes);
-    if (pData == NULL) {
+    if (!pTable->isOriginalBorrowed) {
+        free((void*)pTable->pOriginal);
+    }
+
+    pTable->pOriginal = pOriginal;
+    pTable->originalLength = originalLength;
+    pTable->isOriginalBorrowed = isBorrowed;
+
+    // Nothing references the add buffer anymore so it can be reused from the start.
+    pTable->addLength = 0;
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_piece_table_insert(drte_piece_table* pTable, size_t iChar, const char* text, size_t textLength)
+{
+    if (pTable == NULL || text == NULL || iChar > pTable->length) {
         return DRTE_FALSE;
     }
 
-    memcpy(pData, &pView->_id, sizeof(pView->_id));
+    if (textLength == 0) {
+        return DRTE_TRUE;
+    }
 
-    if (!drte_engine__capture_and_push_undo_state__cursors(pEngine, pStack, pView)) {
+    size_t addOffset = pTable->addLength;
+    if (!drte_piece_table__append(pTable, text, textLength)) {
         return DRTE_FALSE;
     }
 
-    if (!drte_engine__capture_and_push_undo_state__selections(pEngine, pStack, pView)) {
+    drte_piece piece;
+    piece.offset = addOffset;
+    piece.length = textLength;
+    piece.buffer = DRTE_PIECE_BUFFER_ADD;
+    if (!drte_piece_table__insert_piece(pTable, iChar, &piece)) {
+        pTable->addLength = addOffset;
         return DRTE_FALSE;
     }
 
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_engine__capture_and_push_undo_state(drte_engine* pEngine, drte_stack_buffer* pStack)
+drte_bool32 drte_piece_table_delete(drte_piece_table* pTable, size_t iCharBeg, size_t iCharEnd)
 {
-    if (pEngine == NULL || pStack == NULL) {
+    if (pTable == NULL) {
         return DRTE_FALSE;
     }
 
-    size_t oldStackPtr = drte_stack_buffer_get_stack_ptr(pStack);
+    if (iCharEnd > pTable->length) {
+        iCharEnd = pTable->length;
+    }
 
-    if (!drte_engine__capture_and_push_undo_state__user_data(pEngine, pStack)) {
-        drte_stack_buffer_set_stack_ptr(pStack, oldStackPtr);
+    if (iCharBeg >= iCharEnd) {
         return DRTE_FALSE;
     }
 
-
-    // There is state that needs to be captured for each view. We'll need to view count to begin with.
-    size_t *pViewCount = (size_t*)drte_stack_buffer_alloc(pStack, sizeof(size_t));
-    if (pViewCount == NULL) {
-        drte_stack_buffer_set_stack_ptr(pStack, oldStackPtr);
+    // Pieces need to begin at both ends of the range so that only whole pieces are removed.
+    if (!drte_piece_table__insert_piece(pTable, iCharBeg, NULL) || !drte_piece_table__insert_piece(pTable, iCharEnd, NULL)) {
         return DRTE_FALSE;
     }
 
-    *pViewCount = drte_engine_get_view_count(pEngine);
-
+    drte_piece_table__remove_pieces(pTable, iCharBeg, iCharEnd);
 
-    // Each view...
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        if (!drte_engine__capture_and_push_undo_state__view(pEngine, pStack, pView)) {
-            drte_stack_buffer_set_stack_ptr(pStack, oldStackPtr);
-            return DRTE_FALSE;
+    // Undoing an insertion will often leave two pieces next to each other that reference adjacent text in the same buffer. These
+    // can be merged back together to keep the piece count down.
+    if (iCharBeg > 0 && iCharBeg < pTable->length) {
+        drte_piece_cursor left;
+        drte_piece_cursor right;
+        drte_piece_table__find_piece(pTable, iCharBeg-1, &left);
+        drte_piece_table__find_piece(pTable, iCharBeg,   &right);
+        if (left.pPiece->buffer == right.pPiece->buffer && left.pPiece->offset + left.pPiece->length == right.pPiece->offset) {
+            size_t rightLength = right.pPiece->length;
+            drte_piece_table__remove_pieces(pTable, iCharBeg, iCharBeg + rightLength);
+            drte_piece_table__add_to_piece_length(pTable, iCharBeg-1, rightLength);
         }
     }
 
     return DRTE_TRUE;
 }
 
-size_t drte_engine__get_prev_undo_data_offset(drte_engine* pEngine)
+// Copies the given range of characters to the given buffer. The output buffer must be large enough to hold the entire range. This
+// does not null terminate the output buffer. Returns the number of characters that were copied.
+size_t drte_piece_table_copy(drte_piece_table* pTable, size_t iCharBeg, size_t iCharEnd, char* pDst)
 {
-    if (pEngine == NULL) {
+    if (pTable == NULL || pDst == NULL) {
         return 0;
     }
 
-    if (pEngine->undoBuffer.pBuffer == NULL || pEngine->undoStackCount == 0) {
-        return 0;
+    if (iCharEnd > pTable->length) {
+        iCharEnd = pTable->length;
     }
 
-    return *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, pEngine->currentUndoDataOffset + 0));
-}
+    drte_piece_cursor cursor;
+    if (iCharBeg >= iCharEnd || !drte_piece_table__find_piece(pTable, iCharBeg, &cursor)) {
+        return 0;
+    }
 
-size_t drte_engine__get_next_undo_data_offset(drte_engine* pEngine)
-{
-    if (pEngine == NULL) {
-        return 0;
-    }
+    size_t copiedLength = 0;
+    for (;;) {
+        size_t iLocalChar = iCharBeg - cursor.iCharBeg;
+        size_t length = cursor.pPiece->length - iLocalChar;
+        if (length > iCharEnd - iCharBeg) {
+            length = iCharEnd - iCharBeg;
+        }
 
-    if (pEngine->undoBuffer.pBuffer == NULL || pEngine->undoStackCount == 0) {
-        return 0;
+        memcpy(pDst + copiedLength, drte_piece_table__get_piece_text(pTable, cursor.pPiece) + iLocalChar, length);
+        copiedLength += length;
+        iCharBeg += length;
+
+        if (iCharBeg == iCharEnd || !drte_piece_table__next_piece(&cursor)) {
+            break;
+        }
     }
 
-    return *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, pEngine->currentUndoDataOffset + sizeof(size_t)));
+    return copiedLength;
 }
 
-
-typedef struct drte_undo_state_view_info drte_undo_state_view_info;
-struct drte_undo_state_view_info
-{
-    size_t id;
-    size_t cursorCount;
-    const drte_cursor* pCursors;
-    size_t selectionCount;
-    const drte_region* pSelections;
-};
-
-typedef struct
+// Replaces each of the given ranges with the same text. The ranges must be sorted, must not overlap and must all be rangeLength
+// characters long. The new text is built in a single pass into a new buffer which then replaces the add buffer and every existing
+// piece, which means the cost depends on the length of the text rather than the number of ranges.
+drte_bool32 drte_piece_table_replace_ranges(drte_piece_table* pTable, const size_t* pRangeBegs, size_t rangeCount, size_t rangeLength, const char* text, size_t textLength)
 {
-    size_t prevUndoDataOffset;
-    size_t nextUndoDataOffset;
-    size_t oldStateLocalOffset;
-    size_t newStateLocalOffset;
-    size_t textChangesOffset;
-
-    size_t textChangeCount;
-    const uint8_t* pTextChanges;
-
-    const uint8_t* pOldState;
-    const uint8_t* pNewState;
-
-    struct
-    {
-        size_t userDataSize;
-        const void* pUserData;
-        size_t viewCount;
-        size_t firstViewOffset;
-    } oldState;
+    if (pTable == NULL || (pRangeBegs == NULL && rangeCount > 0) || (text == NULL && textLength > 0)) {
+        return DRTE_FALSE;
+    }
 
-    struct
-    {
-        size_t userDataSize;
-        const void* pUserData;
-        size_t viewCount;
-        size_t firstViewOffset;
-    } newState;
-} drte_undo_state_info;
+    if (rangeCount == 0) {
+        return DRTE_TRUE;
+    }
 
-void drte_engine__breakdown_undo_state_view_info(const uint8_t* pUndoData, drte_undo_state_view_info* pInfoOut, size_t* pBytesReadOut)
-{
-    size_t runningOffset = 0;
-    pInfoOut->id             = *(const size_t*)     (pUndoData + runningOffset); runningOffset += sizeof(size_t);
-    pInfoOut->cursorCount    = *(const size_t*)     (pUndoData + runningOffset); runningOffset += sizeof(size_t);
-    pInfoOut->pCursors       =  (const drte_cursor*)(pUndoData + runningOffset); runningOffset += sizeof(drte_cursor)*pInfoOut->cursorCount;
-    pInfoOut->selectionCount = *(const size_t*)     (pUndoData + runningOffset); runningOffset += sizeof(size_t);
-    pInfoOut->pSelections    =  (const drte_region*)(pUndoData + runningOffset); runningOffset += sizeof(drte_region)*pInfoOut->selectionCount;
+    if (pRangeBegs[rangeCount-1] + rangeLength > pTable->length) {
+        return DRTE_FALSE;
+    }
 
-    *pBytesReadOut = runningOffset;
-}
+    if (!drte_piece_table__reserve_nodes(pTable, 2)) {
+        return DRTE_FALSE;
+    }
 
-DRTE_INLINE void drte_engine__breakdown_undo_state_info(const uint8_t* pUndoData, drte_undo_state_info* pInfoOut)
-{
-    assert(pInfoOut != NULL);
+    size_t newLength = pTable->length - (rangeCount * rangeLength) + (rangeCount * textLength);
+    char* pNewAdd = NULL;
+    if (newLength > 0) {
+        pNewAdd = (char*)malloc(newLength);
+        if (pNewAdd == NULL) {
+            return DRTE_FALSE;
+        }
+    }
 
-    drte_undo_state_info result;
-    result.prevUndoDataOffset  = *(const size_t*)(pUndoData + sizeof(size_t)*0);
-    result.nextUndoDataOffset  = *(const size_t*)(pUndoData + sizeof(size_t)*1);
-    result.oldStateLocalOffset = *(const size_t*)(pUndoData + sizeof(size_t)*2);
-    result.newStateLocalOffset = *(const size_t*)(pUndoData + sizeof(size_t)*3);
-    result.textChangesOffset   = *(const size_t*)(pUndoData + sizeof(size_t)*4);
+    char* pDst = pNewAdd;
 
-    result.textChangeCount = *(const size_t*)(pUndoData + result.textChangesOffset);
-    result.pTextChanges = pUndoData + result.textChangesOffset + sizeof(size_t);
+    size_t iChar = 0;
+    for (size_t iRange = 0; iRange < rangeCount; ++iRange) {
+        assert(pRangeBegs[iRange] >= iChar);
 
-    result.pOldState = pUndoData + result.oldStateLocalOffset;
-    result.pNewState = pUndoData + result.newStateLocalOffset;
+        pDst += drte_piece_table_copy(pTable, iChar, pRangeBegs[iRange], pDst);
+        memcpy(pDst, text, textLength);
+        pDst += textLength;
 
-    size_t runningOffset = 0;
-    result.oldState.userDataSize = *(const size_t*)(result.pOldState + runningOffset); runningOffset += sizeof(size_t);
-    result.oldState.pUserData = result.pOldState + runningOffset;                      runningOffset += result.oldState.userDataSize;
-    result.oldState.viewCount = *(const size_t*)(result.pOldState + runningOffset);    runningOffset += sizeof(size_t);
-    result.oldState.firstViewOffset = result.oldStateLocalOffset + runningOffset;
+        iChar = pRangeBegs[iRange] + rangeLength;
+    }
 
-    runningOffset = 0;
-    result.newState.userDataSize = *(const size_t*)(result.pNewState + runningOffset); runningOffset += sizeof(size_t);
-    result.newState.pUserData = result.pNewState + runningOffset;                      runningOffset += result.newState.userDataSize;
-    result.newState.viewCount = *(const size_t*)(result.pNewState + runningOffset);    runningOffset += sizeof(size_t);
-    result.newState.firstViewOffset = result.newStateLocalOffset + runningOffset;
+    pDst += drte_piece_table_copy(pTable, iChar, pTable->length, pDst);
+    assert((size_t)(pDst - pNewAdd) == newLength);
 
-    *pInfoOut = result;
+    drte_piece_table__replace_add_buffer(pTable, pNewAdd, newLength);
+    return DRTE_TRUE;
 }
 
-
-drte_bool32 drte_engine_prepare_undo_point(drte_engine* pEngine)
+// Replaces each of the given regions with it's own text. The regions must be sorted and must not overlap, but they can be empty in
+// which case the text is inserted. The new text of every region is stored back to back in pTexts. Like drte_piece_table_replace_ranges()
+// the new text is built in a single pass into a new buffer which replaces the add buffer.
+drte_bool32 drte_piece_table_replace_regions(drte_piece_table* pTable, const drte_region* pRegions, size_t regionCount, const char* pTexts, const size_t* pTextLengths)
 {
-    if (pEngine == NULL) {
+    if (pTable == NULL || (regionCount > 0 && (pRegions == NULL || pTextLengths == NULL))) {
         return DRTE_FALSE;
     }
 
-    // If we have a previously prepared state we'll need to clear it.
-    if (pEngine->hasPreparedUndoState) {
-        drte_stack_buffer_set_stack_ptr(&pEngine->preparedUndoState, 0);
+    if (regionCount == 0) {
+        return DRTE_TRUE;
     }
 
-    // If the prepared undo point is cancelled later on we'll need to free the memory at some point.
-    pEngine->preparedUndoTextChangeCount = 0;
-    pEngine->hasPreparedUndoState = drte_engine__capture_and_push_undo_state(pEngine, &pEngine->preparedUndoState);
-    if (!pEngine->hasPreparedUndoState) {
-        return DRTE_FALSE;   // <-- An error occured while trying to capture the undo state.
+    if (pRegions[regionCount-1].iCharEnd > pTable->length) {
+        return DRTE_FALSE;
     }
 
-    // Allocate space for the text change count and initialize to 0 to begin with.
-    pEngine->preparedUndoTextChangesOffset = drte_stack_buffer_get_stack_ptr(&pEngine->preparedUndoState);
-    void* pTextChangeCount = drte_stack_buffer_alloc(&pEngine->preparedUndoState, sizeof(size_t));
-    if (pTextChangeCount == NULL) {
-        pEngine->hasPreparedUndoState = DRTE_FALSE;
+    if (!drte_piece_table__reserve_nodes(pTable, 2)) {
         return DRTE_FALSE;
     }
 
-    *(size_t*)pTextChangeCount = 0;
+    size_t newLength = pTable->length;
+    for (size_t iRegion = 0; iRegion < regionCount; ++iRegion) {
+        newLength = newLength - (pRegions[iRegion].iCharEnd - pRegions[iRegion].iCharBeg) + pTextLengths[iRegion];
+    }
+
+    char* pNewAdd = NULL;
+    if (newLength > 0) {
+        pNewAdd = (char*)malloc(newLength);
+        if (pNewAdd == NULL) {
+            return DRTE_FALSE;
+        }
+    }
+
+    char* pDst = pNewAdd;
+
+    size_t iChar = 0;
+    for (size_t iRegion = 0; iRegion < regionCount; ++iRegion) {
+        assert(pRegions[iRegion].iCharBeg >= iChar);
+        assert(pRegions[iRegion].iCharEnd >= pRegions[iRegion].iCharBeg);
+
+        pDst += drte_piece_table_copy(pTable, iChar, pRegions[iRegion].iCharBeg, pDst);
+        if (pTextLengths[iRegion] > 0) {
+            memcpy(pDst, pTexts, pTextLengths[iRegion]);
+            pDst   += pTextLengths[iRegion];
+            pTexts += pTextLengths[iRegion];
+        }
+
+        iChar = pRegions[iRegion].iCharEnd;
+    }
 
+    pDst += drte_piece_table_copy(pTable, iChar, pTable->length, pDst);
+    assert((size_t)(pDst - pNewAdd) == newLength);
 
+    drte_piece_table__replace_add_buffer(pTable, pNewAdd, newLength);
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_engine_commit_undo_point(drte_engine* pEngine)
+// Counts the number of '\n' characters in the given range.
+size_t drte_piece_table_count_newlines(drte_piece_table* pTable, size_t iCharBeg, size_t iCharEnd)
 {
-    if (pEngine == NULL) {
-        return DRTE_FALSE;
+    if (pTable == NULL) {
+        return 0;
     }
 
-    // The undo point must have been prepared earlier.
-    if (!pEngine->hasPreparedUndoState) {
-        return DRTE_FALSE;
+    if (iCharEnd > pTable->length) {
+        iCharEnd = pTable->length;
     }
 
-
-
-    // The undo buffer needs to be trimmed.
-    if (drte_engine_get_redo_points_remaining_count(pEngine) > 0) {
-        drte_stack_buffer_set_stack_ptr(&pEngine->undoBuffer, pEngine->currentRedoDataOffset);
-        if (pEngine->onUndoStackTrimmed) pEngine->onUndoStackTrimmed(pEngine);
+    drte_piece_cursor cursor;
+    if (iCharBeg >= iCharEnd || !drte_piece_table__find_piece(pTable, iCharBeg, &cursor)) {
+        return 0;
     }
 
-    pEngine->undoStackCount = pEngine->iUndoState;
-
+    size_t count = 0;
+    for (;;) {
+        size_t iLocalChar = iCharBeg - cursor.iCharBeg;
+        size_t length = cursor.pPiece->length - iLocalChar;
+        if (length > iCharEnd - iCharBeg) {
+            length = iCharEnd - iCharBeg;
+        }
 
-    // The data to push onto the stack is done in 3 main parts. The first part is the header which stores the size and offsets of each major section. The
-    // second part is the prepared data. The third part is the state at the time of comitting.
-    
-    // Header.
-    size_t headerSize =
-        sizeof(size_t) +    // Prev undo data offset.
-        sizeof(size_t) +    // Next undo data offset.
-        sizeof(size_t) +    // Old state local offset.
-        sizeof(size_t) +    // New state local offset.
-        sizeof(size_t);     // The offset of the text changes.
-    size_t headerOffset = drte_stack_buffer_get_stack_ptr(&pEngine->undoBuffer);
+        count += drte__count_newlines(drte_piece_table__get_piece_text(pTable, cursor.pPiece) + iLocalChar, length);
+        iCharBeg += length;
 
-    if (drte_stack_buffer_alloc(&pEngine->undoBuffer, headerSize) == NULL) {
-        drte_stack_buffer_set_stack_ptr(&pEngine->undoBuffer, pEngine->currentUndoDataOffset);
-        return DRTE_FALSE;
+        if (iCharBeg == iCharEnd || !drte_piece_table__next_piece(&cursor)) {
+            break;
+        }
     }
 
+    return count;
+}
 
-    // Prepared data.
-    size_t preparedDataSize = drte_stack_buffer_get_stack_ptr(&pEngine->preparedUndoState);
-    size_t preparedDataOffset = drte_stack_buffer_get_stack_ptr(&pEngine->undoBuffer);
+// Retrieves a pointer to a contiguous run of text for the given range. When the range is contained within a single piece this
+// points directly into the backing buffer; otherwise the range is copied into a scratch buffer. The returned string is not
+// necessarily null terminated. Returns NULL if we run out of memory.
+const char* drte_piece_table_get_text_range(drte_piece_table* pTable, size_t iCharBeg, size_t iCharEnd)
+{
+    assert(pTable != NULL);
 
-    if (drte_stack_buffer_alloc(&pEngine->undoBuffer, preparedDataSize) == NULL) {
-        drte_stack_buffer_set_stack_ptr(&pEngine->undoBuffer, pEngine->currentUndoDataOffset);
-        return DRTE_FALSE;
+    if (iCharEnd > pTable->length) {
+        iCharEnd = pTable->length;
     }
 
-    memcpy(drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, preparedDataOffset), drte_stack_buffer_get_data_ptr(&pEngine->preparedUndoState, 0), preparedDataSize);
+    if (iCharBeg >= iCharEnd) {
+        return "";
+    }
 
+    drte_piece_cursor cursor;
+    drte_piece_table__find_piece(pTable, iCharBeg, &cursor);
+    if (iCharEnd <= cursor.iCharBeg + cursor.pPiece->length) {
+        return drte_piece_table__get_piece_text(pTable, cursor.pPiece) + (iCharBeg - cursor.iCharBeg);
+    }
 
-    // Committed data.
-    size_t committedDataOffset = drte_stack_buffer_get_stack_ptr(&pEngine->undoBuffer);
+    size_t length = iCharEnd - iCharBeg;
+    if (length + 1 > pTable->scratchBufferSize) {
+        char* pNewScratch = (char*)realloc(pTable->pScratch, length + 1);
+        if (pNewScratch == NULL) {
+            return NULL;
+        }
 
-    if (!drte_engine__capture_and_push_undo_state(pEngine, &pEngine->undoBuffer)) {
-        drte_stack_buffer_set_stack_ptr(&pEngine->undoBuffer, pEngine->currentUndoDataOffset);
-        return DRTE_FALSE;
+        pTable->pScratch = pNewScratch;
+        pTable->scratchBufferSize = length + 1;
     }
 
+    drte_piece_table_copy(pTable, iCharBeg, iCharEnd, pTable->pScratch);
+    pTable->pScratch[length] = '\0';
 
-    size_t prevUndoDataOffset = pEngine->currentUndoDataOffset;
-    size_t nextUndoDataOffset = drte_stack_buffer_get_stack_ptr(&pEngine->undoBuffer);
+    return pTable->pScratch;
+}
 
 
-    // The header needs to be written last.
-    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, headerOffset + sizeof(size_t)*0)) = prevUndoDataOffset;
-    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, headerOffset + sizeof(size_t)*1)) = nextUndoDataOffset;
-    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, headerOffset + sizeof(size_t)*2)) = preparedDataOffset  - headerOffset;
-    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, headerOffset + sizeof(size_t)*3)) = committedDataOffset - headerOffset;
-    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, headerOffset + sizeof(size_t)*4)) = headerSize + pEngine->preparedUndoTextChangesOffset;
 
-    pEngine->currentUndoDataOffset = headerOffset;
-    pEngine->currentRedoDataOffset = headerOffset;
+// Retrieves the character at the given index, or '\0' if it's out of range.
+DRTE_INLINE char drte_engine__get_char(drte_engine* pEngine, size_t iChar)
+{
+    assert(pEngine != NULL);
+    return drte_piece_table_get_char(&pEngine->text, iChar);
+}
 
-    drte_stack_buffer_set_stack_ptr(&pEngine->preparedUndoState, 0);
-    pEngine->hasPreparedUndoState = DRTE_FALSE;
-    pEngine->preparedUndoTextChangeCount = 0;
+// Retrieves a pointer to a contiguous run of the engine's text. See drte_piece_table_get_text_range().
+DRTE_INLINE const char* drte_engine__get_text_range(drte_engine* pEngine, size_t iCharBeg, size_t iCharEnd)
+{
+    assert(pEngine != NULL);
+    return drte_piece_table_get_text_range(&pEngine->text, iCharBeg, iCharEnd);
+}
 
 
-    pEngine->undoStackCount += 1;
-    pEngine->iUndoState += 1;
 
-    if (pEngine->onUndoPointChanged) {
-        pEngine->onUndoPointChanged(pEngine, pEngine->iUndoState);
-    }
 
-    return DRTE_TRUE;
-}
+// Performs a full refresh of the text engine, including refreshing line wrapping and repaining.
+void drte_engine__refresh(drte_engine* pEngine);
 
-drte_bool32 drte_engine_undo(drte_engine* pEngine)
-{
-    if (pEngine == NULL) {
-        return DRTE_FALSE;
-    }
+/// Applies the given undo state.
+void drte_engine__apply_undo_state(drte_engine* pEngine, const void* pUndoDataPtr);
 
-    if (drte_engine_get_undo_points_remaining_count(pEngine) > 0) {
-        const void* pUndoDataPtr = drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, pEngine->currentUndoDataOffset);
-        if (pUndoDataPtr == NULL) {
-            return DRTE_FALSE;
-        }
+// Updates everything that depends on the text after text has been inserted.
+drte_bool32 drte_engine__on_text_inserted(drte_engine* pEngine, const char* text, size_t textLength, size_t insertIndex, size_t iLine);
 
-        drte_engine__apply_undo_state(pEngine, pUndoDataPtr);
-        pEngine->iUndoState -= 1;
+// Makes sure the lines up to and including the line containing the given character have been indexed.
+drte_bool32 drte_engine__index_lines_to_character(drte_engine* pEngine, size_t iChar);
 
-        if (pEngine->onUndoPointChanged) {
-            pEngine->onUndoPointChanged(pEngine, pEngine->iUndoState);
-        }
+// Replaces each of the given ranges with the same text.
+drte_bool32 drte_engine__replace_ranges(drte_engine* pEngine, const size_t* pRangeBegs, size_t rangeCount, size_t rangeLength, const char* text, size_t textLength);
 
+// Replaces each of the given regions with it's own text, in place when there are no more than DRTE_REPLACE_REGIONS_IN_PLACE_LIMIT of
+// them and by rebuilding the text with drte_piece_table_replace_regions() otherwise.
+drte_bool32 drte_engine__replace_regions(drte_engine* pEngine, const drte_region* pRegions, size_t regionCount, const char* pTexts, const size_t* pTextLengths);
 
-        pEngine->currentRedoDataOffset = pEngine->currentUndoDataOffset;
-        pEngine->currentUndoDataOffset = drte_engine__get_prev_undo_data_offset(pEngine);
-        return DRTE_TRUE;
-    }
+// Updates the lexer states and tokens of the highlighter after oldLineCount lines starting at iFirstLine have been replaced with
+// newLineCount lines.
+void drte_engine__on_lines_changed(drte_engine* pEngine, size_t iFirstLine, size_t oldLineCount, size_t newLineCount);
 
-    return DRTE_FALSE;
-}
+// Forgets everything the highlighter has lexed.
+void drte_engine__reset_lexer(drte_engine* pEngine);
 
-drte_bool32 drte_engine_redo(drte_engine* pEngine)
-{
-    if (pEngine == NULL) {
-        return DRTE_FALSE;
-    }
+// Retrieves the next highlighting token ending after the given character, lexing it's line if necessary.
+drte_bool32 drte_engine__get_next_lexer_token(drte_engine* pEngine, size_t iChar, size_t* pCharBegOut, size_t* pCharEndOut, drte_style_token* pStyleTokenOut);
 
-    if (drte_engine_get_redo_points_remaining_count(pEngine) > 0) {
-        const void* pUndoDataPtr = drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, pEngine->currentRedoDataOffset);
-        if (pUndoDataPtr == NULL) {
-            return DRTE_FALSE;
-        }
+// Updates the view's index of matches after removedLength characters starting at iCharBeg have been replaced with insertedLength characters.
+void drte_view__update_matches(drte_view* pView, size_t iCharBeg, size_t removedLength, size_t insertedLength);
 
-        drte_engine__apply_redo_state(pEngine, pUndoDataPtr);
-        pEngine->iUndoState += 1;
+// Throws away the view's index of matches so that it's rebuilt from the start.
+void drte_view__reset_matches(drte_view* pView);
 
-        if (pEngine->onUndoPointChanged) {
-            pEngine->onUndoPointChanged(pEngine, pEngine->iUndoState);
-        }
+/// Applies the given undo state as a redo operation.
+void drte_engine__apply_redo_state(drte_engine* pEngine, const void* pUndoDataPtr);
 
-        pEngine->currentUndoDataOffset = pEngine->currentRedoDataOffset;
-        if (drte_engine_get_redo_points_remaining_count(pEngine) > 0) {
-            pEngine->currentRedoDataOffset = drte_engine__get_next_undo_data_offset(pEngine);
-        }
+// Retrieves the size in bytes of a text change in the undo buffer, not including alignment padding.
+size_t drte_engine__get_text_change_size(const uint8_t* pData);
 
-        return DRTE_TRUE;
-    }
+/// Called when a cursor moves.
+void drte_engine__on_cursor_move(drte_engine* pEngine, drte_view* pView, size_t cursorIndex);
 
-    return DRTE_FALSE;
-}
 
-unsigned int drte_engine_get_undo_points_remaining_count(drte_engine* pEngine)
+
+static void drte_view__refresh_word_wrapping(drte_view* pView);
+static void drte_view__invalidate_word_wrapping(drte_view* pView);
+static void drte_view__update_word_wrapping(drte_view* pView, size_t iFirstLine, size_t lineCount, size_t characterOffset);
+static void drte_view__on_word_wrapping_changed(drte_view* pView);
+static void drte_view__clear_measurements(drte_view* pView);
+static void drte_view__invalidate_line_measurements(drte_view* pView, size_t iFirstLine, size_t oldLineCount, size_t newLineCount, size_t firstLineKeptLength);
+static float drte_view__get_line_width(drte_view* pView, size_t iLine);
+static float drte_view__get_tab_width_in_pixels(drte_view* pView);
+
+void drte_view__update_cursor_sticky_position(drte_view* pView, drte_cursor* pCursor)
 {
-    if (pEngine == NULL) {
-        return 0;
+    if (pView == NULL || pCursor == NULL) {
+        return;
     }
 
-    return pEngine->iUndoState;
+    // If the character is on a different line to the cursor, it means the cursor is pinned to the end of the previous line and the character
+    // is the first character on the _next_ line. This will happen when word wrap is enabled. In this case things need to be treated a bit
+    // differently to calculate the x position.
+    float charPosX;
+    float charPosY;
+    if (pCursor->iLine != drte_view_get_character_line(pView, pView->pWrappedLines, pCursor->iCharAbs)) {
+        drte_view_measure_line(pView, pCursor->iLine, &charPosX, NULL);
+        charPosY = drte_view_get_line_pos_y(pView, pCursor->iLine);
+    } else {
+        drte_view_get_character_position(pView, pView->pWrappedLines, pCursor->iCharAbs, &charPosX, &charPosY);
+    }
+
+    pCursor->absoluteSickyPosX = charPosX;
 }
 
-unsigned int drte_engine_get_redo_points_remaining_count(drte_engine* pEngine)
+size_t drte_engine__acquire_view_id(drte_engine* pEngine)
 {
-    if (pEngine == NULL) {
-        return 0;
-    }
+    assert(pEngine != NULL);
+    return pEngine->nextViewID++;   // <-- Make this thread-safe?
+}
 
-    if (pEngine->undoStackCount > 0)
-    {
-        assert(pEngine->iUndoState <= pEngine->undoStackCount);
-        return pEngine->undoStackCount - pEngine->iUndoState;
+
+// Finds a style slot index of the given style token. Returns DRTE_INVALID_STYLE_SLOT if it could not be found.
+uint8_t drte_engine__get_style_slot(drte_engine* pEngine, drte_style_token styleToken)
+{
+    assert(pEngine != NULL);
+    assert(pEngine->styleCount < 256);
+
+    for (uint8_t iStyleSlot = 0; iStyleSlot < pEngine->styleCount; ++iStyleSlot) {
+        if (pEngine->styles[iStyleSlot].styleToken == styleToken) {
+            return iStyleSlot;
+        }
     }
 
+    return DRTE_INVALID_STYLE_SLOT;
+}
+
+// Gets the style token associated with the given slot.
+drte_style_token drte_engine__get_style_token(drte_engine* pEngine, uint8_t styleSlot)
+{
+    assert(pEngine != NULL);
+    return pEngine->styles[styleSlot].styleToken;
+}
+
+// Marks the sorted selections as needing to be rebuilt. This must be called whenever pSelections is changed.
+static void drte_view__invalidate_sorted_selections(drte_view* pView)
+{
+    assert(pView != NULL);
+    pView->_isSortedSelectionsStale = DRTE_TRUE;
+}
+
+static int drte_view__compare_regions_by_first_character(const void* pA, const void* pB)
+{
+    const drte_region* pRegionA = (const drte_region*)pA;
+    const drte_region* pRegionB = (const drte_region*)pB;
+
+    if (pRegionA->iCharBeg < pRegionB->iCharBeg) return -1;
+    if (pRegionA->iCharBeg > pRegionB->iCharBeg) return +1;
     return 0;
 }
 
-void drte_engine_clear_undo_stack(drte_engine* pEngine)
+// Rebuilds the sorted selections from pSelections if they've been changed since the last time.
+static drte_bool32 drte_view__refresh_sorted_selections(drte_view* pView)
 {
-    if (pEngine == NULL) {
-        return;
+    assert(pView != NULL);
+
+    if (!pView->_isSortedSelectionsStale) {
+        return DRTE_TRUE;
     }
 
-    drte_stack_buffer_set_stack_ptr(&pEngine->undoBuffer, 0);
-    drte_stack_buffer_set_stack_ptr(&pEngine->preparedUndoState, 0);
+    if (pView->_sortedSelectionBufferSize < pView->selectionCount) {
+        size_t newBufferSize = (pView->_sortedSelectionBufferSize == 0) ? 16 : pView->_sortedSelectionBufferSize*2;
+        if (newBufferSize < pView->selectionCount) {
+            newBufferSize = pView->selectionCount;
+        }
 
-    pEngine->undoStackCount = 0;
+        drte_region* pNewSortedSelections = (drte_region*)realloc(pView->_pSortedSelections, newBufferSize * sizeof(*pNewSortedSelections));
+        if (pNewSortedSelections == NULL) {
+            return DRTE_FALSE;
+        }
 
-    if (pEngine->iUndoState > 0) {
-        pEngine->iUndoState = 0;
+        pView->_pSortedSelections = pNewSortedSelections;
+        pView->_sortedSelectionBufferSize = newBufferSize;
+    }
 
-        if (pEngine->onUndoPointChanged) {
-            pEngine->onUndoPointChanged(pEngine, pEngine->iUndoState);
+    // Empty selections don't cover any characters so they're left out.
+    size_t count = 0;
+    for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+        drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
+        if (selection.iCharBeg < selection.iCharEnd) {
+            pView->_pSortedSelections[count++] = selection;
         }
     }
-}
 
+    qsort(pView->_pSortedSelections, count, sizeof(*pView->_pSortedSelections), drte_view__compare_regions_by_first_character);
 
-
-void drte_engine_set_on_paint_text(drte_engine* pEngine, drte_engine_on_paint_text_proc proc)
-{
-    if (pEngine == NULL) {
-        return;
+    // Regions that overlap or touch are merged so that both the first and last characters of the regions are in ascending order.
+    size_t mergedCount = 0;
+    for (size_t iRegion = 0; iRegion < count; ++iRegion) {
+        drte_region region = pView->_pSortedSelections[iRegion];
+        if (mergedCount > 0 && region.iCharBeg <= pView->_pSortedSelections[mergedCount-1].iCharEnd) {
+            if (pView->_pSortedSelections[mergedCount-1].iCharEnd < region.iCharEnd) {
+                pView->_pSortedSelections[mergedCount-1].iCharEnd = region.iCharEnd;
+            }
+        } else {
+            pView->_pSortedSelections[mergedCount++] = region;
+        }
     }
 
-    pEngine->onPaintText = proc;
+    pView->_sortedSelectionCount = mergedCount;
+    pView->_isSortedSelectionsStale = DRTE_FALSE;
+    return DRTE_TRUE;
 }
 
-void drte_engine_set_on_paint_rect(drte_engine* pEngine, drte_engine_on_paint_rect_proc proc)
+// Retrieves the next selection region starting from the given character, including the region the character is sitting in, if any.
+//
+// Overlapping selections are returned as a single region.
+static drte_bool32 drte_view__get_next_selection_from_character(drte_view* pView, size_t iChar, drte_region* pSelectionOut)
 {
-    if (pEngine == NULL) {
-        return;
+    assert(pView != NULL);
+    assert(pSelectionOut != NULL);
+
+    if (pView->selectionCount == 0) {
+        return DRTE_FALSE;
     }
 
-    pEngine->onPaintRect = proc;
-}
+    if (drte_view__refresh_sorted_selections(pView)) {
+        // The first region ending after the character is either the one the character is sitting in or the closest one after it.
+        size_t iLo = 0;
+        size_t iHi = pView->_sortedSelectionCount;
+        while (iLo < iHi) {
+            size_t iMid = iLo + (iHi - iLo)/2;
+            if (pView->_pSortedSelections[iMid].iCharEnd <= iChar) {
+                iLo = iMid + 1;
+            } else {
+                iHi = iMid;
+            }
+        }
 
+        if (iLo == pView->_sortedSelectionCount) {
+            return DRTE_FALSE;
+        }
 
-void drte_engine_step(drte_engine* pEngine, unsigned int milliseconds)
-{
-    if (pEngine == NULL || milliseconds == 0) {
-        return;
+        *pSelectionOut = pView->_pSortedSelections[iLo];
+        return DRTE_TRUE;
     }
 
-    if (pEngine->timeToNextCursorBlink < milliseconds)
-    {
-        pEngine->isCursorBlinkOn = !pEngine->isCursorBlinkOn;
-        pEngine->timeToNextCursorBlink = pEngine->cursorBlinkRate;
 
-        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-            drte_view_begin_dirty(pView);
-            for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-                drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
+    // Falling back to a linear search if we ran out of memory for the sorted selections. Selections can be in any order. Need to first
+    // check every single one to determine if any are on top of the character. If so we just return the first one. Otherwise we fall
+    // through to the next loop which finds the closest selection to the character.
+    drte_bool32 foundSelectionAfterChar = DRTE_FALSE;
+    drte_region closestSelection;
+    closestSelection.iCharBeg = (size_t)-1;
+    closestSelection.iCharEnd = (size_t)-1;
+
+    for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+        drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
+        if (iChar >= selection.iCharBeg && iChar < selection.iCharEnd) {
+            *pSelectionOut = selection;
+            return DRTE_TRUE;
+        }
+
+        if (selection.iCharBeg > iChar) {
+            foundSelectionAfterChar = DRTE_TRUE;
+            if (closestSelection.iCharBeg > selection.iCharBeg) {
+                closestSelection = selection;
             }
-            drte_view_end_dirty(pView);
         }
     }
-    else
-    {
-        pEngine->timeToNextCursorBlink -= milliseconds;
+
+
+    if (foundSelectionAfterChar) {
+        *pSelectionOut = closestSelection;
     }
+
+    return foundSelectionAfterChar;
 }
 
+// Retrieves the index of the first match starting after the given character.
+static size_t drte_view__find_first_match_after_character(drte_view* pView, size_t iChar)
+{
+    assert(pView != NULL);
+
+    size_t iLo = 0;
+    size_t iHi = pView->_matchCount;
+    while (iLo < iHi) {
+        size_t iMid = iLo + (iHi - iLo)/2;
+        if (pView->_pMatches[iMid] <= iChar) {
+            iLo = iMid + 1;
+        } else {
+            iHi = iMid;
+        }
+    }
 
+    return iLo;
+}
 
-void drte_engine__refresh(drte_engine* pEngine)
+// Retrieves the match that's sitting on top of the given character, or the closest one after it. This is the same as
+// drte_view__get_next_selection_from_character(), but for matches.
+static drte_bool32 drte_view__get_next_match_from_character(drte_view* pView, size_t iChar, drte_region* pMatchOut)
 {
-    assert(pEngine != NULL);
+    assert(pView != NULL);
+    assert(pMatchOut != NULL);
 
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        drte_view__refresh_word_wrapping(pView);
+    size_t matchLength = pView->_matchPattern.length;
+
+    // The last match starting at or before the character is the only one that could be on top of it since every match is the same length.
+    size_t iMatch = drte_view__find_first_match_after_character(pView, iChar);
+    if (iMatch > 0 && pView->_pMatches[iMatch-1] + matchLength > iChar) {
+        iMatch -= 1;
     }
+
+    if (iMatch == pView->_matchCount) {
+        return DRTE_FALSE;
+    }
+
+    pMatchOut->iCharBeg = pView->_pMatches[iMatch];
+    pMatchOut->iCharEnd = pView->_pMatches[iMatch] + matchLength;
+    return DRTE_TRUE;
 }
 
 
 
-void drte_view__set_cursors(drte_view* pView, size_t cursorCount, const drte_cursor* pCursors)
+//// Line Cache ////
+//
+// The line cache is a B-tree. Leaves store the distance between the first character of each line and the first character of the
+// line before it (the first line is relative to zero). Branches store the number of lines and characters contained within each of
+// their children. Finding a line by index or by character is a walk down a single path, and inserting, removing or offsetting lines
+// only needs to update the nodes along that path, rather than every line that comes after the edit.
+//
+// Distances are unsigned and all arithmetic on them is allowed to wrap. A line may temporarily sit before the line above it while a
+// set of lines is being updated, but the sums will come out correct once everything is consistent again.
+struct drte_line_cache_node
 {
-    assert(pView != NULL);
+    drte_uint32 isLeaf;
+    drte_uint32 count;      // The number of lines for leaves, or the number of children for branches.
+    union
+    {
+        size_t lineOffsets[DRTE_LINE_CACHE_LEAF_CAPACITY];
+        struct
+        {
+            drte_line_cache_node* pChildren[DRTE_LINE_CACHE_BRANCH_CAPACITY];
+            size_t lineCounts[DRTE_LINE_CACHE_BRANCH_CAPACITY];
+            size_t charCounts[DRTE_LINE_CACHE_BRANCH_CAPACITY];
+        } branch;
+    } data;
+};
 
-    if (cursorCount > 0) {
-        drte_cursor* pNewCursors = (drte_cursor*)realloc(pView->pCursors, cursorCount * sizeof(*pNewCursors));
-        if (pNewCursors != NULL) {
-            pView->pCursors = pNewCursors;
-            for (size_t iCursor = 0; iCursor < cursorCount; ++iCursor) {
-                pView->pCursors[iCursor] = pCursors[iCursor];
-                drte_view__update_cursor_sticky_position(pView, &pView->pCursors[iCursor]);
-            }
+drte_line_cache_node* drte_line_cache__alloc_node(drte_line_cache* pLineCache, drte_bool32 isLeaf)
+{
+    assert(pLineCache != NULL);
 
-            pView->cursorCount = cursorCount;
-        }
+    // Spare nodes are reserved before any operation that may need to split a node so that we never run out of memory half way
+    // through an update.
+    drte_line_cache_node* pNode = pLineCache->pSpareNodes;
+    if (pNode != NULL) {
+        pLineCache->pSpareNodes = pNode->data.branch.pChildren[0];
+        pLineCache->spareNodeCount -= 1;
     } else {
-        pView->cursorCount = 0;
+        pNode = (drte_line_cache_node*)malloc(sizeof(*pNode));
+        if (pNode == NULL) {
+            return NULL;
+        }
     }
+
+    pNode->isLeaf = isLeaf;
+    pNode->count = 0;
+    return pNode;
 }
 
-void drte_view__set_selections(drte_view* pView, size_t selectionCount, const drte_region* pSelections)
+void drte_line_cache__free_node(drte_line_cache* pLineCache, drte_line_cache_node* pNode)
 {
-    assert(pView != NULL);
+    assert(pLineCache != NULL);
 
-    if (selectionCount > 0) {
-        drte_region* pNewSelections = (drte_region*)realloc(pView->pSelections, selectionCount * sizeof(*pNewSelections));
-        if (pNewSelections != NULL) {
-            pView->pSelections = pNewSelections;
-            for (size_t iSelection = 0; iSelection < selectionCount; ++iSelection) {
-                pView->pSelections[iSelection] = pSelections[iSelection];
-            }
+    if (pNode == NULL) {
+        return;
+    }
 
-            pView->selectionCount = selectionCount;
+    if (!pNode->isLeaf) {
+        for (drte_uint32 iChild = 0; iChild < pNode->count; ++iChild) {
+            drte_line_cache__free_node(pLineCache, pNode->data.branch.pChildren[iChild]);
         }
-    } else {
-        pView->selectionCount = 0;
     }
+
+    free(pNode);
 }
 
-void drte_engine__apply_text_changes_reversed(drte_engine* pEngine, size_t changeCount, const uint8_t* pData)
+drte_bool32 drte_line_cache__reserve_nodes(drte_line_cache* pLineCache, size_t count)
 {
-    // Each item in pData is formatted as:
-    //   type, iCharBeg, iCharEnd, text (null terminated).
+    assert(pLineCache != NULL);
 
-    assert(pEngine != NULL);
-    assert(pData != NULL);
+    while (pLineCache->spareNodeCount < count) {
+        drte_line_cache_node* pNode = (drte_line_cache_node*)malloc(sizeof(*pNode));
+        if (pNode == NULL) {
+            return DRTE_FALSE;
+        }
 
-    if (changeCount == 0) {
-        return;
+        pNode->data.branch.pChildren[0] = pLineCache->pSpareNodes;
+        pLineCache->pSpareNodes = pNode;
+        pLineCache->spareNodeCount += 1;
     }
 
-    drte_undo_change_type type = *(drte_undo_change_type*)(pData + 0);
-    size_t iCharBeg = *(size_t*)(pData + sizeof(drte_undo_change_type));
-    size_t iCharEnd = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
-    const char* text = (const char*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t) + sizeof(size_t));
-    size_t sizeInBytes = sizeof(drte_undo_change_type) + sizeof(size_t) + sizeof(size_t) + (iCharEnd - iCharBeg) + 1;
+    return DRTE_TRUE;
+}
 
-    // We need to do the next changes before doing this one. This is how we do it in reverse.
-    drte_engine__apply_text_changes_reversed(pEngine, changeCount - 1, pData + drte_round_up(sizeInBytes, DRTE_STACK_BUFFER_ALIGNMENT));
+// Retrieves the number of lines and characters contained within the given node.
+void drte_line_cache__get_node_size(drte_line_cache_node* pNode, size_t* pLineCountOut, size_t* pCharCountOut)
+{
+    assert(pNode != NULL);
 
-    // Now we apply the change, remembering to transform inserts into deletes and vice versa.
-    if (type == drte_undo_change_type_insert) {
-        drte_engine_delete_text(pEngine, iCharBeg, iCharEnd);
+    size_t lineCount = 0;
+    size_t charCount = 0;
+    if (pNode->isLeaf) {
+        lineCount = pNode->count;
+        for (drte_uint32 i = 0; i < pNode->count; ++i) {
+            charCount += pNode->data.lineOffsets[i];
+        }
     } else {
-        drte_engine_insert_text(pEngine, text, iCharBeg);
+        for (drte_uint32 i = 0; i < pNode->count; ++i) {
+            lineCount += pNode->data.branch.lineCounts[i];
+            charCount += pNode->data.branch.charCounts[i];
+        }
     }
+
+    if (pLineCountOut) *pLineCountOut = lineCount;
+    if (pCharCountOut) *pCharCountOut = charCount;
 }
 
-void drte_engine__apply_text_changes(drte_engine* pEngine, size_t changeCount, const uint8_t* pData)
+// Adds the given amount to the offset of the given line.
+void drte_line_cache__add_to_line_offset(drte_line_cache* pLineCache, size_t iLine, size_t amount)
 {
-    // Each item in pData is formatted as:
-    //   type, iCharBeg, iCharEnd, text (null terminated).
+    assert(pLineCache != NULL);
+    assert(iLine < pLineCache->count);
+
+    drte_line_cache_node* pNode = pLineCache->pRoot;
+    while (!pNode->isLeaf) {
+        drte_uint32 iChild = 0;
+        while (iLine >= pNode->data.branch.lineCounts[iChild]) {
+            iLine -= pNode->data.branch.lineCounts[iChild];
+            iChild += 1;
+        }
 
-    assert(pEngine != NULL);
-    assert(pData != NULL);
+        pNode->data.branch.charCounts[iChild] += amount;
+        pNode = pNode->data.branch.pChildren[iChild];
+    }
 
-    for (size_t i = 0; i < changeCount; ++i) {
-        drte_undo_change_type type = *(drte_undo_change_type*)(pData + 0);
-        size_t iCharBeg = *(size_t*)(pData + sizeof(drte_undo_change_type));
-        size_t iCharEnd = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
-        const char* text = (const char*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t) + sizeof(size_t));
-        size_t sizeInBytes = sizeof(drte_undo_change_type) + sizeof(size_t) + sizeof(size_t) + (iCharEnd - iCharBeg) + 1;
+    pNode->data.lineOffsets[iLine] += amount;
+}
 
-        // Now we apply the change, remembering to transform inserts into deletes and vice versa.
-        if (type == drte_undo_change_type_insert) {
-            drte_engine_insert_text(pEngine, text, iCharBeg);
-        } else {
-            drte_engine_delete_text(pEngine, iCharBeg, iCharEnd);
+// Inserts a line into the given node. Returns the new right sibling if the node needed to be split, otherwise NULL.
+drte_line_cache_node* drte_line_cache__node_insert(drte_line_cache* pLineCache, drte_line_cache_node* pNode, size_t iLine, size_t lineOffset)
+{
+    assert(pLineCache != NULL);
+    assert(pNode != NULL);
+
+    if (pNode->isLeaf) {
+        drte_line_cache_node* pSibling = NULL;
+        if (pNode->count == DRTE_LINE_CACHE_LEAF_CAPACITY) {
+            pSibling = drte_line_cache__alloc_node(pLineCache, DRTE_TRUE);
+            assert(pSibling != NULL);   // <-- Nodes should have been reserved with drte_line_cache__reserve_nodes().
+
+            // Lines are usually added in order so favour filling the left side.
+            drte_uint32 splitIndex = DRTE_LINE_CACHE_LEAF_CAPACITY - (DRTE_LINE_CACHE_LEAF_CAPACITY/4);
+            pSibling->count = pNode->count - splitIndex;
+            memcpy(pSibling->data.lineOffsets, pNode->data.lineOffsets + splitIndex, pSibling->count * sizeof(size_t));
+            pNode->count = splitIndex;
+
+            if (iLine > splitIndex) {
+                drte_line_cache__node_insert(pLineCache, pSibling, iLine - splitIndex, lineOffset);
+                return pSibling;
+            }
         }
 
-        pData += drte_round_up(sizeInBytes, DRTE_STACK_BUFFER_ALIGNMENT);
+        memmove(pNode->data.lineOffsets + iLine + 1, pNode->data.lineOffsets + iLine, (pNode->count - iLine) * sizeof(size_t));
+        pNode->data.lineOffsets[iLine] = lineOffset;
+        pNode->count += 1;
+
+        return pSibling;
     }
-}
 
-void drte_engine__apply_undo_state(drte_engine* pEngine, const void* pUndoDataPtr)
-{
-    if (pEngine == NULL) {
-        return;
+
+    // Lines at the boundary between two children go to the end of the left child.
+    drte_uint32 iChild = 0;
+    while (iChild+1 < pNode->count && iLine > pNode->data.branch.lineCounts[iChild]) {
+        iLine -= pNode->data.branch.lineCounts[iChild];
+        iChild += 1;
     }
 
-    // Begin dirty.
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        drte_view_begin_dirty(pView);
+    pNode->data.branch.lineCounts[iChild] += 1;
+    pNode->data.branch.charCounts[iChild] += lineOffset;
+
+    drte_line_cache_node* pNewChild = drte_line_cache__node_insert(pLineCache, pNode->data.branch.pChildren[iChild], iLine, lineOffset);
+    if (pNewChild == NULL) {
+        return NULL;
     }
 
+    size_t newChildLineCount;
+    size_t newChildCharCount;
+    drte_line_cache__get_node_size(pNewChild, &newChildLineCount, &newChildCharCount);
+    pNode->data.branch.lineCounts[iChild] -= newChildLineCount;
+    pNode->data.branch.charCounts[iChild] -= newChildCharCount;
+
+    drte_line_cache_node* pSibling = NULL;
+    drte_line_cache_node* pTarget = pNode;
+    drte_uint32 iNewChild = iChild+1;
+    if (pNode->count == DRTE_LINE_CACHE_BRANCH_CAPACITY) {
+        pSibling = drte_line_cache__alloc_node(pLineCache, DRTE_FALSE);
+        assert(pSibling != NULL);
+
+        drte_uint32 splitIndex = DRTE_LINE_CACHE_BRANCH_CAPACITY/2;
+        pSibling->count = pNode->count - splitIndex;
+        memcpy(pSibling->data.branch.pChildren,  pNode->data.branch.pChildren  + splitIndex, pSibling->count * sizeof(drte_line_cache_node*));
+        memcpy(pSibling->data.branch.lineCounts, pNode->data.branch.lineCounts + splitIndex, pSibling->count * sizeof(size_t));
+        memcpy(pSibling->data.branch.charCounts, pNode->data.branch.charCounts + splitIndex, pSibling->count * sizeof(size_t));
+        pNode->count = splitIndex;
+
+        if (iNewChild > splitIndex) {
+            pTarget = pSibling;
+            iNewChild -= splitIndex;
+        }
+    }
 
-    drte_undo_state_info state;
-    drte_engine__breakdown_undo_state_info((const uint8_t*)pUndoDataPtr, &state);
+    drte_uint32 moveCount = pTarget->count - iNewChild;
+    memmove(pTarget->data.branch.pChildren  + iNewChild + 1, pTarget->data.branch.pChildren  + iNewChild, moveCount * sizeof(drte_line_cache_node*));
+    memmove(pTarget->data.branch.lineCounts + iNewChild + 1, pTarget->data.branch.lineCounts + iNewChild, moveCount * sizeof(size_t));
+    memmove(pTarget->data.branch.charCounts + iNewChild + 1, pTarget->data.branch.charCounts + iNewChild, moveCount * sizeof(size_t));
+    pTarget->data.branch.pChildren[iNewChild]  = pNewChild;
+    pTarget->data.branch.lineCounts[iNewChild] = newChildLineCount;
+    pTarget->data.branch.charCounts[iNewChild] = newChildCharCount;
+    pTarget->count += 1;
 
-    // Text.
-    drte_engine__apply_text_changes_reversed(pEngine, state.textChangeCount, state.pTextChanges);
+    return pSibling;
+}
 
+// Inserts a single line with the given offset relative to the line before it.
+drte_bool32 drte_line_cache__insert_line(drte_line_cache* pLineCache, size_t iLine, size_t lineOffset)
+{
+    assert(pLineCache != NULL);
+    assert(iLine <= pLineCache->count);
 
-    // For each view with captured state...
-    size_t viewDataOffset = state.oldState.firstViewOffset;
-    for (size_t iView = 0; iView < state.oldState.viewCount; ++iView) {
-        size_t viewDataSize;
-        drte_undo_state_view_info viewData;
-        drte_engine__breakdown_undo_state_view_info((uint8_t*)pUndoDataPtr + viewDataOffset, &viewData, &viewDataSize);
+    // Worst case is that every node on the path to the leaf is split, plus a new root.
+    if (!drte_line_cache__reserve_nodes(pLineCache, pLineCache->height + 1)) {
+        return DRTE_FALSE;
+    }
 
-        // If the view that owns this captured state still exists it needs to have it's selections and cursors restored. Otherwise we just skip it.
-        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-            if (pView->_id == viewData.id) {
-                drte_view__set_cursors(pView, viewData.cursorCount, viewData.pCursors);
-                drte_view__set_selections(pView, viewData.selectionCount, viewData.pSelections);
-                
-                for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-                    drte_engine__on_cursor_move(pEngine, pView, iCursor);
-                }
-
-                break;
-            }
-        }
-
-        viewDataOffset += viewDataSize;
-    }
+    drte_line_cache_node* pSibling = drte_line_cache__node_insert(pLineCache, pLineCache->pRoot, iLine, lineOffset);
+    if (pSibling != NULL) {
+        drte_line_cache_node* pNewRoot = drte_line_cache__alloc_node(pLineCache, DRTE_FALSE);
+        assert(pNewRoot != NULL);
 
+        pNewRoot->count = 2;
+        pNewRoot->data.branch.pChildren[0] = pLineCache->pRoot;
+        pNewRoot->data.branch.pChildren[1] = pSibling;
+        drte_line_cache__get_node_size(pLineCache->pRoot, &pNewRoot->data.branch.lineCounts[0], &pNewRoot->data.branch.charCounts[0]);
+        drte_line_cache__get_node_size(pSibling,          &pNewRoot->data.branch.lineCounts[1], &pNewRoot->data.branch.charCounts[1]);
 
-    if (pEngine->onTextChanged) {
-        pEngine->onTextChanged(pEngine);
-    }
-
-    // Application-defined data.
-    if (pEngine->onApplyUndoState) {
-        pEngine->onApplyUndoState(pEngine, state.oldState.userDataSize, state.oldState.pUserData);
+        pLineCache->pRoot = pNewRoot;
+        pLineCache->height += 1;
     }
 
-
-    // End dirty.
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        drte_view_end_dirty(pView);
-    }
+    pLineCache->count += 1;
+    return DRTE_TRUE;
 }
 
-void drte_engine__apply_redo_state(drte_engine* pEngine, const void* pUndoDataPtr)
+// Merges the child at the given index with it's right neighbour if they are small enough to fit in a single node.
+void drte_line_cache__try_merge_children(drte_line_cache_node* pNode, drte_uint32 iChild)
 {
-    if (pEngine == NULL) {
+    assert(pNode != NULL);
+    assert(!pNode->isLeaf);
+
+    if (iChild+1 >= pNode->count) {
         return;
     }
 
-    // Begin dirty.
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        drte_view_begin_dirty(pView);
+    drte_line_cache_node* pLeft  = pNode->data.branch.pChildren[iChild];
+    drte_line_cache_node* pRight = pNode->data.branch.pChildren[iChild+1];
+    drte_uint32 capacity = (pLeft->isLeaf) ? DRTE_LINE_CACHE_LEAF_CAPACITY : DRTE_LINE_CACHE_BRANCH_CAPACITY;
+    if (pLeft->count + pRight->count > capacity) {
+        return;
     }
 
+    if (pLeft->isLeaf) {
+        memcpy(pLeft->data.lineOffsets + pLeft->count, pRight->data.lineOffsets, pRight->count * sizeof(size_t));
+    } else {
+        memcpy(pLeft->data.branch.pChildren  + pLeft->count, pRight->data.branch.pChildren,  pRight->count * sizeof(drte_line_cache_node*));
+        memcpy(pLeft->data.branch.lineCounts + pLeft->count, pRight->data.branch.lineCounts, pRight->count * sizeof(size_t));
+        memcpy(pLeft->data.branch.charCounts + pLeft->count, pRight->data.branch.charCounts, pRight->count * sizeof(size_t));
+    }
+    pLeft->count += pRight->count;
 
-    drte_undo_state_info state;
-    drte_engine__breakdown_undo_state_info((const uint8_t*)pUndoDataPtr, &state);
-
-    // Text.
-    drte_engine__apply_text_changes(pEngine, state.textChangeCount, state.pTextChanges);
-
-    size_t viewDataOffset = state.newState.firstViewOffset;
-    for (size_t iView = 0; iView < state.newState.viewCount; ++iView) {
-        size_t viewDataSize;
-        drte_undo_state_view_info viewData;
-        drte_engine__breakdown_undo_state_view_info((uint8_t*)pUndoDataPtr + viewDataOffset, &viewData, &viewDataSize);
-
-        // If the view that owns this captured state still exists it needs to have it's selections and cursors restored. Otherwise we just skip it.
-        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-            if (pView->_id == viewData.id) {
-                drte_view__set_cursors(pView, viewData.cursorCount, viewData.pCursors);
-                drte_view__set_selections(pView, viewData.selectionCount, viewData.pSelections);
-                
-                for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-                    drte_engine__on_cursor_move(pEngine, pView, iCursor);
-                }
+    pNode->data.branch.lineCounts[iChild] += pNode->data.branch.lineCounts[iChild+1];
+    pNode->data.branch.charCounts[iChild] += pNode->data.branch.charCounts[iChild+1];
 
-                break;
-            }
-        }
+    drte_uint32 moveCount = pNode->count - (iChild+2);
+    memmove(pNode->data.branch.pChildren  + iChild+1, pNode->data.branch.pChildren  + iChild+2, moveCount * sizeof(drte_line_cache_node*));
+    memmove(pNode->data.branch.lineCounts + iChild+1, pNode->data.branch.lineCounts + iChild+2, moveCount * sizeof(size_t));
+    memmove(pNode->data.branch.charCounts + iChild+1, pNode->data.branch.charCounts + iChild+2, moveCount * sizeof(size_t));
+    pNode->count -= 1;
 
-        viewDataOffset += viewDataSize;
-    }
+    free(pRight);   // <-- Not drte_line_cache__free_node() because the children have been moved to the left node.
+}
 
+// Removes a line from the given node. Returns the offset of the line that was removed.
+size_t drte_line_cache__node_remove(drte_line_cache* pLineCache, drte_line_cache_node* pNode, size_t iLine)
+{
+    assert(pNode != NULL);
 
-    if (pEngine->onTextChanged) {
-        pEngine->onTextChanged(pEngine);
+    if (pNode->isLeaf) {
+        size_t lineOffset = pNode->data.lineOffsets[iLine];
+        memmove(pNode->data.lineOffsets + iLine, pNode->data.lineOffsets + iLine + 1, (pNode->count - iLine - 1) * sizeof(size_t));
+        pNode->count -= 1;
+        return lineOffset;
     }
 
-    // Application-defined data.
-    if (pEngine->onApplyUndoState) {
-        pEngine->onApplyUndoState(pEngine, state.newState.userDataSize, state.newState.pUserData);
+    drte_uint32 iChild = 0;
+    while (iLine >= pNode->data.branch.lineCounts[iChild]) {
+        iLine -= pNode->data.branch.lineCounts[iChild];
+        iChild += 1;
     }
 
+    size_t lineOffset = drte_line_cache__node_remove(pLineCache, pNode->data.branch.pChildren[iChild], iLine);
+    pNode->data.branch.lineCounts[iChild] -= 1;
+    pNode->data.branch.charCounts[iChild] -= lineOffset;
 
-    // End dirty.
-    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
-        drte_view_end_dirty(pView);
+    // Keep the tree reasonably dense by merging small children back in with their neighbours.
+    drte_line_cache_node* pChild = pNode->data.branch.pChildren[iChild];
+    drte_uint32 capacity = (pChild->isLeaf) ? DRTE_LINE_CACHE_LEAF_CAPACITY : DRTE_LINE_CACHE_BRANCH_CAPACITY;
+    if (pChild->count < capacity/4) {
+        if (iChild+1 < pNode->count) {
+            drte_line_cache__try_merge_children(pNode, iChild);
+        } else if (iChild > 0) {
+            drte_line_cache__try_merge_children(pNode, iChild-1);
+        }
     }
-}
-
 
+    return lineOffset;
+}
 
-void drte_engine__on_cursor_move(drte_engine* pEngine, drte_view* pView, size_t cursorIndex)
+// Removes a single line, returning it's offset relative to the line before it.
+size_t drte_line_cache__remove_line(drte_line_cache* pLineCache, size_t iLine)
 {
-    if (pEngine == NULL) {
-        return;
-    }
+    assert(pLineCache != NULL);
+    assert(iLine < pLineCache->count);
 
-    // When the cursor moves we want to reset the cursor's blink state.
-    drte_engine_reset_cursor_blinks(pEngine);
+    size_t lineOffset = drte_line_cache__node_remove(pLineCache, pLineCache->pRoot, iLine);
+    pLineCache->count -= 1;
 
-    if (pEngine->onCursorMove) {
-        pEngine->onCursorMove(pEngine, pView, cursorIndex);
+    // The root is collapsed when it only has one child left.
+    while (!pLineCache->pRoot->isLeaf && pLineCache->pRoot->count == 1) {
+        drte_line_cache_node* pOldRoot = pLineCache->pRoot;
+        pLineCache->pRoot = pOldRoot->data.branch.pChildren[0];
+        pLineCache->height -= 1;
+
+        free(pOldRoot);
     }
 
-    drte_view_dirty(pView, drte_view_get_cursor_rect(pView, cursorIndex));  // <-- Is this needed?
+    return lineOffset;
 }
 
-
-
-///////////////////////////////////////////////////////////////////////////////
-//
-// Views
-//
-///////////////////////////////////////////////////////////////////////////////
-
-DRTE_INLINE void drte_view__repaint(drte_view* pView)
+// Writes the offset of every line to the given buffer.
+size_t drte_line_cache__node_flatten(drte_line_cache_node* pNode, size_t* pLineOffsetsOut)
 {
-    drte_view_dirty(pView, drte_view_get_local_rect(pView));
-}
+    assert(pNode != NULL);
 
-static float drte_view__get_tab_width_in_pixels(drte_view* pView)
-{
-    float tabWidth = (float)(pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth * pView->tabSizeInSpaces);
-    if (tabWidth <= 0) {
-        tabWidth = (float)pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth;
-        if (tabWidth <= 0) {
-            tabWidth = 4;
-        }
+    if (pNode->isLeaf) {
+        memcpy(pLineOffsetsOut, pNode->data.lineOffsets, pNode->count * sizeof(size_t));
+        return pNode->count;
     }
 
-    return tabWidth;
+    size_t lineCount = 0;
+    for (drte_uint32 iChild = 0; iChild < pNode->count; ++iChild) {
+        lineCount += drte_line_cache__node_flatten(pNode->data.branch.pChildren[iChild], pLineOffsetsOut + lineCount);
+    }
+
+    return lineCount;
 }
 
-static void drte_view__refresh_word_wrapping(drte_view* pView)
+// Replaces the contents of the line cache with the given line offsets. This is done bottom up in linear time and is used for large
+// edits where inserting or removing lines one at a time would be slower than just starting again.
+drte_bool32 drte_line_cache__rebuild(drte_line_cache* pLineCache, const size_t* pLineOffsets, size_t lineCount)
 {
-    // When word wrap is enabled we need to recalculate the lines and then repaint. There is no need to do
-    // this when word wrap is disabled, but it will need a repaint.
-    if (drte_view_is_word_wrap_enabled(pView)) {
-        // Make sure the cache is cleared to begin with.
-        drte_line_cache_clear(pView->pWrappedLines);
-
-        // Line wrapping is done by simply sub-diving each unwrapped line based on word boundaries.
-        size_t lineCount = drte_line_cache_get_line_count(pView->pEngine->pUnwrappedLines);
-        for (size_t iLine = 0; iLine < lineCount; ++iLine) {
-            size_t iLineCharBeg;
-            size_t iLineCharEnd;
-            drte_view_get_line_character_range(pView, pView->pEngine->pUnwrappedLines, iLine, &iLineCharBeg, &iLineCharEnd);
-
-            if (iLineCharBeg < iLineCharEnd) {
-                float runningWidth = 0;
-                while (iLineCharBeg < iLineCharEnd) {
-                    drte_line_cache_append_line(pView->pWrappedLines, iLineCharBeg);
-
-                    drte_segment segment;
-                    if (!drte_engine__first_segment_on_line(pView, pView->pEngine->pUnwrappedLines, iLine, iLineCharBeg, &segment)) {
-                        break;
-                    }
+    assert(pLineCache != NULL);
 
-                    do
-                    {
-                        if ((runningWidth + segment.width) > pView->sizeX) {
-                            float unused = 0;
-                            size_t iChar = iLineCharBeg;
-                            if (pView->pEngine->onGetCursorPositionFromPoint) {
-                                pView->pEngine->onGetCursorPositionFromPoint(pView->pEngine, drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot), pView->scale, pView->pEngine->text + segment.iCharBeg, segment.iCharEnd - segment.iCharBeg,
-                                    segment.width, pView->sizeX - runningWidth, &unused, &iChar);
-                            }
+    size_t nodeCount = (lineCount + DRTE_LINE_CACHE_LEAF_CAPACITY-1) / DRTE_LINE_CACHE_LEAF_CAPACITY;
+    if (nodeCount == 0) {
+        nodeCount = 1;
+    }
 
-                            size_t iWordCharBeg;
-                            size_t iWordCharEnd;
-                            if (!drte_engine_get_word_containing_character(pView->pEngine, iLineCharBeg + iChar, &iWordCharBeg, &iWordCharEnd)) {
-                                iLineCharBeg = segment.iCharEnd;
-                                runningWidth = 0;
-                                break;
-                            }
+    drte_line_cache_node** ppNodes = (drte_line_cache_node**)malloc(nodeCount * sizeof(*ppNodes));
+    if (ppNodes == NULL) {
+        return DRTE_FALSE;
+    }
 
+    for (size_t iNode = 0; iNode < nodeCount; ++iNode) {
+        ppNodes[iNode] = drte_line_cache__alloc_node(pLineCache, DRTE_TRUE);
+        if (ppNodes[iNode] == NULL) {
+            for (size_t iNodeToFree = 0; iNodeToFree < iNode; ++iNodeToFree) {
+                drte_line_cache__free_node(pLineCache, ppNodes[iNodeToFree]);
+            }
+            free(ppNodes);
+            return DRTE_FALSE;
+        }
 
-                            size_t iPrevLineChar = pView->pWrappedLines->pLines[pView->pWrappedLines->count-1];
-                            if (iWordCharBeg <= iPrevLineChar) {
-                                iWordCharBeg  = segment.iCharBeg + iChar;   // The word itself is longer than the container which means it needs to be split based on the exact character.
-                            }
+        size_t iFirstLine = iNode * DRTE_LINE_CACHE_LEAF_CAPACITY;
+        size_t count = lineCount - iFirstLine;
+        if (count > DRTE_LINE_CACHE_LEAF_CAPACITY) {
+            count = DRTE_LINE_CACHE_LEAF_CAPACITY;
+        }
 
-                            // Always make sure wrapping has at least one character.
-                            if (iWordCharBeg == iLineCharBeg) {
-                                iWordCharBeg += 1;
-                            }
+        ppNodes[iNode]->count = (drte_uint32)count;
+        if (count > 0) {
+            memcpy(ppNodes[iNode]->data.lineOffsets, pLineOffsets + iFirstLine, count * sizeof(size_t));
+        }
+    }
 
-                            iLineCharBeg = iWordCharBeg;
-                            runningWidth = 0;
-                            break;
-                        } else {
-                            runningWidth += segment.width;
-                            iLineCharBeg = segment.iCharEnd;
-                        }
-                    } while (drte_engine__next_segment_on_line(pView, &segment));
+    size_t height = 1;
+    while (nodeCount > 1) {
+        size_t parentCount = (nodeCount + DRTE_LINE_CACHE_BRANCH_CAPACITY-1) / DRTE_LINE_CACHE_BRANCH_CAPACITY;
+        for (size_t iParent = 0; iParent < parentCount; ++iParent) {
+            drte_line_cache_node* pParent = drte_line_cache__alloc_node(pLineCache, DRTE_FALSE);
+            if (pParent == NULL) {
+                // Out of memory. Everything that's been built so far needs to be freed.
+                for (size_t iNodeToFree = 0; iNodeToFree < iParent; ++iNodeToFree) {
+                    drte_line_cache__free_node(pLineCache, ppNodes[iNodeToFree]);
                 }
-            } else {
-                drte_line_cache_append_line(pView->pWrappedLines, iLineCharBeg);  // <-- Empty line.
+                for (size_t iNodeToFree = iParent*DRTE_LINE_CACHE_BRANCH_CAPACITY; iNodeToFree < nodeCount; ++iNodeToFree) {
+                    drte_line_cache__free_node(pLineCache, ppNodes[iNodeToFree]);
+                }
+                free(ppNodes);
+                return DRTE_FALSE;
             }
-        }
-    }
 
-    // Cursors need to have their sticky positions refreshed.
-    drte_view_begin_dirty(pView);
-    {
-        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-            drte_view_move_cursor_to_character(pView, iCursor, drte_view_get_cursor_character(pView, iCursor));
+            size_t iFirstChild = iParent * DRTE_LINE_CACHE_BRANCH_CAPACITY;
+            size_t count = nodeCount - iFirstChild;
+            if (count > DRTE_LINE_CACHE_BRANCH_CAPACITY) {
+                count = DRTE_LINE_CACHE_BRANCH_CAPACITY;
+            }
+
+            for (size_t iChild = 0; iChild < count; ++iChild) {
+                pParent->data.branch.pChildren[iChild] = ppNodes[iFirstChild + iChild];
+                drte_line_cache__get_node_size(ppNodes[iFirstChild + iChild], &pParent->data.branch.lineCounts[iChild], &pParent->data.branch.charCounts[iChild]);
+            }
+            pParent->count = (drte_uint32)count;
+
+            ppNodes[iParent] = pParent;     // <-- Safe because iParent is always <= iFirstChild.
         }
 
-        drte_view__repaint(pView);
+        nodeCount = parentCount;
+        height += 1;
     }
-    drte_view_end_dirty(pView);
-}
 
+    drte_line_cache__free_node(pLineCache, pLineCache->pRoot);
+    pLineCache->pRoot = ppNodes[0];
+    pLineCache->height = height;
+    pLineCache->count = lineCount;
 
+    free(ppNodes);
+    return DRTE_TRUE;
+}
 
-drte_view* drte_view_create(drte_engine* pEngine)
-{
-    if (pEngine == NULL) {
-        return NULL;
-    }
+// Edits that add or remove more lines than this fraction of the total line count are done by rebuilding the tree.
+#define DRTE_LINE_CACHE_REBUILD_RATIO   8
 
-    drte_view* pView = (drte_view*)calloc(1, sizeof(*pView));
-    if (pView == NULL) {
-        return NULL;
-    }
+drte_bool32 drte_line_cache__should_rebuild(drte_line_cache* pLineCache, size_t lineCount)
+{
+    assert(pLineCache != NULL);
+    return lineCount > DRTE_LINE_CACHE_LEAF_CAPACITY && lineCount > pLineCache->count / DRTE_LINE_CACHE_REBUILD_RATIO;
+}
 
-    pView->pEngine = pEngine;
-    pView->tabSizeInSpaces = 4;
-    pView->cursorWidth = 1;
-    pView->scale = 1;
-    
-    pView->_id = drte_engine__acquire_view_id(pEngine);
-    pView->_accumulatedDirtyRect = drte_make_inside_out_rect();
-    pView->pWrappedLines = &pEngine->_unwrappedLines;
 
+drte_bool32 drte_line_cache_init(drte_line_cache* pLineCache)
+{
+    if (pLineCache == NULL) {
+        return DRTE_FALSE;
+    }
 
-    // Attach the view to the start of the list.
-    pView->_pPrevView = NULL;
-    pView->_pNextView = pEngine->pRootView;
+    memset(pLineCache, 0, sizeof(*pLineCache));
 
-    if (pEngine->pRootView != NULL) {
-        pEngine->pRootView->_pPrevView = pView;
+    pLineCache->pRoot = drte_line_cache__alloc_node(pLineCache, DRTE_TRUE);
+    if (pLineCache->pRoot == NULL) {
+        return DRTE_FALSE;
     }
 
-    pEngine->pRootView = pView;
-
+    // There's always at least one line, starting at the first character.
+    pLineCache->pRoot->data.lineOffsets[0] = 0;
+    pLineCache->pRoot->count = 1;
+    pLineCache->height = 1;
+    pLineCache->count = 1;
 
-    return pView;
+    return DRTE_TRUE;
 }
 
-void drte_view_delete(drte_view* pView)
+void drte_line_cache_uninit(drte_line_cache* pLineCache)
 {
-    if (pView == NULL) {
+    if (pLineCache == NULL) {
         return;
     }
 
-    // Remove the view from the list first.
-    if (pView->pEngine->pRootView == pView) {
-        pView->pEngine->pRootView = pView->_pNextView;
-    }
-    
-    if (pView->_pNextView != NULL) {
-        pView->_pNextView->_pPrevView = pView->_pPrevView;
+    drte_line_cache__free_node(pLineCache, pLineCache->pRoot);
+
+    while (pLineCache->pSpareNodes != NULL) {
+        drte_line_cache_node* pNext = pLineCache->pSpareNodes->data.branch.pChildren[0];
+        free(pLineCache->pSpareNodes);
+        pLineCache->pSpareNodes = pNext;
     }
-    if (pView->_pPrevView != NULL) {
-        pView->_pPrevView->_pNextView = pView->_pNextView;
+
+    // It's important to clear everything to zero in case this is called multiple times after each other which is abolutely possible.
+    memset(pLineCache, 0, sizeof(*pLineCache));
+}
+
+size_t drte_line_cache_get_line_count(drte_line_cache* pLineCache)
+{
+    if (pLineCache == NULL) {
+        return 0;
     }
 
-    drte_line_cache_uninit(&pView->_wrappedLines);
-    free(pView);
+    return pLineCache->count;
 }
 
 
-void drte_view_set_size(drte_view* pView, float sizeX, float sizeY)
+size_t drte_line_cache_get_line_first_character(drte_line_cache* pLineCache, size_t iLine)
 {
-    if (pView == NULL) {
-        return;
+    if (pLineCache == NULL || iLine >= pLineCache->count) {
+        return 0;
     }
 
-    drte_bool32 sizeXChanged = pView->sizeX != sizeX;
-    drte_bool32 sizeYChanged = pView->sizeY != sizeY;
-    if (!sizeXChanged && !sizeYChanged) {
-        return;
-    }
+    size_t iCharBeg = 0;
 
-    pView->sizeX = sizeX;
-    pView->sizeY = sizeY;
+    drte_line_cache_node* pNode = pLineCache->pRoot;
+    while (!pNode->isLeaf) {
+        drte_uint32 iChild = 0;
+        while (iLine >= pNode->data.branch.lineCounts[iChild]) {
+            iLine    -= pNode->data.branch.lineCounts[iChild];
+            iCharBeg += pNode->data.branch.charCounts[iChild];
+            iChild += 1;
+        }
 
-    if (sizeXChanged && drte_view_is_word_wrap_enabled(pView)) {
-        drte_view__refresh_word_wrapping(pView);
-    } else {
-        drte_view__repaint(pView);
+        pNode = pNode->data.branch.pChildren[iChild];
     }
-}
 
-void drte_view_get_size(drte_view* pView, float* pSizeXOut, float* pSizeYOut)
-{
-    if (pSizeXOut != NULL) *pSizeXOut = 0;
-    if (pSizeYOut != NULL) *pSizeYOut = 0;
-    if (pView == NULL) return;
+    for (size_t i = 0; i <= iLine; ++i) {
+        iCharBeg += pNode->data.lineOffsets[i];
+    }
 
-    if (pSizeXOut != NULL) *pSizeXOut = pView->sizeX;
-    if (pSizeYOut != NULL) *pSizeYOut = pView->sizeY;
+    return iCharBeg;
 }
 
-
-void drte_view_set_inner_offset(drte_view* pView, float innerOffsetX, float innerOffsetY)
+void drte_line_cache_set_line_first_character(drte_line_cache* pLineCache, size_t iLine, size_t iCharBeg)
 {
-    if (pView == NULL) {
+    if (pLineCache == NULL || iLine >= pLineCache->count) {
         return;
     }
 
-    pView->innerOffsetX = innerOffsetX;
-    pView->innerOffsetY = innerOffsetY;
+    // Moving a line means the line after it needs to be moved back by the same amount to stay where it is.
+    size_t amount = iCharBeg - drte_line_cache_get_line_first_character(pLineCache, iLine);
+    drte_line_cache__add_to_line_offset(pLineCache, iLine, amount);
 
-    drte_view__repaint(pView);
+    if (iLine+1 < pLineCache->count) {
+        drte_line_cache__add_to_line_offset(pLineCache, iLine+1, 0 - amount);
+    }
 }
 
-void drte_view_get_inner_offset(drte_view* pView, float* pInnerOffsetXOut, float* pInnerOffsetYOut)
+drte_bool32 drte_line_cache_insert_lines(drte_line_cache* pLineCache, size_t insertLineIndex, size_t lineCount, size_t characterOffset)
 {
-    if (pInnerOffsetXOut != NULL) *pInnerOffsetXOut = 0;
-    if (pInnerOffsetYOut != NULL) *pInnerOffsetYOut = 0;
-    if (pView == NULL) return;
-
-    if (pInnerOffsetXOut != NULL) *pInnerOffsetXOut = pView->innerOffsetX;
-    if (pInnerOffsetYOut != NULL) *pInnerOffsetYOut = pView->innerOffsetY;
-}
+    if (pLineCache == NULL || insertLineIndex > pLineCache->count) {
+        return DRTE_FALSE;
+    }
 
+    // New lines start at the same character as the line before them. They should be positioned properly afterwards with
+    // drte_line_cache_set_line_first_character().
+    for (size_t i = 0; i < lineCount; ++i) {
+        if (!drte_line_cache__insert_line(pLineCache, insertLineIndex + i, 0)) {
+            return DRTE_FALSE;
+        }
+    }
 
-void drte_view_set_tab_size(drte_view* pView, unsigned int sizeInSpaces)
-{
-    if (pView == NULL || pView->tabSizeInSpaces == sizeInSpaces) {
-        return;
+    // All existing lines coming after the inserted lines need to have their first character index updated.
+    if (insertLineIndex + lineCount < pLineCache->count) {
+        drte_line_cache__add_to_line_offset(pLineCache, insertLineIndex + lineCount, characterOffset);
     }
 
-    pView->tabSizeInSpaces = sizeInSpaces;
-    drte_view__refresh_word_wrapping(pView);
+    return DRTE_TRUE;
 }
 
-
-void drte_view_begin_dirty(drte_view* pView)
+drte_bool32 drte_line_cache_insert_lines_from_text(drte_line_cache* pLineCache, size_t insertLineIndex, size_t iCharBeg, const char* text, size_t textLength)
 {
-    if (pView == NULL) {
-        return;
+    if (pLineCache == NULL || insertLineIndex == 0 || insertLineIndex > pLineCache->count || text == NULL) {
+        return DRTE_FALSE;
     }
 
-    pView->_dirtyCounter += 1;
-}
+    size_t lineCount = drte__count_newlines(text, textLength);
+    if (lineCount == 0) {
+        if (insertLineIndex < pLineCache->count) {
+            drte_line_cache__add_to_line_offset(pLineCache, insertLineIndex, textLength);
+        }
 
-void drte_view_end_dirty(drte_view* pView)
-{
-    if (pView == NULL) {
-        return;
+        return DRTE_TRUE;
     }
 
-    assert(pView->_dirtyCounter > 0);
 
-    pView->_dirtyCounter -= 1;
+    size_t iPrevLineCharBeg = drte_line_cache_get_line_first_character(pLineCache, insertLineIndex-1);
 
-    if (pView->_dirtyCounter == 0) {
-        if (pView->pEngine->onDirty && drte_rect_has_volume(pView->_accumulatedDirtyRect)) {
-            pView->pEngine->onDirty(pView->pEngine, pView, pView->_accumulatedDirtyRect);
+    if (drte_line_cache__should_rebuild(pLineCache, lineCount)) {
+        size_t* pLineOffsets = (size_t*)malloc((pLineCache->count + lineCount) * sizeof(*pLineOffsets));
+        if (pLineOffsets == NULL) {
+            return DRTE_FALSE;
         }
 
-        pView->_accumulatedDirtyRect = drte_make_inside_out_rect();
-    }
-}
+        size_t oldLineCount = drte_line_cache__node_flatten(pLineCache->pRoot, pLineOffsets);
+        memmove(pLineOffsets + insertLineIndex + lineCount, pLineOffsets + insertLineIndex, (oldLineCount - insertLineIndex) * sizeof(*pLineOffsets));
 
-void drte_view_dirty(drte_view* pView, drte_rect rect)
-{
-    if (pView == NULL) {
-        return;
-    }
+        size_t iLine = insertLineIndex;
+        size_t iRunningCharBeg = iPrevLineCharBeg;
+        for (size_t iChar = drte__find_newline(text, textLength); iChar < textLength; iChar += 1 + drte__find_newline(text + iChar + 1, textLength - iChar - 1)) {
+            pLineOffsets[iLine++] = (iCharBeg + iChar + 1) - iRunningCharBeg;
+            iRunningCharBeg = iCharBeg + iChar + 1;
+        }
 
-    drte_view_begin_dirty(pView);
-    pView->_accumulatedDirtyRect = drte_rect_union(pView->_accumulatedDirtyRect, rect);
-    drte_view_end_dirty(pView);
-}
+        if (iLine < oldLineCount + lineCount) {
+            pLineOffsets[iLine] += textLength - (iRunningCharBeg - iPrevLineCharBeg);
+        }
 
-void drte_view_paint(drte_view* pView, drte_rect rect, void* pPaintData)
-{
-    if (pView == NULL || pView->pEngine->onPaintText == NULL || pView->pEngine->onPaintRect == NULL) {
-        return;
-    }
+        drte_bool32 result = drte_line_cache__rebuild(pLineCache, pLineOffsets, oldLineCount + lineCount);
+        free(pLineOffsets);
 
-    if (rect.left < 0) {
-        rect.left = 0;
-    }
-    if (rect.top < 0) {
-        rect.top = 0;
-    }
-    if (rect.right > pView->sizeX) {
-        rect.right = pView->sizeX;
+        return result;
     }
-    if (rect.bottom > pView->sizeY) {
-        rect.bottom = pView->sizeY;
+
+
+    size_t iLine = insertLineIndex;
+    size_t iRunningCharBeg = iPrevLineCharBeg;
+    for (size_t iChar = drte__find_newline(text, textLength); iChar < textLength; iChar += 1 + drte__find_newline(text + iChar + 1, textLength - iChar - 1)) {
+        if (!drte_line_cache__insert_line(pLineCache, iLine++, (iCharBeg + iChar + 1) - iRunningCharBeg)) {
+            return DRTE_FALSE;
+        }
+
+        iRunningCharBeg = iCharBeg + iChar + 1;
     }
 
-    if (rect.right <= rect.left || rect.bottom <= rect.top) {
-        return;
+    // The line that was previously after the insertion point is now relative to the last of the new lines.
+    if (iLine < pLineCache->count) {
+        drte_line_cache__add_to_line_offset(pLineCache, iLine, textLength - (iRunningCharBeg - iPrevLineCharBeg));
     }
 
-    float lineHeight = drte_engine_get_line_height(pView->pEngine);
+    return DRTE_TRUE;
+}
 
+drte_bool32 drte_line_cache_append_line(drte_line_cache* pLineCache, size_t iLineCharBeg)
+{
+    if (pLineCache == NULL) {
+        return DRTE_FALSE;
+    }
 
-    size_t iLineTop;
-    size_t iLineBottom;
-    drte_view_get_visible_lines(pView, &iLineTop, &iLineBottom);
+    size_t lineCount = drte_line_cache_get_line_count(pLineCache);
 
-    float linePosX = pView->innerOffsetX;
-    float linePosY = 0;
+    size_t iLastLineCharBeg;
+    drte_line_cache__get_node_size(pLineCache->pRoot, NULL, &iLastLineCharBeg);
 
-    drte_segment segment;
-    if (drte_engine__first_segment_on_line(pView, pView->pWrappedLines, iLineTop, (size_t)-1, &segment)) {
-        size_t iLine = iLineTop;
-        while (iLine <= iLineBottom) {
-            float lineWidth = 0;
+    return drte_line_cache__insert_line(pLineCache, lineCount, iLineCharBeg - iLastLineCharBeg);
+}
 
-            do
-            {
-                if (linePosX + segment.posX > pView->sizeX) {
-                    // All remaining segments on this line (including this one) is clipped. Go to the next line.
-                    segment.iCharBeg = segment.iLineCharEnd;
-                    segment.iCharEnd = segment.iLineCharEnd;
-                    segment.isAtEndOfLine = DRTE_TRUE;
-                    break;
-                }
+// Appends lines to the end of the cache. The first character of each line is pLineCharBegs[i] + characterOffset. Lines must be in
+// increasing order and come after the start of the current last line.
+drte_bool32 drte_line_cache_append_lines(drte_line_cache* pLineCache, const size_t* pLineCharBegs, size_t lineCount, size_t characterOffset)
+{
+    if (pLineCache == NULL || (pLineCharBegs == NULL && lineCount > 0)) {
+        return DRTE_FALSE;
+    }
 
-                lineWidth += segment.width;
+    if (lineCount == 0) {
+        return DRTE_TRUE;
+    }
 
-                // Don't draw segments to the left of the container.
-                if (linePosX + segment.posX + segment.width < 0) {
-                    if (segment.iCharBeg == segment.iLineCharEnd) {
-                        break;
-                    }
-                    continue;
-                }
+    size_t iRunningCharBeg;
+    drte_line_cache__get_node_size(pLineCache->pRoot, NULL, &iRunningCharBeg);
 
-                uint32_t c = drte_engine_get_utf32(pView->pEngine, segment.iCharBeg);
-                if (c == '\t' || segment.iCharBeg == segment.iLineCharEnd) {
-                    // It's whitespace.
-                    if (segment.iCharBeg == segment.iLineCharEnd) {
-                        // TODO: Only do this if the character is selected.
-                        uint32_t cend = drte_engine_get_utf32(pView->pEngine, segment.iCharBeg);
-                        if (cend == '\r' || cend == '\n') {
-                            segment.width = pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth;
-                            lineWidth += segment.width;
-                        }
-                    }
+    if (drte_line_cache__should_rebuild(pLineCache, lineCount)) {
+        size_t* pLineOffsets = (size_t*)malloc((pLineCache->count + lineCount) * sizeof(*pLineOffsets));
+        if (pLineOffsets == NULL) {
+            return DRTE_FALSE;
+        }
 
-                    drte_style_token bgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.bgStyleSlot);
-                    if (pView->pEngine->onPaintRect && bgStyleToken != 0) {
-                        pView->pEngine->onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(linePosX + segment.posX, linePosY, linePosX + segment.posX + segment.width, linePosY + lineHeight), pPaintData);
-                    }
-                } else {
-                    // It's normal text.
-                    // TODO: Gather the text and properly support UTF-8.
-                    const char* text = pView->pEngine->text + segment.iCharBeg;
-                    size_t textLength = segment.iCharEnd - segment.iCharBeg;
+        size_t oldLineCount = drte_line_cache__node_flatten(pLineCache->pRoot, pLineOffsets);
+        for (size_t i = 0; i < lineCount; ++i) {
+            pLineOffsets[oldLineCount + i] = (pLineCharBegs[i] + characterOffset) - iRunningCharBeg;
+            iRunningCharBeg = pLineCharBegs[i] + characterOffset;
+        }
 
-                    // TODO: Draw text on the base line to properly handle font's of differing sizes.
+        drte_bool32 result = drte_line_cache__rebuild(pLineCache, pLineOffsets, oldLineCount + lineCount);
+        free(pLineOffsets);
 
-                    drte_style_token fgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot);
-                    drte_style_token bgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.bgStyleSlot);
-                    if (pView->pEngine->onPaintText && fgStyleToken != 0 && bgStyleToken != 0) {
-                        pView->pEngine->onPaintText(pView->pEngine, pView, fgStyleToken, bgStyleToken, text, textLength, linePosX + segment.posX, linePosY, pPaintData);
-                    }
-                }
+        return result;
+    }
 
-                if (segment.iCharBeg == segment.iLineCharEnd) {
-                    break;
-                }
-            } while (drte_engine__next_segment(pView, &segment));
+    for (size_t i = 0; i < lineCount; ++i) {
+        if (!drte_line_cache__insert_line(pLineCache, pLineCache->count, (pLineCharBegs[i] + characterOffset) - iRunningCharBeg)) {
+            return DRTE_FALSE;
+        }
 
+        iRunningCharBeg = pLineCharBegs[i] + characterOffset;
+    }
 
-            // The part after the end of the line needs to be drawn.
-            float lineRight = linePosX + lineWidth;
-            if (lineRight < pView->sizeX) {
-                drte_style_token bgStyleToken = pView->pEngine->styles[pView->pEngine->defaultStyleSlot].styleToken;
-                if (pView->cursorCount > 0 && segment.iLine == drte_view_get_cursor_line(pView, pView->cursorCount-1)) {
-                    bgStyleToken = pView->pEngine->styles[pView->pEngine->activeLineStyleSlot].styleToken;
-                }
+    return DRTE_TRUE;
+}
 
-                if (pView->pEngine->onPaintRect && bgStyleToken != 0) {
-                    pView->pEngine->onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(lineRight, linePosY, pView->sizeX, linePosY + lineHeight), pPaintData);
-                }
-            }
+drte_bool32 drte_line_cache_remove_lines(drte_line_cache* pLineCache, size_t firstLineIndex, size_t lineCount, size_t characterOffset)
+{
+    if (pLineCache == NULL || firstLineIndex >= pLineCache->count) {
+        return DRTE_FALSE;
+    }
 
-            linePosY += lineHeight;
+    if (pLineCache->count <= lineCount) {
+        // Everything except the first line is being removed.
+        size_t firstLineOffset = 0;
+        return drte_line_cache__rebuild(pLineCache, &firstLineOffset, 1);
+    }
 
+    if (lineCount > pLineCache->count - firstLineIndex) {
+        lineCount = pLineCache->count - firstLineIndex;
+    }
 
-            // Go to the first segment of the next line.
-            if (!drte_engine__next_segment(pView, &segment)) {
-                break;
-            }
+    // The offsets of the removed lines are accumulated so the line that ends up taking their place can be made relative to the
+    // line before the removed range.
+    size_t removedCharCount = 0;
 
-            iLine += 1;
-        }
-    } else {
-        // Couldn't create a segment iterator. Likely means there is no text. Just draw a single blank line.
-        drte_style_token bgStyleToken = pView->pEngine->styles[pView->pEngine->activeLineStyleSlot].styleToken;
-        if (pView->pEngine->onPaintRect && bgStyleToken != 0) {
-            pView->pEngine->onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(linePosX, linePosY, pView->sizeX, linePosY + lineHeight), pPaintData);
+    if (drte_line_cache__should_rebuild(pLineCache, lineCount)) {
+        size_t* pLineOffsets = (size_t*)malloc(pLineCache->count * sizeof(*pLineOffsets));
+        if (pLineOffsets == NULL) {
+            return DRTE_FALSE;
         }
-    }
 
+        size_t oldLineCount = drte_line_cache__node_flatten(pLineCache->pRoot, pLineOffsets);
+        for (size_t iLine = firstLineIndex; iLine < firstLineIndex + lineCount; ++iLine) {
+            removedCharCount += pLineOffsets[iLine];
+        }
 
-    // Cursors.
-    if (drte_view_is_showing_cursors(pView) && pView->pEngine->isCursorBlinkOn && pView->pEngine->styles[pView->pEngine->cursorStyleSlot].styleToken != 0) {
-        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-            pView->pEngine->onPaintRect(pView->pEngine, pView, pView->pEngine->styles[pView->pEngine->cursorStyleSlot].styleToken, drte_view_get_cursor_rect(pView, iCursor), pPaintData);
+        memmove(pLineOffsets + firstLineIndex, pLineOffsets + firstLineIndex + lineCount, (oldLineCount - firstLineIndex - lineCount) * sizeof(*pLineOffsets));
+        if (firstLineIndex < oldLineCount - lineCount) {
+            pLineOffsets[firstLineIndex] += removedCharCount - characterOffset;
         }
+
+        drte_bool32 result = drte_line_cache__rebuild(pLineCache, pLineOffsets, oldLineCount - lineCount);
+        free(pLineOffsets);
+
+        return result;
     }
 
+    for (size_t i = 0; i < lineCount; ++i) {
+        removedCharCount += drte_line_cache__remove_line(pLineCache, firstLineIndex);
+    }
 
-    // The rectangle region below the last line.
-    if (linePosY < pView->sizeY && pView->pEngine->styles[pView->pEngine->defaultStyleSlot].styleToken != 0) {
-        // TODO: Only draw the intersection of the bottom rectangle with the invalid rectangle.
-        drte_rect tailRect;
-        tailRect.left = 0;
-        tailRect.top = (iLineBottom + 1) * drte_engine_get_line_height(pView->pEngine) + pView->innerOffsetY;
-        tailRect.right = pView->sizeX;
-        tailRect.bottom = pView->sizeY;
-        pView->pEngine->onPaintRect(pView->pEngine, pView, pView->pEngine->styles[pView->pEngine->defaultStyleSlot].styleToken, tailRect, pPaintData);
+    if (firstLineIndex < pLineCache->count) {
+        drte_line_cache__add_to_line_offset(pLineCache, firstLineIndex, removedCharCount - characterOffset);
     }
+
+    return DRTE_TRUE;
 }
 
-void drte_view_paint_line_numbers(drte_view* pView, float lineNumbersWidth, float lineNumbersHeight, drte_engine_on_paint_text_proc onPaintText, drte_engine_on_paint_rect_proc onPaintRect, void* pPaintData)
+// Replaces oldLineCount lines starting at firstLineIndex with newLineCount lines whose first characters are given in pLineCharBegs. The
+// line after the replaced range, if any, is moved so that it starts at nextLineCharBeg. Line 0 must always start at character 0.
+drte_bool32 drte_line_cache_replace_lines(drte_line_cache* pLineCache, size_t firstLineIndex, size_t oldLineCount, const size_t* pLineCharBegs, size_t newLineCount, size_t nextLineCharBeg)
 {
-    if (pView == NULL || onPaintText == NULL || onPaintRect == NULL) {
-        return;
+    if (pLineCache == NULL || firstLineIndex >= pLineCache->count || newLineCount == 0 || pLineCharBegs == NULL) {
+        return DRTE_FALSE;
     }
 
-    float lineHeight = drte_engine_get_line_height(pView->pEngine);
-
-    size_t iLineTop;
-    size_t iLineBottom;
-    drte_view_get_visible_lines(pView, &iLineTop, &iLineBottom);
+    if (oldLineCount > pLineCache->count - firstLineIndex) {
+        oldLineCount = pLineCache->count - firstLineIndex;
+    }
 
-    drte_style_token fgStyleToken = pView->pEngine->styles[pView->pEngine->lineNumbersStyleSlot].styleToken;
-    drte_style_token bgStyleToken = pView->pEngine->styles[pView->pEngine->lineNumbersStyleSlot].styleToken;
+    size_t iRunningCharBeg = 0;
+    if (firstLineIndex > 0) {
+        iRunningCharBeg = drte_line_cache_get_line_first_character(pLineCache, firstLineIndex-1);
+    }
 
-    size_t lineNumber = iLineTop;
+    if (drte_line_cache__should_rebuild(pLineCache, (oldLineCount > newLineCount) ? oldLineCount : newLineCount)) {
+        size_t newCount = pLineCache->count - oldLineCount + newLineCount;
+        size_t* pLineOffsets = (size_t*)malloc(((newCount > pLineCache->count) ? newCount : pLineCache->count) * sizeof(*pLineOffsets));
+        if (pLineOffsets == NULL) {
+            return DRTE_FALSE;
+        }
 
-    float lineTop = pView->innerOffsetY + (iLineTop * lineHeight);
-    for (size_t iLine = iLineTop; iLine <= iLineBottom; ++iLine) {
-        float lineBottom = lineTop + lineHeight;
-        drte_bool32 drawLineNumber = DRTE_FALSE;
+        size_t oldCount = drte_line_cache__node_flatten(pLineCache->pRoot, pLineOffsets);
+        memmove(pLineOffsets + firstLineIndex + newLineCount, pLineOffsets + firstLineIndex + oldLineCount, (oldCount - firstLineIndex - oldLineCount) * sizeof(*pLineOffsets));
 
-        size_t iLineCharBeg;
-        size_t iLineCharEnd;
-        drte_view_get_line_character_range(pView, pView->pWrappedLines, iLine, &iLineCharBeg, &iLineCharEnd);
-        if (iLine == 0 || pView->pEngine->text[iLineCharBeg-1] == '\n') {
-            lineNumber += 1;
-            drawLineNumber = DRTE_TRUE;
+        for (size_t i = 0; i < newLineCount; ++i) {
+            pLineOffsets[firstLineIndex + i] = pLineCharBegs[i] - iRunningCharBeg;
+            iRunningCharBeg = pLineCharBegs[i];
         }
 
-        if (drawLineNumber) {
-            char iLineStr[64];
-            snprintf(iLineStr, sizeof(iLineStr), "%d", (int)lineNumber);   // TODO: drte_string_to_int(). This snprintf() has shown up in profiling so best fix this.
+        if (firstLineIndex + newLineCount < newCount) {
+            pLineOffsets[firstLineIndex + newLineCount] = nextLineCharBeg - iRunningCharBeg;
+        }
 
-            dtk_int32 textWidth = 0;
-            dtk_int32 textHeight = 0;
-            if (pView->pEngine->onMeasureString && fgStyleToken) {
-                pView->pEngine->onMeasureString(pView->pEngine, fgStyleToken, pView->scale, iLineStr, strlen(iLineStr), &textWidth, &textHeight);
-            }
+        drte_bool32 result = drte_line_cache__rebuild(pLineCache, pLineOffsets, newCount);
+        free(pLineOffsets);
 
-            float textLeft = lineNumbersWidth - textWidth;
-            float textTop  = lineTop + (lineHeight - textHeight) / 2;
+        return result;
+    }
 
-            if (fgStyleToken != 0 && bgStyleToken != 0) {
-                onPaintText(pView->pEngine, pView, fgStyleToken, bgStyleToken, iLineStr, strlen(iLineStr), textLeft, textTop, pPaintData);
-                onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(0, lineTop, textLeft, lineBottom), pPaintData);
 
-                // There could be a region above and below the text. This will happen if the line height of the line numbers is
-                // smaller than the main line height.
-                if (textHeight < lineHeight) {
-                    onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(textLeft, lineTop, lineNumbersWidth, textTop), pPaintData);
-                    onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(textLeft, textTop + textHeight, lineNumbersWidth, lineBottom), pPaintData);
-                }
-            }
-        } else {
-            if (fgStyleToken != 0 && bgStyleToken != 0) {
-                onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(0, lineTop, lineNumbersWidth, lineBottom), pPaintData);
-            }
+    // The new lines are inserted before the old ones are removed so the cache is never left empty.
+    for (size_t i = 0; i < newLineCount; ++i) {
+        if (!drte_line_cache__insert_line(pLineCache, firstLineIndex + i, pLineCharBegs[i] - iRunningCharBeg)) {
+            return DRTE_FALSE;
         }
 
-        lineTop = lineBottom;
+        iRunningCharBeg = pLineCharBegs[i];
     }
 
-    // The region below the lines.
-    if (lineTop < pView->sizeY && bgStyleToken != 0) {
-        onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(0, lineTop, lineNumbersWidth, lineNumbersHeight), pPaintData);
+    for (size_t i = 0; i < oldLineCount; ++i) {
+        drte_line_cache__remove_line(pLineCache, firstLineIndex + newLineCount);
     }
-}
-
 
-drte_rect drte_view_get_local_rect(drte_view* pView)
-{
-    if (pView == NULL) {
-        return drte_make_rect(0, 0, 0, 0);
+    size_t iNextLine = firstLineIndex + newLineCount;
+    if (iNextLine < pLineCache->count) {
+        drte_line_cache__add_to_line_offset(pLineCache, iNextLine, nextLineCharBeg - drte_line_cache_get_line_first_character(pLineCache, iNextLine));
     }
 
-    return drte_make_rect(0, 0, pView->sizeX, pView->sizeY);
+    return DRTE_TRUE;
 }
 
+drte_bool32 drte_line_cache_offset_lines(drte_line_cache* pLineCache, size_t firstLineIndex, size_t characterOffset)
+{
+    if (pLineCache == NULL || firstLineIndex >= pLineCache->count) {
+        return DRTE_FALSE;
+    }
+
+    // Lines are stored relative to each other so only the first line needs to be moved.
+    drte_line_cache__add_to_line_offset(pLineCache, firstLineIndex, characterOffset);
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_line_cache_offset_lines_negative(drte_line_cache* pLineCache, size_t firstLineIndex, size_t characterOffset)
+{
+    if (pLineCache == NULL || firstLineIndex >= pLineCache->count) {
+        return DRTE_FALSE;
+    }
+
+    drte_line_cache__add_to_line_offset(pLineCache, firstLineIndex, 0 - characterOffset);
+    return DRTE_TRUE;
+}
+
+
+size_t drte_line_cache_find_line_by_character(drte_line_cache* pLineCache, size_t iChar)
+{
+    if (pLineCache == NULL || pLineCache->count <= 1) {
+        return 0;
+    }
+
+    // We're looking for the first line that starts after the character. The line we want is the one before it.
+    size_t iLine = 0;
+    size_t iCharBeg = 0;
+
+    drte_line_cache_node* pNode = pLineCache->pRoot;
+    while (!pNode->isLeaf) {
+        drte_uint32 iChild = 0;
+        while (iChild < pNode->count && iCharBeg + pNode->data.branch.charCounts[iChild] <= iChar) {
+            iLine    += pNode->data.branch.lineCounts[iChild];
+            iCharBeg += pNode->data.branch.charCounts[iChild];
+            iChild += 1;
+        }
+
+        if (iChild == pNode->count) {
+            return pLineCache->count-1;     // The character is on the last line.
+        }
+
+        pNode = pNode->data.branch.pChildren[iChild];
+    }
+
+    for (drte_uint32 i = 0; i < pNode->count; ++i) {
+        iCharBeg += pNode->data.lineOffsets[i];
+        if (iCharBeg > iChar) {
+            return (iLine + i > 0) ? iLine + i - 1 : 0;
+        }
+    }
+
+    return iLine + pNode->count - 1;
+}
+
+void drte_line_cache_clear(drte_line_cache* pLineCache)
+{
+    if (pLineCache == NULL) {
+        return;
+    }
+
+    drte_line_cache__rebuild(pLineCache, NULL, 0);
+}
+
+
+
+// A drte_segment object is used for iterating over the segments of a chunk of text.
+typedef struct
+{
+    drte_line_cache* pLineCache;
+    size_t iLine;
+    size_t iLineCharBeg;
+    size_t iLineCharEnd;
+    size_t iCursorLine;
+    size_t iCharBeg;
+    size_t iCharEnd;
+    uint8_t fgStyleSlot;
+    uint8_t bgStyleSlot;
+    float posX;
+    float width;
+    drte_bool32 isAtEnd;
+    drte_bool32 isAtEndOfLine;
+} drte_segment;
+
+float drte_engine__measure_segment(drte_view* pView, drte_segment* pSegment)
+{
+    assert(pView != NULL);
+    assert(pSegment != NULL);
+
+    drte_engine* pEngine = pView->pEngine;
+    assert(pEngine != NULL);
+
+
+    dtk_int32 segmentWidth = 0;
+    if (pSegment->iCharEnd > pSegment->iCharBeg) {
+        uint32_t c = drte_engine_get_utf32(pEngine, pSegment->iCharBeg);
+        if (c == '\t') {
+            // It was a tab segment.
+            float tabWidth = drte_view__get_tab_width_in_pixels(pView);
+            size_t tabCount = pSegment->iCharEnd - pSegment->iCharBeg;
+            float nextTabPos = (float)((int)(pSegment->posX / tabWidth) + 1) * tabWidth;
+            float distanceToNextTab = nextTabPos - pSegment->posX;
+            segmentWidth = (dtk_int32)(distanceToNextTab + ((tabCount-1) * tabWidth));
+        } else if (pSegment->iCharBeg == pSegment->iLineCharEnd) {
+            segmentWidth = 0;
+        } else {
+            // It's normal text. We need to refer to the backend for measuring, but the same segments tend to be measured over and over
+            // again by layout queries so recently measured ones are remembered.
+            drte_measured_segment* pMeasured = &pView->_measuredSegments[(pSegment->iCharBeg*31 + pSegment->iCharEnd + pSegment->fgStyleSlot) & (DRTE_MEASURED_SEGMENT_CACHE_SIZE-1)];
+            if (pMeasured->iCharBeg == pSegment->iCharBeg && pMeasured->iCharEnd == pSegment->iCharEnd && pMeasured->fgStyleSlot == pSegment->fgStyleSlot && pMeasured->scale == pView->scale) {
+                return pMeasured->width;
+            }
+
+            dtk_int32 unused;
+            drte_style_token fgStyleToken = drte_engine__get_style_token(pEngine, pSegment->fgStyleSlot);
+            if (pEngine->onMeasureString && fgStyleToken) {
+                pEngine->onMeasureString(pEngine, fgStyleToken, pView->scale, drte_engine__get_text_range(pEngine, pSegment->iCharBeg, pSegment->iCharEnd), pSegment->iCharEnd - pSegment->iCharBeg, &segmentWidth, &unused);
+            }
+
+            pMeasured->iCharBeg = pSegment->iCharBeg;
+            pMeasured->iCharEnd = pSegment->iCharEnd;
+            pMeasured->fgStyleSlot = pSegment->fgStyleSlot;
+            pMeasured->scale = pView->scale;
+            pMeasured->width = (float)segmentWidth;
+        }
+    }
+
+    return (float)segmentWidth;
+}
+
+// Retrieves the first checkpoint of a line after the given character. Checkpoints are every DRTE_LINE_CHECKPOINT_INTERVAL characters from
+// the start of the line, moved forward so they don't split a UTF-8 sequence. There are none left when the return value is at or past
+// the end of the line.
+static size_t drte_engine__next_line_checkpoint(drte_engine* pEngine, size_t iLineCharBeg, size_t iLineCharEnd, size_t iChar)
+{
+    assert(pEngine != NULL);
+    assert(iChar >= iLineCharBeg);
+
+    size_t iCheckpoint = iLineCharBeg + ((iChar - iLineCharBeg) / DRTE_LINE_CHECKPOINT_INTERVAL + 1) * DRTE_LINE_CHECKPOINT_INTERVAL;
+    while (iCheckpoint < iLineCharEnd && ((unsigned char)drte_engine__get_char(pEngine, iCheckpoint) & 0xC0) == 0x80) {
+        iCheckpoint += 1;
+    }
+
+    return iCheckpoint;
+}
+
+drte_bool32 drte_engine__next_segment(drte_view* pView, drte_segment* pSegment)
+{
+    assert(pView != NULL);
+    assert(pSegment != NULL);
+
+    drte_engine* pEngine = pView->pEngine;
+    assert(pEngine != NULL);
+
+    // TODO: Handle UTF-8 properly.
+    // TODO: There is LOTS of optimization opportunity in this function.
+
+    // The next segment is clamped to a specific character with the following priorities, from highest priority to lowest
+    // - The end of the text
+    // - The end of the line
+    // - Tab boundaries
+    // - Selection boundaries
+    // - Highlight boundaries
+    //
+    // If the next character begins in the middle of a segment, it will be clamped against said segment.
+
+
+    if (pSegment->isAtEnd) {
+        return DRTE_FALSE;
+    }
+
+    if (pSegment->isAtEndOfLine) {
+        pSegment->iLine += 1;
+        pSegment->posX = 0;
+        pSegment->width = 0;
+        pSegment->isAtEndOfLine = DRTE_FALSE;
+        drte_view_get_line_character_range(pView, pSegment->pLineCache, pSegment->iLine, &pSegment->iLineCharBeg, &pSegment->iLineCharEnd);
+
+        pSegment->iCharEnd = pSegment->iLineCharBeg;
+    }
+
+    uint8_t fgStyleSlot = pEngine->defaultStyleSlot;
+    uint8_t bgStyleSlot = pEngine->defaultStyleSlot;
+
+    // Find the end of the next segment, but don't modify the segment yet. The reason for this is that we need to measure the segment later.
+    size_t iCharBeg = pSegment->iCharEnd;
+    size_t iCharEnd = iCharBeg;
+
+    if (pView->cursorCount > 0 && pSegment->iLine == pSegment->iCursorLine) {
+        bgStyleSlot = pEngine->activeLineStyleSlot;
+    }
+
+
+    drte_bool32 isAnythingSelected = DRTE_FALSE;
+    drte_bool32 isInSelection = DRTE_FALSE;
+    drte_region selection = drte_make_region(0, 0);
+    if (drte_view__get_next_selection_from_character(pView, iCharBeg, &selection)) {
+        isInSelection = iCharBeg >= selection.iCharBeg && iCharBeg < selection.iCharEnd;
+        isAnythingSelected = DRTE_TRUE;
+    }
+
+    if (isInSelection) {
+        bgStyleSlot = pEngine->selectionStyleSlot;
+    }
+
+
+    // Matches are drawn underneath selections.
+    drte_bool32 isAnythingMatched = DRTE_FALSE;
+    drte_bool32 isInMatch = DRTE_FALSE;
+    drte_region match = drte_make_region(0, 0);
+    if (pEngine->matchStyleSlot != DRTE_INVALID_STYLE_SLOT && drte_view__get_next_match_from_character(pView, iCharBeg, &match)) {
+        isInMatch = iCharBeg >= match.iCharBeg && iCharBeg < match.iCharEnd;
+        isAnythingMatched = DRTE_TRUE;
+    }
+
+    if (isInMatch && !isInSelection) {
+        bgStyleSlot = pEngine->matchStyleSlot;
+    }
+
+
+
+    // Highlight segment.
+    drte_style_segment highlightSegment;
+    drte_style_token highlightStyleToken;
+    drte_bool32 isInHighlightSegment = DRTE_FALSE;
+    if (pEngine->onLexLine && drte_engine__get_next_lexer_token(pEngine, iCharBeg, &highlightSegment.iCharBeg, &highlightSegment.iCharEnd, &highlightStyleToken)) {
+        isInHighlightSegment = iCharBeg >= highlightSegment.iCharBeg && iCharBeg < highlightSegment.iCharEnd;
+    } else {
+        highlightSegment.iCharBeg = (size_t)-1;
+        highlightSegment.iCharEnd = (size_t)-1;
+        highlightStyleToken = drte_engine__get_style_token(pEngine, pEngine->defaultStyleSlot);
+    }
+
+
+
+    size_t iMaxChar = (size_t)-1;
+
+    // Clamp to selection.
+    if (isInSelection) {
+        iMaxChar = selection.iCharEnd;
+    } else if (isAnythingSelected) {
+        if (selection.iCharBeg > iCharBeg) {
+            iMaxChar = selection.iCharBeg;
+        }
+    }
+
+    // Clamp to match.
+    if (isInMatch) {
+        iMaxChar = drte_min(iMaxChar, match.iCharEnd);
+    } else if (isAnythingMatched) {
+        iMaxChar = drte_min(iMaxChar, match.iCharBeg);
+    }
+
+    // Clamp to highlight segment. Tokens with an unregistered style are drawn with the default style.
+    if (isInHighlightSegment) {
+        uint8_t highlightStyleSlot = drte_engine__get_style_slot(pEngine, highlightStyleToken);
+        if (highlightStyleSlot != DRTE_INVALID_STYLE_SLOT) {
+            fgStyleSlot = highlightStyleSlot;
+        }
+
+        iMaxChar = drte_min(iMaxChar, highlightSegment.iCharEnd);
+    } else {
+        iMaxChar = drte_min(iMaxChar, highlightSegment.iCharBeg);
+    }
+
+    // Clamp to the next checkpoint so segment boundaries on long lines are the same no matter where iteration was started from.
+    iMaxChar = drte_min(iMaxChar, drte_engine__next_line_checkpoint(pEngine, pSegment->iLineCharBeg, pSegment->iLineCharEnd, iCharBeg));
+
+
+
+    char c = drte_engine__get_char(pEngine, iCharBeg);
+    if (c == '\0') {
+        pSegment->isAtEnd = DRTE_TRUE;
+    } else {
+        if (iCharBeg == pSegment->iLineCharEnd) {
+            pSegment->isAtEndOfLine = DRTE_TRUE;
+            iCharEnd += 1;
+        } else {
+            for (;;) {
+                c = drte_engine__get_char(pEngine, iCharEnd);
+                if (c == '\0' || iCharEnd == pSegment->iLineCharEnd) {
+                    break;
+                }
+
+                if (c == '\t') {
+                    if (drte_engine__get_char(pEngine, iCharBeg) != '\t') {
+                        break;
+                    } else {
+                        // Group tabs into a single segment.
+                        for (;;) {
+                            c = drte_engine__get_char(pEngine, iCharEnd);
+                            if (c == '\0' || iCharEnd == pSegment->iLineCharEnd || c != '\t') {
+                                break;
+                            }
+
+                            if (iCharEnd == iMaxChar) {
+                                break;
+                            }
+
+                            iCharEnd += 1;
+                        }
+
+                        break;
+                    }
+                }
+
+
+                // Selection and styling segment clamp.
+                if (iCharEnd == iMaxChar) {
+                    break;
+                }
+
+                iCharEnd += 1;
+            }
+        }
+    }
+
+    if (iCharBeg == iCharEnd) {
+        assert(pSegment->isAtEnd == DRTE_TRUE);
+        iCharEnd += 1;
+    }
+
+
+    // We now have everything we need to construct the next segment iterator.
+    pSegment->iCharBeg = iCharBeg;
+    pSegment->iCharEnd = iCharEnd;
+    pSegment->fgStyleSlot = fgStyleSlot;
+    pSegment->bgStyleSlot = bgStyleSlot;
+    pSegment->posX += pSegment->width;
+    pSegment->width = drte_engine__measure_segment(pView, pSegment);
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine__next_segment_on_line(drte_view* pView, drte_segment* pSegment)
+{
+    assert(pView != NULL);
+    assert(pSegment != NULL);
+
+    if (pSegment->isAtEndOfLine) {
+        return DRTE_FALSE;
+    }
+
+    return drte_engine__next_segment(pView, pSegment);
+}
+
+drte_bool32 drte_engine__first_segment(drte_view* pView, drte_line_cache* pLineCache, size_t iChar, drte_segment* pSegment)
+{
+    if (pView == NULL || pSegment == NULL) {
+        return DRTE_FALSE;
+    }
+
+    drte_engine* pEngine = pView->pEngine;
+    if (pEngine == NULL || pEngine->textLength == 0) {
+        return DRTE_FALSE;
+    }
+
+
+    if (pLineCache == pEngine->pUnwrappedLines && !drte_engine__index_lines_to_character(pEngine, iChar)) {
+        return DRTE_FALSE;
+    }
+
+    pSegment->pLineCache = pLineCache;
+    pSegment->iLine = drte_line_cache_find_line_by_character(pLineCache, iChar);
+    pSegment->iCursorLine = drte_view_get_cursor_line(pView, pView->cursorCount-1);
+    pSegment->iCharBeg = iChar;
+    pSegment->iCharEnd = pSegment->iCharBeg;
+    pSegment->fgStyleSlot = pEngine->defaultStyleSlot;
+    pSegment->bgStyleSlot = pEngine->defaultStyleSlot;
+    pSegment->posX = 0;
+    pSegment->width = 0;
+    pSegment->isAtEnd = DRTE_FALSE;
+    pSegment->isAtEndOfLine = DRTE_FALSE;
+    drte_view_get_line_character_range(pView, pSegment->pLineCache, pSegment->iLine, &pSegment->iLineCharBeg, &pSegment->iLineCharEnd);
+
+    return drte_engine__next_segment(pView, pSegment);
+}
+
+drte_bool32 drte_engine__first_segment_on_line(drte_view* pView, drte_line_cache* pLineCache, size_t lineIndex, size_t iChar, drte_segment* pSegment)
+{
+    if (pView == NULL || pSegment == NULL) {
+        return DRTE_FALSE;
+    }
+
+    drte_engine* pEngine = pView->pEngine;
+    if (pEngine == NULL || pEngine->textLength == 0) {
+        return DRTE_FALSE;
+    }
+
+
+    pSegment->pLineCache = pLineCache;
+    pSegment->iLine = lineIndex;
+    pSegment->iCursorLine = drte_view_get_cursor_line(pView, pView->cursorCount-1);
+    pSegment->iCharBeg = iChar;
+    pSegment->iCharEnd = iChar;
+    pSegment->fgStyleSlot = pEngine->defaultStyleSlot;
+    pSegment->bgStyleSlot = pEngine->defaultStyleSlot;
+    pSegment->posX = 0;
+    pSegment->width = 0;
+    pSegment->isAtEnd = DRTE_FALSE;
+    pSegment->isAtEndOfLine = DRTE_FALSE;
+
+    if (iChar == (size_t)-1) {
+        pSegment->iCharBeg = drte_view_get_line_first_character(pView, pLineCache, lineIndex);
+        pSegment->iCharEnd = pSegment->iCharBeg;
+    }
+
+    pSegment->iLineCharBeg = pSegment->iCharBeg;
+    pSegment->iLineCharEnd = drte_view_get_line_last_character(pView, pLineCache, lineIndex);
+
+    return drte_engine__next_segment(pView, pSegment);
+}
+
+
+
+// Word iteration.
+typedef struct
+{
+    size_t iCharRangeBeg;
+    size_t iCharRangeEnd;
+    size_t iCharBeg;
+    size_t iCharEnd;
+    drte_bool32 isAtEnd;
+} drte_word_iterator;
+
+drte_bool32 drte_engine__next_word(drte_engine* pEngine, drte_word_iterator* pIterator)
+{
+    if (pEngine == NULL || pIterator == NULL) {
+        return DRTE_FALSE;
+    }
+
+    if (pIterator->isAtEnd) {
+        return DRTE_FALSE;
+    }
+
+    pIterator->iCharBeg = pIterator->iCharEnd;
+
+    size_t iCharEnd;
+    if (!drte_engine_get_end_of_word_containing_character(pEngine, pIterator->iCharBeg, &iCharEnd)) {
+        pIterator->isAtEnd = DRTE_TRUE;
+        return DRTE_FALSE;
+    }
+
+    // Always make sure the last character never goes beyond the end of the range.
+    if (iCharEnd > pIterator->iCharRangeEnd) {
+        iCharEnd = pIterator->iCharRangeEnd;
+    }
+
+    pIterator->iCharEnd = iCharEnd;
+
+    // If we got an empty word we will fall back to the remaining section of the range as the last part.
+    if (pIterator->iCharBeg == pIterator->iCharEnd) {
+        pIterator->iCharEnd = pIterator->iCharRangeEnd;
+    }
+
+
+    if (pIterator->iCharBeg == pIterator->iCharEnd) {
+        pIterator->isAtEnd = DRTE_TRUE;
+        return DRTE_FALSE;
+    }
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine__first_word(drte_engine* pEngine, size_t iCharRangeBeg, size_t iCharRangeEnd, drte_word_iterator* pIterator)
+{
+    if (pEngine == NULL || pEngine->textLength == 0 || pIterator == NULL) {
+        return DRTE_FALSE;
+    }
+
+    if (iCharRangeBeg >= iCharRangeEnd) {
+        return DRTE_FALSE;
+    }
+
+    if (iCharRangeBeg > pEngine->textLength) {
+        return DRTE_FALSE;
+    }
+
+    // Clamp the end character to the last character in the text.
+    if (iCharRangeEnd > pEngine->textLength) {
+        iCharRangeEnd = pEngine->textLength;
+    }
+
+
+    pIterator->iCharRangeBeg = iCharRangeBeg;
+    pIterator->iCharRangeEnd = iCharRangeEnd;
+    pIterator->iCharBeg = iCharRangeBeg;
+    pIterator->iCharEnd = iCharRangeBeg;
+    pIterator->isAtEnd = DRTE_FALSE;
+
+    return drte_engine__next_word(pEngine, pIterator);
+}
+
+
+
+
+void drte_engine__push_text_change_to_prepared_undo_state(drte_engine* pEngine, drte_undo_change_type type, size_t iCharBeg, size_t iCharEnd, const char* text)
+{
+    if (pEngine == NULL || text == NULL) {
+        return;
+    }
+
+    // Large runs of text are compressed. These are stored as the type, range, compressed size and then the compressed text. If
+    // the text doesn't compress well it's stored as normal.
+    size_t textLength = iCharEnd - iCharBeg;
+    if (textLength >= DRTE_UNDO_COMPRESSION_THRESHOLD) {
+        size_t headerSize = sizeof(type) + sizeof(size_t)*3;
+        size_t dataOffset = drte_stack_buffer_get_stack_ptr(&pEngine->preparedUndoState);
+        size_t compressedCapacity = drte_lz_compress_bound(textLength);
+
+        uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(&pEngine->preparedUndoState, headerSize + compressedCapacity);
+        if (pData != NULL) {
+            size_t compressedSize = drte_lz_compress(text, textLength, pData + headerSize, compressedCapacity);
+            if (compressedSize > 0 && compressedSize < textLength) {
+                drte_undo_change_type compressedType = (type == drte_undo_change_type_insert) ? drte_undo_change_type_insert_compressed : drte_undo_change_type_delete_compressed;
+                memcpy(pData, &compressedType, sizeof(compressedType));
+                memcpy(pData + sizeof(type), &iCharBeg, sizeof(iCharBeg));
+                memcpy(pData + sizeof(type) + sizeof(iCharBeg), &iCharEnd, sizeof(iCharEnd));
+                memcpy(pData + sizeof(type) + sizeof(iCharBeg) + sizeof(iCharEnd), &compressedSize, sizeof(compressedSize));
+
+                // Give back whatever wasn't needed by the compressed text.
+                drte_stack_buffer_set_stack_ptr(&pEngine->preparedUndoState, dataOffset + headerSize + compressedSize);
+
+                *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->preparedUndoState, pEngine->preparedUndoTextChangesOffset)) += 1;
+                return;
+            }
+
+            drte_stack_buffer_set_stack_ptr(&pEngine->preparedUndoState, dataOffset);
+        }
+    }
+
+    size_t sizeInBytes =
+        sizeof(type) +
+        sizeof(size_t) +
+        sizeof(size_t) +
+        textLength + 1;  // +1 for null terminator.
+
+    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(&pEngine->preparedUndoState, sizeInBytes);
+    if (pData == NULL) {
+        return;
+    }
+
+    memcpy(pData, &type, sizeof(type));
+    memcpy(pData + sizeof(type), &iCharBeg, sizeof(iCharBeg));
+    memcpy(pData + sizeof(type) + sizeof(iCharBeg), &iCharEnd, sizeof(iCharEnd));
+    memcpy(pData + sizeof(type) + sizeof(iCharBeg) + sizeof(iCharEnd), text, (iCharEnd - iCharBeg));
+    *(pData + sizeof(type) + sizeof(iCharBeg) + sizeof(iCharEnd) + (iCharEnd - iCharBeg)) = '\0';
+
+    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->preparedUndoState, pEngine->preparedUndoTextChangesOffset)) += 1;
+}
+
+void drte_engine__push_replace_to_prepared_undo_state(drte_engine* pEngine, const size_t* pRangeBegs, size_t rangeCount, const char* oldText, size_t oldTextLength, const char* newText, size_t newTextLength)
+{
+    if (pEngine == NULL || pRangeBegs == NULL || oldText == NULL || newText == NULL) {
+        return;
+    }
+
+    // A replacement is stored as the old and new text once, followed by where each range started before the change.
+    drte_undo_change_type type = drte_undo_change_type_replace;
+    size_t sizeInBytes =
+        sizeof(type) +
+        sizeof(size_t) +
+        sizeof(size_t) +
+        sizeof(size_t) +
+        (sizeof(size_t) * rangeCount) +
+        oldTextLength + 1 +         // +1 for null terminator.
+        newTextLength + 1;          // +1 for null terminator.
+
+    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(&pEngine->preparedUndoState, sizeInBytes);
+    if (pData == NULL) {
+        return;
+    }
+
+    memcpy(pData, &type, sizeof(type));                     pData += sizeof(type);
+    memcpy(pData, &rangeCount, sizeof(rangeCount));         pData += sizeof(rangeCount);
+    memcpy(pData, &oldTextLength, sizeof(oldTextLength));   pData += sizeof(oldTextLength);
+    memcpy(pData, &newTextLength, sizeof(newTextLength));   pData += sizeof(newTextLength);
+    memcpy(pData, pRangeBegs, sizeof(size_t) * rangeCount); pData += sizeof(size_t) * rangeCount;
+    memcpy(pData, oldText, oldTextLength);                  pData += oldTextLength; *pData++ = '\0';
+    memcpy(pData, newText, newTextLength);                  pData += newTextLength; *pData++ = '\0';
+
+    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->preparedUndoState, pEngine->preparedUndoTextChangesOffset)) += 1;
+}
+
+void drte_engine__push_replace_regions_to_prepared_undo_state(drte_engine* pEngine, const drte_region* pRegions, size_t regionCount, const char* pNewTexts, const size_t* pNewTextLengths)
+{
+    if (pEngine == NULL || pRegions == NULL || pNewTextLengths == NULL) {
+        return;
+    }
+
+    size_t oldTextLength = 0;
+    size_t newTextLength = 0;
+    for (size_t iRegion = 0; iRegion < regionCount; ++iRegion) {
+        oldTextLength += pRegions[iRegion].iCharEnd - pRegions[iRegion].iCharBeg;
+        newTextLength += pNewTextLengths[iRegion];
+    }
+
+    // Each region has different text so the old and new text of every region is stored back to back, followed by the length of
+    // each region's new text. The regions are stored as they were before the change.
+    drte_undo_change_type type = drte_undo_change_type_replace_regions;
+    size_t sizeInBytes =
+        sizeof(type) +
+        sizeof(size_t) +
+        sizeof(size_t) +
+        sizeof(size_t) +
+        (sizeof(drte_region) * regionCount) +
+        (sizeof(size_t) * regionCount) +
+        oldTextLength + 1 +         // +1 for null terminator.
+        newTextLength + 1;          // +1 for null terminator.
+
+    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(&pEngine->preparedUndoState, sizeInBytes);
+    if (pData == NULL) {
+        return;
+    }
+
+    memcpy(pData, &type, sizeof(type));                                 pData += sizeof(type);
+    memcpy(pData, &regionCount, sizeof(regionCount));                   pData += sizeof(regionCount);
+    memcpy(pData, &oldTextLength, sizeof(oldTextLength));               pData += sizeof(oldTextLength);
+    memcpy(pData, &newTextLength, sizeof(newTextLength));               pData += sizeof(newTextLength);
+    memcpy(pData, pRegions, sizeof(drte_region) * regionCount);         pData += sizeof(drte_region) * regionCount;
+    memcpy(pData, pNewTextLengths, sizeof(size_t) * regionCount);       pData += sizeof(size_t) * regionCount;
+    for (size_t iRegion = 0; iRegion < regionCount; ++iRegion) {
+        pData += drte_piece_table_copy(&pEngine->text, pRegions[iRegion].iCharBeg, pRegions[iRegion].iCharEnd, (char*)pData);
+    }
+    *pData++ = '\0';
+    memcpy(pData, pNewTexts, newTextLength);                            pData += newTextLength; *pData++ = '\0';
+
+    *((size_t*)drte_stack_buffer_get_data_ptr(&pEngine->preparedUndoState, pEngine->preparedUndoTextChangesOffset)) += 1;
+}
+
+
+// Notifies the application that the buffer passed to drte_engine_set_text_no_copy() is no longer being used by the engine.
+void drte_engine__release_borrowed_text(drte_engine* pEngine)
+{
+    assert(pEngine != NULL);
+
+    if (!pEngine->text.isOriginalBorrowed) {
+        return;
+    }
+
+    if (pEngine->onFreeBorrowedText) {
+        pEngine->onFreeBorrowedText(pEngine, pEngine->text.pOriginal, pEngine->text.originalLength, pEngine->pBorrowedTextUserData);
+    }
+
+    pEngine->text.pOriginal = NULL;
+    pEngine->text.originalLength = 0;
+    pEngine->text.isOriginalBorrowed = DRTE_FALSE;
+    pEngine->onFreeBorrowedText = NULL;
+    pEngine->pBorrowedTextUserData = NULL;
+}
+
+drte_bool32 drte_engine_init(drte_engine* pEngine, void* pUserData)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    memset(pEngine, 0, sizeof(*pEngine));
+
+    pEngine->defaultStyleSlot = DRTE_INVALID_STYLE_SLOT;
+    pEngine->selectionStyleSlot = DRTE_INVALID_STYLE_SLOT;
+    pEngine->activeLineStyleSlot = DRTE_INVALID_STYLE_SLOT;
+    pEngine->matchStyleSlot = DRTE_INVALID_STYLE_SLOT;
+    pEngine->cursorStyleSlot = DRTE_INVALID_STYLE_SLOT;
+    pEngine->lineNumbersStyleSlot = DRTE_INVALID_STYLE_SLOT;
+
+
+    // Note that _wrappedLines is intentionally left uninitialized because word wrap is disabled by default.
+    drte_line_cache_init(&pEngine->_unwrappedLines);
+
+    // Both line caches point to the same underlying structure to save on memory. This is only the case when word wrap is disabled, which is
+    // the default behaviour.
+    pEngine->pUnwrappedLines = &pEngine->_unwrappedLines;
+
+    drte_piece_table_init(&pEngine->text);
+
+    pEngine->cursorBlinkRate       = 500;
+    pEngine->timeToNextCursorBlink = pEngine->cursorBlinkRate;
+    pEngine->isCursorBlinkOn       = DRTE_TRUE;
+    pEngine->pUserData             = pUserData;
+
+    drte_stack_buffer_init(&pEngine->preparedUndoState);
+    drte_stack_buffer_init(&pEngine->undoBuffer);
+
+    pEngine->highlighterLexLimit = (size_t)-1;
+    drte_engine__reset_lexer(pEngine);
+
+
+    // The temporary view.
+    //pEngine->pView = drte_view_create(pEngine);
+
+    return DRTE_TRUE;
+}
+
+void drte_engine_uninit(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    // All views need to be deleted.
+    while (pEngine->pRootView != NULL) {
+        drte_view_delete(pEngine->pRootView);
+    }
+
+
+    drte_engine_clear_undo_stack(pEngine);
+
+    drte_stack_buffer_uninit(&pEngine->undoBuffer);
+    drte_stack_buffer_uninit(&pEngine->preparedUndoState);
+
+    drte_line_cache_uninit(&pEngine->_unwrappedLines);
+
+    free(pEngine->_pLexerStates);
+    for (size_t i = 0; i < DRTE_LEXED_LINE_CACHE_SIZE; ++i) {
+        free(pEngine->_lexedLines[i].pTokens);
+    }
+
+    //free(pEngine->pView->pSelections);
+    //free(pEngine->pView->pCursors);
+
+    drte_engine__release_borrowed_text(pEngine);
+    drte_piece_table_uninit(&pEngine->text);
+}
+
+
+size_t drte_engine_get_view_count(drte_engine* pEngine)
+{
+    size_t count = 0;
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        count += 1;
+    }
+
+    return count;
+}
+
+
+drte_bool32 drte_engine_register_style_token(drte_engine* pEngine, drte_style_token styleToken, drte_font_metrics fontMetrics)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    // If the token already exists just refresh.
+    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
+    if (styleSlot != DRTE_INVALID_STYLE_SLOT) {
+        pEngine->styles[styleSlot].fontMetrics = fontMetrics;
+
+        if (!(pEngine->flags & DRTE_USE_EXPLICIT_LINE_HEIGHT)) {
+            pEngine->lineHeight = 0;
+            for (uint16_t i = 0; i < pEngine->styleCount; ++i) {
+                if (pEngine->lineHeight < fontMetrics.lineHeight) {
+                    pEngine->lineHeight = fontMetrics.lineHeight;
+                }
+            }
+        }
+
+        drte_engine__refresh(pEngine);
+        return DRTE_TRUE;
+    }
+
+
+    // If we get here it means the style has not previously been registered. We don't need to do any repainting or refreshing here
+    // because the style will not actually be used by anything yet.
+    if (pEngine->styleCount == 255) {
+        return DRTE_FALSE;   // Too many styles. The 256'th slot (index 255) is used as the error indicator.
+    }
+
+    // Line heights need to be refreshed if it has not been set explicitly.
+    if (pEngine->lineHeight < fontMetrics.lineHeight && (pEngine->flags & DRTE_USE_EXPLICIT_LINE_HEIGHT) == 0) {
+        pEngine->lineHeight = fontMetrics.lineHeight;
+    }
+
+    pEngine->styles[pEngine->styleCount].styleToken = styleToken;
+    pEngine->styles[pEngine->styleCount].fontMetrics = fontMetrics;
+
+    pEngine->styleCount += 1;
+    return DRTE_TRUE;
+}
+
+void drte_engine_set_default_style(drte_engine* pEngine, drte_style_token styleToken)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
+    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
+        return;
+    }
+
+    if (pEngine->defaultStyleSlot == styleSlot) {
+        return; // Nothing has changed.
+    }
+
+    pEngine->defaultStyleSlot = styleSlot;
+    drte_engine__refresh(pEngine);
+}
+
+void drte_engine_set_selection_style(drte_engine* pEngine, drte_style_token styleToken)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
+    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
+        return;
+    }
+
+    if (pEngine->selectionStyleSlot == styleSlot) {
+        return; // Nothing has changed.
+    }
+
+    pEngine->selectionStyleSlot = styleSlot;
+
+
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        if (drte_view_is_anything_selected(pView)) {
+            drte_view__invalidate_word_wrapping(pView);    // <-- This will repaint.
+        }
+    }
+}
+
+void drte_engine_set_active_line_style(drte_engine* pEngine, drte_style_token styleToken)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
+    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
+        return;
+    }
+
+    if (pEngine->activeLineStyleSlot == styleSlot) {
+        return; // Nothing has changed.
+    }
+
+    pEngine->activeLineStyleSlot = styleSlot;
+    drte_engine__refresh(pEngine);
+}
+
+void drte_engine_set_match_style(drte_engine* pEngine, drte_style_token styleToken)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
+    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
+        return;
+    }
+
+    if (pEngine->matchStyleSlot == styleSlot) {
+        return; // Nothing has changed.
+    }
+
+    pEngine->matchStyleSlot = styleSlot;
+
+
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        if (pView->_matchCount > 0) {
+            drte_view__invalidate_word_wrapping(pView);    // <-- This will repaint.
+        }
+    }
+}
+
+void drte_engine_set_cursor_style(drte_engine* pEngine, drte_style_token styleToken)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
+    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
+        return;
+    }
+
+    if (pEngine->cursorStyleSlot == styleSlot) {
+        return; // Nothing has changed.
+    }
+
+    pEngine->cursorStyleSlot = styleSlot;
+    drte_engine__refresh(pEngine);
+}
+
+void drte_engine_set_line_numbers_style(drte_engine* pEngine, drte_style_token styleToken)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    uint8_t styleSlot = drte_engine__get_style_slot(pEngine, styleToken);
+    if (styleSlot == DRTE_INVALID_STYLE_SLOT) {
+        return;
+    }
+
+    if (pEngine->lineNumbersStyleSlot == styleSlot) {
+        return; // Nothing has changed.
+    }
+
+    pEngine->lineNumbersStyleSlot = styleSlot;
+    drte_engine__refresh(pEngine);
+}
+
+
+void drte_engine_set_highlighter(drte_engine* pEngine, drte_engine_on_lex_line_proc proc, void* pUserData)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->onLexLine = proc;
+    pEngine->pHighlightUserData = pUserData;
+    drte_engine__reset_lexer(pEngine);
+
+    drte_engine__refresh(pEngine);
+}
+
+drte_bool32 drte_lexed_line_add_token(drte_lexed_line* pLine, size_t iCharBeg, size_t iCharEnd, drte_style_token styleToken)
+{
+    if (pLine == NULL) {
+        return DRTE_TRUE;
+    }
+
+    if (iCharBeg >= iCharEnd) {
+        return DRTE_FALSE;
+    }
+
+    if (pLine->tokenCount == pLine->tokenBufferSize) {
+        size_t newBufferSize = (pLine->tokenBufferSize == 0) ? 16 : pLine->tokenBufferSize * 2;
+        drte_lexer_token* pNewTokens = (drte_lexer_token*)realloc(pLine->pTokens, newBufferSize * sizeof(*pNewTokens));
+        if (pNewTokens == NULL) {
+            return DRTE_FALSE;
+        }
+
+        pLine->pTokens = pNewTokens;
+        pLine->tokenBufferSize = newBufferSize;
+    }
+
+    pLine->pTokens[pLine->tokenCount].iCharBeg = iCharBeg;
+    pLine->pTokens[pLine->tokenCount].iCharEnd = iCharEnd;
+    pLine->pTokens[pLine->tokenCount].styleToken = styleToken;
+    pLine->tokenCount += 1;
+
+    return DRTE_TRUE;
+}
+
+static drte_bool32 drte_engine__reserve_lexer_states(drte_engine* pEngine, size_t count)
+{
+    assert(pEngine != NULL);
+
+    if (count > pEngine->_lexerStateBufferSize) {
+        size_t newBufferSize = pEngine->_lexerStateBufferSize * 2;
+        if (newBufferSize < count) {
+            newBufferSize = count;
+        }
+
+        uint32_t* pNewStates = (uint32_t*)realloc(pEngine->_pLexerStates, newBufferSize * sizeof(*pNewStates));
+        if (pNewStates == NULL) {
+            return DRTE_FALSE;
+        }
+
+        pEngine->_pLexerStates = pNewStates;
+        pEngine->_lexerStateBufferSize = newBufferSize;
+    }
+
+    return DRTE_TRUE;
+}
+
+// Forgets the tokens of every line from iFirstLine onwards.
+static void drte_engine__invalidate_lexed_lines(drte_engine* pEngine, size_t iFirstLine)
+{
+    assert(pEngine != NULL);
+
+    for (size_t i = 0; i < DRTE_LEXED_LINE_CACHE_SIZE; ++i) {
+        if (pEngine->_lexedLines[i].iLine != (size_t)-1 && pEngine->_lexedLines[i].iLine >= iFirstLine) {
+            pEngine->_lexedLines[i].iLine = (size_t)-1;
+        }
+    }
+}
+
+void drte_engine__reset_lexer(drte_engine* pEngine)
+{
+    assert(pEngine != NULL);
+
+    // The state at the start of the first line is always 0 so it's the only state that's known up front.
+    pEngine->_lexerStateValidCount = 0;
+    if (pEngine->onLexLine != NULL && drte_engine__reserve_lexer_states(pEngine, 1)) {
+        pEngine->_pLexerStates[0] = 0;
+        pEngine->_lexerStateValidCount = 1;
+    }
+
+    pEngine->_lexerStateStaleBeg = pEngine->_lexerStateValidCount;
+    pEngine->_lexerStateCount = pEngine->_lexerStateValidCount;
+    pEngine->_lexerVersion += 1;
+
+    drte_engine__invalidate_lexed_lines(pEngine, 0);
+}
+
+void drte_engine__on_lines_changed(drte_engine* pEngine, size_t iFirstLine, size_t oldLineCount, size_t newLineCount)
+{
+    assert(pEngine != NULL);
+
+    if (pEngine->onLexLine == NULL || pEngine->_lexerStateValidCount == 0) {
+        return;
+    }
+
+    drte_engine__invalidate_lexed_lines(pEngine, iFirstLine);
+    pEngine->_lexerVersion += 1;
+
+    // The state at the start of the first changed line is unaffected, but everything after it needs to be lexed again.
+    size_t validCount = drte_min(pEngine->_lexerStateValidCount, iFirstLine+1);
+
+    // The states after the changed lines are kept so lexing can stop early if it catches up with them. They need to be a run of states
+    // that follow on from one another, so when there's already a stale run only the part of it after the changed lines can be kept.
+    size_t iOldStaleBeg = iFirstLine + oldLineCount;
+    if (pEngine->_lexerStateValidCount < pEngine->_lexerStateCount) {
+        iOldStaleBeg = drte_max(iOldStaleBeg, pEngine->_lexerStateStaleBeg);
+    }
+
+    if (iOldStaleBeg >= pEngine->_lexerStateCount) {
+        pEngine->_lexerStateValidCount = validCount;
+        pEngine->_lexerStateStaleBeg = validCount;
+        pEngine->_lexerStateCount = validCount;
+        return;
+    }
+
+    size_t staleCount = pEngine->_lexerStateCount - iOldStaleBeg;
+    size_t iNewStaleBeg = iOldStaleBeg - oldLineCount + newLineCount;
+    if (!drte_engine__reserve_lexer_states(pEngine, iNewStaleBeg + staleCount)) {
+        pEngine->_lexerStateValidCount = validCount;
+        pEngine->_lexerStateStaleBeg = validCount;
+        pEngine->_lexerStateCount = validCount;
+        return;
+    }
+
+    memmove(pEngine->_pLexerStates + iNewStaleBeg, pEngine->_pLexerStates + iOldStaleBeg, staleCount * sizeof(*pEngine->_pLexerStates));
+
+    pEngine->_lexerStateValidCount = validCount;
+    pEngine->_lexerStateStaleBeg = iNewStaleBeg;
+    pEngine->_lexerStateCount = iNewStaleBeg + staleCount;
+}
+
+// Retrieves the text of the given unwrapped line to pass to the highlighter, not including the new line character.
+static const char* drte_engine__get_lexer_line_text(drte_engine* pEngine, size_t iLine, size_t* pLineCharBegOut, size_t* pTextLengthOut)
+{
+    assert(pEngine != NULL);
+
+    size_t iLineCharBeg = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iLine);
+    size_t iLineCharEnd = pEngine->textLength;
+    if (iLine+1 < drte_line_cache_get_line_count(pEngine->pUnwrappedLines)) {
+        iLineCharEnd = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iLine+1) - 1;
+    }
+
+    *pLineCharBegOut = iLineCharBeg;
+    *pTextLengthOut = iLineCharEnd - iLineCharBeg;
+    return drte_engine__get_text_range(pEngine, iLineCharBeg, iLineCharEnd);
+}
+
+// Sets the state of the lexer at the start of the first line whose state isn't known.
+static drte_bool32 drte_engine__push_lexer_state(drte_engine* pEngine, uint32_t state)
+{
+    assert(pEngine != NULL);
+    assert(pEngine->_lexerStateValidCount > 0);
+
+    size_t iLine = pEngine->_lexerStateValidCount;
+    if (!drte_engine__reserve_lexer_states(pEngine, iLine+1)) {
+        return DRTE_FALSE;
+    }
+
+    // If the state has caught up with the state from before the text was changed, the rest of the stale states are up to date.
+    if (iLine >= pEngine->_lexerStateStaleBeg && iLine < pEngine->_lexerStateCount && pEngine->_pLexerStates[iLine] == state) {
+        pEngine->_lexerStateValidCount = pEngine->_lexerStateCount;
+        pEngine->_lexerStateStaleBeg = pEngine->_lexerStateCount;
+        return DRTE_TRUE;
+    }
+
+    pEngine->_pLexerStates[iLine] = state;
+    pEngine->_lexerStateValidCount = iLine+1;
+    pEngine->_lexerStateStaleBeg = drte_max(pEngine->_lexerStateStaleBeg, pEngine->_lexerStateValidCount);
+    pEngine->_lexerStateCount = drte_max(pEngine->_lexerStateCount, pEngine->_lexerStateValidCount);
+    return DRTE_TRUE;
+}
+
+// Makes sure the state of the lexer at the start of the given unwrapped line is known.
+static drte_bool32 drte_engine__lex_to_line(drte_engine* pEngine, size_t iLine)
+{
+    assert(pEngine != NULL);
+    assert(pEngine->onLexLine != NULL);
+
+    if (pEngine->_lexerStateValidCount == 0) {
+        return DRTE_FALSE;
+    }
+
+    while (pEngine->_lexerStateValidCount <= iLine) {
+        size_t iLexedLine = pEngine->_lexerStateValidCount-1;
+
+        size_t iLineCharBeg;
+        size_t textLength;
+        const char* text = drte_engine__get_lexer_line_text(pEngine, iLexedLine, &iLineCharBeg, &textLength);
+        if (!drte_engine__push_lexer_state(pEngine, pEngine->onLexLine(pEngine, pEngine->_pLexerStates[iLexedLine], text, textLength, NULL, pEngine->pHighlightUserData))) {
+            return DRTE_FALSE;
+        }
+    }
+
+    return DRTE_TRUE;
+}
+
+// Retrieves the tokens of the given unwrapped line, lexing it if they aren't already known.
+static drte_lexed_line* drte_engine__get_lexed_line(drte_engine* pEngine, size_t iLine)
+{
+    assert(pEngine != NULL);
+
+    drte_lexed_line* pLine = &pEngine->_lexedLines[iLine & (DRTE_LEXED_LINE_CACHE_SIZE-1)];
+    if (pLine->iLine == iLine) {
+        return pLine;
+    }
+
+    // Lines too far past the last known state are left to be lexed in the background.
+    if (iLine >= pEngine->_lexerStateValidCount && iLine - pEngine->_lexerStateValidCount >= pEngine->highlighterLexLimit) {
+        return NULL;
+    }
+
+    if (!drte_engine__lex_to_line(pEngine, iLine)) {
+        return NULL;
+    }
+
+    size_t iLineCharBeg;
+    size_t textLength;
+    const char* text = drte_engine__get_lexer_line_text(pEngine, iLine, &iLineCharBeg, &textLength);
+
+    pLine->iLine = iLine;
+    pLine->tokenCount = 0;
+    pEngine->onLexLine(pEngine, pEngine->_pLexerStates[iLine], text, textLength, pLine, pEngine->pHighlightUserData);
+
+    return pLine;
+}
+
+drte_bool32 drte_engine__get_next_lexer_token(drte_engine* pEngine, size_t iChar, size_t* pCharBegOut, size_t* pCharEndOut, drte_style_token* pStyleTokenOut)
+{
+    assert(pEngine != NULL);
+    assert(pCharBegOut != NULL);
+    assert(pCharEndOut != NULL);
+    assert(pStyleTokenOut != NULL);
+
+    size_t iLine = drte_line_cache_find_line_by_character(pEngine->pUnwrappedLines, iChar);
+    drte_lexed_line* pLine = drte_engine__get_lexed_line(pEngine, iLine);
+    if (pLine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    size_t iLineCharBeg = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iLine);
+    size_t iLocalChar = iChar - iLineCharBeg;
+
+    // Binary search for the first token ending after the character.
+    size_t lo = 0;
+    size_t hi = pLine->tokenCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        if (pLine->pTokens[mid].iCharEnd <= iLocalChar) {
+            lo = mid+1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == pLine->tokenCount) {
+        return DRTE_FALSE;
+    }
+
+    *pCharBegOut = iLineCharBeg + pLine->pTokens[lo].iCharBeg;
+    *pCharEndOut = iLineCharBeg + pLine->pTokens[lo].iCharEnd;
+    *pStyleTokenOut = pLine->pTokens[lo].styleToken;
+    return DRTE_TRUE;
+}
+
+// Repaints the unwrapped lines from iLineBeg up to but not including iLineEnd in each view.
+static void drte_engine__dirty_unwrapped_lines(drte_engine* pEngine, size_t iLineBeg, size_t iLineEnd)
+{
+    assert(pEngine != NULL);
+
+    size_t lineCount = drte_line_cache_get_line_count(pEngine->pUnwrappedLines);
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        size_t iWrappedLineBeg = drte_view_get_character_line(pView, pView->pWrappedLines, drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iLineBeg));
+        size_t iWrappedLineEnd = drte_view_get_line_count(pView);
+        if (iLineEnd < lineCount) {
+            iWrappedLineEnd = drte_view_get_character_line(pView, pView->pWrappedLines, drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iLineEnd));
+        }
+
+        drte_rect rect = drte_view_get_local_rect(pView);
+        rect.top    = drte_max(rect.top,    drte_view_get_line_pos_y(pView, iWrappedLineBeg) + pView->innerOffsetY);
+        rect.bottom = drte_min(rect.bottom, drte_view_get_line_pos_y(pView, iWrappedLineEnd) + pView->innerOffsetY);
+        if (rect.bottom > rect.top) {
+            drte_view_dirty(pView, rect);
+        }
+    }
+}
+
+void drte_engine_set_highlighter_lex_limit(drte_engine* pEngine, size_t maxLineCount)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->highlighterLexLimit = maxLineCount;
+    drte_engine__refresh(pEngine);
+}
+
+drte_bool32 drte_engine_get_lexer_job(drte_engine* pEngine, char* pTextOut, size_t textOutSize, drte_lexer_job* pJob)
+{
+    if (pEngine == NULL || pTextOut == NULL || pJob == NULL || pEngine->onLexLine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    // The state after the last line is never needed, and it's the only line which can still have text waiting to be indexed.
+    size_t lineCount = drte_line_cache_get_line_count(pEngine->pUnwrappedLines);
+    if (pEngine->_lexerStateValidCount == 0 || pEngine->_lexerStateValidCount >= lineCount) {
+        return DRTE_FALSE;
+    }
+
+    size_t iFirstLine = pEngine->_lexerStateValidCount-1;
+    size_t iLineCharBeg = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iFirstLine);
+    size_t iLineCharEnd = iLineCharBeg;
+    size_t jobLineCount = 0;
+    while (iFirstLine + jobLineCount + 1 < lineCount) {
+        size_t iNextLineCharBeg = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iFirstLine + jobLineCount + 1);
+        if (iNextLineCharBeg - iLineCharBeg > textOutSize) {
+            break;
+        }
+
+        iLineCharEnd = iNextLineCharBeg;
+        jobLineCount += 1;
+    }
+
+    // A line too long to fit is lexed on the spot rather than holding everything after it up.
+    if (jobLineCount == 0) {
+        if (!drte_engine__lex_to_line(pEngine, iFirstLine+1)) {
+            return DRTE_FALSE;
+        }
+
+        return drte_engine_get_lexer_job(pEngine, pTextOut, textOutSize, pJob);
+    }
+
+    drte_piece_table_copy(&pEngine->text, iLineCharBeg, iLineCharEnd, pTextOut);
+
+    pJob->pEngine = pEngine;
+    pJob->onLexLine = pEngine->onLexLine;
+    pJob->pUserData = pEngine->pHighlightUserData;
+    pJob->version = pEngine->_lexerVersion;
+    pJob->iFirstLine = iFirstLine;
+    pJob->state = pEngine->_pLexerStates[iFirstLine];
+    pJob->text = pTextOut;
+    pJob->textLength = iLineCharEnd - iLineCharBeg;
+    pJob->lineCount = jobLineCount;
+    return DRTE_TRUE;
+}
+
+void drte_lexer_job_run(const drte_lexer_job* pJob, uint32_t* pStatesOut)
+{
+    if (pJob == NULL || pStatesOut == NULL) {
+        return;
+    }
+
+    uint32_t state = pJob->state;
+    size_t iLineCharBeg = 0;
+    for (size_t iLine = 0; iLine < pJob->lineCount; ++iLine) {
+        size_t lineLength = drte__find_newline(pJob->text + iLineCharBeg, pJob->textLength - iLineCharBeg);
+        state = pJob->onLexLine(pJob->pEngine, state, pJob->text + iLineCharBeg, lineLength, NULL, pJob->pUserData);
+        pStatesOut[iLine] = state;
+
+        iLineCharBeg += lineLength + 1;
+    }
+}
+
+drte_bool32 drte_engine_set_lexer_states(drte_engine* pEngine, const drte_lexer_job* pJob, const uint32_t* pStates)
+{
+    if (pEngine == NULL || pJob == NULL || (pStates == NULL && pJob->lineCount > 0)) {
+        return DRTE_FALSE;
+    }
+
+    if (pJob->version != pEngine->_lexerVersion || pEngine->onLexLine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    // Some of the lines may have been lexed on demand while the job was running.
+    size_t iFirstNewLine = pEngine->_lexerStateValidCount;
+    for (size_t iLine = pJob->iFirstLine+1; iLine < pJob->iFirstLine+1 + pJob->lineCount; ++iLine) {
+        if (iLine == pEngine->_lexerStateValidCount) {
+            if (!drte_engine__push_lexer_state(pEngine, pStates[iLine - pJob->iFirstLine - 1])) {
+                return DRTE_FALSE;
+            }
+        }
+    }
+
+    // The lines whose states are now known were painted with the default style.
+    if (pEngine->_lexerStateValidCount > iFirstNewLine) {
+        drte_engine__dirty_unwrapped_lines(pEngine, iFirstNewLine, pEngine->_lexerStateValidCount);
+    }
+
+    return DRTE_TRUE;
+}
+
+
+void drte_engine_set_line_height(drte_engine* pEngine, float lineHeight)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    // Don't do anything if nothing is changing.
+    if (lineHeight == 0 && (pEngine->flags & DRTE_USE_EXPLICIT_LINE_HEIGHT) == 0) {
+        return;
+    }
+
+    pEngine->flags |= DRTE_USE_EXPLICIT_LINE_HEIGHT;
+    pEngine->lineHeight = lineHeight;
+
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view_dirty(pView, drte_view_get_local_rect(pView));
+    }
+}
+
+float drte_engine_get_line_height(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    return pEngine->lineHeight;
+}
+
+
+
+uint32_t drte_engine_get_utf32(drte_engine* pEngine, size_t characterIndex)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    // TODO: Handle UTF-8 properly.
+    return drte_engine__get_char(pEngine, characterIndex);
+}
+
+
+void drte_engine_set_text(drte_engine* pEngine, const char* text)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    // Remove existing text first.
+    if (pEngine->textLength > 0) {
+        drte_engine_delete_text(pEngine, 0, pEngine->textLength);
+    }
+
+    // Insert new text.
+    drte_engine_insert_text(pEngine, text, 0);
+}
+
+drte_bool32 drte_engine__set_text_no_copy(drte_engine* pEngine, const char* text, size_t textLength, drte_engine_on_free_text_proc onFree, void* pUserData, drte_bool32 indexLines)
+{
+    if (pEngine == NULL || (text == NULL && textLength > 0)) {
+        return DRTE_FALSE;
+    }
+
+    // Remove existing text first.
+    if (pEngine->textLength > 0) {
+        drte_engine_delete_text(pEngine, 0, pEngine->textLength);
+    }
+
+    // Undo points refer to text by it's position so they're all invalidated unless this change is being recorded.
+    if (!pEngine->hasPreparedUndoState) {
+        drte_engine_clear_undo_stack(pEngine);
+    }
+
+    // The engine is now empty so the original buffer can be swapped out without affecting anything.
+    drte_engine__release_borrowed_text(pEngine);
+    if (!drte_piece_table_set_original(&pEngine->text, text, textLength, DRTE_TRUE)) {
+        return DRTE_FALSE;
+    }
+
+    pEngine->onFreeBorrowedText = onFree;
+    pEngine->pBorrowedTextUserData = pUserData;
+    pEngine->textLength = pEngine->text.length;
+    pEngine->unindexedLength = 0;
+
+    if (textLength == 0) {
+        return DRTE_TRUE;
+    }
+
+    if (indexLines) {
+        return drte_engine__on_text_inserted(pEngine, text, textLength, 0, 0);
+    }
+
+
+    // The lines are left unindexed. Cursors and selections were all collapsed to the start of the text when it was deleted above so
+    // they can stay where they are, which avoids needing any lines.
+    pEngine->unindexedLength = textLength;
+    drte_engine__on_lines_changed(pEngine, 0, 1, 1);
+
+    if (pEngine->hasPreparedUndoState) {
+        drte_engine__push_text_change_to_prepared_undo_state(pEngine, drte_undo_change_type_insert, 0, textLength, text);
+    }
+
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view__reset_matches(pView);
+
+        if (drte_view_is_word_wrap_enabled(pView)) {
+            drte_view__refresh_word_wrapping(pView);    // <-- This will index every line and repaint.
+        } else {
+            drte_view__clear_measurements(pView);
+            drte_view_dirty(pView, drte_view_get_local_rect(pView));
+        }
+    }
+
+    if (pEngine->onTextChanged) {
+        pEngine->onTextChanged(pEngine);
+    }
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine_set_text_no_copy(drte_engine* pEngine, const char* text, size_t textLength, drte_engine_on_free_text_proc onFree, void* pUserData)
+{
+    return drte_engine__set_text_no_copy(pEngine, text, textLength, onFree, pUserData, DRTE_TRUE);
+}
+
+drte_bool32 drte_engine_set_text_no_copy_unindexed(drte_engine* pEngine, const char* text, size_t textLength, drte_engine_on_free_text_proc onFree, void* pUserData)
+{
+    return drte_engine__set_text_no_copy(pEngine, text, textLength, onFree, pUserData, DRTE_FALSE);
+}
+
+drte_bool32 drte_engine_copy_borrowed_text(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    if (!pEngine->text.isOriginalBorrowed) {
+        return DRTE_TRUE;   // Nothing is borrowed.
+    }
+
+    char* pOriginal = NULL;
+    if (pEngine->text.originalLength > 0) {
+        pOriginal = (char*)malloc(pEngine->text.originalLength);
+        if (pOriginal == NULL) {
+            return DRTE_FALSE;
+        }
+
+        memcpy(pOriginal, pEngine->text.pOriginal, pEngine->text.originalLength);
+    }
+
+    // Pieces refer to the original buffer by offset so they don't need to be touched.
+    size_t originalLength = pEngine->text.originalLength;
+    drte_engine__release_borrowed_text(pEngine);
+
+    pEngine->text.pOriginal = pOriginal;
+    pEngine->text.originalLength = originalLength;
+
+    return DRTE_TRUE;
+}
+
+// Indexes the lines of at least the next length characters of the unindexed text. Indexing always continues to the end of the line.
+drte_bool32 drte_engine__index_unindexed_text(drte_engine* pEngine, size_t length)
+{
+    assert(pEngine != NULL);
+
+    if (length > pEngine->unindexedLength) {
+        length = pEngine->unindexedLength;
+    }
+
+    // Edits are never made to unindexed text so it's always the untouched tail of the original buffer.
+    const char* pUnindexedText = pEngine->text.pOriginal + (pEngine->text.originalLength - pEngine->unindexedLength);
+    size_t iIndexedEnd = pEngine->textLength - pEngine->unindexedLength;
+
+    length += drte__find_newline(pUnindexedText + length, pEngine->unindexedLength - length);
+    if (length < pEngine->unindexedLength) {
+        length += 1;    // Include the new line character.
+    }
+
+    size_t iLastLine = drte_line_cache_get_line_count(pEngine->pUnwrappedLines) - 1;
+    if (!drte_line_cache_insert_lines_from_text(pEngine->pUnwrappedLines, iLastLine + 1, iIndexedEnd, pUnindexedText, length)) {
+        return DRTE_FALSE;
+    }
+
+    pEngine->unindexedLength -= length;
+
+    // The last line will have been cut short by the new lines.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view__invalidate_line_measurements(pView, iLastLine, 1, drte_line_cache_get_line_count(pEngine->pUnwrappedLines) - iLastLine, 0);
+    }
+
+    drte_engine__on_lines_changed(pEngine, iLastLine, 1, drte_line_cache_get_line_count(pEngine->pUnwrappedLines) - iLastLine);
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine__index_lines_to_character(drte_engine* pEngine, size_t iChar)
+{
+    assert(pEngine != NULL);
+
+    size_t iIndexedEnd = pEngine->textLength - pEngine->unindexedLength;
+    if (pEngine->unindexedLength == 0 || iChar < iIndexedEnd) {
+        return DRTE_TRUE;
+    }
+
+    return drte_engine__index_unindexed_text(pEngine, iChar - iIndexedEnd);
+}
+
+drte_bool32 drte_engine_add_indexed_lines(drte_engine* pEngine, const size_t* pLineOffsets, size_t lineCount, size_t scannedLength)
+{
+    if (pEngine == NULL || (pLineOffsets == NULL && lineCount > 0)) {
+        return DRTE_FALSE;
+    }
+
+    if (scannedLength > pEngine->text.originalLength) {
+        scannedLength = pEngine->text.originalLength;
+    }
+
+    size_t originalIndexedEnd = pEngine->text.originalLength - pEngine->unindexedLength;
+    if (pEngine->unindexedLength == 0 || scannedLength <= originalIndexedEnd) {
+        return DRTE_TRUE;   // Everything here has already been indexed.
+    }
+
+    // Some of these lines may have been indexed on the spot while they were being found.
+    size_t iFirstLine = 0;
+    while (iFirstLine < lineCount && pLineOffsets[iFirstLine] <= originalIndexedEnd) {
+        iFirstLine += 1;
+    }
+
+    // Offsets are relative to the original buffer. Edits before the unindexed text shift it by a fixed amount.
+    size_t characterOffset = (pEngine->textLength - pEngine->unindexedLength) - originalIndexedEnd;
+    size_t iLastLine = drte_line_cache_get_line_count(pEngine->pUnwrappedLines) - 1;
+    if (!drte_line_cache_append_lines(pEngine->pUnwrappedLines, pLineOffsets + iFirstLine, lineCount - iFirstLine, characterOffset)) {
+        return DRTE_FALSE;
+    }
+
+    pEngine->unindexedLength = pEngine->text.originalLength - scannedLength;
+
+    // The last line will have been cut short by the new lines.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view__invalidate_line_measurements(pView, iLastLine, 1, drte_line_cache_get_line_count(pEngine->pUnwrappedLines) - iLastLine, 0);
+        drte_view_dirty(pView, drte_view_get_local_rect(pView));
+    }
+
+    drte_engine__on_lines_changed(pEngine, iLastLine, 1, drte_line_cache_get_line_count(pEngine->pUnwrappedLines) - iLastLine);
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine_index_lines_to_line(drte_engine* pEngine, size_t iLine)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    while (pEngine->unindexedLength > 0 && drte_line_cache_get_line_count(pEngine->pUnwrappedLines)-1 <= iLine) {
+        if (!drte_engine__index_unindexed_text(pEngine, DRTE_LINE_INDEXING_CHUNK_SIZE)) {
+            return DRTE_FALSE;
+        }
+    }
+
+    return DRTE_TRUE;
+}
+
+size_t drte_engine_get_unindexed_length(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    return pEngine->unindexedLength;
+}
+
+size_t drte_engine_get_text(drte_engine* pEngine, char* textOut, size_t textOutSize)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    return drte_engine_get_subtext(pEngine, 0, pEngine->textLength, textOut, textOutSize);
+}
+
+size_t drte_engine_get_subtext(drte_engine* pEngine, size_t characterBeg, size_t characterEnd, char* textOut, size_t textOutSize)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    // Safety.
+    if (textOut != NULL && textOutSize > 0) {
+        textOut[0] = '\0';
+    }
+
+    if (characterEnd > pEngine->textLength) {
+        return 0;   // Trying to read past the end of the engine's text.
+    }
+
+    size_t subtextLen = (characterEnd - characterBeg);
+    if (textOut == NULL) {
+        return subtextLen;
+    }
+
+    if (subtextLen == 0) {
+        return 0;
+    }
+
+    if (textOutSize <= subtextLen) {
+        return 0;   // Output buffer is too small. Needs room for the null terminator.
+    }
+
+    drte_piece_table_copy(&pEngine->text, characterBeg, characterEnd, textOut);
+    textOut[subtextLen] = '\0';
+
+    return subtextLen;
+}
+
+
+void drte_engine_set_on_dirty(drte_engine* pEngine, drte_engine_on_dirty_proc proc)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->onDirty = proc;
+}
+
+void drte_engine_set_on_text_changed(drte_engine* pEngine, drte_engine_on_text_changed_proc proc)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->onTextChanged = proc;
+}
+
+void drte_engine_set_on_undo_point_changed(drte_engine* pEngine, drte_engine_on_undo_point_changed_proc proc)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->onUndoPointChanged = proc;
+}
+
+void drte_engine_set_on_cursor_move(drte_engine* pEngine, drte_engine_on_cursor_move_proc proc)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->onCursorMove = proc;
+}
+
+
+
+void drte_engine_set_cursor_blink_rate(drte_engine* pEngine, unsigned int blinkRateInMilliseconds)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->cursorBlinkRate = blinkRateInMilliseconds;
+}
+
+unsigned int drte_engine_get_cursor_blink_rate(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    return pEngine->cursorBlinkRate;
+}
+
+void drte_engine_reset_cursor_blinks(drte_engine* pEngine)
+{
+    if (pEngine == NULL) return;
+    pEngine->timeToNextCursorBlink = pEngine->cursorBlinkRate;
+    pEngine->isCursorBlinkOn = DRTE_TRUE;
+}
+
+
+
+drte_bool32 drte_engine_insert_character(drte_engine* pEngine, size_t insertIndex, uint32_t utf32)
+{
+    // TODO: Do a proper UTF-32 -> UTF-8 conversion.
+    char utf8[16];
+    utf8[0] = (char)utf32;
+    utf8[1] = '\0';
+
+    return drte_engine_insert_text(pEngine, utf8, insertIndex);
+}
+
+drte_bool32 drte_engine_delete_character(drte_engine* pEngine, size_t iChar)
+{
+    return drte_engine_delete_text(pEngine, iChar, iChar+1);
+}
+
+// Updates everything that depends on the text after the given text has been added to storage at the given index. iLine is the
+// line the text was inserted on.
+drte_bool32 drte_engine__on_text_inserted(drte_engine* pEngine, const char* text, size_t textLength, size_t insertIndex, size_t iLine)
+{
+    assert(pEngine != NULL);
+
+    // Adjust lines. Only '\n' is used to determine line boundaries which means "\r\n" is correctly treated as a single line break.
+    size_t unwrappedLineCount = drte_line_cache_get_line_count(pEngine->pUnwrappedLines);
+    if (!drte_line_cache_insert_lines_from_text(pEngine->pUnwrappedLines, iLine+1, insertIndex, text, textLength)) {
+        return DRTE_FALSE;
+    }
+
+    // The lexer states need to be shifted before the views are re-wrapped because wrapping lexes the new text.
+    size_t insertedLineCount = drte_line_cache_get_line_count(pEngine->pUnwrappedLines) - unwrappedLineCount;
+    drte_engine__on_lines_changed(pEngine, iLine, 1, insertedLineCount + 1);
+
+    // The lines of each view are brought up to date straight away so the cursors below are moved to the right lines.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        if (drte_view_is_word_wrap_enabled(pView)) {
+            drte_view__update_word_wrapping(pView, iLine, insertedLineCount + 1, textLength);
+        } else {
+            drte_view__invalidate_line_measurements(pView, iLine, 1, insertedLineCount + 1, insertIndex - drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iLine));
+        }
+    }
+
+
+
+    // Add the change to the prepared state.
+    if (pEngine->hasPreparedUndoState) {
+        drte_engine__push_text_change_to_prepared_undo_state(pEngine, drte_undo_change_type_insert, insertIndex, insertIndex + textLength, text);
+    }
+
+
+    // Cursors and selections after this cursor need to be updated.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view__update_matches(pView, insertIndex, 0, textLength);
+
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            if (pView->pCursors[iCursor].iCharAbs >= insertIndex) {
+                drte_view_move_cursor_to_character(pView, iCursor, pView->pCursors[iCursor].iCharAbs + textLength);
+            }
+        }
+
+        // As with cursors, selections need to be updated too.
+        drte_view__invalidate_sorted_selections(pView);
+        for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+            drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
+            if (selection.iCharBeg >= insertIndex) {
+                pView->pSelections[iSelection].iCharBeg += textLength;
+                pView->pSelections[iSelection].iCharEnd += textLength;
+            } else {
+                if (selection.iCharEnd >= insertIndex) {
+                    if (pView->pSelections[iSelection].iCharEnd > pView->pSelections[iSelection].iCharBeg) {
+                        pView->pSelections[iSelection].iCharEnd += textLength;
+                    } else {
+                        pView->pSelections[iSelection].iCharBeg += textLength;
+                    }
+                }
+            }
+        }
+    }
+
+
+    // Refresh the lines if line wrap is enabled.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        if (drte_view_is_word_wrap_enabled(pView)) {
+            drte_view__on_word_wrapping_changed(pView);    // <-- This will repaint.
+        } else {
+            drte_view_dirty(pView, drte_view_get_local_rect(pView));
+        }
+    }
+
+
+    if (pEngine->onTextChanged) {
+        pEngine->onTextChanged(pEngine);
+    }
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine_insert_text(drte_engine* pEngine, const char* text, size_t insertIndex)
+{
+    if (pEngine == NULL || text == NULL) {
+        return DRTE_FALSE;
+    }
+
+    if (insertIndex > pEngine->textLength) {
+        return DRTE_FALSE;
+    }
+
+    size_t newTextLength = strlen(text);
+    if (newTextLength == 0) {
+        return DRTE_FALSE;
+    }
+
+    // Text can only be inserted where lines have been indexed.
+    if (!drte_engine__index_lines_to_character(pEngine, insertIndex)) {
+        return DRTE_FALSE;
+    }
+
+    // We need to get the index of the line that's being inserted so we can know how to update the internal line cache.
+    size_t iLine = drte_line_cache_find_line_by_character(pEngine->pUnwrappedLines, insertIndex);
+
+
+    // TODO: Add proper support for UTF-8.
+    if (!drte_piece_table_insert(&pEngine->text, insertIndex, text, newTextLength)) {
+        return DRTE_FALSE;
+    }
+
+    pEngine->textLength = pEngine->text.length;
+
+    return drte_engine__on_text_inserted(pEngine, text, newTextLength, insertIndex, iLine);
+}
+
+drte_bool32 drte_engine_delete_text(drte_engine* pEngine, size_t iFirstCh, size_t iLastChPlus1)
+{
+    if (pEngine == NULL || iLastChPlus1 == iFirstCh) {
+        return DRTE_FALSE;
+    }
+
+    if (iFirstCh > pEngine->textLength) {
+        iFirstCh = pEngine->textLength;
+    }
+
+    if (iLastChPlus1 > pEngine->textLength) {
+        iLastChPlus1 = pEngine->textLength;
+    }
+
+
+    if (iFirstCh > iLastChPlus1) {
+        size_t temp = iFirstCh;
+        iFirstCh = iLastChPlus1;
+        iLastChPlus1 = temp;
+    }
+
+
+    // Text can only be deleted where lines have been indexed, except when deleting everything up to the end in which case the
+    // unindexed text can just be dropped. It never made it into the line cache so it has no lines to remove.
+    size_t iIndexedEnd = iLastChPlus1;
+    if (pEngine->unindexedLength > 0) {
+        if (iLastChPlus1 == pEngine->textLength) {
+            if (!drte_engine__index_lines_to_character(pEngine, iFirstCh)) {
+                return DRTE_FALSE;
+            }
+
+            iIndexedEnd = pEngine->textLength - pEngine->unindexedLength;
+            pEngine->unindexedLength = 0;
+        } else {
+            if (!drte_engine__index_lines_to_character(pEngine, iLastChPlus1)) {
+                return DRTE_FALSE;
+            }
+        }
+    }
+
+    // We need to get the index of the line that's being inserted so we can know how to update the internal line cache.
+    size_t iLine = drte_line_cache_find_line_by_character(pEngine->pUnwrappedLines, iFirstCh);
+
+    size_t linesRemovedCount = drte_piece_table_count_newlines(&pEngine->text, iFirstCh, iIndexedEnd);
+
+
+    size_t bytesToRemove = iLastChPlus1 - iFirstCh;
+    if (bytesToRemove > 0)
+    {
+        // Update cursors and selections _before_ deleting the text.
+        size_t iCharBeg = iFirstCh;
+        size_t iCharEnd = iLastChPlus1;
+        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+            for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+                size_t iCursorChar = pView->pCursors[iCursor].iCharAbs;
+                if (iCursorChar > iCharBeg && iCursorChar <= iCharEnd) {
+                    drte_view_move_cursor_to_character(pView, iCursor, iCharBeg);
+                } else {
+                    if (iCursorChar >= iCharEnd) {
+                        drte_view_move_cursor_to_character(pView, iCursor, iCursorChar - (iCharEnd - iCharBeg));
+                    }
+                }
+            }
+
+            // <---> = selection
+            // |---| = selectionToDelete
+            drte_view__invalidate_sorted_selections(pView);
+            for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+                drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
+                if (selection.iCharBeg < iCharBeg) {
+                    if (selection.iCharEnd > iCharBeg) {
+                        if (selection.iCharEnd < iCharEnd) {
+                            // <---|--->---|
+                            selection.iCharEnd = iCharBeg;
+                        } else {
+                            // <---|---|--->
+                            selection.iCharEnd -= iCharEnd - iCharBeg;
+                        }
+                    }
+                } else {
+                    if (selection.iCharBeg < iCharEnd) {
+                        if (selection.iCharEnd < iCharEnd) {
+                            // |---<--->---|
+                            selection.iCharBeg = selection.iCharEnd = iCharBeg;
+                        } else {
+                            // |---<---|--->
+                            selection.iCharEnd -= (iCharEnd - selection.iCharBeg);
+                            selection.iCharBeg  = iCharBeg;
+                        }
+                    } else {
+                        selection.iCharBeg -= (iCharEnd - iCharBeg);
+                        selection.iCharEnd -= (iCharEnd - iCharBeg);
+                    }
+                }
+
+                if (pView->pSelections[iSelection].iCharBeg < pView->pSelections[iSelection].iCharEnd) {
+                    pView->pSelections[iSelection].iCharBeg = selection.iCharBeg;
+                    pView->pSelections[iSelection].iCharEnd = selection.iCharEnd;
+                } else {
+                    pView->pSelections[iSelection].iCharBeg = selection.iCharEnd;
+                    pView->pSelections[iSelection].iCharEnd = selection.iCharBeg;
+                }
+            }
+        }
+
+
+
+        // Add the change to the prepared state.
+        if (pEngine->hasPreparedUndoState) {
+            drte_engine__push_text_change_to_prepared_undo_state(pEngine, drte_undo_change_type_delete, iFirstCh, iLastChPlus1, drte_engine__get_text_range(pEngine, iFirstCh, iLastChPlus1));
+        }
+
+
+        if (!drte_piece_table_delete(&pEngine->text, iFirstCh, iLastChPlus1)) {
+            return DRTE_FALSE;
+        }
+
+        pEngine->textLength = pEngine->text.length;
+
+        if (linesRemovedCount > 0) {
+            if (!drte_line_cache_remove_lines(pEngine->pUnwrappedLines, iLine+1, linesRemovedCount, bytesToRemove)) {
+                return DRTE_FALSE;
+            }
+        } else {
+            // No lines were removed, but we still need to update the character positions of the line cache.
+            drte_line_cache_offset_lines_negative(pEngine->pUnwrappedLines, iLine+1, bytesToRemove);
+        }
+
+        drte_engine__on_lines_changed(pEngine, iLine, linesRemovedCount + 1, 1);
+
+
+        // Re-wrap the line the text was deleted from if line wrap is enabled.
+        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+            drte_view__update_matches(pView, iFirstCh, bytesToRemove, 0);
+
+            if (drte_view_is_word_wrap_enabled(pView)) {
+                drte_view__update_word_wrapping(pView, iLine, 1, 0 - bytesToRemove);
+                drte_view__on_word_wrapping_changed(pView);    // <-- This will repaint.
+            } else {
+                drte_view__invalidate_line_measurements(pView, iLine, linesRemovedCount + 1, 1, iFirstCh - drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iLine));
+
+                // After line each cursor is sitting on may have changed.
+                for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+                    drte_view_move_cursor_to_character(pView, iCursor, pView->pCursors[iCursor].iCharAbs);
+                }
+
+                drte_view_dirty(pView, drte_view_get_local_rect(pView));
+            }
+        }
+        
+
+        if (pEngine->onTextChanged) {
+            pEngine->onTextChanged(pEngine);
+        }
+
+        return DRTE_TRUE;
+    }
+
+    return DRTE_FALSE;
+}
+
+// Rebuilds the line cache after the piece table has been rebuilt as a single contiguous piece by a replacement.
+drte_bool32 drte_engine__rebuild_line_cache_after_replace(drte_engine* pEngine)
+{
+    assert(pEngine != NULL);
+
+    pEngine->textLength = pEngine->text.length;
+    pEngine->unindexedLength = 0;
+
+    // The new text is contiguous so the line cache can be rebuilt from scratch in one go. This also takes care of any lines that
+    // were still waiting to be indexed.
+    const char* newText = drte_piece_table_get_text_range(&pEngine->text, 0, pEngine->textLength);
+    size_t lineCount = 1 + drte__count_newlines(newText, pEngine->textLength);
+
+    size_t* pLineOffsets = (size_t*)malloc(lineCount * sizeof(*pLineOffsets));
+    if (pLineOffsets == NULL) {
+        return DRTE_FALSE;
+    }
+
+    pLineOffsets[0] = 0;
+    drte_find_line_offsets(newText, pEngine->textLength, pLineOffsets + 1, lineCount - 1, NULL);
+
+    // The line cache stores each line relative to the previous one.
+    for (size_t iLine = lineCount-1; iLine > 0; --iLine) {
+        pLineOffsets[iLine] -= pLineOffsets[iLine-1];
+    }
+
+    drte_bool32 result = drte_line_cache__rebuild(pEngine->pUnwrappedLines, pLineOffsets, lineCount);
+    free(pLineOffsets);
+
+    drte_engine__reset_lexer(pEngine);
+
+    return result;
+}
+
+// Maps a character from before a call to drte_engine__replace_ranges() to where it ends up afterwards. A character inside one of the
+// ranges is moved to the start of it's replacement.
+size_t drte_engine__map_character_through_ranges(size_t iChar, const size_t* pRangeBegs, size_t rangeCount, size_t rangeLength, size_t textLength)
+{
+    // Binary search for the number of ranges starting before the character.
+    size_t iLo = 0;
+    size_t iHi = rangeCount;
+    while (iLo < iHi) {
+        size_t iMid = iLo + (iHi - iLo)/2;
+        if (pRangeBegs[iMid] < iChar) {
+            iLo = iMid + 1;
+        } else {
+            iHi = iMid;
+        }
+    }
+
+    if (iLo > 0 && iChar < pRangeBegs[iLo-1] + rangeLength) {
+        return pRangeBegs[iLo-1] - (iLo-1)*rangeLength + (iLo-1)*textLength;
+    }
+
+    return iChar - iLo*rangeLength + iLo*textLength;
+}
+
+drte_bool32 drte_engine__replace_ranges(drte_engine* pEngine, const size_t* pRangeBegs, size_t rangeCount, size_t rangeLength, const char* text, size_t textLength)
+{
+    assert(pEngine != NULL);
+
+    if (rangeCount == 0 || pRangeBegs[rangeCount-1] + rangeLength > pEngine->textLength) {
+        return DRTE_FALSE;
+    }
+
+    // Add the change to the prepared state. Every range has the same text so only the first one needs to be stored.
+    if (pEngine->hasPreparedUndoState) {
+        const char* oldText = drte_engine__get_text_range(pEngine, pRangeBegs[0], pRangeBegs[0] + rangeLength);
+        drte_engine__push_replace_to_prepared_undo_state(pEngine, pRangeBegs, rangeCount, oldText, rangeLength, text, textLength);
+    }
+
+    if (!drte_piece_table_replace_ranges(&pEngine->text, pRangeBegs, rangeCount, rangeLength, text, textLength)) {
+        return DRTE_FALSE;
+    }
+
+    if (!drte_engine__rebuild_line_cache_after_replace(pEngine)) {
+        return DRTE_FALSE;
+    }
+
+
+    // Cursors and selections are mapped to their new positions. Matches could be anywhere so they are found again from scratch.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view__reset_matches(pView);
+
+        drte_view__invalidate_sorted_selections(pView);
+        for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+            pView->pSelections[iSelection].iCharBeg = drte_engine__map_character_through_ranges(pView->pSelections[iSelection].iCharBeg, pRangeBegs, rangeCount, rangeLength, textLength);
+            pView->pSelections[iSelection].iCharEnd = drte_engine__map_character_through_ranges(pView->pSelections[iSelection].iCharEnd, pRangeBegs, rangeCount, rangeLength, textLength);
+        }
+
+        if (drte_view_is_word_wrap_enabled(pView)) {
+            drte_view__refresh_word_wrapping(pView);    // <-- This will repaint.
+        } else {
+            drte_view__clear_measurements(pView);       // Any line could have changed.
+            drte_view_dirty(pView, drte_view_get_local_rect(pView));
+        }
+
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            drte_view_move_cursor_to_character(pView, iCursor, drte_engine__map_character_through_ranges(pView->pCursors[iCursor].iCharAbs, pRangeBegs, rangeCount, rangeLength, textLength));
+        }
+    }
+
+
+    if (pEngine->onTextChanged) {
+        pEngine->onTextChanged(pEngine);
+    }
+
+    return DRTE_TRUE;
+}
+
+// Maps a character from before a call to drte_engine__replace_regions() to where it ends up afterwards. <pNewRegionBegs> is where each
+// region starts after the change. A character inside one of the regions is moved to the start of it's replacement.
+size_t drte_engine__map_character_through_regions(size_t iChar, const drte_region* pRegions, size_t regionCount, const size_t* pNewRegionBegs, const size_t* pNewTextLengths)
+{
+    size_t iLo = 0;
+    size_t iHi = regionCount;
+    while (iLo < iHi) {
+        size_t iMid = iLo + (iHi - iLo)/2;
+        if (pRegions[iMid].iCharBeg < iChar) {
+            iLo = iMid + 1;
+        } else {
+            iHi = iMid;
+        }
+    }
+
+    if (iLo == 0) {
+        return iChar;
+    }
+
+    const drte_region* pRegion = &pRegions[iLo-1];
+    if (iChar < pRegion->iCharEnd) {
+        return pNewRegionBegs[iLo-1];
+    }
+
+    return iChar - pRegion->iCharEnd + pNewRegionBegs[iLo-1] + pNewTextLengths[iLo-1];
+}
+
+// Replaces a single region of the text, updating the lines, lexer states, matches and word wrapping the same way as drte_engine_insert_text()
+// and drte_engine_delete_text(). Cursors, selections, undo and repainting are left to the caller. Lines must have been indexed up to the
+// end of the region.
+drte_bool32 drte_engine__replace_region_in_place(drte_engine* pEngine, drte_region region, const char* text, size_t textLength)
+{
+    assert(pEngine != NULL);
+    assert(region.iCharBeg <= region.iCharEnd);
+
+    size_t iLine = drte_line_cache_find_line_by_character(pEngine->pUnwrappedLines, region.iCharBeg);
+    size_t iLineCharBeg = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, iLine);
+    size_t oldUnwrappedLineCount = drte_line_cache_get_line_count(pEngine->pUnwrappedLines);
+
+    size_t removedLength = region.iCharEnd - region.iCharBeg;
+    size_t removedLineCount = 0;
+    if (removedLength > 0) {
+        removedLineCount = drte_piece_table_count_newlines(&pEngine->text, region.iCharBeg, region.iCharEnd);
+        if (!drte_piece_table_delete(&pEngine->text, region.iCharBeg, region.iCharEnd)) {
+            return DRTE_FALSE;
+        }
+
+        if (removedLineCount > 0) {
+            if (!drte_line_cache_remove_lines(pEngine->pUnwrappedLines, iLine+1, removedLineCount, removedLength)) {
+                return DRTE_FALSE;
+            }
+        } else {
+            drte_line_cache_offset_lines_negative(pEngine->pUnwrappedLines, iLine+1, removedLength);
+        }
+    }
+
+    if (textLength > 0) {
+        if (!drte_piece_table_insert(&pEngine->text, region.iCharBeg, text, textLength)) {
+            return DRTE_FALSE;
+        }
+
+        if (!drte_line_cache_insert_lines_from_text(pEngine->pUnwrappedLines, iLine+1, region.iCharBeg, text, textLength)) {
+            return DRTE_FALSE;
+        }
+    }
+
+    pEngine->textLength = pEngine->text.length;
+
+    // The lexer states need to be shifted before the views are re-wrapped because wrapping lexes the new text.
+    size_t insertedLineCount = drte_line_cache_get_line_count(pEngine->pUnwrappedLines) + removedLineCount - oldUnwrappedLineCount;
+    drte_engine__on_lines_changed(pEngine, iLine, removedLineCount + 1, insertedLineCount + 1);
+
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view__update_matches(pView, region.iCharBeg, removedLength, textLength);
+
+        if (drte_view_is_word_wrap_enabled(pView)) {
+            drte_view__update_word_wrapping(pView, iLine, insertedLineCount + 1, textLength - removedLength);
+        } else {
+            drte_view__invalidate_line_measurements(pView, iLine, removedLineCount + 1, insertedLineCount + 1, region.iCharBeg - iLineCharBeg);
+        }
+    }
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine__replace_regions(drte_engine* pEngine, const drte_region* pRegions, size_t regionCount, const char* pTexts, const size_t* pTextLengths)
+{
+    assert(pEngine != NULL);
+
+    if (regionCount == 0 || pRegions[regionCount-1].iCharEnd > pEngine->textLength) {
+        return DRTE_FALSE;
+    }
+
+    // Small batches, which includes typing at each cursor, are applied one region at a time so that only the lines they touch need to
+    // be updated. Large batches rebuild the text and everything that depends on it in one go, which is quicker than updating it once
+    // for every region.
+    drte_bool32 isInPlace = regionCount <= DRTE_REPLACE_REGIONS_IN_PLACE_LIMIT;
+    if (isInPlace && !drte_engine__index_lines_to_character(pEngine, pRegions[regionCount-1].iCharEnd)) {
+        return DRTE_FALSE;
+    }
+
+    size_t* pNewRegionBegs = (size_t*)malloc(regionCount * sizeof(*pNewRegionBegs));
+    if (pNewRegionBegs == NULL) {
+        return DRTE_FALSE;
+    }
+
+    size_t offset = 0;
+    size_t totalTextLength = 0;
+    for (size_t iRegion = 0; iRegion < regionCount; ++iRegion) {
+        pNewRegionBegs[iRegion] = pRegions[iRegion].iCharBeg + offset;
+        offset = offset + pTextLengths[iRegion] - (pRegions[iRegion].iCharEnd - pRegions[iRegion].iCharBeg);
+        totalTextLength += pTextLengths[iRegion];
+    }
+
+    if (pEngine->hasPreparedUndoState) {
+        drte_engine__push_replace_regions_to_prepared_undo_state(pEngine, pRegions, regionCount, pTexts, pTextLengths);
+    }
+
+    if (isInPlace) {
+        // Regions are applied from the last to the first so the ones still to be applied don't move.
+        const char* pText = pTexts + totalTextLength;
+        for (size_t iRegion = regionCount; iRegion > 0; --iRegion) {
+            pText -= pTextLengths[iRegion-1];
+            if (!drte_engine__replace_region_in_place(pEngine, pRegions[iRegion-1], pText, pTextLengths[iRegion-1])) {
+                free(pNewRegionBegs);
+                return DRTE_FALSE;
+            }
+        }
+    } else {
+        if (!drte_piece_table_replace_regions(&pEngine->text, pRegions, regionCount, pTexts, pTextLengths) || !drte_engine__rebuild_line_cache_after_replace(pEngine)) {
+            free(pNewRegionBegs);
+            return DRTE_FALSE;
+        }
+    }
+
+
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view__invalidate_sorted_selections(pView);
+        for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+            pView->pSelections[iSelection].iCharBeg = drte_engine__map_character_through_regions(pView->pSelections[iSelection].iCharBeg, pRegions, regionCount, pNewRegionBegs, pTextLengths);
+            pView->pSelections[iSelection].iCharEnd = drte_engine__map_character_through_regions(pView->pSelections[iSelection].iCharEnd, pRegions, regionCount, pNewRegionBegs, pTextLengths);
+        }
+
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            drte_view_move_cursor_to_character(pView, iCursor, drte_engine__map_character_through_regions(pView->pCursors[iCursor].iCharAbs, pRegions, regionCount, pNewRegionBegs, pTextLengths));
+        }
+
+        if (isInPlace) {
+            if (drte_view_is_word_wrap_enabled(pView)) {
+                drte_view__on_word_wrapping_changed(pView);    // <-- This will repaint.
+            } else {
+                drte_view_dirty(pView, drte_view_get_local_rect(pView));
+            }
+        } else {
+            drte_view__reset_matches(pView);
+
+            if (drte_view_is_word_wrap_enabled(pView)) {
+                drte_view__refresh_word_wrapping(pView);    // <-- This will repaint.
+            } else {
+                drte_view__clear_measurements(pView);       // Any line could have changed.
+                drte_view_dirty(pView, drte_view_get_local_rect(pView));
+            }
+        }
+    }
+
+    free(pNewRegionBegs);
+
+    if (pEngine->onTextChanged) {
+        pEngine->onTextChanged(pEngine);
+    }
+
+    return DRTE_TRUE;
+}
+
+
+drte_bool32 drte_engine_get_start_of_word_containing_character(drte_engine* pEngine, size_t iChar, size_t* pWordBegOut)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    if (iChar > 0) {
+        iChar -= 1;
+
+        // Skip whitespace.
+        if (drte_is_whitespace(drte_engine__get_char(pEngine, iChar))) {
+            while (iChar > 0) {
+                if (!drte_is_whitespace(drte_engine__get_char(pEngine, iChar))) {
+                    break;
+                }
+
+                iChar -= 1;
+            }
+        }
+
+        if (!drte_is_symbol_or_whitespace(drte_engine__get_char(pEngine, iChar))) {
+            while (iChar > 0) {
+                uint32_t c = drte_engine__get_char(pEngine, iChar-1);
+                if (drte_is_symbol_or_whitespace(c)) {
+                    break;
+                }
+
+                iChar -= 1;
+            }
+        }
+    }
+
+    if (pWordBegOut) *pWordBegOut = iChar;
+    return DRTE_TRUE;
+}
+
+
+drte_bool32 drte_engine_get_start_of_next_word_from_character(drte_engine* pEngine, size_t iChar, size_t* pWordBegOut)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    while (drte_engine__get_char(pEngine, iChar) != '\0' && drte_engine__get_char(pEngine, iChar) != '\n' && !(drte_engine__get_char(pEngine, iChar) == '\r' && drte_engine__get_char(pEngine, iChar+1))) {
+        uint32_t c = drte_engine__get_char(pEngine, iChar);
+        if (!drte_is_whitespace(c)) {
+            break;
+        }
+
+        iChar += 1;
+    }
+
+    if (pWordBegOut) *pWordBegOut = iChar;
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine_get_end_of_word_containing_character(drte_engine* pEngine, size_t iChar, size_t* pWordEndOut)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    if (!drte_is_symbol_or_whitespace(drte_engine__get_char(pEngine, iChar))) {
+        while (drte_engine__get_char(pEngine, iChar) != '\0' && drte_engine__get_char(pEngine, iChar) != '\n' && !(drte_engine__get_char(pEngine, iChar) == '\r' && drte_engine__get_char(pEngine, iChar+1))) {
+            uint32_t c = drte_engine__get_char(pEngine, iChar);
+            if (drte_is_symbol_or_whitespace(c)) {
+                break;
+            }
+
+            iChar += 1;
+        }
+    } else {
+        if (drte_engine__get_char(pEngine, iChar) != '\n' && !(drte_engine__get_char(pEngine, iChar) == '\r' && drte_engine__get_char(pEngine, iChar+1))) {
+            iChar += 1;
+        }
+    }
+
+    if (pWordEndOut) *pWordEndOut = iChar;
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine_get_word_containing_character(drte_engine* pEngine, size_t iChar, size_t* pWordBegOut, size_t* pWordEndOut)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    drte_bool32 moveToStartOfNextWord = DRTE_FALSE;
+
+    // Move to the start of the word if we're not already there.
+    if (iChar > 0) {
+        uint32_t c = drte_engine__get_char(pEngine, iChar);
+        uint32_t cprev = drte_engine__get_char(pEngine, iChar-1);
+
+        if (c == '\0') {
+            if (pWordBegOut) *pWordBegOut = pEngine->textLength;
+            if (pWordEndOut) *pWordEndOut = pEngine->textLength;
+            return DRTE_FALSE;
+        }
+
+        if (!drte_is_whitespace(c) && !drte_is_whitespace(cprev) && !drte_is_symbol_or_whitespace(c)) {
+            drte_engine_get_start_of_word_containing_character(pEngine, iChar, &iChar);
+        } else if (drte_is_whitespace(c) && drte_is_whitespace(cprev)) {
+            drte_engine__index_lines_to_character(pEngine, iChar);
+            size_t iLineCharBeg = drte_line_cache_get_line_first_character(pEngine->pUnwrappedLines, drte_line_cache_find_line_by_character(pEngine->pUnwrappedLines, iChar));
+            while (iChar > 0 && iChar > iLineCharBeg) {
+                if (!drte_is_whitespace(drte_engine__get_char(pEngine, iChar-1))) {
+                    break;
+                }
+                iChar -= 1;
+            }
+
+            moveToStartOfNextWord = DRTE_TRUE;
+        }
+    }
+
+    size_t iWordCharEnd;
+    drte_bool32 result;
+    if (moveToStartOfNextWord) {
+        result = drte_engine_get_start_of_next_word_from_character(pEngine, iChar, &iWordCharEnd);
+    } else {
+        result = drte_engine_get_end_of_word_containing_character(pEngine, iChar, &iWordCharEnd);
+    }
+
+    if (pWordBegOut) *pWordBegOut = iChar;
+    if (pWordEndOut) *pWordEndOut = iWordCharEnd;
+
+    if (result) {
+        result = iChar < iWordCharEnd;
+    }
+
+    return result;
+}
+
+
+
+
+drte_bool32 drte_engine__capture_and_push_undo_state__user_data(drte_engine* pEngine, drte_stack_buffer* pStack)
+{
+    assert(pEngine != NULL);
+    assert(pStack != NULL);
+
+    // Make room in the undo buffer for the application-defined prepared state.
+    size_t preparedStateUserDataSize = 0;
+    if (pEngine->onGetUndoState) {
+        preparedStateUserDataSize = pEngine->onGetUndoState(pEngine, NULL);
+    }
+
+    void* pPreparedUserData = drte_stack_buffer_alloc(pStack, sizeof(size_t) + preparedStateUserDataSize);     // <-- sizeof(size_t) is for storing the size of the user data.
+    if (pPreparedUserData == NULL) {
+        return DRTE_FALSE;
+    }
+
+    *(size_t*)pPreparedUserData = preparedStateUserDataSize;
+    if (preparedStateUserDataSize > 0) {
+        if (pEngine->onGetUndoState(pEngine, (uint8_t*)pPreparedUserData + sizeof(size_t)) != preparedStateUserDataSize) {
+            return DRTE_FALSE;   // Inconsistent data size returned by onGetUndoState().
+        }
+    }
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine__capture_and_push_undo_state__cursors(drte_engine* pEngine, drte_stack_buffer* pStack, drte_view* pView)
+{
+    assert(pEngine != NULL);
+    assert(pStack != NULL);
+    assert(pView != NULL);
+
+    (void)pEngine;
+
+    size_t sizeInBytes =
+        sizeof(pView->cursorCount) +
+        sizeof(drte_cursor) * pView->cursorCount;
+
+    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(pStack, sizeInBytes);
+    if (pData == NULL) {
+        return DRTE_FALSE;
+    }
+
+    memcpy(pData, &pView->cursorCount, sizeof(pView->cursorCount));
+    memcpy(pData + sizeof(pView->cursorCount), pView->pCursors, sizeof(drte_cursor) * pView->cursorCount);
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine__capture_and_push_undo_state__selections(drte_engine* pEngine, drte_stack_buffer* pStack, drte_view* pView)
+{
+    assert(pEngine != NULL);
+    assert(pStack != NULL);
+    assert(pView != NULL);
+
+    (void)pEngine;
+
+    size_t sizeInBytes =
+        sizeof(pView->selectionCount) +
+        sizeof(drte_region) * pView->selectionCount;
+
+    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(pStack, sizeInBytes);
+    if (pData == NULL) {
+        return DRTE_FALSE;
+    }
+
+    memcpy(pData, &pView->selectionCount, sizeof(pView->selectionCount));
+    memcpy(pData + sizeof(pView->selectionCount), pView->pSelections, sizeof(drte_region) * pView->selectionCount);
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine__capture_and_push_undo_state__view(drte_engine* pEngine, drte_stack_buffer* pStack, drte_view* pView)
+{
+    if (pEngine == NULL || pStack == NULL || pView == NULL) {
+        return DRTE_FALSE;
+    }
+
+    size_t sizeInBytes = 
+        sizeof(pView->_id);
+
+    uint8_t* pData = (uint8_t*)drte_stack_buffer_alloc(pStack, sizeInBytes);
+    if (pData == NULL) {
+        return DRTE_FALSE;
+    }
+
+    memcpy(pData, &pView->_id, sizeof(pView->_id));
+
+    if (!drte_engine__capture_and_push_undo_state__cursors(pEngine, pStack, pView)) {
+        return DRTE_FALSE;
+    }
+
+    if (!drte_engine__capture_and_push_undo_state__selections(pEngine, pStack, pView)) {
+        return DRTE_FALSE;
+    }
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine__capture_and_push_undo_state(drte_engine* pEngine, drte_stack_buffer* pStack)
+{
+    if (pEngine == NULL || pStack == NULL) {
+        return DRTE_FALSE;
+    }
+
+    size_t oldStackPtr = drte_stack_buffer_get_stack_ptr(pStack);
+
+    if (!drte_engine__capture_and_push_undo_state__user_data(pEngine, pStack)) {
+        drte_stack_buffer_set_stack_ptr(pStack, oldStackPtr);
+        return DRTE_FALSE;
+    }
+
+
+    // There is state that needs to be captured for each view. We'll need to view count to begin with.
+    size_t *pViewCount = (size_t*)drte_stack_buffer_alloc(pStack, sizeof(size_t));
+    if (pViewCount == NULL) {
+        drte_stack_buffer_set_stack_ptr(pStack, oldStackPtr);
+        return DRTE_FALSE;
+    }
+
+    *pViewCount = drte_engine_get_view_count(pEngine);
+
+
+    // Each view...
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        if (!drte_engine__capture_and_push_undo_state__view(pEngine, pStack, pView)) {
+            drte_stack_buffer_set_stack_ptr(pStack, oldStackPtr);
+            return DRTE_FALSE;
+        }
+    }
+
+    return DRTE_TRUE;
+}
+
+// Retrieves a pointer to the data at the given offset of the undo history, taking into account the data that has been removed
+// from the front of the buffer.
+DRTE_INLINE void* drte_engine__get_undo_data_ptr(drte_engine* pEngine, size_t offset)
+{
+    assert(offset >= pEngine->undoBufferDiscardedSize);
+    return drte_stack_buffer_get_data_ptr(&pEngine->undoBuffer, offset - pEngine->undoBufferDiscardedSize);
+}
+
+// Retrieves the offset of the end of the undo history.
+DRTE_INLINE size_t drte_engine__get_undo_data_end_offset(drte_engine* pEngine)
+{
+    return drte_stack_buffer_get_stack_ptr(&pEngine->undoBuffer) + pEngine->undoBufferDiscardedSize;
+}
+
+// Removes everything in the undo history from the given offset onwards.
+DRTE_INLINE void drte_engine__set_undo_data_end_offset(drte_engine* pEngine, size_t offset)
+{
+    assert(offset >= pEngine->undoBufferDiscardedSize);
+    drte_stack_buffer_set_stack_ptr(&pEngine->undoBuffer, offset - pEngine->undoBufferDiscardedSize);
+}
+
+size_t drte_engine__get_prev_undo_data_offset(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    if (pEngine->undoBuffer.pBuffer == NULL || pEngine->undoStackCount == 0) {
+        return 0;
+    }
+
+    return *((size_t*)drte_engine__get_undo_data_ptr(pEngine, pEngine->currentUndoDataOffset + 0));
+}
+
+size_t drte_engine__get_next_undo_data_offset(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    if (pEngine->undoBuffer.pBuffer == NULL || pEngine->undoStackCount == 0) {
+        return 0;
+    }
+
+    return *((size_t*)drte_engine__get_undo_data_ptr(pEngine, pEngine->currentUndoDataOffset + sizeof(size_t)));
+}
+
+
+typedef struct drte_undo_state_view_info drte_undo_state_view_info;
+struct drte_undo_state_view_info
+{
+    size_t id;
+    size_t cursorCount;
+    const drte_cursor* pCursors;
+    size_t selectionCount;
+    const drte_region* pSelections;
+};
+
+typedef struct
+{
+    size_t prevUndoDataOffset;
+    size_t nextUndoDataOffset;
+    size_t oldStateLocalOffset;
+    size_t newStateLocalOffset;
+    size_t textChangesOffset;
+
+    size_t textChangeCount;
+    const uint8_t* pTextChanges;
+
+    const uint8_t* pOldState;
+    const uint8_t* pNewState;
+
+    struct
+    {
+        size_t userDataSize;
+        const void* pUserData;
+        size_t viewCount;
+        size_t firstViewOffset;
+    } oldState;
+
+    struct
+    {
+        size_t userDataSize;
+        const void* pUserData;
+        size_t viewCount;
+        size_t firstViewOffset;
+    } newState;
+} drte_undo_state_info;
+
+void drte_engine__breakdown_undo_state_view_info(const uint8_t* pUndoData, drte_undo_state_view_info* pInfoOut, size_t* pBytesReadOut)
+{
+    size_t runningOffset = 0;
+    pInfoOut->id             = *(const size_t*)     (pUndoData + runningOffset); runningOffset += sizeof(size_t);
+    pInfoOut->cursorCount    = *(const size_t*)     (pUndoData + runningOffset); runningOffset += sizeof(size_t);
+    pInfoOut->pCursors       =  (const drte_cursor*)(pUndoData + runningOffset); runningOffset += sizeof(drte_cursor)*pInfoOut->cursorCount;
+    pInfoOut->selectionCount = *(const size_t*)     (pUndoData + runningOffset); runningOffset += sizeof(size_t);
+    pInfoOut->pSelections    =  (const drte_region*)(pUndoData + runningOffset); runningOffset += sizeof(drte_region)*pInfoOut->selectionCount;
+
+    *pBytesReadOut = runningOffset;
+}
+
+DRTE_INLINE void drte_engine__breakdown_undo_state_info(const uint8_t* pUndoData, drte_undo_state_info* pInfoOut)
+{
+    assert(pInfoOut != NULL);
+
+    drte_undo_state_info result;
+    result.prevUndoDataOffset  = *(const size_t*)(pUndoData + sizeof(size_t)*0);
+    result.nextUndoDataOffset  = *(const size_t*)(pUndoData + sizeof(size_t)*1);
+    result.oldStateLocalOffset = *(const size_t*)(pUndoData + sizeof(size_t)*2);
+    result.newStateLocalOffset = *(const size_t*)(pUndoData + sizeof(size_t)*3);
+    result.textChangesOffset   = *(const size_t*)(pUndoData + sizeof(size_t)*4);
+
+    result.textChangeCount = *(const size_t*)(pUndoData + result.textChangesOffset);
+    result.pTextChanges = pUndoData + result.textChangesOffset + sizeof(size_t);
+
+    result.pOldState = pUndoData + result.oldStateLocalOffset;
+    result.pNewState = pUndoData + result.newStateLocalOffset;
+
+    size_t runningOffset = 0;
+    result.oldState.userDataSize = *(const size_t*)(result.pOldState + runningOffset); runningOffset += sizeof(size_t);
+    result.oldState.pUserData = result.pOldState + runningOffset;                      runningOffset += result.oldState.userDataSize;
+    result.oldState.viewCount = *(const size_t*)(result.pOldState + runningOffset);    runningOffset += sizeof(size_t);
+    result.oldState.firstViewOffset = result.oldStateLocalOffset + runningOffset;
+
+    runningOffset = 0;
+    result.newState.userDataSize = *(const size_t*)(result.pNewState + runningOffset); runningOffset += sizeof(size_t);
+    result.newState.pUserData = result.pNewState + runningOffset;                      runningOffset += result.newState.userDataSize;
+    result.newState.viewCount = *(const size_t*)(result.pNewState + runningOffset);    runningOffset += sizeof(size_t);
+    result.newState.firstViewOffset = result.newStateLocalOffset + runningOffset;
+
+    *pInfoOut = result;
+}
+
+
+// Evicts the oldest undo points until the undo stack fits within the memory budget. The current undo point is never evicted.
+void drte_engine__evict_undo_points(drte_engine* pEngine)
+{
+    assert(pEngine != NULL);
+
+    if (pEngine->undoMemoryBudget == 0) {
+        return;
+    }
+
+    // The undo points are linked by their offsets so evicting the oldest is just a matter of moving the first offset to the next one.
+    unsigned int evictedCount = 0;
+    while (pEngine->iUndoState > 1 && (drte_engine__get_undo_data_end_offset(pEngine) - pEngine->firstUndoDataOffset) > pEngine->undoMemoryBudget) {
+        pEngine->firstUndoDataOffset = *((size_t*)drte_engine__get_undo_data_ptr(pEngine, pEngine->firstUndoDataOffset + sizeof(size_t)));
+        pEngine->undoStackCount -= 1;
+        pEngine->iUndoState -= 1;
+        evictedCount += 1;
+    }
+
+    if (evictedCount == 0) {
+        return;
+    }
+
+    pEngine->evictedUndoPointCount += evictedCount;
+
+    // The memory of evicted points is only given back once there's at least as much of it as there is memory still in use. This
+    // keeps the cost of moving the remaining points down to the front of the buffer constant when spread over each eviction.
+    size_t evictedSize = pEngine->firstUndoDataOffset - pEngine->undoBufferDiscardedSize;
+    if (evictedSize >= drte_engine__get_undo_data_end_offset(pEngine) - pEngine->firstUndoDataOffset) {
+        drte_stack_buffer_remove_front(&pEngine->undoBuffer, evictedSize);
+        pEngine->undoBufferDiscardedSize = pEngine->firstUndoDataOffset;
+    }
+
+    if (pEngine->onUndoPointsEvicted) {
+        pEngine->onUndoPointsEvicted(pEngine, evictedCount);
+    }
+}
+
+drte_bool32 drte_engine_prepare_undo_point(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    // If we have a previously prepared state we'll need to clear it.
+    if (pEngine->hasPreparedUndoState) {
+        drte_stack_buffer_set_stack_ptr(&pEngine->preparedUndoState, 0);
+    }
+
+    // If the prepared undo point is cancelled later on we'll need to free the memory at some point.
+    pEngine->preparedUndoTextChangeCount = 0;
+    pEngine->hasPreparedUndoState = drte_engine__capture_and_push_undo_state(pEngine, &pEngine->preparedUndoState);
+    if (!pEngine->hasPreparedUndoState) {
+        return DRTE_FALSE;   // <-- An error occured while trying to capture the undo state.
+    }
+
+    // Allocate space for the text change count and initialize to 0 to begin with.
+    pEngine->preparedUndoTextChangesOffset = drte_stack_buffer_get_stack_ptr(&pEngine->preparedUndoState);
+    void* pTextChangeCount = drte_stack_buffer_alloc(&pEngine->preparedUndoState, sizeof(size_t));
+    if (pTextChangeCount == NULL) {
+        pEngine->hasPreparedUndoState = DRTE_FALSE;
+        return DRTE_FALSE;
+    }
+
+    *(size_t*)pTextChangeCount = 0;
+
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine_commit_undo_point(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    // The undo point must have been prepared earlier.
+    if (!pEngine->hasPreparedUndoState) {
+        return DRTE_FALSE;
+    }
+
+
+
+    // The undo buffer needs to be trimmed.
+    if (drte_engine_get_redo_points_remaining_count(pEngine) > 0) {
+        drte_engine__set_undo_data_end_offset(pEngine, pEngine->currentRedoDataOffset);
+        if (pEngine->onUndoStackTrimmed) pEngine->onUndoStackTrimmed(pEngine);
+    }
+
+    pEngine->undoStackCount = pEngine->iUndoState;
+
+
+    // The data to push onto the stack is done in 3 main parts. The first part is the header which stores the size and offsets of each major section. The
+    // second part is the prepared data. The third part is the state at the time of comitting.
+    
+    // Header.
+    size_t headerSize =
+        sizeof(size_t) +    // Prev undo data offset.
+        sizeof(size_t) +    // Next undo data offset.
+        sizeof(size_t) +    // Old state local offset.
+        sizeof(size_t) +    // New state local offset.
+        sizeof(size_t);     // The offset of the text changes.
+    size_t headerOffset = drte_engine__get_undo_data_end_offset(pEngine);
+
+    if (drte_stack_buffer_alloc(&pEngine->undoBuffer, headerSize) == NULL) {
+        drte_engine__set_undo_data_end_offset(pEngine, headerOffset);
+        return DRTE_FALSE;
+    }
+
+
+    // Prepared data.
+    size_t preparedDataSize = drte_stack_buffer_get_stack_ptr(&pEngine->preparedUndoState);
+    size_t preparedDataOffset = drte_engine__get_undo_data_end_offset(pEngine);
+
+    if (drte_stack_buffer_alloc(&pEngine->undoBuffer, preparedDataSize) == NULL) {
+        drte_engine__set_undo_data_end_offset(pEngine, headerOffset);
+        return DRTE_FALSE;
+    }
+
+    memcpy(drte_engine__get_undo_data_ptr(pEngine, preparedDataOffset), drte_stack_buffer_get_data_ptr(&pEngine->preparedUndoState, 0), preparedDataSize);
+
+
+    // Committed data.
+    size_t committedDataOffset = drte_engine__get_undo_data_end_offset(pEngine);
+
+    if (!drte_engine__capture_and_push_undo_state(pEngine, &pEngine->undoBuffer)) {
+        drte_engine__set_undo_data_end_offset(pEngine, headerOffset);
+        return DRTE_FALSE;
+    }
+
+
+    size_t prevUndoDataOffset = pEngine->currentUndoDataOffset;
+    size_t nextUndoDataOffset = drte_engine__get_undo_data_end_offset(pEngine);
+
+
+    // The header needs to be written last.
+    *((size_t*)drte_engine__get_undo_data_ptr(pEngine, headerOffset + sizeof(size_t)*0)) = prevUndoDataOffset;
+    *((size_t*)drte_engine__get_undo_data_ptr(pEngine, headerOffset + sizeof(size_t)*1)) = nextUndoDataOffset;
+    *((size_t*)drte_engine__get_undo_data_ptr(pEngine, headerOffset + sizeof(size_t)*2)) = preparedDataOffset  - headerOffset;
+    *((size_t*)drte_engine__get_undo_data_ptr(pEngine, headerOffset + sizeof(size_t)*3)) = committedDataOffset - headerOffset;
+    *((size_t*)drte_engine__get_undo_data_ptr(pEngine, headerOffset + sizeof(size_t)*4)) = headerSize + pEngine->preparedUndoTextChangesOffset;
+
+    pEngine->currentUndoDataOffset = headerOffset;
+    pEngine->currentRedoDataOffset = headerOffset;
+
+    drte_stack_buffer_set_stack_ptr(&pEngine->preparedUndoState, 0);
+    pEngine->hasPreparedUndoState = DRTE_FALSE;
+    pEngine->preparedUndoTextChangeCount = 0;
+
+
+    pEngine->undoStackCount += 1;
+    pEngine->iUndoState += 1;
+
+    drte_engine__evict_undo_points(pEngine);
+
+    if (pEngine->onUndoPointChanged) {
+        pEngine->onUndoPointChanged(pEngine, pEngine->iUndoState);
+    }
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_engine_undo(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    if (drte_engine_get_undo_points_remaining_count(pEngine) > 0) {
+        const void* pUndoDataPtr = drte_engine__get_undo_data_ptr(pEngine, pEngine->currentUndoDataOffset);
+        if (pUndoDataPtr == NULL) {
+            return DRTE_FALSE;
+        }
+
+        drte_engine__apply_undo_state(pEngine, pUndoDataPtr);
+        pEngine->iUndoState -= 1;
+
+        if (pEngine->onUndoPointChanged) {
+            pEngine->onUndoPointChanged(pEngine, pEngine->iUndoState);
+        }
+
+
+        pEngine->currentRedoDataOffset = pEngine->currentUndoDataOffset;
+        pEngine->currentUndoDataOffset = drte_engine__get_prev_undo_data_offset(pEngine);
+        return DRTE_TRUE;
+    }
+
+    return DRTE_FALSE;
+}
+
+drte_bool32 drte_engine_redo(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return DRTE_FALSE;
+    }
+
+    if (drte_engine_get_redo_points_remaining_count(pEngine) > 0) {
+        const void* pUndoDataPtr = drte_engine__get_undo_data_ptr(pEngine, pEngine->currentRedoDataOffset);
+        if (pUndoDataPtr == NULL) {
+            return DRTE_FALSE;
+        }
+
+        drte_engine__apply_redo_state(pEngine, pUndoDataPtr);
+        pEngine->iUndoState += 1;
+
+        if (pEngine->onUndoPointChanged) {
+            pEngine->onUndoPointChanged(pEngine, pEngine->iUndoState);
+        }
+
+        pEngine->currentUndoDataOffset = pEngine->currentRedoDataOffset;
+        if (drte_engine_get_redo_points_remaining_count(pEngine) > 0) {
+            pEngine->currentRedoDataOffset = drte_engine__get_next_undo_data_offset(pEngine);
+        }
+
+        return DRTE_TRUE;
+    }
+
+    return DRTE_FALSE;
+}
+
+unsigned int drte_engine_get_undo_points_remaining_count(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    return pEngine->iUndoState;
+}
+
+unsigned int drte_engine_get_redo_points_remaining_count(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    if (pEngine->undoStackCount > 0)
+    {
+        assert(pEngine->iUndoState <= pEngine->undoStackCount);
+        return pEngine->undoStackCount - pEngine->iUndoState;
+    }
+
+    return 0;
+}
+
+void drte_engine_clear_undo_stack(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    drte_stack_buffer_set_stack_ptr(&pEngine->undoBuffer, 0);
+    drte_stack_buffer_set_stack_ptr(&pEngine->preparedUndoState, 0);
+
+    pEngine->undoStackCount = 0;
+    pEngine->currentUndoDataOffset = 0;
+    pEngine->currentRedoDataOffset = 0;
+    pEngine->firstUndoDataOffset = 0;
+    pEngine->undoBufferDiscardedSize = 0;
+    pEngine->evictedUndoPointCount = 0;
+
+    if (pEngine->iUndoState > 0) {
+        pEngine->iUndoState = 0;
+
+        if (pEngine->onUndoPointChanged) {
+            pEngine->onUndoPointChanged(pEngine, pEngine->iUndoState);
+        }
+    }
+}
+
+void drte_engine_set_undo_memory_budget(drte_engine* pEngine, size_t sizeInBytes)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->undoMemoryBudget = sizeInBytes;
+    drte_engine__evict_undo_points(pEngine);
+}
+
+size_t drte_engine_get_undo_memory_budget(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return 0;
+    }
+
+    return pEngine->undoMemoryBudget;
+}
+
+void drte_engine_get_undo_stats(drte_engine* pEngine, drte_undo_stats* pStatsOut)
+{
+    if (pStatsOut == NULL) {
+        return;
+    }
+
+    memset(pStatsOut, 0, sizeof(*pStatsOut));
+
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pStatsOut->undoPointCount = drte_engine_get_undo_points_remaining_count(pEngine);
+    pStatsOut->redoPointCount = drte_engine_get_redo_points_remaining_count(pEngine);
+    pStatsOut->evictedPointCount = pEngine->evictedUndoPointCount;
+    pStatsOut->allocatedSizeInBytes = pEngine->undoBuffer.bufferSize + pEngine->preparedUndoState.bufferSize;
+    pStatsOut->memoryBudget = pEngine->undoMemoryBudget;
+    if (pEngine->undoStackCount > 0) {
+        pStatsOut->sizeInBytes = drte_engine__get_undo_data_end_offset(pEngine) - pEngine->firstUndoDataOffset;
+    }
+
+    // The text sizes are not tracked as the stack changes so they are added up by walking over every text change on the stack.
+    size_t undoDataOffset = pEngine->firstUndoDataOffset;
+    for (unsigned int iUndoPoint = 0; iUndoPoint < pEngine->undoStackCount; ++iUndoPoint) {
+        const uint8_t* pUndoData = (const uint8_t*)drte_engine__get_undo_data_ptr(pEngine, undoDataOffset);
+
+        drte_undo_state_info state;
+        drte_engine__breakdown_undo_state_info(pUndoData, &state);
+
+        const uint8_t* pTextChange = state.pTextChanges;
+        for (size_t iChange = 0; iChange < state.textChangeCount; ++iChange) {
+            drte_undo_change_type type = *(drte_undo_change_type*)pTextChange;
+            size_t textSize;
+            size_t storedTextSize;
+            if (type == drte_undo_change_type_replace || type == drte_undo_change_type_replace_regions) {
+                textSize = *(size_t*)(pTextChange + sizeof(drte_undo_change_type) + sizeof(size_t)) + *(size_t*)(pTextChange + sizeof(drte_undo_change_type) + sizeof(size_t)*2);
+                storedTextSize = textSize;
+            } else {
+                textSize = *(size_t*)(pTextChange + sizeof(drte_undo_change_type) + sizeof(size_t)) - *(size_t*)(pTextChange + sizeof(drte_undo_change_type));
+                if (type == drte_undo_change_type_insert_compressed || type == drte_undo_change_type_delete_compressed) {
+                    storedTextSize = *(size_t*)(pTextChange + sizeof(drte_undo_change_type) + sizeof(size_t)*2);
+                } else {
+                    storedTextSize = textSize;
+                }
+            }
+
+            pStatsOut->textSizeInBytes       += textSize;
+            pStatsOut->storedTextSizeInBytes += storedTextSize;
+
+            pTextChange += drte_round_up(drte_engine__get_text_change_size(pTextChange), DRTE_STACK_BUFFER_ALIGNMENT);
+        }
+
+        undoDataOffset = *(size_t*)(pUndoData + sizeof(size_t));
+    }
+}
+
+
+
+void drte_engine_set_on_paint_text(drte_engine* pEngine, drte_engine_on_paint_text_proc proc)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->onPaintText = proc;
+}
+
+void drte_engine_set_on_paint_rect(drte_engine* pEngine, drte_engine_on_paint_rect_proc proc)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    pEngine->onPaintRect = proc;
+}
+
+
+void drte_engine_step(drte_engine* pEngine, unsigned int milliseconds)
+{
+    if (pEngine == NULL || milliseconds == 0) {
+        return;
+    }
+
+    if (pEngine->timeToNextCursorBlink < milliseconds)
+    {
+        pEngine->isCursorBlinkOn = !pEngine->isCursorBlinkOn;
+        pEngine->timeToNextCursorBlink = pEngine->cursorBlinkRate;
+
+        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+            drte_view_begin_dirty(pView);
+            for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+                drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
+            }
+            drte_view_end_dirty(pView);
+        }
+    }
+    else
+    {
+        pEngine->timeToNextCursorBlink -= milliseconds;
+    }
+}
+
+
+
+void drte_engine__refresh(drte_engine* pEngine)
+{
+    assert(pEngine != NULL);
+
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view__invalidate_word_wrapping(pView);
+    }
+}
+
+
+
+// Makes sure pCursors has room for at least the given number of cursors.
+drte_bool32 drte_view__reserve_cursors(drte_view* pView, size_t cursorCount)
+{
+    assert(pView != NULL);
+
+    if (pView->_cursorBufferSize < cursorCount) {
+        size_t newBufferSize = (pView->_cursorBufferSize == 0) ? 4 : pView->_cursorBufferSize*2;
+        if (newBufferSize < cursorCount) {
+            newBufferSize = cursorCount;
+        }
+
+        drte_cursor* pNewCursors = (drte_cursor*)realloc(pView->pCursors, newBufferSize * sizeof(*pNewCursors));
+        if (pNewCursors == NULL) {
+            return DRTE_FALSE;
+        }
+
+        pView->pCursors = pNewCursors;
+        pView->_cursorBufferSize = newBufferSize;
+    }
+
+    return DRTE_TRUE;
+}
+
+// Makes sure pSelections has room for at least the given number of selections.
+drte_bool32 drte_view__reserve_selections(drte_view* pView, size_t selectionCount)
+{
+    assert(pView != NULL);
+
+    if (pView->_selectionBufferSize < selectionCount) {
+        size_t newBufferSize = (pView->_selectionBufferSize == 0) ? 4 : pView->_selectionBufferSize*2;
+        if (newBufferSize < selectionCount) {
+            newBufferSize = selectionCount;
+        }
+
+        drte_region* pNewSelections = (drte_region*)realloc(pView->pSelections, newBufferSize * sizeof(*pNewSelections));
+        if (pNewSelections == NULL) {
+            return DRTE_FALSE;
+        }
+
+        pView->pSelections = pNewSelections;
+        pView->_selectionBufferSize = newBufferSize;
+    }
+
+    return DRTE_TRUE;
+}
+
+void drte_view__set_cursors(drte_view* pView, size_t cursorCount, const drte_cursor* pCursors)
+{
+    assert(pView != NULL);
+
+    if (cursorCount > 0) {
+        if (drte_view__reserve_cursors(pView, cursorCount)) {
+            for (size_t iCursor = 0; iCursor < cursorCount; ++iCursor) {
+                pView->pCursors[iCursor] = pCursors[iCursor];
+                drte_view__update_cursor_sticky_position(pView, &pView->pCursors[iCursor]);
+            }
+
+            pView->cursorCount = cursorCount;
+        }
+    } else {
+        pView->cursorCount = 0;
+    }
+}
+
+void drte_view__set_selections(drte_view* pView, size_t selectionCount, const drte_region* pSelections)
+{
+    assert(pView != NULL);
+
+    drte_view__invalidate_sorted_selections(pView);
+
+    if (selectionCount > 0) {
+        if (drte_view__reserve_selections(pView, selectionCount)) {
+            for (size_t iSelection = 0; iSelection < selectionCount; ++iSelection) {
+                pView->pSelections[iSelection] = pSelections[iSelection];
+            }
+
+            pView->selectionCount = selectionCount;
+        }
+    } else {
+        pView->selectionCount = 0;
+    }
+}
+
+// Retrieves the size in bytes of a text change in the undo buffer, not including alignment padding.
+size_t drte_engine__get_text_change_size(const uint8_t* pData)
+{
+    // Insertions and deletions are formatted as:
+    //   type, iCharBeg, iCharEnd, text (null terminated).
+    //
+    // Replacements are formatted as:
+    //   type, rangeCount, oldTextLength, newTextLength, range starts, old text (null terminated), new text (null terminated).
+    //
+    // Region replacements are formatted as:
+    //   type, regionCount, oldTextLength, newTextLength, regions, new text lengths, old text (null terminated), new text (null terminated).
+    //
+    // Compressed insertions and deletions are formatted as:
+    //   type, iCharBeg, iCharEnd, compressedSize, compressed text.
+    drte_undo_change_type type = *(drte_undo_change_type*)(pData + 0);
+    if (type == drte_undo_change_type_insert_compressed || type == drte_undo_change_type_delete_compressed) {
+        size_t compressedSize = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t)*2);
+        return sizeof(drte_undo_change_type) + sizeof(size_t)*3 + compressedSize;
+    } else if (type == drte_undo_change_type_replace_regions) {
+        size_t regionCount   = *(size_t*)(pData + sizeof(drte_undo_change_type));
+        size_t oldTextLength = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
+        size_t newTextLength = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t)*2);
+        return sizeof(drte_undo_change_type) + sizeof(size_t)*3 + (sizeof(drte_region) + sizeof(size_t))*regionCount + oldTextLength + 1 + newTextLength + 1;
+    } else if (type == drte_undo_change_type_replace) {
+        size_t rangeCount    = *(size_t*)(pData + sizeof(drte_undo_change_type));
+        size_t oldTextLength = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
+        size_t newTextLength = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t)*2);
+        return sizeof(drte_undo_change_type) + sizeof(size_t)*3 + sizeof(size_t)*rangeCount + oldTextLength + 1 + newTextLength + 1;
+    } else {
+        size_t iCharBeg = *(size_t*)(pData + sizeof(drte_undo_change_type));
+        size_t iCharEnd = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
+        return sizeof(drte_undo_change_type) + sizeof(size_t) + sizeof(size_t) + (iCharEnd - iCharBeg) + 1;
+    }
+}
+
+// Copies the text of an insertion or deletion in the undo buffer, decompressing it if needed. The output buffer must have room
+// for iCharEnd - iCharBeg characters. A null terminator is not added.
+drte_bool32 drte_engine__copy_text_change_text(const uint8_t* pData, char* pTextOut)
+{
+    assert(pData != NULL);
+    assert(pTextOut != NULL);
+
+    drte_undo_change_type type = *(drte_undo_change_type*)(pData + 0);
+    size_t iCharBeg = *(size_t*)(pData + sizeof(drte_undo_change_type));
+    size_t iCharEnd = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
+
+    if (type == drte_undo_change_type_insert_compressed || type == drte_undo_change_type_delete_compressed) {
+        size_t compressedSize = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t)*2);
+        return drte_lz_decompress(pData + sizeof(drte_undo_change_type) + sizeof(size_t)*3, compressedSize, pTextOut, iCharEnd - iCharBeg);
+    }
+
+    assert(type == drte_undo_change_type_insert || type == drte_undo_change_type_delete);
+    memcpy(pTextOut, pData + sizeof(drte_undo_change_type) + sizeof(size_t)*2, iCharEnd - iCharBeg);
+    return DRTE_TRUE;
+}
+
+// Applies a single text change from the undo buffer. When isReversed is set the change is undone.
+void drte_engine__apply_text_change(drte_engine* pEngine, const uint8_t* pData, drte_bool32 isReversed)
+{
+    assert(pEngine != NULL);
+    assert(pData != NULL);
+
+    drte_undo_change_type type = *(drte_undo_change_type*)(pData + 0);
+    if (type == drte_undo_change_type_replace) {
+        size_t rangeCount    = *(size_t*)(pData + sizeof(drte_undo_change_type));
+        size_t oldTextLength = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
+        size_t newTextLength = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t)*2);
+        const uint8_t* pRangeBegs = pData + sizeof(drte_undo_change_type) + sizeof(size_t)*3;
+        const char* oldText = (const char*)(pRangeBegs + sizeof(size_t)*rangeCount);
+        const char* newText = oldText + oldTextLength + 1;
+
+        size_t* pMappedRangeBegs = (size_t*)malloc(rangeCount * sizeof(*pMappedRangeBegs));
+        if (pMappedRangeBegs == NULL) {
+            return;
+        }
+
+        memcpy(pMappedRangeBegs, pRangeBegs, rangeCount * sizeof(*pMappedRangeBegs));
+
+        if (isReversed) {
+            // The ranges were stored as they were before the change so they need to be moved to where the new text ended up.
+            for (size_t iRange = 0; iRange < rangeCount; ++iRange) {
+                pMappedRangeBegs[iRange] = pMappedRangeBegs[iRange] - iRange*oldTextLength + iRange*newTextLength;
+            }
+
+            drte_engine__replace_ranges(pEngine, pMappedRangeBegs, rangeCount, newTextLength, oldText, oldTextLength);
+        } else {
+            drte_engine__replace_ranges(pEngine, pMappedRangeBegs, rangeCount, oldTextLength, newText, newTextLength);
+        }
+
+        free(pMappedRangeBegs);
+        return;
+    }
+
+    if (type == drte_undo_change_type_replace_regions) {
+        size_t regionCount   = *(size_t*)(pData + sizeof(drte_undo_change_type));
+        size_t oldTextLength = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
+        const uint8_t* pStoredRegions = pData + sizeof(drte_undo_change_type) + sizeof(size_t)*3;
+        const uint8_t* pStoredNewTextLengths = pStoredRegions + sizeof(drte_region)*regionCount;
+        const char* oldText = (const char*)(pStoredNewTextLengths + sizeof(size_t)*regionCount);
+        const char* newText = oldText + oldTextLength + 1;
+
+        drte_region* pRegions = (drte_region*)malloc(regionCount * (sizeof(drte_region) + sizeof(size_t)));
+        if (pRegions == NULL) {
+            return;
+        }
+
+        size_t* pTextLengths = (size_t*)(pRegions + regionCount);
+        memcpy(pRegions, pStoredRegions, regionCount * sizeof(drte_region));
+        memcpy(pTextLengths, pStoredNewTextLengths, regionCount * sizeof(size_t));
+
+        if (isReversed) {
+            // The regions now hold the new text, and it's the old text that goes back in.
+            size_t offset = 0;
+            for (size_t iRegion = 0; iRegion < regionCount; ++iRegion) {
+                size_t oldLength = pRegions[iRegion].iCharEnd - pRegions[iRegion].iCharBeg;
+                size_t newLength = pTextLengths[iRegion];
+
+                pRegions[iRegion].iCharBeg += offset;
+                pRegions[iRegion].iCharEnd  = pRegions[iRegion].iCharBeg + newLength;
+                pTextLengths[iRegion] = oldLength;
+
+                offset = offset + newLength - oldLength;
+            }
+
+            drte_engine__replace_regions(pEngine, pRegions, regionCount, oldText, pTextLengths);
+        } else {
+            drte_engine__replace_regions(pEngine, pRegions, regionCount, newText, pTextLengths);
+        }
+
+        free(pRegions);
+        return;
+    }
+
+    size_t iCharBeg = *(size_t*)(pData + sizeof(drte_undo_change_type));
+    size_t iCharEnd = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
+    const char* text = (const char*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t) + sizeof(size_t));
+
+    drte_bool32 isCompressed = DRTE_FALSE;
+    if (type == drte_undo_change_type_insert_compressed || type == drte_undo_change_type_delete_compressed) {
+        isCompressed = DRTE_TRUE;
+        type = (type == drte_undo_change_type_insert_compressed) ? drte_undo_change_type_insert : drte_undo_change_type_delete;
+    }
+
+    // When reversing, inserts are transformed into deletes and vice versa.
+    if (isReversed) {
+        type = (type == drte_undo_change_type_insert) ? drte_undo_change_type_delete : drte_undo_change_type_insert;
+    }
+
+    if (type == drte_undo_change_type_insert) {
+        // Compressed text only needs to be decompressed when it's going back into the document.
+        if (isCompressed) {
+            size_t textLength = iCharEnd - iCharBeg;
+
+            char* pDecompressedText = (char*)malloc(textLength + 1);
+            if (pDecompressedText == NULL) {
+                return;
+            }
+
+            if (!drte_engine__copy_text_change_text(pData, pDecompressedText)) {
+                free(pDecompressedText);
+                return;
+            }
+
+            pDecompressedText[textLength] = '\0';
+            drte_engine_insert_text(pEngine, pDecompressedText, iCharBeg);
+            free(pDecompressedText);
+        } else {
+            drte_engine_insert_text(pEngine, text, iCharBeg);
+        }
+    } else {
+        drte_engine_delete_text(pEngine, iCharBeg, iCharEnd);
+    }
+}
+
+// An insertion or deletion from the undo buffer as it will be applied, which for an undo is the opposite of what was recorded.
+typedef struct
+{
+    size_t iCharBeg;
+    size_t removedLength;
+    size_t insertedLength;
+} drte_undo_edit;
+
+// Retrieves the edit that applying the given text change will make. Returns false for replacements which are never batched.
+drte_bool32 drte_engine__get_undo_edit(const uint8_t* pData, drte_bool32 isReversed, drte_undo_edit* pEditOut)
+{
+    assert(pData != NULL);
+    assert(pEditOut != NULL);
+
+    drte_undo_change_type type = *(drte_undo_change_type*)(pData + 0);
+    if (type == drte_undo_change_type_replace || type == drte_undo_change_type_replace_regions) {
+        return DRTE_FALSE;
+    }
+
+    size_t iCharBeg = *(size_t*)(pData + sizeof(drte_undo_change_type));
+    size_t iCharEnd = *(size_t*)(pData + sizeof(drte_undo_change_type) + sizeof(size_t));
+
+    drte_bool32 isInsert = (type == drte_undo_change_type_insert || type == drte_undo_change_type_insert_compressed);
+    if (isReversed) {
+        isInsert = !isInsert;
+    }
+
+    pEditOut->iCharBeg       = iCharBeg;
+    pEditOut->removedLength  = isInsert ? 0 : iCharEnd - iCharBeg;
+    pEditOut->insertedLength = isInsert ? iCharEnd - iCharBeg : 0;
+    return DRTE_TRUE;
+}
+
+// Retrieves the number of text changes at the start of the list which can be applied as a single replacement. This is the case when
+// each change is entirely after the previous one once it's been applied, or entirely before it. Multi-cursor edits, replacements and
+// block indenting all fall into one of these.
+size_t drte_engine__get_undo_edit_run_length(const uint8_t** ppChanges, size_t changeCount, drte_bool32 isReversed, drte_bool32* pIsDescendingOut)
+{
+    assert(ppChanges != NULL);
+    assert(pIsDescendingOut != NULL);
+
+    *pIsDescendingOut = DRTE_FALSE;
+
+    drte_undo_edit prevEdit;
+    if (changeCount == 0 || !drte_engine__get_undo_edit(ppChanges[0], isReversed, &prevEdit)) {
+        return 0;
+    }
+
+    size_t runLength = 1;
+    while (runLength < changeCount) {
+        drte_undo_edit edit;
+        if (!drte_engine__get_undo_edit(ppChanges[runLength], isReversed, &edit)) {
+            break;
+        }
+
+        drte_bool32 isAfter  = edit.iCharBeg >= prevEdit.iCharBeg + prevEdit.insertedLength;
+        drte_bool32 isBefore = edit.iCharBeg + edit.removedLength <= prevEdit.iCharBeg;
+        if (runLength == 1) {
+            if (!isAfter && !isBefore) {
+                break;
+            }
+
+            *pIsDescendingOut = !isAfter;
+        } else {
+            if (*pIsDescendingOut ? !isBefore : !isAfter) {
+                break;
+            }
+        }
+
+        prevEdit = edit;
+        runLength += 1;
+    }
+
+    return runLength;
+}
+
+// Applies a run of text changes found with drte_engine__get_undo_edit_run_length() as a single region replacement. This returns false
+// without changing anything if memory could not be allocated.
+drte_bool32 drte_engine__apply_undo_edit_run(drte_engine* pEngine, const uint8_t** ppChanges, size_t changeCount, drte_bool32 isReversed, drte_bool32 isDescending)
+{
+    assert(pEngine != NULL);
+    assert(ppChanges != NULL);
+
+    drte_region* pRegions = (drte_region*)malloc(changeCount * (sizeof(drte_region) + sizeof(size_t) + sizeof(const uint8_t*)));
+    if (pRegions == NULL) {
+        return DRTE_FALSE;
+    }
+
+    size_t* pTextLengths = (size_t*)(pRegions + changeCount);
+    const uint8_t** ppSortedChanges = (const uint8_t**)(pTextLengths + changeCount);
+
+    // Each change is mapped back to where it would be in the text before any of them were applied. When the changes move forwards
+    // through the text this means undoing the shift caused by the earlier changes. When they move backwards the earlier changes are
+    // all after this one so there's nothing to undo, but the regions need to be put back into order.
+    size_t removedLengthSoFar  = 0;
+    size_t insertedLengthSoFar = 0;
+    for (size_t iChange = 0; iChange < changeCount; ++iChange) {
+        drte_undo_edit edit;
+        drte_engine__get_undo_edit(ppChanges[iChange], isReversed, &edit);
+
+        size_t iRegion = isDescending ? (changeCount - iChange - 1) : iChange;
+        size_t iCharBeg = isDescending ? edit.iCharBeg : (edit.iCharBeg + removedLengthSoFar - insertedLengthSoFar);
+
+        pRegions[iRegion].iCharBeg = iCharBeg;
+        pRegions[iRegion].iCharEnd = iCharBeg + edit.removedLength;
+        pTextLengths[iRegion] = edit.insertedLength;
+        ppSortedChanges[iRegion] = ppChanges[iChange];
+
+        removedLengthSoFar  += edit.removedLength;
+        insertedLengthSoFar += edit.insertedLength;
+    }
+
+    char* pTexts = (char*)malloc(insertedLengthSoFar + 1);
+    if (pTexts == NULL) {
+        free(pRegions);
+        return DRTE_FALSE;
+    }
+
+    size_t textOffset = 0;
+    for (size_t iRegion = 0; iRegion < changeCount; ++iRegion) {
+        if (pTextLengths[iRegion] > 0) {
+            if (!drte_engine__copy_text_change_text(ppSortedChanges[iRegion], pTexts + textOffset)) {
+                free(pTexts);
+                free(pRegions);
+                return DRTE_FALSE;
+            }
+
+            textOffset += pTextLengths[iRegion];
+        }
+    }
+
+    // Regions that touch are merged since their text is already back to back. Typing builds up a lot of these.
+    size_t regionCount = 0;
+    for (size_t iRegion = 0; iRegion < changeCount; ++iRegion) {
+        if (regionCount > 0 && pRegions[regionCount-1].iCharEnd == pRegions[iRegion].iCharBeg) {
+            pRegions[regionCount-1].iCharEnd = pRegions[iRegion].iCharEnd;
+            pTextLengths[regionCount-1] += pTextLengths[iRegion];
+        } else {
+            pRegions[regionCount] = pRegions[iRegion];
+            pTextLengths[regionCount] = pTextLengths[iRegion];
+            regionCount += 1;
+        }
+    }
+
+    drte_engine__replace_regions(pEngine, pRegions, regionCount, pTexts, pTextLengths);
+
+    free(pTexts);
+    free(pRegions);
+    return DRTE_TRUE;
+}
+
+// Applies the given text changes in order. Long runs of insertions and deletions are applied as a single replacement so cursors,
+// selections and repainting are only dealt with once rather than once per change.
+void drte_engine__apply_text_change_list(drte_engine* pEngine, const uint8_t** ppChanges, size_t changeCount, drte_bool32 isReversed)
+{
+    assert(pEngine != NULL);
+    assert(ppChanges != NULL);
+
+    size_t iChange = 0;
+    while (iChange < changeCount) {
+        drte_bool32 isDescending;
+        size_t runLength = drte_engine__get_undo_edit_run_length(ppChanges + iChange, changeCount - iChange, isReversed, &isDescending);
+        if (runLength >= DRTE_UNDO_BATCH_MIN_CHANGE_COUNT && drte_engine__apply_undo_edit_run(pEngine, ppChanges + iChange, runLength, isReversed, isDescending)) {
+            iChange += runLength;
+            continue;
+        }
+
+        if (runLength == 0) {
+            runLength = 1;
+        }
+
+        for (size_t iRunChange = 0; iRunChange < runLength; ++iRunChange) {
+            drte_engine__apply_text_change(pEngine, ppChanges[iChange + iRunChange], isReversed);
+        }
+
+        iChange += runLength;
+    }
+}
+
+// Retrieves a pointer to each text change in the undo buffer so they can be walked in either direction. Free the result with free().
+const uint8_t** drte_engine__gather_text_changes(size_t changeCount, const uint8_t* pData)
+{
+    assert(pData != NULL);
+
+    const uint8_t** ppChanges = (const uint8_t**)malloc(changeCount * sizeof(*ppChanges));
+    if (ppChanges == NULL) {
+        return NULL;
+    }
+
+    for (size_t iChange = 0; iChange < changeCount; ++iChange) {
+        ppChanges[iChange] = pData;
+        pData += drte_round_up(drte_engine__get_text_change_size(pData), DRTE_STACK_BUFFER_ALIGNMENT);
+    }
+
+    return ppChanges;
+}
+
+void drte_engine__apply_text_changes_reversed(drte_engine* pEngine, size_t changeCount, const uint8_t* pData)
+{
+    assert(pEngine != NULL);
+    assert(pData != NULL);
+
+    if (changeCount == 0) {
+        return;
+    }
+
+    // The changes can only be walked forwards so they're gathered first and then applied from last to first.
+    const uint8_t** ppChanges = drte_engine__gather_text_changes(changeCount, pData);
+    if (ppChanges == NULL) {
+        return;
+    }
+
+    for (size_t iChange = 0; iChange < changeCount/2; ++iChange) {
+        const uint8_t* pTemp = ppChanges[iChange];
+        ppChanges[iChange] = ppChanges[changeCount - iChange - 1];
+        ppChanges[changeCount - iChange - 1] = pTemp;
+    }
+
+    drte_engine__apply_text_change_list(pEngine, ppChanges, changeCount, DRTE_TRUE);
+    free(ppChanges);
+}
+
+void drte_engine__apply_text_changes(drte_engine* pEngine, size_t changeCount, const uint8_t* pData)
+{
+    assert(pEngine != NULL);
+    assert(pData != NULL);
+
+    if (changeCount == 0) {
+        return;
+    }
+
+    const uint8_t** ppChanges = drte_engine__gather_text_changes(changeCount, pData);
+    if (ppChanges == NULL) {
+        return;
+    }
+
+    drte_engine__apply_text_change_list(pEngine, ppChanges, changeCount, DRTE_FALSE);
+    free(ppChanges);
+}
+
+void drte_engine__apply_undo_state(drte_engine* pEngine, const void* pUndoDataPtr)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    // Begin dirty.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view_begin_dirty(pView);
+    }
+
+
+    drte_undo_state_info state;
+    drte_engine__breakdown_undo_state_info((const uint8_t*)pUndoDataPtr, &state);
+
+    // Text.
+    drte_engine__apply_text_changes_reversed(pEngine, state.textChangeCount, state.pTextChanges);
+
+
+    // For each view with captured state...
+    size_t viewDataOffset = state.oldState.firstViewOffset;
+    for (size_t iView = 0; iView < state.oldState.viewCount; ++iView) {
+        size_t viewDataSize;
+        drte_undo_state_view_info viewData;
+        drte_engine__breakdown_undo_state_view_info((uint8_t*)pUndoDataPtr + viewDataOffset, &viewData, &viewDataSize);
+
+        // If the view that owns this captured state still exists it needs to have it's selections and cursors restored. Otherwise we just skip it.
+        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+            if (pView->_id == viewData.id) {
+                drte_view__set_cursors(pView, viewData.cursorCount, viewData.pCursors);
+                drte_view__set_selections(pView, viewData.selectionCount, viewData.pSelections);
+                
+                for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+                    drte_engine__on_cursor_move(pEngine, pView, iCursor);
+                }
+
+                break;
+            }
+        }
+
+        viewDataOffset += viewDataSize;
+    }
+
+
+    if (pEngine->onTextChanged) {
+        pEngine->onTextChanged(pEngine);
+    }
+
+    // Application-defined data.
+    if (pEngine->onApplyUndoState) {
+        pEngine->onApplyUndoState(pEngine, state.oldState.userDataSize, state.oldState.pUserData);
+    }
+
+
+    // End dirty.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view_end_dirty(pView);
+    }
+}
+
+void drte_engine__apply_redo_state(drte_engine* pEngine, const void* pUndoDataPtr)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    // Begin dirty.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view_begin_dirty(pView);
+    }
+
+
+    drte_undo_state_info state;
+    drte_engine__breakdown_undo_state_info((const uint8_t*)pUndoDataPtr, &state);
+
+    // Text.
+    drte_engine__apply_text_changes(pEngine, state.textChangeCount, state.pTextChanges);
+
+    size_t viewDataOffset = state.newState.firstViewOffset;
+    for (size_t iView = 0; iView < state.newState.viewCount; ++iView) {
+        size_t viewDataSize;
+        drte_undo_state_view_info viewData;
+        drte_engine__breakdown_undo_state_view_info((uint8_t*)pUndoDataPtr + viewDataOffset, &viewData, &viewDataSize);
+
+        // If the view that owns this captured state still exists it needs to have it's selections and cursors restored. Otherwise we just skip it.
+        for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+            if (pView->_id == viewData.id) {
+                drte_view__set_cursors(pView, viewData.cursorCount, viewData.pCursors);
+                drte_view__set_selections(pView, viewData.selectionCount, viewData.pSelections);
+                
+                for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+                    drte_engine__on_cursor_move(pEngine, pView, iCursor);
+                }
+
+                break;
+            }
+        }
+
+        viewDataOffset += viewDataSize;
+    }
+
+
+    if (pEngine->onTextChanged) {
+        pEngine->onTextChanged(pEngine);
+    }
+
+    // Application-defined data.
+    if (pEngine->onApplyUndoState) {
+        pEngine->onApplyUndoState(pEngine, state.newState.userDataSize, state.newState.pUserData);
+    }
+
+
+    // End dirty.
+    for (drte_view* pView = drte_engine_first_view(pEngine); pView != NULL; pView = drte_view_next_view(pView)) {
+        drte_view_end_dirty(pView);
+    }
+}
+
+
+
+void drte_engine__on_cursor_move(drte_engine* pEngine, drte_view* pView, size_t cursorIndex)
+{
+    if (pEngine == NULL) {
+        return;
+    }
+
+    // When the cursor moves we want to reset the cursor's blink state.
+    drte_engine_reset_cursor_blinks(pEngine);
+
+    if (pEngine->onCursorMove) {
+        pEngine->onCursorMove(pEngine, pView, cursorIndex);
+    }
+
+    drte_view_dirty(pView, drte_view_get_cursor_rect(pView, cursorIndex));  // <-- Is this needed?
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Views
+//
+///////////////////////////////////////////////////////////////////////////////
+
+DRTE_INLINE void drte_view__repaint(drte_view* pView)
+{
+    drte_view_dirty(pView, drte_view_get_local_rect(pView));
+}
+
+static float drte_view__get_tab_width_in_pixels(drte_view* pView)
+{
+    float tabWidth = (float)(pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth * pView->tabSizeInSpaces);
+    if (tabWidth <= 0) {
+        tabWidth = (float)pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth;
+        if (tabWidth <= 0) {
+            tabWidth = 4;
+        }
+    }
+
+    return tabWidth;
+}
+
+static drte_bool32 drte_view__reserve_line_widths(drte_view* pView, size_t count)
+{
+    assert(pView != NULL);
+
+    if (count > pView->_lineWidthBufferSize) {
+        size_t newBufferSize = pView->_lineWidthBufferSize * 2;
+        if (newBufferSize < count) {
+            newBufferSize = count;
+        }
+
+        float* pNewLineWidths = (float*)realloc(pView->_pLineWidths, newBufferSize * sizeof(*pNewLineWidths));
+        if (pNewLineWidths == NULL) {
+            return DRTE_FALSE;
+        }
+
+        pView->_pLineWidths = pNewLineWidths;
+        pView->_lineWidthBufferSize = newBufferSize;
+    }
+
+    return DRTE_TRUE;
+}
+
+// Forgets the checkpoints of oldLineCount lines starting at iFirstLine which have been replaced by newLineCount lines. The checkpoints
+// of the first line within its first keptLength characters are still valid and are kept.
+static void drte_view__invalidate_long_lines(drte_view* pView, size_t iFirstLine, size_t oldLineCount, size_t newLineCount, size_t keptLength)
+{
+    assert(pView != NULL);
+
+    size_t longLineCount = 0;
+    for (size_t i = 0; i < pView->_longLineCount; ++i) {
+        drte_long_line* pLongLine = &pView->_pLongLines[i];
+        if (pLongLine->iLine >= iFirstLine + oldLineCount) {
+            pLongLine->iLine = pLongLine->iLine - oldLineCount + newLineCount;
+        } else if (pLongLine->iLine == iFirstLine && keptLength > 0) {
+            while (pLongLine->checkpointCount > 1 && pLongLine->pCheckpoints[pLongLine->checkpointCount-1].iChar >= keptLength) {
+                pLongLine->checkpointCount -= 1;
+            }
+
+            pLongLine->width = -1;
+        } else if (pLongLine->iLine >= iFirstLine) {
+            free(pLongLine->pCheckpoints);
+            continue;
+        }
+
+        pView->_pLongLines[longLineCount++] = *pLongLine;
+    }
+
+    pView->_longLineCount = longLineCount;
+}
+
+// Forgets every measurement. Called when something affecting the width of the text, other than the text itself, has changed, or
+// when the text has been replaced in a way that could have changed any line.
+static void drte_view__clear_measurements(drte_view* pView)
+{
+    assert(pView != NULL);
+
+    pView->_lineWidthCount = 0;
+    pView->_lineWidthScale = pView->scale;
+    memset(pView->_measuredSegments, 0, sizeof(pView->_measuredSegments));
+
+    for (size_t i = 0; i < pView->_longLineCount; ++i) {
+        free(pView->_pLongLines[i].pCheckpoints);
+    }
+    pView->_longLineCount = 0;
+}
+
+// Forgets the widths of oldLineCount lines starting at iFirstLine which have been replaced by newLineCount lines. The lines after them
+// keep their widths. Measured segments are identified by character position so they are all forgotten. firstLineKeptLength is the
+// number of characters at the start of the first line that are unchanged, which is used to keep the part of a long line before an
+// edit from needing to be walked again.
+static void drte_view__invalidate_line_measurements(drte_view* pView, size_t iFirstLine, size_t oldLineCount, size_t newLineCount, size_t firstLineKeptLength)
+{
+    assert(pView != NULL);
+
+    memset(pView->_measuredSegments, 0, sizeof(pView->_measuredSegments));
+    drte_view__invalidate_long_lines(pView, iFirstLine, oldLineCount, newLineCount, firstLineKeptLength);
+
+    if (iFirstLine >= pView->_lineWidthCount) {
+        return;
+    }
+
+    if (oldLineCount >= pView->_lineWidthCount - iFirstLine) {
+        pView->_lineWidthCount = iFirstLine;    // Nothing after the replaced lines has been measured.
+        return;
+    }
+
+    size_t tailLineCount = pView->_lineWidthCount - iFirstLine - oldLineCount;
+    if (!drte_view__reserve_line_widths(pView, iFirstLine + newLineCount + tailLineCount)) {
+        pView->_lineWidthCount = iFirstLine;
+        return;
+    }
+
+    memmove(pView->_pLineWidths + iFirstLine + newLineCount, pView->_pLineWidths + iFirstLine + oldLineCount, tailLineCount * sizeof(*pView->_pLineWidths));
+    for (size_t i = 0; i < newLineCount; ++i) {
+        pView->_pLineWidths[iFirstLine + i] = -1;
+    }
+
+    pView->_lineWidthCount = iFirstLine + newLineCount + tailLineCount;
+}
+
+// Retrieves the checkpoints of the line a segment iterator is on, creating them if necessary. Returns NULL if the line is not one of
+// the view's own lines or isn't long enough to have any checkpoints.
+static drte_long_line* drte_view__get_long_line(drte_view* pView, const drte_segment* pSegment)
+{
+    assert(pView != NULL);
+    assert(pSegment != NULL);
+
+    if (pSegment->pLineCache != pView->pWrappedLines || pSegment->iLineCharEnd - pSegment->iLineCharBeg <= DRTE_LINE_CHECKPOINT_INTERVAL) {
+        return NULL;
+    }
+
+    // The scale is set on the view directly so it's checked here rather than when it changes.
+    if (pView->_lineWidthScale != pView->scale) {
+        drte_view__clear_measurements(pView);
+    }
+
+    size_t lo = 0;
+    size_t hi = pView->_longLineCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        if (pView->_pLongLines[mid].iLine < pSegment->iLine) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < pView->_longLineCount && pView->_pLongLines[lo].iLine == pSegment->iLine) {
+        return &pView->_pLongLines[lo];
+    }
+
+    if (pView->_longLineCount == pView->_longLineBufferSize) {
+        size_t newBufferSize = (pView->_longLineBufferSize == 0) ? 16 : pView->_longLineBufferSize*2;
+        drte_long_line* pNewLongLines = (drte_long_line*)realloc(pView->_pLongLines, newBufferSize * sizeof(*pNewLongLines));
+        if (pNewLongLines == NULL) {
+            return NULL;
+        }
+
+        pView->_pLongLines = pNewLongLines;
+        pView->_longLineBufferSize = newBufferSize;
+    }
+
+    drte_line_checkpoint* pCheckpoints = (drte_line_checkpoint*)malloc(16 * sizeof(*pCheckpoints));
+    if (pCheckpoints == NULL) {
+        return NULL;
+    }
+
+    pCheckpoints[0].iChar = 0;
+    pCheckpoints[0].posX = 0;
+
+    memmove(pView->_pLongLines + lo + 1, pView->_pLongLines + lo, (pView->_longLineCount - lo) * sizeof(*pView->_pLongLines));
+    pView->_longLineCount += 1;
+
+    drte_long_line* pLongLine = &pView->_pLongLines[lo];
+    pLongLine->iLine = pSegment->iLine;
+    pLongLine->pCheckpoints = pCheckpoints;
+    pLongLine->checkpointCount = 1;
+    pLongLine->checkpointBufferSize = 16;
+    pLongLine->width = -1;
+
+    return pLongLine;
+}
+
+static drte_bool32 drte_view__push_line_checkpoint(drte_long_line* pLongLine, size_t iChar, float posX)
+{
+    assert(pLongLine != NULL);
+
+    if (pLongLine->checkpointCount == pLongLine->checkpointBufferSize) {
+        size_t newBufferSize = pLongLine->checkpointBufferSize*2;
+        drte_line_checkpoint* pNewCheckpoints = (drte_line_checkpoint*)realloc(pLongLine->pCheckpoints, newBufferSize * sizeof(*pNewCheckpoints));
+        if (pNewCheckpoints == NULL) {
+            return DRTE_FALSE;
+        }
+
+        pLongLine->pCheckpoints = pNewCheckpoints;
+        pLongLine->checkpointBufferSize = newBufferSize;
+    }
+
+    pLongLine->pCheckpoints[pLongLine->checkpointCount].iChar = iChar;
+    pLongLine->pCheckpoints[pLongLine->checkpointCount].posX = posX;
+    pLongLine->checkpointCount += 1;
+
+    return DRTE_TRUE;
+}
+
+// Finds the last known checkpoint at or before both the given position and character, which is relative to the start of the line.
+static size_t drte_view__find_line_checkpoint(drte_long_line* pLongLine, float posX, size_t iChar)
+{
+    assert(pLongLine != NULL);
+    assert(pLongLine->checkpointCount > 0);
+
+    size_t lo = 0;
+    size_t hi = pLongLine->checkpointCount;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo)/2;
+        if (pLongLine->pCheckpoints[mid].posX <= posX && pLongLine->pCheckpoints[mid].iChar <= iChar) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+// Moves a segment iterator to the segment starting at the given checkpoint of the line it's on.
+static void drte_view__move_segment_to_line_checkpoint(drte_view* pView, drte_segment* pSegment, const drte_line_checkpoint* pCheckpoint)
+{
+    assert(pView != NULL);
+    assert(pSegment != NULL);
+    assert(pCheckpoint != NULL);
+
+    pSegment->iCharEnd = pSegment->iLineCharBeg + pCheckpoint->iChar;
+    pSegment->posX = pCheckpoint->posX;
+    pSegment->width = 0;
+    pSegment->isAtEnd = DRTE_FALSE;
+    pSegment->isAtEndOfLine = DRTE_FALSE;
+    drte_engine__next_segment(pView, pSegment);
+}
+
+// Finds the last checkpoint of a long line at or before both the given position and character, which is relative to the start of the
+// line. If the target is past the last known checkpoint the line is walked from there, remembering the checkpoints it passes, until
+// one past the target or the end of the line is reached. pLineSegment is any segment iterator on the line.
+static size_t drte_view__walk_long_line(drte_view* pView, drte_long_line* pLongLine, const drte_segment* pLineSegment, float targetPosX, size_t iTargetChar)
+{
+    assert(pView != NULL);
+    assert(pLongLine != NULL);
+    assert(pLineSegment != NULL);
+
+    size_t iCheckpoint = drte_view__find_line_checkpoint(pLongLine, targetPosX, iTargetChar);
+    if (iCheckpoint+1 < pLongLine->checkpointCount || pLongLine->width >= 0) {
+        return iCheckpoint;
+    }
+
+    drte_segment segment = *pLineSegment;
+    drte_view__move_segment_to_line_checkpoint(pView, &segment, &pLongLine->pCheckpoints[iCheckpoint]);
+    for (;;) {
+        size_t iChar = segment.iCharBeg - segment.iLineCharBeg;
+        if (iChar >= pLongLine->checkpointCount * DRTE_LINE_CHECKPOINT_INTERVAL && !segment.isAtEndOfLine && !segment.isAtEnd) {
+            if (!drte_view__push_line_checkpoint(pLongLine, iChar, segment.posX)) {
+                break;
+            }
+
+            if (segment.posX > targetPosX || iChar > iTargetChar) {
+                break;
+            }
+        }
+
+        if (!drte_engine__next_segment_on_line(pView, &segment)) {
+            pLongLine->width = segment.posX + segment.width;
+            break;
+        }
+    }
+
+    return drte_view__find_line_checkpoint(pLongLine, targetPosX, iTargetChar);
+}
+
+// Moves a segment iterator sitting at the start of a line to the last checkpoint of the line at or before both the given position and
+// character so that whatever is looking for them doesn't need to measure everything before it. Lines too short to have checkpoints
+// are left alone.
+static void drte_view__seek_segment(drte_view* pView, drte_segment* pSegment, float targetPosX, size_t iTargetChar)
+{
+    assert(pView != NULL);
+    assert(pSegment != NULL);
+
+    drte_long_line* pLongLine = drte_view__get_long_line(pView, pSegment);
+    if (pLongLine == NULL) {
+        return;
+    }
+
+    if (iTargetChar != (size_t)-1) {
+        iTargetChar = (iTargetChar > pSegment->iLineCharBeg) ? iTargetChar - pSegment->iLineCharBeg : 0;
+    }
+
+    size_t iCheckpoint = drte_view__walk_long_line(pView, pLongLine, pSegment, targetPosX, iTargetChar);
+    if (iCheckpoint > 0) {
+        drte_view__move_segment_to_line_checkpoint(pView, pSegment, &pLongLine->pCheckpoints[iCheckpoint]);
+    }
+}
+
+// Retrieves the width of the given line of the view, only measuring it if it hasn't been measured since it last changed.
+static float drte_view__get_line_width(drte_view* pView, size_t iLine)
+{
+    assert(pView != NULL);
+
+    // The scale is set on the view directly so it's checked here rather than when it changes.
+    if (pView->_lineWidthScale != pView->scale) {
+        drte_view__clear_measurements(pView);
+    }
+
+    if (iLine < pView->_lineWidthCount && pView->_pLineWidths[iLine] >= 0) {
+        return pView->_pLineWidths[iLine];
+    }
+
+    float lineWidth = 0;
+
+    drte_segment segment;
+    if (drte_engine__first_segment_on_line(pView, pView->pWrappedLines, iLine, (size_t)-1, &segment)) {
+        // Long lines aren't measured to the end just to size a scroll bar. Until something has walked to the end of one its width is
+        // estimated from the part that has been walked, assuming the rest of the line is made up of characters of the same width.
+        drte_long_line* pLongLine = drte_view__get_long_line(pView, &segment);
+        if (pLongLine != NULL) {
+            drte_view__walk_long_line(pView, pLongLine, &segment, FLT_MAX, 0);
+            if (pLongLine->width < 0) {
+                const drte_line_checkpoint* pLastCheckpoint = &pLongLine->pCheckpoints[pLongLine->checkpointCount-1];
+                if (pLastCheckpoint->iChar == 0) {
+                    return 0;
+                }
+
+                return pLastCheckpoint->posX + (pLastCheckpoint->posX / pLastCheckpoint->iChar) * (segment.iLineCharEnd - segment.iLineCharBeg - pLastCheckpoint->iChar);
+            }
+
+            lineWidth = pLongLine->width;
+        } else {
+            do
+            {
+                lineWidth += segment.width;
+            } while (drte_engine__next_segment_on_line(pView, &segment));
+        }
+    }
+
+    if (iLine < drte_view_get_line_count(pView)) {
+        if (iLine >= pView->_lineWidthCount && drte_view__reserve_line_widths(pView, iLine+1)) {
+            for (size_t i = pView->_lineWidthCount; i < iLine; ++i) {
+                pView->_pLineWidths[i] = -1;
+            }
+
+            pView->_lineWidthCount = iLine+1;
+        }
+
+        if (iLine < pView->_lineWidthCount) {
+            pView->_pLineWidths[iLine] = lineWidth;
+        }
+    }
+
+    return lineWidth;
+}
+
+
+static drte_bool32 drte_view__push_wrapped_line(size_t** ppLineCharBegs, size_t* pLineCount, size_t* pBufferSize, size_t iLineCharBeg)
+{
+    if (*pLineCount == *pBufferSize) {
+        size_t newBufferSize = (*pBufferSize == 0) ? 64 : *pBufferSize * 2;
+        size_t* pNewLineCharBegs = (size_t*)realloc(*ppLineCharBegs, newBufferSize * sizeof(*pNewLineCharBegs));
+        if (pNewLineCharBegs == NULL) {
+            return DRTE_FALSE;
+        }
+
+        *ppLineCharBegs = pNewLineCharBegs;
+        *pBufferSize = newBufferSize;
+    }
+
+    (*ppLineCharBegs)[*pLineCount] = iLineCharBeg;
+    *pLineCount += 1;
+
+    return DRTE_TRUE;
+}
+
+// Appends the first character of each wrapped line making up the given unwrapped line to *ppLineCharBegs, growing it as required.
+static drte_bool32 drte_view__wrap_line(drte_view* pView, size_t iLine, size_t** ppLineCharBegs, size_t* pLineCount, size_t* pBufferSize)
+{
+    assert(pView != NULL);
+
+    size_t iLineCharBeg;
+    size_t iLineCharEnd;
+    drte_view_get_line_character_range(pView, pView->pEngine->pUnwrappedLines, iLine, &iLineCharBeg, &iLineCharEnd);
+
+    // Line wrapping is done by simply sub-diving the line based on word boundaries. Empty lines still get a wrapped line of their own.
+    float runningWidth = 0;
+    do
+    {
+        if (!drte_view__push_wrapped_line(ppLineCharBegs, pLineCount, pBufferSize, iLineCharBeg)) {
+            return DRTE_FALSE;
+        }
+
+        size_t iWrappedLineCharBeg = iLineCharBeg;
+        if (iLineCharBeg >= iLineCharEnd) {
+            break;
+        }
+
+        drte_segment segment;
+        if (!drte_engine__first_segment_on_line(pView, pView->pEngine->pUnwrappedLines, iLine, iLineCharBeg, &segment)) {
+            break;
+        }
+
+        do
+        {
+            if ((runningWidth + segment.width) > pView->sizeX) {
+                float unused = 0;
+                size_t iChar = iLineCharBeg;
+                if (pView->pEngine->onGetCursorPositionFromPoint) {
+                    pView->pEngine->onGetCursorPositionFromPoint(pView->pEngine, drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot), pView->scale, drte_engine__get_text_range(pView->pEngine, segment.iCharBeg, segment.iCharEnd), segment.iCharEnd - segment.iCharBeg,
+                        segment.width, pView->sizeX - runningWidth, &unused, &iChar);
+                }
+
+                size_t iWordCharBeg;
+                size_t iWordCharEnd;
+                if (!drte_engine_get_word_containing_character(pView->pEngine, iLineCharBeg + iChar, &iWordCharBeg, &iWordCharEnd)) {
+                    iLineCharBeg = segment.iCharEnd;
+                    runningWidth = 0;
+                    break;
+                }
+
+                if (iWordCharBeg <= iWrappedLineCharBeg) {
+                    iWordCharBeg  = segment.iCharBeg + iChar;   // The word itself is longer than the container which means it needs to be split based on the exact character.
+                }
+
+                // Always make sure wrapping has at least one character.
+                if (iWordCharBeg == iLineCharBeg) {
+                    iWordCharBeg += 1;
+                }
+
+                iLineCharBeg = iWordCharBeg;
+                runningWidth = 0;
+                break;
+            } else {
+                runningWidth += segment.width;
+                iLineCharBeg = segment.iCharEnd;
+            }
+        } while (drte_engine__next_segment_on_line(pView, &segment));
+    } while (iLineCharBeg < iLineCharEnd);
+
+    return DRTE_TRUE;
+}
+
+// Wraps lineCount unwrapped lines starting at iFirstLine and replaces the wrapped lines they were previously covered by. characterOffset
+// is how far the unwrapped line after the range has moved since the wrapped lines were last updated, as a wrapping offset.
+static drte_bool32 drte_view__rewrap_lines(drte_view* pView, size_t iFirstLine, size_t lineCount, size_t characterOffset)
+{
+    assert(pView != NULL);
+    assert(drte_view_is_word_wrap_enabled(pView));
+
+    drte_line_cache* pUnwrappedLines = pView->pEngine->pUnwrappedLines;
+
+    size_t unwrappedLineCount = drte_line_cache_get_line_count(pUnwrappedLines);
+    if (iFirstLine >= unwrappedLineCount || lineCount == 0) {
+        return DRTE_TRUE;
+    }
+
+    if (lineCount > unwrappedLineCount - iFirstLine) {
+        lineCount = unwrappedLineCount - iFirstLine;
+    }
+
+    // Nothing before the range has moved, and the start of every unwrapped line is also the start of a wrapped line, so the wrapped
+    // lines to replace can be found from where the range starts and where the line after it used to start.
+    size_t iWrappedLineBeg = drte_line_cache_find_line_by_character(pView->pWrappedLines, drte_line_cache_get_line_first_character(pUnwrappedLines, iFirstLine));
+    size_t iWrappedLineEnd = drte_line_cache_get_line_count(pView->pWrappedLines);
+    size_t iNextLineCharBeg = 0;
+    if (iFirstLine + lineCount < unwrappedLineCount) {
+        iNextLineCharBeg = drte_line_cache_get_line_first_character(pUnwrappedLines, iFirstLine + lineCount);
+        iWrappedLineEnd  = drte_line_cache_find_line_by_character(pView->pWrappedLines, iNextLineCharBeg - characterOffset);
+    }
+
+    size_t* pLineCharBegs = NULL;
+    size_t wrappedLineCount = 0;
+    size_t bufferSize = 0;
+    for (size_t iLine = iFirstLine; iLine < iFirstLine + lineCount; ++iLine) {
+        if (!drte_view__wrap_line(pView, iLine, &pLineCharBegs, &wrappedLineCount, &bufferSize)) {
+            free(pLineCharBegs);
+            return DRTE_FALSE;
+        }
+    }
+
+    drte_bool32 result = drte_line_cache_replace_lines(pView->pWrappedLines, iWrappedLineBeg, iWrappedLineEnd - iWrappedLineBeg, pLineCharBegs, wrappedLineCount, iNextLineCharBeg);
+    free(pLineCharBegs);
+
+    drte_view__invalidate_line_measurements(pView, iWrappedLineBeg, iWrappedLineEnd - iWrappedLineBeg, wrappedLineCount, 0);
+
+    return result;
+}
+
+// Re-wraps a range of unwrapped lines whose text hasn't changed, keeping the line at the top of the view where it is.
+static drte_bool32 drte_view__rewrap_lines_in_place(drte_view* pView, size_t iFirstLine, size_t lineCount)
+{
+    assert(pView != NULL);
+
+    size_t iTopLine;
+    drte_view_get_visible_lines(pView, &iTopLine, NULL);
+
+    drte_bool32 isTopLineValid = iTopLine < drte_line_cache_get_line_count(pView->pWrappedLines);
+    size_t iTopLineCharBeg = drte_line_cache_get_line_first_character(pView->pWrappedLines, iTopLine);
+
+    if (!drte_view__rewrap_lines(pView, iFirstLine, lineCount, 0)) {
+        return DRTE_FALSE;
+    }
+
+    if (isTopLineValid) {
+        size_t iNewTopLine = drte_line_cache_find_line_by_character(pView->pWrappedLines, iTopLineCharBeg);
+        if (iNewTopLine > iTopLine) {
+            pView->innerOffsetY -= (iNewTopLine - iTopLine) * drte_engine_get_line_height(pView->pEngine);
+        } else {
+            pView->innerOffsetY += (iTopLine - iNewTopLine) * drte_engine_get_line_height(pView->pEngine);
+        }
+    }
+
+    return DRTE_TRUE;
+}
+
+// Wraps the unwrapped lines in view that haven't yet been wrapped against the current size of the view.
+static void drte_view__wrap_visible_lines(drte_view* pView)
+{
+    assert(pView != NULL);
+
+    // Wrapping the lines in view can bring more lines into view when they get shorter, hence the loop.
+    size_t iLineEnd = 0;
+    for (;;) {
+        size_t iTopLine;
+        size_t iBottomLine;
+        drte_view_get_visible_lines(pView, &iTopLine, &iBottomLine);
+        if (iTopLine > iBottomLine) {
+            break;  // Scrolled past the end.
+        }
+
+        size_t iFirstLine = drte_line_cache_find_line_by_character(pView->pEngine->pUnwrappedLines, drte_line_cache_get_line_first_character(pView->pWrappedLines, iTopLine));
+        size_t iLastLine  = drte_line_cache_find_line_by_character(pView->pEngine->pUnwrappedLines, drte_line_cache_get_line_first_character(pView->pWrappedLines, iBottomLine));
+        if (iFirstLine < pView->_iNextLineToWrap) {
+            iFirstLine = pView->_iNextLineToWrap;
+        }
+        if (iFirstLine < iLineEnd) {
+            iFirstLine = iLineEnd;
+        }
+
+        if (iFirstLine > iLastLine) {
+            break;
+        }
+
+        if (!drte_view__rewrap_lines_in_place(pView, iFirstLine, iLastLine - iFirstLine + 1)) {
+            break;
+        }
+
+        iLineEnd = iLastLine + 1;
+    }
+}
+
+// Cursors need to have their sticky positions refreshed after the lines have been wrapped differently.
+static void drte_view__on_word_wrapping_changed(drte_view* pView)
+{
+    assert(pView != NULL);
+
+    drte_view_begin_dirty(pView);
+    {
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            drte_view_move_cursor_to_character(pView, iCursor, drte_view_get_cursor_character(pView, iCursor));
+        }
+
+        drte_view__repaint(pView);
+    }
+    drte_view_end_dirty(pView);
+}
+
+// Called when the text has been replaced in it's entirety or word wrap has just been enabled. The wrapped lines start out the same as
+// the unwrapped lines and are then wrapped like they would be after a change in width.
+static void drte_view__refresh_word_wrapping(drte_view* pView)
+{
+    if (drte_view_is_word_wrap_enabled(pView)) {
+        // Every line needs to be known in order to wrap them.
+        drte_engine_index_lines_to_line(pView->pEngine, (size_t)-1);
+
+        size_t lineCount = drte_line_cache_get_line_count(pView->pEngine->pUnwrappedLines);
+        size_t* pLineOffsets = (size_t*)malloc(lineCount * sizeof(*pLineOffsets));
+        if (pLineOffsets != NULL) {
+            drte_line_cache__node_flatten(pView->pEngine->pUnwrappedLines->pRoot, pLineOffsets);
+            drte_line_cache__rebuild(pView->pWrappedLines, pLineOffsets, lineCount);
+            free(pLineOffsets);
+        } else {
+            drte_line_cache_clear(pView->pWrappedLines);
+        }
+    }
+
+    drte_view__invalidate_word_wrapping(pView);
+}
+
+// Called when something affecting the width of the text, but not the text itself, has changed. The lines in view are wrapped straight
+// away and the rest are left for drte_view_wrap_lines().
+static void drte_view__invalidate_word_wrapping(drte_view* pView)
+{
+    drte_view__clear_measurements(pView);
+
+    if (drte_view_is_word_wrap_enabled(pView)) {
+        pView->_iNextLineToWrap = 0;
+        drte_view__wrap_visible_lines(pView);
+    }
+
+    drte_view__on_word_wrapping_changed(pView);
+}
+
+// Called after an edit to re-wrap only the unwrapped lines it touched. See drte_view__rewrap_lines(). This does not repaint, which is
+// left to drte_view__on_word_wrapping_changed() once the cursors have been moved.
+static void drte_view__update_word_wrapping(drte_view* pView, size_t iFirstLine, size_t lineCount, size_t characterOffset)
+{
+    if (drte_view_is_word_wrap_enabled(pView)) {
+        if (!drte_view__rewrap_lines(pView, iFirstLine, lineCount, characterOffset)) {
+            drte_view__refresh_word_wrapping(pView);
+            return;
+        }
+
+        // Lines after the edit have moved which means anything still to be wrapped needs to be picked up from the end of the edit.
+        if (pView->_iNextLineToWrap != (size_t)-1 && iFirstLine < pView->_iNextLineToWrap) {
+            pView->_iNextLineToWrap = iFirstLine + lineCount;
+        }
+    }
+}
+
+
+
+drte_view* drte_view_create(drte_engine* pEngine)
+{
+    if (pEngine == NULL) {
+        return NULL;
+    }
+
+    drte_view* pView = (drte_view*)calloc(1, sizeof(*pView));
+    if (pView == NULL) {
+        return NULL;
+    }
+
+    pView->pEngine = pEngine;
+    pView->tabSizeInSpaces = 4;
+    pView->cursorWidth = 1;
+    pView->scale = 1;
+    
+    pView->_id = drte_engine__acquire_view_id(pEngine);
+    pView->_accumulatedDirtyRect = drte_make_inside_out_rect();
+    pView->pWrappedLines = &pEngine->_unwrappedLines;
+
+
+    // Attach the view to the start of the list.
+    pView->_pPrevView = NULL;
+    pView->_pNextView = pEngine->pRootView;
+
+    if (pEngine->pRootView != NULL) {
+        pEngine->pRootView->_pPrevView = pView;
+    }
+
+    pEngine->pRootView = pView;
+
+
+    return pView;
+}
+
+void drte_view_delete(drte_view* pView)
+{
+    if (pView == NULL) {
+        return;
+    }
+
+    // Remove the view from the list first.
+    if (pView->pEngine->pRootView == pView) {
+        pView->pEngine->pRootView = pView->_pNextView;
+    }
+    
+    if (pView->_pNextView != NULL) {
+        pView->_pNextView->_pPrevView = pView->_pPrevView;
+    }
+    if (pView->_pPrevView != NULL) {
+        pView->_pPrevView->_pNextView = pView->_pNextView;
+    }
+
+    drte_line_cache_uninit(&pView->_wrappedLines);
+    drte_search_pattern_uninit(&pView->_findPattern);
+    drte_regex_uninit(&pView->_findRegex);
+    drte_search_pattern_uninit(&pView->_matchPattern);
+    free(pView->_pMatches);
+    free(pView->_pLineWidths);
+    for (size_t i = 0; i < pView->_longLineCount; ++i) {
+        free(pView->_pLongLines[i].pCheckpoints);
+    }
+    free(pView->_pLongLines);
+    free(pView->_pSortedSelections);
+    free(pView->pSelections);
+    free(pView->pCursors);
+    free(pView);
+}
+
+
+void drte_view_set_size(drte_view* pView, float sizeX, float sizeY)
+{
+    if (pView == NULL) {
+        return;
+    }
+
+    drte_bool32 sizeXChanged = pView->sizeX != sizeX;
+    drte_bool32 sizeYChanged = pView->sizeY != sizeY;
+    if (!sizeXChanged && !sizeYChanged) {
+        return;
+    }
+
+    pView->sizeX = sizeX;
+    pView->sizeY = sizeY;
+
+    if (sizeXChanged && drte_view_is_word_wrap_enabled(pView)) {
+        drte_view__invalidate_word_wrapping(pView);
+    } else {
+        drte_view__repaint(pView);
+    }
+}
+
+void drte_view_get_size(drte_view* pView, float* pSizeXOut, float* pSizeYOut)
+{
+    if (pSizeXOut != NULL) *pSizeXOut = 0;
+    if (pSizeYOut != NULL) *pSizeYOut = 0;
+    if (pView == NULL) return;
+
+    if (pSizeXOut != NULL) *pSizeXOut = pView->sizeX;
+    if (pSizeYOut != NULL) *pSizeYOut = pView->sizeY;
+}
+
+
+void drte_view_set_inner_offset(drte_view* pView, float innerOffsetX, float innerOffsetY)
+{
+    if (pView == NULL) {
+        return;
+    }
+
+    pView->innerOffsetX = innerOffsetX;
+    pView->innerOffsetY = innerOffsetY;
+
+    drte_view__repaint(pView);
+}
+
+void drte_view_get_inner_offset(drte_view* pView, float* pInnerOffsetXOut, float* pInnerOffsetYOut)
+{
+    if (pInnerOffsetXOut != NULL) *pInnerOffsetXOut = 0;
+    if (pInnerOffsetYOut != NULL) *pInnerOffsetYOut = 0;
+    if (pView == NULL) return;
+
+    if (pInnerOffsetXOut != NULL) *pInnerOffsetXOut = pView->innerOffsetX;
+    if (pInnerOffsetYOut != NULL) *pInnerOffsetYOut = pView->innerOffsetY;
+}
+
+
+void drte_view_set_tab_size(drte_view* pView, unsigned int sizeInSpaces)
+{
+    if (pView == NULL || pView->tabSizeInSpaces == sizeInSpaces) {
+        return;
+    }
+
+    pView->tabSizeInSpaces = sizeInSpaces;
+    drte_view__invalidate_word_wrapping(pView);
+}
+
+
+void drte_view_begin_dirty(drte_view* pView)
+{
+    if (pView == NULL) {
+        return;
+    }
+
+    pView->_dirtyCounter += 1;
+}
+
+void drte_view_end_dirty(drte_view* pView)
+{
+    if (pView == NULL) {
+        return;
+    }
+
+    assert(pView->_dirtyCounter > 0);
+
+    pView->_dirtyCounter -= 1;
+
+    if (pView->_dirtyCounter == 0) {
+        if (pView->pEngine->onDirty && drte_rect_has_volume(pView->_accumulatedDirtyRect)) {
+            pView->pEngine->onDirty(pView->pEngine, pView, pView->_accumulatedDirtyRect);
+        }
+
+        pView->_accumulatedDirtyRect = drte_make_inside_out_rect();
+    }
+}
+
+void drte_view_dirty(drte_view* pView, drte_rect rect)
+{
+    if (pView == NULL) {
+        return;
+    }
+
+    drte_view_begin_dirty(pView);
+    pView->_accumulatedDirtyRect = drte_rect_union(pView->_accumulatedDirtyRect, rect);
+    drte_view_end_dirty(pView);
+}
+
+void drte_view_paint(drte_view* pView, drte_rect rect, void* pPaintData)
+{
+    if (pView == NULL || pView->pEngine->onPaintText == NULL || pView->pEngine->onPaintRect == NULL) {
+        return;
+    }
+
+    if (rect.left < 0) {
+        rect.left = 0;
+    }
+    if (rect.top < 0) {
+        rect.top = 0;
+    }
+    if (rect.right > pView->sizeX) {
+        rect.right = pView->sizeX;
+    }
+    if (rect.bottom > pView->sizeY) {
+        rect.bottom = pView->sizeY;
+    }
+
+    if (rect.right <= rect.left || rect.bottom <= rect.top) {
+        return;
+    }
+
+    float lineHeight = drte_engine_get_line_height(pView->pEngine);
+
+
+    size_t iFirstVisibleLine;
+    size_t iLastVisibleLine;
+    drte_view_get_visible_lines(pView, &iFirstVisibleLine, &iLastVisibleLine);
+
+    // Only the lines intersecting the rectangle are painted. This is what keeps small invalidations like a cursor blink or a
+    // single typed character down to the cost of a single line.
+    size_t iLineTop    = iFirstVisibleLine + (size_t)(rect.top / lineHeight);
+    size_t iLineBottom = iFirstVisibleLine + (size_t)ceilf(rect.bottom / lineHeight) - 1;
+    if (iLineBottom > iLastVisibleLine) {
+        iLineBottom = iLastVisibleLine;
+    }
+
+    pView->_paintedLineCount = 0;
+
+    float linePosX = pView->innerOffsetX;
+    float linePosY = (iLineTop - iFirstVisibleLine) * lineHeight;
+
+    drte_segment segment;
+    if (iLineTop > iLineBottom) {
+        // The rectangle is entirely below the last line so there are no lines to paint.
+    } else if (drte_engine__first_segment_on_line(pView, pView->pWrappedLines, iLineTop, (size_t)-1, &segment)) {
+        size_t iLine = iLineTop;
+        while (iLine <= iLineBottom) {
+            // Long lines are started from the checkpoint closest to the left of the rectangle rather than their first character.
+            drte_view__seek_segment(pView, &segment, rect.left - linePosX, (size_t)-1);
+
+            float lineWidth = segment.posX;
+            pView->_paintedLineCount += 1;
+
+            do
+            {
+                if (linePosX + segment.posX > rect.right) {
+                    // All remaining segments on this line (including this one) is clipped. Go to the next line.
+                    segment.iCharBeg = segment.iLineCharEnd;
+                    segment.iCharEnd = segment.iLineCharEnd;
+                    segment.isAtEndOfLine = DRTE_TRUE;
+                    break;
+                }
+
+                lineWidth += segment.width;
+
+                // Don't draw segments to the left of the rectangle.
+                if (linePosX + segment.posX + segment.width < rect.left) {
+                    if (segment.iCharBeg == segment.iLineCharEnd) {
+                        break;
+                    }
+                    continue;
+                }
+
+                uint32_t c = drte_engine_get_utf32(pView->pEngine, segment.iCharBeg);
+                if (c == '\t' || segment.iCharBeg == segment.iLineCharEnd) {
+                    // It's whitespace.
+                    if (segment.iCharBeg == segment.iLineCharEnd) {
+                        // TODO: Only do this if the character is selected.
+                        uint32_t cend = drte_engine_get_utf32(pView->pEngine, segment.iCharBeg);
+                        if (cend == '\r' || cend == '\n') {
+                            segment.width = pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth;
+                            lineWidth += segment.width;
+                        }
+                    }
+
+                    drte_style_token bgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.bgStyleSlot);
+                    if (pView->pEngine->onPaintRect && bgStyleToken != 0) {
+                        pView->pEngine->onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(linePosX + segment.posX, linePosY, linePosX + segment.posX + segment.width, linePosY + lineHeight), pPaintData);
+                    }
+                } else {
+                    // It's normal text.
+                    // TODO: Gather the text and properly support UTF-8.
+                    const char* text = drte_engine__get_text_range(pView->pEngine, segment.iCharBeg, segment.iCharEnd);
+                    size_t textLength = segment.iCharEnd - segment.iCharBeg;
+
+                    // TODO: Draw text on the base line to properly handle font's of differing sizes.
+
+                    drte_style_token fgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot);
+                    drte_style_token bgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.bgStyleSlot);
+                    if (pView->pEngine->onPaintText && fgStyleToken != 0 && bgStyleToken != 0) {
+                        pView->pEngine->onPaintText(pView->pEngine, pView, fgStyleToken, bgStyleToken, text, textLength, linePosX + segment.posX, linePosY, pPaintData);
+                    }
+                }
+
+                if (segment.iCharBeg == segment.iLineCharEnd) {
+                    break;
+                }
+            } while (drte_engine__next_segment(pView, &segment));
+
+
+            // The part after the end of the line needs to be drawn.
+            float lineRight = linePosX + lineWidth;
+            if (lineRight < rect.right) {
+                drte_style_token bgStyleToken = pView->pEngine->styles[pView->pEngine->defaultStyleSlot].styleToken;
+                if (pView->cursorCount > 0 && segment.iLine == drte_view_get_cursor_line(pView, pView->cursorCount-1)) {
+                    bgStyleToken = pView->pEngine->styles[pView->pEngine->activeLineStyleSlot].styleToken;
+                }
+
+                if (pView->pEngine->onPaintRect && bgStyleToken != 0) {
+                    pView->pEngine->onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(lineRight, linePosY, pView->sizeX, linePosY + lineHeight), pPaintData);
+                }
+            }
+
+            linePosY += lineHeight;
+
+
+            // Go to the first segment of the next line.
+            if (!drte_engine__next_segment(pView, &segment)) {
+                break;
+            }
+
+            iLine += 1;
+        }
+    } else {
+        // Couldn't create a segment iterator. Likely means there is no text. Just draw a single blank line.
+        drte_style_token bgStyleToken = pView->pEngine->styles[pView->pEngine->activeLineStyleSlot].styleToken;
+        if (pView->pEngine->onPaintRect && bgStyleToken != 0) {
+            pView->pEngine->onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(linePosX, linePosY, pView->sizeX, linePosY + lineHeight), pPaintData);
+        }
+
+        pView->_paintedLineCount = 1;
+    }
+
+
+    // Cursors.
+    if (drte_view_is_showing_cursors(pView) && pView->pEngine->isCursorBlinkOn && pView->pEngine->styles[pView->pEngine->cursorStyleSlot].styleToken != 0) {
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            drte_rect cursorRect = drte_view_get_cursor_rect(pView, iCursor);
+            if (cursorRect.right < rect.left || cursorRect.left > rect.right || cursorRect.bottom <= rect.top || cursorRect.top >= rect.bottom) {
+                continue;
+            }
+
+            pView->pEngine->onPaintRect(pView->pEngine, pView, pView->pEngine->styles[pView->pEngine->cursorStyleSlot].styleToken, cursorRect, pPaintData);
+        }
+    }
+
+
+    // The rectangle region below the last line. Only the part intersecting the rectangle is drawn.
+    float tailTop = (iLastVisibleLine + 1) * lineHeight + pView->innerOffsetY;
+    if (tailTop < rect.bottom && pView->pEngine->styles[pView->pEngine->defaultStyleSlot].styleToken != 0) {
+        drte_rect tailRect;
+        tailRect.left = rect.left;
+        tailRect.top = (tailTop > rect.top) ? tailTop : rect.top;
+        tailRect.right = rect.right;
+        tailRect.bottom = rect.bottom;
+        pView->pEngine->onPaintRect(pView->pEngine, pView, pView->pEngine->styles[pView->pEngine->defaultStyleSlot].styleToken, tailRect, pPaintData);
+    }
+}
+
+size_t drte_view_get_painted_line_count(drte_view* pView)
+{
+    if (pView == NULL) return 0;
+    return pView->_paintedLineCount;
+}
+
+void drte_view_paint_line_numbers(drte_view* pView, float lineNumbersWidth, float lineNumbersHeight, drte_engine_on_paint_text_proc onPaintText, drte_engine_on_paint_rect_proc onPaintRect, void* pPaintData)
+{
+    if (pView == NULL || onPaintText == NULL || onPaintRect == NULL) {
+        return;
+    }
+
+    float lineHeight = drte_engine_get_line_height(pView->pEngine);
+
+    size_t iLineTop;
+    size_t iLineBottom;
+    drte_view_get_visible_lines(pView, &iLineTop, &iLineBottom);
+
+    drte_style_token fgStyleToken = pView->pEngine->styles[pView->pEngine->lineNumbersStyleSlot].styleToken;
+    drte_style_token bgStyleToken = pView->pEngine->styles[pView->pEngine->lineNumbersStyleSlot].styleToken;
+
+    size_t lineNumber = iLineTop;
+
+    float lineTop = pView->innerOffsetY + (iLineTop * lineHeight);
+    for (size_t iLine = iLineTop; iLine <= iLineBottom; ++iLine) {
+        float lineBottom = lineTop + lineHeight;
+        drte_bool32 drawLineNumber = DRTE_FALSE;
+
+        size_t iLineCharBeg;
+        size_t iLineCharEnd;
+        drte_view_get_line_character_range(pView, pView->pWrappedLines, iLine, &iLineCharBeg, &iLineCharEnd);
+        if (iLine == 0 || drte_engine__get_char(pView->pEngine, iLineCharBeg-1) == '\n') {
+            lineNumber += 1;
+            drawLineNumber = DRTE_TRUE;
+        }
+
+        if (drawLineNumber) {
+            char iLineStr[64];
+            snprintf(iLineStr, sizeof(iLineStr), "%d", (int)lineNumber);   // TODO: drte_string_to_int(). This snprintf() has shown up in profiling so best fix this.
+
+            dtk_int32 textWidth = 0;
+            dtk_int32 textHeight = 0;
+            if (pView->pEngine->onMeasureString && fgStyleToken) {
+                pView->pEngine->onMeasureString(pView->pEngine, fgStyleToken, pView->scale, iLineStr, strlen(iLineStr), &textWidth, &textHeight);
+            }
+
+            float textLeft = lineNumbersWidth - textWidth;
+            float textTop  = lineTop + (lineHeight - textHeight) / 2;
+
+            if (fgStyleToken != 0 && bgStyleToken != 0) {
+                onPaintText(pView->pEngine, pView, fgStyleToken, bgStyleToken, iLineStr, strlen(iLineStr), textLeft, textTop, pPaintData);
+                onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(0, lineTop, textLeft, lineBottom), pPaintData);
+
+                // There could be a region above and below the text. This will happen if the line height of the line numbers is
+                // smaller than the main line height.
+                if (textHeight < lineHeight) {
+                    onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(textLeft, lineTop, lineNumbersWidth, textTop), pPaintData);
+                    onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(textLeft, textTop + textHeight, lineNumbersWidth, lineBottom), pPaintData);
+                }
+            }
+        } else {
+            if (fgStyleToken != 0 && bgStyleToken != 0) {
+                onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(0, lineTop, lineNumbersWidth, lineBottom), pPaintData);
+            }
+        }
+
+        lineTop = lineBottom;
+    }
+
+    // The region below the lines.
+    if (lineTop < pView->sizeY && bgStyleToken != 0) {
+        onPaintRect(pView->pEngine, pView, bgStyleToken, drte_make_rect(0, lineTop, lineNumbersWidth, lineNumbersHeight), pPaintData);
+    }
+}
+
+
+drte_rect drte_view_get_local_rect(drte_view* pView)
+{
+    if (pView == NULL) {
+        return drte_make_rect(0, 0, 0, 0);
+    }
+
+    return drte_make_rect(0, 0, pView->sizeX, pView->sizeY);
+}
+
+
+void drte_view_enable_word_wrap(drte_view* pView)
+{
+    if (pView == NULL && !drte_view_is_word_wrap_enabled(pView)) {
+        return;
+    }
+
+    // The wrapped line cache will not have been initialized at this point so we need to do that first.
+    if (!drte_line_cache_init(&pView->_wrappedLines)) {
+        return;
+    }
+    pView->pWrappedLines = &pView->_wrappedLines;
+
+    pView->flags |= DRTE_WORD_WRAP_ENABLED;
+    drte_view__refresh_word_wrapping(pView);
+}
+
+void drte_view_disable_word_wrap(drte_view* pView)
+{
+    if (pView == NULL && drte_view_is_word_wrap_enabled(pView)) {
+        return;
+    }
+
+    // We do not need the wrapped line cache.
+    pView->pWrappedLines = &pView->pEngine->_unwrappedLines;
+    drte_line_cache_uninit(&pView->_wrappedLines);
+
+    pView->flags &= ~DRTE_WORD_WRAP_ENABLED;
+    drte_view__refresh_word_wrapping(pView);
+}
+
+drte_bool32 drte_view_is_word_wrap_enabled(drte_view* pView)
+{
+    return (pView->flags & DRTE_WORD_WRAP_ENABLED) != 0;
+}
+
+drte_bool32 drte_view_wrap_lines(drte_view* pView, size_t maxLineCount)
+{
+    if (pView == NULL || drte_view_is_word_wrapping_complete(pView)) {
+        return DRTE_TRUE;
+    }
+
+    drte_view_begin_dirty(pView);
+    {
+        // Whatever is in view comes first in case it's been scrolled to since the lines were invalidated.
+        drte_view__wrap_visible_lines(pView);
+
+        size_t lineCount = drte_line_cache_get_line_count(pView->pEngine->pUnwrappedLines);
+        size_t iFirstLine = pView->_iNextLineToWrap;
+        if (iFirstLine > lineCount) {
+            iFirstLine = lineCount;
+        }
+        if (maxLineCount > lineCount - iFirstLine) {
+            maxLineCount = lineCount - iFirstLine;
+        }
+
+        if (drte_view__rewrap_lines_in_place(pView, iFirstLine, maxLineCount)) {
+            pView->_iNextLineToWrap = iFirstLine + maxLineCount;
+            if (pView->_iNextLineToWrap >= lineCount) {
+                pView->_iNextLineToWrap = (size_t)-1;
+            }
+        }
+
+        // The lines the cursors are on are updated without moving them so the caller doesn't scroll back to them.
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            pView->pCursors[iCursor].iLine = drte_view_get_character_line(pView, pView->pWrappedLines, pView->pCursors[iCursor].iCharAbs);
+        }
+
+        drte_view__repaint(pView);
+    }
+    drte_view_end_dirty(pView);
+
+    return drte_view_is_word_wrapping_complete(pView);
+}
+
+drte_bool32 drte_view_is_word_wrapping_complete(drte_view* pView)
+{
+    if (pView == NULL || !drte_view_is_word_wrap_enabled(pView)) {
+        return DRTE_TRUE;
+    }
+
+    return pView->_iNextLineToWrap == (size_t)-1;
+}
+
+
+size_t drte_view_get_character_line(drte_view* pView, drte_line_cache* pLineCache, size_t characterIndex)
+{
+    if (pView == NULL) {
+        return 0;
+    }
+
+    if (pLineCache == NULL) pLineCache = pView->pWrappedLines;
+
+    if (pLineCache == pView->pEngine->pUnwrappedLines) {
+        drte_engine__index_lines_to_character(pView->pEngine, characterIndex);
+    }
+
+    return drte_line_cache_find_line_by_character(pLineCache, characterIndex);
+}
+
+void drte_view_get_character_position(drte_view* pView, drte_line_cache* pLineCache, size_t characterIndex, float* pPosXOut, float* pPosYOut)
+{
+    if (pPosXOut) *pPosXOut = 0;
+    if (pPosYOut) *pPosYOut = 0;
+
+    if (pView == NULL) {
+        return;
+    }
+
+    size_t lineIndex = drte_view_get_character_line(pView, pLineCache, characterIndex);
+
+    float posX = 0;
+    float posY = lineIndex * drte_engine_get_line_height(pView->pEngine);
+
+    drte_segment segment;
+    if (drte_engine__first_segment_on_line(pView, pLineCache, lineIndex, (size_t)-1, &segment)) {
+        drte_view__seek_segment(pView, &segment, FLT_MAX, characterIndex);
+        do
+        {
+            if (characterIndex >= segment.iCharBeg && characterIndex < segment.iCharEnd) {
+                // It's somewhere in this segment.
+                if (drte_engine_get_utf32(pView->pEngine, segment.iCharBeg) == '\t') {
+                    // If the first character in the segment is a tab character, then every character in this segment
+                    // will be a tab. The location of the character is rounded to the nearest tab column.
+                    posX = segment.posX;
+
+                    size_t tabCount = characterIndex - segment.iCharBeg;
+                    if (tabCount > 0) {
+                        float tabWidth = drte_view__get_tab_width_in_pixels(pView);
+                        float nextTabPos = (float)((int)(segment.posX / tabWidth) + 1) * tabWidth;
+                        posX = nextTabPos + ((tabCount-1) * tabWidth);
+                    }
+                } else {
+                    // We must refer to the backend in order to find the exact position of the character.
+                    // TODO: Grab a copy of the string rather than a direct offset.
+                    drte_style_token fgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot);
+                    if (pView->pEngine->onGetCursorPositionFromChar && fgStyleToken != 0) {
+                        pView->pEngine->onGetCursorPositionFromChar(pView->pEngine, fgStyleToken, pView->scale, drte_engine__get_text_range(pView->pEngine, segment.iCharBeg, segment.iCharEnd), characterIndex - segment.iCharBeg, &posX);
+                        posX += segment.posX;
+                    }
+                }
+
+                break;
+            }
+        } while (drte_engine__next_segment_on_line(pView, &segment));
+    }
+
+    if (pPosXOut) *pPosXOut = posX;
+    if (pPosYOut) *pPosYOut = posY;
+}
+
+drte_bool32 drte_view_get_character_under_point_relative_to_text(drte_view* pView, drte_line_cache* pLineCache, float inputPosXRelativeToText, float inputPosYRelativeToText, size_t* piCharOut, size_t* piLineOut)
+{
+    if (piCharOut) *piCharOut = 0;
+    if (piLineOut) *piLineOut = 0;
+
+    if (pView == NULL) {
+        return DRTE_FALSE;
+    }
+
+    size_t iLine = drte_view_get_line_at_pos_y(pView, pLineCache, inputPosYRelativeToText);
+    size_t iChar = 0;
+
+    if (piLineOut) *piLineOut = iLine;
+
+    // Once we have the line, finding the specific character under the point is done by iterating over each segment and finding the one
+    // containing the point on the x axis. Once the segment has been found, we use the backend to get the exact character.
+    if (inputPosXRelativeToText < 0) {
+        iChar = drte_view_get_line_first_character(pView, pLineCache, (size_t)iLine);   // It's to the left of the line, so just pin it to the first character in the line.
+        
+        if (piCharOut) *piCharOut = iChar;
+        return DRTE_FALSE;   // <-- Return DRTE_FALSE because it's not actually over a character (it's to the left).
+    }
+
+    drte_segment segment;
+    if (drte_engine__first_segment_on_line(pView, pLineCache, (size_t)iLine, (size_t)-1, &segment)) {
+        drte_view__seek_segment(pView, &segment, inputPosXRelativeToText, (size_t)-1);
+        do
+        {
+            if (inputPosXRelativeToText >= segment.posX && inputPosXRelativeToText < segment.posX + segment.width) {
+                // It's somewhere on this run. If it's a tab segment it needs to be handled slightly differently because of the way tabs
+                // are aligned to tab columns.
+                if (drte_engine_get_utf32(pView->pEngine, segment.iCharBeg) == '\t') {
+                    const float tabWidth = drte_view__get_tab_width_in_pixels(pView);
+
+                    iChar = segment.iCharBeg;
+
+                    float tabLeft = segment.posX;
+                    for (/* Do Nothing*/; iChar < segment.iCharEnd; ++iChar)
+                    {
+                        float tabRight = tabWidth * ((segment.posX + (tabWidth*((iChar-segment.iCharBeg) + 1))) / tabWidth);
+                        if (inputPosXRelativeToText >= tabLeft && inputPosXRelativeToText <= tabRight)
+                        {
+                            // The input position is somewhere on top of this character. If it's positioned on the left side of the character, set the output
+                            // value to the character at iChar. Otherwise it should be set to the character at iChar + 1.
+                            float charBoundsRightHalf = tabLeft + ceilf(((tabRight - tabLeft) / 2.0f));
+                            if (inputPosXRelativeToText > charBoundsRightHalf) {
+                                iChar += 1;
+                            }
+
+                            break;
+                        }
+
+                        tabLeft = tabRight;
+                    }
+                } else {
+                    float unused;
+                    size_t iCharTemp;
+
+                    drte_style_token fgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot);
+                    if (pView->pEngine->onGetCursorPositionFromPoint) {
+                        pView->pEngine->onGetCursorPositionFromPoint(pView->pEngine, fgStyleToken, pView->scale, drte_engine__get_text_range(pView->pEngine, segment.iCharBeg, segment.iCharEnd), segment.iCharEnd - segment.iCharBeg, segment.width, inputPosXRelativeToText - segment.posX, &unused, &iCharTemp);
+                        iChar = segment.iCharBeg + iCharTemp;
+                    }
+                }
+
+                if (piCharOut) *piCharOut = iChar;
+
+                // It's possible that the Y position is not actually over a line. Whether or not we return DRTE_TRUE or DRTE_FALSE depends on this.
+                if (inputPosYRelativeToText < 0) {
+                    return DRTE_FALSE;
+                } else {
+                    if (inputPosYRelativeToText >= (drte_view_get_line_count(pView) * drte_engine_get_line_height(pView->pEngine))) {
+                        return DRTE_FALSE;
+                    }
+                }
+
+                return DRTE_TRUE;
+            }
+        } while (drte_engine__next_segment_on_line(pView, &segment));
+
+        // If we get here it means the position is to the right of the line. Just pin it to the end of the line.
+        iChar = segment.iCharBeg;   // <-- segment.iCharBeg should be sitting on a new line or null terminator.
+
+        if (piCharOut) *piCharOut = iChar;
+        return DRTE_FALSE;   // <-- Return DRTE_FALSE because it's not actually over a character (it's to the right)
+    }
+
+    return DRTE_FALSE;
+}
+
+drte_bool32 drte_view_get_character_under_point(drte_view* pView, drte_line_cache* pLineCache, float inputPosXRelativeToContainer, float inputPosYRelativeToContainer, size_t* piCharOut, size_t* piLineOut)
+{
+    if (pView == NULL) {
+        return 0;
+    }
+
+    float inputPosXRelativeToText = inputPosXRelativeToContainer - pView->innerOffsetX;
+    float inputPosYRelativeToText = inputPosYRelativeToContainer - pView->innerOffsetY;
+    return drte_view_get_character_under_point_relative_to_text(pView, pLineCache, inputPosXRelativeToText, inputPosYRelativeToText, piCharOut, piLineOut);
+}
+
+void drte_view_get_visible_lines(drte_view* pView, size_t* pFirstLineOut, size_t* pLastLineOut)
+{
+    if (pFirstLineOut) *pFirstLineOut = 0;
+    if (pLastLineOut) *pLastLineOut = 0;
+    if (pView == NULL) return;
+
+    size_t iFirstLine = (size_t)(-pView->innerOffsetY / drte_engine_get_line_height(pView->pEngine));
+
+    if (pFirstLineOut) {
+        *pFirstLineOut = iFirstLine;
+    }
+
+    if (pLastLineOut) {
+        size_t lineCount = drte_view_get_line_count(pView);
+        size_t iLastLine = iFirstLine + ((size_t)(pView->sizeY / drte_engine_get_line_height(pView->pEngine)));
+        if (lineCount == 0) {
+            iLastLine = 0;
+        } else {
+            if (iLastLine >= lineCount) {
+                iLastLine = lineCount - 1;
+            }
+        }
+
+        *pLastLineOut = iLastLine;
+    }
+}
+
+size_t drte_view_get_line_count(drte_view* pView)
+{
+    if (pView == NULL) return 0;
+    return drte_line_cache_get_line_count(pView->pWrappedLines);
+}
+
+size_t drte_view_get_line_count_per_page(drte_view* pView)
+{
+    if (pView == NULL) return 1;
+
+    size_t lineCount = (size_t)(pView->sizeY / drte_engine_get_line_height(pView->pEngine));
+    if (lineCount == 0) {
+        lineCount = 1;  // Always at least one line on a page.
+    }
+
+    return lineCount;
+}
+
+size_t drte_view_get_page_count(drte_view* pView)
+{
+    if (pView == NULL) return 1;
+
+    size_t lineCount    = drte_view_get_line_count(pView);
+    size_t linesPerPage = drte_view_get_line_count_per_page(pView);
+
+    size_t pageCount = lineCount / linesPerPage;
+
+    // Don't forget the last page. We use a mod operation for this to ensure we don't add a blank page
+    // in the case that the last line is sitting on the last line of the last printed page.
+    if (lineCount % linesPerPage != 0) {
+        pageCount += 1;
+    }
+
+    return pageCount;
+}
+
+size_t drte_view_get_visible_line_count(drte_view* pView)
+{
+    if (pView == NULL) return 0;
+    return (size_t)(pView->sizeY / drte_engine_get_line_height(pView->pEngine)) + 1;
+}
+
+float drte_view_get_visible_line_width(drte_view* pView)
+{
+    if (pView == NULL) return 0;
+
+    size_t iLineTop;
+    size_t iLineBottom;
+    drte_view_get_visible_lines(pView, &iLineTop, &iLineBottom);
+
+    float maxLineWidth = 0;
+
+    size_t lineCount = drte_view_get_line_count(pView);
+    for (size_t iLine = iLineTop; iLine <= iLineBottom && iLine < lineCount; ++iLine) {
+        float lineWidth = drte_view__get_line_width(pView, iLine);
+        if (maxLineWidth < lineWidth) {
+            maxLineWidth = lineWidth;
+        }
+    }
+
+    return maxLineWidth;
+}
+
+void drte_view_measure_line(drte_view* pView, size_t iLine, float* pSizeXOut, float* pSizeYOut)
+{
+    if (pSizeXOut) *pSizeXOut = 0;
+    if (pSizeYOut) *pSizeYOut = 0;
+
+    if (pView == NULL) {
+        return;
+    }
+
+    if (pSizeYOut) *pSizeYOut = drte_engine_get_line_height(pView->pEngine);
+    if (pSizeXOut) *pSizeXOut = drte_view__get_line_width(pView, iLine);
+}
+
+float drte_view_get_line_pos_y(drte_view* pView, size_t iLine)
+{
+    return iLine * drte_engine_get_line_height(pView->pEngine);
+}
+
+size_t drte_view_get_line_at_pos_y(drte_view* pView, drte_line_cache* pLineCache, float posY)
+{
+    if (pView == NULL) return 0;
+    if (pLineCache == NULL) pLineCache = pView->pWrappedLines;
+
+    size_t lineCount = drte_line_cache_get_line_count(pLineCache);
+    if (lineCount == 0) {
+        return 0;
+    }
+
+    intptr_t iLine = (intptr_t)(posY / drte_engine_get_line_height(pView->pEngine));
+    if (iLine < 0) {
+        iLine = 0;
+    }
+    if ((size_t)iLine >= lineCount) {
+        iLine = lineCount-1;
+    }
+
+    return iLine;
+}
+
+size_t drte_view_get_line_first_character(drte_view* pView, drte_line_cache* pLineCache, size_t iLine)
+{
+    if (pView == NULL || iLine == 0) {
+        return 0;
+    }
+
+    if (pLineCache == NULL) pLineCache = pView->pWrappedLines;
+    return drte_line_cache_get_line_first_character(pLineCache, iLine);
+}
+
+size_t drte_view_get_line_last_character(drte_view* pView, drte_line_cache* pLineCache, size_t iLine)
+{
+    if (pView == NULL) {
+        return 0;
+    }
+
+    if (pLineCache == NULL) pLineCache = pView->pWrappedLines;
+
+    // The end of the last line isn't known until the next line has been indexed.
+    if (pLineCache == pView->pEngine->pUnwrappedLines && iLine+1 >= drte_line_cache_get_line_count(pLineCache)) {
+        drte_engine__index_lines_to_character(pView->pEngine, pView->pEngine->textLength - pView->pEngine->unindexedLength);
+    }
+
+
+    // The line caches only store the index of the first character of the line. We can quality get the last character of the line
+    // by simply interrogating the first character of the _next_ line. However, there is no next line for the last line so we handle
+    // that one in a special way.
+    if (iLine+1 < drte_line_cache_get_line_count(pLineCache)) {
+        size_t iLineEnd = drte_line_cache_get_line_first_character(pLineCache, iLine+1);
+        assert(iLineEnd > 0);
+
+        if (drte_engine__get_char(pView->pEngine, iLineEnd-1) == '\n') {
+            iLineEnd -= 1;
+            if (iLineEnd > 0) {
+                if (drte_engine__get_char(pView->pEngine, iLineEnd-1) == '\r') {
+                    iLineEnd -= 1;
+                }
+            }
+        }
+
+        return iLineEnd;
+    }
+
+    // It's the last line. Just return the position of the null terminator.
+    return pView->pEngine->textLength;
+}
+
+size_t drte_view_get_line_first_non_whitespace_character(drte_view* pView, drte_line_cache* pLineCache, size_t iLine)
+{
+    size_t iChar = drte_view_get_line_first_character(pView, pLineCache, iLine);
+    for (;;) {
+        uint32_t c = drte_engine__get_char(pView->pEngine, iChar);
+        if (c == '\0' || c == '\r' || c == '\n' || !drte_is_whitespace(c)) {
+            break;
+        }
+
+        iChar += 1;
+    }
+
+    return iChar;
+}
+
+void drte_view_get_line_character_range(drte_view* pView, drte_line_cache* pLineCache, size_t iLine, size_t* pCharStartOut, size_t* pCharEndOut)
+{
+    if (pView == NULL) {
+        return;
+    }
+
+    if (pCharStartOut) *pCharStartOut = drte_view_get_line_first_character(pView, pLineCache, iLine);
+    if (pCharEndOut) *pCharEndOut = drte_view_get_line_last_character(pView, pLineCache, iLine);
+}
+
+
+
+
+void drte_view_set_cursor_width(drte_view* pView, float cursorWidth)
+{
+    if (pView == NULL || pView->cursorWidth == cursorWidth) {
+        return;
+    }
+
+    drte_view_begin_dirty(pView);
+    {
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
+        }
+
+        pView->cursorWidth = cursorWidth;
+        if (pView->cursorWidth > 0 && pView->cursorWidth < 1) {
+            pView->cursorWidth = 1;
+        }
+
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
+        }
+    }
+    drte_view_end_dirty(pView);
+}
+
+
+void drte_view_show_cursors(drte_view* pView)
+{
+    if (pView == NULL || drte_view_is_showing_cursors(pView)) {
+        return;
+    }
+
+    drte_engine_reset_cursor_blinks(pView->pEngine);
+    pView->flags |= DRTE_SHOWING_CURSORS;
+
+    drte_view_begin_dirty(pView);
+    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+        drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
+    }
+    drte_view_end_dirty(pView);
+}
+
+void drte_view_hide_cursors(drte_view* pView)
+{
+    if (pView == NULL || !drte_view_is_showing_cursors(pView)) {
+        return;
+    }
+
+    pView->flags &= ~DRTE_SHOWING_CURSORS;
+
+    drte_view_begin_dirty(pView);
+    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+        drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
+    }
+    drte_view_end_dirty(pView);
+}
+
+drte_bool32 drte_view_is_showing_cursors(drte_view* pView)
+{
+    if (pView == NULL) return DRTE_FALSE;
+    return (pView->flags & DRTE_SHOWING_CURSORS) != 0;
+}
+
+
+void drte_view_get_cursor_position(drte_view* pView, size_t cursorIndex, float* pPosXOut, float* pPosYOut)
+{
+    if (pPosXOut) *pPosXOut = 0;
+    if (pPosYOut) *pPosYOut = 0;
+
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return;
+    }
+
+    // If the character is on a different line to the cursor, it means the cursor is pinned to the end of the previous line and the character
+    // is the first character on the _next_ line. This will happen when word wrap is enabled. In this case things need to be treated a bit
+    // differently to calculate the x position.
+    float posX = 0;
+    float posY = 0;
+    if (pView->pCursors[cursorIndex].iLine != drte_view_get_character_line(pView, pView->pWrappedLines, pView->pCursors[cursorIndex].iCharAbs)) {
+        drte_view_measure_line(pView, pView->pCursors[cursorIndex].iLine, &posX, NULL);
+        posY = drte_view_get_line_pos_y(pView, pView->pCursors[cursorIndex].iLine);
+    } else {
+        drte_view_get_character_position(pView, pView->pWrappedLines, pView->pCursors[cursorIndex].iCharAbs, &posX, &posY);
+    }
+
+    if (pPosXOut) *pPosXOut = posX + pView->innerOffsetX;
+    if (pPosYOut) *pPosYOut = posY + pView->innerOffsetY;
+}
+
+drte_rect drte_view_get_cursor_rect(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL) {
+        return drte_make_rect(0, 0, 0, 0);
+    }
+
+    float cursorPosX;
+    float cursorPosY;
+    drte_view_get_cursor_position(pView, cursorIndex, &cursorPosX, &cursorPosY);
+
+    return drte_make_rect(cursorPosX, cursorPosY, cursorPosX + pView->cursorWidth, cursorPosY + drte_engine_get_line_height(pView->pEngine));
+}
+
+size_t drte_view_insert_cursor(drte_view* pView, size_t iChar)
+{
+    if (pView == NULL) {
+        return (size_t)-1;
+    }
+
+    if (!drte_view__reserve_cursors(pView, pView->cursorCount+1)) {
+        return (size_t)-1;
+    }
+
+    pView->pCursors[pView->cursorCount].iCharAbs = 0;
+    pView->pCursors[pView->cursorCount].iLine = 0;
+    pView->pCursors[pView->cursorCount].absoluteSickyPosX = 0;
+    pView->cursorCount += 1;
+
+    drte_view_begin_dirty(pView);
+        drte_view_move_cursor_to_character(pView, pView->cursorCount-1, iChar);
+        drte_view__repaint(pView);
+    drte_view_end_dirty(pView);
+
+    return pView->cursorCount - 1;
+}
+
+size_t drte_view_insert_cursor_at_character_and_line(drte_view* pView, size_t iChar, size_t iLine)
+{
+    size_t iCursor = drte_view_insert_cursor(pView, iChar);
+    if (iCursor == (size_t)-1) {
+        return (size_t)-1;
+    }
+
+    pView->pCursors[iCursor].iLine = iLine;
+    return iCursor;
+}
+
+void drte_view_remove_cursor(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return;
+    }
+
+    for (size_t i = cursorIndex; i < pView->cursorCount-1; ++i) {
+        pView->pCursors[i] = pView->pCursors[i+1];
+    }
+
+    pView->cursorCount -= 1;
+    drte_view__repaint(pView);
+}
+
+typedef struct
+{
+    size_t iCharAbs;
+    size_t iCursor;
+} drte_cursor_sort_item;
+
+static int drte_view__compare_cursor_sort_items(const void* pA, const void* pB)
+{
+    const drte_cursor_sort_item* pItemA = (const drte_cursor_sort_item*)pA;
+    const drte_cursor_sort_item* pItemB = (const drte_cursor_sort_item*)pB;
+
+    if (pItemA->iCharAbs < pItemB->iCharAbs) return -1;
+    if (pItemA->iCharAbs > pItemB->iCharAbs) return +1;
+    if (pItemA->iCursor  < pItemB->iCursor)  return -1;
+    if (pItemA->iCursor  > pItemB->iCursor)  return +1;
+    return 0;
+}
+
+void drte_view_remove_overlapping_cursors(drte_view* pView)
+{
+    if (pView == NULL || pView->cursorCount == 0) {
+        return;
+    }
+
+    // The cursors are sorted by their position which brings cursors sitting on the same character next to each other. Ties are broken
+    // by the index of the cursor so that the first cursor at each position is the one that's kept.
+    drte_cursor_sort_item* pSortItems = (drte_cursor_sort_item*)malloc(pView->cursorCount * (sizeof(*pSortItems) + sizeof(drte_bool32)));
+    if (pSortItems == NULL) {
+        return;
+    }
+
+    drte_bool32* pIsRemoved = (drte_bool32*)(pSortItems + pView->cursorCount);
+    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+        pSortItems[iCursor].iCharAbs = pView->pCursors[iCursor].iCharAbs;
+        pSortItems[iCursor].iCursor = iCursor;
+        pIsRemoved[iCursor] = DRTE_FALSE;
+    }
+
+    qsort(pSortItems, pView->cursorCount, sizeof(*pSortItems), drte_view__compare_cursor_sort_items);
+
+    size_t removedCount = 0;
+    for (size_t i = 1; i < pView->cursorCount; ++i) {
+        if (pSortItems[i].iCharAbs == pSortItems[i-1].iCharAbs) {
+            pIsRemoved[pSortItems[i].iCursor] = DRTE_TRUE;
+            removedCount += 1;
+        }
+    }
+
+    // The remaining cursors are moved down in place, keeping their order.
+    if (removedCount > 0) {
+        size_t newCursorCount = 0;
+        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+            if (!pIsRemoved[iCursor]) {
+                pView->pCursors[newCursorCount++] = pView->pCursors[iCursor];
+            }
+        }
+
+        pView->cursorCount = newCursorCount;
+        drte_view__repaint(pView);
+    }
+
+    free(pSortItems);
+}
+
+size_t drte_view_get_last_cursor(drte_view* pView)
+{
+    if (pView == NULL || pView->cursorCount == 0) {
+        return 0;
+    }
+
+    return pView->cursorCount - 1;
+}
+
+size_t drte_view_get_cursor_line(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return 0;
+    }
+
+    return pView->pCursors[cursorIndex].iLine;
+}
+
+size_t drte_view_get_cursor_column(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return 0;
+    }
+
+    float posX;
+    float posY;
+    drte_view_get_cursor_position(pView, cursorIndex, &posX, &posY);
+
+    return (unsigned int)((int)posX / pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth);
+}
+
+size_t drte_view_get_cursor_character(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return 0;
+    }
+
+    return pView->pCursors[cursorIndex].iCharAbs;
+}
+
+drte_bool32 drte_view_move_cursor_to_point(drte_view* pView, size_t cursorIndex, float posX, float posY)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
+
+    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
+
+    pView->pCursors[cursorIndex].iCharAbs = 0;
+    pView->pCursors[cursorIndex].iLine = 0;
+    pView->pCursors[cursorIndex].absoluteSickyPosX = 0;
+
+    float inputPosXRelativeToText = posX - pView->innerOffsetX;
+    float inputPosYRelativeToText = posY - pView->innerOffsetY;
+    if (!drte_view_move_cursor_to_point_relative_to_text(pView, cursorIndex, inputPosXRelativeToText, inputPosYRelativeToText)) {
+        return DRTE_FALSE;
+    }
+
+    drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
+
+    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs) {
+        drte_view_begin_dirty(pView);
+            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
+            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: This can be optimized. Only redraw the previous line and the new cursor rectangle.
+        drte_view_end_dirty(pView);
+    }
+
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_view_move_cursor_to_point_relative_to_text(drte_view* pView, size_t cursorIndex, float posXRelativeToText, float posYRelativeToText)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
+
+    size_t iLine = drte_view_get_line_at_pos_y(pView, pView->pWrappedLines, posYRelativeToText);
+    pView->pCursors[cursorIndex].iLine = iLine;
+
+    // Once we have the line, finding the specific character under the point is done by iterating over each segment and finding the one
+    // containing the point on the x axis. Once the segment has been found, we use the backend to get the exact character.
+    if (posXRelativeToText < 0) {
+        pView->pCursors[cursorIndex].iCharAbs = drte_view_get_line_first_character(pView, pView->pWrappedLines, (size_t)iLine);
+        return DRTE_TRUE;    // It's to the left of the line, so just pin it to the first character in the line.
+    }
+
+    drte_segment segment;
+    if (drte_engine__first_segment_on_line(pView, pView->pWrappedLines, (size_t)iLine, (size_t)-1, &segment)) {
+        drte_view__seek_segment(pView, &segment, posXRelativeToText, (size_t)-1);
+        do
+        {
+            if (posXRelativeToText >= segment.posX && posXRelativeToText < segment.posX + segment.width) {
+                // It's somewhere on this run. If it's a tab segment it needs to be handled slightly differently because of the way tabs
+                // are aligned to tab columns.
+                if (drte_engine_get_utf32(pView->pEngine, segment.iCharBeg) == '\t') {
+                    const float tabWidth = drte_view__get_tab_width_in_pixels(pView);
+
+                    pView->pCursors[cursorIndex].iCharAbs = segment.iCharBeg;
+
+                    float tabLeft = segment.posX;
+                    for (/* Do Nothing*/; pView->pCursors[cursorIndex].iCharAbs < segment.iCharEnd; ++pView->pCursors[cursorIndex].iCharAbs)
+                    {
+                        float tabRight = tabWidth * ((segment.posX + (tabWidth*((pView->pCursors[cursorIndex].iCharAbs-segment.iCharBeg) + 1))) / tabWidth);
+                        if (posXRelativeToText >= tabLeft && posXRelativeToText <= tabRight)
+                        {
+                            // The input position is somewhere on top of this character. If it's positioned on the left side of the character, set the output
+                            // value to the character at iChar. Otherwise it should be set to the character at iChar + 1.
+                            float charBoundsRightHalf = tabLeft + ceilf(((tabRight - tabLeft) / 2.0f));
+                            if (posXRelativeToText > charBoundsRightHalf) {
+                                pView->pCursors[cursorIndex].iCharAbs += 1;
+                            }
+
+                            break;
+                        }
+
+                        tabLeft = tabRight;
+                    }
+                } else {
+                    float unused;
+                    size_t iChar;
+
+                    drte_style_token fgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot);
+                    if (pView->pEngine->onGetCursorPositionFromPoint) {
+                        pView->pEngine->onGetCursorPositionFromPoint(pView->pEngine, fgStyleToken, pView->scale, drte_engine__get_text_range(pView->pEngine, segment.iCharBeg, segment.iCharEnd), segment.iCharEnd - segment.iCharBeg, segment.width, posXRelativeToText - segment.posX, &unused, &iChar);
+                        pView->pCursors[cursorIndex].iCharAbs = segment.iCharBeg + iChar;
+                    }
+                }
+
+                return DRTE_TRUE;
+            }
+        } while (drte_engine__next_segment_on_line(pView, &segment));
+
+        // If we get here it means the position is to the right of the line. Just pin it to the end of the line.
+        pView->pCursors[cursorIndex].iCharAbs = segment.iCharBeg;   // <-- segment.iCharBeg should be sitting on a new line or null terminator.
+
+        return DRTE_TRUE;
+    }
+
+    return DRTE_FALSE;
+}
+
+drte_bool32 drte_view_move_cursor_left(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
+
+    if (pView->pCursors[cursorIndex].iCharAbs == 0) {
+        return DRTE_FALSE;   // Already at the start of the string. Nowhere to go.
+    }
+
+    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
+    size_t iPrevLine = pView->pCursors[cursorIndex].iLine;
+
+    // Line boundary.
+    if (iPrevLine > 0) {
+        size_t iLineCharBeg = drte_view_get_line_first_character(pView, pView->pWrappedLines, iPrevLine);
+        if (iLineCharBeg == iPrevChar) {
+            drte_view_move_cursor_to_end_of_line_by_index(pView, cursorIndex, iPrevLine-1);
+            if (pView->pCursors[cursorIndex].iCharAbs == iPrevChar) {
+                pView->pCursors[cursorIndex].iCharAbs -= 1;
+            }
+        } else {
+            pView->pCursors[cursorIndex].iCharAbs -= 1;
+        }
+    } else {
+        pView->pCursors[cursorIndex].iCharAbs -= 1;
+    }
+
+    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs || iPrevLine != pView->pCursors[cursorIndex].iLine) {
+        pView->pCursors[cursorIndex].iLine = drte_view_get_character_line(pView, pView->pWrappedLines, pView->pCursors[cursorIndex].iCharAbs);
+        drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
+
+        drte_view_begin_dirty(pView);
+            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
+            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: Optimize this so that only the changed region is redrawn.
+        drte_view_end_dirty(pView);
+    }
+
+    return DRTE_TRUE;
+}
 
-void drte_view_enable_word_wrap(drte_view* pView)
+drte_bool32 drte_view_move_cursor_right(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL && !drte_view_is_word_wrap_enabled(pView)) {
-        return;
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
     }
 
-    // The wrapped line cache will not have been initialized at this point so we need to do that first.
-    if (!drte_line_cache_init(&pView->_wrappedLines)) {
-        return;
+    if (pView->pCursors[cursorIndex].iCharAbs >= pView->pEngine->textLength) {
+        return DRTE_FALSE;   // Already at the end. Nowhere to go.
     }
-    pView->pWrappedLines = &pView->_wrappedLines;
 
-    pView->flags |= DRTE_WORD_WRAP_ENABLED;
-    drte_view__refresh_word_wrapping(pView);
-}
+    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
+    size_t iPrevLine = pView->pCursors[cursorIndex].iLine;
 
-void drte_view_disable_word_wrap(drte_view* pView)
-{
-    if (pView == NULL && drte_view_is_word_wrap_enabled(pView)) {
-        return;
+    // Line boundary.
+    if (iPrevLine+1 < drte_view_get_line_count(pView)) {
+        size_t iLineCharEnd = drte_view_get_line_last_character(pView, pView->pWrappedLines, iPrevLine);
+        if (iLineCharEnd == iPrevChar) {
+            drte_view_move_cursor_to_start_of_line_by_index(pView, cursorIndex, iPrevLine+1);
+        } else {
+            pView->pCursors[cursorIndex].iCharAbs += 1;
+        }
+    } else {
+        pView->pCursors[cursorIndex].iCharAbs += 1;
     }
 
-    // We do not need the wrapped line cache.
-    pView->pWrappedLines = &pView->pEngine->_unwrappedLines;
-    drte_line_cache_uninit(&pView->_wrappedLines);
+    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs || iPrevLine != pView->pCursors[cursorIndex].iLine) {
+        pView->pCursors[cursorIndex].iLine = drte_view_get_character_line(pView, pView->pWrappedLines, pView->pCursors[cursorIndex].iCharAbs);
+        drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
 
-    pView->flags &= ~DRTE_WORD_WRAP_ENABLED;
-    drte_view__refresh_word_wrapping(pView);
+        drte_view_begin_dirty(pView);
+            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
+            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: Optimize this so that only the changed region is redrawn.
+        drte_view_end_dirty(pView);
+    }
+
+    return DRTE_TRUE;
 }
 
-drte_bool32 drte_view_is_word_wrap_enabled(drte_view* pView)
+drte_bool32 drte_view_move_cursor_up(drte_view* pView, size_t cursorIndex)
 {
-    return (pView->flags & DRTE_WORD_WRAP_ENABLED) != 0;
-}
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
 
+    return drte_view_move_cursor_y(pView, cursorIndex, -1);
+}
 
-size_t drte_view_get_character_line(drte_view* pView, drte_line_cache* pLineCache, size_t characterIndex)
+drte_bool32 drte_view_move_cursor_down(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL) {
-        return 0;
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
     }
 
-    if (pLineCache == NULL) pLineCache = pView->pWrappedLines;
-
-    return drte_line_cache_find_line_by_character(pLineCache, characterIndex);
+    return drte_view_move_cursor_y(pView, cursorIndex, 1);
 }
 
-void drte_view_get_character_position(drte_view* pView, drte_line_cache* pLineCache, size_t characterIndex, float* pPosXOut, float* pPosYOut)
+drte_bool32 drte_view_move_cursor_y(drte_view* pView, size_t cursorIndex, int amount)
 {
-    if (pPosXOut) *pPosXOut = 0;
-    if (pPosYOut) *pPosYOut = 0;
-
-    if (pView == NULL) {
-        return;
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
     }
 
-    size_t lineIndex = drte_view_get_character_line(pView, pLineCache, characterIndex);
+    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
 
-    float posX = 0;
-    float posY = lineIndex * drte_engine_get_line_height(pView->pEngine);
+    size_t lineCount = drte_view_get_line_count(pView);
+    if (lineCount == 0) {
+        return DRTE_FALSE;
+    }
 
-    drte_segment segment;
-    if (drte_engine__first_segment_on_line(pView, pLineCache, lineIndex, (size_t)-1, &segment)) {
-        do
-        {
-            if (characterIndex >= segment.iCharBeg && characterIndex < segment.iCharEnd) {
-                // It's somewhere in this segment.
-                if (drte_engine_get_utf32(pView->pEngine, segment.iCharBeg) == '\t') {
-                    // If the first character in the segment is a tab character, then every character in this segment
-                    // will be a tab. The location of the character is rounded to the nearest tab column.
-                    posX = segment.posX;
+    // Moving a marker up or down depends on it's sticky position.
+    intptr_t iNewLine = pView->pCursors[cursorIndex].iLine + amount;
+    if (iNewLine < 0) {
+        iNewLine = 0;
+    }
+    if ((size_t)iNewLine > lineCount) {
+        iNewLine = lineCount - 1;
+    }
 
-                    size_t tabCount = characterIndex - segment.iCharBeg;
-                    if (tabCount > 0) {
-                        float tabWidth = drte_view__get_tab_width_in_pixels(pView);
-                        float nextTabPos = (float)((int)(segment.posX / tabWidth) + 1) * tabWidth;
-                        posX = nextTabPos + ((tabCount-1) * tabWidth);
-                    }
-                } else {
-                    // We must refer to the backend in order to find the exact position of the character.
-                    // TODO: Grab a copy of the string rather than a direct offset.
-                    drte_style_token fgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot);
-                    if (pView->pEngine->onGetCursorPositionFromChar && fgStyleToken != 0) {
-                        pView->pEngine->onGetCursorPositionFromChar(pView->pEngine, fgStyleToken, pView->scale, pView->pEngine->text + segment.iCharBeg, characterIndex - segment.iCharBeg, &posX);
-                        posX += segment.posX;
-                    }
-                }
+    float newMarkerPosX = pView->pCursors[cursorIndex].absoluteSickyPosX;
+    float newMarkerPosY = drte_view_get_line_pos_y(pView, (size_t)iNewLine);
+    drte_view_move_cursor_to_point_relative_to_text(pView, cursorIndex, newMarkerPosX, newMarkerPosY);
 
-                break;
-            }
-        } while (drte_engine__next_segment_on_line(pView, &segment));
+    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs) {
+        drte_view_begin_dirty(pView);
+            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
+            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: Optimize this so that only the changed region is redrawn.
+        drte_view_end_dirty(pView);
     }
 
-    if (pPosXOut) *pPosXOut = posX;
-    if (pPosYOut) *pPosYOut = posY;
+    return DRTE_TRUE;
 }
 
-drte_bool32 drte_view_get_character_under_point_relative_to_text(drte_view* pView, drte_line_cache* pLineCache, float inputPosXRelativeToText, float inputPosYRelativeToText, size_t* piCharOut, size_t* piLineOut)
+drte_bool32 drte_view_move_cursor_to_end_of_line(drte_view* pView, size_t cursorIndex)
 {
-    if (piCharOut) *piCharOut = 0;
-    if (piLineOut) *piLineOut = 0;
-
-    if (pView == NULL) {
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
         return DRTE_FALSE;
     }
 
-    size_t iLine = drte_view_get_line_at_pos_y(pView, pLineCache, inputPosYRelativeToText);
-    size_t iChar = 0;
+    return drte_view_move_cursor_to_end_of_line_by_index(pView, cursorIndex, pView->pCursors[cursorIndex].iLine);
+}
 
-    if (piLineOut) *piLineOut = iLine;
+drte_bool32 drte_view_move_cursor_to_start_of_line(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
 
-    // Once we have the line, finding the specific character under the point is done by iterating over each segment and finding the one
-    // containing the point on the x axis. Once the segment has been found, we use the backend to get the exact character.
-    if (inputPosXRelativeToText < 0) {
-        iChar = drte_view_get_line_first_character(pView, pLineCache, (size_t)iLine);   // It's to the left of the line, so just pin it to the first character in the line.
-        
-        if (piCharOut) *piCharOut = iChar;
-        return DRTE_FALSE;   // <-- Return DRTE_FALSE because it's not actually over a character (it's to the left).
+    return drte_view_move_cursor_to_start_of_line_by_index(pView, cursorIndex, pView->pCursors[cursorIndex].iLine);
+}
+
+drte_bool32 drte_view_move_cursor_to_end_of_line_by_index(drte_view* pView, size_t cursorIndex, size_t iLine)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
     }
 
-    drte_segment segment;
-    if (drte_engine__first_segment_on_line(pView, pLineCache, (size_t)iLine, (size_t)-1, &segment)) {
-        do
-        {
-            if (inputPosXRelativeToText >= segment.posX && inputPosXRelativeToText < segment.posX + segment.width) {
-                // It's somewhere on this run. If it's a tab segment it needs to be handled slightly differently because of the way tabs
-                // are aligned to tab columns.
-                if (drte_engine_get_utf32(pView->pEngine, segment.iCharBeg) == '\t') {
-                    const float tabWidth = drte_view__get_tab_width_in_pixels(pView);
+    drte_view_move_cursor_to_character_and_line(pView, cursorIndex, drte_view_get_line_last_character(pView, pView->pWrappedLines, iLine), iLine);
+    return DRTE_TRUE;
+}
 
-                    iChar = segment.iCharBeg;
+drte_bool32 drte_view_move_cursor_to_start_of_line_by_index(drte_view* pView, size_t cursorIndex, size_t iLine)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
 
-                    float tabLeft = segment.posX;
-                    for (/* Do Nothing*/; iChar < segment.iCharEnd; ++iChar)
-                    {
-                        float tabRight = tabWidth * ((segment.posX + (tabWidth*((iChar-segment.iCharBeg) + 1))) / tabWidth);
-                        if (inputPosXRelativeToText >= tabLeft && inputPosXRelativeToText <= tabRight)
-                        {
-                            // The input position is somewhere on top of this character. If it's positioned on the left side of the character, set the output
-                            // value to the character at iChar. Otherwise it should be set to the character at iChar + 1.
-                            float charBoundsRightHalf = tabLeft + ceilf(((tabRight - tabLeft) / 2.0f));
-                            if (inputPosXRelativeToText > charBoundsRightHalf) {
-                                iChar += 1;
-                            }
+    drte_view_move_cursor_to_character_and_line(pView, cursorIndex, drte_view_get_line_first_character(pView, pView->pWrappedLines, iLine), iLine);
+    return DRTE_TRUE;
+}
 
-                            break;
-                        }
+drte_bool32 drte_view_move_cursor_to_end_of_unwrapped_line(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
 
-                        tabLeft = tabRight;
-                    }
-                } else {
-                    float unused;
-                    size_t iCharTemp;
+    drte_view_move_cursor_to_character(pView, cursorIndex, drte_view_get_line_last_character(pView, pView->pEngine->pUnwrappedLines, drte_view_get_character_line(pView, pView->pEngine->pUnwrappedLines, pView->pCursors[cursorIndex].iCharAbs)));
+    return DRTE_TRUE;
+}
 
-                    drte_style_token fgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot);
-                    if (pView->pEngine->onGetCursorPositionFromPoint) {
-                        pView->pEngine->onGetCursorPositionFromPoint(pView->pEngine, fgStyleToken, pView->scale, pView->pEngine->text + segment.iCharBeg, segment.iCharEnd - segment.iCharBeg, segment.width, inputPosXRelativeToText - segment.posX, &unused, &iCharTemp);
-                        iChar = segment.iCharBeg + iCharTemp;
-                    }
-                }
+drte_bool32 drte_view_move_cursor_to_start_of_unwrapped_line(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
 
-                if (piCharOut) *piCharOut = iChar;
+    return drte_view_move_cursor_to_start_of_unwrapped_line_by_index(pView, cursorIndex, drte_view_get_character_line(pView, pView->pEngine->pUnwrappedLines, pView->pCursors[cursorIndex].iCharAbs));
+}
 
-                // It's possible that the Y position is not actually over a line. Whether or not we return DRTE_TRUE or DRTE_FALSE depends on this.
-                if (inputPosYRelativeToText < 0) {
-                    return DRTE_FALSE;
-                } else {
-                    if (inputPosYRelativeToText >= (drte_view_get_line_count(pView) * drte_engine_get_line_height(pView->pEngine))) {
-                        return DRTE_FALSE;
-                    }
-                }
+drte_bool32 drte_view_move_cursor_to_start_of_unwrapped_line_by_index(drte_view* pView, size_t cursorIndex, size_t iLine)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
 
-                return DRTE_TRUE;
-            }
-        } while (drte_engine__next_segment_on_line(pView, &segment));
+    drte_view_move_cursor_to_character(pView, cursorIndex, drte_view_get_line_first_character(pView, pView->pEngine->pUnwrappedLines, iLine));
+    return DRTE_TRUE;
+}
 
-        // If we get here it means the position is to the right of the line. Just pin it to the end of the line.
-        iChar = segment.iCharBeg;   // <-- segment.iCharBeg should be sitting on a new line or null terminator.
+drte_bool32 drte_view_is_cursor_at_end_of_wrapped_line(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
 
-        if (piCharOut) *piCharOut = iChar;
-        return DRTE_FALSE;   // <-- Return DRTE_FALSE because it's not actually over a character (it's to the right)
+    size_t iCursorChar = pView->pCursors[cursorIndex].iCharAbs;
+    size_t iCursorLine = pView->pCursors[cursorIndex].iLine;
+
+    size_t iWrappedLineLastChar = drte_view_get_line_last_character(pView, pView->pWrappedLines, iCursorLine);
+    if (iCursorChar == iWrappedLineLastChar) {
+        return DRTE_TRUE;
     }
 
     return DRTE_FALSE;
 }
 
-drte_bool32 drte_view_get_character_under_point(drte_view* pView, drte_line_cache* pLineCache, float inputPosXRelativeToContainer, float inputPosYRelativeToContainer, size_t* piCharOut, size_t* piLineOut)
+drte_bool32 drte_view_is_cursor_at_start_of_wrapped_line(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL) {
-        return 0;
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
     }
 
-    float inputPosXRelativeToText = inputPosXRelativeToContainer - pView->innerOffsetX;
-    float inputPosYRelativeToText = inputPosYRelativeToContainer - pView->innerOffsetY;
-    return drte_view_get_character_under_point_relative_to_text(pView, pLineCache, inputPosXRelativeToText, inputPosYRelativeToText, piCharOut, piLineOut);
-}
-
-void drte_view_get_visible_lines(drte_view* pView, size_t* pFirstLineOut, size_t* pLastLineOut)
-{
-    if (pFirstLineOut) *pFirstLineOut = 0;
-    if (pLastLineOut) *pLastLineOut = 0;
-    if (pView == NULL) return;
-
-    size_t iFirstLine = (size_t)(-pView->innerOffsetY / drte_engine_get_line_height(pView->pEngine));
+    size_t iCursorChar = pView->pCursors[cursorIndex].iCharAbs;
+    size_t iCursorLine = pView->pCursors[cursorIndex].iLine;
 
-    if (pFirstLineOut) {
-        *pFirstLineOut = iFirstLine;
+    size_t iWrappedLineLastChar = drte_view_get_line_first_character(pView, pView->pWrappedLines, iCursorLine);
+    if (iCursorChar == iWrappedLineLastChar) {
+        return DRTE_TRUE;
     }
 
-    if (pLastLineOut) {
-        size_t lineCount = drte_view_get_line_count(pView);
-        size_t iLastLine = iFirstLine + ((size_t)(pView->sizeY / drte_engine_get_line_height(pView->pEngine)));
-        if (lineCount == 0) {
-            iLastLine = 0;
-        } else {
-            if (iLastLine >= lineCount) {
-                iLastLine = lineCount - 1;
-            }
-        }
-
-        *pLastLineOut = iLastLine;
-    }
+    return DRTE_FALSE;
 }
 
-size_t drte_view_get_line_count(drte_view* pView)
+drte_bool32 drte_view_move_cursor_to_end_of_text(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL) return 0;
-    return drte_line_cache_get_line_count(pView->pWrappedLines);
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
+
+    drte_view_move_cursor_to_character(pView, cursorIndex, pView->pEngine->textLength);
+    return DRTE_TRUE;
 }
 
-size_t drte_view_get_line_count_per_page(drte_view* pView)
+drte_bool32 drte_view_move_cursor_to_start_of_text(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL) return 1;
-
-    size_t lineCount = (size_t)(pView->sizeY / drte_engine_get_line_height(pView->pEngine));
-    if (lineCount == 0) {
-        lineCount = 1;  // Always at least one line on a page.
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
     }
 
-    return lineCount;
+    drte_view_move_cursor_to_character(pView, cursorIndex, 0);
+    return DRTE_TRUE;
 }
 
-size_t drte_view_get_page_count(drte_view* pView)
+void drte_view_move_cursor_to_start_of_selection(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL) return 1;
-
-    size_t lineCount    = drte_view_get_line_count(pView);
-    size_t linesPerPage = drte_view_get_line_count_per_page(pView);
+    if (pView == NULL || pView->selectionCount == 0 || pView->cursorCount <= cursorIndex) {
+        return;
+    }
 
-    size_t pageCount = lineCount / linesPerPage;
+    drte_view_move_cursor_to_character(pView, cursorIndex, drte_region_normalize(pView->pSelections[pView->selectionCount-1]).iCharBeg);
+}
 
-    // Don't forget the last page. We use a mod operation for this to ensure we don't add a blank page
-    // in the case that the last line is sitting on the last line of the last printed page.
-    if (lineCount % linesPerPage != 0) {
-        pageCount += 1;
+void drte_view_move_cursor_to_end_of_selection(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->selectionCount == 0 || pView->cursorCount <= cursorIndex) {
+        return;
     }
 
-    return pageCount;
+    drte_view_move_cursor_to_character(pView, cursorIndex, drte_region_normalize(pView->pSelections[pView->selectionCount-1]).iCharEnd);
 }
 
-size_t drte_view_get_visible_line_count(drte_view* pView)
+void drte_view_move_cursor_to_character(drte_view* pView, size_t cursorIndex, size_t characterIndex)
 {
-    if (pView == NULL) return 0;
-    return (size_t)(pView->sizeY / drte_engine_get_line_height(pView->pEngine)) + 1;
+    drte_view_move_cursor_to_character_and_line(pView, cursorIndex, characterIndex, drte_view_get_character_line(pView, pView->pWrappedLines, characterIndex));
 }
 
-float drte_view_get_visible_line_width(drte_view* pView)
+void drte_view_move_cursor_to_character_and_line(drte_view* pView, size_t cursorIndex, size_t iChar, size_t iLine)
 {
-    if (pView == NULL) return 0;
-
-    size_t iLineTop;
-    size_t iLineBottom;
-    drte_view_get_visible_lines(pView, &iLineTop, &iLineBottom);
-
-    float maxLineWidth = 0;
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return;
+    }
 
-    drte_segment segment;
-    if (drte_engine__first_segment_on_line(pView, pView->pWrappedLines, iLineTop, (size_t)-1, &segment)) {
-        size_t iLine = iLineTop;
-        while (iLine <= iLineBottom) {
-            float lineWidth = 0;
+    // Clamp the character to the end of the string.
+    if (iChar > pView->pEngine->textLength) {
+        iChar = pView->pEngine->textLength;
+    }
 
-            do
-            {
-                lineWidth += segment.width;
+    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
+    size_t iPrevLine = pView->pCursors[cursorIndex].iLine;
 
-                if (segment.iCharBeg == segment.iLineCharEnd) {
-                    break;
-                }
-            } while (drte_engine__next_segment(pView, &segment));
+    pView->pCursors[cursorIndex].iCharAbs = iChar;
+    pView->pCursors[cursorIndex].iLine = iLine;
 
+    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs || iPrevLine != pView->pCursors[cursorIndex].iLine) {
+        drte_view_begin_dirty(pView);
+            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
+            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: Optimize this so that only the changed region is redrawn.
+        drte_view_end_dirty(pView);
+    }
+}
 
-            if (maxLineWidth < lineWidth) {
-                maxLineWidth = lineWidth;
-            }
+size_t drte_view_move_cursor_to_end_of_word(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return 0;
+    }
 
-            // Go to the first segment of the next line.
-            if (!drte_engine__next_segment(pView, &segment)) {
+    size_t iChar = drte_view_get_cursor_character(pView, cursorIndex);
+    if (!drte_is_symbol_or_whitespace(drte_engine__get_char(pView->pEngine, iChar))) {
+        while (drte_engine__get_char(pView->pEngine, iChar) != '\0') {
+            uint32_t c = drte_engine__get_char(pView->pEngine, iChar);
+            if (drte_is_symbol_or_whitespace(c)) {
                 break;
             }
 
-            iLine += 1;
+            iChar += 1;
         }
+    } else {
+        iChar += 1;
     }
 
-    return maxLineWidth;
+
+
+    drte_view_move_cursor_to_character(pView, cursorIndex, iChar);
+    return iChar;
 }
 
-void drte_view_measure_line(drte_view* pView, size_t iLine, float* pSizeXOut, float* pSizeYOut)
+size_t drte_view_move_cursor_to_start_of_next_word(drte_view* pView, size_t cursorIndex)
 {
-    if (pSizeXOut) *pSizeXOut = 0;
-    if (pSizeYOut) *pSizeYOut = 0;
-
-    if (pView == NULL) {
-        return;
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return 0;
     }
 
-    if (pSizeYOut) *pSizeYOut = drte_engine_get_line_height(pView->pEngine);
-    if (pSizeXOut) {
-        float lineWidth = 0;
+    size_t iChar = drte_view_move_cursor_to_end_of_word(pView, cursorIndex);
+    drte_bool32 isOnNewLine = drte_engine__get_char(pView->pEngine, iChar) == '\r' || drte_engine__get_char(pView->pEngine, iChar) == '\n';
+    if (!isOnNewLine) {
+        while (drte_engine__get_char(pView->pEngine, iChar) != '\0') {
+            uint32_t c = drte_engine__get_char(pView->pEngine, iChar);
+            if (!drte_is_whitespace(c)) {
+                break;
+            }
 
-        drte_segment segment;
-        if (drte_engine__first_segment_on_line(pView, pView->pWrappedLines, iLine, (size_t)-1, &segment)) {
-            do
-            {
-                lineWidth += segment.width;
-            } while (drte_engine__next_segment_on_line(pView, &segment));
+            iChar += 1;
         }
-
-        *pSizeXOut = lineWidth;
     }
-}
 
-float drte_view_get_line_pos_y(drte_view* pView, size_t iLine)
-{
-    return iLine * drte_engine_get_line_height(pView->pEngine);
+    drte_view_move_cursor_to_character(pView, cursorIndex, iChar);
+    return iChar;
 }
 
-size_t drte_view_get_line_at_pos_y(drte_view* pView, drte_line_cache* pLineCache, float posY)
+size_t drte_view_move_cursor_to_start_of_word(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL) return 0;
-    if (pLineCache == NULL) pLineCache = pView->pWrappedLines;
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return 0;
+    }
 
-    size_t lineCount = drte_line_cache_get_line_count(pLineCache);
-    if (lineCount == 0) {
+    size_t iChar = drte_view_get_cursor_character(pView, cursorIndex);
+    if (iChar == 0) {
         return 0;
     }
 
-    intptr_t iLine = (intptr_t)(posY / drte_engine_get_line_height(pView->pEngine));
-    if (iLine < 0) {
-        iLine = 0;
+    iChar -= 1;
+
+    // Skip whitespace.
+    if (drte_is_whitespace(drte_engine__get_char(pView->pEngine, iChar))) {
+        while (iChar > 0) {
+            uint32_t c = drte_engine__get_char(pView->pEngine, iChar);
+            if (!drte_is_whitespace(c)) {
+                break;
+            }
+
+            if (c == '\n') {
+                if (drte_engine__get_char(pView->pEngine, iChar-1) == '\r') {
+                    iChar -= 1;
+                }
+
+                break;
+            }
+
+            iChar -= 1;
+        }
     }
-    if ((size_t)iLine >= lineCount) {
-        iLine = lineCount-1;
+
+    if (!drte_is_symbol_or_whitespace(drte_engine__get_char(pView->pEngine, iChar))) {
+        while (iChar > 0) {
+            uint32_t c = drte_engine__get_char(pView->pEngine, iChar-1);
+            if (drte_is_symbol_or_whitespace(c)) {
+                break;
+            }
+
+            iChar -= 1;
+        }
     }
 
-    return iLine;
+    drte_view_move_cursor_to_character(pView, cursorIndex, iChar);
+    return iChar;
 }
 
-size_t drte_view_get_line_first_character(drte_view* pView, drte_line_cache* pLineCache, size_t iLine)
+size_t drte_view_get_spaces_to_next_column_from_character(drte_view* pView, size_t iChar)
 {
-    if (pView == NULL || iLine == 0) {
+    if (pView == NULL) {
         return 0;
     }
 
-    if (pLineCache == NULL) pLineCache = pView->pWrappedLines;
-    return drte_line_cache_get_line_first_character(pLineCache, iLine);
+    if (iChar > pView->pEngine->textLength) {
+        iChar = pView->pEngine->textLength;
+    }
+
+
+    const float tabWidth = drte_view__get_tab_width_in_pixels(pView);
+
+    float posX;
+    float posY;
+    drte_view_get_character_position(pView, pView->pWrappedLines, iChar, &posX, &posY);
+
+    float tabColPosX = (posX + tabWidth) - ((size_t)posX % (size_t)tabWidth);
+
+    return (size_t)(tabColPosX - posX) / pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth;
 }
 
-size_t drte_view_get_line_last_character(drte_view* pView, drte_line_cache* pLineCache, size_t iLine)
+size_t drte_view_get_spaces_to_next_column_from_cursor(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL || pView->pEngine->text == NULL) {
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
         return 0;
     }
 
-    if (pLineCache == NULL) pLineCache = pView->pWrappedLines;
-
-
-    // The line caches only store the index of the first character of the line. We can quality get the last character of the line
-    // by simply interrogating the first character of the _next_ line. However, there is no next line for the last line so we handle
-    // that one in a special way.
-    if (iLine+1 < drte_line_cache_get_line_count(pLineCache)) {
-        size_t iLineEnd = drte_line_cache_get_line_first_character(pLineCache, iLine+1);
-        assert(iLineEnd > 0);
-
-        if (pView->pEngine->text[iLineEnd-1] == '\n') {
-            iLineEnd -= 1;
-            if (iLineEnd > 0) {
-                if (pView->pEngine->text[iLineEnd-1] == '\r') {
-                    iLineEnd -= 1;
-                }
-            }
-        }
+    return drte_view_get_spaces_to_next_column_from_character(pView, drte_view_get_cursor_character(pView, cursorIndex));
+}
 
-        return iLineEnd;
+drte_bool32 drte_view_is_cursor_at_start_of_selection(drte_view* pView, size_t cursorIndex)
+{
+    if (pView == NULL || pView->selectionCount == 0 || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
     }
 
-    // It's the last line. Just return the position of the null terminator.
-    return drte_line_cache_get_line_first_character(pLineCache, iLine) + strlen(pView->pEngine->text + drte_line_cache_get_line_first_character(pLineCache, iLine));
+    drte_region region = drte_region_normalize(pView->pSelections[pView->selectionCount-1]);
+    return pView->pCursors[cursorIndex].iCharAbs == region.iCharBeg;
 }
 
-size_t drte_view_get_line_first_non_whitespace_character(drte_view* pView, drte_line_cache* pLineCache, size_t iLine)
+drte_bool32 drte_view_is_cursor_at_end_of_selection(drte_view* pView, size_t cursorIndex)
 {
-    size_t iChar = drte_view_get_line_first_character(pView, pLineCache, iLine);
-    for (;;) {
-        uint32_t c = pView->pEngine->text[iChar];
-        if (c == '\0' || c == '\r' || c == '\n' || !drte_is_whitespace(c)) {
-            break;
-        }
+    if (pView == NULL || pView->selectionCount == 0 || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
+    }
 
-        iChar += 1;
+    drte_region region = drte_region_normalize(pView->pSelections[pView->selectionCount-1]);
+    return pView->pCursors[cursorIndex].iCharAbs == region.iCharEnd;
+}
+
+drte_bool32 drte_view_get_word_under_cursor(drte_view* pView, size_t cursorIndex, size_t* pWordBegOut, size_t* pWordEndOut)
+{
+    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+        return DRTE_FALSE;
     }
 
-    return iChar;
+    return drte_engine_get_word_containing_character(pView->pEngine, pView->pCursors[cursorIndex].iCharAbs, pWordBegOut, pWordEndOut);
 }
 
-void drte_view_get_line_character_range(drte_view* pView, drte_line_cache* pLineCache, size_t iLine, size_t* pCharStartOut, size_t* pCharEndOut)
+drte_bool32 drte_view_get_word_under_point(drte_view* pView, float posX, float posY, size_t* pWordBegOut, size_t* pWordEndOut)
 {
     if (pView == NULL) {
-        return;
+        return DRTE_FALSE;
     }
 
-    if (pCharStartOut) *pCharStartOut = drte_view_get_line_first_character(pView, pLineCache, iLine);
-    if (pCharEndOut) *pCharEndOut = drte_view_get_line_last_character(pView, pLineCache, iLine);
+    size_t iChar;
+    drte_view_get_character_under_point(pView, pView->pWrappedLines, posX, posY, &iChar, NULL);
+
+    return drte_engine_get_word_containing_character(pView->pEngine, iChar, pWordBegOut, pWordEndOut);
 }
 
 
 
 
-void drte_view_set_cursor_width(drte_view* pView, float cursorWidth)
+drte_bool32 drte_view_is_anything_selected(drte_view* pView)
 {
-    if (pView == NULL || pView->cursorWidth == cursorWidth) {
-        return;
+    if (pView == NULL) {
+        return DRTE_FALSE;
     }
 
-    drte_view_begin_dirty(pView);
-    {
-        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-            drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
-        }
-
-        pView->cursorWidth = cursorWidth;
-        if (pView->cursorWidth > 0 && pView->cursorWidth < 1) {
-            pView->cursorWidth = 1;
-        }
-
-        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-            drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
-        }
-    }
-    drte_view_end_dirty(pView);
+    return pView->selectionCount > 0;
 }
 
-
-void drte_view_show_cursors(drte_view* pView)
+void drte_view_deselect_all(drte_view* pView)
 {
-    if (pView == NULL || drte_view_is_showing_cursors(pView)) {
+    if (pView == NULL) {
         return;
     }
 
-    drte_engine_reset_cursor_blinks(pView->pEngine);
-    pView->flags |= DRTE_SHOWING_CURSORS;
+    pView->selectionCount = 0;
+    drte_view__invalidate_sorted_selections(pView);
 
-    drte_view_begin_dirty(pView);
-    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-        drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
-    }
-    drte_view_end_dirty(pView);
+    drte_view_dirty(pView, drte_view_get_local_rect(pView));
 }
 
-void drte_view_hide_cursors(drte_view* pView)
+void drte_view_select_all(drte_view* pView)
 {
-    if (pView == NULL || !drte_view_is_showing_cursors(pView)) {
+    if (pView == NULL) {
         return;
     }
 
-    pView->flags &= ~DRTE_SHOWING_CURSORS;
+    // Deselect everything first to ensure any multi-select stuff is cleared.
+    drte_view_deselect_all(pView);
 
-    drte_view_begin_dirty(pView);
-    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-        drte_view_dirty(pView, drte_view_get_cursor_rect(pView, iCursor));
-    }
-    drte_view_end_dirty(pView);
+    drte_view_select(pView, 0, pView->pEngine->textLength);
 }
 
-drte_bool32 drte_view_is_showing_cursors(drte_view* pView)
+void drte_view_select(drte_view* pView, size_t firstCharacter, size_t lastCharacter)
 {
-    if (pView == NULL) return DRTE_FALSE;
-    return (pView->flags & DRTE_SHOWING_CURSORS) != 0;
-}
+    if (pView == NULL) {
+        return;
+    }
 
+    drte_view_begin_selection(pView, firstCharacter);
+    drte_view_set_selection_end_point(pView, lastCharacter);
 
-void drte_view_get_cursor_position(drte_view* pView, size_t cursorIndex, float* pPosXOut, float* pPosYOut)
-{
-    if (pPosXOut) *pPosXOut = 0;
-    if (pPosYOut) *pPosYOut = 0;
+    drte_view_dirty(pView, drte_view_get_local_rect(pView));
+}
 
+void drte_view_select_word_under_cursor(drte_view* pView, size_t cursorIndex)
+{
     if (pView == NULL || pView->cursorCount <= cursorIndex) {
         return;
     }
 
-    // If the character is on a different line to the cursor, it means the cursor is pinned to the end of the previous line and the character
-    // is the first character on the _next_ line. This will happen when word wrap is enabled. In this case things need to be treated a bit
-    // differently to calculate the x position.
-    float posX = 0;
-    float posY = 0;
-    if (pView->pCursors[cursorIndex].iLine != drte_view_get_character_line(pView, pView->pWrappedLines, pView->pCursors[cursorIndex].iCharAbs)) {
-        drte_view_measure_line(pView, pView->pCursors[cursorIndex].iLine, &posX, NULL);
-        posY = drte_view_get_line_pos_y(pView, pView->pCursors[cursorIndex].iLine);
-    } else {
-        drte_view_get_character_position(pView, pView->pWrappedLines, pView->pCursors[cursorIndex].iCharAbs, &posX, &posY);
-    }
+    size_t iWordBeg;
+    size_t iWordEnd;
+    drte_view_get_word_under_cursor(pView, cursorIndex, &iWordBeg, &iWordEnd);
 
-    if (pPosXOut) *pPosXOut = posX + pView->innerOffsetX;
-    if (pPosYOut) *pPosYOut = posY + pView->innerOffsetY;
+    drte_view_select(pView, iWordBeg, iWordEnd);
 }
 
-drte_rect drte_view_get_cursor_rect(drte_view* pView, size_t cursorIndex)
+size_t drte_view_get_selected_text(drte_view* pView, char* textOut, size_t textOutSize)
 {
-    if (pView == NULL) {
-        return drte_make_rect(0, 0, 0, 0);
+    // Safety.
+    if (textOut != NULL && textOutSize > 0) {
+        textOut[0] = '\0';
     }
 
-    float cursorPosX;
-    float cursorPosY;
-    drte_view_get_cursor_position(pView, cursorIndex, &cursorPosX, &cursorPosY);
+    if (pView == NULL || (textOut != NULL && textOutSize == 0)) {
+        return 0;
+    }
 
-    return drte_make_rect(cursorPosX, cursorPosY, cursorPosX + pView->cursorWidth, cursorPosY + drte_engine_get_line_height(pView->pEngine));
+    if (!drte_view_is_anything_selected(pView)) {
+        return 0;
+    }
+
+
+    // The selected text is just every selection concatenated together.
+    size_t length = 0;
+    for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+        drte_region region = drte_region_normalize(pView->pSelections[iSelection]);
+        if (textOut != NULL) {
+            drte_engine_get_subtext(pView->pEngine, region.iCharBeg, region.iCharEnd, textOut+length, textOutSize-length);
+        }
+
+        length += (region.iCharEnd - region.iCharBeg);
+    }
+
+    return length;
 }
 
-size_t drte_view_insert_cursor(drte_view* pView, size_t iChar)
+size_t drte_view_get_selection_text(drte_view* pView, size_t iSelection, char* textOut, size_t textOutSize)
 {
-    if (pView == NULL) {
-        return (size_t)-1;
+    // Safety.
+    if (textOut != NULL && textOutSize > 0) {
+        textOut[0] = '\0';
     }
 
-    drte_cursor* pNewCursors = (drte_cursor*)realloc(pView->pCursors, (pView->cursorCount+1) * sizeof(*pNewCursors));
-    if (pNewCursors == NULL) {
-        return (size_t)-1;
+    if (pView == NULL || (textOut != NULL && textOutSize == 0)) {
+        return 0;
     }
 
-    pView->pCursors = pNewCursors;
-    pView->pCursors[pView->cursorCount].iCharAbs = 0;
-    pView->pCursors[pView->cursorCount].iLine = 0;
-    pView->pCursors[pView->cursorCount].absoluteSickyPosX = 0;
-    pView->cursorCount += 1;
+    if (!drte_view_is_anything_selected(pView)) {
+        return 0;
+    }
 
-    drte_view_begin_dirty(pView);
-        drte_view_move_cursor_to_character(pView, pView->cursorCount-1, iChar);
-        drte_view__repaint(pView);
-    drte_view_end_dirty(pView);
+    drte_region region = drte_region_normalize(pView->pSelections[iSelection]);
+    if (textOut != NULL) {
+        drte_engine_get_subtext(pView->pEngine, region.iCharBeg, region.iCharEnd, textOut, textOutSize);
+    }
 
-    return pView->cursorCount - 1;
+    return (region.iCharEnd - region.iCharBeg);
 }
 
-size_t drte_view_insert_cursor_at_character_and_line(drte_view* pView, size_t iChar, size_t iLine)
+size_t drte_view_get_selection_first_line(drte_view* pView, size_t iSelection)
 {
-    size_t iCursor = drte_view_insert_cursor(pView, iChar);
-    if (iCursor == (size_t)-1) {
-        return (size_t)-1;
+    if (pView == NULL || pView->selectionCount == 0) {
+        return 0;
     }
 
-    pView->pCursors[iCursor].iLine = iLine;
-    return iCursor;
+    return drte_view_get_character_line(pView, pView->pWrappedLines, drte_region_normalize(pView->pSelections[iSelection]).iCharBeg);
 }
 
-void drte_view_remove_cursor(drte_view* pView, size_t cursorIndex)
+size_t drte_view_get_selection_last_line(drte_view* pView, size_t iSelection)
 {
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
-        return;
+    if (pView == NULL) {
+        return 0;
     }
 
-    for (size_t i = cursorIndex; i < pView->cursorCount-1; ++i) {
-        pView->pCursors[i] = pView->pCursors[i+1];
-    }
+    return drte_view_get_character_line(pView, pView->pWrappedLines, drte_region_normalize(pView->pSelections[iSelection]).iCharEnd);
+}
 
-    pView->cursorCount -= 1;
-    drte_view__repaint(pView);
+void drte_view_move_selection_anchor_to_end_of_line(drte_view* pView, size_t iLine)
+{
+    drte_view_set_selection_anchor(pView, drte_view_get_line_last_character(pView, pView->pWrappedLines, iLine));
 }
 
-void drte_view_remove_overlapping_cursors(drte_view* pView)
+void drte_view_move_selection_anchor_to_start_of_line(drte_view* pView, size_t iLine)
 {
-    if (pView == NULL || pView->cursorCount == 0) {
-        return;
-    }
+    drte_view_set_selection_anchor(pView, drte_view_get_line_first_character(pView, pView->pWrappedLines, iLine));
+}
 
-    drte_view_begin_dirty(pView);
-    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-        for (size_t jCursor = iCursor+1; jCursor < pView->cursorCount; ++jCursor) {
-            if (pView->pCursors[iCursor].iCharAbs == pView->pCursors[jCursor].iCharAbs) {
-                drte_view_remove_cursor(pView, jCursor);
-                break;
-            }
-        }
+size_t drte_view_get_selection_anchor_line(drte_view* pView)
+{
+    if (pView == NULL || pView->selectionCount == 0) {
+        return 0;
     }
-    drte_view_end_dirty(pView);
+
+    return drte_view_get_character_line(pView, pView->pWrappedLines, pView->pSelections[pView->selectionCount-1].iCharBeg);
 }
 
-size_t drte_view_get_last_cursor(drte_view* pView)
+
+void drte_view_begin_selection(drte_view* pView, size_t iCharBeg)
 {
-    if (pView == NULL || pView->cursorCount == 0) {
-        return 0;
+    if (pView == NULL) {
+        return;
     }
 
-    return pView->cursorCount - 1;
+    if (!drte_view__reserve_selections(pView, pView->selectionCount + 1)) {
+        return;
+    }
+
+    pView->pSelections[pView->selectionCount].iCharBeg = iCharBeg;
+    pView->pSelections[pView->selectionCount].iCharEnd = iCharBeg;
+    pView->selectionCount += 1;
+    drte_view__invalidate_sorted_selections(pView);
 }
 
-size_t drte_view_get_cursor_line(drte_view* pView, size_t cursorIndex)
+void drte_view_cancel_selection(drte_view* pView, size_t iSelection)
 {
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
-        return 0;
+    if (pView == NULL || pView->selectionCount == 0) {
+        return;
     }
 
-    return pView->pCursors[cursorIndex].iLine;
+    for (/* Do Nothing */; iSelection < pView->selectionCount-1; ++iSelection) {
+        pView->pSelections[iSelection] = pView->pSelections[iSelection+1];
+    }
+
+    pView->selectionCount -= 1;
+    drte_view__invalidate_sorted_selections(pView);
 }
 
-size_t drte_view_get_cursor_column(drte_view* pView, size_t cursorIndex)
+void drte_view_cancel_last_selection(drte_view* pView)
 {
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
-        return 0;
+    if (pView == NULL || pView->selectionCount == 0) {
+        return;
     }
 
-    float posX;
-    float posY;
-    drte_view_get_cursor_position(pView, cursorIndex, &posX, &posY);
-
-    return (unsigned int)((int)posX / pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth);
+    pView->selectionCount -= 1;
+    drte_view__invalidate_sorted_selections(pView);
 }
 
-size_t drte_view_get_cursor_character(drte_view* pView, size_t cursorIndex)
+void drte_view_set_selection_anchor(drte_view* pView, size_t iCharBeg)
 {
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
-        return 0;
+    if (pView == NULL || pView->selectionCount == 0) {
+        return;
     }
 
-    return pView->pCursors[cursorIndex].iCharAbs;
+    if (pView->pSelections[pView->selectionCount-1].iCharBeg != iCharBeg) {
+        pView->pSelections[pView->selectionCount-1].iCharBeg = iCharBeg;
+        drte_view__invalidate_sorted_selections(pView);
+        drte_view__repaint(pView);
+    }
 }
 
-drte_bool32 drte_view_move_cursor_to_point(drte_view* pView, size_t cursorIndex, float posX, float posY)
+void drte_view_set_selection_end_point(drte_view* pView, size_t iCharEnd)
 {
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
+    if (pView == NULL || pView->selectionCount == 0) {
+        return;
     }
 
-    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
-
-    pView->pCursors[cursorIndex].iCharAbs = 0;
-    pView->pCursors[cursorIndex].iLine = 0;
-    pView->pCursors[cursorIndex].absoluteSickyPosX = 0;
+    if (pView->pSelections[pView->selectionCount-1].iCharEnd != iCharEnd) {
+        pView->pSelections[pView->selectionCount-1].iCharEnd = iCharEnd;
+        drte_view__invalidate_sorted_selections(pView);
+        drte_view__repaint(pView);
+    }
+}
 
-    float inputPosXRelativeToText = posX - pView->innerOffsetX;
-    float inputPosYRelativeToText = posY - pView->innerOffsetY;
-    if (!drte_view_move_cursor_to_point_relative_to_text(pView, cursorIndex, inputPosXRelativeToText, inputPosYRelativeToText)) {
+drte_bool32 drte_view_get_last_selection(drte_view* pView, size_t* iCharBegOut, size_t* iCharEndOut)
+{
+    if (pView == NULL || pView->selectionCount == 0) {
         return DRTE_FALSE;
     }
 
-    drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
-
-    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs) {
-        drte_view_begin_dirty(pView);
-            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
-            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: This can be optimized. Only redraw the previous line and the new cursor rectangle.
-        drte_view_end_dirty(pView);
-    }
+    drte_region selection = drte_region_normalize(pView->pSelections[pView->selectionCount-1]);
 
+    if (iCharBegOut) *iCharBegOut = selection.iCharBeg;
+    if (iCharEndOut) *iCharEndOut = selection.iCharEnd;
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_view_move_cursor_to_point_relative_to_text(drte_view* pView, size_t cursorIndex, float posXRelativeToText, float posYRelativeToText)
+drte_bool32 drte_view_get_selection_under_point(drte_view* pView, float posX, float posY, size_t* piSelectionOut)
 {
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+    if (pView == NULL) return DRTE_FALSE;
+
+    size_t iChar;
+    if (!drte_view_get_character_under_point(pView, pView->pWrappedLines, posX, posY, &iChar, NULL)) {
         return DRTE_FALSE;
     }
 
-    size_t iLine = drte_view_get_line_at_pos_y(pView, pView->pWrappedLines, posYRelativeToText);
-    pView->pCursors[cursorIndex].iLine = iLine;
-
-    // Once we have the line, finding the specific character under the point is done by iterating over each segment and finding the one
-    // containing the point on the x axis. Once the segment has been found, we use the backend to get the exact character.
-    if (posXRelativeToText < 0) {
-        pView->pCursors[cursorIndex].iCharAbs = drte_view_get_line_first_character(pView, pView->pWrappedLines, (size_t)iLine);
-        return DRTE_TRUE;    // It's to the left of the line, so just pin it to the first character in the line.
+    for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+        drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
+        if (iChar >= selection.iCharBeg && iChar < selection.iCharEnd) {
+            if (piSelectionOut) *piSelectionOut = iSelection;
+            return DRTE_TRUE;
+        }
     }
 
-    drte_segment segment;
-    if (drte_engine__first_segment_on_line(pView, pView->pWrappedLines, (size_t)iLine, (size_t)-1, &segment)) {
-        do
-        {
-            if (posXRelativeToText >= segment.posX && posXRelativeToText < segment.posX + segment.width) {
-                // It's somewhere on this run. If it's a tab segment it needs to be handled slightly differently because of the way tabs
-                // are aligned to tab columns.
-                if (drte_engine_get_utf32(pView->pEngine, segment.iCharBeg) == '\t') {
-                    const float tabWidth = drte_view__get_tab_width_in_pixels(pView);
+    return DRTE_FALSE;
+}
 
-                    pView->pCursors[cursorIndex].iCharAbs = segment.iCharBeg;
 
-                    float tabLeft = segment.posX;
-                    for (/* Do Nothing*/; pView->pCursors[cursorIndex].iCharAbs < segment.iCharEnd; ++pView->pCursors[cursorIndex].iCharAbs)
-                    {
-                        float tabRight = tabWidth * ((segment.posX + (tabWidth*((pView->pCursors[cursorIndex].iCharAbs-segment.iCharBeg) + 1))) / tabWidth);
-                        if (posXRelativeToText >= tabLeft && posXRelativeToText <= tabRight)
-                        {
-                            // The input position is somewhere on top of this character. If it's positioned on the left side of the character, set the output
-                            // value to the character at iChar. Otherwise it should be set to the character at iChar + 1.
-                            float charBoundsRightHalf = tabLeft + ceilf(((tabRight - tabLeft) / 2.0f));
-                            if (posXRelativeToText > charBoundsRightHalf) {
-                                pView->pCursors[cursorIndex].iCharAbs += 1;
-                            }
 
-                            break;
-                        }
 
-                        tabLeft = tabRight;
-                    }
-                } else {
-                    float unused;
-                    size_t iChar;
+drte_bool32 drte_view_insert_character_at_cursor(drte_view* pView, size_t cursorIndex, unsigned int character)
+{
+    if (pView == NULL) {
+        return DRTE_FALSE;
+    }
 
-                    drte_style_token fgStyleToken = drte_engine__get_style_token(pView->pEngine, segment.fgStyleSlot);
-                    if (pView->pEngine->onGetCursorPositionFromPoint) {
-                        pView->pEngine->onGetCursorPositionFromPoint(pView->pEngine, fgStyleToken, pView->scale, pView->pEngine->text + segment.iCharBeg, segment.iCharEnd - segment.iCharBeg, segment.width, posXRelativeToText - segment.posX, &unused, &iChar);
-                        pView->pCursors[cursorIndex].iCharAbs = segment.iCharBeg + iChar;
-                    }
-                }
+    drte_view_begin_dirty(pView);
+    {
+        drte_engine_insert_character(pView->pEngine, pView->pCursors[cursorIndex].iCharAbs, character);
+    }
+    drte_view_end_dirty(pView);
 
-                return DRTE_TRUE;
-            }
-        } while (drte_engine__next_segment_on_line(pView, &segment));
 
-        // If we get here it means the position is to the right of the line. Just pin it to the end of the line.
-        pView->pCursors[cursorIndex].iCharAbs = segment.iCharBeg;   // <-- segment.iCharBeg should be sitting on a new line or null terminator.
+    // The cursor's sticky position needs to be updated whenever the text is edited.
+    drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
 
-        return DRTE_TRUE;
-    }
 
-    return DRTE_FALSE;
+    drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
+
+    return DRTE_TRUE;
 }
 
-drte_bool32 drte_view_move_cursor_left(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_insert_character_at_cursors(drte_view* pView, unsigned int character)
 {
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
+    if (pView == NULL) {
         return DRTE_FALSE;
     }
 
-    if (pView->pCursors[cursorIndex].iCharAbs == 0) {
-        return DRTE_FALSE;   // Already at the start of the string. Nowhere to go.
-    }
-
-    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
-    size_t iPrevLine = pView->pCursors[cursorIndex].iLine;
+    // TODO: Do a proper UTF-32 -> UTF-8 conversion.
+    char utf8[16];
+    utf8[0] = (char)character;
+    utf8[1] = '\0';
 
-    // Line boundary.
-    if (iPrevLine > 0) {
-        size_t iLineCharBeg = drte_view_get_line_first_character(pView, pView->pWrappedLines, iPrevLine);
-        if (iLineCharBeg == iPrevChar) {
-            drte_view_move_cursor_to_end_of_line_by_index(pView, cursorIndex, iPrevLine-1);
-            if (pView->pCursors[cursorIndex].iCharAbs == iPrevChar) {
-                pView->pCursors[cursorIndex].iCharAbs -= 1;
-            }
-        } else {
-            pView->pCursors[cursorIndex].iCharAbs -= 1;
-        }
-    } else {
-        pView->pCursors[cursorIndex].iCharAbs -= 1;
-    }
+    return drte_view_insert_text_at_cursors(pView, utf8);
+}
 
-    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs || iPrevLine != pView->pCursors[cursorIndex].iLine) {
-        pView->pCursors[cursorIndex].iLine = drte_view_get_character_line(pView, pView->pWrappedLines, pView->pCursors[cursorIndex].iCharAbs);
-        drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
+typedef struct
+{
+    drte_edit edit;
+    size_t iEdit;
+} drte_edit_sort_item;
 
-        drte_view_begin_dirty(pView);
-            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
-            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: Optimize this so that only the changed region is redrawn.
-        drte_view_end_dirty(pView);
-    }
+static int drte_view__compare_edit_sort_items(const void* pA, const void* pB)
+{
+    const drte_edit_sort_item* pItemA = (const drte_edit_sort_item*)pA;
+    const drte_edit_sort_item* pItemB = (const drte_edit_sort_item*)pB;
 
-    return DRTE_TRUE;
+    if (pItemA->edit.iChar < pItemB->edit.iChar) return -1;
+    if (pItemA->edit.iChar > pItemB->edit.iChar) return +1;
+    if (pItemA->iEdit < pItemB->iEdit) return -1;
+    if (pItemA->iEdit > pItemB->iEdit) return +1;
+    return 0;
 }
 
-drte_bool32 drte_view_move_cursor_right(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_apply_edits(drte_view* pView, const drte_edit* pEdits, size_t editCount)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    if (pView == NULL || (pEdits == NULL && editCount > 0)) {
         return DRTE_FALSE;
     }
 
-    if (pView->pCursors[cursorIndex].iCharAbs >= pView->pEngine->textLength) {
-        return DRTE_FALSE;   // Already at the end. Nowhere to go.
-    }
+    drte_engine* pEngine = pView->pEngine;
 
-    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
-    size_t iPrevLine = pView->pCursors[cursorIndex].iLine;
+    // The edits are sorted by their position first. Edits that don't do anything are left out here.
+    drte_edit_sort_item* pSortItems = (drte_edit_sort_item*)malloc((editCount > 0 ? editCount : 1) * sizeof(*pSortItems));
+    if (pSortItems == NULL) {
+        return DRTE_FALSE;
+    }
 
-    // Line boundary.
-    if (iPrevLine+1 < drte_view_get_line_count(pView)) {
-        size_t iLineCharEnd = drte_view_get_line_last_character(pView, pView->pWrappedLines, iPrevLine);
-        if (iLineCharEnd == iPrevChar) {
-            drte_view_move_cursor_to_start_of_line_by_index(pView, cursorIndex, iPrevLine+1);
-        } else {
-            pView->pCursors[cursorIndex].iCharAbs += 1;
+    size_t sortItemCount = 0;
+    size_t totalTextLength = 0;
+    for (size_t iEdit = 0; iEdit < editCount; ++iEdit) {
+        drte_edit edit = pEdits[iEdit];
+        if (edit.iChar > pEngine->textLength) {
+            edit.iChar = pEngine->textLength;
+        }
+        if (edit.deleteLength > pEngine->textLength - edit.iChar) {
+            edit.deleteLength = pEngine->textLength - edit.iChar;
+        }
+        if (edit.text == NULL) {
+            edit.textLength = 0;
         }
-    } else {
-        pView->pCursors[cursorIndex].iCharAbs += 1;
-    }
 
-    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs || iPrevLine != pView->pCursors[cursorIndex].iLine) {
-        pView->pCursors[cursorIndex].iLine = drte_view_get_character_line(pView, pView->pWrappedLines, pView->pCursors[cursorIndex].iCharAbs);
-        drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
+        if (edit.deleteLength == 0 && edit.textLength == 0) {
+            continue;
+        }
 
-        drte_view_begin_dirty(pView);
-            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
-            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: Optimize this so that only the changed region is redrawn.
-        drte_view_end_dirty(pView);
+        pSortItems[sortItemCount].edit = edit;
+        pSortItems[sortItemCount].iEdit = iEdit;
+        sortItemCount += 1;
+        totalTextLength += edit.textLength;
     }
 
-    return DRTE_TRUE;
-}
-
-drte_bool32 drte_view_move_cursor_up(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    if (sortItemCount == 0) {
+        free(pSortItems);
         return DRTE_FALSE;
     }
 
-    return drte_view_move_cursor_y(pView, cursorIndex, -1);
-}
+    qsort(pSortItems, sortItemCount, sizeof(*pSortItems), drte_view__compare_edit_sort_items);
 
-drte_bool32 drte_view_move_cursor_down(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+
+    // The regions, their text lengths and where they start after the change are all allocated in one go. The text of every region is
+    // stored back to back after that.
+    size_t* pCursorTargets = NULL;
+    drte_region* pRegions = (drte_region*)malloc(sortItemCount * (sizeof(drte_region) + sizeof(size_t)*2) + pView->cursorCount*sizeof(size_t) + totalTextLength);
+    if (pRegions == NULL) {
+        free(pSortItems);
         return DRTE_FALSE;
     }
 
-    return drte_view_move_cursor_y(pView, cursorIndex, 1);
-}
+    size_t* pTextLengths = (size_t*)(pRegions + sortItemCount);
+    size_t* pNewRegionBegs = pTextLengths + sortItemCount;
+    pCursorTargets = pNewRegionBegs + sortItemCount;
+    char* pTexts = (char*)(pCursorTargets + pView->cursorCount);
 
-drte_bool32 drte_view_move_cursor_y(drte_view* pView, size_t cursorIndex, int amount)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
-    }
+    size_t regionCount = 0;
+    char* pNextText = pTexts;
+    for (size_t iItem = 0; iItem < sortItemCount; ++iItem) {
+        const drte_edit* pEdit = &pSortItems[iItem].edit;
 
-    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
+        // An edit starting inside the previous region, or at the same place, is combined with it.
+        if (regionCount > 0 && (pEdit->iChar < pRegions[regionCount-1].iCharEnd || pEdit->iChar == pRegions[regionCount-1].iCharBeg)) {
+            if (pRegions[regionCount-1].iCharEnd < pEdit->iChar + pEdit->deleteLength) {
+                pRegions[regionCount-1].iCharEnd = pEdit->iChar + pEdit->deleteLength;
+            }
+            pTextLengths[regionCount-1] += pEdit->textLength;
+        } else {
+            pRegions[regionCount].iCharBeg = pEdit->iChar;
+            pRegions[regionCount].iCharEnd = pEdit->iChar + pEdit->deleteLength;
+            pTextLengths[regionCount] = pEdit->textLength;
+            regionCount += 1;
+        }
 
-    size_t lineCount = drte_view_get_line_count(pView);
-    if (lineCount == 0) {
-        return DRTE_FALSE;
+        if (pEdit->textLength > 0) {
+            memcpy(pNextText, pEdit->text, pEdit->textLength);
+            pNextText += pEdit->textLength;
+        }
     }
 
-    // Moving a marker up or down depends on it's sticky position.
-    intptr_t iNewLine = pView->pCursors[cursorIndex].iLine + amount;
-    if (iNewLine < 0) {
-        iNewLine = 0;
+    free(pSortItems);
+
+
+    // This view's cursors are placed at the end of the new text of the region they're touching, which is what's expected when typing
+    // at each cursor. This needs to be worked out before the text changes.
+    size_t offset = 0;
+    for (size_t iRegion = 0; iRegion < regionCount; ++iRegion) {
+        pNewRegionBegs[iRegion] = pRegions[iRegion].iCharBeg + offset;
+        offset = offset + pTextLengths[iRegion] - (pRegions[iRegion].iCharEnd - pRegions[iRegion].iCharBeg);
     }
-    if ((size_t)iNewLine > lineCount) {
-        iNewLine = lineCount - 1;
+
+    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+        size_t iChar = pView->pCursors[iCursor].iCharAbs;
+
+        // Find the last region starting at or before the cursor.
+        size_t iLo = 0;
+        size_t iHi = regionCount;
+        while (iLo < iHi) {
+            size_t iMid = iLo + (iHi - iLo)/2;
+            if (pRegions[iMid].iCharBeg <= iChar) {
+                iLo = iMid + 1;
+            } else {
+                iHi = iMid;
+            }
+        }
+
+        if (iLo == 0) {
+            pCursorTargets[iCursor] = iChar;
+        } else if (iChar <= pRegions[iLo-1].iCharEnd) {
+            pCursorTargets[iCursor] = pNewRegionBegs[iLo-1] + pTextLengths[iLo-1];
+        } else {
+            pCursorTargets[iCursor] = iChar - pRegions[iLo-1].iCharEnd + pNewRegionBegs[iLo-1] + pTextLengths[iLo-1];
+        }
     }
 
-    float newMarkerPosX = pView->pCursors[cursorIndex].absoluteSickyPosX;
-    float newMarkerPosY = drte_view_get_line_pos_y(pView, (size_t)iNewLine);
-    drte_view_move_cursor_to_point_relative_to_text(pView, cursorIndex, newMarkerPosX, newMarkerPosY);
 
-    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs) {
-        drte_view_begin_dirty(pView);
-            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
-            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: Optimize this so that only the changed region is redrawn.
-        drte_view_end_dirty(pView);
+    drte_bool32 wasTextChanged;
+    drte_view_begin_dirty(pView);
+    {
+        wasTextChanged = drte_engine__replace_regions(pEngine, pRegions, regionCount, pTexts, pTextLengths);
+        if (wasTextChanged) {
+            for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+                drte_view_move_cursor_to_character(pView, iCursor, pCursorTargets[iCursor]);
+                drte_view__update_cursor_sticky_position(pView, &pView->pCursors[iCursor]);
+            }
+        }
     }
+    drte_view_end_dirty(pView);
 
-    return DRTE_TRUE;
+    free(pRegions);
+    return wasTextChanged;
 }
 
-drte_bool32 drte_view_move_cursor_to_end_of_line(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_insert_text_at_cursors(drte_view* pView, const char* text)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    if (pView == NULL || text == NULL || pView->cursorCount == 0) {
         return DRTE_FALSE;
     }
 
-    return drte_view_move_cursor_to_end_of_line_by_index(pView, cursorIndex, pView->pCursors[cursorIndex].iLine);
-}
-
-drte_bool32 drte_view_move_cursor_to_start_of_line(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    drte_edit* pEdits = (drte_edit*)malloc(pView->cursorCount * sizeof(*pEdits));
+    if (pEdits == NULL) {
         return DRTE_FALSE;
     }
 
-    return drte_view_move_cursor_to_start_of_line_by_index(pView, cursorIndex, pView->pCursors[cursorIndex].iLine);
-}
-
-drte_bool32 drte_view_move_cursor_to_end_of_line_by_index(drte_view* pView, size_t cursorIndex, size_t iLine)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
+    size_t textLength = strlen(text);
+    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+        pEdits[iCursor].iChar = pView->pCursors[iCursor].iCharAbs;
+        pEdits[iCursor].deleteLength = 0;
+        pEdits[iCursor].text = text;
+        pEdits[iCursor].textLength = textLength;
     }
 
-    drte_view_move_cursor_to_character_and_line(pView, cursorIndex, drte_view_get_line_last_character(pView, pView->pWrappedLines, iLine), iLine);
-    return DRTE_TRUE;
-}
-
-drte_bool32 drte_view_move_cursor_to_start_of_line_by_index(drte_view* pView, size_t cursorIndex, size_t iLine)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
-    }
+    drte_bool32 wasTextChanged = drte_view_apply_edits(pView, pEdits, pView->cursorCount);
 
-    drte_view_move_cursor_to_character_and_line(pView, cursorIndex, drte_view_get_line_first_character(pView, pView->pWrappedLines, iLine), iLine);
-    return DRTE_TRUE;
+    free(pEdits);
+    return wasTextChanged;
 }
 
-drte_bool32 drte_view_move_cursor_to_end_of_unwrapped_line(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_insert_text_at_cursor(drte_view* pView, size_t cursorIndex, const char* text)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    if (pView == NULL || text == NULL) {
         return DRTE_FALSE;
     }
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, drte_view_get_line_last_character(pView, pView->pEngine->pUnwrappedLines, drte_view_get_character_line(pView, pView->pEngine->pUnwrappedLines, pView->pCursors[cursorIndex].iCharAbs)));
-    return DRTE_TRUE;
-}
-
-drte_bool32 drte_view_move_cursor_to_start_of_unwrapped_line(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
+    drte_view_begin_dirty(pView);
+    {
+        size_t cursorPos = pView->pCursors[cursorIndex].iCharAbs;
+        drte_engine_insert_text(pView->pEngine, text, cursorPos);
     }
+    drte_view_end_dirty(pView);
 
-    return drte_view_move_cursor_to_start_of_unwrapped_line_by_index(pView, cursorIndex, drte_view_get_character_line(pView, pView->pEngine->pUnwrappedLines, pView->pCursors[cursorIndex].iCharAbs));
-}
 
-drte_bool32 drte_view_move_cursor_to_start_of_unwrapped_line_by_index(drte_view* pView, size_t cursorIndex, size_t iLine)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
-    }
+    // The cursor's sticky position needs to be updated whenever the text is edited.
+    drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
+
+    drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, drte_view_get_line_first_character(pView, pView->pEngine->pUnwrappedLines, iLine));
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_view_is_cursor_at_end_of_wrapped_line(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_delete_character_to_left_of_cursor(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    if (pView == NULL) {
         return DRTE_FALSE;
     }
 
-    size_t iCursorChar = pView->pCursors[cursorIndex].iCharAbs;
-    size_t iCursorLine = pView->pCursors[cursorIndex].iLine;
-
-    size_t iWrappedLineLastChar = drte_view_get_line_last_character(pView, pView->pWrappedLines, iCursorLine);
-    if (iCursorChar == iWrappedLineLastChar) {
+    // We just move the cursor to the left, and then delete the character to the right.
+    if (drte_view_move_cursor_left(pView, cursorIndex)) {
+        drte_view_delete_character_to_right_of_cursor(pView, cursorIndex);
         return DRTE_TRUE;
     }
 
     return DRTE_FALSE;
 }
 
-drte_bool32 drte_view_is_cursor_at_start_of_wrapped_line(drte_view* pView, size_t cursorIndex)
+// Retrieves the number of characters making up the character at the given index. This is 2 for a \r\n line ending and 1 otherwise.
+static size_t drte_view__get_character_length(drte_view* pView, size_t iChar)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
-    }
-
-    size_t iCursorChar = pView->pCursors[cursorIndex].iCharAbs;
-    size_t iCursorLine = pView->pCursors[cursorIndex].iLine;
+    assert(pView != NULL);
 
-    size_t iWrappedLineLastChar = drte_view_get_line_first_character(pView, pView->pWrappedLines, iCursorLine);
-    if (iCursorChar == iWrappedLineLastChar) {
-        return DRTE_TRUE;
+    if (drte_engine__get_char(pView->pEngine, iChar) == '\r' && drte_engine__get_char(pView->pEngine, iChar+1) == '\n') {
+        return 2;
     }
 
-    return DRTE_FALSE;
+    return 1;
 }
 
-drte_bool32 drte_view_move_cursor_to_end_of_text(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_delete_character_to_left_of_cursors(drte_view* pView, drte_bool32 leaveNewLines)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    if (pView == NULL || pView->cursorCount == 0) {
         return DRTE_FALSE;
     }
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, pView->pEngine->textLength);
-    return DRTE_TRUE;
-}
-
-drte_bool32 drte_view_move_cursor_to_start_of_text(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    drte_edit* pEdits = (drte_edit*)malloc(pView->cursorCount * sizeof(*pEdits));
+    if (pEdits == NULL) {
         return DRTE_FALSE;
     }
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, 0);
-    return DRTE_TRUE;
-}
+    // This finds the same character drte_view_move_cursor_left() would move to.
+    size_t editCount = 0;
+    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+        size_t iCursorChar = pView->pCursors[iCursor].iCharAbs;
+        if (iCursorChar == 0) {
+            continue;
+        }
 
-void drte_view_move_cursor_to_start_of_selection(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->selectionCount == 0 || pView->cursorCount <= cursorIndex) {
-        return;
-    }
+        size_t iCursorLine = drte_view_get_cursor_line(pView, iCursor);
+        size_t iLineCharBeg = drte_view_get_line_first_character(pView, pView->pWrappedLines, iCursorLine);
+        if (leaveNewLines && iCursorChar == iLineCharBeg) {
+            continue;
+        }
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, drte_region_normalize(pView->pSelections[pView->selectionCount-1]).iCharBeg);
-}
+        size_t iCharBeg = iCursorChar - 1;
+        if (iCursorLine > 0 && iCursorChar == iLineCharBeg) {
+            iCharBeg = drte_view_get_line_last_character(pView, pView->pWrappedLines, iCursorLine-1);
+            if (iCharBeg == iCursorChar) {
+                iCharBeg -= 1;
+            }
+        }
 
-void drte_view_move_cursor_to_end_of_selection(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->pEngine->text == NULL || pView->selectionCount == 0 || pView->cursorCount <= cursorIndex) {
-        return;
+        pEdits[editCount].iChar = iCharBeg;
+        pEdits[editCount].deleteLength = drte_view__get_character_length(pView, iCharBeg);
+        pEdits[editCount].text = NULL;
+        pEdits[editCount].textLength = 0;
+        editCount += 1;
     }
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, drte_region_normalize(pView->pSelections[pView->selectionCount-1]).iCharEnd);
-}
+    drte_bool32 wasTextChanged = drte_view_apply_edits(pView, pEdits, editCount);
 
-void drte_view_move_cursor_to_character(drte_view* pView, size_t cursorIndex, size_t characterIndex)
-{
-    drte_view_move_cursor_to_character_and_line(pView, cursorIndex, characterIndex, drte_view_get_character_line(pView, pView->pWrappedLines, characterIndex));
+    free(pEdits);
+    return wasTextChanged;
 }
 
-void drte_view_move_cursor_to_character_and_line(drte_view* pView, size_t cursorIndex, size_t iChar, size_t iLine)
+drte_bool32 drte_view_delete_character_to_right_of_cursor(drte_view* pView, size_t cursorIndex)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return;
+    if (pView == NULL) {
+        return DRTE_FALSE;
     }
 
-    // Clamp the character to the end of the string.
-    if (iChar > pView->pEngine->textLength) {
-        iChar = pView->pEngine->textLength;
-    }
+    size_t iCharBeg = pView->pCursors[cursorIndex].iCharAbs;
+    if (iCharBeg < pView->pEngine->textLength)
+    {
+        size_t iCharEnd = iCharBeg+1;
+        if (drte_engine__get_char(pView->pEngine, iCharBeg) == '\r' && drte_engine__get_char(pView->pEngine, iCharEnd) == '\n') {
+            iCharEnd += 1;  // It's a \r\n line ending.
+        }
 
-    size_t iPrevChar = pView->pCursors[cursorIndex].iCharAbs;
-    size_t iPrevLine = pView->pCursors[cursorIndex].iLine;
+        if (!drte_engine_delete_text(pView->pEngine, iCharBeg, iCharEnd)) {
+            return DRTE_FALSE;
+        }
 
-    pView->pCursors[cursorIndex].iCharAbs = iChar;
-    pView->pCursors[cursorIndex].iLine = iLine;
 
-    if (iPrevChar != pView->pCursors[cursorIndex].iCharAbs || iPrevLine != pView->pCursors[cursorIndex].iLine) {
-        drte_view_begin_dirty(pView);
-            drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
-            drte_view_dirty(pView, drte_view_get_local_rect(pView));   // <-- TODO: Optimize this so that only the changed region is redrawn.
-        drte_view_end_dirty(pView);
+        // The layout will have changed.
+        drte_view_move_cursor_to_character(pView, cursorIndex, iCharBeg);
+
+        if (pView->pEngine->onTextChanged) {
+            pView->pEngine->onTextChanged(pView->pEngine);
+        }
+
+        drte_view_dirty(pView, drte_view_get_local_rect(pView));
+
+        return DRTE_TRUE;
     }
+
+    return DRTE_FALSE;
 }
 
-size_t drte_view_move_cursor_to_end_of_word(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_delete_character_to_right_of_cursors(drte_view* pView, drte_bool32 leaveNewLines)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return 0;
+    if (pView == NULL || pView->cursorCount == 0) {
+        return DRTE_FALSE;
     }
 
-    size_t iChar = drte_view_get_cursor_character(pView, cursorIndex);
-    if (!drte_is_symbol_or_whitespace(pView->pEngine->text[iChar])) {
-        while (pView->pEngine->text[iChar] != '\0') {
-            uint32_t c = pView->pEngine->text[iChar];
-            if (drte_is_symbol_or_whitespace(c)) {
-                break;
-            }
+    drte_edit* pEdits = (drte_edit*)malloc(pView->cursorCount * sizeof(*pEdits));
+    if (pEdits == NULL) {
+        return DRTE_FALSE;
+    }
 
-            iChar += 1;
+    size_t editCount = 0;
+    for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
+        size_t iCursorChar = pView->pCursors[iCursor].iCharAbs;
+        if (iCursorChar >= pView->pEngine->textLength) {
+            continue;
         }
-    } else {
-        iChar += 1;
-    }
 
+        if (leaveNewLines) {
+            size_t iLineCharEnd = drte_view_get_line_last_character(pView, pView->pWrappedLines, drte_view_get_cursor_line(pView, iCursor));
+            if (iCursorChar == iLineCharEnd) {
+                continue;
+            }
+        }
 
+        pEdits[editCount].iChar = iCursorChar;
+        pEdits[editCount].deleteLength = drte_view__get_character_length(pView, iCursorChar);
+        pEdits[editCount].text = NULL;
+        pEdits[editCount].textLength = 0;
+        editCount += 1;
+    }
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, iChar);
-    return iChar;
+    drte_bool32 wasTextChanged = drte_view_apply_edits(pView, pEdits, editCount);
+
+    free(pEdits);
+    return wasTextChanged;
 }
 
-size_t drte_view_move_cursor_to_start_of_next_word(drte_view* pView, size_t cursorIndex)
+
+drte_bool32 drte_view_delete_selected_text(drte_view* pView)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return 0;
+    if (pView == NULL || pView->selectionCount == 0) {
+        return DRTE_FALSE;
     }
 
-    size_t iChar = drte_view_move_cursor_to_end_of_word(pView, cursorIndex);
-    drte_bool32 isOnNewLine = pView->pEngine->text[iChar] == '\r' || pView->pEngine->text[iChar] == '\n';
-    if (!isOnNewLine) {
-        while (pView->pEngine->text[iChar] != '\0') {
-            uint32_t c = pView->pEngine->text[iChar];
-            if (!drte_is_whitespace(c)) {
-                break;
-            }
-
-            iChar += 1;
+    drte_bool32 wasTextChanged = DRTE_FALSE;
+    drte_view_begin_dirty(pView);
+    {
+        for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
+            wasTextChanged = drte_view_delete_selection_text(pView, iSelection) || wasTextChanged;
         }
     }
+    drte_view_end_dirty(pView);
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, iChar);
-    return iChar;
+    return wasTextChanged;
 }
 
-size_t drte_view_move_cursor_to_start_of_word(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_delete_selection_text(drte_view* pView, size_t iSelectionToDelete)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
-        return 0;
+    if (pView == NULL || pView->selectionCount == 0) {
+        return DRTE_FALSE;
     }
 
-    size_t iChar = drte_view_get_cursor_character(pView, cursorIndex);
-    if (iChar == 0) {
-        return 0;
+    drte_region selectionToDelete = drte_region_normalize(pView->pSelections[iSelectionToDelete]);
+    if (selectionToDelete.iCharBeg == selectionToDelete.iCharEnd) {
+        return DRTE_FALSE;   // Nothing is selected.
     }
 
-    iChar -= 1;
-
-    // Skip whitespace.
-    if (drte_is_whitespace(pView->pEngine->text[iChar])) {
-        while (iChar > 0) {
-            uint32_t c = pView->pEngine->text[iChar];
-            if (!drte_is_whitespace(c)) {
-                break;
-            }
-
-            if (c == '\n') {
-                if (pView->pEngine->text[iChar-1] == '\r') {
-                    iChar -= 1;
-                }
+    return drte_engine_delete_text(pView->pEngine, selectionToDelete.iCharBeg, selectionToDelete.iCharEnd);
+}
 
-                break;
-            }
 
-            iChar -= 1;
-        }
+drte_bool32 drte_engine_find(drte_engine* pEngine, drte_search_pattern* pPattern, size_t iCharBeg, size_t iCharEnd, size_t* pCharOut)
+{
+    if (pEngine == NULL || pPattern == NULL || pPattern->length == 0) {
+        return DRTE_FALSE;
     }
 
-    if (!drte_is_symbol_or_whitespace(pView->pEngine->text[iChar])) {
-        while (iChar > 0) {
-            uint32_t c = pView->pEngine->text[iChar-1];
-            if (drte_is_symbol_or_whitespace(c)) {
-                break;
-            }
+    if (iCharEnd > pEngine->textLength) {
+        iCharEnd = pEngine->textLength;
+    }
 
-            iChar -= 1;
-        }
+    size_t patternLength = pPattern->length;
+    if (iCharBeg >= iCharEnd || iCharEnd - iCharBeg < patternLength) {
+        return DRTE_FALSE;
     }
 
-    drte_view_move_cursor_to_character(pView, cursorIndex, iChar);
-    return iChar;
-}
+    // The text is not stored contiguously. Each piece is searched directly, and then the boundary between it and the next piece
+    // is copied out and searched separately to catch matches that straddle the two.
+    drte_piece_table* pTable = &pEngine->text;
+    drte_piece_cursor cursor;
+    drte_piece_table__find_piece(pTable, iCharBeg, &cursor);
+    size_t iChar = iCharBeg;
+    while (iChar + patternLength <= iCharEnd) {
+        const drte_piece* pPiece = cursor.pPiece;
 
-size_t drte_view_get_spaces_to_next_column_from_character(drte_view* pView, size_t iChar)
-{
-    if (pView == NULL) {
-        return 0;
-    }
+        size_t iPieceCharEnd = cursor.iCharBeg + pPiece->length;
+        if (iPieceCharEnd > iCharEnd) {
+            iPieceCharEnd = iCharEnd;
+        }
 
-    if (iChar > pView->pEngine->textLength) {
-        iChar = pView->pEngine->textLength;
-    }
+        size_t length = iPieceCharEnd - iChar;
+        if (length >= patternLength) {
+            size_t i = drte__find_pattern(pPattern, drte_piece_table__get_piece_text(pTable, pPiece) + (iChar - cursor.iCharBeg), length);
+            if (i < length) {
+                if (pCharOut) *pCharOut = iChar + i;
+                return DRTE_TRUE;
+            }
+        }
 
+        if (iPieceCharEnd == iCharEnd) {
+            break;
+        }
 
-    const float tabWidth = drte_view__get_tab_width_in_pixels(pView);
+        if (patternLength > 1) {
+            size_t iWindowBeg = (length > patternLength-1) ? iPieceCharEnd - (patternLength-1) : iChar;
+            size_t iWindowEnd = drte_min(iPieceCharEnd + (patternLength-1), iCharEnd);
+            size_t windowLength = drte_piece_table_copy(pTable, iWindowBeg, iWindowEnd, pPattern->pWindow);
 
-    float posX;
-    float posY;
-    drte_view_get_character_position(pView, pView->pWrappedLines, iChar, &posX, &posY);
+            size_t i = drte__find_pattern(pPattern, pPattern->pWindow, windowLength);
+            if (i < windowLength) {
+                if (pCharOut) *pCharOut = iWindowBeg + i;
+                return DRTE_TRUE;
+            }
+        }
 
-    float tabColPosX = (posX + tabWidth) - ((size_t)posX % (size_t)tabWidth);
+        iChar = iPieceCharEnd;
+        drte_piece_table__next_piece(&cursor);
+    }
 
-    return (size_t)(tabColPosX - posX) / pView->pEngine->styles[pView->pEngine->defaultStyleSlot].fontMetrics.spaceWidth;
+    return DRTE_FALSE;
 }
 
-size_t drte_view_get_spaces_to_next_column_from_cursor(drte_view* pView, size_t cursorIndex)
+size_t drte_engine_replace_all(drte_engine* pEngine, drte_search_pattern* pPattern, const char* replacement, size_t iCharBeg, size_t iCharEnd)
 {
-    if (pView == NULL || pView->pEngine->text == NULL || pView->cursorCount <= cursorIndex) {
+    if (pEngine == NULL || pPattern == NULL || pPattern->length == 0 || replacement == NULL) {
         return 0;
     }
 
-    return drte_view_get_spaces_to_next_column_from_character(pView, drte_view_get_cursor_character(pView, cursorIndex));
-}
+    // Find every match first. Matches never overlap because the search for the next one starts at the end of the previous one.
+    size_t matchCount = 0;
+    size_t matchBufferSize = 0;
+    size_t* pMatches = NULL;
 
-drte_bool32 drte_view_is_cursor_at_start_of_selection(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->selectionCount == 0 || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
-    }
+    size_t iMatch;
+    while (drte_engine_find(pEngine, pPattern, iCharBeg, iCharEnd, &iMatch)) {
+        if (matchCount == matchBufferSize) {
+            size_t newMatchBufferSize = (matchBufferSize == 0) ? 256 : matchBufferSize*2;
+            size_t* pNewMatches = (size_t*)realloc(pMatches, newMatchBufferSize * sizeof(*pNewMatches));
+            if (pNewMatches == NULL) {
+                free(pMatches);
+                return 0;
+            }
 
-    drte_region region = drte_region_normalize(pView->pSelections[pView->selectionCount-1]);
-    return pView->pCursors[cursorIndex].iCharAbs == region.iCharBeg;
-}
+            pMatches = pNewMatches;
+            matchBufferSize = newMatchBufferSize;
+        }
 
-drte_bool32 drte_view_is_cursor_at_end_of_selection(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->selectionCount == 0 || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
+        pMatches[matchCount++] = iMatch;
+        iCharBeg = iMatch + pPattern->length;
     }
 
-    drte_region region = drte_region_normalize(pView->pSelections[pView->selectionCount-1]);
-    return pView->pCursors[cursorIndex].iCharAbs == region.iCharEnd;
-}
-
-drte_bool32 drte_view_get_word_under_cursor(drte_view* pView, size_t cursorIndex, size_t* pWordBegOut, size_t* pWordEndOut)
-{
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
-        return DRTE_FALSE;
+    if (matchCount > 0) {
+        if (!drte_engine__replace_ranges(pEngine, pMatches, matchCount, pPattern->length, replacement, strlen(replacement))) {
+            matchCount = 0;
+        }
     }
 
-    return drte_engine_get_word_containing_character(pView->pEngine, pView->pCursors[cursorIndex].iCharAbs, pWordBegOut, pWordEndOut);
+    free(pMatches);
+    return matchCount;
 }
 
-drte_bool32 drte_view_get_word_under_point(drte_view* pView, float posX, float posY, size_t* pWordBegOut, size_t* pWordEndOut)
+// Runs the forward program of a regular expression from iCharBeg to find where the leftmost match ends.
+drte_bool32 drte_engine__find_regex_match_end(drte_engine* pEngine, drte_regex* pRegex, size_t iCharBeg, size_t iCharEnd, size_t* pMatchEndOut)
 {
-    if (pView == NULL) {
+    assert(pEngine != NULL);
+    assert(pRegex != NULL);
+
+    drte_regex_program* pProgram = &pRegex->forward;
+    drte_regex_dfa_state* pState = drte_regex__get_dfa_start_state(pRegex, pProgram, (iCharBeg > 0) ? (drte_uint8)drte_engine__get_char(pEngine, iCharBeg-1) : -1, DRTE_FALSE);
+    if (pState == NULL) {
         return DRTE_FALSE;
     }
 
-    size_t iChar;
-    drte_view_get_character_under_point(pView, pView->pWrappedLines, posX, posY, &iChar, NULL);
-
-    return drte_engine_get_word_containing_character(pView->pEngine, iChar, pWordBegOut, pWordEndOut);
-}
+    drte_bool32 isMatch = DRTE_FALSE;
+    size_t matchEnd = 0;
 
+    // A state is flagged as a match when a match ended just before the character that led to it.
+    drte_piece_table* pTable = &pEngine->text;
+    drte_piece_cursor cursor;
+    drte_piece_table__find_piece(pTable, iCharBeg, &cursor);
+    size_t iChar = iCharBeg;
+    while (iChar < iCharEnd) {
+        const drte_piece* pPiece = cursor.pPiece;
+        const drte_uint8* pText = (const drte_uint8*)drte_piece_table__get_piece_text(pTable, pPiece) + (iChar - cursor.iCharBeg);
 
+        size_t length = cursor.iCharBeg + pPiece->length - iChar;
+        if (length > iCharEnd - iChar) {
+            length = iCharEnd - iChar;
+        }
 
+        for (size_t i = 0; i < length; ++i) {
+            size_t iByteClass = pRegex->byteClasses[pText[i]];
+            drte_regex_dfa_state* pNextState = pState->pNext[iByteClass];
+            if (pNextState == NULL) {
+                pNextState = drte_regex__get_dfa_next_state(pRegex, pProgram, pState, iByteClass);
+                if (pNextState == NULL) {
+                    return DRTE_FALSE;
+                }
+            }
 
-drte_bool32 drte_view_is_anything_selected(drte_view* pView)
-{
-    if (pView == NULL) {
-        return DRTE_FALSE;
-    }
+            pState = pNextState;
+            if ((pState->flags & DRTE_REGEX_DFA_MATCH) != 0) {
+                isMatch = DRTE_TRUE;
+                matchEnd = iChar + i;
+            }
 
-    return pView->selectionCount > 0;
-}
+            if (drte_regex__is_dfa_state_dead(pState)) {
+                goto done;
+            }
+        }
 
-void drte_view_deselect_all(drte_view* pView)
-{
-    if (pView == NULL) {
-        return;
+        iChar += length;
+        drte_piece_table__next_piece(&cursor);
     }
 
-    pView->selectionCount = 0;
-
-    drte_view_dirty(pView, drte_view_get_local_rect(pView));
-}
+    // A match can still end at the end of the range. The character after it is needed for "$" and "\b".
+    {
+        size_t iByteClass = (iCharEnd < pEngine->textLength) ? pRegex->byteClasses[(drte_uint8)drte_engine__get_char(pEngine, iCharEnd)] : pRegex->byteClassCount;
+        drte_regex_dfa_state* pNextState = pState->pNext[iByteClass];
+        if (pNextState == NULL) {
+            pNextState = drte_regex__get_dfa_next_state(pRegex, pProgram, pState, iByteClass);
+            if (pNextState == NULL) {
+                return DRTE_FALSE;
+            }
+        }
 
-void drte_view_select_all(drte_view* pView)
-{
-    if (pView == NULL) {
-        return;
+        if ((pNextState->flags & DRTE_REGEX_DFA_MATCH) != 0) {
+            isMatch = DRTE_TRUE;
+            matchEnd = iCharEnd;
+        }
     }
 
-    // Deselect everything first to ensure any multi-select stuff is cleared.
-    drte_view_deselect_all(pView);
+done:
+    if (isMatch) {
+        *pMatchEndOut = matchEnd;
+    }
 
-    drte_view_select(pView, 0, pView->pEngine->textLength);
+    return isMatch;
 }
 
-void drte_view_select(drte_view* pView, size_t firstCharacter, size_t lastCharacter)
+// Runs the reverse program of a regular expression backwards from the end of a match to find where it starts. The earliest start is the
+// one that belongs to the leftmost match.
+drte_bool32 drte_engine__find_regex_match_beg(drte_engine* pEngine, drte_regex* pRegex, size_t iCharBeg, size_t iMatchEnd, size_t* pMatchBegOut)
 {
-    if (pView == NULL) {
-        return;
+    assert(pEngine != NULL);
+    assert(pRegex != NULL);
+
+    drte_regex_program* pProgram = &pRegex->reverse;
+    drte_regex_dfa_state* pState = drte_regex__get_dfa_start_state(pRegex, pProgram, (iMatchEnd < pEngine->textLength) ? (drte_uint8)drte_engine__get_char(pEngine, iMatchEnd) : -1, DRTE_TRUE);
+    if (pState == NULL) {
+        return DRTE_FALSE;
     }
 
-    drte_view_begin_selection(pView, firstCharacter);
-    drte_view_set_selection_end_point(pView, lastCharacter);
+    drte_bool32 isMatch = DRTE_FALSE;
+    size_t matchBeg = 0;
 
-    drte_view_dirty(pView, drte_view_get_local_rect(pView));
-}
+    drte_piece_table* pTable = &pEngine->text;
+    size_t iChar = iMatchEnd;
+    if (iChar > iCharBeg) {
+        drte_piece_cursor cursor;
+        drte_piece_table__find_piece(pTable, iChar-1, &cursor);
+        for (;;) {
+            const drte_piece* pPiece = cursor.pPiece;
+            const drte_uint8* pText = (const drte_uint8*)drte_piece_table__get_piece_text(pTable, pPiece) - cursor.iCharBeg;
 
-void drte_view_select_word_under_cursor(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL || pView->cursorCount <= cursorIndex) {
-        return;
-    }
+            size_t iPieceCharBeg = (cursor.iCharBeg > iCharBeg) ? cursor.iCharBeg : iCharBeg;
+            while (iChar > iPieceCharBeg) {
+                iChar -= 1;
 
-    size_t iWordBeg;
-    size_t iWordEnd;
-    drte_view_get_word_under_cursor(pView, cursorIndex, &iWordBeg, &iWordEnd);
+                size_t iByteClass = pRegex->byteClasses[pText[iChar]];
+                drte_regex_dfa_state* pNextState = pState->pNext[iByteClass];
+                if (pNextState == NULL) {
+                    pNextState = drte_regex__get_dfa_next_state(pRegex, pProgram, pState, iByteClass);
+                    if (pNextState == NULL) {
+                        return DRTE_FALSE;
+                    }
+                }
 
-    drte_view_select(pView, iWordBeg, iWordEnd);
-}
+                pState = pNextState;
+                if ((pState->flags & DRTE_REGEX_DFA_MATCH) != 0) {
+                    isMatch = DRTE_TRUE;
+                    matchBeg = iChar + 1;
+                }
 
-size_t drte_view_get_selected_text(drte_view* pView, char* textOut, size_t textOutSize)
-{
-    // Safety.
-    if (textOut != NULL && textOutSize > 0) {
-        textOut[0] = '\0';
-    }
+                if (drte_regex__is_dfa_state_dead(pState)) {
+                    goto done;
+                }
+            }
 
-    if (pView == NULL || (textOut != NULL && textOutSize == 0)) {
-        return 0;
-    }
+            if (iChar == iCharBeg) {
+                break;
+            }
 
-    if (!drte_view_is_anything_selected(pView)) {
-        return 0;
+            drte_piece_table__prev_piece(&cursor);
+        }
     }
 
+    {
+        size_t iByteClass = (iCharBeg > 0) ? pRegex->byteClasses[(drte_uint8)drte_engine__get_char(pEngine, iCharBeg-1)] : pRegex->byteClassCount;
+        drte_regex_dfa_state* pNextState = pState->pNext[iByteClass];
+        if (pNextState == NULL) {
+            pNextState = drte_regex__get_dfa_next_state(pRegex, pProgram, pState, iByteClass);
+            if (pNextState == NULL) {
+                return DRTE_FALSE;
+            }
+        }
 
-    // The selected text is just every selection concatenated together.
-    size_t length = 0;
-    for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
-        drte_region region = drte_region_normalize(pView->pSelections[iSelection]);
-        if (textOut != NULL) {
-            drte__strncpy_s(textOut+length, textOutSize-length, pView->pEngine->text+region.iCharBeg, (region.iCharEnd - region.iCharBeg));
+        if ((pNextState->flags & DRTE_REGEX_DFA_MATCH) != 0) {
+            isMatch = DRTE_TRUE;
+            matchBeg = iCharBeg;
         }
+    }
 
-        length += (region.iCharEnd - region.iCharBeg);
+done:
+    if (isMatch) {
+        *pMatchBegOut = matchBeg;
     }
 
-    return length;
+    return isMatch;
 }
 
-size_t drte_view_get_selection_text(drte_view* pView, size_t iSelection, char* textOut, size_t textOutSize)
+drte_bool32 drte_engine_find_regex(drte_engine* pEngine, drte_regex* pRegex, size_t iCharBeg, size_t iCharEnd, size_t* pMatchBegOut, size_t* pMatchEndOut)
 {
-    // Safety.
-    if (textOut != NULL && textOutSize > 0) {
-        textOut[0] = '\0';
+    if (pEngine == NULL || pRegex == NULL || pRegex->forward.pInsts == NULL) {
+        return DRTE_FALSE;
     }
 
-    if (pView == NULL || (textOut != NULL && textOutSize == 0)) {
-        return 0;
+    if (iCharEnd > pEngine->textLength) {
+        iCharEnd = pEngine->textLength;
     }
 
-    if (!drte_view_is_anything_selected(pView)) {
-        return 0;
+    if (iCharBeg > iCharEnd) {
+        return DRTE_FALSE;
     }
 
-    drte_region region = drte_region_normalize(pView->pSelections[iSelection]);
-    if (textOut != NULL) {
-        drte__strncpy_s(textOut, textOutSize, pView->pEngine->text+region.iCharBeg, (region.iCharEnd - region.iCharBeg));
+    size_t matchBeg;
+    size_t matchEnd;
+    if (!drte_engine__find_regex_match_end(pEngine, pRegex, iCharBeg, iCharEnd, &matchEnd)) {
+        return DRTE_FALSE;
     }
 
-    return (region.iCharEnd - region.iCharBeg);
+    if (!drte_engine__find_regex_match_beg(pEngine, pRegex, iCharBeg, matchEnd, &matchBeg)) {
+        return DRTE_FALSE;  // Should never happen, unless we run out of memory.
+    }
+
+    if (pMatchBegOut) *pMatchBegOut = matchBeg;
+    if (pMatchEndOut) *pMatchEndOut = matchEnd;
+    return DRTE_TRUE;
 }
 
-size_t drte_view_get_selection_first_line(drte_view* pView, size_t iSelection)
+drte_bool32 drte_engine_get_regex_groups(drte_engine* pEngine, drte_regex* pRegex, size_t iMatchBeg, size_t iMatchEnd, size_t* pGroupsOut)
 {
-    if (pView == NULL || pView->selectionCount == 0) {
-        return 0;
+    if (pEngine == NULL || pRegex == NULL || pRegex->forward.pInsts == NULL || pGroupsOut == NULL || iMatchBeg > iMatchEnd || iMatchEnd > pEngine->textLength) {
+        return DRTE_FALSE;
     }
 
-    return drte_view_get_character_line(pView, pView->pWrappedLines, drte_region_normalize(pView->pSelections[iSelection]).iCharBeg);
-}
+    // The whole match is all that's needed when there are no groups, which avoids simulating the NFA.
+    if (pRegex->groupCount == 1) {
+        pGroupsOut[0] = iMatchBeg;
+        pGroupsOut[1] = iMatchEnd;
+        return DRTE_TRUE;
+    }
 
-size_t drte_view_get_selection_last_line(drte_view* pView, size_t iSelection)
-{
-    if (pView == NULL) {
-        return 0;
+    const char* text = drte_engine__get_text_range(pEngine, iMatchBeg, iMatchEnd);
+    if (text == NULL) {
+        return DRTE_FALSE;
     }
 
-    return drte_view_get_character_line(pView, pView->pWrappedLines, drte_region_normalize(pView->pSelections[iSelection]).iCharEnd);
-}
+    int prevChar = (iMatchBeg > 0) ? (drte_uint8)drte_engine__get_char(pEngine, iMatchBeg-1) : -1;
+    int nextChar = (iMatchEnd < pEngine->textLength) ? (drte_uint8)drte_engine__get_char(pEngine, iMatchEnd) : -1;
+    if (!drte_regex__find_groups(pRegex, text, iMatchEnd - iMatchBeg, prevChar, nextChar, pGroupsOut)) {
+        return DRTE_FALSE;
+    }
 
-void drte_view_move_selection_anchor_to_end_of_line(drte_view* pView, size_t iLine)
-{
-    drte_view_set_selection_anchor(pView, drte_view_get_line_last_character(pView, pView->pWrappedLines, iLine));
-}
+    for (size_t i = 0; i < pRegex->groupCount*2; ++i) {
+        if (pGroupsOut[i] != (size_t)-1) {
+            pGroupsOut[i] += iMatchBeg;
+        }
+    }
 
-void drte_view_move_selection_anchor_to_start_of_line(drte_view* pView, size_t iLine)
-{
-    drte_view_set_selection_anchor(pView, drte_view_get_line_first_character(pView, pView->pWrappedLines, iLine));
+    return DRTE_TRUE;
 }
 
-size_t drte_view_get_selection_anchor_line(drte_view* pView)
+size_t drte_engine_expand_regex_replacement(drte_engine* pEngine, drte_regex* pRegex, size_t iMatchBeg, size_t iMatchEnd, const char* replacement, char* pTextOut, size_t textOutSize)
 {
-    if (pView == NULL || pView->selectionCount == 0) {
+    if (pEngine == NULL || pRegex == NULL || replacement == NULL) {
         return 0;
     }
 
-    return drte_view_get_character_line(pView, pView->pWrappedLines, pView->pSelections[pView->selectionCount-1].iCharBeg);
-}
+    size_t pGroups[DRTE_REGEX_MAX_GROUPS*2];
+    drte_bool32 hasGroups = DRTE_FALSE;
 
+    size_t length = 0;
+    for (const char* pNext = replacement; *pNext != '\0'; ) {
+        const char* text = pNext;
+        size_t textLength = 1;
+        size_t iGroupBeg = 0;
+        size_t iGroupEnd = 0;
+
+        if (pNext[0] == '\\' && pNext[1] >= '0' && pNext[1] <= '9') {
+            size_t iGroup = (size_t)(pNext[1] - '0');
+            if (!hasGroups) {
+                hasGroups = drte_engine_get_regex_groups(pEngine, pRegex, iMatchBeg, iMatchEnd, pGroups);
+            }
 
-void drte_view_begin_selection(drte_view* pView, size_t iCharBeg)
-{
-    if (pView == NULL) {
-        return;
-    }
+            text = NULL;
+            textLength = 0;
+            if (hasGroups && iGroup < pRegex->groupCount && pGroups[iGroup*2 + 0] != (size_t)-1) {
+                iGroupBeg = pGroups[iGroup*2 + 0];
+                iGroupEnd = pGroups[iGroup*2 + 1];
+                textLength = iGroupEnd - iGroupBeg;
+            }
 
-    drte_region* pNewSelections = (drte_region*)realloc(pView->pSelections, (pView->selectionCount + 1) * sizeof(*pNewSelections));
-    if (pNewSelections == NULL) {
-        return;
-    }
+            pNext += 2;
+        } else if (pNext[0] == '\\' && (pNext[1] == 'n' || pNext[1] == 't' || pNext[1] == '\\')) {
+            text = (pNext[1] == 'n') ? "\n" : ((pNext[1] == 't') ? "\t" : "\\");
+            pNext += 2;
+        } else {
+            pNext += 1;
+        }
 
-    pView->pSelections = pNewSelections;
-    pView->pSelections[pView->selectionCount].iCharBeg = iCharBeg;
-    pView->pSelections[pView->selectionCount].iCharEnd = iCharBeg;
-    pView->selectionCount += 1;
-}
+        // Whatever doesn't fit is cut off, but the full length is still returned.
+        if (pTextOut != NULL && length < textOutSize) {
+            size_t lengthToCopy = textLength;
+            if (lengthToCopy > textOutSize - length - 1) {
+                lengthToCopy = textOutSize - length - 1;
+            }
 
-void drte_view_cancel_selection(drte_view* pView, size_t iSelection)
-{
-    if (pView == NULL || pView->selectionCount == 0) {
-        return;
-    }
+            if (text != NULL) {
+                memcpy(pTextOut + length, text, lengthToCopy);
+            } else {
+                drte_piece_table_copy(&pEngine->text, iGroupBeg, iGroupBeg + lengthToCopy, pTextOut + length);
+            }
+        }
 
-    for (/* Do Nothing */; iSelection < pView->selectionCount-1; ++iSelection) {
-        pView->pSelections[iSelection] = pView->pSelections[iSelection+1];
+        length += textLength;
     }
 
-    pView->selectionCount -= 1;
-}
-
-void drte_view_cancel_last_selection(drte_view* pView)
-{
-    if (pView == NULL || pView->selectionCount == 0) {
-        return;
+    if (pTextOut != NULL && textOutSize > 0) {
+        pTextOut[(length < textOutSize) ? length : textOutSize-1] = '\0';
     }
 
-    pView->selectionCount -= 1;
+    return length;
 }
 
-void drte_view_set_selection_anchor(drte_view* pView, size_t iCharBeg)
+size_t drte_engine_replace_all_regex(drte_engine* pEngine, drte_regex* pRegex, const char* replacement, size_t iCharBeg, size_t iCharEnd)
 {
-    if (pView == NULL || pView->selectionCount == 0) {
-        return;
+    if (pEngine == NULL || pRegex == NULL || replacement == NULL) {
+        return 0;
     }
 
-    if (pView->pSelections[pView->selectionCount-1].iCharBeg != iCharBeg) {
-        pView->pSelections[pView->selectionCount-1].iCharBeg = iCharBeg;
-        drte_view__repaint(pView);
+    if (iCharEnd > pEngine->textLength) {
+        iCharEnd = pEngine->textLength;
     }
-}
 
-void drte_view_set_selection_end_point(drte_view* pView, size_t iCharEnd)
-{
-    if (pView == NULL || pView->selectionCount == 0) {
-        return;
-    }
+    // Every match is found and expanded before any of the text is changed.
+    size_t matchCount = 0;
+    size_t matchBufferSize = 0;
+    drte_region* pMatches = NULL;
+    size_t* pTextLengths = NULL;
 
-    if (pView->pSelections[pView->selectionCount-1].iCharEnd != iCharEnd) {
-        pView->pSelections[pView->selectionCount-1].iCharEnd = iCharEnd;
-        drte_view__repaint(pView);
-    }
-}
+    size_t textsLength = 0;
+    size_t textsBufferSize = 0;
+    char* pTexts = NULL;
 
-drte_bool32 drte_view_get_last_selection(drte_view* pView, size_t* iCharBegOut, size_t* iCharEndOut)
-{
-    if (pView == NULL || pView->selectionCount == 0) {
-        return DRTE_FALSE;
-    }
+    size_t matchBeg;
+    size_t matchEnd;
+    while (iCharBeg <= iCharEnd && drte_engine_find_regex(pEngine, pRegex, iCharBeg, iCharEnd, &matchBeg, &matchEnd)) {
+        if (matchCount == matchBufferSize) {
+            size_t newMatchBufferSize = (matchBufferSize == 0) ? 256 : matchBufferSize*2;
+            drte_region* pNewMatches = (drte_region*)realloc(pMatches, newMatchBufferSize * sizeof(*pNewMatches));
+            size_t* pNewTextLengths = (pNewMatches != NULL) ? (size_t*)realloc(pTextLengths, newMatchBufferSize * sizeof(*pNewTextLengths)) : NULL;
+            if (pNewMatches != NULL) pMatches = pNewMatches;
+            if (pNewTextLengths == NULL) {
+                matchCount = 0;
+                break;
+            }
 
-    drte_region selection = drte_region_normalize(pView->pSelections[pView->selectionCount-1]);
+            pTextLengths = pNewTextLengths;
+            matchBufferSize = newMatchBufferSize;
+        }
 
-    if (iCharBegOut) *iCharBegOut = selection.iCharBeg;
-    if (iCharEndOut) *iCharEndOut = selection.iCharEnd;
-    return DRTE_TRUE;
-}
+        size_t textLength = drte_engine_expand_regex_replacement(pEngine, pRegex, matchBeg, matchEnd, replacement, NULL, 0);
+        if (textsLength + textLength + 1 > textsBufferSize) {
+            size_t newTextsBufferSize = (textsBufferSize*2 > textsLength + textLength + 1) ? textsBufferSize*2 : textsLength + textLength + 1 + 256;
+            char* pNewTexts = (char*)realloc(pTexts, newTextsBufferSize);
+            if (pNewTexts == NULL) {
+                matchCount = 0;
+                break;
+            }
 
-drte_bool32 drte_view_get_selection_under_point(drte_view* pView, float posX, float posY, size_t* piSelectionOut)
-{
-    if (pView == NULL) return DRTE_FALSE;
+            pTexts = pNewTexts;
+            textsBufferSize = newTextsBufferSize;
+        }
 
-    size_t iChar;
-    if (!drte_view_get_character_under_point(pView, pView->pWrappedLines, posX, posY, &iChar, NULL)) {
-        return DRTE_FALSE;
-    }
+        drte_engine_expand_regex_replacement(pEngine, pRegex, matchBeg, matchEnd, replacement, pTexts + textsLength, textLength + 1);
+        textsLength += textLength;
 
-    for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
-        drte_region selection = drte_region_normalize(pView->pSelections[iSelection]);
-        if (iChar >= selection.iCharBeg && iChar < selection.iCharEnd) {
-            if (piSelectionOut) *piSelectionOut = iSelection;
-            return DRTE_TRUE;
+        pMatches[matchCount].iCharBeg = matchBeg;
+        pMatches[matchCount].iCharEnd = matchEnd;
+        pTextLengths[matchCount] = textLength;
+        matchCount += 1;
+
+        // An empty match would be found again at the same place so the search needs to move along by one character.
+        iCharBeg = (matchEnd > matchBeg) ? matchEnd : matchEnd + 1;
+    }
+
+    if (matchCount > 0) {
+        if (!drte_engine__replace_regions(pEngine, pMatches, matchCount, pTexts, pTextLengths)) {
+            matchCount = 0;
         }
     }
 
-    return DRTE_FALSE;
+    free(pMatches);
+    free(pTextLengths);
+    free(pTexts);
+    return matchCount;
 }
 
+// Retrieves the view's search pattern for the given text, preparing it if it's not the same as last time.
+drte_search_pattern* drte_view__get_find_pattern(drte_view* pView, const char* text)
+{
+    assert(pView != NULL);
+    assert(text != NULL);
 
+    if (pView->_findPattern.pText == NULL || strcmp(pView->_findPattern.pText, text) != 0) {
+        drte_search_pattern_uninit(&pView->_findPattern);
+        if (!drte_search_pattern_init(&pView->_findPattern, text, strlen(text))) {
+            return NULL;
+        }
+    }
 
+    return &pView->_findPattern;
+}
 
-drte_bool32 drte_view_insert_character_at_cursor(drte_view* pView, size_t cursorIndex, unsigned int character)
+drte_bool32 drte_view_find_next(drte_view* pView, const char* text, size_t* pSelectionStartOut, size_t* pSelectionEndOut)
 {
-    if (pView == NULL) {
+    if (pView == NULL || pView->pEngine == NULL || text == NULL || text[0] == '\0') {
         return DRTE_FALSE;
     }
 
-    drte_view_begin_dirty(pView);
-    {
-        drte_engine_insert_character(pView->pEngine, pView->pCursors[cursorIndex].iCharAbs, character);
+    drte_search_pattern* pPattern = drte_view__get_find_pattern(pView, text);
+    if (pPattern == NULL) {
+        return DRTE_FALSE;
     }
-    drte_view_end_dirty(pView);
 
+    size_t cursorPos = 0;
+    if (pView->cursorCount > 0) {
+        cursorPos = pView->pCursors[pView->cursorCount-1].iCharAbs;
+    }
 
-    // The cursor's sticky position needs to be updated whenever the text is edited.
-    drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
+    // If every occurance of this text has already been indexed there's no need to search.
+    size_t nextOccurance;
+    if (pView->_matchPattern.pText != NULL && drte_view_is_match_index_complete(pView) && strcmp(pView->_matchPattern.pText, text) == 0) {
+        size_t iMatch;
+        if (!drte_view_find_next_match(pView, cursorPos, &iMatch)) {
+            return DRTE_FALSE;
+        }
 
+        nextOccurance = pView->_pMatches[iMatch];
+    } else {
+        // When looping back there's no need to search any further than the last place a match could start before the cursor.
+        if (!drte_engine_find(pView->pEngine, pPattern, cursorPos, pView->pEngine->textLength, &nextOccurance)) {
+            if (!drte_engine_find(pView->pEngine, pPattern, 0, cursorPos + pPattern->length-1, &nextOccurance)) {
+                return DRTE_FALSE;
+            }
+        }
+    }
 
-    drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
+    if (pSelectionStartOut) {
+        *pSelectionStartOut = nextOccurance;
+    }
+    if (pSelectionEndOut) {
+        *pSelectionEndOut = nextOccurance + pPattern->length;
+    }
 
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_view_insert_character_at_cursors(drte_view* pView, unsigned int character)
+// Retrieves the view's regular expression for the given pattern, compiling it if it's not the same as last time.
+drte_regex* drte_view__get_find_regex(drte_view* pView, const char* pattern)
 {
-    if (pView == NULL) {
-        return DRTE_FALSE;
+    assert(pView != NULL);
+    assert(pattern != NULL);
+
+    if (pView->_findRegex.pPattern == NULL || strcmp(pView->_findRegex.pPattern, pattern) != 0) {
+        drte_regex_uninit(&pView->_findRegex);
+        if (!drte_regex_init(&pView->_findRegex, pattern, 0)) {
+            return NULL;
+        }
     }
 
-    // TODO: This can be improved because it is posting multiple onTextChanged messages.
+    return &pView->_findRegex;
+}
 
-    drte_bool32 wasTextChanged = DRTE_FALSE;
-    drte_view_begin_dirty(pView);
-    {
-        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-            if (!drte_view_insert_character_at_cursor(pView, iCursor, character)) {
-                continue;
-            } else {
-                wasTextChanged = DRTE_TRUE;
-            }
+// Finds the first non-empty match of a regular expression that starts within the given range.
+drte_bool32 drte_view__find_non_empty_regex_match(drte_view* pView, drte_regex* pRegex, size_t iCharBeg, size_t* pMatchBegOut, size_t* pMatchEndOut)
+{
+    assert(pView != NULL);
+
+    size_t textLength = pView->pEngine->textLength;
+    while (iCharBeg < textLength) {
+        if (!drte_engine_find_regex(pView->pEngine, pRegex, iCharBeg, textLength, pMatchBegOut, pMatchEndOut)) {
+            return DRTE_FALSE;
+        }
+
+        if (*pMatchEndOut > *pMatchBegOut) {
+            return DRTE_TRUE;
         }
+
+        iCharBeg = *pMatchBegOut + 1;
     }
-    drte_view_end_dirty(pView);
 
-    return wasTextChanged;
+    return DRTE_FALSE;
 }
 
-drte_bool32 drte_view_insert_text_at_cursor(drte_view* pView, size_t cursorIndex, const char* text)
+drte_bool32 drte_view_find_next_regex(drte_view* pView, const char* pattern, size_t* pSelectionStartOut, size_t* pSelectionEndOut)
 {
-    if (pView == NULL || text == NULL) {
+    if (pView == NULL || pView->pEngine == NULL || pattern == NULL || pattern[0] == '\0') {
         return DRTE_FALSE;
     }
 
-    drte_view_begin_dirty(pView);
-    {
-        size_t cursorPos = pView->pCursors[cursorIndex].iCharAbs;
-        drte_engine_insert_text(pView->pEngine, text, cursorPos);
+    drte_regex* pRegex = drte_view__get_find_regex(pView, pattern);
+    if (pRegex == NULL) {
+        return DRTE_FALSE;
     }
-    drte_view_end_dirty(pView);
 
+    size_t cursorPos = 0;
+    if (pView->cursorCount > 0) {
+        cursorPos = pView->pCursors[pView->cursorCount-1].iCharAbs;
+    }
 
-    // The cursor's sticky position needs to be updated whenever the text is edited.
-    drte_view__update_cursor_sticky_position(pView, &pView->pCursors[cursorIndex]);
+    size_t matchBeg;
+    size_t matchEnd;
+    if (!drte_view__find_non_empty_regex_match(pView, pRegex, cursorPos, &matchBeg, &matchEnd)) {
+        if (cursorPos == 0 || !drte_view__find_non_empty_regex_match(pView, pRegex, 0, &matchBeg, &matchEnd)) {
+            return DRTE_FALSE;
+        }
+    }
 
-    drte_engine__on_cursor_move(pView->pEngine, pView, cursorIndex);
+    if (pSelectionStartOut) {
+        *pSelectionStartOut = matchBeg;
+    }
+    if (pSelectionEndOut) {
+        *pSelectionEndOut = matchEnd;
+    }
 
     return DRTE_TRUE;
 }
 
-drte_bool32 drte_view_delete_character_to_left_of_cursor(drte_view* pView, size_t cursorIndex)
+drte_bool32 drte_view_find_next_no_loop(drte_view* pView, const char* text, size_t* pSelectionStartOut, size_t* pSelectionEndOut)
 {
-    if (pView == NULL) {
+    if (pView == NULL || pView->pEngine == NULL || text == NULL || text[0] == '\0') {
         return DRTE_FALSE;
     }
 
-    // We just move the cursor to the left, and then delete the character to the right.
-    if (drte_view_move_cursor_left(pView, cursorIndex)) {
-        drte_view_delete_character_to_right_of_cursor(pView, cursorIndex);
-        return DRTE_TRUE;
+    drte_search_pattern* pPattern = drte_view__get_find_pattern(pView, text);
+    if (pPattern == NULL) {
+        return DRTE_FALSE;
     }
 
-    return DRTE_FALSE;
-}
+    size_t cursorPos = 0;
+    if (pView->cursorCount > 0) {
+        cursorPos = pView->pCursors[pView->cursorCount-1].iCharAbs;
+    }
 
-drte_bool32 drte_view_delete_character_to_left_of_cursors(drte_view* pView, drte_bool32 leaveNewLines)
-{
-    if (pView == NULL) {
+    size_t nextOccurance;
+    if (!drte_engine_find(pView->pEngine, pPattern, cursorPos, pView->pEngine->textLength, &nextOccurance)) {
         return DRTE_FALSE;
     }
 
-    drte_bool32 wasTextChanged = DRTE_FALSE;
-    drte_view_begin_dirty(pView);
-    {
-        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-            size_t iCursorChar = pView->pCursors[iCursor].iCharAbs;
-            if (iCursorChar == 0) {
-                continue;
-            }
+    if (pSelectionStartOut) {
+        *pSelectionStartOut = nextOccurance;
+    }
+    if (pSelectionEndOut) {
+        *pSelectionEndOut = nextOccurance + pPattern->length;
+    }
 
-            if (leaveNewLines) {
-                size_t iLineCharBeg = drte_view_get_line_first_character(pView, pView->pWrappedLines, drte_view_get_cursor_line(pView, iCursor));
-                if (iCursorChar == iLineCharBeg) {
-                    continue;
-                }
-            }
+    return DRTE_TRUE;
+}
 
-            if (!drte_view_delete_character_to_left_of_cursor(pView, iCursor)) {
-                continue;
+
+// Finds every match starting in the given range and inserts them into the view's index at the given position. The range must not
+// contain any matches that are already in the index.
+drte_bool32 drte_view__index_matches_in_range(drte_view* pView, size_t iMatchInsert, size_t iCharBeg, size_t iCharEnd)
+{
+    assert(pView != NULL);
+    assert(iMatchInsert <= pView->_matchCount);
+
+    size_t matchLength = pView->_matchPattern.length;
+
+    // The search needs to go far enough past the end of the range to find matches that start inside it.
+    size_t iSearchEnd = iCharEnd + (matchLength-1);
+
+    // The new matches are found first and then inserted all at once so the existing ones only need to be moved once.
+    size_t newMatchCount = 0;
+    size_t newMatchBufferSize = 0;
+    size_t* pNewMatches = NULL;
+
+    size_t iMatch;
+    while (iCharBeg < iCharEnd && drte_engine_find(pView->pEngine, &pView->_matchPattern, iCharBeg, iSearchEnd, &iMatch) && iMatch < iCharEnd) {
+        if (newMatchCount == newMatchBufferSize) {
+            newMatchBufferSize = (newMatchBufferSize == 0) ? 64 : newMatchBufferSize*2;
+            size_t* pNewMatchesRealloc = (size_t*)realloc(pNewMatches, newMatchBufferSize * sizeof(*pNewMatches));
+            if (pNewMatchesRealloc == NULL) {
+                free(pNewMatches);
+                return DRTE_FALSE;
             }
 
-            wasTextChanged = DRTE_TRUE;
+            pNewMatches = pNewMatchesRealloc;
         }
-    }
-    drte_view_end_dirty(pView);
 
-    return wasTextChanged;
-}
+        pNewMatches[newMatchCount++] = iMatch;
 
-drte_bool32 drte_view_delete_character_to_right_of_cursor(drte_view* pView, size_t cursorIndex)
-{
-    if (pView == NULL) {
-        return DRTE_FALSE;
+        // Matches are allowed to overlap.
+        iCharBeg = iMatch + 1;
     }
 
-    size_t iCharBeg = pView->pCursors[cursorIndex].iCharAbs;
-    if (iCharBeg < pView->pEngine->textLength)
-    {
-        size_t iCharEnd = iCharBeg+1;
-        if (pView->pEngine->text[iCharBeg] == '\r' && pView->pEngine->text[iCharEnd] == '\n') {
-            iCharEnd += 1;  // It's a \r\n line ending.
+    if (newMatchCount == 0) {
+        return DRTE_TRUE;
+    }
+
+    if (pView->_matchCount + newMatchCount > pView->_matchBufferSize) {
+        size_t newBufferSize = (pView->_matchBufferSize == 0) ? 256 : pView->_matchBufferSize*2;
+        if (newBufferSize < pView->_matchCount + newMatchCount) {
+            newBufferSize = pView->_matchCount + newMatchCount;
         }
 
-        if (!drte_engine_delete_text(pView->pEngine, iCharBeg, iCharEnd)) {
+        size_t* pNewBuffer = (size_t*)realloc(pView->_pMatches, newBufferSize * sizeof(*pNewBuffer));
+        if (pNewBuffer == NULL) {
+            free(pNewMatches);
             return DRTE_FALSE;
         }
 
+        pView->_pMatches = pNewBuffer;
+        pView->_matchBufferSize = newBufferSize;
+    }
+
+    memmove(pView->_pMatches + iMatchInsert + newMatchCount, pView->_pMatches + iMatchInsert, (pView->_matchCount - iMatchInsert) * sizeof(*pView->_pMatches));
+    memcpy(pView->_pMatches + iMatchInsert, pNewMatches, newMatchCount * sizeof(*pView->_pMatches));
+    pView->_matchCount += newMatchCount;
 
-        // The layout will have changed.
-        drte_view_move_cursor_to_character(pView, cursorIndex, iCharBeg);
+    free(pNewMatches);
+    return DRTE_TRUE;
+}
 
-        if (pView->pEngine->onTextChanged) {
-            pView->pEngine->onTextChanged(pView->pEngine);
+void drte_view__reset_matches(drte_view* pView)
+{
+    assert(pView != NULL);
+
+    pView->_matchCount = 0;
+    pView->_matchIndexedLength = 0;
+}
+
+void drte_view__update_matches(drte_view* pView, size_t iCharBeg, size_t removedLength, size_t insertedLength)
+{
+    assert(pView != NULL);
+
+    if (pView->_matchPattern.pText == NULL) {
+        return;
+    }
+
+    size_t matchLength = pView->_matchPattern.length;
+
+    // Matches that overlap the removed text need to be removed. When nothing is removed this is just the matches that straddle the
+    // insertion point.
+    size_t iAffectedCharBeg = (iCharBeg > matchLength-1) ? iCharBeg - (matchLength-1) : 0;
+    size_t iAffectedCharEnd = iCharBeg + removedLength;
+
+    size_t iMatchBeg = drte_view__find_first_match_after_character(pView, iAffectedCharBeg);
+    while (iMatchBeg > 0 && pView->_pMatches[iMatchBeg-1] >= iAffectedCharBeg) {
+        iMatchBeg -= 1;
+    }
+
+    size_t iMatchEnd = iMatchBeg;
+    while (iMatchEnd < pView->_matchCount && pView->_pMatches[iMatchEnd] < iAffectedCharEnd) {
+        iMatchEnd += 1;
+    }
+
+    // Large insertions are left to drte_view_index_matches() so the caller isn't held up. Everything from the edit onwards will be
+    // indexed again.
+    if (insertedLength > DRTE_MATCH_INDEXING_CHUNK_SIZE) {
+        pView->_matchCount = iMatchBeg;
+        if (pView->_matchIndexedLength > iAffectedCharBeg) {
+            pView->_matchIndexedLength = iAffectedCharBeg;
         }
 
         drte_view_dirty(pView, drte_view_get_local_rect(pView));
+        return;
+    }
 
-        return DRTE_TRUE;
+    memmove(pView->_pMatches + iMatchBeg, pView->_pMatches + iMatchEnd, (pView->_matchCount - iMatchEnd) * sizeof(*pView->_pMatches));
+    pView->_matchCount -= iMatchEnd - iMatchBeg;
+
+    // Matches after the edit are moved.
+    for (size_t iMatch = iMatchBeg; iMatch < pView->_matchCount; ++iMatch) {
+        pView->_pMatches[iMatch] = pView->_pMatches[iMatch] - removedLength + insertedLength;
     }
 
-    return DRTE_FALSE;
+    if (iCharBeg + removedLength <= pView->_matchIndexedLength) {
+        pView->_matchIndexedLength = pView->_matchIndexedLength - removedLength + insertedLength;
+    } else if (iCharBeg < pView->_matchIndexedLength) {
+        pView->_matchIndexedLength = iCharBeg;
+    }
+
+    // The only new matches are the ones that include some of the inserted text, or that straddle the point where text was removed.
+    drte_view__index_matches_in_range(pView, iMatchBeg, iAffectedCharBeg, drte_min(iCharBeg + insertedLength, pView->_matchIndexedLength));
 }
 
-drte_bool32 drte_view_delete_character_to_right_of_cursors(drte_view* pView, drte_bool32 leaveNewLines)
+drte_bool32 drte_view_set_match_text(drte_view* pView, const char* text)
 {
     if (pView == NULL) {
         return DRTE_FALSE;
     }
 
-    drte_bool32 wasTextChanged = DRTE_FALSE;
-    drte_view_begin_dirty(pView);
-    {
-        for (size_t iCursor = 0; iCursor < pView->cursorCount; ++iCursor) {
-            size_t iCursorChar = pView->pCursors[iCursor].iCharAbs;
-            if (leaveNewLines) {
-                size_t iLineCharEnd = drte_view_get_line_last_character(pView, pView->pWrappedLines, drte_view_get_cursor_line(pView, iCursor));
-                if (iCursorChar == iLineCharEnd) {
-                    continue;
-                }
-            }
+    if (text == NULL) {
+        text = "";
+    }
 
-            if (!drte_view_delete_character_to_right_of_cursor(pView, iCursor)) {
-                continue;
-            }
+    const char* prevText = (pView->_matchPattern.pText != NULL) ? pView->_matchPattern.pText : "";
+    if (strcmp(prevText, text) == 0) {
+        return DRTE_TRUE;   // Nothing has changed.
+    }
 
-            wasTextChanged = DRTE_TRUE;
-        }
+    drte_search_pattern_uninit(&pView->_matchPattern);
+    drte_view__reset_matches(pView);
+
+    drte_bool32 result = DRTE_TRUE;
+    if (text[0] != '\0') {
+        result = drte_search_pattern_init(&pView->_matchPattern, text, strlen(text));
     }
-    drte_view_end_dirty(pView);
 
-    return wasTextChanged;
+    drte_view_dirty(pView, drte_view_get_local_rect(pView));
+    return result;
 }
 
+const char* drte_view_get_match_text(drte_view* pView)
+{
+    if (pView == NULL) {
+        return NULL;
+    }
+
+    return pView->_matchPattern.pText;
+}
 
-drte_bool32 drte_view_delete_selected_text(drte_view* pView)
+drte_bool32 drte_view_index_matches(drte_view* pView, size_t maxCharacters)
 {
-    if (pView == NULL || pView->selectionCount == 0) {
+    if (pView == NULL) {
         return DRTE_FALSE;
     }
 
-    drte_bool32 wasTextChanged = DRTE_FALSE;
-    drte_view_begin_dirty(pView);
-    {
-        for (size_t iSelection = 0; iSelection < pView->selectionCount; ++iSelection) {
-            wasTextChanged = drte_view_delete_selection_text(pView, iSelection) || wasTextChanged;
-        }
+    if (drte_view_is_match_index_complete(pView)) {
+        return DRTE_TRUE;
     }
-    drte_view_end_dirty(pView);
 
-    return wasTextChanged;
-}
+    size_t iCharBeg = pView->_matchIndexedLength;
+    size_t iCharEnd = pView->pEngine->textLength;
+    if (iCharEnd - iCharBeg > maxCharacters) {
+        iCharEnd = iCharBeg + maxCharacters;
+    }
 
-drte_bool32 drte_view_delete_selection_text(drte_view* pView, size_t iSelectionToDelete)
-{
-    if (pView == NULL || pView->selectionCount == 0) {
+    size_t prevMatchCount = pView->_matchCount;
+    if (!drte_view__index_matches_in_range(pView, pView->_matchCount, iCharBeg, iCharEnd)) {
         return DRTE_FALSE;
     }
 
-    drte_region selectionToDelete = drte_region_normalize(pView->pSelections[iSelectionToDelete]);
-    if (selectionToDelete.iCharBeg == selectionToDelete.iCharEnd) {
-        return DRTE_FALSE;   // Nothing is selected.
+    pView->_matchIndexedLength = iCharEnd;
+
+    if (pView->_matchCount > prevMatchCount) {
+        drte_view_dirty(pView, drte_view_get_local_rect(pView));
     }
 
-    return drte_engine_delete_text(pView->pEngine, selectionToDelete.iCharBeg, selectionToDelete.iCharEnd);
+    return drte_view_is_match_index_complete(pView);
 }
 
-
-drte_bool32 drte_view_find_next(drte_view* pView, const char* text, size_t* pSelectionStartOut, size_t* pSelectionEndOut)
+drte_bool32 drte_view_is_match_index_complete(drte_view* pView)
 {
-    if (pView == NULL || pView->pEngine == NULL || pView->pEngine->text == NULL || text == NULL || text[0] == '\0') {
+    if (pView == NULL) {
         return DRTE_FALSE;
     }
 
-    size_t cursorPos = 0;
-    if (pView->cursorCount > 0) {
-        cursorPos = pView->pCursors[pView->cursorCount-1].iCharAbs;
-    }
+    return pView->_matchPattern.pText == NULL || pView->_matchIndexedLength >= pView->pEngine->textLength;
+}
 
-    char* nextOccurance = strstr(pView->pEngine->text + cursorPos, text);
-    if (nextOccurance == NULL) {
-        nextOccurance = strstr(pView->pEngine->text, text);
+size_t drte_view_get_match_count(drte_view* pView)
+{
+    if (pView == NULL) {
+        return 0;
     }
 
-    if (nextOccurance == NULL) {
+    return pView->_matchCount;
+}
+
+drte_bool32 drte_view_get_match(drte_view* pView, size_t iMatch, size_t* pCharBegOut, size_t* pCharEndOut)
+{
+    if (pView == NULL || iMatch >= pView->_matchCount) {
         return DRTE_FALSE;
     }
 
-    if (pSelectionStartOut) {
-        *pSelectionStartOut = nextOccurance - pView->pEngine->text;
-    }
-    if (pSelectionEndOut) {
-        *pSelectionEndOut = (nextOccurance - pView->pEngine->text) + strlen(text);
+    if (pCharBegOut) *pCharBegOut = pView->_pMatches[iMatch];
+    if (pCharEndOut) *pCharEndOut = pView->_pMatches[iMatch] + pView->_matchPattern.length;
+    return DRTE_TRUE;
+}
+
+size_t drte_view_get_match_count_before_character(drte_view* pView, size_t iChar)
+{
+    if (pView == NULL || iChar == 0) {
+        return 0;
     }
 
-    return DRTE_TRUE;
+    return drte_view__find_first_match_after_character(pView, iChar-1);
 }
 
-drte_bool32 drte_view_find_next_no_loop(drte_view* pView, const char* text, size_t* pSelectionStartOut, size_t* pSelectionEndOut)
+drte_bool32 drte_view_find_next_match(drte_view* pView, size_t iChar, size_t* pMatchIndexOut)
 {
-    if (pView == NULL || pView->pEngine == NULL || pView->pEngine->text == NULL || text == NULL || text[0] == '\0') {
+    if (pView == NULL || pView->_matchCount == 0) {
         return DRTE_FALSE;
     }
 
-    size_t cursorPos = 0;
-    if (pView->cursorCount > 0) {
-        cursorPos = pView->pCursors[pView->cursorCount-1].iCharAbs;
+    size_t iMatch = drte_view_get_match_count_before_character(pView, iChar);
+    if (iMatch == pView->_matchCount) {
+        iMatch = 0;
     }
 
-    char* nextOccurance = strstr(pView->pEngine->text + cursorPos, text);
-    if (nextOccurance == NULL) {
+    if (pMatchIndexOut) *pMatchIndexOut = iMatch;
+    return DRTE_TRUE;
+}
+
+drte_bool32 drte_view_find_prev_match(drte_view* pView, size_t iChar, size_t* pMatchIndexOut)
+{
+    if (pView == NULL || pView->_matchCount == 0) {
         return DRTE_FALSE;
     }
 
-    if (pSelectionStartOut) {
-        *pSelectionStartOut = nextOccurance - pView->pEngine->text;
-    }
-    if (pSelectionEndOut) {
-        *pSelectionEndOut = (nextOccurance - pView->pEngine->text) + strlen(text);
+    size_t iMatch = drte_view_get_match_count_before_character(pView, iChar);
+    if (iMatch == 0) {
+        iMatch = pView->_matchCount;
     }
 
+    if (pMatchIndexOut) *pMatchIndexOut = iMatch-1;
     return DRTE_TRUE;
 }
 
@@ -0,0 +1,587 @@
+// Copyright (C) 2017 David Reid. See included LICENSE file.
+
+// Regression tests for dr_text_engine. These don't depend on anything else in dred. To build and run:
+//
+//     cc source/tests/dr_text_engine_tests.c -o dr_text_engine_tests -lm && ./dr_text_engine_tests
+
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef int32_t dtk_int32;
+
+#define DR_TEXT_ENGINE_IMPLEMENTATION
+#include "../external/dr_text_engine.h"
+
+#define TEST_STYLE_DEFAULT  1
+#define TEST_STYLE_BRACKETS 2
+
+static int g_FailedCount = 0;
+
+static void test_fail(const char* testName, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    printf("FAILED: %s: ", testName);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+
+    g_FailedCount += 1;
+}
+
+// Every character is 8 wide and every line is 16 high.
+static void test__on_measure_string(drte_engine* pEngine, drte_style_token styleToken, float scale, const char* text, size_t textLength, int* pWidthOut, int* pHeightOut)
+{
+    (void)pEngine;
+    (void)styleToken;
+    (void)text;
+
+    *pWidthOut  = (int)(textLength * 8 * scale);
+    *pHeightOut = (int)(16 * scale);
+}
+
+static void test__on_get_cursor_position_from_point(drte_engine* pEngine, drte_style_token styleToken, float scale, const char* text, size_t textSizeInBytes, float maxWidth, float inputPosX, float* pTextCursorPosXOut, size_t* pCharacterIndexOut)
+{
+    (void)pEngine;
+    (void)styleToken;
+    (void)text;
+    (void)maxWidth;
+
+    size_t iChar = (size_t)(inputPosX / (8 * scale));
+    if (iChar > textSizeInBytes) {
+        iChar = textSizeInBytes;
+    }
+
+    *pTextCursorPosXOut = iChar * 8 * scale;
+    *pCharacterIndexOut = iChar;
+}
+
+// A lexer whose state is how deep inside brackets the end of the line is, which means a change to one line can change the state of
+// every line after it. The tokens don't depend on the state so that the way a line is wrapped only depends on it's own text.
+static uint32_t test__on_lex_line(drte_engine* pEngine, uint32_t state, const char* text, size_t textLength, drte_lexed_line* pLine, void* pUserData)
+{
+    (void)pEngine;
+    (void)pUserData;
+
+    for (size_t i = 0; i < textLength; ++i) {
+        if (text[i] == '(') {
+            state += 1;
+            drte_lexed_line_add_token(pLine, i, i+1, TEST_STYLE_BRACKETS);
+        } else if (text[i] == ')') {
+            if (state > 0) {
+                state -= 1;
+            }
+            drte_lexed_line_add_token(pLine, i, i+1, TEST_STYLE_BRACKETS);
+        }
+    }
+
+    return state;
+}
+
+static void test__init_engine(drte_engine* pEngine)
+{
+    drte_engine_init(pEngine, NULL);
+    pEngine->onMeasureString = test__on_measure_string;
+    pEngine->onGetCursorPositionFromPoint = test__on_get_cursor_position_from_point;
+
+    drte_engine_register_style_token(pEngine, TEST_STYLE_DEFAULT,  drte_font_metrics_create(12, 4, 16, 8));
+    drte_engine_register_style_token(pEngine, TEST_STYLE_BRACKETS, drte_font_metrics_create(12, 4, 16, 8));
+    drte_engine_set_default_style(pEngine, TEST_STYLE_DEFAULT);
+}
+
+static char* test__get_text(drte_engine* pEngine)
+{
+    size_t textLength = drte_engine_get_text(pEngine, NULL, 0);
+    char* text = (char*)malloc(textLength + 1);
+    drte_engine_get_text(pEngine, text, textLength + 1);
+    return text;
+}
+
+// Simple deterministic random numbers so failures can be reproduced.
+static uint32_t test__rand(uint32_t* pSeed)
+{
+    *pSeed = *pSeed * 1103515245 + 12345;
+    return (*pSeed >> 16) & 0x7FFF;
+}
+
+static void test__random_text(uint32_t* pSeed, char* textOut, size_t textLength)
+{
+    static const char chars[] = "((()))\n\n abcdefgh";
+    for (size_t i = 0; i < textLength; ++i) {
+        textOut[i] = chars[test__rand(pSeed) % (sizeof(chars)-1)];
+    }
+    textOut[textLength] = '\0';
+}
+
+// Checks the lexer state of each line against lexing the whole text again from the start.
+static void test__check_lexer_states(const char* testName, drte_engine* pEngine, uint32_t seed)
+{
+    size_t lineCount = drte_line_cache_get_line_count(pEngine->pUnwrappedLines);
+    if (!drte_engine__lex_to_line(pEngine, lineCount-1)) {
+        test_fail(testName, "seed %u: failed to lex to line %zu", seed, lineCount-1);
+        return;
+    }
+
+    char* text = test__get_text(pEngine);
+
+    uint32_t state = 0;
+    const char* lineBeg = text;
+    for (size_t iLine = 0; iLine < lineCount; ++iLine) {
+        if (pEngine->_pLexerStates[iLine] != state) {
+            test_fail(testName, "seed %u: line %zu is in state %u when it should be %u", seed, iLine, pEngine->_pLexerStates[iLine], state);
+            break;
+        }
+
+        const char* lineEnd = strchr(lineBeg, '\n');
+        if (lineEnd == NULL) {
+            lineEnd = lineBeg + strlen(lineBeg);
+        }
+
+        state = test__on_lex_line(pEngine, state, lineBeg, (size_t)(lineEnd - lineBeg), NULL, NULL);
+        lineBeg = lineEnd + (*lineEnd == '\n');
+    }
+
+    free(text);
+}
+
+// Inserting text while word wrap is enabled lexes the new text while the lines are re-wrapped, so the lexer states need to be moved
+// to their new lines before then.
+static void test_lexer_states_after_edits_with_word_wrap()
+{
+    const char* testName = "lexer states after edits with word wrap";
+
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        drte_engine engine;
+        test__init_engine(&engine);
+        drte_engine_set_highlighter(&engine, test__on_lex_line, NULL);
+
+        uint32_t randomSeed = seed;
+        char text[4096];
+        test__random_text(&randomSeed, text, 2000);
+        drte_engine_set_text(&engine, text);
+
+        drte_view* pView = drte_view_create(&engine);
+        drte_view_set_size(pView, 160, 480);
+        drte_view_enable_word_wrap(pView);
+
+        // The edits are made without lexing in between so that each one is made while there are stale states left by the last.
+        drte_engine__lex_to_line(&engine, drte_line_cache_get_line_count(engine.pUnwrappedLines)-1);
+
+        for (int iEdit = 0; iEdit < 50; ++iEdit) {
+            size_t textLength = drte_engine_get_text(&engine, NULL, 0);
+            size_t insertLength = 1 + test__rand(&randomSeed) % ((iEdit % 10 == 0) ? 2000 : 20);
+            test__random_text(&randomSeed, text, insertLength);
+
+            size_t iChar = test__rand(&randomSeed) % (textLength + 1);
+            if (test__rand(&randomSeed) % 3 == 0 && textLength > 0) {
+                drte_engine_delete_text(&engine, iChar, drte_min(iChar + insertLength, textLength));
+            } else {
+                drte_engine_insert_text(&engine, text, iChar);
+            }
+        }
+
+        test__check_lexer_states(testName, &engine, seed);
+
+        drte_view_delete(pView);
+        drte_engine_uninit(&engine);
+    }
+}
+
+// Checks the width of each line of the view against a view of a new engine holding the same text.
+static void test__check_line_widths(const char* testName, drte_view* pView)
+{
+    char* text = test__get_text(pView->pEngine);
+
+    drte_engine engine;
+    test__init_engine(&engine);
+    drte_engine_set_text(&engine, text);
+
+    drte_view* pExpectedView = drte_view_create(&engine);
+    drte_view_set_size(pExpectedView, pView->sizeX, pView->sizeY);
+
+    size_t lineCount = drte_line_cache_get_line_count(engine.pUnwrappedLines);
+    for (size_t iLine = 0; iLine < lineCount; ++iLine) {
+        float width;
+        drte_view_measure_line(pView, iLine, &width, NULL);
+
+        float expectedWidth;
+        drte_view_measure_line(pExpectedView, iLine, &expectedWidth, NULL);
+
+        if (width != expectedWidth) {
+            test_fail(testName, "line %zu measured %g when it should be %g", iLine, width, expectedWidth);
+            break;
+        }
+    }
+
+    drte_view_delete(pExpectedView);
+    drte_engine_uninit(&engine);
+    free(text);
+}
+
+// Replacing every occurance of a pattern can change any line, so the widths the view has already measured need to be forgotten.
+static void test_line_widths_after_replace_all()
+{
+    const char* testName = "line widths after replace all";
+
+    drte_engine engine;
+    test__init_engine(&engine);
+    drte_engine_set_text(&engine, "one two\nthree two one\ntwo two two\nfour");
+
+    drte_view* pView = drte_view_create(&engine);
+    drte_view_set_size(pView, 640, 480);
+
+    size_t lineCount = drte_line_cache_get_line_count(engine.pUnwrappedLines);
+    for (size_t iLine = 0; iLine < lineCount; ++iLine) {
+        float width;
+        drte_view_measure_line(pView, iLine, &width, NULL);
+    }
+
+    drte_search_pattern pattern;
+    drte_search_pattern_init(&pattern, "two", 3);
+    drte_engine_replace_all(&engine, &pattern, "twenty two", 0, engine.textLength);
+    drte_search_pattern_uninit(&pattern);
+
+    test__check_line_widths(testName, pView);
+
+    drte_view_delete(pView);
+    drte_engine_uninit(&engine);
+}
+
+// Replacing every occurance of a pattern rebuilds the whole text. The text it replaces shouldn't be kept around.
+static void test_replace_all_reclaims_add_buffer()
+{
+    const char* testName = "replace all reclaims add buffer";
+
+    drte_engine engine;
+    test__init_engine(&engine);
+    drte_engine_set_text(&engine, "one two\nthree two one\ntwo two two\nfour");
+
+    drte_search_pattern pattern;
+    drte_search_pattern_init(&pattern, "o", 1);
+    for (int i = 0; i < 1000; ++i) {
+        drte_engine_replace_all(&engine, &pattern, "o", 0, engine.textLength);
+    }
+    drte_search_pattern_uninit(&pattern);
+
+    if (engine.text.addBufferSize > engine.textLength) {
+        test_fail(testName, "the add buffer is %zu bytes for %zu characters of text", engine.text.addBufferSize, engine.textLength);
+    }
+
+    drte_engine_uninit(&engine);
+}
+
+// Batches of edits, and undoing and redoing them, replace the text at many places at once. Like replacing all occurances of a pattern
+// the text they replace shouldn't be kept around.
+static void test_batched_edits_reclaim_add_buffer()
+{
+    const char* testName = "batched edits reclaim add buffer";
+
+    drte_engine engine;
+    test__init_engine(&engine);
+
+    uint32_t randomSeed = 1;
+    char text[4096];
+    test__random_text(&randomSeed, text, sizeof(text)-1);
+    drte_engine_set_text(&engine, text);
+
+    drte_view* pView = drte_view_create(&engine);
+    drte_view_set_size(pView, 640, 480);
+
+    for (int i = 0; i < 200; ++i) {
+        drte_edit edits[3];
+        for (int iEdit = 0; iEdit < 3; ++iEdit) {
+            edits[iEdit].iChar = iEdit * 1000;
+            edits[iEdit].deleteLength = 1;
+            edits[iEdit].text = "x";
+            edits[iEdit].textLength = 1;
+        }
+
+        drte_engine_prepare_undo_point(&engine);
+        drte_view_apply_edits(pView, edits, 3);
+        drte_engine_commit_undo_point(&engine);
+
+        drte_engine_undo(&engine);
+        drte_engine_redo(&engine);
+    }
+
+    if (engine.text.addBufferSize > engine.textLength*4) {
+        test_fail(testName, "the add buffer is %zu bytes for %zu characters of text", engine.text.addBufferSize, engine.textLength);
+    }
+
+    drte_view_delete(pView);
+    drte_engine_uninit(&engine);
+}
+
+// Checks the wrapped lines of the view against a view of a new engine holding the same text.
+static void test__check_wrapped_lines(const char* testName, drte_view* pView, uint32_t seed)
+{
+    char* text = test__get_text(pView->pEngine);
+
+    // Lines are wrapped between highlighting tokens so the new engine needs the same highlighter.
+    drte_engine engine;
+    test__init_engine(&engine);
+    drte_engine_set_highlighter(&engine, pView->pEngine->onLexLine, NULL);
+    drte_engine_set_text(&engine, text);
+
+    drte_view* pExpectedView = drte_view_create(&engine);
+    drte_view_set_size(pExpectedView, pView->sizeX, pView->sizeY);
+    drte_view_enable_word_wrap(pExpectedView);
+    drte_view_wrap_lines(pExpectedView, (size_t)-1);
+    drte_view_wrap_lines(pView, (size_t)-1);
+
+    size_t lineCount = drte_line_cache_get_line_count(pView->pWrappedLines);
+    size_t expectedLineCount = drte_line_cache_get_line_count(pExpectedView->pWrappedLines);
+    if (lineCount != expectedLineCount) {
+        test_fail(testName, "seed %u: there are %zu wrapped lines when there should be %zu", seed, lineCount, expectedLineCount);
+    } else {
+        for (size_t iLine = 0; iLine < lineCount; ++iLine) {
+            size_t iCharBeg = drte_line_cache_get_line_first_character(pView->pWrappedLines, iLine);
+            size_t iExpectedCharBeg = drte_line_cache_get_line_first_character(pExpectedView->pWrappedLines, iLine);
+            if (iCharBeg != iExpectedCharBeg) {
+                test_fail(testName, "seed %u: wrapped line %zu starts at %zu when it should start at %zu", seed, iLine, iCharBeg, iExpectedCharBeg);
+                break;
+            }
+        }
+    }
+
+    drte_view_delete(pExpectedView);
+    drte_engine_uninit(&engine);
+    free(text);
+}
+
+// Checks the matches of the view against a view of a new engine holding the same text.
+static void test__check_matches(const char* testName, drte_view* pView, uint32_t seed)
+{
+    char* text = test__get_text(pView->pEngine);
+
+    drte_engine engine;
+    test__init_engine(&engine);
+    drte_engine_set_text(&engine, text);
+
+    drte_view* pExpectedView = drte_view_create(&engine);
+    drte_view_set_match_text(pExpectedView, drte_view_get_match_text(pView));
+    drte_view_index_matches(pExpectedView, (size_t)-1);
+    drte_view_index_matches(pView, (size_t)-1);
+
+    if (pView->_matchCount != pExpectedView->_matchCount || memcmp(pView->_pMatches, pExpectedView->_pMatches, pView->_matchCount * sizeof(size_t)) != 0) {
+        test_fail(testName, "seed %u: there are %zu matches when there should be %zu, or they are in the wrong place", seed, pView->_matchCount, pExpectedView->_matchCount);
+    }
+
+    drte_view_delete(pExpectedView);
+    drte_engine_uninit(&engine);
+    free(text);
+}
+
+// Batches of edits are applied one region at a time when they're small and by rebuilding the text when they're large. Either way
+// everything that depends on the text should end up the same as if the text had been set from scratch.
+static void test_batched_edits_match_a_new_engine()
+{
+    const char* testName = "batched edits match a new engine";
+
+    for (uint32_t seed = 1; seed <= 10; ++seed) {
+        drte_engine engine;
+        test__init_engine(&engine);
+        drte_engine_set_highlighter(&engine, test__on_lex_line, NULL);
+
+        uint32_t randomSeed = seed;
+        static char expected[65536];
+        static char actual[65536];
+        test__random_text(&randomSeed, expected, 3000);
+        drte_engine_set_text(&engine, expected);
+        size_t expectedLength = 3000;
+
+        drte_view* pWrappedView = drte_view_create(&engine);
+        drte_view_set_size(pWrappedView, 160, 480);
+        drte_view_enable_word_wrap(pWrappedView);
+
+        drte_view* pView = drte_view_create(&engine);
+        drte_view_set_size(pView, 640, 480);
+        drte_view_set_match_text(pView, "ab");
+
+        // The edits are made without lexing in between so that each one is made while there are stale states left by the last.
+        drte_engine__lex_to_line(&engine, drte_line_cache_get_line_count(engine.pUnwrappedLines)-1);
+
+        for (int iBatch = 0; iBatch < 30; ++iBatch) {
+            // Everything that's remembered about the text needs to be there before each batch so it can be checked that it's updated.
+            drte_view_wrap_lines(pWrappedView, (size_t)-1);
+            drte_view_index_matches(pView, (size_t)-1);
+
+            size_t lineCount = drte_line_cache_get_line_count(engine.pUnwrappedLines);
+            for (size_t iLine = 0; iLine < lineCount; ++iLine) {
+                float width;
+                drte_view_measure_line(pView, iLine, &width, NULL);
+            }
+
+            // Some batches have more regions than are applied in place. The last few don't so that mistakes made in place aren't hidden by
+            // the text being rebuilt.
+            size_t maxEditCount = (iBatch % 10 == 5) ? DRTE_REPLACE_REGIONS_IN_PLACE_LIMIT*2 : 4;
+
+            drte_edit edits[DRTE_REPLACE_REGIONS_IN_PLACE_LIMIT*2];
+            char texts[DRTE_REPLACE_REGIONS_IN_PLACE_LIMIT*2][8];
+            size_t editCount = 0;
+            size_t iChar = 0;
+            while (editCount < maxEditCount) {
+                iChar += test__rand(&randomSeed) % (2 * expectedLength / maxEditCount + 1);
+                if (iChar > expectedLength) {
+                    break;
+                }
+
+                edits[editCount].iChar = iChar;
+                edits[editCount].deleteLength = test__rand(&randomSeed) % 6;
+                if (edits[editCount].deleteLength > expectedLength - iChar) {
+                    edits[editCount].deleteLength = expectedLength - iChar;
+                }
+
+                edits[editCount].textLength = test__rand(&randomSeed) % 7;
+                test__random_text(&randomSeed, texts[editCount], edits[editCount].textLength);
+                edits[editCount].text = texts[editCount];
+
+                // The next edit needs to start after this one so they aren't combined.
+                iChar += edits[editCount].deleteLength + 1;
+                editCount += 1;
+            }
+
+            // The edits are given in reverse order to make sure they're sorted.
+            for (size_t iEdit = 0; iEdit < editCount/2; ++iEdit) {
+                drte_edit temp = edits[iEdit];
+                edits[iEdit] = edits[editCount-1 - iEdit];
+                edits[editCount-1 - iEdit] = temp;
+            }
+
+            drte_view_apply_edits(pView, edits, editCount);
+
+            for (size_t iEdit = 0; iEdit < editCount; ++iEdit) {
+                const drte_edit* pEdit = &edits[iEdit];
+                memmove(expected + pEdit->iChar + pEdit->textLength, expected + pEdit->iChar + pEdit->deleteLength, expectedLength - (pEdit->iChar + pEdit->deleteLength));
+                memcpy(expected + pEdit->iChar, pEdit->text, pEdit->textLength);
+                expectedLength = expectedLength - pEdit->deleteLength + pEdit->textLength;
+            }
+        }
+
+        size_t actualLength = drte_engine_get_text(&engine, actual, sizeof(actual));
+        if (actualLength != expectedLength || memcmp(actual, expected, expectedLength) != 0) {
+            test_fail(testName, "seed %u: text does not match", seed);
+        }
+
+        test__check_lexer_states(testName, &engine, seed);
+        test__check_line_widths(testName, pView);
+        test__check_wrapped_lines(testName, pWrappedView, seed);
+        test__check_matches(testName, pView, seed);
+
+        drte_view_delete(pView);
+        drte_view_delete(pWrappedView);
+        drte_engine_uninit(&engine);
+    }
+}
+
+// Random edits to a piece table, checked against the same edits made to a flat string. Enough edits are made for the tree of pieces
+// to grow several levels deep and then shrink back down.
+static void test_piece_table_random_edits()
+{
+    const char* testName = "piece table random edits";
+
+    for (uint32_t seed = 1; seed <= 10; ++seed) {
+        uint32_t randomSeed = seed;
+
+        static char original[4096];
+        test__random_text(&randomSeed, original, sizeof(original)-1);
+
+        drte_piece_table table;
+        drte_piece_table_init(&table);
+        drte_piece_table_set_original(&table, original, sizeof(original)-1, DRTE_TRUE);
+
+        size_t expectedLength = sizeof(original)-1;
+        char* expected = (char*)malloc(1024*1024);
+        char* actual   = (char*)malloc(1024*1024);
+        memcpy(expected, original, expectedLength);
+
+        for (int iEdit = 0; iEdit < 20000; ++iEdit) {
+            // Grow for the first half and shrink for the second half.
+            drte_bool32 isInsert = (test__rand(&randomSeed) % 4) < ((iEdit < 10000) ? 3u : 1u);
+            size_t iChar = (expectedLength > 0) ? test__rand(&randomSeed) % (expectedLength + 1) : 0;
+            size_t length = 1 + test__rand(&randomSeed) % 8;
+
+            if (isInsert) {
+                char text[16];
+                test__random_text(&randomSeed, text, length);
+                drte_piece_table_insert(&table, iChar, text, length);
+
+                memmove(expected + iChar + length, expected + iChar, expectedLength - iChar);
+                memcpy(expected + iChar, text, length);
+                expectedLength += length;
+            } else if (iChar < expectedLength) {
+                size_t iCharEnd = drte_min(iChar + length, expectedLength);
+                drte_piece_table_delete(&table, iChar, iCharEnd);
+
+                memmove(expected + iChar, expected + iCharEnd, expectedLength - iCharEnd);
+                expectedLength -= iCharEnd - iChar;
+            }
+
+            if (table.length != expectedLength) {
+                test_fail(testName, "seed %u, edit %d: length is %zu when it should be %zu", seed, iEdit, table.length, expectedLength);
+                break;
+            }
+
+            if (iEdit % 1000 == 0 || iEdit == 19999) {
+                size_t copiedLength = drte_piece_table_copy(&table, 0, table.length, actual);
+                if (copiedLength != expectedLength || memcmp(actual, expected, expectedLength) != 0) {
+                    test_fail(testName, "seed %u, edit %d: text does not match", seed, iEdit);
+                    break;
+                }
+            }
+
+            if (expectedLength > 0) {
+                size_t iCharBeg = test__rand(&randomSeed) % expectedLength;
+                size_t iCharEnd = iCharBeg + test__rand(&randomSeed) % 64;
+                if (iCharEnd > expectedLength) {
+                    iCharEnd = expectedLength;
+                }
+                if (drte_piece_table_get_char(&table, iCharBeg) != expected[iCharBeg]) {
+                    test_fail(testName, "seed %u, edit %d: character %zu does not match", seed, iEdit, iCharBeg);
+                    break;
+                }
+
+                const char* range = drte_piece_table_get_text_range(&table, iCharBeg, iCharEnd);
+                if (memcmp(range, expected + iCharBeg, iCharEnd - iCharBeg) != 0) {
+                    test_fail(testName, "seed %u, edit %d: range %zu-%zu does not match", seed, iEdit, iCharBeg, iCharEnd);
+                    break;
+                }
+
+                if (drte_piece_table_count_newlines(&table, iCharBeg, iCharEnd) != drte__count_newlines(expected + iCharBeg, iCharEnd - iCharBeg)) {
+                    test_fail(testName, "seed %u, edit %d: new line count of range %zu-%zu does not match", seed, iEdit, iCharBeg, iCharEnd);
+                    break;
+                }
+            }
+        }
+
+        free(expected);
+        free(actual);
+        drte_piece_table_uninit(&table);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+
+    test_piece_table_random_edits();
+    test_lexer_states_after_edits_with_word_wrap();
+    test_line_widths_after_replace_all();
+    test_replace_all_reclaims_add_buffer();
+    test_batched_edits_reclaim_add_buffer();
+    test_batched_edits_match_a_new_engine();
+
+    if (g_FailedCount > 0) {
+        printf("%d test(s) failed.\n", g_FailedCount);
+        return 1;
+    }
+
+    printf("All tests passed.\n");
+    return 0;
+}